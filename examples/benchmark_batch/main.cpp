@@ -0,0 +1,78 @@
+#include <tomsolver/tomsolver.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace tomsolver;
+
+/*
+ * Compare the lane-batched SolveBatch (8 parameter sets per batch) with solving the parameter sets one by one,
+ * on a single thread.
+ * The system is the intersection of the circle x^2 + y^2 = r^2 and the curve y = a*sqrt(x).
+ * In the second sweep some parameter sets have no root, so their Newton iterations fail.
+ *
+ * usage: Benchmark_Batch [count] [repeat]
+ * Build in Release mode, timings of unoptimized builds are meaningless.
+ */
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int repeat = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (count <= 0 || repeat <= 0) {
+        std::cerr << "usage: " << argv[0] << " [count] [repeat]" << std::endl;
+        return -1;
+    }
+
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*sqrt(x)"_f};
+    Mat guess = {{1, 1}};
+
+    // run SolveBatch repeat times, return the best time in milliseconds and the number of converged sets
+    auto measure = [&](const Mat &params, bool laneBatched, int &converged) {
+        BatchOptions options;
+        options.threads = 1;
+        options.laneBatched = laneBatched;
+        double best = 1e300;
+        for (int r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            BatchResult result = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, guess, options);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+            converged =
+                static_cast<int>(std::count(result.status.begin(), result.status.end(), BatchStatus::CONVERGED));
+        }
+        return best;
+    };
+
+    auto run = [&](const char *name, const Mat &params) {
+        int convergedLanes = 0, convergedRows = 0;
+        double tLanes = measure(params, true, convergedLanes);
+        double tRows = measure(params, false, convergedRows);
+        std::cout << name << ": " << convergedRows << " of " << count << " converged" << std::endl;
+        std::cout << "  one by one:   " << tRows << " ms" << std::endl;
+        std::cout << "  lane-batched: " << tLanes << " ms (" << tRows / tLanes << "x)" << std::endl;
+        if (convergedLanes != convergedRows) {
+            std::cout << "  mismatch: " << convergedLanes << " converged in lane-batched mode" << std::endl;
+        }
+    };
+
+    Mat params(count, 2);
+    for (int i = 0; i < count; ++i) {
+        params.Value(i, 0) = 0.5 + 1.0e-4 * (i % 20000);
+        params.Value(i, 1) = 1 + 1.0e-3 * (i % 1000);
+    }
+    std::cout << "best of " << repeat << " runs, 1 thread" << std::endl;
+    run("well-posed sweep", params);
+
+    // r = 0 or a = -40: the Newton iteration fails for many of these sets
+    for (int i = 0; i < count; ++i) {
+        if (i % 23 == 3) {
+            params.Value(i, 0) = 0;
+        } else if (i % 19 == 5) {
+            params.Value(i, 1) = -40;
+        }
+    }
+    run("sweep with failing sets", params);
+
+    return 0;
+}
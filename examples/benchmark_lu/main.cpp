@@ -0,0 +1,66 @@
+#include <tomsolver/tomsolver.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace tomsolver;
+
+/*
+ * Compare the double-precision LU factorization with the mixed-precision one
+ * (float factorization + iterative refinement) on a dense diagonally dominant system.
+ *
+ * usage: Benchmark_LU [n] [repeat]
+ * Build in Release mode, timings of unoptimized builds are meaningless.
+ */
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 600;
+    int repeat = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (n <= 0 || repeat <= 0) {
+        std::cerr << "usage: " << argv[0] << " [n] [repeat]" << std::endl;
+        return -1;
+    }
+
+    Mat A(n, n);
+    Vec b(n);
+    for (int i = 0; i < n; ++i) {
+        double rowSum = 0;
+        for (int j = 0; j < n; ++j) {
+            if (i != j) {
+                A.Value(i, j) = std::sin(0.37 * i + 1.3 * j);
+                rowSum += std::abs(A.Value(i, j));
+            }
+        }
+        A.Value(i, i) = rowSum + 1;
+        b[i] = std::cos(0.5 * i);
+    }
+
+    // run the factorization and the solve repeat times, return the best time in milliseconds
+    auto measure = [&](auto &lu, Vec &x) {
+        double best = 1e300;
+        for (int r = 0; r < repeat; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            lu.Factor(A);
+            lu.Solve(b, x);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    };
+
+    Vec x(n), y(n);
+    LUFactorization lu(n);
+    MixedPrecisionLUFactorization mixed(n);
+    double tDouble = measure(lu, x);
+    double tMixed = measure(mixed, y);
+
+    std::cout << "n = " << n << ", best of " << repeat << " runs" << std::endl;
+    std::cout << "double LU:          " << tDouble << " ms" << std::endl;
+    std::cout << "mixed-precision LU: " << tMixed << " ms (" << tDouble / tMixed << "x)" << std::endl;
+    std::cout << "max |x_double - x_mixed| = " << (x - y).NormInfinity() << std::endl;
+    std::cout << "residual of mixed-precision solution = " << (b - (A * y).ToVec()).NormInfinity() << std::endl;
+
+    return 0;
+}
@@ -48,6 +48,9 @@ class MyClass:
 
         self.contents = []
 
+        # 当前所处的#if嵌套层数。条件编译块内的#include <>和#define保留在原位，不提到文件开头
+        ifDepth = 0
+
         for line in lines_orig:
             stripedLine = line.strip()
 
@@ -55,6 +58,11 @@ class MyClass:
             if stripedLine == "#pragma once":
                 continue
 
+            if re.match(r"#\s*if", stripedLine):
+                ifDepth += 1
+            elif re.match(r"#\s*endif", stripedLine):
+                ifDepth -= 1
+
             innerDep = re.match(r"#include\s+\"([a-z_./\\]+)\"", stripedLine)
             if innerDep is not None:
                 basename = innerDep.group(1)
@@ -65,12 +73,12 @@ class MyClass:
                 continue
 
             libDep = re.match(r"#include\s+<([a-z_./\\]+)>", stripedLine)
-            if libDep is not None:
+            if libDep is not None and ifDepth == 0:
                 basename = libDep.group(1)
                 self.depsLib.append(basename)
                 continue
 
-            if stripedLine.find("#define") == 0:
+            if stripedLine.find("#define") == 0 and ifDepth == 0:
                 self.defines.append(stripedLine)
                 continue
 
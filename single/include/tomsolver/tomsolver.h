@@ -3,20 +3,24 @@
 #define _USE_MATH_DEFINES
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <clocale>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <exception>
 #include <forward_list>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <map>
 #include <math.h>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <regex>
 #include <set>
@@ -24,6 +28,7 @@
 #include <stack>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -32,89 +37,23 @@
 
 namespace tomsolver {
 
-constexpr double PI = M_PI;
-
-template <typename T>
-inline T radians(T &&t) noexcept {
-    return std::forward<T>(t) / 180.0 * PI;
-}
-
-template <typename T>
-inline T degrees(T &&t) noexcept {
-    return std::forward<T>(t) * 180.0 / PI;
-}
-
-enum class MathOperator {
-    MATH_NULL,
-    // 一元
-    MATH_POSITIVE,
-    MATH_NEGATIVE,
-
-    // 函数
-    MATH_SIN,
-    MATH_COS,
-    MATH_TAN,
-    MATH_ARCSIN,
-    MATH_ARCCOS,
-    MATH_ARCTAN,
-    MATH_SQRT,
-    MATH_LOG,
-    MATH_LOG2,
-    MATH_LOG10,
-    MATH_EXP,
-
-    // 二元
-    MATH_ADD,
-    MATH_SUB,
-    MATH_MULTIPLY,
-    MATH_DIVIDE,
-    MATH_POWER,
-    MATH_AND,
-    MATH_OR,
-    MATH_MOD,
-
-    MATH_LEFT_PARENTHESIS,
-    MATH_RIGHT_PARENTHESIS
-};
-
-/**
- * 操作符转std::string
- */
-inline std::string MathOperatorToStr(MathOperator op);
-
-/**
- * 取得操作数的数量。
- */
-inline int GetOperatorNum(MathOperator op) noexcept;
-
-/**
-* 返回运算符的优先级
-
-*/
-inline int Rank(MathOperator op) noexcept;
-
-/**
- * 返回运算符结合性
- */
-inline bool IsLeft2Right(MathOperator eOperator) noexcept;
-
-/**
- * 返回是否满足交换律
- */
-inline bool InAssociativeLaws(MathOperator eOperator) noexcept;
+namespace internal {
 
 /**
- * 返回是否是函数
+ * 实际使用的工作线程数量（包括调用者所在的线程）：threads为0时取std::thread::hardware_concurrency()，
+ * 不超过count，至少为1。
  */
-inline bool IsFunction(MathOperator op) noexcept;
+inline int ParallelWorkers(int count, int threads) noexcept;
 
 /**
- * 是整数 且 为偶数
- * FIXME: 超出long long范围的处理
+ * 用ParallelWorkers(count, threads)个线程（包括调用者所在的线程）并行执行body(worker, k)，k = 0..count-1。
+ * 每个k只执行一次，执行顺序不定；worker为执行它的线程编号，取值[0, ParallelWorkers(count, threads))，
+ * 可以用来访问每个线程自己的数据。各线程都使用调用者所在线程的Config::Get()（见ConfigScope）。
+ * body抛出异常后不再开始新的k，等所有线程结束后，重新抛出第一个异常。
  */
-inline bool IsIntAndEven(double n) noexcept;
+inline void ParallelFor(int count, int threads, const std::function<void(int, int)> &body);
 
-inline double Calc(MathOperator op, double v1, double v2);
+} // namespace internal
 
 } // namespace tomsolver
 /*
@@ -141,8 +80,104 @@ inline Original Inverse(), Adjoint(), GetCofactor(), Det() is from https://githu
 
 namespace tomsolver {
 
+class Mat;
 class Vec;
 
+namespace internal {
+
+/**
+ * 所有矩阵表达式的公共基类，仅用于类型判断。
+ */
+struct MatExprTag {};
+
+} // namespace internal
+
+/**
+ * 逐元素矩阵表达式的基类（表达式模板）。MatView、VecView等视图也是矩阵表达式。
+ * Mat/Vec之间的+、-和数乘不立即计算，而是返回表达式对象。表达式被赋值给Mat/Vec时，
+ * 整条运算链在一个循环里逐元素求值，只分配一次结果的内存；赋值给已有的同尺寸对象时不分配内存。
+ *
+ * 表达式以引用保存作为左值的Mat/Vec，临时的Mat/Vec则被移动到表达式内部保存。
+ * 因此用auto保存表达式时，被引用的Mat/Vec必须在表达式求值前保持有效，且求值结果反映的是求值时的值。
+ * 表达式可以像Mat/Vec一样用[]取元素、调用ToVec()、参与点乘和比较。
+ * 需要立即得到结果时，赋值给Mat/Vec或调用Eval()。
+ */
+template <typename E>
+class MatExpr : public internal::MatExprTag {
+public:
+    const E &Derived() const noexcept {
+        return static_cast<const E &>(*this);
+    }
+
+    int Rows() const noexcept {
+        return Derived().Rows();
+    }
+
+    int Cols() const noexcept {
+        return Derived().Cols();
+    }
+
+    /**
+     * 按行连续存储的顺序，把表达式的值写入out。out可以与表达式引用的矩阵是同一块内存。
+     */
+    void EvalTo(double *out) const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        for (int i = 0; i < n; ++i) {
+            out[i] = e.Coeff(i);
+        }
+    }
+
+    /**
+     * 按行连续存储的顺序取第i个元素。
+     */
+    double operator[](int i) const noexcept {
+        return Derived().Coeff(i);
+    }
+
+    /**
+     * 计算表达式的值。
+     */
+    Mat Eval() const noexcept;
+
+    /**
+     * 计算表达式的值并输出Vec。如果列数不为1，抛出异常。
+     * @exception runtime_error 列数不为1
+     */
+    Vec ToVec() const;
+
+    /**
+     * 各元素的平方和，不生成中间矩阵。
+     */
+    double Norm2() const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            double v = e.Coeff(i);
+            ret += v * v;
+        }
+        return ret;
+    }
+
+    /**
+     * 各元素绝对值的最大值，不生成中间矩阵。出现nan时返回nan，与Mat::NormInfinity一致。
+     */
+    double NormInfinity() const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            double a = std::abs(e.Coeff(i));
+            if (std::isnan(a)) {
+                return a;
+            }
+            ret = std::max(ret, a);
+        }
+        return ret;
+    }
+};
+
 class Mat {
 public:
     explicit Mat(int row, int col, double initValue = 0) noexcept;
@@ -151,11 +186,31 @@ public:
 
     Mat(int row, int col, std::valarray<double> data) noexcept;
 
+    /**
+     * 对表达式求值。
+     */
+    template <typename E>
+    Mat(const MatExpr<E> &expr) noexcept : rows(expr.Rows()), cols(expr.Cols()), data(rows * cols) {
+        expr.EvalTo(Data());
+    }
+
     Mat(const Mat &) = default;
     Mat(Mat &&) = default;
     Mat &operator=(const Mat &) = default;
     Mat &operator=(Mat &&) = default;
 
+    /**
+     * 对表达式求值。尺寸相同时直接写入已有的内存，不分配内存。
+     */
+    template <typename E>
+    Mat &operator=(const MatExpr<E> &expr) noexcept {
+        if (rows != expr.Rows() || cols != expr.Cols()) {
+            return *this = Mat(expr);
+        }
+        expr.EvalTo(Data());
+        return *this;
+    }
+
     std::slice_array<double> Row(int i, int offset = 0);
     std::slice_array<double> Col(int j, int offset = 0);
     auto Row(int i, int offset = 0) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]);
@@ -163,29 +218,69 @@ public:
     const double &Value(int i, int j) const;
     double &Value(int i, int j);
 
+    /**
+     * 按行连续存放的元素。空矩阵返回nullptr。
+     */
+    const double *Data() const noexcept {
+        return data.size() ? std::addressof(data[0]) : nullptr;
+    }
+
+    double *Data() noexcept {
+        return data.size() ? std::addressof(data[0]) : nullptr;
+    }
+
     bool operator==(double m) const noexcept;
     bool operator==(const Mat &b) const noexcept;
 
-    // be negative
-    Mat operator-() noexcept;
-
-    Mat operator+(const Mat &b) const noexcept;
     Mat &operator+=(const Mat &b) noexcept;
 
-    Mat operator-(const Mat &b) const noexcept;
+    template <typename E>
+    Mat &operator+=(const MatExpr<E> &expr) noexcept {
+        assert(rows == expr.Rows());
+        assert(cols == expr.Cols());
+        const E &e = expr.Derived();
+        for (int i = 0; i < rows * cols; ++i) {
+            data[i] += e.Coeff(i);
+        }
+        return *this;
+    }
+
+    Mat &operator-=(const Mat &b) noexcept;
+
+    template <typename E>
+    Mat &operator-=(const MatExpr<E> &expr) noexcept {
+        assert(rows == expr.Rows());
+        assert(cols == expr.Cols());
+        const E &e = expr.Derived();
+        for (int i = 0; i < rows * cols; ++i) {
+            data[i] -= e.Coeff(i);
+        }
+        return *this;
+    }
+
+    Mat &operator*=(double k) noexcept;
 
-    Mat operator*(double m) const noexcept;
     Mat operator*(const Mat &b) const noexcept;
 
-    int Rows() const noexcept;
+    int Rows() const noexcept {
+        return rows;
+    }
 
-    int Cols() const noexcept;
+    int Cols() const noexcept {
+        return cols;
+    }
 
     /**
      * 输出Vec。如果列数不为1，抛出异常。
      * @exception runtime_error 列数不为1
      */
-    Vec ToVec() const;
+    Vec ToVec() const &;
+
+    /**
+     * 输出Vec，直接移走自身的数据，不复制。如果列数不为1，抛出异常。
+     * @exception runtime_error 列数不为1
+     */
+    Vec ToVec() &&;
 
     Mat &SwapRow(int i, int j) noexcept;
     Mat &SwapCol(int i, int j) noexcept;
@@ -209,7 +304,7 @@ public:
     void SetValue(double value) noexcept;
 
     /**
-     * 返回矩阵是否正定。
+     * 返回矩阵是否正定。通过Cholesky分解判断，只使用矩阵的下三角部分，因此矩阵应当是对称矩阵。
      */
     bool PositiveDetermine() const noexcept;
 
@@ -226,7 +321,6 @@ protected:
     int cols;
     std::valarray<double> data;
 
-    friend Mat operator*(double k, const Mat &mat) noexcept;
     friend std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept;
     friend Mat EachDivide(const Mat &a, const Mat &b) noexcept;
     friend bool IsZero(const Mat &mat) noexcept;
@@ -234,10 +328,10 @@ protected:
     friend void GetCofactor(const Mat &A, Mat &temp, int p, int q, int n) noexcept;
     friend void Adjoint(const Mat &A, Mat &adj) noexcept;
     friend double Det(const Mat &A, int n) noexcept;
+    friend Mat TransposeMultiply(const Mat &A) noexcept;
+    friend Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept;
 };
 
-inline Mat operator*(double k, const Mat &mat) noexcept;
-
 inline std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept;
 
 inline Mat EachDivide(const Mat &a, const Mat &b) noexcept;
@@ -256,7 +350,7 @@ inline void Adjoint(const Mat &A, Mat &adj) noexcept;
 inline void GetCofactor(const Mat &A, Mat &temp, int p, int q, int n) noexcept;
 
 /**
- * 计算矩阵的行列式值。
+ * 计算矩阵左上角n阶子矩阵的行列式值。使用列主元消元，复杂度O(n³)。
  */
 inline double Det(const Mat &A, int n) noexcept;
 
@@ -268,6 +362,29 @@ public:
 
     Vec(std::valarray<double> data) noexcept;
 
+    /**
+     * 对表达式求值。表达式必须只有1列。
+     */
+    template <typename E>
+    Vec(const MatExpr<E> &expr) noexcept : Mat(expr) {
+        assert(cols == 1);
+    }
+
+    Vec(const Vec &) = default;
+    Vec(Vec &&) = default;
+    Vec &operator=(const Vec &) = default;
+    Vec &operator=(Vec &&) = default;
+
+    /**
+     * 对表达式求值。尺寸相同时直接写入已有的内存，不分配内存。
+     */
+    template <typename E>
+    Vec &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Cols() == 1);
+        Mat::operator=(expr);
+        return *this;
+    }
+
     Mat &AsMat() noexcept;
 
     void Resize(int newRows) noexcept;
@@ -276,1368 +393,1734 @@ public:
 
     double operator[](std::size_t i) const noexcept;
 
-    Vec operator+(const Vec &b) const noexcept;
-
-    // be negative
-    Vec operator-() noexcept;
-
-    Vec operator-(const Vec &b) const noexcept;
-
-    Vec operator*(double m) const noexcept;
-
     Vec operator*(const Vec &b) const noexcept;
 
     Vec operator/(const Vec &b) const noexcept;
 
     bool operator<(const Vec &b) noexcept;
-
-    friend double Dot(const Vec &a, const Vec &b) noexcept;
-    friend Vec operator*(double k, const Vec &V);
 };
 
 /**
- * 向量点乘。
+ * 计算AᵀA，不生成转置矩阵。
  */
-inline double Dot(const Vec &a, const Vec &b) noexcept;
+inline Mat TransposeMultiply(const Mat &A) noexcept;
 
-} // namespace tomsolver
+/**
+ * 计算Aᵀb，不生成转置矩阵。
+ */
+inline Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept;
 
-namespace tomsolver {
+template <typename E>
+inline Mat MatExpr<E>::Eval() const noexcept {
+    return Mat(*this);
+}
+
+template <typename E>
+inline Vec MatExpr<E>::ToVec() const {
+    if (Cols() != 1) {
+        throw std::runtime_error("MatExpr::ToVec fail. cols is not one");
+    }
+    return Vec(*this);
+}
 
 /**
- * 求解线性方程组Ax = b。传入矩阵A，向量b，返回向量x。
- * @exception MathError 奇异矩阵
- * @exception MathError 矛盾方程组
- * @exception MathError 不定方程（设置Config::Get().allowIndeterminateEquation=true可以允许不定方程组返回一组特解）
- *
+ * 表达式与矩阵比较，先对表达式求值。
  */
-inline Vec SolveLinear(Mat A, Vec b);
+template <typename E>
+inline bool operator==(const MatExpr<E> &a, const Mat &b) noexcept {
+    return b == a.Eval();
+}
 
-} // namespace tomsolver
+template <int N, int M>
+class FixedMat;
 
-namespace tomsolver {
+namespace internal {
 
-enum class ErrorType {
-    ERROR_INVALID_NUMBER,                // 出现无效的浮点数(inf, -inf, nan)
-    ERROR_ILLEGALCHAR,                   // 出现非法字符
-    ERROR_INVALID_VARNAME,               // 无效变量名
-    ERROR_WRONG_EXPRESSION,              // 表达式逻辑不正确
-    ERROR_EMPTY_INPUT,                   // 表达式为空
-    ERROR_UNDEFINED_VARIABLE,            // 未定义的变量
-    ERROR_SUBS_NOT_EQUAL,                // 替换与被替换数量不对等
-    ERROR_NOT_LINK_VARIABLETABLE,        // 未链接变量表
-    ERROR_OUTOF_DOMAIN,                  // 计算超出定义域
-    ERROR_VAR_COUNT_NOT_EQUAL_NUM_COUNT, // 定义变量时变量数量与初始值不等
-    ERROR_VAR_HAS_BEEN_DEFINED,          // 变量重定义
-    ERROR_INDETERMINATE_EQUATION,        // 不定方程
-    ERROR_SINGULAR_MATRIX,               // 矩阵奇异
-    ERROR_INFINITY_SOLUTIONS,            // 无穷多解
-    ERROR_OVER_DETERMINED_EQUATIONS,     // 方程组过定义
-    SIZE_NOT_MATCH                       // 维数不匹配
-};
+/**
+ * 表达式中以引用保存的Mat/Vec。求值时才读取数据的地址，因此被引用的对象在此之前可以被重新赋值。
+ */
+class MatRef : public MatExpr<MatRef> {
+public:
+    explicit MatRef(const Mat &m) noexcept : m(m) {}
 
-inline std::string GetErrorInfo(ErrorType err);
+    int Rows() const noexcept {
+        return m.Rows();
+    }
 
-class MathError : public std::runtime_error {
+    int Cols() const noexcept {
+        return m.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return m.Data()[i];
+    }
+
+private:
+    const Mat &m;
+};
+
+/**
+ * 表达式中以值保存的临时Mat/Vec。
+ */
+class MatValue : public MatExpr<MatValue> {
 public:
-    MathError(ErrorType errorType, const std::string &extInfo = {});
+    explicit MatValue(Mat &&m) noexcept : m(std::move(m)) {}
 
-    virtual const char *what() const noexcept override;
+    explicit MatValue(const Mat &m) noexcept : m(m) {}
 
-    ErrorType GetErrorType() const noexcept;
+    int Rows() const noexcept {
+        return m.Rows();
+    }
+
+    int Cols() const noexcept {
+        return m.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return m.Data()[i];
+    }
 
 private:
-    ErrorType errorType;
-    std::string errInfo;
+    Mat m;
 };
 
-} // namespace tomsolver
+struct PlusOp {
+    static double Apply(double a, double b) noexcept {
+        return a + b;
+    }
+};
 
-namespace tomsolver {
+struct MinusOp {
+    static double Apply(double a, double b) noexcept {
+        return a - b;
+    }
+};
 
-inline std::string GetErrorInfo(ErrorType err) {
-    switch (err) {
-    case ErrorType::ERROR_INVALID_NUMBER:
-        return u8"invalid number";
-        break;
-    case ErrorType::ERROR_ILLEGALCHAR:
-        return u8"illegal character";
-        break;
-    case ErrorType::ERROR_INVALID_VARNAME:
-        return u8"invalid variable name (must start with an underscore \"_\" or a letter)";
-        break;
-    case ErrorType::ERROR_WRONG_EXPRESSION:
-        return u8"invalid expression";
-        break;
-    case ErrorType::ERROR_EMPTY_INPUT:
-        return u8"empty input";
-        break;
-    case ErrorType::ERROR_UNDEFINED_VARIABLE:
-        return u8"undefined variable";
-        break;
-    case ErrorType::ERROR_SUBS_NOT_EQUAL:
-        return u8"number of substitutions does not match the number of items to be replaced";
-        break;
-    case ErrorType::ERROR_NOT_LINK_VARIABLETABLE:
-        return u8"not linked variable table";
-        break;
-    case ErrorType::ERROR_OUTOF_DOMAIN:
-        return u8"out of domain";
-        break;
-    case ErrorType::ERROR_VAR_COUNT_NOT_EQUAL_NUM_COUNT:
-        return u8"the number of variable is not equal with number count";
-        break;
-    case ErrorType::ERROR_VAR_HAS_BEEN_DEFINED:
-        return u8"variable redefined";
-        break;
-    case ErrorType::ERROR_INDETERMINATE_EQUATION:
-        return u8"indeterminate equation";
-        break;
-    case ErrorType::ERROR_SINGULAR_MATRIX:
-        return u8"singular matrix";
-        break;
-    case ErrorType::ERROR_INFINITY_SOLUTIONS:
-        return u8"infinite solutions";
-        break;
-    case ErrorType::ERROR_OVER_DETERMINED_EQUATIONS:
-        return u8"overdetermined equations";
-        break;
-    case ErrorType::SIZE_NOT_MATCH:
-        return u8"size does not match";
-    default:
-        assert(0);
-        break;
+/**
+ * 逐元素的二元运算。
+ */
+template <typename Op, typename L, typename R>
+class MatBinaryExpr : public MatExpr<MatBinaryExpr<Op, L, R>> {
+public:
+    MatBinaryExpr(L lhs, R rhs) noexcept : l(std::move(lhs)), r(std::move(rhs)) {
+        assert(l.Rows() == r.Rows());
+        assert(l.Cols() == r.Cols());
     }
-    return u8"GetErrorInfo: bug";
-}
 
-inline MathError::MathError(ErrorType errorType, const std::string &extInfo)
-    : std::runtime_error(extInfo), errorType(errorType) {
-    errInfo = GetErrorInfo(errorType);
-    if (!extInfo.empty()) {
-        errInfo += ": \"" + extInfo + "\"";
+    int Rows() const noexcept {
+        return l.Rows();
     }
-}
 
-inline const char *MathError::what() const noexcept {
-    return errInfo.c_str();
-}
+    int Cols() const noexcept {
+        return l.Cols();
+    }
 
-inline ErrorType MathError::GetErrorType() const noexcept {
-    return errorType;
-}
+    double Coeff(int i) const noexcept {
+        return Op::Apply(l.Coeff(i), r.Coeff(i));
+    }
 
-} // namespace tomsolver
+private:
+    L l;
+    R r;
+};
 
-namespace tomsolver {
+/**
+ * 数乘。
+ */
+template <typename E>
+class MatScaleExpr : public MatExpr<MatScaleExpr<E>> {
+public:
+    MatScaleExpr(double k, E e) noexcept : k(k), e(std::move(e)) {}
 
-enum class LogLevel { OFF, FATAL, ERROR, WARN, INFO, DEBUG, TRACE, ALL };
+    int Rows() const noexcept {
+        return e.Rows();
+    }
 
-enum class NonlinearMethod { NEWTON_RAPHSON, LM };
+    int Cols() const noexcept {
+        return e.Cols();
+    }
 
-struct Config {
-    /**
-     * 指定出现浮点数无效值(inf, -inf, nan)时，是否抛出异常。默认为true。
-     */
-    bool throwOnInvalidValue = true;
+    double Coeff(int i) const noexcept {
+        return k * e.Coeff(i);
+    }
 
-    double epsilon = 1.0e-9;
+private:
+    double k;
+    E e;
+};
 
-    LogLevel logLevel = LogLevel::WARN;
+template <typename T>
+struct IsMatExpr : std::is_base_of<MatExprTag, std::decay_t<T>> {};
 
-    /**
-     * 最大迭代次数限制
-     */
-    int maxIterations = 100;
+template <typename T>
+struct IsMatOperand
+    : std::integral_constant<bool, std::is_base_of<Mat, std::decay_t<T>>::value || IsMatExpr<T>::value> {};
 
-    /**
-     * 求解方法
-     */
-    NonlinearMethod nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+template <typename T>
+struct IsFixedMat : std::false_type {};
 
-    /**
-     * 非线性方程求解时，当没有为VarsTable传初值时，设定的初值
-     */
-    double initialValue = 1.0;
+template <int N, int M>
+struct IsFixedMat<FixedMat<N, M>> : std::true_type {};
 
-    /**
-     * 是否允许不定方程存在。
-     * 例如，当等式数量大于未知数数量时，方程组成为不定方程；
-     * 如果允许，此时将返回一组特解；如果不允许，将抛出异常。
-     */
-    bool allowIndeterminateEquation = false;
+/**
+ * 运算数都是FixedMat时使用fixed_mat.h中的重载，结果仍是FixedMat。
+ */
+template <typename L, typename R>
+using EnableIfMatOperands =
+    std::enable_if_t<IsMatOperand<L>::value && IsMatOperand<R>::value &&
+                     !(IsFixedMat<std::decay_t<L>>::value && IsFixedMat<std::decay_t<R>>::value)>;
 
-    void Reset() noexcept;
+template <typename T>
+using EnableIfMatOperand = std::enable_if_t<IsMatOperand<T>::value && !IsFixedMat<std::decay_t<T>>::value>;
 
-    static Config &Get();
+/**
+ * 运算数在表达式中的保存方式：左值Mat/Vec保存引用，右值Mat/Vec保存值，表达式保存值。
+ */
+template <typename T, bool = std::is_base_of<Mat, std::decay_t<T>>::value>
+struct MatOperand {
+    using type = std::decay_t<T>;
 };
 
-inline std::string ToString(double value) noexcept;
+template <typename T>
+struct MatOperand<T &, true> {
+    using type = MatRef;
+};
 
-} // namespace tomsolver
+template <typename T>
+struct MatOperand<T, true> {
+    using type = MatValue;
+};
 
-namespace tomsolver {
+template <typename T>
+using MatOperandT = typename MatOperand<T>::type;
 
-namespace {
+template <typename T>
+inline MatOperandT<T> MakeMatOperand(T &&t) noexcept {
+    return MatOperandT<T>(std::forward<T>(t));
+}
 
-static const std::tuple<const char *, std::regex> strategies[] = {
-    {"%.16e", std::regex{"\\.?0+(?=e)"}},
-    {"%.16f", std::regex{"\\.?0+(?=$)"}},
-};
+} // namespace internal
 
+template <typename L, typename R, typename = internal::EnableIfMatOperands<L, R>>
+inline auto operator+(L &&l, R &&r) noexcept {
+    using Expr = internal::MatBinaryExpr<internal::PlusOp, internal::MatOperandT<L>, internal::MatOperandT<R>>;
+    return Expr(internal::MakeMatOperand(std::forward<L>(l)), internal::MakeMatOperand(std::forward<R>(r)));
 }
 
-inline std::string ToString(double value) noexcept {
-    if (value == 0.0) {
-        return "0";
-    }
-
-    char buf[64];
+template <typename L, typename R, typename = internal::EnableIfMatOperands<L, R>>
+inline auto operator-(L &&l, R &&r) noexcept {
+    using Expr = internal::MatBinaryExpr<internal::MinusOp, internal::MatOperandT<L>, internal::MatOperandT<R>>;
+    return Expr(internal::MakeMatOperand(std::forward<L>(l)), internal::MakeMatOperand(std::forward<R>(r)));
+}
 
-    // 绝对值过大 或者 绝对值过小，应该使用科学计数法来表示
-    auto getStrategyIdx = [absValue = std::abs(value)] {
-        return (absValue >= 1.0e16 || absValue <= 1.0e-16) ? 0 : 1;
-    };
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+inline auto operator*(double k, T &&m) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(k, internal::MakeMatOperand(std::forward<T>(m)));
+}
 
-    auto &strategy = strategies[getStrategyIdx()];
-    auto fmt = std::get<0>(strategy);
-    auto &re = std::get<1>(strategy);
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+inline auto operator*(T &&m, double k) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(k, internal::MakeMatOperand(std::forward<T>(m)));
+}
 
-    snprintf(buf, sizeof(buf), fmt, value);
-    return std::regex_replace(buf, re, "");
+// be negative
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+inline auto operator-(T &&m) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(-1, internal::MakeMatOperand(std::forward<T>(m)));
 }
 
-inline void Config::Reset() noexcept {
-    *this = {};
+/**
+ * 表达式与矩阵相乘（矩阵乘法）。
+ */
+template <typename E>
+inline Mat operator*(const MatExpr<E> &a, const Mat &b) noexcept {
+    return a.Eval() * b;
 }
 
-inline Config &Config::Get() {
-    static Config config;
-    return config;
+/**
+ * 表达式与向量相乘。与Mat/Vec的运算规则一致：表达式的列数等于向量的行数时为矩阵乘法，否则为逐元素相乘。
+ */
+template <typename E>
+inline Vec operator*(const MatExpr<E> &a, const Vec &b) noexcept {
+    if (a.Cols() == b.Rows()) {
+        return (a.Eval() * b).ToVec();
+    }
+    return Vec(a) * b;
 }
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
+namespace internal {
+
+/*
+ * 稠密矩阵、向量运算的底层内核。矩阵均按行连续存储（与Mat一致）。
+ * 第一次调用时通过cpuid检测CPU支持的指令集，之后使用对应的SSE2/AVX2/AVX-512实现；
+ * 非x86平台使用标量实现。各实现对nan的处理相同。
+ */
+
 /**
- * 变量表。
- * 内部保存了多个变量名及其数值的对应关系。
+ * 向量内核可用的SIMD指令集。
  */
-class VarsTable {
-public:
-    /**
-     * 新建变量表。
-     * @param vars 变量数组
-     * @param initValue 初值
-     */
-    VarsTable(const std::vector<std::string> &vars, double initValue);
+enum class SimdLevel { SCALAR, SSE2, AVX2, AVX512 };
 
-    /**
-     * 新建变量表。
-     * @param vars 变量数组
-     * @param initValue 初值
-     */
-    explicit VarsTable(std::initializer_list<std::pair<std::string, double>> initList);
+/**
+ * 返回当前CPU上内核实际使用的指令集。
+ */
+inline SimdLevel GetSimdLevel() noexcept;
 
-    /**
-     * 新建变量表。
-     * @param vars 变量数组
-     * @param initValue 初值
-     */
-    explicit VarsTable(const std::map<std::string, double> &table) noexcept;
+/**
+ * 改用指定指令集的内核，但不超过CPU实际支持的级别。返回实际使用的指令集。
+ * 用于对比测试各指令集的实现。可以与内核调用并发，但正在执行的调用仍使用原来的实现。
+ */
+inline SimdLevel SetSimdLevel(SimdLevel level) noexcept;
 
-    /**
-     * 变量数量。
-     */
-    int VarNums() const noexcept;
+/**
+ * 返回x和y的点积。
+ */
+inline double Dot(int n, const double *x, const double *y) noexcept;
 
-    /**
-     * 返回std::vector容器包装的变量名数组。
-     */
-    const std::vector<std::string> &Vars() const noexcept;
+/**
+ * 返回x各元素绝对值的最大值。出现nan时返回nan。
+ */
+inline double AbsMax(int n, const double *x) noexcept;
 
-    /**
-     * 返回所有变量名对应的值的数值向量。
-     */
-    const Vec &Values() const noexcept;
+/**
+ * out = x + alpha * y。out可以与x或y重叠（完全相同的地址）。
+ */
+inline void ScaledAdd(int n, const double *x, double alpha, const double *y, double *out) noexcept;
 
-    /**
-     * 设置数值向量。
-     */
-    void SetValues(const Vec &v) noexcept;
+/**
+ * 返回是否所有|x[i]| < tol。出现nan时返回false。
+ */
+inline bool AllAbsLess(int n, const double *x, double tol) noexcept;
 
-    /**
-     * 返回是否有指定的变量。
-     */
-    bool Has(const std::string &varname) const noexcept;
+/**
+ * 返回是否所有|x[i] - y[i]| < tol。出现nan时返回false。
+ */
+inline bool AllAbsDiffLess(int n, const double *x, const double *y, double tol) noexcept;
 
-    std::string ToString() const noexcept;
+/**
+ * C = A * B。A为m×k，B为k×n，C为m×n。C不能与A、B重叠。
+ */
+inline void Gemm(int m, int n, int k, const double *A, const double *B, double *C) noexcept;
 
-    std::map<std::string, double>::const_iterator begin() const noexcept;
+/**
+ * C = Aᵀ * A，不生成Aᵀ。A为m×n，C为n×n。C不能与A重叠。
+ */
+inline void SyrkTranspose(int m, int n, const double *A, double *C) noexcept;
 
-    std::map<std::string, double>::const_iterator end() const noexcept;
+/**
+ * y = Aᵀ * x，不生成Aᵀ。A为m×n，x的长度为m，y的长度为n。y不能与A、x重叠。
+ */
+inline void GemvTranspose(int m, int n, const double *A, const double *x, double *y) noexcept;
 
-    std::map<std::string, double>::const_iterator cbegin() const noexcept;
+} // namespace internal
 
-    std::map<std::string, double>::const_iterator cend() const noexcept;
+} // namespace tomsolver
 
-    bool operator==(const VarsTable &rhs) const noexcept;
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TOMSOLVER_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
-    /**
-     * 根据变量名获取数值。
-     * @exception out_of_range 如果没有这个变量，抛出异常
-     */
-    double operator[](const std::string &varname) const;
+// GCC和Clang需要为使用了对应指令集的函数单独指定target，MSVC不需要
+#if defined(__GNUC__) || defined(__clang__)
+#define TOMSOLVER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TOMSOLVER_TARGET(isa)
+#endif
 
-private:
-    std::vector<std::string> vars;
-    Vec values;
-    std::map<std::string, double> table;
-};
+namespace tomsolver {
 
-inline std::ostream &operator<<(std::ostream &out, const VarsTable &table) noexcept;
+namespace internal {
 
-} // namespace tomsolver
+namespace {
 
-namespace tomsolver {
+// 分块大小：A的MC×KC子块和B的KC×NC子块在计算过程中常驻缓存
+constexpr int GEMM_MC = 64;
+constexpr int GEMM_KC = 256;
+constexpr int GEMM_NC = 128;
 
-inline VarsTable::VarsTable(const std::vector<std::string> &vars, double initValue)
-    : vars(vars), values(static_cast<int>(vars.size()), initValue) {
-    for (auto &var : vars) {
-        table.insert({var, initValue});
+// AᵀA按NB×NB分块计算，保证C的子块常驻缓存
+constexpr int SYRK_NB = 128;
+
+/*
+ * 标量实现。
+ */
+
+inline double DotScalar(int n, const double *x, const double *y) noexcept {
+    double ret = 0;
+    for (int i = 0; i < n; ++i) {
+        ret += x[i] * y[i];
     }
-    assert(vars.size() == table.size() && "vars is not unique");
+    return ret;
 }
 
-inline VarsTable::VarsTable(std::initializer_list<std::pair<std::string, double>> initList)
-    : VarsTable({initList.begin(), initList.end()}) {
-    assert(vars.size() == table.size() && "vars is not unique");
-}
-
-inline VarsTable::VarsTable(const std::map<std::string, double> &table) noexcept
-    : vars(table.size()), values(static_cast<int>(table.size())), table(table) {
-    int i = 0;
-    for (auto &item : table) {
-        vars[i] = item.first;
-        values[i] = item.second;
-        ++i;
+inline double AbsMaxScalar(int n, const double *x) noexcept {
+    double ret = 0;
+    for (int i = 0; i < n; ++i) {
+        double a = std::abs(x[i]);
+        if (std::isnan(a)) {
+            return a;
+        }
+        ret = std::max(ret, a);
     }
+    return ret;
 }
 
-inline int VarsTable::VarNums() const noexcept {
-    return static_cast<int>(table.size());
+inline void ScaledAddScalar(int n, const double *x, double alpha, const double *y, double *out) noexcept {
+    for (int i = 0; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
 }
 
-inline const std::vector<std::string> &VarsTable::Vars() const noexcept {
-    return vars;
+inline bool AllAbsLessScalar(int n, const double *x, double tol) noexcept {
+    for (int i = 0; i < n; ++i) {
+        if (!(std::abs(x[i]) < tol)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-inline const Vec &VarsTable::Values() const noexcept {
-    return values;
+inline bool AllAbsDiffLessScalar(int n, const double *x, const double *y, double tol) noexcept {
+    for (int i = 0; i < n; ++i) {
+        if (!(std::abs(x[i] - y[i]) < tol)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-inline void VarsTable::SetValues(const Vec &v) noexcept {
-    assert(v.Rows() == values.Rows());
-    values = v;
-    for (int i = 0; i < values.Rows(); ++i) {
-        table[vars[i]] = v[i];
+/**
+ * 4行×8列的寄存器分块：C(4×8) += A(4×k) * B(k×8)。
+ */
+inline void GemmMicroKernel4x8Scalar(int k, const double *A, int lda, const double *B, int ldb, double *C,
+                                     int ldc) noexcept {
+    double c[4][8];
+    for (int r = 0; r < 4; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            c[r][j] = C[r * ldc + j];
+        }
+    }
+    for (int p = 0; p < k; ++p) {
+        const double *b = B + p * ldb;
+        for (int r = 0; r < 4; ++r) {
+            double a = A[r * lda + p];
+            for (int j = 0; j < 8; ++j) {
+                c[r][j] += a * b[j];
+            }
+        }
+    }
+    for (int r = 0; r < 4; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            C[r * ldc + j] = c[r][j];
+        }
     }
 }
 
-inline bool VarsTable::Has(const std::string &varname) const noexcept {
-    return table.find(varname) != table.end();
+#if defined(TOMSOLVER_KERNELS_X86)
+
+/**
+ * 合并SIMD整块部分和剩余尾部的AbsMax结果，尾部出现nan时返回nan。
+ */
+inline double CombineAbsMax(double head, double tail) noexcept {
+    return std::isnan(tail) ? tail : std::max(head, tail);
 }
 
-inline std::string VarsTable::ToString() const noexcept {
-    std::string ret;
-    for (auto &item : table) {
-        ret += item.first + " = " + tomsolver::ToString(item.second) + "\n";
+/*
+ * SSE2实现。每次处理2个double。
+ */
+
+inline TOMSOLVER_TARGET("sse2") double DotSse2(int n, const double *x, const double *y) noexcept {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    double ret = _mm_cvtsd_f64(_mm_add_sd(s0, _mm_unpackhi_pd(s0, s0)));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
     }
     return ret;
 }
 
-inline std::map<std::string, double>::const_iterator VarsTable::begin() const noexcept {
-    return table.begin();
+inline TOMSOLVER_TARGET("sse2") double AbsMaxSse2(int n, const double *x) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d m = _mm_setzero_pd();
+    __m128d nan = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        m = _mm_max_pd(m, _mm_andnot_pd(sign, v));
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+    }
+    if (_mm_movemask_pd(nan)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double ret = _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
 }
 
-inline std::map<std::string, double>::const_iterator VarsTable::end() const noexcept {
-    return table.end();
+inline TOMSOLVER_TARGET("sse2") void ScaledAddSse2(int n, const double *x, double alpha, const double *y,
+                                                   double *out) noexcept {
+    const __m128d a = _mm_set1_pd(alpha);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(a, _mm_loadu_pd(y + i))));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
 }
 
-inline std::map<std::string, double>::const_iterator VarsTable::cbegin() const noexcept {
-    return table.cbegin();
+inline TOMSOLVER_TARGET("sse2") bool AllAbsLessSse2(int n, const double *x, double tol) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d t = _mm_set1_pd(tol);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        if (_mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, _mm_loadu_pd(x + i)), t)) != 0x3) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
 }
 
-inline std::map<std::string, double>::const_iterator VarsTable::cend() const noexcept {
-    return table.cend();
+inline TOMSOLVER_TARGET("sse2") bool AllAbsDiffLessSse2(int n, const double *x, const double *y, double tol) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d t = _mm_set1_pd(tol);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i));
+        if (_mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, d), t)) != 0x3) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
 }
 
-inline bool VarsTable::operator==(const VarsTable &rhs) const noexcept {
-    return values.Rows() == rhs.values.Rows() &&
-           std::equal(table.begin(), table.end(), rhs.table.begin(), [](const auto &lhs, const auto &rhs) {
-               auto &lVar = lhs.first;
-               auto &lVal = lhs.second;
-               auto &rVar = rhs.first;
-               auto &rVal = rhs.second;
-               return lVar == rVar && std::abs(lVal - rVal) <= Config::Get().epsilon;
-           });
+/*
+ * AVX2 + FMA实现。每次处理4个double。
+ */
+
+inline TOMSOLVER_TARGET("avx2,fma") double DotAvx2(int n, const double *x, const double *y) noexcept {
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+    }
+    s0 = _mm256_add_pd(s0, s1);
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    double ret = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
 }
 
-inline double VarsTable::operator[](const std::string &varname) const {
-    auto it = table.find(varname);
-    if (it == table.end()) {
-        throw std::out_of_range("no such variable: " + varname);
+inline TOMSOLVER_TARGET("avx2,fma") double AbsMaxAvx2(int n, const double *x) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d m = _mm256_setzero_pd();
+    __m256d nan = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        m = _mm256_max_pd(m, _mm256_andnot_pd(sign, v));
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
     }
-    return it->second;
+    if (_mm256_movemask_pd(nan)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    __m128d h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+    double ret = _mm_cvtsd_f64(_mm_max_sd(h, _mm_unpackhi_pd(h, h)));
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
 }
 
-inline std::ostream &operator<<(std::ostream &out, const VarsTable &table) noexcept {
-    out << table.ToString();
-    return out;
+inline TOMSOLVER_TARGET("avx2,fma") void ScaledAddAvx2(int n, const double *x, double alpha, const double *y,
+                                                       double *out) noexcept {
+    const __m256d a = _mm256_set1_pd(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
 }
 
-} // namespace tomsolver
+inline TOMSOLVER_TARGET("avx2,fma") bool AllAbsLessAvx2(int n, const double *x, double tol) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d t = _mm256_set1_pd(tol);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d lt = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_loadu_pd(x + i)), t, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(lt) != 0xF) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
+}
 
-namespace tomsolver {
+inline TOMSOLVER_TARGET("avx2,fma") bool AllAbsDiffLessAvx2(int n, const double *x, const double *y,
+                                                            double tol) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d t = _mm256_set1_pd(tol);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, d), t, _CMP_LT_OQ)) != 0xF) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
+}
 
-enum class NodeType { NUMBER, OPERATOR, VARIABLE };
+/**
+ * 4行×8列的寄存器分块：C(4×8) += A(4×k) * B(k×8)。C的4×8子块累加在8个ymm寄存器中。
+ */
+inline TOMSOLVER_TARGET("avx2,fma") void GemmMicroKernel4x8Avx2(int k, const double *A, int lda, const double *B,
+                                                                int ldb, double *C, int ldc) noexcept {
+    __m256d c[4][2];
+    for (int r = 0; r < 4; ++r) {
+        c[r][0] = _mm256_loadu_pd(C + r * ldc);
+        c[r][1] = _mm256_loadu_pd(C + r * ldc + 4);
+    }
+    for (int p = 0; p < k; ++p) {
+        __m256d b0 = _mm256_loadu_pd(B + p * ldb);
+        __m256d b1 = _mm256_loadu_pd(B + p * ldb + 4);
+        for (int r = 0; r < 4; ++r) {
+            __m256d a = _mm256_broadcast_sd(A + r * lda + p);
+            c[r][0] = _mm256_fmadd_pd(a, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_pd(a, b1, c[r][1]);
+        }
+    }
+    for (int r = 0; r < 4; ++r) {
+        _mm256_storeu_pd(C + r * ldc, c[r][0]);
+        _mm256_storeu_pd(C + r * ldc + 4, c[r][1]);
+    }
+}
 
-// 前置声明
-namespace internal {
-struct NodeImpl;
+/*
+ * AVX-512实现。每次处理8个double。
+ */
+
+inline TOMSOLVER_TARGET("avx512f") double DotAvx512(int n, const double *x, const double *y) noexcept {
+    __m512d s = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s);
+    }
+    // 不使用_mm512_reduce_add_pd：GCC在优化时会对其内部实现误报未初始化
+    double buf[8];
+    _mm512_storeu_pd(buf, s);
+    double ret = ((buf[0] + buf[1]) + (buf[2] + buf[3])) + ((buf[4] + buf[5]) + (buf[6] + buf[7]));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
+}
+
+inline TOMSOLVER_TARGET("avx512f") double AbsMaxAvx512(int n, const double *x) noexcept {
+    __m512d m = _mm512_setzero_pd();
+    __mmask8 nan = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d v = _mm512_loadu_pd(x + i);
+        // 同上，使用带掩码的版本
+        m = _mm512_mask_max_pd(m, 0xFF, m, _mm512_abs_pd(v));
+        nan |= _mm512_cmp_pd_mask(v, v, _CMP_UNORD_Q);
+    }
+    if (nan) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double buf[8];
+    _mm512_storeu_pd(buf, m);
+    double ret = *std::max_element(buf, buf + 8);
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
+}
+
+inline TOMSOLVER_TARGET("avx512f") void ScaledAddAvx512(int n, const double *x, double alpha, const double *y,
+                                                        double *out) noexcept {
+    const __m512d a = _mm512_set1_pd(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(out + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+inline TOMSOLVER_TARGET("avx512f") bool AllAbsLessAvx512(int n, const double *x, double tol) noexcept {
+    const __m512d t = _mm512_set1_pd(tol);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (_mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_loadu_pd(x + i)), t, _CMP_LT_OQ) != 0xFF) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
+}
+
+inline TOMSOLVER_TARGET("avx512f") bool AllAbsDiffLessAvx512(int n, const double *x, const double *y,
+                                                             double tol) noexcept {
+    const __m512d t = _mm512_set1_pd(tol);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d d = _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        if (_mm512_cmp_pd_mask(_mm512_abs_pd(d), t, _CMP_LT_OQ) != 0xFF) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
 }
-class SymMat;
 
+#if defined(_MSC_VER)
 /**
- * 表达式节点。
+ * 通过cpuid和xgetbv检测CPU和操作系统同时支持的指令集。
  */
-using Node = std::unique_ptr<internal::NodeImpl>;
+inline TOMSOLVER_TARGET("xsave") SimdLevel DetectSimdLevel() noexcept {
+    int info[4];
+    __cpuid(info, 0);
+    int maxId = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    bool avx2 = false;
+    bool avx512f = false;
+    if (maxId >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512f = (info[1] & (1 << 16)) != 0;
+    }
 
-namespace internal {
+    // 操作系统需要保存ymm/zmm寄存器的状态
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osYmm = (xcr0 & 0x6) == 0x6;
+    bool osZmm = (xcr0 & 0xE6) == 0xE6;
 
+    if (avx512f && osZmm) {
+        return SimdLevel::AVX512;
+    }
+    if (avx2 && fma && osYmm) {
+        return SimdLevel::AVX2;
+    }
+    return sse2 ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+}
+#else
 /**
- * 单个节点的实现。通常应该以std::unique_ptr包裹。
+ * 检测CPU和操作系统同时支持的指令集。
  */
-struct NodeImpl {
+inline SimdLevel DetectSimdLevel() noexcept {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+}
+#endif
 
-    NodeImpl(NodeType type, MathOperator op, double value, std::string varname) noexcept;
+#else
 
-    NodeImpl(const NodeImpl &rhs) noexcept;
-    NodeImpl &operator=(const NodeImpl &rhs) noexcept;
+inline SimdLevel DetectSimdLevel() noexcept {
+    return SimdLevel::SCALAR;
+}
 
-    NodeImpl(NodeImpl &&rhs) noexcept;
-    NodeImpl &operator=(NodeImpl &&rhs) noexcept;
+#endif
 
-    ~NodeImpl();
+/**
+ * 按指令集选出的一组内核。
+ */
+struct Kernels {
+    SimdLevel level;
+    double (*dot)(int, const double *, const double *);
+    double (*absMax)(int, const double *);
+    void (*scaledAdd)(int, const double *, double, const double *, double *);
+    bool (*allAbsLess)(int, const double *, double);
+    bool (*allAbsDiffLess)(int, const double *, const double *, double);
+    void (*gemmMicroKernel4x8)(int, const double *, int, const double *, int, double *, int);
+};
 
-    bool Equal(const Node &rhs) const noexcept;
+const Kernels SCALAR_KERNELS{SimdLevel::SCALAR,   DotScalar,           AbsMaxScalar, ScaledAddScalar, AllAbsLessScalar,
+                             AllAbsDiffLessScalar, GemmMicroKernel4x8Scalar};
 
-    /**
-     * 把整个节点以中序遍历的顺序输出为字符串。
-     * 例如：
-     *      Node n = (Var("a") + Num(1)) * Var("b");
-     *   则
-     *      n->ToString() == "(a+1.000000)*b"
-     */
-    std::string ToString() const noexcept;
+#if defined(TOMSOLVER_KERNELS_X86)
+const Kernels SSE2_KERNELS{SimdLevel::SSE2,   DotSse2,           AbsMaxSse2, ScaledAddSse2, AllAbsLessSse2,
+                           AllAbsDiffLessSse2, GemmMicroKernel4x8Scalar};
 
-    /**
-     * 计算出整个表达式的数值。不改变自身。
-     * @exception runtime_error 如果有变量存在，则无法计算
-     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
-     */
-    double Vpa() const;
+const Kernels AVX2_KERNELS{SimdLevel::AVX2,   DotAvx2,           AbsMaxAvx2, ScaledAddAvx2, AllAbsLessAvx2,
+                           AllAbsDiffLessAvx2, GemmMicroKernel4x8Avx2};
 
-    /**
-     * 计算出整个表达式的数值。不改变自身。
-     * @exception runtime_error 如果有变量存在，则无法计算
-     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
-     */
-    NodeImpl &Calc();
+const Kernels AVX512_KERNELS{SimdLevel::AVX512,   DotAvx512,           AbsMaxAvx512, ScaledAddAvx512, AllAbsLessAvx512,
+                             AllAbsDiffLessAvx512, GemmMicroKernel4x8Avx2};
+#endif
 
-    /**
-     * 返回表达式内出现的所有变量名。
-     */
-    std::set<std::string> GetAllVarNames() const noexcept;
+inline const Kernels *SelectKernels(SimdLevel level) noexcept {
+#if defined(TOMSOLVER_KERNELS_X86)
+    switch (level) {
+    case SimdLevel::AVX512:
+        return &AVX512_KERNELS;
+    case SimdLevel::AVX2:
+        return &AVX2_KERNELS;
+    case SimdLevel::SSE2:
+        return &SSE2_KERNELS;
+    case SimdLevel::SCALAR:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return &SCALAR_KERNELS;
+}
 
-    /**
-     * 检查整个节点数的parent指针是否正确。
-     */
-    void CheckParent() const noexcept;
+/**
+ * CPU和操作系统支持的最高指令集，只检测一次。
+ */
+inline SimdLevel SupportedSimdLevel() noexcept {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
 
-private:
-    std::string varname;
-    double value;
-    MathOperator op = MathOperator::MATH_NULL;
-    NodeType type = NodeType::NUMBER;
-    NodeImpl *parent = nullptr;
-    Node left, right;
-    NodeImpl() = default;
+inline std::atomic<const Kernels *> &CurrentKernels() noexcept {
+    static std::atomic<const Kernels *> current{SelectKernels(SupportedSimdLevel())};
+    return current;
+}
 
-    /**
-     * 本节点如果是OPERATOR，检查操作数数量和left, right指针是否匹配。
-     */
-    void CheckOperatorNum() const noexcept;
+inline const Kernels &GetKernels() noexcept {
+    return *CurrentKernels().load(std::memory_order_relaxed);
+}
 
-    /**
-     * 节点转string。仅限本节点，不含子节点。
-     */
-    std::string NodeToStr() const noexcept;
+/**
+ * 不足一个寄存器分块的边缘部分：C(mr×nr) += A(mr×k) * B(k×nr)。
+ */
+inline void GemmEdge(int mr, int nr, int k, const double *A, int lda, const double *B, int ldb, double *C,
+                     int ldc) noexcept {
+    for (int r = 0; r < mr; ++r) {
+        double *c = C + r * ldc;
+        for (int p = 0; p < k; ++p) {
+            double a = A[r * lda + p];
+            const double *b = B + p * ldb;
+            for (int j = 0; j < nr; ++j) {
+                c[j] += a * b[j];
+            }
+        }
+    }
+}
 
-    void ToStringRecursively(std::stringstream &output) const noexcept;
+} // namespace
 
-    void ToStringNonRecursively(std::stringstream &output) const noexcept;
+inline SimdLevel GetSimdLevel() noexcept {
+    return GetKernels().level;
+}
 
-    /**
-     * 计算表达式数值。递归实现。
-     * @exception runtime_error 如果有变量存在，则无法计算
-     * @exception MathError 不符合定义域, 除0等情况。
-     */
-    double VpaRecursively() const;
+inline SimdLevel SetSimdLevel(SimdLevel level) noexcept {
+    level = std::min(level, SupportedSimdLevel());
+    CurrentKernels().store(SelectKernels(level), std::memory_order_relaxed);
+    return level;
+}
 
-    /**
-     * 计算表达式数值。非递归实现。
-     * 性能弱于递归实现。但不会导致栈溢出。
-     * 根据benchmark，生成一组含4000个随机四则运算节点的表达式，生成1000次，Release下测试耗时3000ms。递归实现耗时2500ms。
-     * 粗略计算，即 1333 ops/ms。
-     * @exception runtime_error 如果有变量存在，则无法计算
-     * @exception MathError 不符合定义域, 除0等情况。
-     */
-    double VpaNonRecursively() const;
-
-    /**
-     * 释放整个节点树，除了自己。
-     * 实际是二叉树的非递归后序遍历。
-     */
-    void Release() noexcept;
-
-    friend Node Operator(MathOperator op, Node left, Node right) noexcept;
-
-    friend Node CloneRecursively(const Node &rhs) noexcept;
-    friend Node CloneNonRecursively(const Node &rhs) noexcept;
+inline double Dot(int n, const double *x, const double *y) noexcept {
+    return GetKernels().dot(n, x, y);
+}
 
-    friend void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept;
-    friend void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept;
+inline double AbsMax(int n, const double *x) noexcept {
+    return GetKernels().absMax(n, x);
+}
 
-    friend std::ostream &operator<<(std::ostream &out, const Node &n) noexcept;
+inline void ScaledAdd(int n, const double *x, double alpha, const double *y, double *out) noexcept {
+    GetKernels().scaledAdd(n, x, alpha, y, out);
+}
 
-    template <typename T>
-    friend Node UnaryOperator(MathOperator op, T &&n) noexcept;
+inline bool AllAbsLess(int n, const double *x, double tol) noexcept {
+    return GetKernels().allAbsLess(n, x, tol);
+}
 
-    template <typename T1, typename T2>
-    friend Node BinaryOperator(MathOperator op, T1 &&n1, T2 &&n2) noexcept;
+inline bool AllAbsDiffLess(int n, const double *x, const double *y, double tol) noexcept {
+    return GetKernels().allAbsDiffLess(n, x, y, tol);
+}
 
-    friend class tomsolver::SymMat;
-    friend class SimplifyFunctions;
-    friend class DiffFunctions;
-    friend class SubsFunctions;
-    friend class ParseFunctions;
-};
+inline void Gemm(int m, int n, int k, const double *A, const double *B, double *C) noexcept {
+    std::fill(C, C + m * n, 0.0);
 
-inline Node CloneRecursively(const Node &rhs) noexcept;
+    auto microKernel = GetKernels().gemmMicroKernel4x8;
 
-inline Node CloneNonRecursively(const Node &rhs) noexcept;
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        int nc = std::min(GEMM_NC, n - jc);
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            int kc = std::min(GEMM_KC, k - pc);
+            for (int ic = 0; ic < m; ic += GEMM_MC) {
+                int mc = std::min(GEMM_MC, m - ic);
 
-/**
- * 对于一个节点n和另一个节点n1，把n1移动到作为n的子节点。
- * 用法：CopyOrMoveTo(n->parent, n->left, std::forward<T>(n1));
- */
-inline void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept;
+                const double *a = A + ic * k + pc;
+                const double *b = B + pc * n + jc;
+                double *c = C + ic * n + jc;
 
-/**
- * 对于一个节点n和另一个节点n1，把n1整个拷贝一份，把拷贝的副本设为n的子节点。
- * 用法：CopyOrMoveTo(n->parent, n->left, std::forward<T>(n1));
- */
-inline void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept;
+                int i = 0;
+                for (; i + 4 <= mc; i += 4) {
+                    int j = 0;
+                    for (; j + 8 <= nc; j += 8) {
+                        microKernel(kc, a + i * k, k, b + j, n, c + i * n + j, n);
+                    }
+                    if (j < nc) {
+                        GemmEdge(4, nc - j, kc, a + i * k, k, b + j, n, c + i * n + j, n);
+                    }
+                }
+                if (i < mc) {
+                    GemmEdge(mc - i, nc, kc, a + i * k, k, b, n, c + i * n, n);
+                }
+            }
+        }
+    }
+}
 
-/**
- * 重载std::ostream的<<操作符以输出一个Node节点。
- */
-inline std::ostream &operator<<(std::ostream &out, const Node &n) noexcept;
+inline void SyrkTranspose(int m, int n, const double *A, double *C) noexcept {
+    std::fill(C, C + n * n, 0.0);
+
+    // 只计算上三角。C += A(r,:)ᵀ * A(r,:)，每次累加4行以减少对C的读写
+    for (int ic = 0; ic < n; ic += SYRK_NB) {
+        int ie = std::min(ic + SYRK_NB, n);
+        for (int jc = ic; jc < n; jc += SYRK_NB) {
+            int je = std::min(jc + SYRK_NB, n);
+
+            int r = 0;
+            for (; r + 4 <= m; r += 4) {
+                const double *a0 = A + r * n;
+                const double *a1 = a0 + n;
+                const double *a2 = a1 + n;
+                const double *a3 = a2 + n;
+                for (int i = ic; i < ie; ++i) {
+                    double s0 = a0[i], s1 = a1[i], s2 = a2[i], s3 = a3[i];
+                    double *c = C + i * n;
+                    for (int j = std::max(i, jc); j < je; ++j) {
+                        c[j] += s0 * a0[j] + s1 * a1[j] + s2 * a2[j] + s3 * a3[j];
+                    }
+                }
+            }
+            for (; r < m; ++r) {
+                const double *a0 = A + r * n;
+                for (int i = ic; i < ie; ++i) {
+                    double s0 = a0[i];
+                    double *c = C + i * n;
+                    for (int j = std::max(i, jc); j < je; ++j) {
+                        c[j] += s0 * a0[j];
+                    }
+                }
+            }
+        }
+    }
 
-template <typename T>
-inline Node UnaryOperator(MathOperator op, T &&n) noexcept {
-    auto ret = std::make_unique<NodeImpl>(NodeType::OPERATOR, op, 0, "");
-    CopyOrMoveTo(ret.get(), ret->left, std::forward<T>(n));
-    return ret;
+    // 复制到下三角
+    for (int i = 1; i < n; ++i) {
+        for (int j = 0; j < i; ++j) {
+            C[i * n + j] = C[j * n + i];
+        }
+    }
 }
 
-template <typename T1, typename T2>
-inline Node BinaryOperator(MathOperator op, T1 &&n1, T2 &&n2) noexcept {
-    auto ret = std::make_unique<NodeImpl>(NodeType::OPERATOR, op, 0, "");
-    CopyOrMoveTo(ret.get(), ret->left, std::forward<T1>(n1));
-    CopyOrMoveTo(ret.get(), ret->right, std::forward<T2>(n2));
-    return ret;
-}
+inline void GemvTranspose(int m, int n, const double *A, const double *x, double *y) noexcept {
+    std::fill(y, y + n, 0.0);
 
-/**
- * 新建一个运算符节点。
- */
-inline Node Operator(MathOperator op, Node left = nullptr, Node right = nullptr) noexcept;
+    // y += x[r] * A(r,:)，每次累加4行以减少对y的读写
+    int r = 0;
+    for (; r + 4 <= m; r += 4) {
+        const double *a0 = A + r * n;
+        const double *a1 = a0 + n;
+        const double *a2 = a1 + n;
+        const double *a3 = a2 + n;
+        double x0 = x[r], x1 = x[r + 1], x2 = x[r + 2], x3 = x[r + 3];
+        for (int j = 0; j < n; ++j) {
+            y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
+        }
+    }
+    for (; r < m; ++r) {
+        const double *a0 = A + r * n;
+        double x0 = x[r];
+        for (int j = 0; j < n; ++j) {
+            y[j] += x0 * a0[j];
+        }
+    }
+}
 
 } // namespace internal
 
-inline Node Clone(const Node &rhs) noexcept;
+} // namespace tomsolver
 
-/**
- * 对节点进行移动。等同于std::move。
- */
-inline Node Move(Node &rhs) noexcept;
+namespace tomsolver {
 
-/**
- * 新建一个数值节点。
- */
-inline Node Num(double num) noexcept;
+enum class ErrorType {
+    ERROR_INVALID_NUMBER,                // 出现无效的浮点数(inf, -inf, nan)
+    ERROR_ILLEGALCHAR,                   // 出现非法字符
+    ERROR_INVALID_VARNAME,               // 无效变量名
+    ERROR_WRONG_EXPRESSION,              // 表达式逻辑不正确
+    ERROR_EMPTY_INPUT,                   // 表达式为空
+    ERROR_UNDEFINED_VARIABLE,            // 未定义的变量
+    ERROR_SUBS_NOT_EQUAL,                // 替换与被替换数量不对等
+    ERROR_NOT_LINK_VARIABLETABLE,        // 未链接变量表
+    ERROR_OUTOF_DOMAIN,                  // 计算超出定义域
+    ERROR_VAR_COUNT_NOT_EQUAL_NUM_COUNT, // 定义变量时变量数量与初始值不等
+    ERROR_VAR_HAS_BEEN_DEFINED,          // 变量重定义
+    ERROR_INDETERMINATE_EQUATION,        // 不定方程
+    ERROR_SINGULAR_MATRIX,               // 矩阵奇异
+    ERROR_INFINITY_SOLUTIONS,            // 无穷多解
+    ERROR_OVER_DETERMINED_EQUATIONS,     // 方程组过定义
+    SIZE_NOT_MATCH,                      // 维数不匹配
+    ERROR_DIVERGENCE,                    // 迭代发散
+    ERROR_STAGNATION,                    // 迭代停滞
+    ERROR_CANCELLED,                     // 求解被取消
+    ERROR_ITERATION_LIMIT                // 迭代次数超出限制
+};
 
-/**
- * 新建一个函数节点。
- */
-inline Node Op(MathOperator op);
+inline std::string GetErrorInfo(ErrorType err);
 
-/**
- * 返回变量名是否有效。（只支持英文数字或者下划线，第一个字符必须是英文或者下划线）
- */
-inline bool VarNameIsLegal(const std::string &varname) noexcept;
+class MathError : public std::runtime_error {
+public:
+    MathError(ErrorType errorType, const std::string &extInfo = {});
 
-/**
- * 新建一个变量节点。
- * @exception runtime_error 名字不合法
- */
-inline Node Var(std::string varname);
+    virtual const char *what() const noexcept override;
 
-template <typename...>
-struct SfinaeNodeImpl : std::false_type {};
+    ErrorType GetErrorType() const noexcept;
 
-template <>
-struct SfinaeNodeImpl<Node> : std::true_type {};
+private:
+    ErrorType errorType;
+    std::string errInfo;
+};
 
-template <>
-struct SfinaeNodeImpl<Node, Node> : std::true_type {};
+} // namespace tomsolver
 
-template <typename... T>
-using SfinaeNode = std::enable_if_t<SfinaeNodeImpl<std::decay_t<T>...>::value, Node>;
+namespace tomsolver {
 
-template <typename T1, typename T2>
-inline SfinaeNode<T1, T2> operator+(T1 &&n1, T2 &&n2) noexcept {
-    return internal::BinaryOperator(MathOperator::MATH_ADD, std::forward<T1>(n1), std::forward<T2>(n2));
+inline std::string GetErrorInfo(ErrorType err) {
+    switch (err) {
+    case ErrorType::ERROR_INVALID_NUMBER:
+        return u8"invalid number";
+        break;
+    case ErrorType::ERROR_ILLEGALCHAR:
+        return u8"illegal character";
+        break;
+    case ErrorType::ERROR_INVALID_VARNAME:
+        return u8"invalid variable name (must start with an underscore \"_\" or a letter)";
+        break;
+    case ErrorType::ERROR_WRONG_EXPRESSION:
+        return u8"invalid expression";
+        break;
+    case ErrorType::ERROR_EMPTY_INPUT:
+        return u8"empty input";
+        break;
+    case ErrorType::ERROR_UNDEFINED_VARIABLE:
+        return u8"undefined variable";
+        break;
+    case ErrorType::ERROR_SUBS_NOT_EQUAL:
+        return u8"number of substitutions does not match the number of items to be replaced";
+        break;
+    case ErrorType::ERROR_NOT_LINK_VARIABLETABLE:
+        return u8"not linked variable table";
+        break;
+    case ErrorType::ERROR_OUTOF_DOMAIN:
+        return u8"out of domain";
+        break;
+    case ErrorType::ERROR_VAR_COUNT_NOT_EQUAL_NUM_COUNT:
+        return u8"the number of variable is not equal with number count";
+        break;
+    case ErrorType::ERROR_VAR_HAS_BEEN_DEFINED:
+        return u8"variable redefined";
+        break;
+    case ErrorType::ERROR_INDETERMINATE_EQUATION:
+        return u8"indeterminate equation";
+        break;
+    case ErrorType::ERROR_SINGULAR_MATRIX:
+        return u8"singular matrix";
+        break;
+    case ErrorType::ERROR_INFINITY_SOLUTIONS:
+        return u8"infinite solutions";
+        break;
+    case ErrorType::ERROR_OVER_DETERMINED_EQUATIONS:
+        return u8"overdetermined equations";
+        break;
+    case ErrorType::SIZE_NOT_MATCH:
+        return u8"size does not match";
+        break;
+    case ErrorType::ERROR_DIVERGENCE:
+        return u8"iteration diverged";
+        break;
+    case ErrorType::ERROR_STAGNATION:
+        return u8"iteration stagnated";
+        break;
+    case ErrorType::ERROR_CANCELLED:
+        return u8"cancelled";
+        break;
+    case ErrorType::ERROR_ITERATION_LIMIT:
+        return u8"iteration limit exceeded";
+    default:
+        assert(0);
+        break;
+    }
+    return u8"GetErrorInfo: bug";
 }
 
-template <typename T>
-inline SfinaeNode<T> &operator+=(Node &n1, T &&n2) noexcept {
-    n1 = internal::BinaryOperator(MathOperator::MATH_ADD, std::move(n1), std::forward<T>(n2));
-    return n1;
+inline MathError::MathError(ErrorType errorType, const std::string &extInfo)
+    : std::runtime_error(extInfo), errorType(errorType) {
+    errInfo = GetErrorInfo(errorType);
+    if (!extInfo.empty()) {
+        errInfo += ": \"" + extInfo + "\"";
+    }
 }
 
-template <typename T1, typename T2>
-inline SfinaeNode<T1, T2> operator-(T1 &&n1, T2 &&n2) noexcept {
-    return internal::BinaryOperator(MathOperator::MATH_SUB, std::forward<T1>(n1), std::forward<T2>(n2));
+inline const char *MathError::what() const noexcept {
+    return errInfo.c_str();
 }
 
-template <typename T>
-inline SfinaeNode<T> operator-(T &&n1) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_NEGATIVE, std::forward<T>(n1));
+inline ErrorType MathError::GetErrorType() const noexcept {
+    return errorType;
 }
 
-template <typename T>
-inline SfinaeNode<T> operator+(T &&n1) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_POSITIVE, std::forward<T>(n1));
-}
+} // namespace tomsolver
 
-template <typename T>
-inline SfinaeNode<T> &operator-=(Node &n1, T &&n2) noexcept {
-    n1 = internal::BinaryOperator(MathOperator::MATH_SUB, std::move(n1), std::forward<T>(n2));
-    return n1;
-}
+namespace tomsolver {
 
-template <typename T1, typename T2>
-inline SfinaeNode<T1, T2> operator*(T1 &&n1, T2 &&n2) noexcept {
-    return internal::BinaryOperator(MathOperator::MATH_MULTIPLY, std::forward<T1>(n1), std::forward<T2>(n2));
-}
+enum class LogLevel { OFF, FATAL, ERROR, WARN, INFO, DEBUG, TRACE, ALL };
 
-template <typename T>
-inline SfinaeNode<T> &operator*=(Node &n1, T &&n2) noexcept {
-    n1 = internal::BinaryOperator(MathOperator::MATH_MULTIPLY, std::move(n1), std::forward<T>(n2));
-    return n1;
-}
+enum class NonlinearMethod { NEWTON_RAPHSON, LM, DOGLEG, NEWTON_KRYLOV, AUTO };
 
-template <typename T1, typename T2>
-inline SfinaeNode<T1, T2> operator/(T1 &&n1, T2 &&n2) noexcept {
-    return internal::BinaryOperator(MathOperator::MATH_DIVIDE, std::forward<T1>(n1), std::forward<T2>(n2));
-}
+enum class LineSearchMethod { NONE, ARMIJO, CUBIC };
 
-template <typename T>
-inline SfinaeNode<T> &operator/=(Node &n1, T &&n2) noexcept {
-    n1 = internal::BinaryOperator(MathOperator::MATH_DIVIDE, std::move(n1), std::forward<T>(n2));
-    return n1;
-}
+enum class KrylovMethod { GMRES, BICGSTAB };
 
-template <typename T1, typename T2>
-inline SfinaeNode<T1, T2> operator^(T1 &&n1, T2 &&n2) noexcept {
-    return internal::BinaryOperator(MathOperator::MATH_POWER, std::forward<T1>(n1), std::forward<T2>(n2));
-}
+struct Config {
+    /**
+     * 指定出现浮点数无效值(inf, -inf, nan)时，是否抛出异常。默认为true。
+     */
+    bool throwOnInvalidValue = true;
 
-template <typename T>
-inline SfinaeNode<T> &operator^=(Node &n1, T &&n2) noexcept {
-    n1 = internal::BinaryOperator(MathOperator::MATH_POWER, std::move(n1), std::forward<T>(n2));
-    return n1;
-}
+    /**
+     * 判断浮点数相等、矩阵奇异的阈值，也是非线性方程组的绝对残差容差：||F||∞ < epsilon时视为收敛。
+     */
+    double epsilon = 1.0e-9;
 
-} // namespace tomsolver
+    LogLevel logLevel = LogLevel::WARN;
 
-namespace tomsolver {
+    /**
+     * 最大迭代次数限制
+     */
+    int maxIterations = 100;
 
-namespace internal {
+    /**
+     * 非线性方程组的相对残差容差：||F||∞ ≤ relativeTolerance·||F0||∞时视为收敛，F0为初值处的残差。
+     * 绝对残差容差即为epsilon。为0时只使用绝对残差容差。
+     */
+    double relativeTolerance = 0;
 
-inline NodeImpl::NodeImpl(NodeType type, MathOperator op, double value, std::string varname) noexcept
-    : varname(varname), value(value), op(op), type(type), parent(nullptr) {
-    switch (type) {
-    case NodeType::NUMBER:
-        assert(op == MathOperator::MATH_NULL && varname == "");
-        break;
-    case NodeType::OPERATOR:
-        assert(op != MathOperator::MATH_NULL && varname == "");
-        break;
-    case NodeType::VARIABLE:
-        assert(op == MathOperator::MATH_NULL);
-        break;
-    default:
-        assert(0);
-    }
-}
+    /**
+     * 非线性方程组的步长容差：||Δq|| ≤ stepTolerance·(||q|| + stepTolerance)时视为收敛。为0时不按步长判断收敛。
+     */
+    double stepTolerance = 0;
 
-inline NodeImpl::NodeImpl(const NodeImpl &rhs) noexcept {
-    *this = rhs;
-}
+    /**
+     * 发散检测：||F||∞超过初值处的divergenceRatio倍时，抛出ERROR_DIVERGENCE。为0时不检测。
+     */
+    double divergenceRatio = 0;
 
-inline NodeImpl &NodeImpl::operator=(const NodeImpl &rhs) noexcept {
-    type = rhs.type;
-    op = rhs.op;
-    value = rhs.value;
-    varname = rhs.varname;
-    parent = rhs.parent;
-    if (rhs.left) {
-        left = Clone(rhs.left);
-        left->parent = this;
-    } else {
-        left = nullptr;
-    }
-    if (rhs.right) {
-        right = Clone(rhs.right);
-        right->parent = this;
-    } else {
-        right = nullptr;
-    }
-    return *this;
-}
+    /**
+     * 停滞检测：连续stagnationIterations次迭代||F||∞都没有明显下降时，抛出ERROR_STAGNATION。为0时不检测。
+     * 信赖域/LM方法中被拒绝的试探步也计入迭代次数。
+     */
+    int stagnationIterations = 0;
 
-inline NodeImpl::NodeImpl(NodeImpl &&rhs) noexcept {
-    *this = std::move(rhs);
-}
+    /**
+     * 求解方法
+     */
+    NonlinearMethod nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
 
-inline NodeImpl &NodeImpl::operator=(NodeImpl &&rhs) noexcept {
-    type = std::exchange(rhs.type, {});
-    op = std::exchange(rhs.op, {});
-    value = std::exchange(rhs.value, {});
-    varname = std::exchange(rhs.varname, {});
-    parent = std::exchange(rhs.parent, {});
-    left = std::exchange(rhs.left, {});
-    if (left) {
-        left->parent = this;
-    }
-    right = std::exchange(rhs.right, {});
-    if (right) {
-        right->parent = this;
-    }
+    /**
+     * Newton-Raphson方法是否复用雅可比矩阵的LU分解结果（弦方法/简化牛顿法）。
+     * 开启后只有当||phi||的收缩率（本次/上次）大于jacobianRefreshRatio时，才重新计算并分解雅可比矩阵。
+     * 仅对方阵（方程数量等于未知数数量）生效。
+     */
+    bool reuseJacobian = false;
 
-    return *this;
-}
+    /**
+     * 复用雅可比矩阵时，触发重新计算雅可比矩阵的||phi||收缩率阈值，取值范围(0, 1)。
+     */
+    double jacobianRefreshRatio = 0.5;
 
-inline NodeImpl::~NodeImpl() {
-    Release();
-}
+    /**
+     * Newton-Raphson方法是否使用混合精度求解牛顿步：以单精度分解雅可比矩阵，再以双精度残差迭代修正，
+     * 得到与双精度分解相同精度的牛顿步。迭代修正停滞或单精度分解失败时，自动退回双精度分解。仅对方阵生效。
+     */
+    bool mixedPrecision = false;
 
-// 前序遍历。非递归实现。
-inline bool NodeImpl::Equal(const Node &other) const noexcept {
-    if (this == other.get()) {
-        return true;
-    }
+    /**
+     * 非线性方程组求解时，是否对雅可比矩阵做行列平衡（见Equilibration），即按数量级缩放方程与未知量。
+     * 用于量纲、数量级差异很大的方程组，避免主元的绝对阈值造成误判奇异。缩放因子由初值处的雅可比矩阵确定。
+     * 仅对方阵生效：方程数量不等于未知数数量时，缩放会改变最小二乘解或最小范数解。
+     * SolveByNewtonKrylov不构造雅可比矩阵，不做行列平衡，可以通过预条件子达到同样的效果。
+     * 缩放会改变迭代过程中的舍入误差与主元选择，默认关闭，保持原有方程组的迭代结果不变。
+     */
+    bool equilibrate = false;
 
-    std::stack<std::tuple<const NodeImpl &, const NodeImpl &>> stk;
+    /**
+     * 行列平衡开启时，是否在每次重新计算雅可比矩阵时更新缩放因子。关闭时始终使用初值处的缩放因子。
+     */
+    bool updateEquilibration = false;
 
-    auto tie = [](const NodeImpl &node) {
-        return std::tie(node.type, node.op, node.value, node.varname);
-    };
+    /**
+     * 混合精度求解时，每次求解允许的最大修正次数。超过后退回双精度分解。
+     */
+    int maxRefinementIterations = 10;
 
-    auto IsSame = [&tie](const NodeImpl &lhs, const NodeImpl &rhs) {
-        return tie(lhs) == tie(rhs);
-    };
+    /**
+     * Newton-Raphson方法和Newton-Krylov方法沿牛顿方向的一维搜索方法。默认为NONE，即每次都走完整的牛顿步。
+     * 完整的牛顿步使||phi||增大或者超出定义域时，可以选择ARMIJO（回溯减半）或CUBIC（插值回溯）。
+     */
+    LineSearchMethod lineSearch = LineSearchMethod::NONE;
 
-    auto CheckChildren = [&stk](const Node &lhs, const Node &rhs) {
-        // ╔═════╦═════╦════════╦═════════╗
-        // ║ lhs ║ rhs ║ return ║ emplace ║
-        // ╠═════╬═════╬════════╬═════════╣
-        // ║ T   ║ T   ║ T      ║ T       ║
-        // ╟─────╫─────╫────────╫─────────╢
-        // ║ T   ║ F   ║ F      ║ F       ║
-        // ╟─────╫─────╫────────╫─────────╢
-        // ║ F   ║ T   ║ F      ║ F       ║
-        // ╟─────╫─────╫────────╫─────────╢
-        // ║ F   ║ F   ║ T      ║ F       ║
-        // ╚═════╩═════╩════════╩═════════╝
-        if (!lhs ^ !rhs) {
-            return false;
-        }
+    /**
+     * Newton-Krylov方法求解每个牛顿步所用的Krylov子空间方法。BICGSTAB的内存为O(n)，与krylovRestart无关。
+     */
+    KrylovMethod krylovMethod = KrylovMethod::GMRES;
 
-        if (lhs && rhs) {
-            stk.emplace(*lhs, *rhs);
-        }
+    /**
+     * Newton-Krylov方法中GMRES的重启长度，即重启前保存的Krylov子空间基向量数量。内存占用约为未知数数量的这么多倍。
+     */
+    int krylovRestart = 30;
 
-        return true;
-    };
+    /**
+     * Newton-Krylov方法求解每个牛顿步J·Δq = -F的相对精度，即要求||J·Δq + F|| <= krylovTolerance * ||F||。
+     * eisenstatWalker为true时，Newton-Krylov方法不使用这个值。LM方法使用共轭梯度法时也使用这个精度。
+     */
+    double krylovTolerance = 1.0e-6;
 
-    auto CheckNode = [&IsSame, &CheckChildren](const NodeImpl &lhs, const NodeImpl &rhs) {
-        return IsSame(lhs, rhs) && CheckChildren(lhs.left, rhs.left) && CheckChildren(lhs.right, rhs.right);
-    };
+    /**
+     * Newton-Krylov方法是否按Eisenstat-Walker方法选取每个牛顿步的相对精度（forcing term）：
+     * 离解较远时只粗略求解，||F||下降越快要求越高，避免前几次迭代过度求解线性方程组。
+     */
+    bool eisenstatWalker = true;
 
-    if (!CheckNode(*this, *other)) {
-        return false;
-    }
+    /**
+     * Newton-Krylov方法中，每个牛顿步最多的GMRES迭代次数。
+     */
+    int maxKrylovIterations = 1000;
 
-    while (!stk.empty()) {
-        const auto &lhs = std::get<0>(stk.top());
-        const auto &rhs = std::get<1>(stk.top());
-        stk.pop();
+    /**
+     * LM方法是否用Jacobi预条件共轭梯度法求解阻尼方程(JᵀJ + μD²)h = -JᵀF。
+     * 开启后不构造和分解JᵀJ，每次迭代只需要J和Jᵀ各乘一次向量，适合未知数很多的情况。
+     */
+    bool lmConjugateGradient = false;
 
-        // 检查
-        if (!CheckNode(lhs, rhs)) {
-            return false;
-        }
-    }
+    /**
+     * SolveFixedPoint使用的Anderson加速深度，即最多保留的历史残差数量。为0时退化为普通的不动点迭代x = G(x)。
+     */
+    int andersonDepth = 5;
 
-    return true;
-}
+    /**
+     * 非线性方程求解时，当没有为VarsTable传初值时，设定的初值
+     */
+    double initialValue = 1.0;
 
-inline std::string NodeImpl::ToString() const noexcept {
-    std::stringstream ss;
-    ToStringNonRecursively(ss);
-    return ss.str();
-}
+    /**
+     * 是否允许不定方程存在。
+     * 例如，当等式数量大于未知数数量时，方程组成为不定方程；
+     * 如果允许，此时将返回一组特解；如果不允许，将抛出异常。
+     */
+    bool allowIndeterminateEquation = false;
 
-inline double NodeImpl::Vpa() const {
-    return VpaNonRecursively();
-}
+    void Reset() noexcept;
 
-inline NodeImpl &NodeImpl::Calc() {
-    auto d = Vpa();
-    *this = {};
-    value = d;
+    /**
+     * 当前线程使用的配置：在ConfigScope的作用域内为该作用域的选项，否则为进程全局的默认配置。
+     * 全局配置只应在没有其他线程求解时修改。需要在多个线程中同时使用不同的配置时，把SolverOptions传给各个函数。
+     */
+    static Config &Get();
 
-    return *this;
-}
+private:
+    static Config *&Current() noexcept;
 
-// 前序遍历。非递归实现。
-inline void NodeImpl::CheckParent() const noexcept {
-    std::stack<std::reference_wrapper<const NodeImpl>> stk;
+    friend class ConfigScope;
+};
 
-    auto EmplaceNode = [&stk](const Node &node) {
-        if (node) {
-            stk.emplace(*node);
-        }
-    };
-    auto TryEmplaceChildren = [&EmplaceNode](const NodeImpl &node) {
-        node.CheckOperatorNum();
-        EmplaceNode(node.left);
-        EmplaceNode(node.right);
-    };
+/**
+ * 单次调用的求解选项，字段与Config相同。传给Solve、SolveLinear、Vpa等函数后只在这次调用中生效，
+ * 既不读取也不修改全局配置，因此多个线程可以同时使用各自的选项。
+ */
+using SolverOptions = Config;
 
-    TryEmplaceChildren(*this);
+/**
+ * 在作用域内让当前线程的Config::Get()返回options的副本，析构时恢复。其他线程不受影响，可以嵌套。
+ */
+class ConfigScope {
+public:
+    explicit ConfigScope(const Config &options) noexcept;
 
-    while (!stk.empty()) {
-        const auto &f = stk.top().get();
-        stk.pop();
+    ~ConfigScope();
 
-#ifndef NDEBUG
-        // 检查
-        assert(f.parent);
-        bool isLeftChild = f.parent->left.get() == &f;
-        bool isRightChild = f.parent->right.get() == &f;
-        assert(isLeftChild || isRightChild);
-#endif
+    ConfigScope(const ConfigScope &) = delete;
 
-        TryEmplaceChildren(f);
-    }
-}
+    ConfigScope &operator=(const ConfigScope &) = delete;
 
-inline void NodeImpl::CheckOperatorNum() const noexcept {
-    if (type != NodeType::OPERATOR) {
-        return;
-    }
+private:
+    Config config;
+    Config *previous;
+};
 
-    switch (GetOperatorNum(op)) {
-    case 1:
-        assert(!right);
-        break;
-    case 2:
-        assert(right);
-        break;
-    default:
-        assert(0);
-        break;
-    }
+inline std::string ToString(double value) noexcept;
 
-    assert(left);
-}
-
-inline std::string NodeImpl::NodeToStr() const noexcept {
-    switch (type) {
-    case NodeType::NUMBER:
-        return tomsolver::ToString(value);
-    case NodeType::VARIABLE:
-        return varname;
-    case NodeType::OPERATOR:
-        return MathOperatorToStr(op);
-    }
-    assert(0 && "unexpected NodeType. maybe this is a bug.");
-    return "";
-}
+} // namespace tomsolver
 
-// 中序遍历。递归实现。
-inline void NodeImpl::ToStringRecursively(std::stringstream &output) const noexcept {
-    switch (type) {
-    case NodeType::NUMBER:
-        // 如果当前节点是数值且小于0，且前面是-运算符，那么加括号
-        if (value < 0 && parent && parent->right.get() == this && parent->op == MathOperator::MATH_SUB) {
-            output << "(" << NodeToStr() << ")";
-        } else {
-            output << NodeToStr();
-        }
-        return;
-    case NodeType::VARIABLE:
-        output << NodeToStr();
-        return;
-    case NodeType::OPERATOR:
-        // pass
-        break;
-    }
+namespace tomsolver {
 
-    auto hasParenthesis = false;
-    auto operatorNum = GetOperatorNum(op);
-    if (operatorNum == 1) // 一元运算符：函数和取负
-    {
-        if (op == MathOperator::MATH_POSITIVE || op == MathOperator::MATH_NEGATIVE) {
-            output << "(" << NodeToStr();
-        } else {
-            output << NodeToStr() << "(";
-        }
-        hasParenthesis = true;
-    } else {
-        // 非一元运算符才输出，即一元运算符的输出顺序已改变
-        if (type == NodeType::OPERATOR && parent) { // 本级为运算符
-            if ((GetOperatorNum(parent->op) == 2 && // 父运算符存在，为二元，
-                 (Rank(parent->op) > Rank(op)       // 父级优先级高于本级->加括号
+namespace {
 
-                  || ( // 两级优先级相等
-                         Rank(parent->op) == Rank(op) &&
-                         (
-                             // 本级为父级的右子树 且父级不满足结合律->加括号
-                             (InAssociativeLaws(parent->op) == false && this == parent->right.get()) ||
-                             // 两级都是右结合
-                             (InAssociativeLaws(parent->op) == false && IsLeft2Right(op) == false)))))
+static const std::tuple<const char *, std::regex> strategies[] = {
+    {"%.16e", std::regex{"\\.?0+(?=e)"}},
+    {"%.16f", std::regex{"\\.?0+(?=$)"}},
+};
 
-                //||
+}
 
-                ////父运算符存在，为除号，且本级为分子，则添加括号
-                //(now->parent->eOperator == MATH_DIVIDE && now == now->parent->right)
-            ) {
-                output << "(";
-                hasParenthesis = true;
-            }
-        }
+inline std::string ToString(double value) noexcept {
+    if (value == 0.0) {
+        return "0";
     }
 
-    if (left) // 左遍历
-    {
-        left->ToStringRecursively(output);
-    }
+    char buf[64];
 
-    if (operatorNum != 1) // 非一元运算符才输出，即一元运算符的输出顺序已改变
-    {
-        output << NodeToStr();
-    }
+    // 绝对值过大 或者 绝对值过小，应该使用科学计数法来表示
+    auto getStrategyIdx = [absValue = std::abs(value)] {
+        return (absValue >= 1.0e16 || absValue <= 1.0e-16) ? 0 : 1;
+    };
 
-    if (right) // 右遍历
-    {
-        right->ToStringRecursively(output);
-    }
+    auto &strategy = strategies[getStrategyIdx()];
+    auto fmt = std::get<0>(strategy);
+    auto &re = std::get<1>(strategy);
 
-    // 回到本级时补齐右括号，包住前面的东西
-    if (hasParenthesis) {
-        output << ")";
-    }
+    snprintf(buf, sizeof(buf), fmt, value);
+    return std::regex_replace(buf, re, "");
 }
 
-// 中序遍历。非递归实现。
-inline void NodeImpl::ToStringNonRecursively(std::stringstream &output) const noexcept {
-    std::stack<std::reference_wrapper<const NodeImpl>> stk;
-
-    NodeImpl rightParenthesis(NodeType::OPERATOR, MathOperator::MATH_RIGHT_PARENTHESIS, 0, "");
-
-    auto AddLeftLine = [&stk, &output, &rightParenthesis](const NodeImpl *cur) {
-        while (cur) {
-            if (cur->type != NodeType::OPERATOR) {
-                stk.emplace(*cur);
-                cur = cur->left.get();
-                continue;
-            }
+inline void Config::Reset() noexcept {
+    *this = {};
+}
 
-            // 一元运算符的特殊处理：
-            //      例如sin: 直接输出 "sin(" ，并且把一个右括号入栈。让退栈时这个右括号能包裹住现在的子树。
-            //      如果是+/-: 直接输出 "+"/"-"，如果+/-的操作数是operator，那么处理方式和sin这类一样；
-            //                                  如果+/-的操作数是number/variable，那么不加括号。
-            if (GetOperatorNum(cur->op) == 1) {
-                if ((cur->op == MathOperator::MATH_POSITIVE || cur->op == MathOperator::MATH_NEGATIVE) &&
-                    (cur->left->type != NodeType::OPERATOR)) {
-                    output << cur->NodeToStr();
-                    cur = cur->left.get();
-                    continue;
-                }
-                output << cur->NodeToStr() << "(";
+inline Config &Config::Get() {
+    static Config config;
+    Config *current = Current();
+    return current ? *current : config;
+}
 
-                // not push this op
+inline Config *&Config::Current() noexcept {
+    thread_local Config *current = nullptr;
+    return current;
+}
 
-                // push ')'
-                stk.emplace(rightParenthesis);
+inline ConfigScope::ConfigScope(const Config &options) noexcept : config(options), previous(Config::Current()) {
+    Config::Current() = &config;
+}
 
-                cur = cur->left.get();
-                continue;
-            }
+inline ConfigScope::~ConfigScope() {
+    Config::Current() = previous;
+}
 
-            // 二元运算符的特殊处理：
-            if (cur->parent) {
-                if ((GetOperatorNum(cur->parent->op) == 2 && // 父运算符存在，为二元，
-                     (Rank(cur->parent->op) > Rank(cur->op)  // 父级优先级高于本级->加括号
+} // namespace tomsolver
 
-                      || ( // 两级优先级相等
-                             Rank(cur->parent->op) == Rank(cur->op) &&
-                             (
-                                 // 本级为父级的右子树 且父级不满足结合律->加括号
-                                 (InAssociativeLaws(cur->parent->op) == false && cur == cur->parent->right.get()) ||
-                                 // 两级都是右结合
-                                 (InAssociativeLaws(cur->parent->op) == false && IsLeft2Right(cur->op) == false)))))
+namespace tomsolver {
 
-                    //||
+namespace internal {
 
-                    ////父运算符存在，为除号，且本级为分子，则添加括号
-                    //(now->parent->eOperator == MATH_DIVIDE && now == now->parent->right)
-                ) {
-                    output << "(";
+inline int ParallelWorkers(int count, int threads) noexcept {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return std::max(1, std::min(threads, count));
+}
 
-                    // push ')'
-                    stk.emplace(rightParenthesis);
+inline void ParallelFor(int count, int threads, const std::function<void(int, int)> &body) {
+    const Config &config = Config::Get();
+    std::atomic<int> next{0};
+    std::atomic<bool> stopped{false};
+    std::mutex mtx;
+    std::exception_ptr error;
 
-                    stk.emplace(*cur);
-                    cur = cur->left.get();
-                    continue;
+    auto worker = [&](int id) {
+        ConfigScope scope(config); // 工作线程使用调用者所在线程的配置
+        while (!stopped.load()) {
+            int k = next++;
+            if (k >= count) {
+                return;
+            }
+            try {
+                body(id, k);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
                 }
+                stopped = true;
             }
-
-            stk.emplace(*cur);
-            cur = cur->left.get();
         }
     };
 
-    AddLeftLine(this);
-
-    while (!stk.empty()) {
-        const auto &cur = stk.top().get();
-        stk.pop();
-
-        // output
-
-        // 负数的特殊处理
-        // 如果当前节点是数值且小于0，且前面是-运算符，那么加括号
-        if (cur.type == NodeType::NUMBER && cur.value < 0 && cur.parent && cur.parent->right.get() == &cur &&
-            cur.parent->op == MathOperator::MATH_SUB) {
-            output << "(" << cur.NodeToStr() << ")";
-        } else {
-            output << cur.NodeToStr();
-        }
+    // 调用者所在的线程也参与执行
+    int workers = ParallelWorkers(count, threads);
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; ++i) {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto &t : pool) {
+        t.join();
+    }
 
-        if (cur.right) {
-            AddLeftLine(cur.right.get());
-            continue;
-        }
+    if (error) {
+        std::rethrow_exception(error);
     }
 }
 
-// 后序遍历。递归实现。
-inline double NodeImpl::VpaRecursively() const {
+} // namespace internal
 
-    auto vpa = [](const Node &node) {
-        return node ? node->Vpa() : 0;
-    };
+} // namespace tomsolver
 
-    switch (type) {
-    case NodeType::NUMBER:
-        return value;
+namespace tomsolver {
 
-    case NodeType::VARIABLE:
-        throw std::runtime_error("has variable. can not calculate to be a number");
+constexpr double PI = M_PI;
 
-    case NodeType::OPERATOR:
-        assert((GetOperatorNum(op) == 1 && left && right == nullptr) || (GetOperatorNum(op) == 2 && left && right));
-        return tomsolver::Calc(op, vpa(left), vpa(right));
-    }
+template <typename T>
+inline T radians(T &&t) noexcept {
+    return std::forward<T>(t) / 180.0 * PI;
+}
 
-    throw std::runtime_error("unsupported node type");
+template <typename T>
+inline T degrees(T &&t) noexcept {
+    return std::forward<T>(t) * 180.0 / PI;
 }
 
-// 后序遍历。非递归实现。
-inline double NodeImpl::VpaNonRecursively() const {
+enum class MathOperator {
+    MATH_NULL,
+    // 一元
+    MATH_POSITIVE,
+    MATH_NEGATIVE,
 
-    std::stack<std::reference_wrapper<const NodeImpl>> stk;
-    std::forward_list<std::reference_wrapper<const NodeImpl>> revertedPostOrder;
+    // 函数
+    MATH_SIN,
+    MATH_COS,
+    MATH_TAN,
+    MATH_ARCSIN,
+    MATH_ARCCOS,
+    MATH_ARCTAN,
+    MATH_SQRT,
+    MATH_LOG,
+    MATH_LOG2,
+    MATH_LOG10,
+    MATH_EXP,
 
-    // ==== Part I ====
+    // 二元
+    MATH_ADD,
+    MATH_SUB,
+    MATH_MULTIPLY,
+    MATH_DIVIDE,
+    MATH_POWER,
+    MATH_AND,
+    MATH_OR,
+    MATH_MOD,
 
-    // 借助一个栈，得到反向的后序遍历序列，结果保存在revertedPostOrder
-    stk.emplace(*this);
+    MATH_LEFT_PARENTHESIS,
+    MATH_RIGHT_PARENTHESIS
+};
 
-    while (!stk.empty()) {
-        const auto &node = stk.top().get();
-        stk.pop();
-
-        if (node.left) {
-            stk.emplace(*node.left);
-        }
-
-        if (node.right) {
-            stk.emplace(*node.right);
-        }
-
-        revertedPostOrder.emplace_front(node);
-    }
-
-    // ==== Part II ====
-    // revertedPostOrder的反向序列是一组逆波兰表达式，根据这组逆波兰表达式可以计算出表达式的值
-    // calcStk是用来计算值的临时栈，计算完成后calcStk的size应该为1
-    std::stack<double> calcStk;
-    // for (auto it = revertedPostOrder.rbegin(); it != revertedPostOrder.rend(); ++it) {
-    for (const auto &nodeWrapper : revertedPostOrder) {
-        const auto &node = nodeWrapper.get();
-        switch (node.type) {
-        case NodeType::NUMBER:
-            calcStk.emplace(node.value);
-            break;
+/**
+ * 操作符转std::string
+ */
+inline std::string MathOperatorToStr(MathOperator op);
 
-        case NodeType::OPERATOR: {
-            auto r = std::numeric_limits<double>::quiet_NaN();
+/**
+ * 取得操作数的数量。
+ */
+inline int GetOperatorNum(MathOperator op) noexcept;
 
-            switch (GetOperatorNum(node.op)) {
-            case 1:
-                break;
-            case 2:
-                r = calcStk.top();
-                calcStk.pop();
-                break;
-            default:
-                assert(0 && "[VpaNonRecursively] unsupported operator num");
-                break;
-            }
+/**
+* 返回运算符的优先级
 
-            auto &l = calcStk.top();
-            l = tomsolver::Calc(node.op, l, r);
-            break;
-        }
-        case NodeType::VARIABLE:
-        default:
-            throw std::runtime_error("wrong");
-            break;
-        }
-    }
+*/
+inline int Rank(MathOperator op) noexcept;
 
-    assert(calcStk.size() == 1);
+/**
+ * 返回运算符结合性
+ */
+inline bool IsLeft2Right(MathOperator eOperator) noexcept;
 
-    return calcStk.top();
-}
+/**
+ * 返回是否满足交换律
+ */
+inline bool InAssociativeLaws(MathOperator eOperator) noexcept;
 
-// 后序遍历。因为要在左右儿子都没有的情况下删除节点。
-inline void NodeImpl::Release() noexcept {
-    std::stack<Node> stk;
+/**
+ * 返回是否是函数
+ */
+inline bool IsFunction(MathOperator op) noexcept;
 
-    auto emplaceNode = [&stk](Node node) {
-        if (node) {
-            stk.emplace(std::move(node));
-        }
-    };
+/**
+ * 是整数 且 为偶数
+ * FIXME: 超出long long范围的处理
+ */
+inline bool IsIntAndEven(double n) noexcept;
 
-    auto emplaceChildren = [&emplaceNode](NodeImpl &node) {
-        emplaceNode(std::move(node.left));
-        emplaceNode(std::move(node.right));
-    };
+namespace internal {
 
-    emplaceChildren(*this);
+/**
+ * 抛出ERROR_INVALID_NUMBER异常，异常信息中包含出错的运算式。
+ * @exception MathError 总是抛出
+ */
+inline void ThrowInvalidNumber(MathOperator op, double v1, double v2);
 
-    while (!stk.empty()) {
-        auto node = std::move(stk.top());
-        stk.pop();
+} // namespace internal
 
-        emplaceChildren(*node);
+/**
+ * 以标量类型T（float、double、long double）计算运算符op。一元运算符忽略v2。
+ * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+ */
+template <typename T>
+inline T Calc(MathOperator op, T v1, T v2) {
+    T ret = std::numeric_limits<T>::quiet_NaN();
+    switch (op) {
+    case MathOperator::MATH_SIN:
+        ret = std::sin(v1);
+        break;
+    case MathOperator::MATH_COS:
+        ret = std::cos(v1);
+        break;
+    case MathOperator::MATH_TAN:
+        ret = std::tan(v1);
+        break;
+    case MathOperator::MATH_ARCSIN:
+        ret = std::asin(v1);
+        break;
+    case MathOperator::MATH_ARCCOS:
+        ret = std::acos(v1);
+        break;
+    case MathOperator::MATH_ARCTAN:
+        ret = std::atan(v1);
+        break;
+    case MathOperator::MATH_SQRT:
+        ret = std::sqrt(v1);
+        break;
+    case MathOperator::MATH_LOG:
+        ret = std::log(v1);
+        break;
+    case MathOperator::MATH_LOG2:
+        ret = std::log2(v1);
+        break;
+    case MathOperator::MATH_LOG10:
+        ret = std::log10(v1);
+        break;
+    case MathOperator::MATH_EXP:
+        ret = std::exp(v1);
+        break;
+    case MathOperator::MATH_POSITIVE:
+        ret = v1;
+        break;
+    case MathOperator::MATH_NEGATIVE:
+        ret = -v1;
+        break;
 
-        assert(!node->left && !node->right);
+    case MathOperator::MATH_MOD: //%
+        ret = static_cast<T>(static_cast<int>(v1) % static_cast<int>(v2));
+        break;
+    case MathOperator::MATH_AND: //&
+        ret = static_cast<T>(static_cast<int>(v1) & static_cast<int>(v2));
+        break;
+    case MathOperator::MATH_OR: //|
+        ret = static_cast<T>(static_cast<int>(v1) | static_cast<int>(v2));
+        break;
 
-        // 这里如果把node填入vector，最后翻转。得到的序列就是后序遍历。
+    case MathOperator::MATH_POWER: //^
+        ret = std::pow(v1, v2);
+        break;
 
-        // 这里node会被自动释放。
+    case MathOperator::MATH_ADD:
+        ret = v1 + v2;
+        break;
+    case MathOperator::MATH_SUB:
+        ret = v1 - v2;
+        break;
+    case MathOperator::MATH_MULTIPLY:
+        ret = v1 * v2;
+        break;
+    case MathOperator::MATH_DIVIDE:
+        ret = v1 / v2;
+        break;
+    default:
+        assert(0 && "[Calc] bug.");
+        break;
     }
-}
-
-inline Node CloneRecursively(const Node &src) noexcept {
-    auto ret = std::make_unique<NodeImpl>(src->type, src->op, src->value, src->varname);
-    auto Copy = [ret = ret.get()](Node &tgt, const Node &src) {
-        if (src) {
-            tgt = Clone(src);
-            tgt->parent = ret;
-        }
-    };
 
-    Copy(ret->left, src->left);
-    Copy(ret->right, src->right);
+    if (Config::Get().throwOnInvalidValue && !std::isfinite(ret)) {
+        internal::ThrowInvalidNumber(op, static_cast<double>(v1), static_cast<double>(v2));
+    }
 
     return ret;
 }
 
-// 前序遍历。非递归实现。
-inline Node CloneNonRecursively(const Node &node) noexcept {
-    std::stack<std::tuple<const NodeImpl &, NodeImpl &, Node &>> stk;
+/**
+ * 以double计算运算符op，参数可以是int等能隐式转换为double的类型。一元运算符忽略v2。
+ * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+ */
+inline double Calc(MathOperator op, double v1, double v2);
 
-    auto MakeNode = [](const NodeImpl &src, NodeImpl *parent = nullptr) {
-        auto node = std::make_unique<NodeImpl>(src.type, src.op, src.value, src.varname);
-        node->parent = parent;
-        return node;
+/**
+ * Calc的W路版本：对l = 0..W-1计算v1[l] = op(v1[l], v2[l])，一元运算符忽略v2。
+ * 运算符的分支在循环外，各路的计算连续进行，编译器可以将其向量化。
+ * 不抛出异常：结果为浮点数无效值(inf, -inf, nan)的路将invalid[l]置为true，其余路不受影响。
+ * 与Calc不同，%、&、|的操作数不是有限值或者超出int的范围、以及对0取模时，结果为nan，而不是未定义行为。
+ */
+template <int W>
+inline void CalcLanes(MathOperator op, double *v1, const double *v2, bool *invalid) noexcept {
+    auto unary = [v1](auto fn) {
+        for (int l = 0; l < W; ++l) {
+            v1[l] = fn(v1[l]);
+        }
     };
-
-    auto EmplaceNode = [&stk](const Node &src, NodeImpl &parent, Node &tgt) {
-        if (src) {
-            stk.emplace(*src, parent, tgt);
+    auto binary = [v1, v2](auto fn) {
+        for (int l = 0; l < W; ++l) {
+            v1[l] = fn(v1[l], v2[l]);
         }
     };
-
-    auto EmplaceChildren = [&EmplaceNode](const NodeImpl &src, Node &tgt) {
-        EmplaceNode(src.left, *tgt, tgt->left);
-        EmplaceNode(src.right, *tgt, tgt->right);
+    auto integer = [v1, v2](auto fn) {
+        const double limit = 2147483648.0; // 2^31，|v| < limit时截断为int不会溢出，nan不满足
+        for (int l = 0; l < W; ++l) {
+            bool inRange = std::abs(v1[l]) < limit && std::abs(v2[l]) < limit;
+            v1[l] = inRange ? fn(static_cast<int>(v1[l]), static_cast<int>(v2[l]))
+                            : std::numeric_limits<double>::quiet_NaN();
+        }
     };
+    switch (op) {
+    case MathOperator::MATH_SIN:
+        unary([](double v) {
+            return std::sin(v);
+        });
+        break;
+    case MathOperator::MATH_COS:
+        unary([](double v) {
+            return std::cos(v);
+        });
+        break;
+    case MathOperator::MATH_TAN:
+        unary([](double v) {
+            return std::tan(v);
+        });
+        break;
+    case MathOperator::MATH_ARCSIN:
+        unary([](double v) {
+            return std::asin(v);
+        });
+        break;
+    case MathOperator::MATH_ARCCOS:
+        unary([](double v) {
+            return std::acos(v);
+        });
+        break;
+    case MathOperator::MATH_ARCTAN:
+        unary([](double v) {
+            return std::atan(v);
+        });
+        break;
+    case MathOperator::MATH_SQRT:
+        unary([](double v) {
+            return std::sqrt(v);
+        });
+        break;
+    case MathOperator::MATH_LOG:
+        unary([](double v) {
+            return std::log(v);
+        });
+        break;
+    case MathOperator::MATH_LOG2:
+        unary([](double v) {
+            return std::log2(v);
+        });
+        break;
+    case MathOperator::MATH_LOG10:
+        unary([](double v) {
+            return std::log10(v);
+        });
+        break;
+    case MathOperator::MATH_EXP:
+        unary([](double v) {
+            return std::exp(v);
+        });
+        break;
+    case MathOperator::MATH_POSITIVE:
+        break;
+    case MathOperator::MATH_NEGATIVE:
+        unary([](double v) {
+            return -v;
+        });
+        break;
 
-    auto ret = MakeNode(*node);
-    EmplaceChildren(*node, ret);
+    case MathOperator::MATH_MOD: //%
+        integer([](int a, int b) {
+            return b == 0 ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(a % b);
+        });
+        break;
+    case MathOperator::MATH_AND: //&
+        integer([](int a, int b) {
+            return static_cast<double>(a & b);
+        });
+        break;
+    case MathOperator::MATH_OR: //|
+        integer([](int a, int b) {
+            return static_cast<double>(a | b);
+        });
+        break;
 
-    while (!stk.empty()) {
-        const auto &src = std::get<0>(stk.top());
-        auto &parent = std::get<1>(stk.top());
-        auto &tgt = std::get<2>(stk.top());
-        stk.pop();
-
-        tgt = MakeNode(src, &parent);
-        EmplaceChildren(src, tgt);
-    }
-
-    return ret;
-}
-
-inline void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept {
-    n1->parent = parent;
-    child = std::move(n1);
-}
-
-inline void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept {
-    auto n1Clone = std::make_unique<NodeImpl>(*n1);
-    n1Clone->parent = parent;
-    child = std::move(n1Clone);
-}
-
-inline std::ostream &operator<<(std::ostream &out, const Node &n) noexcept {
-    out << n->ToString();
-    return out;
-}
-
-inline Node Operator(MathOperator op, Node left, Node right) noexcept {
-    auto ret = std::make_unique<internal::NodeImpl>(NodeType::OPERATOR, op, 0, "");
-
-    auto SetChild = [ret = ret.get()](Node &tgt, Node src) {
-        if (src) {
-            src->parent = ret;
-            tgt = std::move(src);
-        }
-    };
-
-    SetChild(ret->left, std::move(left));
-    SetChild(ret->right, std::move(right));
-
-    return ret;
-}
-
-// 前序遍历。非递归实现。
-inline std::set<std::string> NodeImpl::GetAllVarNames() const noexcept {
-    std::set<std::string> ret;
-
-    std::stack<std::reference_wrapper<const NodeImpl>> stk;
-
-    auto EmplaceNode = [&stk](const Node &node) {
-        if (node) {
-            stk.emplace(*node);
-        }
-    };
-
-    auto EmplaceChild = [&ret, &EmplaceNode](const NodeImpl &node) {
-        if (node.type == NodeType::VARIABLE) {
-            ret.emplace(node.varname);
-        }
-        EmplaceNode(node.left);
-        EmplaceNode(node.right);
-    };
-
-    EmplaceChild(*this);
-
-    while (!stk.empty()) {
-        const auto &node = stk.top().get();
-        stk.pop();
-        EmplaceChild(node);
-    }
-
-    return ret;
-}
-
-} // namespace internal
-
-inline Node Clone(const Node &rhs) noexcept {
-    return internal::CloneNonRecursively(rhs);
-}
-
-inline Node Move(Node &rhs) noexcept {
-    return std::move(rhs);
-}
-
-inline Node Num(double num) noexcept {
-    return std::make_unique<internal::NodeImpl>(NodeType::NUMBER, MathOperator::MATH_NULL, num, "");
-}
+    case MathOperator::MATH_POWER: //^
+        binary([](double a, double b) {
+            return std::pow(a, b);
+        });
+        break;
 
-inline Node Op(MathOperator op) {
-    if (op == MathOperator::MATH_NULL) {
-        throw std::runtime_error("Illegal MathOperator: MATH_NULL");
+    case MathOperator::MATH_ADD:
+        binary([](double a, double b) {
+            return a + b;
+        });
+        break;
+    case MathOperator::MATH_SUB:
+        binary([](double a, double b) {
+            return a - b;
+        });
+        break;
+    case MathOperator::MATH_MULTIPLY:
+        binary([](double a, double b) {
+            return a * b;
+        });
+        break;
+    case MathOperator::MATH_DIVIDE:
+        binary([](double a, double b) {
+            return a / b;
+        });
+        break;
+    default:
+        assert(0 && "[CalcLanes] bug.");
+        break;
     }
-    return std::make_unique<internal::NodeImpl>(NodeType::OPERATOR, op, 0, "");
-}
-
-inline bool VarNameIsLegal(const std::string &varname) noexcept {
-    return std::regex_match(varname.begin(), varname.end(), std::regex{R"((?=\w)\D\w*)"});
-}
 
-inline Node Var(std::string varname) {
-    if (!VarNameIsLegal(varname)) {
-        throw std::runtime_error("Illegal varname: " + varname);
+    // 有限值x满足x - x == 0，inf和nan不满足
+    for (int l = 0; l < W; ++l) {
+        invalid[l] = invalid[l] || !(v1[l] - v1[l] == 0);
     }
-    return std::make_unique<internal::NodeImpl>(NodeType::VARIABLE, MathOperator::MATH_NULL, 0, std::move(varname));
 }
 
 } // namespace tomsolver
@@ -1906,1782 +2389,6887 @@ inline bool IsFunction(MathOperator op) noexcept {
 }
 
 inline double Calc(MathOperator op, double v1, double v2) {
-    double ret = std::numeric_limits<double>::quiet_NaN();
-    switch (op) {
-    case MathOperator::MATH_SIN:
-        ret = std::sin(v1);
-        break;
-    case MathOperator::MATH_COS:
-        ret = std::cos(v1);
-        break;
-    case MathOperator::MATH_TAN:
-        ret = std::tan(v1);
-        break;
-    case MathOperator::MATH_ARCSIN:
-        ret = std::asin(v1);
-        break;
-    case MathOperator::MATH_ARCCOS:
-        ret = std::acos(v1);
-        break;
-    case MathOperator::MATH_ARCTAN:
-        ret = std::atan(v1);
-        break;
-    case MathOperator::MATH_SQRT:
-        ret = std::sqrt(v1);
-        break;
-    case MathOperator::MATH_LOG:
-        ret = std::log(v1);
-        break;
-    case MathOperator::MATH_LOG2:
-        ret = std::log2(v1);
-        break;
-    case MathOperator::MATH_LOG10:
-        ret = std::log10(v1);
-        break;
-    case MathOperator::MATH_EXP:
-        ret = std::exp(v1);
-        break;
-    case MathOperator::MATH_POSITIVE:
-        ret = v1;
-        break;
-    case MathOperator::MATH_NEGATIVE:
-        ret = -v1;
-        break;
-
-    case MathOperator::MATH_MOD: //%
-        ret = (int)v1 % (int)v2;
-        break;
-    case MathOperator::MATH_AND: //&
-        ret = (int)v1 & (int)v2;
-        break;
-    case MathOperator::MATH_OR: //|
-        ret = (int)v1 | (int)v2;
-        break;
+    return Calc<double>(op, v1, v2);
+}
 
-    case MathOperator::MATH_POWER: //^
-        ret = std::pow(v1, v2);
-        break;
+namespace internal {
 
-    case MathOperator::MATH_ADD:
-        ret = v1 + v2;
-        break;
-    case MathOperator::MATH_SUB:
-        ret = v1 - v2;
-        break;
-    case MathOperator::MATH_MULTIPLY:
-        ret = v1 * v2;
+inline void ThrowInvalidNumber(MathOperator op, double v1, double v2) {
+    std::stringstream info;
+    info << "expression: \"";
+    switch (GetOperatorNum(op)) {
+    case 1:
+        info << MathOperatorToStr(op) << " " << ToString(v1);
         break;
-    case MathOperator::MATH_DIVIDE:
-        ret = v1 / v2;
+    case 2:
+        info << ToString(v1) << " " << MathOperatorToStr(op) << " " << ToString(v2);
         break;
     default:
-        assert(0 && "[Calc] bug.");
-        break;
-    }
-
-    if (Config::Get().throwOnInvalidValue == false) {
-        return ret;
-    }
-
-    bool isInvalid = (ret == std::numeric_limits<double>::infinity()) ||
-                     (ret == -std::numeric_limits<double>::infinity()) || (ret != ret);
-    if (isInvalid) {
-        // std::string info;
-        std::stringstream info;
-        info << "expression: \"";
-        switch (GetOperatorNum(op)) {
-        case 1:
-            info << MathOperatorToStr(op) << " " << ToString(v1);
-            break;
-        case 2:
-            info << ToString(v1) << " " << MathOperatorToStr(op) << " " << ToString(v2);
-            break;
-        default:
-            assert(0);
-        }
-        info << "\"";
-        throw MathError(ErrorType::ERROR_INVALID_NUMBER, info.str());
+        assert(0);
     }
-
-    return ret;
+    info << "\"";
+    throw MathError(ErrorType::ERROR_INVALID_NUMBER, info.str());
 }
 
+} // namespace internal
+
 } // namespace tomsolver
 
 namespace tomsolver {
 
-inline Mat::Mat(int rows, int cols, double initValue) noexcept : rows(rows), cols(cols), data(initValue, rows * cols) {
-    assert(rows > 0);
-    assert(cols > 0);
-}
+/*
+ * 不拥有内存的矩阵、向量视图。
+ * 视图只保存首元素地址、尺寸和步长，可以指向Mat/Vec的内存，也可以指向调用者自己管理的数组，
+ * 构造和复制都不申请堆内存。视图在使用期间，被指向的内存必须保持有效。
+ * 视图也是矩阵表达式，可以直接参与+、-、数乘运算，或者赋值给Mat/Vec。
+ */
 
-inline Mat::Mat(std::initializer_list<std::initializer_list<double>> init) noexcept {
-    rows = static_cast<int>(init.size());
-    assert(rows > 0);
-    cols = static_cast<int>(std::max(init, [](auto lhs, auto rhs) {
-                                return lhs.size() < rhs.size();
-                            }).size());
-    assert(cols > 0);
-    data.resize(rows * cols);
+class VecView;
 
-    auto i = 0;
-    for (auto values : init) {
-        Row(i++) = values;
-    }
-}
+/**
+ * 只读的矩阵视图。元素(i, j)位于data[i * rowStride + j * colStride]。
+ */
+class MatView : public MatExpr<MatView> {
+public:
+    /**
+     * 按行连续存储的rows×cols矩阵。
+     */
+    MatView(const double *data, int rows, int cols) noexcept;
 
-inline Mat::Mat(int rows, int cols, std::valarray<double> data) noexcept
-    : rows(rows), cols(cols), data(std::move(data)) {}
+    MatView(const double *data, int rows, int cols, int rowStride, int colStride) noexcept;
 
-inline std::slice_array<double> Mat::Row(int i, int offset) {
-    return data[std::slice(cols * i + offset, cols - offset, 1)];
-}
+    MatView(const Mat &mat) noexcept;
 
-inline std::slice_array<double> Mat::Col(int j, int offset) {
-    return data[std::slice(j + offset * cols, rows - offset, cols)];
-}
+    int Rows() const noexcept {
+        return rows;
+    }
 
-inline auto Mat::Row(int i, int offset) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]) {
-    return data[std::slice(cols * i + offset, cols - offset, 1)];
-}
+    int Cols() const noexcept {
+        return cols;
+    }
 
-inline auto Mat::Col(int j, int offset) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]) {
-    return data[std::slice(j + offset * cols, rows - offset, cols)];
-}
+    int RowStride() const noexcept;
 
-inline const double &Mat::Value(int i, int j) const {
-    return data[i * cols + j];
-}
+    int ColStride() const noexcept;
 
-inline double &Mat::Value(int i, int j) {
-    return data[i * cols + j];
-}
+    const double *Data() const noexcept;
 
-inline bool Mat::operator==(double m) const noexcept {
-    return std::all_of(std::begin(data), std::end(data), [m](auto val) {
-        return std::abs(val - m) < Config::Get().epsilon;
-    });
-}
+    double Value(int i, int j) const noexcept {
+        return data[i * rowStride + j * colStride];
+    }
 
-inline bool Mat::operator==(const Mat &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == b.cols);
-    return std::all_of(std::begin(data), std::end(data), [iter = std::begin(b.data)](auto val) mutable {
-        return std::abs(val - *iter++) < Config::Get().epsilon;
-    });
-}
+    /**
+     * 按行连续存储的顺序访问第i个元素。
+     */
+    double Coeff(int i) const noexcept {
+        if (IsContiguous()) {
+            return data[i];
+        }
+        return Value(i / cols, i % cols);
+    }
 
-// be negative
-inline Mat Mat::operator-() noexcept {
-    return {rows, cols, -data};
-}
+    /**
+     * 返回是否按行连续存储。
+     */
+    bool IsContiguous() const noexcept {
+        return rowStride == cols && colStride == 1;
+    }
 
-inline Mat Mat::operator+(const Mat &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == b.cols);
-    return {rows, cols, data + b.data};
-}
+    /**
+     * 转置视图，不复制数据。
+     */
+    MatView Transpose() const noexcept;
 
-inline Mat &Mat::operator+=(const Mat &b) noexcept {
-    assert(rows == b.rows);
-    assert(cols == b.cols);
-    data += b.data;
-    return *this;
-}
+    /**
+     * 从(i, j)开始的rows×cols子矩阵视图。
+     */
+    MatView Block(int i, int j, int rows, int cols) const noexcept;
 
-inline Mat Mat::operator-(const Mat &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == b.cols);
-    return {rows, cols, data - b.data};
-}
+    VecView Row(int i) const noexcept;
 
-inline Mat Mat::operator*(double m) const noexcept {
-    return {rows, cols, data * m};
-}
+    VecView Col(int j) const noexcept;
 
-inline Mat Mat::operator*(const Mat &b) const noexcept {
-    assert(cols == b.rows);
-    Mat ans(rows, b.cols);
-    for (auto i = 0; i < rows; ++i) {
-        for (auto j = 0; j < b.cols; ++j) {
-            ans.Value(i, j) = (Row(i) * b.Col(j)).sum();
-        }
+private:
+    const double *data;
+    int rows;
+    int cols;
+    int rowStride;
+    int colStride;
+};
+
+class MutableVecView;
+
+/**
+ * 只读的向量视图。第i个元素位于data[i * stride]。
+ */
+class VecView : public MatExpr<VecView> {
+public:
+    VecView(const double *data, int size, int stride = 1) noexcept;
+
+    VecView(const Vec &v) noexcept;
+
+    VecView(const MutableVecView &v) noexcept;
+
+    int Rows() const noexcept {
+        return size;
     }
-    return ans;
-}
 
-inline int Mat::Rows() const noexcept {
-    return rows;
-}
+    int Cols() const noexcept {
+        return 1;
+    }
 
-inline int Mat::Cols() const noexcept {
-    return cols;
-}
+    int Size() const noexcept;
 
-inline Vec Mat::ToVec() const {
-    assert(rows > 0);
-    if (cols != 1) {
-        throw std::runtime_error("Mat::ToVec fail. rows is not one");
+    int Stride() const noexcept;
+
+    const double *Data() const noexcept;
+
+    double operator[](int i) const noexcept {
+        return data[i * stride];
     }
-    Vec v(rows);
-    v.cols = 1;
-    v.data = data;
-    return v;
-}
 
-inline Mat &Mat::SwapRow(int i, int j) noexcept {
-    if (i == j) {
-        return *this;
+    double Coeff(int i) const noexcept {
+        return data[i * stride];
     }
-    assert(i >= 0);
-    assert(i < rows);
-    assert(j >= 0);
-    assert(j < rows);
 
-    std::valarray<double> temp = Row(i);
-    Row(i) = Row(j);
-    Row(j) = temp;
+    bool IsContiguous() const noexcept {
+        return stride == 1;
+    }
 
-    return *this;
-}
+    /**
+     * 从start开始、长度为size的子向量视图。
+     */
+    VecView Segment(int start, int size) const noexcept;
 
-inline Mat &Mat::SwapCol(int i, int j) noexcept {
-    if (i == j) {
+private:
+    const double *data;
+    int size;
+    int stride;
+};
+
+/**
+ * 可写的向量视图，用于把结果直接写入调用者的内存。
+ * 与std::slice_array一样，赋值操作复制元素，而不是让视图指向别处。
+ */
+class MutableVecView : public MatExpr<MutableVecView> {
+public:
+    MutableVecView(double *data, int size, int stride = 1) noexcept;
+
+    MutableVecView(Vec &v) noexcept;
+
+    MutableVecView(const MutableVecView &) = default;
+
+    /**
+     * 逐元素复制v的值。
+     */
+    MutableVecView &operator=(const MutableVecView &v) noexcept;
+
+    /**
+     * 逐元素复制列向量m的值。
+     */
+    MutableVecView &operator=(const Mat &m) noexcept;
+
+    /**
+     * 对表达式逐元素求值并写入视图。表达式可以引用视图自身的元素。
+     */
+    template <typename E>
+    MutableVecView &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == size);
+        assert(expr.Cols() == 1);
+        const E &e = expr.Derived();
+        for (int i = 0; i < size; ++i) {
+            data[i * stride] = e.Coeff(i);
+        }
         return *this;
     }
-    assert(i >= 0);
-    assert(i < cols);
-    assert(j >= 0);
-    assert(j < cols);
 
-    std::valarray<double> t = Col(i);
-    Col(i) = Col(j);
-    Col(j) = t;
+    int Rows() const noexcept {
+        return size;
+    }
 
-    return *this;
-}
+    int Cols() const noexcept {
+        return 1;
+    }
 
-inline std::string Mat::ToString() const noexcept {
-    if (data.size() == 0) {
-        return "[]\n";
+    int Size() const noexcept;
+
+    int Stride() const noexcept;
+
+    double *Data() const noexcept;
+
+    double &operator[](int i) const noexcept {
+        return data[i * stride];
     }
 
-    std::stringstream ss;
-    ss << "[";
+    double Coeff(int i) const noexcept {
+        return data[i * stride];
+    }
 
-    size_t i = 0;
-    for (auto val : data) {
-        ss << (i == 0 ? "" : " ") << tomsolver::ToString(val);
-        i++;
-        ss << (i % cols == 0 ? (i == data.size() ? "]\n" : "\n") : ", ");
+    bool IsContiguous() const noexcept {
+        return stride == 1;
     }
 
-    return ss.str();
+    MutableVecView Segment(int start, int size) const noexcept;
+
+private:
+    double *data;
+    int size;
+    int stride;
+};
+
+/**
+ * 向量点乘。
+ */
+inline double Dot(VecView a, VecView b) noexcept;
+
+namespace internal {
+
+/**
+ * 不能直接转换为VecView的表达式（如a - b）时启用。视图使用上面的重载。
+ */
+template <typename E>
+using EnableIfNotVecView = std::enable_if_t<!std::is_convertible<const E &, VecView>::value>;
+
+} // namespace internal
+
+/**
+ * 向量表达式与向量点乘，逐元素求值，不生成中间向量。
+ */
+template <typename E, typename = internal::EnableIfNotVecView<E>>
+inline double Dot(const MatExpr<E> &a, VecView b) noexcept {
+    assert(a.Rows() == b.Size());
+    assert(a.Cols() == 1);
+    const E &e = a.Derived();
+    double ret = 0;
+    for (int i = 0; i < b.Size(); ++i) {
+        ret += e.Coeff(i) * b[i];
+    }
+    return ret;
 }
 
-inline void Mat::Resize(int newRows, int newCols) noexcept {
-    assert(newRows > 0 && newCols > 0);
-    auto temp = std::move(data);
-    data.resize(newRows * newCols);
-    auto minRows = std::min<size_t>(rows, newRows);
-    auto minCols = std::min<size_t>(cols, newCols);
-    data[std::gslice(0, {minRows, minCols}, {static_cast<size_t>(newCols), 1})] =
-        temp[std::gslice(0, {minRows, minCols}, {static_cast<size_t>(cols), 1})];
-    rows = newRows;
-    cols = newCols;
+template <typename E, typename = internal::EnableIfNotVecView<E>>
+inline double Dot(VecView a, const MatExpr<E> &b) noexcept {
+    return Dot(b, a);
 }
 
-inline Mat &Mat::Zero() noexcept {
-    data = 0;
-    return *this;
+template <typename L, typename R, typename = internal::EnableIfNotVecView<L>,
+          typename = internal::EnableIfNotVecView<R>>
+inline double Dot(const MatExpr<L> &a, const MatExpr<R> &b) noexcept {
+    assert(a.Rows() == b.Rows());
+    assert(a.Cols() == 1);
+    assert(b.Cols() == 1);
+    const L &l = a.Derived();
+    const R &r = b.Derived();
+    double ret = 0;
+    for (int i = 0; i < a.Rows(); ++i) {
+        ret += l.Coeff(i) * r.Coeff(i);
+    }
+    return ret;
 }
 
-inline Mat &Mat::Ones() noexcept {
-    assert(rows == cols);
-    Zero();
-    data[std::slice(0, rows, cols + 1)] = 1;
-    return *this;
+/**
+ * out = x + alpha * y，不产生临时对象。out可以与x或y指向同一块内存（步长也相同）。
+ */
+inline void ScaledAdd(VecView x, double alpha, VecView y, MutableVecView out) noexcept;
+
+/**
+ * out = alpha * x，不产生临时对象。out可以与x指向同一块内存（步长也相同）。
+ */
+inline void Scale(double alpha, VecView x, MutableVecView out) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline MatView::MatView(const double *data, int rows, int cols) noexcept : MatView(data, rows, cols, cols, 1) {}
+
+inline MatView::MatView(const double *data, int rows, int cols, int rowStride, int colStride) noexcept
+    : data(data), rows(rows), cols(cols), rowStride(rowStride), colStride(colStride) {
+    assert(rows >= 0);
+    assert(cols >= 0);
 }
 
-inline double Mat::Norm2() const noexcept {
-    return (data * data).sum();
+inline MatView::MatView(const Mat &mat) noexcept : MatView(mat.Data(), mat.Rows(), mat.Cols()) {}
+
+inline int MatView::RowStride() const noexcept {
+    return rowStride;
 }
 
-inline double Mat::NormInfinity() const noexcept {
-    return std::abs(data).max();
+inline int MatView::ColStride() const noexcept {
+    return colStride;
 }
 
-inline double Mat::NormNegInfinity() const noexcept {
-    return std::abs(data).min();
+inline const double *MatView::Data() const noexcept {
+    return data;
 }
 
-inline double Mat::Min() const noexcept {
-    return data.min();
+inline MatView MatView::Transpose() const noexcept {
+    return {data, cols, rows, colStride, rowStride};
 }
 
-inline void Mat::SetValue(double value) noexcept {
-    data = value;
+inline MatView MatView::Block(int i, int j, int rows, int cols) const noexcept {
+    assert(i >= 0 && i + rows <= this->rows);
+    assert(j >= 0 && j + cols <= this->cols);
+    return {data + i * rowStride + j * colStride, rows, cols, rowStride, colStride};
 }
 
-inline bool Mat::PositiveDetermine() const noexcept {
-    assert(rows == cols);
-    for (int i = 1; i <= rows; ++i) {
-        if (Det(*this, i) <= 0) {
-            return false;
-        }
-    }
-    return true;
+inline VecView MatView::Row(int i) const noexcept {
+    assert(i >= 0 && i < rows);
+    return {data + i * rowStride, cols, colStride};
 }
 
-inline Mat Mat::Transpose() const noexcept {
-    Mat ans(cols, rows);
-    for (auto i = 0; i < cols; i++) {
-        ans.Row(i) = Col(i);
-    }
-    return ans;
+inline VecView MatView::Col(int j) const noexcept {
+    assert(j >= 0 && j < cols);
+    return {data + j * colStride, rows, rowStride};
 }
 
-inline Mat Mat::Inverse() const {
-    assert(rows == cols);
-    int n = rows;
-    double det = Det(*this, n); // Determinant, 역행렬을 시킬 행렬의 행렬식을 구함
+inline VecView::VecView(const double *data, int size, int stride) noexcept : data(data), size(size), stride(stride) {
+    assert(size >= 0);
+}
 
-    if (std::abs(det) <= Config::Get().epsilon) // 0일때는 예외처리 (역행렬을 구할 수 없기 때문.)
-    {
-        throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
-    }
+inline VecView::VecView(const Vec &v) noexcept : VecView(v.Data(), v.Rows()) {}
 
-    Mat adj(n, n); // 딸림행렬 선언
+inline VecView::VecView(const MutableVecView &v) noexcept : VecView(v.Data(), v.Size(), v.Stride()) {}
 
-    Adjoint(*this, adj); // 딸림행렬 초기화
+inline int VecView::Size() const noexcept {
+    return size;
+}
 
-    return {n, n, adj.data / det};
+inline int VecView::Stride() const noexcept {
+    return stride;
 }
 
-inline Mat operator*(double k, const Mat &mat) noexcept {
-    Mat ans(mat);
-    ans.data *= k;
-    return ans;
+inline const double *VecView::Data() const noexcept {
+    return data;
 }
 
-inline Mat EachDivide(const Mat &a, const Mat &b) noexcept {
-    assert(a.rows == b.rows);
-    assert(a.cols == b.cols);
-    return {a.rows, b.cols, b.data / b.data};
+inline VecView VecView::Segment(int start, int size) const noexcept {
+    assert(start >= 0 && start + size <= this->size);
+    return {data + start * stride, size, stride};
 }
 
-inline bool IsZero(const Mat &mat) noexcept {
-    return std::all_of(std::begin(mat.data), std::end(mat.data), [](auto val) {
-        return std::abs(val) <= Config::Get().epsilon;
-    });
+inline MutableVecView::MutableVecView(double *data, int size, int stride) noexcept
+    : data(data), size(size), stride(stride) {
+    assert(size >= 0);
 }
 
-inline bool AllIsLessThan(const Mat &v1, const Mat &v2) noexcept {
-    assert(v1.rows == v2.rows && v1.cols == v2.cols);
-    return std::all_of(std::begin(v1.data), std::end(v1.data), [iter = std::begin(v2.data)](auto val) mutable {
-        return val < *iter++;
-    });
+inline MutableVecView::MutableVecView(Vec &v) noexcept : MutableVecView(v.Data(), v.Rows()) {}
+
+inline MutableVecView &MutableVecView::operator=(const MutableVecView &v) noexcept {
+    return *this = VecView(v);
 }
 
-inline int GetMaxAbsRowIndex(const Mat &A, int rowStart, int rowEnd, int col) noexcept {
-    std::valarray<double> temp =
-        std::valarray<double>(A.Col(col)[std::slice(rowStart, rowEnd - rowStart + 1, 1)]).apply(std::abs);
-    auto ret = std::distance(std::begin(temp), std::find(std::begin(temp), std::end(temp), temp.max())) + rowStart;
-    return static_cast<int>(ret);
+inline MutableVecView &MutableVecView::operator=(const Mat &m) noexcept {
+    assert(m.Cols() == 1);
+    return *this = MatView(m);
 }
 
-inline void Adjoint(const Mat &A, Mat &adj) noexcept // 딸림행렬, 수반행렬
-{
-    if (A.rows == 1) // 예외처리
-    {
-        adj.Value(0, 0) = 1;
-        return;
-    }
+inline int MutableVecView::Size() const noexcept {
+    return size;
+}
 
-    Mat cofactor(A.rows - 1, A.cols - 1);
+inline int MutableVecView::Stride() const noexcept {
+    return stride;
+}
 
-    for (int i = 0; i < A.rows; i++) {
-        for (int j = 0; j < A.cols; j++) {
-            GetCofactor(A, cofactor, i, j, A.rows); // 여인수 구하기, 단 i, j값으로 되기에 temp는 항상 바뀐다.
+inline double *MutableVecView::Data() const noexcept {
+    return data;
+}
 
-            auto det = (Det(cofactor, A.rows - 1));
+inline MutableVecView MutableVecView::Segment(int start, int size) const noexcept {
+    assert(start >= 0 && start + size <= this->size);
+    return {data + start * stride, size, stride};
+}
 
-            if ((i + j) % 2 != 0) {
-                det = -det; // +, -, + 형식으로 되는데, 0,0 좌표면 +, 0,1좌표면 -, 이렇게 된다.
-            }
+inline double Dot(VecView a, VecView b) noexcept {
+    assert(a.Size() == b.Size());
+    if (a.IsContiguous() && b.IsContiguous()) {
+        return internal::Dot(a.Size(), a.Data(), b.Data());
+    }
+    double ret = 0;
+    for (int i = 0; i < a.Size(); ++i) {
+        ret += a[i] * b[i];
+    }
+    return ret;
+}
 
-            adj.Value(j, i) = det; // n - 1 X n - 1 은, 언제나 각 여인수 행렬 은
-                                   // 여인수를 따오는 행렬의 크기 - 1 이기 때문이다.
-        }
+inline void ScaledAdd(VecView x, double alpha, VecView y, MutableVecView out) noexcept {
+    assert(x.Size() == y.Size());
+    assert(x.Size() == out.Size());
+    if (x.IsContiguous() && y.IsContiguous() && out.IsContiguous()) {
+        internal::ScaledAdd(x.Size(), x.Data(), alpha, y.Data(), out.Data());
+        return;
+    }
+    for (int i = 0; i < x.Size(); ++i) {
+        out[i] = x[i] + alpha * y[i];
     }
 }
 
-inline void GetCofactor(const Mat &A, Mat &cofactor, int p, int q,
-                        int n) noexcept // 여인수를 구해다주는 함수!
-{
-    /*
-         ┌───┄┄┄┄┄┄┄┄┬───┬┄┄┄┄┄┄┄┄───┐   size of region A = p * q
-    0 -> │           │   │           │                  B = p * (n - 1 - q)
-         ┆           ┆   ┆           ┆                  C = (n - 1 - p) * q
-         ┆     A     ┆   ┆     B     ┆                  D = (n - 1 - p) * (n - 1 - q)
-         ┆           ┆   ┆           ┆
-         ┆           ┆   ┆           ┆    left top of region
-         ├───┄┄┄┄┄┄┄┄┼───┼┄┄┄┄┄┄┄┄───┤   ╔════════╤════════════════╤══════════╗
-    p ─> │           │   │           │   ║ region │ origin matrix  │ cofactor ║
-         ├───┄┄┄┄┄┄┄┄┼───┼┄┄┄┄┄┄┄┄───┤   ╠════════╪════════════════╪══════════╣
-         ┆           ┆   ┆           ┆   ║ A      │ (0, 0)         │ (0, 0)   ║
-         ┆           ┆   ┆           ┆   ╟────────┼────────────────┼──────────╢
-         ┆     C     ┆   ┆     D     ┆   ║ B      │ (0, q + 1)     │ (0, q)   ║
-         ┆           ┆   ┆           ┆   ╟────────┼────────────────┼──────────╢
-         │           │   │           │   ║ C      │ (p + 1, 0)     │ (p, 0)   ║
-    n ─> └───┄┄┄┄┄┄┄┄┴───┴┄┄┄┄┄┄┄┄───┘   ╟────────┼────────────────┼──────────╢
-          ^            ^            ^    ║ D      │ (p + 1, q + 1) │ (p, q)   ║
-          0            q            n    ╚════════╧════════════════╧══════════╝
-    */
+inline void Scale(double alpha, VecView x, MutableVecView out) noexcept {
+    assert(x.Size() == out.Size());
+    for (int i = 0; i < x.Size(); ++i) {
+        out[i] = alpha * x[i];
+    }
+}
 
-    auto newIndex = [n = n - 1](int p, int q) -> size_t {
-        return p * n + q;
-    };
-    auto index = [n = A.cols](int p, int q) -> size_t {
-        return p * n + q;
-    };
-    auto makeValarray = [](int p, int q) {
-        return std::valarray<size_t>{static_cast<size_t>(p), static_cast<size_t>(q)};
-    };
-    auto newStride = makeValarray(n - 1, 1);
-    auto stride = makeValarray(A.cols, 1);
+} // namespace tomsolver
 
-    std::tuple<std::valarray<size_t>, size_t, size_t> config[] = {
-        {makeValarray(p, q), newIndex(0, 0), index(0, 0)},
-        {makeValarray(p, n - 1 - q), newIndex(0, q), index(0, q + 1)},
-        {makeValarray(n - 1 - p, q), newIndex(p, 0), index(p + 1, 0)},
-        {makeValarray(n - 1 - p, n - 1 - q), newIndex(p, q), index(p + 1, q + 1)},
-    };
+namespace tomsolver {
 
-    for (const auto &conf : config) {
-        const auto &size = std::get<0>(conf);
-        const auto &newStart = std::get<1>(conf);
-        const auto &start = std::get<2>(conf);
-        if (newStart < cofactor.data.size()) {
-            cofactor.data[std::gslice(newStart, size, newStride)] = A.data[std::gslice(start, size, stride)];
+/**
+ * 求解线性方程组Ax = b。传入矩阵A，向量b，返回向量x。A和b也可以是MatView/VecView（会复制一次）。
+ * 方程数量多于未知数数量（过定义）时，返回最小二乘解；A秩亏时返回最小二乘解中范数最小的一个。
+ * 方程数量少于未知数数量（不定方程）时，返回范数最小的解。
+ * @exception MathError 奇异矩阵
+ * @exception MathError 矛盾方程组
+ * @exception MathError 不定方程（设置Config::Get().allowIndeterminateEquation=true可以允许不定方程组返回一组特解）
+ *
+ */
+inline Vec SolveLinear(Mat A, Vec b);
+
+/**
+ * 以options代替Config::Get()求解线性方程组Ax = b，不读取也不修改全局配置。其余同上。
+ */
+inline Vec SolveLinear(Mat A, Vec b, const SolverOptions &options);
+
+namespace internal {
+
+/**
+ * n阶方阵的原地LU分解（列主元），标量类型为T（float、double、long double）。
+ * a按行连续存放，分解后L（不含对角线）和U存放在a中，pivots[k]为第k步消元时与第k行交换的行号。
+ * @exception MathError 奇异矩阵
+ */
+template <typename T>
+inline void LUFactorInPlace(T *a, int n, int *pivots) {
+    for (int k = 0; k < n; ++k) {
+        T *rowK = a + k * n;
+
+        // 从第k行到最后一行中，找出k列绝对值最大的一行作为主元行
+        int maxAbsRowIndex = k;
+        T maxAbs = std::abs(rowK[k]);
+        for (int i = k + 1; i < n; ++i) {
+            if (std::abs(a[i * n + k]) > maxAbs) {
+                maxAbs = std::abs(a[i * n + k]);
+                maxAbsRowIndex = i;
+            }
+        }
+
+        pivots[k] = maxAbsRowIndex;
+        if (maxAbs < Config::Get().epsilon) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+
+        if (maxAbsRowIndex != k) {
+            std::swap_ranges(rowK, rowK + n, a + maxAbsRowIndex * n);
+        }
+
+        // 消去k列对角线以下的元素，消元系数存放到L的位置
+        T pivot = rowK[k];
+        for (int i = k + 1; i < n; ++i) {
+            T *rowI = a + i * n;
+            T ratio = rowI[k] /= pivot;
+            if (ratio != 0) {
+                for (int j = k + 1; j < n; ++j) {
+                    rowI[j] -= ratio * rowK[j];
+                }
+            }
         }
     }
 }
 
-inline double Det(const Mat &A, int n) noexcept {
-    if (n == 0) {
-        return 0;
+/**
+ * 利用LUFactorInPlace的结果求解Ax = b。调用时x为b，返回时x为解。
+ * x可以是T*，也可以是支持operator[]的向量（例如MutableVecView）。
+ */
+template <typename T, typename X>
+inline void LUSolveInPlace(const T *lu, const int *pivots, int n, X &&x) noexcept {
+    // 按照分解时的顺序交换b的各行
+    for (int k = 0; k < n; ++k) {
+        if (pivots[k] != k) {
+            std::swap(x[k], x[pivots[k]]);
+        }
     }
 
-    if (n == 1) {
-        return A.Value(0, 0);
+    // 前代：Ly = Pb
+    for (int i = 1; i < n; ++i) {
+        const T *rowI = lu + i * n;
+        T v = x[i];
+        for (int j = 0; j < i; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v;
     }
 
-    if (n == 2) // 계산 압축
-    {
-        return A.Value(0, 0) * A.Value(1, 1) - A.Value(1, 0) * A.Value(0, 1);
+    // 回代：Ux = y
+    for (int i = n - 1; i >= 0; --i) {
+        const T *rowI = lu + i * n;
+        T v = x[i];
+        for (int j = i + 1; j < n; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v / rowI[i];
     }
+}
 
-    Mat cofactor(n - 1, n - 1); // n X n 행렬의 여인수를 담을 임시 행렬
-
-    double D = 0; // D = 한 행렬의 Determinant값
+/**
+ * 同时对W个n阶方阵做原地LU分解（列主元），每个方阵的结果与LUFactorInPlace相同。
+ * 各方阵按路交错存放：a[(i * n + j) * W + l]为第l个方阵的(i, j)元素，pivots[k * W + l]同理。
+ * 选主元时各路分别比较，消元时W路同时计算，最内层的循环连续访问内存，可以向量化。
+ * 不抛出异常：第l个方阵奇异时将ok[l]置为false，该路之后的结果没有意义。
+ */
+template <int W>
+inline void LUFactorLanes(double *a, int n, int *pivots, bool *ok) noexcept {
+    double eps = Config::Get().epsilon;
+    for (int k = 0; k < n; ++k) {
+        double *rowK = a + k * n * W;
+
+        // 各路分别找出k列绝对值最大的一行作为主元行
+        for (int l = 0; l < W; ++l) {
+            int maxAbsRowIndex = k;
+            double maxAbs = std::abs(rowK[k * W + l]);
+            for (int i = k + 1; i < n; ++i) {
+                if (std::abs(a[(i * n + k) * W + l]) > maxAbs) {
+                    maxAbs = std::abs(a[(i * n + k) * W + l]);
+                    maxAbsRowIndex = i;
+                }
+            }
 
-    int sign = 1; // sign = +, -, +, -.... 형태로 지속되는 결과값에 영향을 주는 정수
+            pivots[k * W + l] = maxAbsRowIndex;
+            if (maxAbs < eps) {
+                ok[l] = false;
+            }
 
-    for (int f = 0; f < n; f++) {
-        GetCofactor(A, cofactor, 0, f, n); // 0으로 고정시킨 이유는, 수학 공식 상 Determinant (행렬식)은 n개의 열 중
-        // 아무거나 잡아도 결과값은 모두 일치하기 때문
-        auto det = Det(cofactor, n - 1);
-        auto v = A.Value(0, f);
-        D += sign * v * det; // 재귀 형식으로 돌아간다. f는 n X n 중 정수 n을 향해 간다.
+            if (maxAbsRowIndex != k) {
+                for (int j = 0; j < n; ++j) {
+                    std::swap(rowK[j * W + l], a[(maxAbsRowIndex * n + j) * W + l]);
+                }
+            }
+        }
 
-        sign = -sign; // +, -, +, -... 형식으로 되기 때문에 반대로 만들어준다.
+        // 消去k列对角线以下的元素，消元系数存放到L的位置
+        for (int i = k + 1; i < n; ++i) {
+            double *rowI = a + i * n * W;
+            double ratio[W];
+            for (int l = 0; l < W; ++l) {
+                ratio[l] = rowI[k * W + l] /= rowK[k * W + l];
+            }
+            for (int j = k + 1; j < n; ++j) {
+                for (int l = 0; l < W; ++l) {
+                    rowI[j * W + l] -= ratio[l] * rowK[j * W + l];
+                }
+            }
+        }
     }
-
-    return D; // 마지막엔 n X n 행렬의 Determinant를 리턴해준다.
 }
 
-inline Vec::Vec(int rows, double initValue) noexcept : Mat(rows, 1, initValue) {}
+/**
+ * 利用LUFactorLanes的结果同时求解W个方程组，x[i * W + l]为第l个方程组的b，返回时为解。
+ */
+template <int W>
+inline void LUSolveLanes(const double *lu, const int *pivots, int n, double *x) noexcept {
+    for (int k = 0; k < n; ++k) {
+        for (int l = 0; l < W; ++l) {
+            int p = pivots[k * W + l];
+            if (p != k) {
+                std::swap(x[k * W + l], x[p * W + l]);
+            }
+        }
+    }
 
-inline Vec::Vec(std::initializer_list<double> init) noexcept : Vec(std::valarray<double>{init}) {}
+    // 前代：Ly = Pb
+    for (int i = 1; i < n; ++i) {
+        const double *rowI = lu + i * n * W;
+        for (int j = 0; j < i; ++j) {
+            for (int l = 0; l < W; ++l) {
+                x[i * W + l] -= rowI[j * W + l] * x[j * W + l];
+            }
+        }
+    }
 
-inline Vec::Vec(std::valarray<double> init) noexcept : Vec(static_cast<int>(init.size())) {
-    data = std::move(init);
+    // 回代：Ux = y
+    for (int i = n - 1; i >= 0; --i) {
+        const double *rowI = lu + i * n * W;
+        for (int j = i + 1; j < n; ++j) {
+            for (int l = 0; l < W; ++l) {
+                x[i * W + l] -= rowI[j * W + l] * x[j * W + l];
+            }
+        }
+        for (int l = 0; l < W; ++l) {
+            x[i * W + l] /= rowI[i * W + l];
+        }
+    }
 }
 
-inline Mat &Vec::AsMat() noexcept {
-    return *this;
-}
+} // namespace internal
 
-inline void Vec::Resize(int newRows) noexcept {
-    assert(newRows > 0);
-    Mat::Resize(newRows, 1);
-}
+/**
+ * 方阵的LU分解（列主元），PA = LU。
+ * 分解一次之后可以对多个右端向量反复求解，用于在多次迭代之间复用同一个雅可比矩阵的分解结果。
+ * 工作空间在构造时（或第一次分解时）分配，之后对同阶方阵的分解和求解都不再申请堆内存。
+ */
+class LUFactorization {
+public:
+    LUFactorization() noexcept = default;
 
-inline double &Vec::operator[](std::size_t i) noexcept {
-    return data[i];
-}
+    /**
+     * 预先分配n阶方阵所需的工作空间。
+     */
+    explicit LUFactorization(int n);
 
-inline double Vec::operator[](std::size_t i) const noexcept {
-    return data[i];
-}
+    /**
+     * 构造并立即分解方阵A。
+     * @exception MathError 奇异矩阵
+     */
+    explicit LUFactorization(MatView A);
 
-inline Vec Vec::operator+(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == 1 && b.cols == 1);
-    return {data + b.data};
-}
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(MatView A);
 
-inline Vec Vec::operator-() noexcept {
-    return {-data};
-}
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(const Mat &A);
 
-inline Vec Vec::operator-(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    return {data - b.data};
-}
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     */
+    Vec Solve(VecView b) const;
 
-inline Vec Vec::operator*(double m) const noexcept {
-    return {data * m};
-}
+    /**
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * 不申请堆内存。
+     */
+    void Solve(VecView b, MutableVecView x) const;
 
-inline Vec Vec::operator*(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    return {data * b.data};
-}
+    /**
+     * 条件数的粗略估计max|U(i, i)| / min|U(i, i)|，只需O(n)次运算。
+     * 不是严格的上界或下界，但病态矩阵的U对角元通常相差很多个数量级，足以区分良态与病态。调用前必须已经成功分解。
+     */
+    double ConditionEstimate() const noexcept;
 
-inline Vec Vec::operator/(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    return {data / b.data};
-}
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
 
-inline bool Vec::operator<(const Vec &b) noexcept {
-    assert(rows == b.rows);
-    return std::all_of(std::begin(data), std::end(data), [iter = std::begin(b.data)](auto val) mutable {
-        return val < *iter++;
-    });
-}
+    /**
+     * 方阵的阶数。
+     */
+    int Size() const noexcept;
 
-inline Vec operator*(double k, const Vec &v) {
-    return {v.data * k};
-}
+private:
+    int n = 0;
+    bool factored = false;
 
-inline double Dot(const Vec &a, const Vec &b) noexcept {
-    assert(a.rows == b.rows);
-    return (a.data * b.data).sum();
-}
+    // L和U按行连续存放在同一块内存中，L的对角线元素（均为1）不存储
+    std::vector<double> lu;
 
-inline std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept {
-    return out << mat.ToString();
-}
+    // pivots[k]表示第k步消元时与第k行交换的行号
+    std::vector<int> pivots;
+};
 
-} // namespace tomsolver
+/**
+ * 混合精度的方阵LU分解：以单精度分解A，求解时以双精度残差 r = b - Ax 反复修正（iterative refinement），
+ * 得到与双精度LU分解同等精度的解。分解的内存访问量和计算量约为双精度的一半。
+ * 修正停滞（A病态）、超过Config::Get().maxRefinementIterations次或单精度分解失败时，改用双精度分解A，
+ * 并在下一次Factor之前一直使用双精度分解。
+ * 工作空间的分配规则与LUFactorization相同。
+ */
+class MixedPrecisionLUFactorization {
+public:
+    MixedPrecisionLUFactorization() noexcept = default;
 
-namespace tomsolver {
+    /**
+     * 预先分配n阶方阵所需的工作空间。
+     */
+    explicit MixedPrecisionLUFactorization(int n);
 
-namespace {
-template <typename T>
-inline const T &asConst(T &a) {
-    return a;
-}
-} // namespace
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。A会被复制一份，用于计算双精度残差。
+     * @exception MathError 奇异矩阵（单精度和双精度分解都失败）
+     */
+    void Factor(MatView A);
 
-inline Vec SolveLinear(Mat A, Vec b) {
-    if (Config::Get().logLevel >= LogLevel::TRACE) {
-        std::cout << "SolveLinear:Ax=b (x is the wanted)\n";
-        std::cout << "A=\n" + A.ToString();
-        std::cout << "b=\n" + b.ToString();
-    }
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     * @exception MathError 修正停滞后双精度分解发现A奇异
+     */
+    Vec Solve(VecView b);
 
-    int rows = A.Rows(); // 行数
-    int cols = rows;     // 列数=未知数个数
+    /**
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * @exception MathError 修正停滞后双精度分解发现A奇异
+     */
+    void Solve(VecView b, MutableVecView x);
 
-    int RankA = rows, RankAb = rows; // 初始值
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
 
-    assert(rows == b.Rows()); // A行数不等于b行数
+    /**
+     * 返回是否已经退回双精度分解。
+     */
+    bool IsDoublePrecision() const noexcept;
 
-    Vec ret(rows);
+    /**
+     * 方阵的阶数。
+     */
+    int Size() const noexcept;
 
-    if (rows > 0) {
-        cols = A.Cols();
-    }
-    if (cols != rows) // 不是方阵
-    {
-        if (rows > cols) {
-            // 过定义方程组
-            throw MathError(ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
-        } else {
-            // 不定方程组
-            ret.Resize(cols);
-        }
-    }
+private:
+    int n = 0;
+    bool factored = false;
+    bool doublePrecision = false;
 
-    std::vector<int> TrueRowNumber(cols);
+    // A的副本，按行连续存放
+    std::vector<double> a;
 
-    // 列主元消元法
-    for (auto y = 0, x = 0; y < rows && x < cols; y++, x++) {
-        // if (A[i].size() != rows)
+    // A的无穷范数（行绝对值和的最大值）
+    double normA = 0;
 
-        // 从当前行(y)到最后一行(rows-1)中，找出x列最大的一行与y行交换
-        int maxAbsRowIndex = GetMaxAbsRowIndex(A, y, rows - 1, x);
-        A.SwapRow(y, maxAbsRowIndex);
-        b.SwapRow(y, maxAbsRowIndex);
+    // 单精度的LU分解结果，格式与LUFactorization相同
+    std::vector<float> luf;
+    std::vector<int> pivots;
 
-        while (std::abs(A.Value(y, x)) < Config::Get().epsilon) // 如果当前值为0  x一直递增到非0
-        {
-            x++;
-            if (x == cols) {
-                break;
-            }
+    // 修正过程中的工作空间：b的副本、残差、单精度的修正量
+    std::vector<double> rhs;
+    std::vector<double> r;
+    std::vector<float> d;
 
-            // 交换本行与最大行
-            maxAbsRowIndex = GetMaxAbsRowIndex(A, y, rows - 1, x);
-            A.SwapRow(y, maxAbsRowIndex);
-            b.SwapRow(y, maxAbsRowIndex);
-        }
+    // 双精度分解，仅在退回时使用
+    LUFactorization fallback;
 
-        if (x != cols && x > y) {
-            TrueRowNumber[y] = x; // 补齐方程时 当前行应换到x行
-        }
+    /**
+     * 用单精度分解结果迭代修正求解Ax = rhs，结果写入x。修正停滞时返回false。
+     */
+    bool Refine(MutableVecView x);
 
-        if (x == cols) // 本行全为0
-        {
-            RankA = y;
-            if (std::abs(b[y]) < Config::Get().epsilon) {
-                RankAb = y;
-            }
+    /**
+     * 退回双精度分解。
+     * @exception MathError 奇异矩阵
+     */
+    void FallBack();
+};
 
-            if (RankA != RankAb) {
-                // 奇异，且系数矩阵及增广矩阵秩不相等->无解
-                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
-            } else {
-                // 跳出for，得到特解
-                break;
-            }
-        }
+/**
+ * 列主元Householder QR分解，AP = QR。A为m×n矩阵，形状任意，可以秩亏。
+ * 用于求解最小二乘问题 min||Ax - b||：A列满秩时得到唯一的最小二乘解；
+ * A秩亏（包括m < n）时，再对R的前Rank()行做一次QR分解（完全正交分解），得到范数最小的最小二乘解。
+ * 工作空间的分配规则与LUFactorization相同。
+ */
+class QRFactorization {
+public:
+    QRFactorization() noexcept = default;
 
-        // 主对角线化为1
-        auto ratioY = A.Value(y, x);
-        // y行第j个->第cols个
-        std::valarray<double> rowY = asConst(A).Row(y, x) / ratioY;
-        A.Row(y, x) = rowY;
-        b[y] /= ratioY;
+    /**
+     * 构造并立即分解矩阵A。
+     */
+    explicit QRFactorization(MatView A);
 
-        // 每行化为0
-        for (auto row = y + 1; row < rows; row++) // 下1行->最后1行
-        {
-            auto ratioRow = A.Value(row, x);
-            if (std::abs(ratioRow) >= Config::Get().epsilon) {
-                A.Row(row, x) -= rowY * ratioRow;
-                b[row] -= b[y] * ratioRow;
-            }
-        }
-    }
-
-    bool bIndeterminateEquation = false; // 设置此变量是因为后面rows将=cols，标记以判断是否为不定方程组
-
-    // 若为不定方程组，空缺行全填0继续运算
-    if (rows != cols) {
-        A.Resize(cols, cols);
-        b.Resize(cols);
-        rows = cols;
-        bIndeterminateEquation = true;
-
-        // 调整顺序
-        for (int i = rows - 1; i >= 0; i--) {
-            if (TrueRowNumber[i] != 0) {
-                A.SwapRow(i, TrueRowNumber[i]);
-                b.SwapRow(i, TrueRowNumber[i]);
-            }
-        }
-    }
-
-    // 后置换得到x
-    for (int i = rows - 1; i >= 0; i--) // 最后1行->第1行
-    {
-        auto vec = asConst(A).Row(i, i + 1) * asConst(ret).Col(0, i + 1);
-        ret[i] = b[i] - (vec.size() ? vec.sum() : 0);
-    }
-
-    if (RankA < cols && RankA == RankAb) {
-        if (bIndeterminateEquation) {
-            if (!Config::Get().allowIndeterminateEquation) {
-                throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION,
-                                "A = " + A.ToString() + "\nb = " + b.ToString());
-            }
-        } else {
-            throw MathError(ErrorType::ERROR_INFINITY_SOLUTIONS);
-        }
-    }
-
-    return ret;
-}
-
-} // namespace tomsolver
-
-namespace tomsolver {
-
-template <typename T>
-inline Node sin(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_SIN, std::forward<T>(n));
-}
-
-template <typename T>
-inline Node cos(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_COS, std::forward<T>(n));
-}
-
-template <typename T>
-inline Node tan(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_TAN, std::forward<T>(n));
-}
+    /**
+     * 分解矩阵A。之前的分解结果将被覆盖。
+     * |R(k, k)| < Config::Get().epsilon * |R(0, 0)|的对角元视为0，据此确定A的秩。
+     */
+    void Factor(MatView A);
 
-template <typename T>
-inline Node asin(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_ARCSIN, std::forward<T>(n));
-}
+    /**
+     * 返回min||Ax - b||的解（秩亏时为其中范数最小的解）。b的长度为Rows()，返回值的长度为Cols()。
+     */
+    Vec Solve(VecView b) const;
 
-template <typename T>
-inline Node acos(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_ARCCOS, std::forward<T>(n));
-}
+    /**
+     * 同Solve(b)，结果写入x。x的长度必须等于Cols()，b和x不能指向同一块内存。
+     */
+    void Solve(VecView b, MutableVecView x) const;
 
-template <typename T>
-inline Node atan(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_ARCTAN, std::forward<T>(n));
-}
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
 
-template <typename T>
-inline Node sqrt(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_SQRT, std::forward<T>(n));
-}
+    /**
+     * 数值秩。
+     */
+    int Rank() const noexcept;
 
-template <typename T>
-inline Node log(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_LOG, std::forward<T>(n));
-}
+    int Rows() const noexcept;
 
-template <typename T>
-inline Node log2(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_LOG2, std::forward<T>(n));
-}
+    int Cols() const noexcept;
 
-template <typename T>
-inline Node log10(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_LOG10, std::forward<T>(n));
-}
+private:
+    int m = 0;
+    int n = 0;
+    int rank = 0;
+    bool factored = false;
 
-template <typename T>
-inline Node exp(T &&n) noexcept {
-    return internal::UnaryOperator(MathOperator::MATH_EXP, std::forward<T>(n));
-}
+    // m×n，按行存放。R位于上三角，Householder向量（首元素1不存储）位于对角线以下
+    std::vector<double> qr;
+    std::vector<double> tau;
 
-} // namespace tomsolver
+    // AP的第j列是A的第perm[j]列
+    std::vector<int> perm;
 
-namespace tomsolver {
+    // 秩亏时R的前rank行转置后（n×rank）的QR分解，格式与qr相同
+    std::vector<double> z;
+    std::vector<double> zTau;
 
-/**
- * node对varname求导。在node包含多个变量时，是对varname求偏导。
- * @exception runtime_error 如果表达式内包含AND(&) OR(|) MOD(%)这类不能求导的运算符，则抛出异常
- */
-inline Node Diff(const Node &node, const std::string &varname, int i = 1);
+    // 分解过程中的工作空间
+    std::vector<double> work;
+};
 
 /**
- * node对varname求导。在node包含多个变量时，是对varname求偏导。
- * @exception runtime_error 如果表达式内包含AND(&) OR(|) MOD(%)这类不能求导的运算符，则抛出异常
+ * 对称正定矩阵的Cholesky分解，A = LLᵀ。只使用A的下三角部分。
+ * 工作空间的分配规则与LUFactorization相同。
  */
-inline Node Diff(Node &&node, const std::string &varname, int i = 1);
-
-} // namespace tomsolver
-
-namespace tomsolver {
-
-class SymVec;
-class SymMat {
+class CholeskyFactorization {
 public:
-    /**
-     *
-     */
-    SymMat(int rows, int cols) noexcept;
+    CholeskyFactorization() noexcept = default;
 
     /**
-     * 使用初始化列表构造。注意列表内的对象将被强行移动至Vec内部。
+     * 预先分配n阶方阵所需的工作空间。
      */
-    SymMat(std::initializer_list<std::initializer_list<Node>> init) noexcept;
+    explicit CholeskyFactorization(int n);
 
     /**
-     * 从数值矩阵构造符号矩阵
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @return A是否正定。如果不是正定矩阵，分解失败，返回false
      */
-    SymMat(const Mat &rhs) noexcept;
-
-    SymMat Clone() const noexcept;
-
-    bool Empty() const noexcept;
-
-    int Rows() const noexcept;
-
-    int Cols() const noexcept;
+    bool Factor(MatView A) noexcept;
 
     /**
-     * 输出Vec。如果列数不为1，抛出异常。
-     * @exception runtime_error 列数不为1
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
      */
-    SymVec ToSymVec() const;
+    Vec Solve(VecView b) const;
 
     /**
-     * 逐个元素转换为符号向量（列向量）。
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * 不申请堆内存。
      */
-    SymVec ToSymVecOneByOne() const noexcept;
+    void Solve(VecView b, MutableVecView x) const;
 
     /**
-     * 得到数值矩阵。前提条件是矩阵内的元素均为数值节点，否则抛出异常。
-     * @exception runtime_error 存在非数值节点
+     * 返回是否已经有可用的分解结果。
      */
-    Mat ToMat() const;
+    bool IsFactored() const noexcept;
 
     /**
-     * 把矩阵的内的元素均计算为数值节点。
-     * @exception runtime_error 如果有变量存在，则无法计算
-     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
+     * 方阵的阶数。
      */
-    SymMat &Calc();
+    int Size() const noexcept;
 
-    SymMat &Subs(const std::map<std::string, double> &varValues) noexcept;
+private:
+    int n = 0;
+    bool factored = false;
 
-    SymMat &Subs(const VarsTable &varsTable) noexcept;
+    // L按行存放，只使用下三角部分
+    std::vector<double> l;
+};
 
-    /**
-     * 返回符号矩阵内出现的所有变量名。
-     */
-    std::set<std::string> GetAllVarNames() const noexcept;
+/**
+ * 矩阵的行列平衡（equilibration）：求对角矩阵R、C，使R·A·C每行、每列绝对值最大的元素都落在[1, 2)之间。
+ * 与LAPACK的dgeequ相同，先按行缩放，再对缩放后的矩阵按列缩放。缩放因子取2的整数次幂，缩放本身不引入舍入误差。
+ * 用于量纲差异很大的方程组：主元的绝对阈值Config::Get().epsilon对缩放后的矩阵才有意义。
+ * 全为0的行、列的缩放因子为1。
+ */
+class Equilibration {
+public:
+    Equilibration() noexcept = default;
 
     /**
-     * 如果rhs和自己的维数不匹配会触发assert。
+     * 构造并立即计算A的缩放因子。
      */
-    SymMat operator-(const SymMat &rhs) const noexcept;
+    explicit Equilibration(MatView A);
 
     /**
-     *
-     * @exception MathError 维数不匹配
+     * 计算A的缩放因子。之前的结果将被覆盖。
      */
-    SymMat operator*(const SymMat &rhs) const;
+    void Compute(MatView A);
 
     /**
-     * 返回是否相等。
-     * 目前只能判断表达式树完全一致的情况。
-     * TODO 改为可以判断等价表达式
+     * 将A原地替换为R·A·C。A的尺寸必须与计算缩放因子时的矩阵相同。
      */
-    bool operator==(const SymMat &rhs) const noexcept;
-
-    Node &Value(int i, int j) noexcept;
-    const Node &Value(int i, int j) const noexcept;
+    void Apply(Mat &A) const noexcept;
 
-    std::string ToString() const noexcept;
-
-protected:
-    int rows, cols;
-    std::unique_ptr<std::valarray<Node>> data;
-
-    friend SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept;
-};
-
-class SymVec : public SymMat {
-public:
     /**
-     *
+     * 行缩放因子，即R的对角元，长度为Rows()。
      */
-    SymVec(int rows) noexcept;
+    VecView RowScale() const noexcept;
 
     /**
-     * 使用初始化列表构造。注意列表内的对象将被强行移动至Vec内部。
+     * 列缩放因子，即C的对角元，长度为Cols()。
      */
-    SymVec(std::initializer_list<Node> init) noexcept;
+    VecView ColScale() const noexcept;
 
     /**
-     * 如果rhs和自己的维数不匹配会触发assert。
+     * 返回是否已经计算过缩放因子。
      */
-    SymVec operator-(const SymVec &rhs) const noexcept;
-
-    Node &operator[](std::size_t index) noexcept;
+    bool IsComputed() const noexcept;
 
-    const Node &operator[](std::size_t index) const noexcept;
-};
+    int Rows() const noexcept;
 
-inline SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept;
+    int Cols() const noexcept;
 
-inline std::ostream &operator<<(std::ostream &out, const SymMat &symMat) noexcept;
+private:
+    std::vector<double> r;
+    std::vector<double> c;
+};
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
-/**
- * 用newNode节点替换oldVar指定的变量。
- */
-inline Node Subs(const Node &node, const std::string &oldVar, const Node &newNode) noexcept;
-
-/**
- * 用newNode节点替换oldVar指定的变量。
- */
-inline Node Subs(Node &&node, const std::string &oldVar, const Node &newNode) noexcept;
+namespace {
 
 /**
- * 用newNodes节点替换oldVars指定的变量。
+ * 对m×n矩阵a（按行存放）原地做Householder QR分解，结果格式与QRFactorization相同。
+ * perm不为nullptr时选取剩余列中范数最大的一列作为主元列，perm返回列的排列。
+ * 变换按行访问a，对按行存放的矩阵是连续访存。
  */
-inline Node Subs(const Node &node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept;
+inline void HouseholderQR(double *a, int m, int n, double *tau, int *perm, std::vector<double> &work) {
+    int kMax = std::min(m, n);
+
+    // 各列剩余部分的范数平方、上一次重新计算时的范数平方、Householder变换的中间结果
+    work.assign(3 * n, 0);
+    double *norms = work.data(), *norms0 = norms + n, *w = norms + 2 * n;
+    if (perm) {
+        for (int j = 0; j < n; ++j) {
+            perm[j] = j;
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                norms[j] += a[i * n + j] * a[i * n + j];
+            }
+        }
+        std::copy_n(norms, n, norms0);
+    }
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(Node &&node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept;
+    for (int k = 0; k < kMax; ++k) {
+        double *rowK = a + k * n;
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(const Node &node, const std::map<std::string, Node> &dict) noexcept;
+        if (perm) {
+            int p = static_cast<int>(std::max_element(norms + k, norms + n) - norms);
+            if (p != k) {
+                for (int i = 0; i < m; ++i) {
+                    std::swap(a[i * n + k], a[i * n + p]);
+                }
+                std::swap(perm[k], perm[p]);
+                std::swap(norms[k], norms[p]);
+                std::swap(norms0[k], norms0[p]);
+            }
+        }
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(Node &&node, const std::map<std::string, Node> &dict) noexcept;
+        // 构造Householder变换 H = I - tau * v * vᵀ，使k列对角线以下的元素为0
+        double alpha = rowK[k];
+        double sigma = 0;
+        for (int i = k + 1; i < m; ++i) {
+            sigma += a[i * n + k] * a[i * n + k];
+        }
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(const Node &node, const std::map<std::string, double> &varValues) noexcept;
+        if (sigma == 0) {
+            tau[k] = 0;
+        } else {
+            double beta = -std::copysign(std::sqrt(alpha * alpha + sigma), alpha);
+            tau[k] = (beta - alpha) / beta;
+            double scale = 1 / (alpha - beta);
+            for (int i = k + 1; i < m; ++i) {
+                a[i * n + k] *= scale;
+            }
+            rowK[k] = beta;
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(Node &&node, const std::map<std::string, double> &varValues) noexcept;
+            // 右侧各列左乘H：w = tau * vᵀA，A -= v * w
+            for (int j = k + 1; j < n; ++j) {
+                w[j] = rowK[j];
+            }
+            for (int i = k + 1; i < m; ++i) {
+                const double *rowI = a + i * n;
+                double vi = rowI[k];
+                for (int j = k + 1; j < n; ++j) {
+                    w[j] += vi * rowI[j];
+                }
+            }
+            for (int j = k + 1; j < n; ++j) {
+                w[j] *= tau[k];
+                rowK[j] -= w[j];
+            }
+            for (int i = k + 1; i < m; ++i) {
+                double *rowI = a + i * n;
+                double vi = rowI[k];
+                for (int j = k + 1; j < n; ++j) {
+                    rowI[j] -= vi * w[j];
+                }
+            }
+        }
 
-/**
- * 用newNodes节点替换oldVars指定的变量。
- */
-inline Node Subs(const Node &node, const VarsTable &varsTable) noexcept;
+        if (perm) {
+            // 更新剩余部分的范数。相消过多时重新计算，避免舍入误差累积
+            for (int j = k + 1; j < n; ++j) {
+                norms[j] -= rowK[j] * rowK[j];
+                if (norms[j] <= 1.0e-6 * norms0[j]) {
+                    norms[j] = 0;
+                    for (int i = k + 1; i < m; ++i) {
+                        norms[j] += a[i * n + j] * a[i * n + j];
+                    }
+                    norms0[j] = norms[j];
+                }
+            }
+        }
+    }
+}
 
 /**
- * 用newNodes节点替换oldVars指定的变量。
+ * c = H(k)c，H(k)为HouseholderQR得到的第k个变换。
  */
-inline Node Subs(Node &&node, const VarsTable &varsTable) noexcept;
-
-} // namespace tomsolver
+inline void ApplyHouseholder(const double *a, int m, int n, const double *tau, int k, double *c) noexcept {
+    if (tau[k] == 0) {
+        return;
+    }
+    double s = c[k];
+    for (int i = k + 1; i < m; ++i) {
+        s += a[i * n + k] * c[i];
+    }
+    s *= tau[k];
+    c[k] -= s;
+    for (int i = k + 1; i < m; ++i) {
+        c[i] -= s * a[i * n + k];
+    }
+}
 
-namespace tomsolver {
+} // namespace
 
-namespace internal {
+inline Vec SolveLinear(Mat A, Vec b) {
+    if (Config::Get().logLevel >= LogLevel::TRACE) {
+        std::cout << "SolveLinear:Ax=b (x is the wanted)\n";
+        std::cout << "A=\n" + A.ToString();
+        std::cout << "b=\n" + b.ToString();
+    }
 
-class SubsFunctions {
-public:
-    // 前序遍历。非递归实现。
-    static Node SubsInner(Node node, const std::map<std::string, Node> &dict) noexcept {
+    int rows = A.Rows(); // 行数
+    int cols = rows;     // 列数=未知数个数
 
-        std::stack<std::reference_wrapper<NodeImpl>> stk;
+    int RankA = rows, RankAb = rows; // 初始值
 
-        auto Replace = [&dict](Node &cur) {
-            if (cur->type != NodeType::VARIABLE) {
-                return false;
-            }
+    assert(rows == b.Rows()); // A行数不等于b行数
 
-            auto itor = dict.find(cur->varname);
-            if (itor == dict.end()) {
-                return false;
+    if (rows > 0) {
+        cols = A.Cols();
+    }
+
+    // 过定义方程组：返回最小二乘解
+    if (rows > cols) {
+        return QRFactorization(A).Solve(b);
+    }
+
+    // 不定方程组：返回范数最小的解
+    if (rows < cols) {
+        if (!Config::Get().allowIndeterminateEquation) {
+            throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION, "A = " + A.ToString() + "\nb = " + b.ToString());
+        }
+
+        Vec ret = QRFactorization(A).Solve(b);
+
+        // 秩亏且最小二乘解不满足方程 -> 无解。残差的舍入误差与b的大小成正比，因此使用相对误差
+        double tol = Config::Get().epsilon * std::max(1.0, b.NormInfinity());
+        if (!((A * ret - b).NormInfinity() <= tol)) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        return ret;
+    }
+
+    // 方阵优先使用LU分解；如果奇异，再用下面的消元法判断是无解还是无穷多解
+    try {
+        return LUFactorization(A).Solve(b);
+    } catch (const MathError &err) {
+        if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+            throw;
+        }
+    }
+
+    Vec ret(rows);
+
+    // 列主元消元法
+    for (auto y = 0, x = 0; y < rows && x < cols; y++, x++) {
+        // 从当前行(y)到最后一行(rows-1)中，找出x列最大的一行与y行交换
+        int maxAbsRowIndex = GetMaxAbsRowIndex(A, y, rows - 1, x);
+        A.SwapRow(y, maxAbsRowIndex);
+        b.SwapRow(y, maxAbsRowIndex);
+
+        while (std::abs(A.Value(y, x)) < Config::Get().epsilon) // 如果当前值为0  x一直递增到非0
+        {
+            x++;
+            if (x == cols) {
+                break;
             }
 
-            auto parent = cur->parent;
-            cur = Clone(itor->second);
-            cur->parent = parent;
+            // 交换本行与最大行
+            maxAbsRowIndex = GetMaxAbsRowIndex(A, y, rows - 1, x);
+            A.SwapRow(y, maxAbsRowIndex);
+            b.SwapRow(y, maxAbsRowIndex);
+        }
 
-            return true;
-        };
+        if (x == cols) // 本行全为0
+        {
+            RankA = y;
+            if (std::abs(b[y]) < Config::Get().epsilon) {
+                RankAb = y;
+            }
 
-        if (!Replace(node)) {
-            auto TryReplace = [&stk, &Replace](Node &cur) {
-                if (cur && !Replace(cur)) {
-                    stk.emplace(*cur);
-                }
-            };
+            if (RankA != RankAb) {
+                // 奇异，且系数矩阵及增广矩阵秩不相等->无解
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+            } else {
+                // 跳出for，得到特解
+                break;
+            }
+        }
 
-            TryReplace(node->right);
-            TryReplace(node->left);
+        // 主对角线化为1
+        auto ratioY = A.Value(y, x);
+        // y行第j个->第cols个
+        double *rowY = std::addressof(A.Value(y, 0));
+        for (auto j = x; j < cols; j++) {
+            rowY[j] /= ratioY;
+        }
+        b[y] /= ratioY;
 
-            while (!stk.empty()) {
-                auto &f = stk.top().get();
-                stk.pop();
-                TryReplace(f.right);
-                TryReplace(f.left);
+        // 每行化为0
+        for (auto row = y + 1; row < rows; row++) // 下1行->最后1行
+        {
+            auto ratioRow = A.Value(row, x);
+            if (std::abs(ratioRow) >= Config::Get().epsilon) {
+                double *rowRow = std::addressof(A.Value(row, 0));
+                for (auto j = x; j < cols; j++) {
+                    rowRow[j] -= rowY[j] * ratioRow;
+                }
+                b[row] -= b[y] * ratioRow;
             }
         }
+    }
 
-#ifndef NDEBUG
-        node->CheckParent();
-#endif
-        return node;
+    if (RankA < cols && RankA == RankAb) {
+        throw MathError(ErrorType::ERROR_INFINITY_SOLUTIONS);
     }
-};
 
-} // namespace internal
+    // 后置换得到x
+    for (int i = rows - 1; i >= 0; i--) // 最后1行->第1行
+    {
+        ret[i] = b[i];
+        for (int j = i + 1; j < cols; j++) {
+            ret[i] -= A.Value(i, j) * ret[j];
+        }
+    }
 
-inline Node Subs(const Node &node, const std::string &oldVar, const Node &newNode) noexcept {
-    return Subs(Clone(node), oldVar, newNode);
+    return ret;
 }
 
-inline Node Subs(Node &&node, const std::string &oldVar, const Node &newNode) noexcept {
-    std::map<std::string, Node> dict;
-    dict.insert({oldVar, Clone(newNode)});
-    return internal::SubsFunctions::SubsInner(Move(node), dict);
+inline Vec SolveLinear(Mat A, Vec b, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return SolveLinear(std::move(A), std::move(b));
 }
 
-inline Node Subs(const Node &node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept {
-    return Subs(Clone(node), oldVars, newNodes);
+inline LUFactorization::LUFactorization(int n) : n(n), lu(n * n), pivots(n) {
+    assert(n > 0);
 }
 
-inline Node Subs(Node &&node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept {
-    assert(static_cast<int>(oldVars.size()) == newNodes.Rows());
-    std::map<std::string, Node> dict;
-    for (size_t i = 0; i < oldVars.size(); ++i) {
-        dict.insert({oldVars[i], Clone(newNodes[i])});
-    }
-    return internal::SubsFunctions::SubsInner(Move(node), dict);
+inline LUFactorization::LUFactorization(MatView A) {
+    Factor(A);
 }
 
-inline Node Subs(const Node &node, const std::map<std::string, Node> &dict) noexcept {
-    return Subs(Clone(node), dict);
+inline void LUFactorization::Factor(const Mat &A) {
+    Factor(MatView(A));
 }
 
-inline Node Subs(Node &&node, const std::map<std::string, Node> &dict) noexcept {
-    return internal::SubsFunctions::SubsInner(Move(node), dict);
+inline void LUFactorization::Factor(MatView A) {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    n = A.Rows();
+    lu.resize(n * n);
+    pivots.resize(n);
+    if (A.IsContiguous()) {
+        std::copy_n(A.Data(), n * n, lu.data());
+    } else {
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                lu[i * n + j] = A.Value(i, j);
+            }
+        }
+    }
+
+    internal::LUFactorInPlace(lu.data(), n, pivots.data());
+
+    factored = true;
 }
 
-inline Node Subs(const Node &node, const std::map<std::string, double> &varValues) noexcept {
-    return Subs(Clone(node), varValues);
+inline Vec LUFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
 }
 
-inline Node Subs(Node &&node, const std::map<std::string, double> &varValues) noexcept {
-    std::map<std::string, Node> dict;
-    for (auto &item : varValues) {
-        dict.insert({item.first, Num(item.second)});
+inline void LUFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
+
+    if (b.Data() != x.Data()) {
+        x = b;
     }
-    return internal::SubsFunctions::SubsInner(Move(node), dict);
-}
 
-inline Node Subs(const Node &node, const VarsTable &varsTable) noexcept {
-    return Subs(Clone(node), varsTable);
+    internal::LUSolveInPlace(lu.data(), pivots.data(), n, x);
 }
 
-inline Node Subs(Node &&node, const VarsTable &varsTable) noexcept {
-    std::map<std::string, Node> dict;
-    for (auto &item : varsTable) {
-        dict.insert({item.first, Num(item.second)});
+inline double LUFactorization::ConditionEstimate() const noexcept {
+    assert(factored);
+    double maxAbs = 0, minAbs = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        double v = std::abs(lu[i * n + i]);
+        maxAbs = std::max(maxAbs, v);
+        minAbs = std::min(minAbs, v);
     }
-    return internal::SubsFunctions::SubsInner(Move(node), dict);
+    return maxAbs / minAbs;
 }
 
-} // namespace tomsolver
+inline bool LUFactorization::IsFactored() const noexcept {
+    return factored;
+}
 
-namespace tomsolver {
+inline int LUFactorization::Size() const noexcept {
+    return n;
+}
 
-inline void Simplify(Node &node) noexcept;
+inline MixedPrecisionLUFactorization::MixedPrecisionLUFactorization(int n)
+    : n(n), a(n * n), luf(n * n), pivots(n), rhs(n), r(n), d(n), fallback(n) {
+    assert(n > 0);
+}
+
+inline void MixedPrecisionLUFactorization::Factor(MatView A) {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    doublePrecision = false;
+    n = A.Rows();
+    a.resize(n * n);
+    luf.resize(n * n);
+    pivots.resize(n);
+    rhs.resize(n);
+    r.resize(n);
+    d.resize(n);
+
+    normA = 0;
+    for (int i = 0; i < n; ++i) {
+        double rowSum = 0;
+        for (int j = 0; j < n; ++j) {
+            double v = A.Value(i, j);
+            a[i * n + j] = v;
+            luf[i * n + j] = static_cast<float>(v);
+            rowSum += std::abs(v);
+        }
+        normA = std::max(normA, rowSum);
+    }
 
-} // namespace tomsolver
+    try {
+        internal::LUFactorInPlace(luf.data(), n, pivots.data());
+    } catch (const MathError &err) {
+        if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+            throw;
+        }
 
-namespace tomsolver {
+        // 单精度下奇异（主元下溢等），不一定是A本身奇异
+        FallBack();
+    }
 
-namespace internal {
+    factored = true;
+}
 
-class SimplifyFunctions {
-public:
-    struct SimplifyNode {
-        NodeImpl &node;
-        bool isLeftChild;
+inline Vec MixedPrecisionLUFactorization::Solve(VecView b) {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
 
-        SimplifyNode(NodeImpl &node) : node(node), isLeftChild(!node.parent || node.parent->left.get() == &node) {}
-    };
+inline void MixedPrecisionLUFactorization::Solve(VecView b, MutableVecView x) {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
 
-    // 对单节点n进行化简。
-    static void SimplifySingleNode(std::unique_ptr<NodeImpl> &n) noexcept {
-        auto parent = n->parent;
-        switch (GetOperatorNum(n->op)) {
-        // 对于1元运算符，且儿子是数字的，直接计算出来
-        case 1:
-            if (n->left->type == NodeType::NUMBER) {
-                n->type = NodeType::NUMBER;
-                n->value = tomsolver::Calc(n->op, n->left->value, 0);
-                n->op = MathOperator::MATH_NULL;
-                n->left = nullptr;
-            }
-            break;
+    if (doublePrecision) {
+        fallback.Solve(b, x);
+        return;
+    }
 
-        // 对于2元运算符
-        case 2:
-            // 儿子是数字的，直接计算出来
-            if (n->left->type == NodeType::NUMBER && n->right->type == NodeType::NUMBER) {
-                n->type = NodeType::NUMBER;
-                n->value = tomsolver::Calc(n->op, n->left->value, n->right->value);
-                n->op = MathOperator::MATH_NULL;
-                n->left = nullptr;
-                n->right = nullptr;
-                return;
-            }
+    // b和x可能指向同一块内存，修正过程中每一步都要用到b
+    MutableVecView(rhs.data(), n) = b;
+    if (!Refine(x)) {
+        FallBack();
+        fallback.Solve(VecView(rhs.data(), n), x);
+    }
+}
 
-            assert(n->left && n->right);
-            bool lChildIs0 = n->left->type == NodeType::NUMBER && n->left->value == 0.0;
-            bool rChildIs0 = n->right->type == NodeType::NUMBER && n->right->value == 0.0;
-            bool lChildIs1 = n->left->type == NodeType::NUMBER && n->left->value == 1.0;
-            bool rChildIs1 = n->right->type == NodeType::NUMBER && n->right->value == 1.0;
+inline bool MixedPrecisionLUFactorization::Refine(MutableVecView x) {
+    // 初始解：单精度求解
+    for (int i = 0; i < n; ++i) {
+        d[i] = static_cast<float>(rhs[i]);
+    }
+    internal::LUSolveInPlace(luf.data(), pivots.data(), n, d.data());
+    for (int i = 0; i < n; ++i) {
+        x[i] = d[i];
+    }
 
-            // 任何数乘或被乘0、被0除、0的除0外的任何次方，等于0
-            if ((n->op == MathOperator::MATH_MULTIPLY && (lChildIs0 || rChildIs0)) ||
-                (n->op == MathOperator::MATH_DIVIDE && lChildIs0) || (n->op == MathOperator::MATH_POWER && lChildIs0)) {
-                n = Num(0);
-                n->parent = parent;
-                return;
+    // 残差小于双精度舍入误差的量级时认为收敛
+    double tol = normA * std::numeric_limits<double>::epsilon() * std::sqrt(static_cast<double>(n));
+    double lastCorrection = std::numeric_limits<double>::infinity();
+    for (int it = 0;; ++it) {
+        // r = b - Ax，以双精度计算
+        double normR = 0, normX = 0;
+        for (int i = 0; i < n; ++i) {
+            const double *rowI = a.data() + i * n;
+            double v = rhs[i];
+            if (x.IsContiguous()) {
+                v -= internal::Dot(n, rowI, x.Data());
+            } else {
+                for (int j = 0; j < n; ++j) {
+                    v -= rowI[j] * x[j];
+                }
             }
+            r[i] = v;
+            normR = std::max(normR, std::abs(v));
+            normX = std::max(normX, std::abs(x[i]));
+        }
 
-            // 任何数加或被加0、被减0、乘或被乘1、被1除、开1次方，等于自身
-            if ((n->op == MathOperator::MATH_ADD && (lChildIs0 || rChildIs0)) ||
-                (n->op == MathOperator::MATH_SUB && rChildIs0) ||
-                (n->op == MathOperator::MATH_MULTIPLY && (lChildIs1 || rChildIs1)) ||
-                (n->op == MathOperator::MATH_DIVIDE && rChildIs1) || (n->op == MathOperator::MATH_POWER && rChildIs1)) {
+        if (normR <= tol * normX) {
+            return true;
+        }
 
-                if (lChildIs1 || lChildIs0) {
-                    n->left = nullptr;
-                    n = Move(n->right);
-                    n->parent = parent;
-                } else if (rChildIs1 || rChildIs0) {
-                    n->right = nullptr;
-                    n = Move(n->left);
-                    n->parent = parent;
-                }
-                return;
-            }
+        if (it == Config::Get().maxRefinementIterations) {
+            return false;
         }
-    }
 
-    // 后序遍历。非递归实现。
-    static void SimplifyWholeNode(Node &node) {
+        // 单精度求解修正量 Ad = r
+        for (int i = 0; i < n; ++i) {
+            d[i] = static_cast<float>(r[i]);
+        }
+        internal::LUSolveInPlace(luf.data(), pivots.data(), n, d.data());
 
-        // 借助一个栈，得到反向的后序遍历序列，结果保存在revertedPostOrder。除了root节点，root节点不保存在revertedPostOrder里，最后单独化简。
-        std::stack<SimplifyNode> stk;
-        std::deque<SimplifyNode> revertedPostOrder;
+        double correction = 0;
+        for (int i = 0; i < n; ++i) {
+            correction = std::max(correction, std::abs(static_cast<double>(d[i])));
+        }
 
-        auto popNode = [&stk] {
-            auto node = std::move(stk.top());
-            stk.pop();
-            return node;
-        };
+        // 修正量没有明显缩小（或出现nan），说明A相对单精度过于病态
+        if (!(correction <= 0.5 * lastCorrection)) {
+            return false;
+        }
+        lastCorrection = correction;
 
-        // ==== Part I ====
+        for (int i = 0; i < n; ++i) {
+            x[i] += d[i];
+        }
+    }
+}
 
-        if (node->type != NodeType::OPERATOR) {
-            return;
+inline void MixedPrecisionLUFactorization::FallBack() {
+    fallback.Factor(MatView(a.data(), n, n));
+    doublePrecision = true;
+}
+
+inline bool MixedPrecisionLUFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+inline bool MixedPrecisionLUFactorization::IsDoublePrecision() const noexcept {
+    return doublePrecision;
+}
+
+inline int MixedPrecisionLUFactorization::Size() const noexcept {
+    return n;
+}
+
+inline QRFactorization::QRFactorization(MatView A) {
+    Factor(A);
+}
+
+inline void QRFactorization::Factor(MatView A) {
+    factored = false;
+    m = A.Rows();
+    n = A.Cols();
+    int kMax = std::min(m, n);
+    qr.resize(m * n);
+    tau.resize(kMax);
+    perm.resize(n);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            qr[i * n + j] = A.Value(i, j);
         }
+    }
 
-        stk.push(SimplifyNode(*node.get()));
+    HouseholderQR(qr.data(), m, n, tau.data(), perm.data(), work);
 
-        while (!stk.empty()) {
-            auto f = popNode();
+    // 列主元保证|R(k, k)|大致递减。空矩阵的秩为0
+    double r00 = kMax > 0 ? std::abs(qr[0]) : 0;
+    rank = 0;
+    while (rank < kMax && std::abs(qr[rank * n + rank]) > Config::Get().epsilon * r00) {
+        ++rank;
+    }
 
-            if (f.node.left && f.node.left->type == NodeType::OPERATOR) {
-                stk.push(SimplifyNode(*f.node.left.get()));
+    // 秩亏：R的前rank行 [R11 R12] = Lᵀ Zᵀ，其中 [R11 R12]ᵀ = Z L
+    if (rank < n) {
+        z.assign(n * rank, 0);
+        zTau.resize(rank);
+        for (int i = 0; i < rank; ++i) {
+            for (int j = i; j < n; ++j) {
+                z[j * rank + i] = qr[i * n + j];
             }
+        }
+        HouseholderQR(z.data(), n, rank, zTau.data(), nullptr, work);
+    }
 
-            if (f.node.right && f.node.right->type == NodeType::OPERATOR) {
-                stk.push(SimplifyNode(*f.node.right.get()));
+    factored = true;
+}
+
+inline Vec QRFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
+
+inline void QRFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == m);
+    assert(x.Size() == n);
+
+    // c = Qᵀb
+    Vec c(b);
+    double *pc = c.Data();
+    for (int k = 0; k < std::min(m, n); ++k) {
+        ApplyHouseholder(qr.data(), m, n, tau.data(), k, pc);
+    }
+
+    Vec u(n);
+    double *pu = u.Data();
+    if (rank == n) {
+        // 回代：Ru = c
+        for (int i = n - 1; i >= 0; --i) {
+            const double *rowI = qr.data() + i * n;
+            double v = pc[i];
+            for (int j = i + 1; j < n; ++j) {
+                v -= rowI[j] * pu[j];
+            }
+            pu[i] = v / rowI[i];
+        }
+    } else {
+        // 前代：Lᵀy = c，u = Z[y; 0]即为范数最小的解
+        for (int i = 0; i < rank; ++i) {
+            double v = pc[i];
+            for (int j = 0; j < i; ++j) {
+                v -= z[j * rank + i] * pu[j];
             }
+            pu[i] = v / z[i * rank + i];
+        }
+        for (int k = rank - 1; k >= 0; --k) {
+            ApplyHouseholder(z.data(), n, rank, zTau.data(), k, pu);
+        }
+    }
 
-            revertedPostOrder.emplace_back(std::move(f));
+    for (int j = 0; j < n; ++j) {
+        x[perm[j]] = pu[j];
+    }
+}
+
+inline bool QRFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+inline int QRFactorization::Rank() const noexcept {
+    return rank;
+}
+
+inline int QRFactorization::Rows() const noexcept {
+    return m;
+}
+
+inline int QRFactorization::Cols() const noexcept {
+    return n;
+}
+
+inline CholeskyFactorization::CholeskyFactorization(int n) : n(n), l(n * n) {
+    assert(n > 0);
+}
+
+inline bool CholeskyFactorization::Factor(MatView A) noexcept {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    n = A.Rows();
+    l.resize(n * n);
+
+    for (int j = 0; j < n; ++j) {
+        double *rowJ = l.data() + j * n;
+
+        // 对角线元素
+        double d = A.Value(j, j);
+        for (int k = 0; k < j; ++k) {
+            d -= rowJ[k] * rowJ[k];
+        }
+        if (!(d > 0)) {
+            return false;
+        }
+        rowJ[j] = std::sqrt(d);
+
+        // j列对角线以下的元素
+        for (int i = j + 1; i < n; ++i) {
+            double *rowI = l.data() + i * n;
+            double v = A.Value(i, j);
+            for (int k = 0; k < j; ++k) {
+                v -= rowI[k] * rowJ[k];
+            }
+            rowI[j] = v / rowJ[j];
         }
+    }
 
-        // pop掉root，root最后单独处理
-        revertedPostOrder.pop_front();
+    factored = true;
+    return true;
+}
 
-        // ==== Part II ====
-        std::for_each(revertedPostOrder.rbegin(), revertedPostOrder.rend(), [](SimplifyNode &snode) {
-            SimplifySingleNode(snode.isLeftChild ? snode.node.parent->left : snode.node.parent->right);
-        });
+inline Vec CholeskyFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
 
-        SimplifyFunctions::SimplifySingleNode(node);
+inline void CholeskyFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
 
-        return;
+    if (b.Data() != x.Data()) {
+        x = b;
+    }
 
-        // if (GetOperateNum(now->eOperator) == 2) {
+    // 前代：Ly = b
+    for (int i = 0; i < n; ++i) {
+        const double *rowI = l.data() + i * n;
+        double v = x[i];
+        for (int j = 0; j < i; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v / rowI[i];
+    }
 
-        //    //任何节点的0次方均等于1，除了0的0次方已在前面报错
-        //    if (now->eOperator == MATH_POWER && RChildIs0) {
-        //        //替换掉当前运算符，这个1节点将在回溯时处理
-        //        //新建一个1节点
-        //        TNode *temp;
-        //        temp = new TNode;
-        //        temp->eType = NODE_NUMBER;
-        //        temp->value = 1;
+    // 回代：Lᵀx = y
+    for (int i = n - 1; i >= 0; --i) {
+        double v = x[i];
+        for (int j = i + 1; j < n; ++j) {
+            v -= l[j * n + i] * x[j];
+        }
+        x[i] = v / l[i * n + i];
+    }
+}
 
-        //        // 0节点连接到上面
-        //        if (now != head) {
-        //            if (now->parent->left == now) {
-        //                now->parent->left = temp;
-        //                temp->parent = now->parent;
-        //            }
-        //            if (now->parent->right == now) {
-        //                now->parent->right = temp;
-        //                temp->parent = now->parent;
-        //            }
-        //        } else
-        //            head = temp;
+inline bool CholeskyFactorization::IsFactored() const noexcept {
+    return factored;
+}
 
-        //        DeleteNode(now);
-        //    }
+inline int CholeskyFactorization::Size() const noexcept {
+    return n;
+}
 
-        //    // 0-x=-x
-        //    if (now->eOperator == MATH_SUB && LChildIs0) {
-        //        TNode *LChild = now->left;
-        //        TNode *RChild = now->right;
-        //        now->eOperator = MATH_NEGATIVE;
-        //        now->left = RChild;
-        //        now->right = NULL;
+namespace {
 
-        //        delete LChild;
-        //    }
+/**
+ * 返回2的整数次幂s，使v * s落在[1, 2)之间。v为0时返回1。
+ */
+inline double PowerOfTwoScale(double v) noexcept {
+    if (v == 0) {
+        return 1;
+    }
+    int e;
+    std::frexp(v, &e);
+    return std::ldexp(1.0, 1 - e);
+}
 
-        //}
+} // namespace
+
+inline Equilibration::Equilibration(MatView A) {
+    Compute(A);
+}
+
+inline void Equilibration::Compute(MatView A) {
+    int m = A.Rows(), n = A.Cols();
+    r.assign(m, 0);
+    c.assign(n, 0);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            r[i] = std::max(r[i], std::abs(A.Value(i, j)));
+        }
+        r[i] = PowerOfTwoScale(r[i]);
+    }
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            c[j] = std::max(c[j], std::abs(r[i] * A.Value(i, j)));
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        c[j] = PowerOfTwoScale(c[j]);
+    }
+}
+
+inline void Equilibration::Apply(Mat &A) const noexcept {
+    assert(A.Rows() == Rows());
+    assert(A.Cols() == Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        for (int j = 0; j < A.Cols(); ++j) {
+            A.Value(i, j) *= r[i] * c[j];
+        }
+    }
+}
+
+inline VecView Equilibration::RowScale() const noexcept {
+    assert(IsComputed());
+    return {r.data(), Rows()};
+}
+
+inline VecView Equilibration::ColScale() const noexcept {
+    assert(IsComputed());
+    return {c.data(), Cols()};
+}
+
+inline bool Equilibration::IsComputed() const noexcept {
+    return !r.empty();
+}
+
+inline int Equilibration::Rows() const noexcept {
+    return static_cast<int>(r.size());
+}
+
+inline int Equilibration::Cols() const noexcept {
+    return static_cast<int>(c.size());
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 求解非线性方程组时，沿方向d的回溯一维搜索。
+ * 评价函数为φ(α) = ||f(x + αd)||² / 2。φ(0)与φ'(0)由调用者给出（通常在求方向时已经算好），
+ * 搜索过程中只计算试探点处的f，不再重复计算f(x)和雅可比矩阵。
+ * 工作空间在构造时分配，之后每次搜索都不申请堆内存。
+ */
+class LineSearch {
+public:
+    /**
+     * 每次搜索最多计算f的次数。
+     */
+    static constexpr int MAX_BACKTRACKING = 40;
+
+    /**
+     * Armijo条件φ(α) ≤ φ(0) + cαφ'(0)中的c。
+     */
+    static constexpr double SUFFICIENT_DECREASE = 1.0e-4;
+
+    /**
+     * @param n: 未知数数量，即x的长度
+     * @param m: 方程数量，即f(x)的长度
+     */
+    LineSearch(int n, int m);
+
+    /**
+     * 从α = 1开始回溯，直到满足Armijo条件。
+     * ARMIJO每次把α减半；CUBIC用φ(0)、φ'(0)和最近两次试探的φ做二次/三次插值，新的α限制在[0.1α, 0.5α]内。
+     * 试探点处f抛出浮点数无效值的MathError，或者φ不是有限值时，视为步长过大，把α减半后继续。
+     * @param f: 计算方程组的值，形如void(VecView x, Vec &out)，out的长度为m
+     * @param phi0: φ(0)
+     * @param dphi0: φ'(0)，即f(x)ᵀJd，必须小于0
+     * @return 是否在MAX_BACKTRACKING次以内找到满足条件的α。成功时由Alpha()、X()、F()取得结果
+     */
+    template <typename Func>
+    bool Search(LineSearchMethod method, VecView x, VecView d, double phi0, double dphi0, Func &&f) {
+        assert(method != LineSearchMethod::NONE);
+        assert(x.Size() == xNew.Rows() && d.Size() == xNew.Rows());
+        double a = 1;
+        double prevAlpha = 0; // 上一次结果有限的试探，0表示没有
+        double prevPhi = 0;
+        for (evaluations = 0; evaluations < MAX_BACKTRACKING;) {
+            ScaledAdd(x, a, d, xNew);
+            double phi = EvalPhi(f);
+            ++evaluations;
+            if (phi <= phi0 + SUFFICIENT_DECREASE * a * dphi0) {
+                alpha = a;
+                return true;
+            }
+
+            if (method == LineSearchMethod::CUBIC && std::isfinite(phi)) {
+                double next = Interpolate(a, phi, prevAlpha, prevPhi, phi0, dphi0);
+                prevAlpha = a;
+                prevPhi = phi;
+                a = next;
+            } else {
+                a *= 0.5;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 最近一次成功搜索得到的步长α。
+     */
+    double Alpha() const noexcept;
+
+    /**
+     * 最近一次成功搜索得到的点x + αd。
+     */
+    const Vec &X() const noexcept;
+
+    /**
+     * f(X())。
+     */
+    const Vec &F() const noexcept;
+
+    /**
+     * 最近一次搜索计算f的次数。
+     */
+    int Evaluations() const noexcept;
+
+private:
+    Vec xNew;
+    Vec fNew;
+    double alpha = 0;
+    int evaluations = 0;
+
+    template <typename Func>
+    double EvalPhi(Func &f) {
+        try {
+            f(VecView(xNew), fNew);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                throw;
+            }
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return fNew.Norm2() / 2;
     }
+
+    /**
+     * 以φ(0)、φ'(0)、φ(a)（以及φ(prevAlpha)，prevAlpha不为0时）拟合多项式，返回其极小点，限制在[0.1a, 0.5a]内。
+     */
+    static double Interpolate(double a, double phi, double prevAlpha, double prevPhi, double phi0,
+                              double dphi0) noexcept;
 };
 
-} // namespace internal
+} // namespace tomsolver
 
-inline void Simplify(Node &node) noexcept {
-    internal::SimplifyFunctions::SimplifyWholeNode(node);
-    return;
+namespace tomsolver {
+
+inline LineSearch::LineSearch(int n, int m) : xNew(n), fNew(m) {}
+
+inline double LineSearch::Alpha() const noexcept {
+    return alpha;
+}
+
+inline const Vec &LineSearch::X() const noexcept {
+    return xNew;
+}
+
+inline const Vec &LineSearch::F() const noexcept {
+    return fNew;
+}
+
+inline int LineSearch::Evaluations() const noexcept {
+    return evaluations;
+}
+
+inline double LineSearch::Interpolate(double a, double phi, double prevAlpha, double prevPhi, double phi0,
+                                      double dphi0) noexcept {
+    // 去掉φ(0) + φ'(0)α之后的余项
+    double r = phi - phi0 - dphi0 * a;
+    double t;
+    if (prevAlpha == 0) {
+        // 二次插值：φ(0) + φ'(0)α + (r / a²)α²
+        t = -dphi0 * a * a / (2 * r);
+    } else {
+        // 三次插值：φ(0) + φ'(0)α + bα² + cα³
+        double prevR = prevPhi - phi0 - dphi0 * prevAlpha;
+        double c = (r / (a * a) - prevR / (prevAlpha * prevAlpha)) / (a - prevAlpha);
+        double b = (-prevAlpha * r / (a * a) + a * prevR / (prevAlpha * prevAlpha)) / (a - prevAlpha);
+        if (c == 0) {
+            t = -dphi0 / (2 * b);
+        } else {
+            double disc = b * b - 3 * c * dphi0;
+            t = disc >= 0 ? (-b + std::sqrt(disc)) / (3 * c) : 0.5 * a;
+        }
+    }
+
+    if (!std::isfinite(t)) {
+        return 0.5 * a;
+    }
+    return std::min(std::max(t, 0.1 * a), 0.5 * a);
 }
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
-namespace internal {
+/**
+ * 尺寸在编译期确定的N×M矩阵。数据按行连续存放在对象内部（栈上），构造、复制和运算都不申请堆内存。
+ * 用于2×2～6×6这类小规模方程组：循环次数都是编译期常量，编译器可以完全展开。
+ * FixedMat之间的+、-和数乘结果仍是FixedMat；与Mat/Vec/视图混合运算时结果为Mat。
+ * FixedMat也是矩阵表达式，视图等表达式可以直接赋值给FixedMat。
+ */
+template <int N, int M>
+class FixedMat : public MatExpr<FixedMat<N, M>> {
+    static_assert(N > 0 && M > 0, "FixedMat size must be positive");
 
-class StringView {
 public:
-    constexpr StringView() noexcept = default;
-    constexpr StringView(const char *str, size_t len) noexcept : str{str}, len{len} {}
-    constexpr StringView(const char *str) noexcept : str{str} {
-        while (*str++) {
-            len++;
+    FixedMat() noexcept : data{} {}
+
+    explicit FixedMat(double initValue) noexcept {
+        data.fill(initValue);
+    }
+
+    FixedMat(std::initializer_list<std::initializer_list<double>> init) noexcept : data{} {
+        assert(static_cast<int>(init.size()) == N);
+        int i = 0;
+        for (auto &row : init) {
+            assert(static_cast<int>(row.size()) <= M);
+            std::copy(row.begin(), row.end(), data.begin() + i * M);
+            ++i;
         }
     }
-    StringView(const std::string &str) noexcept : StringView{str.data(), str.size()} {}
-    constexpr StringView(const StringView &) noexcept = default;
-    constexpr StringView &operator=(const StringView &) noexcept = default;
 
-    constexpr auto begin() const noexcept {
-        return str;
+    /**
+     * 按行连续存储的顺序给出全部元素。主要用于FixedVec。
+     */
+    FixedMat(std::initializer_list<double> init) noexcept : data{} {
+        assert(static_cast<int>(init.size()) == N * M);
+        std::copy(init.begin(), init.end(), data.begin());
     }
-    constexpr auto end() const noexcept {
-        return str + len;
+
+    explicit FixedMat(const Mat &mat) noexcept : FixedMat(MatView(mat)) {}
+
+    /**
+     * 对表达式求值。表达式的尺寸必须是N×M。
+     */
+    template <typename E>
+    FixedMat(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == N);
+        assert(expr.Cols() == M);
+        expr.EvalTo(data.data());
     }
-    constexpr auto empty() const noexcept {
-        return !len;
+
+    template <typename E>
+    FixedMat &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == N);
+        assert(expr.Cols() == M);
+        expr.EvalTo(data.data());
+        return *this;
     }
 
-    auto toString() const noexcept {
-        return std::string{begin(), end()};
+    static constexpr int Rows() noexcept {
+        return N;
     }
 
-    template <typename Stream>
-    friend Stream &operator<<(Stream &s, const internal::StringView &sv) {
-        s.rdbuf()->sputn(sv.str, sv.len);
+    static constexpr int Cols() noexcept {
+        return M;
+    }
+
+    double Value(int i, int j) const noexcept {
+        return data[i * M + j];
+    }
+
+    double &Value(int i, int j) noexcept {
+        return data[i * M + j];
+    }
+
+    /**
+     * 按行连续存储的顺序访问第i个元素。对FixedVec即为第i个分量。
+     */
+    double operator[](int i) const noexcept {
+        return data[i];
+    }
+
+    double &operator[](int i) noexcept {
+        return data[i];
+    }
+
+    double Coeff(int i) const noexcept {
+        return data[i];
+    }
+
+    const double *Data() const noexcept {
+        return data.data();
+    }
+
+    double *Data() noexcept {
+        return data.data();
+    }
+
+    FixedMat &operator+=(const FixedMat &b) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] += b.data[i];
+        }
+        return *this;
+    }
+
+    FixedMat &operator-=(const FixedMat &b) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] -= b.data[i];
+        }
+        return *this;
+    }
+
+    FixedMat &operator*=(double k) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] *= k;
+        }
+        return *this;
+    }
+
+    FixedMat<M, N> Transpose() const noexcept {
+        FixedMat<M, N> ans;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < M; ++j) {
+                ans.Value(j, i) = Value(i, j);
+            }
+        }
+        return ans;
+    }
+
+    bool operator==(const FixedMat &b) const noexcept {
+        double eps = Config::Get().epsilon;
+        for (int i = 0; i < N * M; ++i) {
+            if (!(std::abs(data[i] - b.data[i]) < eps)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 返回是否所有元素的绝对值都小于Config::Get().epsilon。
+     */
+    bool operator==(double m) const noexcept {
+        double eps = Config::Get().epsilon;
+        for (int i = 0; i < N * M; ++i) {
+            if (!(std::abs(data[i] - m) < eps)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Mat ToMat() const noexcept {
+        return Mat(*this);
+    }
+
+private:
+    std::array<double, N * M> data;
+};
+
+template <int N>
+using FixedVec = FixedMat<N, 1>;
+
+template <int N, int M>
+inline FixedMat<N, M> operator+(FixedMat<N, M> a, const FixedMat<N, M> &b) noexcept {
+    a += b;
+    return a;
+}
+
+template <int N, int M>
+inline FixedMat<N, M> operator-(FixedMat<N, M> a, const FixedMat<N, M> &b) noexcept {
+    a -= b;
+    return a;
+}
+
+template <int N, int M>
+inline FixedMat<N, M> operator*(FixedMat<N, M> m, double k) noexcept {
+    m *= k;
+    return m;
+}
+
+template <int N, int M>
+inline FixedMat<N, M> operator*(double k, FixedMat<N, M> m) noexcept {
+    m *= k;
+    return m;
+}
+
+// be negative
+template <int N, int M>
+inline FixedMat<N, M> operator-(FixedMat<N, M> m) noexcept {
+    m *= -1;
+    return m;
+}
+
+/**
+ * 矩阵乘法。
+ */
+template <int N, int M, int K>
+inline FixedMat<N, K> operator*(const FixedMat<N, M> &a, const FixedMat<M, K> &b) noexcept {
+    FixedMat<N, K> ans;
+    for (int i = 0; i < N; ++i) {
+        for (int p = 0; p < M; ++p) {
+            double v = a.Value(i, p);
+            for (int j = 0; j < K; ++j) {
+                ans.Value(i, j) += v * b.Value(p, j);
+            }
+        }
+    }
+    return ans;
+}
+
+template <int N, int M>
+inline std::ostream &operator<<(std::ostream &out, const FixedMat<N, M> &mat) noexcept {
+    return out << mat.ToMat();
+}
+
+/**
+ * N阶方阵的LU分解（列主元），PA = LU。分解结果原地存放在FixedMat中，不申请堆内存。
+ */
+template <int N>
+class FixedLUFactorization {
+public:
+    FixedLUFactorization() noexcept = default;
+
+    /**
+     * 构造并立即分解方阵A。
+     * @exception MathError 奇异矩阵
+     */
+    explicit FixedLUFactorization(const FixedMat<N, N> &A) {
+        Factor(A);
+    }
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(const FixedMat<N, N> &A) {
+        factored = false;
+        lu = A;
+        double eps = Config::Get().epsilon;
+        for (int k = 0; k < N; ++k) {
+            int maxAbsRowIndex = k;
+            double maxAbs = std::abs(lu.Value(k, k));
+            for (int i = k + 1; i < N; ++i) {
+                if (std::abs(lu.Value(i, k)) > maxAbs) {
+                    maxAbs = std::abs(lu.Value(i, k));
+                    maxAbsRowIndex = i;
+                }
+            }
+
+            pivots[k] = maxAbsRowIndex;
+            if (maxAbs < eps) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+            }
+
+            if (maxAbsRowIndex != k) {
+                for (int j = 0; j < N; ++j) {
+                    std::swap(lu.Value(k, j), lu.Value(maxAbsRowIndex, j));
+                }
+            }
+
+            double pivot = lu.Value(k, k);
+            for (int i = k + 1; i < N; ++i) {
+                double ratio = lu.Value(i, k) /= pivot;
+                for (int j = k + 1; j < N; ++j) {
+                    lu.Value(i, j) -= ratio * lu.Value(k, j);
+                }
+            }
+        }
+        factored = true;
+    }
+
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     */
+    FixedVec<N> Solve(FixedVec<N> b) const noexcept {
+        assert(factored);
+        for (int k = 0; k < N; ++k) {
+            std::swap(b[k], b[pivots[k]]);
+        }
+        for (int i = 1; i < N; ++i) {
+            for (int j = 0; j < i; ++j) {
+                b[i] -= lu.Value(i, j) * b[j];
+            }
+        }
+        for (int i = N - 1; i >= 0; --i) {
+            for (int j = i + 1; j < N; ++j) {
+                b[i] -= lu.Value(i, j) * b[j];
+            }
+            b[i] /= lu.Value(i, i);
+        }
+        return b;
+    }
+
+    bool IsFactored() const noexcept {
+        return factored;
+    }
+
+private:
+    bool factored = false;
+    FixedMat<N, N> lu;
+    std::array<int, N> pivots{};
+};
+
+namespace internal {
+
+/**
+ * 按N选择求解方法：一般情况使用LU分解，一元、二元的情况使用闭式解。
+ */
+template <int N>
+struct FixedLinearSolver {
+    static FixedVec<N> Solve(const FixedMat<N, N> &A, const FixedVec<N> &b) {
+        return FixedLUFactorization<N>(A).Solve(b);
+    }
+};
+
+template <>
+struct FixedLinearSolver<1> {
+    static FixedVec<1> Solve(const FixedMat<1, 1> &A, const FixedVec<1> &b) {
+        if (std::abs(A[0]) < Config::Get().epsilon) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        return {b[0] / A[0]};
+    }
+};
+
+/**
+ * 克莱姆法则。奇异判断与列主元LU分解一致：det / maxAbs即为消元后的第二个主元。
+ */
+template <>
+struct FixedLinearSolver<2> {
+    static FixedVec<2> Solve(const FixedMat<2, 2> &A, const FixedVec<2> &b) {
+        double a = A.Value(0, 0), c = A.Value(1, 0);
+        double maxAbs = std::max(std::abs(a), std::abs(c));
+        double det = a * A.Value(1, 1) - A.Value(0, 1) * c;
+        double eps = Config::Get().epsilon;
+        if (maxAbs < eps || std::abs(det) < eps * maxAbs) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        return {(b[0] * A.Value(1, 1) - A.Value(0, 1) * b[1]) / det, (a * b[1] - c * b[0]) / det};
+    }
+};
+
+} // namespace internal
+
+/**
+ * 求解N元线性方程组Ax = b。N在编译期确定，不申请堆内存：一元、二元直接求闭式解，其余使用展开的LU分解。
+ * @exception MathError 奇异矩阵
+ */
+template <int N>
+inline FixedVec<N> SolveLinear(const FixedMat<N, N> &A, const FixedVec<N> &b) {
+    return internal::FixedLinearSolver<N>::Solve(A, b);
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 非线性迭代的收敛判断与失败检测，供各个求解器共用。
+ * 收敛条件（满足其一即可）：
+ *  - 残差：||F||∞ < Config::Get().epsilon，或||F||∞ ≤ Config::Get().relativeTolerance·||F0||∞，F0为初值处的残差；
+ *  - 步长：||Δq|| ≤ Config::Get().stepTolerance·(||q|| + Config::Get().stepTolerance)。
+ * 失败检测（默认关闭）：
+ *  - 发散：||F||∞ > Config::Get().divergenceRatio·||F0||∞；
+ *  - 停滞：连续Config::Get().stagnationIterations次迭代，||F||∞都没有比之前的最小值下降STAGNATION_DECREASE以上。
+ * 失败时抛出MathError，调用者可以据此尽早放弃没有希望的初值，而不是一直迭代到Config::Get().maxIterations。
+ */
+class ConvergenceMonitor {
+public:
+    /**
+     * 判断停滞时，||F||∞相对于之前最小值的最小下降比例。
+     */
+    static constexpr double STAGNATION_DECREASE = 1.0e-3;
+
+    ConvergenceMonitor() noexcept = default;
+
+    /**
+     * 记录第it次迭代的残差F，返回是否满足残差收敛条件。第一次调用时的F即为F0。
+     * 未收敛时检测发散与停滞，应在计算下一步之前调用。
+     * @exception MathError 发散(ERROR_DIVERGENCE)、停滞(ERROR_STAGNATION)或被取消(ERROR_CANCELLED)
+     */
+    bool Check(int it, VecView F);
+
+    /**
+     * 步长是否满足收敛条件。stepNorm为这一步的||Δq||，qNorm为走完这一步之后的||q||。stepTolerance为0时总是返回false。
+     */
+    bool StepConverged(double stepNorm, double qNorm) const noexcept;
+
+    /**
+     * 设置取消标志。之后每次调用Check时，如果*cancelled为true，抛出ERROR_CANCELLED，用于从其他线程中止求解。
+     * 为nullptr时不检查。
+     */
+    void SetCancelFlag(const std::atomic<bool> *cancelled) noexcept;
+
+    /**
+     * 残差的收敛阈值，即max(epsilon, relativeTolerance·||F0||∞)。第一次调用Check之后有效。
+     */
+    double Tolerance() const noexcept;
+
+private:
+    const std::atomic<bool> *cancelled = nullptr;
+    bool started = false;
+    double F0Norm = 0;
+    double tolerance = 0;
+    double best = 0;   // 目前为止||F||∞的最小值
+    int sinceBest = 0; // best上一次明显下降之后的迭代次数
+};
+
+/**
+ * 无穷范数max|v[i]|。存在nan时返回nan。
+ */
+inline double InfNorm(VecView v) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline bool ConvergenceMonitor::Check(int it, VecView F) {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+        throw MathError(ErrorType::ERROR_CANCELLED, "iteration " + std::to_string(it));
+    }
+
+    double FNorm = InfNorm(F);
+    if (!started) {
+        started = true;
+        F0Norm = best = FNorm;
+        tolerance = std::max(Config::Get().epsilon, Config::Get().relativeTolerance * F0Norm);
+    }
+
+    if (FNorm < Config::Get().epsilon || FNorm <= Config::Get().relativeTolerance * F0Norm) {
+        return true;
+    }
+
+    double divergenceRatio = Config::Get().divergenceRatio;
+    if (divergenceRatio > 0 && !(FNorm <= divergenceRatio * F0Norm)) {
+        std::stringstream ss;
+        ss << "iteration " << it << ", ||F|| = " << FNorm << ", initial ||F|| = " << F0Norm;
+        throw MathError(ErrorType::ERROR_DIVERGENCE, ss.str());
+    }
+
+    if (FNorm < (1 - STAGNATION_DECREASE) * best) {
+        best = FNorm;
+        sinceBest = 0;
+        return false;
+    }
+    best = std::min(best, FNorm);
+    ++sinceBest;
+
+    int stagnationIterations = Config::Get().stagnationIterations;
+    if (stagnationIterations > 0 && sinceBest >= stagnationIterations) {
+        std::stringstream ss;
+        ss << "iteration " << it << ", ||F|| = " << FNorm << ", no progress in " << sinceBest << " iterations";
+        throw MathError(ErrorType::ERROR_STAGNATION, ss.str());
+    }
+    return false;
+}
+
+inline bool ConvergenceMonitor::StepConverged(double stepNorm, double qNorm) const noexcept {
+    double stepTolerance = Config::Get().stepTolerance;
+    return stepTolerance > 0 && stepNorm <= stepTolerance * (qNorm + stepTolerance);
+}
+
+inline void ConvergenceMonitor::SetCancelFlag(const std::atomic<bool> *cancelled) noexcept {
+    this->cancelled = cancelled;
+}
+
+inline double ConvergenceMonitor::Tolerance() const noexcept {
+    return tolerance;
+}
+
+inline double InfNorm(VecView v) noexcept {
+    double ret = 0;
+    for (int i = 0; i < v.Size(); ++i) {
+        double a = std::abs(v[i]);
+        if (std::isnan(a)) {
+            return a;
+        }
+        ret = std::max(ret, a);
+    }
+    return ret;
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 变量表。
+ * 内部保存了多个变量名及其数值的对应关系。
+ */
+class VarsTable {
+public:
+    /**
+     * 新建变量表。
+     * @param vars 变量数组
+     * @param initValue 初值
+     */
+    VarsTable(const std::vector<std::string> &vars, double initValue);
+
+    /**
+     * 新建变量表。
+     * @param vars 变量数组
+     * @param initValues 各变量的初值，长度必须与vars相同。可以是Vec，也可以是指向调用者内存的VecView
+     */
+    VarsTable(const std::vector<std::string> &vars, VecView initValues);
+
+    /**
+     * 新建变量表。
+     * @param vars 变量数组
+     * @param initValue 初值
+     */
+    explicit VarsTable(std::initializer_list<std::pair<std::string, double>> initList);
+
+    /**
+     * 新建变量表。
+     * @param vars 变量数组
+     * @param initValue 初值
+     */
+    explicit VarsTable(const std::map<std::string, double> &table) noexcept;
+
+    /**
+     * 变量数量。
+     */
+    int VarNums() const noexcept;
+
+    /**
+     * 返回std::vector容器包装的变量名数组。
+     */
+    const std::vector<std::string> &Vars() const noexcept;
+
+    /**
+     * 返回所有变量名对应的值的数值向量。
+     */
+    const Vec &Values() const noexcept;
+
+    /**
+     * 设置数值向量。v可以是Vec，也可以是指向调用者内存的VecView，不会申请堆内存。
+     */
+    void SetValues(VecView v) noexcept;
+
+    /**
+     * 返回是否有指定的变量。
+     */
+    bool Has(const std::string &varname) const noexcept;
+
+    std::string ToString() const noexcept;
+
+    std::map<std::string, double>::const_iterator begin() const noexcept;
+
+    std::map<std::string, double>::const_iterator end() const noexcept;
+
+    std::map<std::string, double>::const_iterator cbegin() const noexcept;
+
+    std::map<std::string, double>::const_iterator cend() const noexcept;
+
+    bool operator==(const VarsTable &rhs) const noexcept;
+
+    /**
+     * 根据变量名获取数值。
+     * @exception out_of_range 如果没有这个变量，抛出异常
+     */
+    double operator[](const std::string &varname) const;
+
+private:
+    std::vector<std::string> vars;
+    Vec values;
+    std::map<std::string, double> table;
+};
+
+inline std::ostream &operator<<(std::ostream &out, const VarsTable &table) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline VarsTable::VarsTable(const std::vector<std::string> &vars, double initValue)
+    : vars(vars), values(static_cast<int>(vars.size()), initValue) {
+    for (auto &var : vars) {
+        table.insert({var, initValue});
+    }
+    assert(vars.size() == table.size() && "vars is not unique");
+}
+
+inline VarsTable::VarsTable(const std::vector<std::string> &vars, VecView initValues)
+    : vars(vars), values(initValues) {
+    assert(static_cast<int>(vars.size()) == initValues.Size());
+    for (int i = 0; i < values.Rows(); ++i) {
+        table.insert({vars[i], values[i]});
+    }
+    assert(vars.size() == table.size() && "vars is not unique");
+}
+
+inline VarsTable::VarsTable(std::initializer_list<std::pair<std::string, double>> initList)
+    : VarsTable({initList.begin(), initList.end()}) {
+    assert(vars.size() == table.size() && "vars is not unique");
+}
+
+inline VarsTable::VarsTable(const std::map<std::string, double> &table) noexcept
+    : vars(table.size()), values(static_cast<int>(table.size())), table(table) {
+    int i = 0;
+    for (auto &item : table) {
+        vars[i] = item.first;
+        values[i] = item.second;
+        ++i;
+    }
+}
+
+inline int VarsTable::VarNums() const noexcept {
+    return static_cast<int>(table.size());
+}
+
+inline const std::vector<std::string> &VarsTable::Vars() const noexcept {
+    return vars;
+}
+
+inline const Vec &VarsTable::Values() const noexcept {
+    return values;
+}
+
+inline void VarsTable::SetValues(VecView v) noexcept {
+    assert(v.Rows() == values.Rows());
+    values = v;
+    for (int i = 0; i < values.Rows(); ++i) {
+        table[vars[i]] = v[i];
+    }
+}
+
+inline bool VarsTable::Has(const std::string &varname) const noexcept {
+    return table.find(varname) != table.end();
+}
+
+inline std::string VarsTable::ToString() const noexcept {
+    std::string ret;
+    for (auto &item : table) {
+        ret += item.first + " = " + tomsolver::ToString(item.second) + "\n";
+    }
+    return ret;
+}
+
+inline std::map<std::string, double>::const_iterator VarsTable::begin() const noexcept {
+    return table.begin();
+}
+
+inline std::map<std::string, double>::const_iterator VarsTable::end() const noexcept {
+    return table.end();
+}
+
+inline std::map<std::string, double>::const_iterator VarsTable::cbegin() const noexcept {
+    return table.cbegin();
+}
+
+inline std::map<std::string, double>::const_iterator VarsTable::cend() const noexcept {
+    return table.cend();
+}
+
+inline bool VarsTable::operator==(const VarsTable &rhs) const noexcept {
+    return values.Rows() == rhs.values.Rows() &&
+           std::equal(table.begin(), table.end(), rhs.table.begin(), [](const auto &lhs, const auto &rhs) {
+               auto &lVar = lhs.first;
+               auto &lVal = lhs.second;
+               auto &rVar = rhs.first;
+               auto &rVal = rhs.second;
+               return lVar == rVar && std::abs(lVal - rVal) <= Config::Get().epsilon;
+           });
+}
+
+inline double VarsTable::operator[](const std::string &varname) const {
+    auto it = table.find(varname);
+    if (it == table.end()) {
+        throw std::out_of_range("no such variable: " + varname);
+    }
+    return it->second;
+}
+
+inline std::ostream &operator<<(std::ostream &out, const VarsTable &table) noexcept {
+    out << table.ToString();
+    return out;
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 压缩稀疏行（CSR）格式的稀疏矩阵，只存放非零元。矩阵与向量相乘的计算量为O(nnz)。
+ * 用于大规模线性方程组的迭代求解，见krylov.h。
+ */
+class SparseMat {
+public:
+    /**
+     * 非零元(row, col)的值为value。
+     */
+    struct Triplet {
+        int row;
+        int col;
+        double value;
+    };
+
+    /**
+     * 由三元组构造rows×cols的稀疏矩阵。三元组的顺序任意，同一位置出现多次时累加。
+     */
+    SparseMat(int rows, int cols, const std::vector<Triplet> &triplets);
+
+    /**
+     * 由稠密矩阵构造，只保留不为0的元素。
+     */
+    explicit SparseMat(MatView mat);
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+    /**
+     * 存放的非零元数量。
+     */
+    int NonZeros() const noexcept;
+
+    /**
+     * 元素(i, j)，不是非零元时返回0。每行内二分查找。
+     */
+    double Value(int i, int j) const noexcept;
+
+    /**
+     * out = A·v。v的长度为Cols()，out的长度为Rows()，不申请堆内存。
+     */
+    void Multiply(VecView v, MutableVecView out) const noexcept;
+
+    /**
+     * out = Aᵀ·v。v的长度为Rows()，out的长度为Cols()，不申请堆内存。
+     */
+    void TransposeMultiply(VecView v, MutableVecView out) const noexcept;
+
+    Mat ToMat() const;
+
+    /**
+     * 第i行的非零元为下标[RowPointers()[i], RowPointers()[i + 1])的元素，长度为Rows() + 1。
+     */
+    const std::vector<int> &RowPointers() const noexcept;
+
+    /**
+     * 非零元的列号，每行内从小到大排列。
+     */
+    const std::vector<int> &ColIndices() const noexcept;
+
+    /**
+     * 非零元的值，与ColIndices()一一对应。
+     */
+    const std::vector<double> &Values() const noexcept;
+
+private:
+    int rows;
+    int cols;
+    std::vector<int> rowPtr;
+    std::vector<int> colIndex;
+    std::vector<double> values;
+};
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline SparseMat::SparseMat(int rows, int cols, const std::vector<Triplet> &triplets)
+    : rows(rows), cols(cols), rowPtr(rows + 1) {
+    assert(rows > 0 && cols > 0);
+
+    std::vector<Triplet> sorted(triplets);
+    std::sort(sorted.begin(), sorted.end(), [](const Triplet &a, const Triplet &b) {
+        return a.row < b.row || (a.row == b.row && a.col < b.col);
+    });
+
+    colIndex.reserve(sorted.size());
+    values.reserve(sorted.size());
+    for (std::size_t k = 0; k < sorted.size(); ++k) {
+        const Triplet &t = sorted[k];
+        assert(t.row >= 0 && t.row < rows);
+        assert(t.col >= 0 && t.col < cols);
+        if (k > 0 && t.row == sorted[k - 1].row && t.col == sorted[k - 1].col) {
+            values.back() += t.value;
+            continue;
+        }
+        colIndex.push_back(t.col);
+        values.push_back(t.value);
+        ++rowPtr[t.row + 1];
+    }
+    for (int i = 0; i < rows; ++i) {
+        rowPtr[i + 1] += rowPtr[i];
+    }
+}
+
+inline SparseMat::SparseMat(MatView mat) : rows(mat.Rows()), cols(mat.Cols()), rowPtr(mat.Rows() + 1) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            if (mat.Value(i, j) != 0) {
+                colIndex.push_back(j);
+                values.push_back(mat.Value(i, j));
+            }
+        }
+        rowPtr[i + 1] = static_cast<int>(values.size());
+    }
+}
+
+inline int SparseMat::Rows() const noexcept {
+    return rows;
+}
+
+inline int SparseMat::Cols() const noexcept {
+    return cols;
+}
+
+inline int SparseMat::NonZeros() const noexcept {
+    return static_cast<int>(values.size());
+}
+
+inline double SparseMat::Value(int i, int j) const noexcept {
+    assert(i >= 0 && i < rows);
+    auto begin = colIndex.begin() + rowPtr[i];
+    auto end = colIndex.begin() + rowPtr[i + 1];
+    auto it = std::lower_bound(begin, end, j);
+    if (it == end || *it != j) {
+        return 0;
+    }
+    return values[it - colIndex.begin()];
+}
+
+inline void SparseMat::Multiply(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == cols);
+    assert(out.Size() == rows);
+    for (int i = 0; i < rows; ++i) {
+        double sum = 0;
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            sum += values[k] * v[colIndex[k]];
+        }
+        out[i] = sum;
+    }
+}
+
+inline void SparseMat::TransposeMultiply(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == rows);
+    assert(out.Size() == cols);
+    for (int j = 0; j < cols; ++j) {
+        out[j] = 0;
+    }
+    for (int i = 0; i < rows; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            out[colIndex[k]] += values[k] * v[i];
+        }
+    }
+}
+
+inline Mat SparseMat::ToMat() const {
+    Mat ret(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            ret.Value(i, colIndex[k]) = values[k];
+        }
+    }
+    return ret;
+}
+
+inline const std::vector<int> &SparseMat::RowPointers() const noexcept {
+    return rowPtr;
+}
+
+inline const std::vector<int> &SparseMat::ColIndices() const noexcept {
+    return colIndex;
+}
+
+inline const std::vector<double> &SparseMat::Values() const noexcept {
+    return values;
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+enum class NodeType { NUMBER, OPERATOR, VARIABLE };
+
+// 前置声明
+namespace internal {
+struct NodeImpl;
+}
+class SymMat;
+
+/**
+ * 表达式节点。
+ */
+using Node = std::unique_ptr<internal::NodeImpl>;
+
+namespace internal {
+
+/**
+ * 单个节点的实现。通常应该以std::unique_ptr包裹。
+ */
+struct NodeImpl {
+
+    NodeImpl(NodeType type, MathOperator op, double value, std::string varname) noexcept;
+
+    NodeImpl(const NodeImpl &rhs) noexcept;
+    NodeImpl &operator=(const NodeImpl &rhs) noexcept;
+
+    NodeImpl(NodeImpl &&rhs) noexcept;
+    NodeImpl &operator=(NodeImpl &&rhs) noexcept;
+
+    ~NodeImpl();
+
+    bool Equal(const Node &rhs) const noexcept;
+
+    /**
+     * 把整个节点以中序遍历的顺序输出为字符串。
+     * 例如：
+     *      Node n = (Var("a") + Num(1)) * Var("b");
+     *   则
+     *      n->ToString() == "(a+1.000000)*b"
+     */
+    std::string ToString() const noexcept;
+
+    /**
+     * 计算出整个表达式的数值。不改变自身。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
+     */
+    double Vpa() const;
+
+    /**
+     * 以options代替Config::Get()计算出整个表达式的数值。不改变自身。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且options.throwOnInvalidValue为true
+     */
+    double Vpa(const SolverOptions &options) const;
+
+    /**
+     * 计算出整个表达式的数值。不改变自身。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
+     */
+    NodeImpl &Calc();
+
+    /**
+     * 返回表达式内出现的所有变量名。
+     */
+    std::set<std::string> GetAllVarNames() const noexcept;
+
+    /**
+     * 检查整个节点数的parent指针是否正确。
+     */
+    void CheckParent() const noexcept;
+
+private:
+    std::string varname;
+    double value;
+    MathOperator op = MathOperator::MATH_NULL;
+    NodeType type = NodeType::NUMBER;
+    NodeImpl *parent = nullptr;
+    Node left, right;
+    NodeImpl() = default;
+
+    /**
+     * 本节点如果是OPERATOR，检查操作数数量和left, right指针是否匹配。
+     */
+    void CheckOperatorNum() const noexcept;
+
+    /**
+     * 节点转string。仅限本节点，不含子节点。
+     */
+    std::string NodeToStr() const noexcept;
+
+    void ToStringRecursively(std::stringstream &output) const noexcept;
+
+    void ToStringNonRecursively(std::stringstream &output) const noexcept;
+
+    /**
+     * 计算表达式数值。递归实现。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 不符合定义域, 除0等情况。
+     */
+    double VpaRecursively() const;
+
+    /**
+     * 计算表达式数值。非递归实现。
+     * 性能弱于递归实现。但不会导致栈溢出。
+     * 根据benchmark，生成一组含4000个随机四则运算节点的表达式，生成1000次，Release下测试耗时3000ms。递归实现耗时2500ms。
+     * 粗略计算，即 1333 ops/ms。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 不符合定义域, 除0等情况。
+     */
+    double VpaNonRecursively() const;
+
+    /**
+     * 释放整个节点树，除了自己。
+     * 实际是二叉树的非递归后序遍历。
+     */
+    void Release() noexcept;
+
+    friend Node Operator(MathOperator op, Node left, Node right) noexcept;
+
+    friend Node CloneRecursively(const Node &rhs) noexcept;
+    friend Node CloneNonRecursively(const Node &rhs) noexcept;
+
+    friend void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept;
+    friend void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept;
+
+    friend std::ostream &operator<<(std::ostream &out, const Node &n) noexcept;
+
+    template <typename T>
+    friend Node UnaryOperator(MathOperator op, T &&n) noexcept;
+
+    template <typename T1, typename T2>
+    friend Node BinaryOperator(MathOperator op, T1 &&n1, T2 &&n2) noexcept;
+
+    friend class tomsolver::SymMat;
+    friend class SimplifyFunctions;
+    friend class DiffFunctions;
+    friend class SubsFunctions;
+    friend class ParseFunctions;
+    friend class CompileFunctions;
+};
+
+inline Node CloneRecursively(const Node &rhs) noexcept;
+
+inline Node CloneNonRecursively(const Node &rhs) noexcept;
+
+/**
+ * 对于一个节点n和另一个节点n1，把n1移动到作为n的子节点。
+ * 用法：CopyOrMoveTo(n->parent, n->left, std::forward<T>(n1));
+ */
+inline void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept;
+
+/**
+ * 对于一个节点n和另一个节点n1，把n1整个拷贝一份，把拷贝的副本设为n的子节点。
+ * 用法：CopyOrMoveTo(n->parent, n->left, std::forward<T>(n1));
+ */
+inline void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept;
+
+/**
+ * 重载std::ostream的<<操作符以输出一个Node节点。
+ */
+inline std::ostream &operator<<(std::ostream &out, const Node &n) noexcept;
+
+template <typename T>
+inline Node UnaryOperator(MathOperator op, T &&n) noexcept {
+    auto ret = std::make_unique<NodeImpl>(NodeType::OPERATOR, op, 0, "");
+    CopyOrMoveTo(ret.get(), ret->left, std::forward<T>(n));
+    return ret;
+}
+
+template <typename T1, typename T2>
+inline Node BinaryOperator(MathOperator op, T1 &&n1, T2 &&n2) noexcept {
+    auto ret = std::make_unique<NodeImpl>(NodeType::OPERATOR, op, 0, "");
+    CopyOrMoveTo(ret.get(), ret->left, std::forward<T1>(n1));
+    CopyOrMoveTo(ret.get(), ret->right, std::forward<T2>(n2));
+    return ret;
+}
+
+/**
+ * 新建一个运算符节点。
+ */
+inline Node Operator(MathOperator op, Node left = nullptr, Node right = nullptr) noexcept;
+
+} // namespace internal
+
+inline Node Clone(const Node &rhs) noexcept;
+
+/**
+ * 对节点进行移动。等同于std::move。
+ */
+inline Node Move(Node &rhs) noexcept;
+
+/**
+ * 新建一个数值节点。
+ */
+inline Node Num(double num) noexcept;
+
+/**
+ * 新建一个函数节点。
+ */
+inline Node Op(MathOperator op);
+
+/**
+ * 返回变量名是否有效。（只支持英文数字或者下划线，第一个字符必须是英文或者下划线）
+ */
+inline bool VarNameIsLegal(const std::string &varname) noexcept;
+
+/**
+ * 新建一个变量节点。
+ * @exception runtime_error 名字不合法
+ */
+inline Node Var(std::string varname);
+
+template <typename...>
+struct SfinaeNodeImpl : std::false_type {};
+
+template <>
+struct SfinaeNodeImpl<Node> : std::true_type {};
+
+template <>
+struct SfinaeNodeImpl<Node, Node> : std::true_type {};
+
+template <typename... T>
+using SfinaeNode = std::enable_if_t<SfinaeNodeImpl<std::decay_t<T>...>::value, Node>;
+
+template <typename T1, typename T2>
+inline SfinaeNode<T1, T2> operator+(T1 &&n1, T2 &&n2) noexcept {
+    return internal::BinaryOperator(MathOperator::MATH_ADD, std::forward<T1>(n1), std::forward<T2>(n2));
+}
+
+template <typename T>
+inline SfinaeNode<T> &operator+=(Node &n1, T &&n2) noexcept {
+    n1 = internal::BinaryOperator(MathOperator::MATH_ADD, std::move(n1), std::forward<T>(n2));
+    return n1;
+}
+
+template <typename T1, typename T2>
+inline SfinaeNode<T1, T2> operator-(T1 &&n1, T2 &&n2) noexcept {
+    return internal::BinaryOperator(MathOperator::MATH_SUB, std::forward<T1>(n1), std::forward<T2>(n2));
+}
+
+template <typename T>
+inline SfinaeNode<T> operator-(T &&n1) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_NEGATIVE, std::forward<T>(n1));
+}
+
+template <typename T>
+inline SfinaeNode<T> operator+(T &&n1) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_POSITIVE, std::forward<T>(n1));
+}
+
+template <typename T>
+inline SfinaeNode<T> &operator-=(Node &n1, T &&n2) noexcept {
+    n1 = internal::BinaryOperator(MathOperator::MATH_SUB, std::move(n1), std::forward<T>(n2));
+    return n1;
+}
+
+template <typename T1, typename T2>
+inline SfinaeNode<T1, T2> operator*(T1 &&n1, T2 &&n2) noexcept {
+    return internal::BinaryOperator(MathOperator::MATH_MULTIPLY, std::forward<T1>(n1), std::forward<T2>(n2));
+}
+
+template <typename T>
+inline SfinaeNode<T> &operator*=(Node &n1, T &&n2) noexcept {
+    n1 = internal::BinaryOperator(MathOperator::MATH_MULTIPLY, std::move(n1), std::forward<T>(n2));
+    return n1;
+}
+
+template <typename T1, typename T2>
+inline SfinaeNode<T1, T2> operator/(T1 &&n1, T2 &&n2) noexcept {
+    return internal::BinaryOperator(MathOperator::MATH_DIVIDE, std::forward<T1>(n1), std::forward<T2>(n2));
+}
+
+template <typename T>
+inline SfinaeNode<T> &operator/=(Node &n1, T &&n2) noexcept {
+    n1 = internal::BinaryOperator(MathOperator::MATH_DIVIDE, std::move(n1), std::forward<T>(n2));
+    return n1;
+}
+
+template <typename T1, typename T2>
+inline SfinaeNode<T1, T2> operator^(T1 &&n1, T2 &&n2) noexcept {
+    return internal::BinaryOperator(MathOperator::MATH_POWER, std::forward<T1>(n1), std::forward<T2>(n2));
+}
+
+template <typename T>
+inline SfinaeNode<T> &operator^=(Node &n1, T &&n2) noexcept {
+    n1 = internal::BinaryOperator(MathOperator::MATH_POWER, std::move(n1), std::forward<T>(n2));
+    return n1;
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace internal {
+
+inline NodeImpl::NodeImpl(NodeType type, MathOperator op, double value, std::string varname) noexcept
+    : varname(varname), value(value), op(op), type(type), parent(nullptr) {
+    switch (type) {
+    case NodeType::NUMBER:
+        assert(op == MathOperator::MATH_NULL && varname == "");
+        break;
+    case NodeType::OPERATOR:
+        assert(op != MathOperator::MATH_NULL && varname == "");
+        break;
+    case NodeType::VARIABLE:
+        assert(op == MathOperator::MATH_NULL);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+inline NodeImpl::NodeImpl(const NodeImpl &rhs) noexcept {
+    *this = rhs;
+}
+
+inline NodeImpl &NodeImpl::operator=(const NodeImpl &rhs) noexcept {
+    type = rhs.type;
+    op = rhs.op;
+    value = rhs.value;
+    varname = rhs.varname;
+    parent = rhs.parent;
+    if (rhs.left) {
+        left = Clone(rhs.left);
+        left->parent = this;
+    } else {
+        left = nullptr;
+    }
+    if (rhs.right) {
+        right = Clone(rhs.right);
+        right->parent = this;
+    } else {
+        right = nullptr;
+    }
+    return *this;
+}
+
+inline NodeImpl::NodeImpl(NodeImpl &&rhs) noexcept {
+    *this = std::move(rhs);
+}
+
+inline NodeImpl &NodeImpl::operator=(NodeImpl &&rhs) noexcept {
+    type = std::exchange(rhs.type, {});
+    op = std::exchange(rhs.op, {});
+    value = std::exchange(rhs.value, {});
+    varname = std::exchange(rhs.varname, {});
+    parent = std::exchange(rhs.parent, {});
+    left = std::exchange(rhs.left, {});
+    if (left) {
+        left->parent = this;
+    }
+    right = std::exchange(rhs.right, {});
+    if (right) {
+        right->parent = this;
+    }
+
+    return *this;
+}
+
+inline NodeImpl::~NodeImpl() {
+    Release();
+}
+
+// 前序遍历。非递归实现。
+inline bool NodeImpl::Equal(const Node &other) const noexcept {
+    if (this == other.get()) {
+        return true;
+    }
+
+    std::stack<std::tuple<const NodeImpl &, const NodeImpl &>> stk;
+
+    auto tie = [](const NodeImpl &node) {
+        return std::tie(node.type, node.op, node.value, node.varname);
+    };
+
+    auto IsSame = [&tie](const NodeImpl &lhs, const NodeImpl &rhs) {
+        return tie(lhs) == tie(rhs);
+    };
+
+    auto CheckChildren = [&stk](const Node &lhs, const Node &rhs) {
+        // ╔═════╦═════╦════════╦═════════╗
+        // ║ lhs ║ rhs ║ return ║ emplace ║
+        // ╠═════╬═════╬════════╬═════════╣
+        // ║ T   ║ T   ║ T      ║ T       ║
+        // ╟─────╫─────╫────────╫─────────╢
+        // ║ T   ║ F   ║ F      ║ F       ║
+        // ╟─────╫─────╫────────╫─────────╢
+        // ║ F   ║ T   ║ F      ║ F       ║
+        // ╟─────╫─────╫────────╫─────────╢
+        // ║ F   ║ F   ║ T      ║ F       ║
+        // ╚═════╩═════╩════════╩═════════╝
+        if (!lhs ^ !rhs) {
+            return false;
+        }
+
+        if (lhs && rhs) {
+            stk.emplace(*lhs, *rhs);
+        }
+
+        return true;
+    };
+
+    auto CheckNode = [&IsSame, &CheckChildren](const NodeImpl &lhs, const NodeImpl &rhs) {
+        return IsSame(lhs, rhs) && CheckChildren(lhs.left, rhs.left) && CheckChildren(lhs.right, rhs.right);
+    };
+
+    if (!CheckNode(*this, *other)) {
+        return false;
+    }
+
+    while (!stk.empty()) {
+        const auto &lhs = std::get<0>(stk.top());
+        const auto &rhs = std::get<1>(stk.top());
+        stk.pop();
+
+        // 检查
+        if (!CheckNode(lhs, rhs)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline std::string NodeImpl::ToString() const noexcept {
+    std::stringstream ss;
+    ToStringNonRecursively(ss);
+    return ss.str();
+}
+
+inline double NodeImpl::Vpa() const {
+    return VpaNonRecursively();
+}
+
+inline double NodeImpl::Vpa(const SolverOptions &options) const {
+    ConfigScope scope(options);
+    return VpaNonRecursively();
+}
+
+inline NodeImpl &NodeImpl::Calc() {
+    auto d = Vpa();
+    *this = {};
+    value = d;
+
+    return *this;
+}
+
+// 前序遍历。非递归实现。
+inline void NodeImpl::CheckParent() const noexcept {
+    std::stack<std::reference_wrapper<const NodeImpl>> stk;
+
+    auto EmplaceNode = [&stk](const Node &node) {
+        if (node) {
+            stk.emplace(*node);
+        }
+    };
+    auto TryEmplaceChildren = [&EmplaceNode](const NodeImpl &node) {
+        node.CheckOperatorNum();
+        EmplaceNode(node.left);
+        EmplaceNode(node.right);
+    };
+
+    TryEmplaceChildren(*this);
+
+    while (!stk.empty()) {
+        const auto &f = stk.top().get();
+        stk.pop();
+
+#ifndef NDEBUG
+        // 检查
+        assert(f.parent);
+        bool isLeftChild = f.parent->left.get() == &f;
+        bool isRightChild = f.parent->right.get() == &f;
+        assert(isLeftChild || isRightChild);
+#endif
+
+        TryEmplaceChildren(f);
+    }
+}
+
+inline void NodeImpl::CheckOperatorNum() const noexcept {
+    if (type != NodeType::OPERATOR) {
+        return;
+    }
+
+    switch (GetOperatorNum(op)) {
+    case 1:
+        assert(!right);
+        break;
+    case 2:
+        assert(right);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+
+    assert(left);
+}
+
+inline std::string NodeImpl::NodeToStr() const noexcept {
+    switch (type) {
+    case NodeType::NUMBER:
+        return tomsolver::ToString(value);
+    case NodeType::VARIABLE:
+        return varname;
+    case NodeType::OPERATOR:
+        return MathOperatorToStr(op);
+    }
+    assert(0 && "unexpected NodeType. maybe this is a bug.");
+    return "";
+}
+
+// 中序遍历。递归实现。
+inline void NodeImpl::ToStringRecursively(std::stringstream &output) const noexcept {
+    switch (type) {
+    case NodeType::NUMBER:
+        // 如果当前节点是数值且小于0，且前面是-运算符，那么加括号
+        if (value < 0 && parent && parent->right.get() == this && parent->op == MathOperator::MATH_SUB) {
+            output << "(" << NodeToStr() << ")";
+        } else {
+            output << NodeToStr();
+        }
+        return;
+    case NodeType::VARIABLE:
+        output << NodeToStr();
+        return;
+    case NodeType::OPERATOR:
+        // pass
+        break;
+    }
+
+    auto hasParenthesis = false;
+    auto operatorNum = GetOperatorNum(op);
+    if (operatorNum == 1) // 一元运算符：函数和取负
+    {
+        if (op == MathOperator::MATH_POSITIVE || op == MathOperator::MATH_NEGATIVE) {
+            output << "(" << NodeToStr();
+        } else {
+            output << NodeToStr() << "(";
+        }
+        hasParenthesis = true;
+    } else {
+        // 非一元运算符才输出，即一元运算符的输出顺序已改变
+        if (type == NodeType::OPERATOR && parent) { // 本级为运算符
+            if ((GetOperatorNum(parent->op) == 2 && // 父运算符存在，为二元，
+                 (Rank(parent->op) > Rank(op)       // 父级优先级高于本级->加括号
+
+                  || ( // 两级优先级相等
+                         Rank(parent->op) == Rank(op) &&
+                         (
+                             // 本级为父级的右子树 且父级不满足结合律->加括号
+                             (InAssociativeLaws(parent->op) == false && this == parent->right.get()) ||
+                             // 两级都是右结合
+                             (InAssociativeLaws(parent->op) == false && IsLeft2Right(op) == false)))))
+
+                //||
+
+                ////父运算符存在，为除号，且本级为分子，则添加括号
+                //(now->parent->eOperator == MATH_DIVIDE && now == now->parent->right)
+            ) {
+                output << "(";
+                hasParenthesis = true;
+            }
+        }
+    }
+
+    if (left) // 左遍历
+    {
+        left->ToStringRecursively(output);
+    }
+
+    if (operatorNum != 1) // 非一元运算符才输出，即一元运算符的输出顺序已改变
+    {
+        output << NodeToStr();
+    }
+
+    if (right) // 右遍历
+    {
+        right->ToStringRecursively(output);
+    }
+
+    // 回到本级时补齐右括号，包住前面的东西
+    if (hasParenthesis) {
+        output << ")";
+    }
+}
+
+// 中序遍历。非递归实现。
+inline void NodeImpl::ToStringNonRecursively(std::stringstream &output) const noexcept {
+    std::stack<std::reference_wrapper<const NodeImpl>> stk;
+
+    NodeImpl rightParenthesis(NodeType::OPERATOR, MathOperator::MATH_RIGHT_PARENTHESIS, 0, "");
+
+    auto AddLeftLine = [&stk, &output, &rightParenthesis](const NodeImpl *cur) {
+        while (cur) {
+            if (cur->type != NodeType::OPERATOR) {
+                stk.emplace(*cur);
+                cur = cur->left.get();
+                continue;
+            }
+
+            // 一元运算符的特殊处理：
+            //      例如sin: 直接输出 "sin(" ，并且把一个右括号入栈。让退栈时这个右括号能包裹住现在的子树。
+            //      如果是+/-: 直接输出 "+"/"-"，如果+/-的操作数是operator，那么处理方式和sin这类一样；
+            //                                  如果+/-的操作数是number/variable，那么不加括号。
+            if (GetOperatorNum(cur->op) == 1) {
+                if ((cur->op == MathOperator::MATH_POSITIVE || cur->op == MathOperator::MATH_NEGATIVE) &&
+                    (cur->left->type != NodeType::OPERATOR)) {
+                    output << cur->NodeToStr();
+                    cur = cur->left.get();
+                    continue;
+                }
+                output << cur->NodeToStr() << "(";
+
+                // not push this op
+
+                // push ')'
+                stk.emplace(rightParenthesis);
+
+                cur = cur->left.get();
+                continue;
+            }
+
+            // 二元运算符的特殊处理：
+            if (cur->parent) {
+                if ((GetOperatorNum(cur->parent->op) == 2 && // 父运算符存在，为二元，
+                     (Rank(cur->parent->op) > Rank(cur->op)  // 父级优先级高于本级->加括号
+
+                      || ( // 两级优先级相等
+                             Rank(cur->parent->op) == Rank(cur->op) &&
+                             (
+                                 // 本级为父级的右子树 且父级不满足结合律->加括号
+                                 (InAssociativeLaws(cur->parent->op) == false && cur == cur->parent->right.get()) ||
+                                 // 两级都是右结合
+                                 (InAssociativeLaws(cur->parent->op) == false && IsLeft2Right(cur->op) == false)))))
+
+                    //||
+
+                    ////父运算符存在，为除号，且本级为分子，则添加括号
+                    //(now->parent->eOperator == MATH_DIVIDE && now == now->parent->right)
+                ) {
+                    output << "(";
+
+                    // push ')'
+                    stk.emplace(rightParenthesis);
+
+                    stk.emplace(*cur);
+                    cur = cur->left.get();
+                    continue;
+                }
+            }
+
+            stk.emplace(*cur);
+            cur = cur->left.get();
+        }
+    };
+
+    AddLeftLine(this);
+
+    while (!stk.empty()) {
+        const auto &cur = stk.top().get();
+        stk.pop();
+
+        // output
+
+        // 负数的特殊处理
+        // 如果当前节点是数值且小于0，且前面是-运算符，那么加括号
+        if (cur.type == NodeType::NUMBER && cur.value < 0 && cur.parent && cur.parent->right.get() == &cur &&
+            cur.parent->op == MathOperator::MATH_SUB) {
+            output << "(" << cur.NodeToStr() << ")";
+        } else {
+            output << cur.NodeToStr();
+        }
+
+        if (cur.right) {
+            AddLeftLine(cur.right.get());
+            continue;
+        }
+    }
+}
+
+// 后序遍历。递归实现。
+inline double NodeImpl::VpaRecursively() const {
+
+    auto vpa = [](const Node &node) {
+        return node ? node->Vpa() : 0;
+    };
+
+    switch (type) {
+    case NodeType::NUMBER:
+        return value;
+
+    case NodeType::VARIABLE:
+        throw std::runtime_error("has variable. can not calculate to be a number");
+
+    case NodeType::OPERATOR:
+        assert((GetOperatorNum(op) == 1 && left && right == nullptr) || (GetOperatorNum(op) == 2 && left && right));
+        return tomsolver::Calc(op, vpa(left), vpa(right));
+    }
+
+    throw std::runtime_error("unsupported node type");
+}
+
+// 后序遍历。非递归实现。
+inline double NodeImpl::VpaNonRecursively() const {
+
+    std::stack<std::reference_wrapper<const NodeImpl>> stk;
+    std::forward_list<std::reference_wrapper<const NodeImpl>> revertedPostOrder;
+
+    // ==== Part I ====
+
+    // 借助一个栈，得到反向的后序遍历序列，结果保存在revertedPostOrder
+    stk.emplace(*this);
+
+    while (!stk.empty()) {
+        const auto &node = stk.top().get();
+        stk.pop();
+
+        if (node.left) {
+            stk.emplace(*node.left);
+        }
+
+        if (node.right) {
+            stk.emplace(*node.right);
+        }
+
+        revertedPostOrder.emplace_front(node);
+    }
+
+    // ==== Part II ====
+    // revertedPostOrder的反向序列是一组逆波兰表达式，根据这组逆波兰表达式可以计算出表达式的值
+    // calcStk是用来计算值的临时栈，计算完成后calcStk的size应该为1
+    std::stack<double> calcStk;
+    // for (auto it = revertedPostOrder.rbegin(); it != revertedPostOrder.rend(); ++it) {
+    for (const auto &nodeWrapper : revertedPostOrder) {
+        const auto &node = nodeWrapper.get();
+        switch (node.type) {
+        case NodeType::NUMBER:
+            calcStk.emplace(node.value);
+            break;
+
+        case NodeType::OPERATOR: {
+            auto r = std::numeric_limits<double>::quiet_NaN();
+
+            switch (GetOperatorNum(node.op)) {
+            case 1:
+                break;
+            case 2:
+                r = calcStk.top();
+                calcStk.pop();
+                break;
+            default:
+                assert(0 && "[VpaNonRecursively] unsupported operator num");
+                break;
+            }
+
+            auto &l = calcStk.top();
+            l = tomsolver::Calc(node.op, l, r);
+            break;
+        }
+        case NodeType::VARIABLE:
+        default:
+            throw std::runtime_error("wrong");
+            break;
+        }
+    }
+
+    assert(calcStk.size() == 1);
+
+    return calcStk.top();
+}
+
+// 后序遍历。因为要在左右儿子都没有的情况下删除节点。
+inline void NodeImpl::Release() noexcept {
+    std::stack<Node> stk;
+
+    auto emplaceNode = [&stk](Node node) {
+        if (node) {
+            stk.emplace(std::move(node));
+        }
+    };
+
+    auto emplaceChildren = [&emplaceNode](NodeImpl &node) {
+        emplaceNode(std::move(node.left));
+        emplaceNode(std::move(node.right));
+    };
+
+    emplaceChildren(*this);
+
+    while (!stk.empty()) {
+        auto node = std::move(stk.top());
+        stk.pop();
+
+        emplaceChildren(*node);
+
+        assert(!node->left && !node->right);
+
+        // 这里如果把node填入vector，最后翻转。得到的序列就是后序遍历。
+
+        // 这里node会被自动释放。
+    }
+}
+
+inline Node CloneRecursively(const Node &src) noexcept {
+    auto ret = std::make_unique<NodeImpl>(src->type, src->op, src->value, src->varname);
+    auto Copy = [ret = ret.get()](Node &tgt, const Node &src) {
+        if (src) {
+            tgt = Clone(src);
+            tgt->parent = ret;
+        }
+    };
+
+    Copy(ret->left, src->left);
+    Copy(ret->right, src->right);
+
+    return ret;
+}
+
+// 前序遍历。非递归实现。
+inline Node CloneNonRecursively(const Node &node) noexcept {
+    std::stack<std::tuple<const NodeImpl &, NodeImpl &, Node &>> stk;
+
+    auto MakeNode = [](const NodeImpl &src, NodeImpl *parent = nullptr) {
+        auto node = std::make_unique<NodeImpl>(src.type, src.op, src.value, src.varname);
+        node->parent = parent;
+        return node;
+    };
+
+    auto EmplaceNode = [&stk](const Node &src, NodeImpl &parent, Node &tgt) {
+        if (src) {
+            stk.emplace(*src, parent, tgt);
+        }
+    };
+
+    auto EmplaceChildren = [&EmplaceNode](const NodeImpl &src, Node &tgt) {
+        EmplaceNode(src.left, *tgt, tgt->left);
+        EmplaceNode(src.right, *tgt, tgt->right);
+    };
+
+    auto ret = MakeNode(*node);
+    EmplaceChildren(*node, ret);
+
+    while (!stk.empty()) {
+        const auto &src = std::get<0>(stk.top());
+        auto &parent = std::get<1>(stk.top());
+        auto &tgt = std::get<2>(stk.top());
+        stk.pop();
+
+        tgt = MakeNode(src, &parent);
+        EmplaceChildren(src, tgt);
+    }
+
+    return ret;
+}
+
+inline void CopyOrMoveTo(NodeImpl *parent, Node &child, Node &&n1) noexcept {
+    n1->parent = parent;
+    child = std::move(n1);
+}
+
+inline void CopyOrMoveTo(NodeImpl *parent, Node &child, const Node &n1) noexcept {
+    auto n1Clone = std::make_unique<NodeImpl>(*n1);
+    n1Clone->parent = parent;
+    child = std::move(n1Clone);
+}
+
+inline std::ostream &operator<<(std::ostream &out, const Node &n) noexcept {
+    out << n->ToString();
+    return out;
+}
+
+inline Node Operator(MathOperator op, Node left, Node right) noexcept {
+    auto ret = std::make_unique<internal::NodeImpl>(NodeType::OPERATOR, op, 0, "");
+
+    auto SetChild = [ret = ret.get()](Node &tgt, Node src) {
+        if (src) {
+            src->parent = ret;
+            tgt = std::move(src);
+        }
+    };
+
+    SetChild(ret->left, std::move(left));
+    SetChild(ret->right, std::move(right));
+
+    return ret;
+}
+
+// 前序遍历。非递归实现。
+inline std::set<std::string> NodeImpl::GetAllVarNames() const noexcept {
+    std::set<std::string> ret;
+
+    std::stack<std::reference_wrapper<const NodeImpl>> stk;
+
+    auto EmplaceNode = [&stk](const Node &node) {
+        if (node) {
+            stk.emplace(*node);
+        }
+    };
+
+    auto EmplaceChild = [&ret, &EmplaceNode](const NodeImpl &node) {
+        if (node.type == NodeType::VARIABLE) {
+            ret.emplace(node.varname);
+        }
+        EmplaceNode(node.left);
+        EmplaceNode(node.right);
+    };
+
+    EmplaceChild(*this);
+
+    while (!stk.empty()) {
+        const auto &node = stk.top().get();
+        stk.pop();
+        EmplaceChild(node);
+    }
+
+    return ret;
+}
+
+} // namespace internal
+
+inline Node Clone(const Node &rhs) noexcept {
+    return internal::CloneNonRecursively(rhs);
+}
+
+inline Node Move(Node &rhs) noexcept {
+    return std::move(rhs);
+}
+
+inline Node Num(double num) noexcept {
+    return std::make_unique<internal::NodeImpl>(NodeType::NUMBER, MathOperator::MATH_NULL, num, "");
+}
+
+inline Node Op(MathOperator op) {
+    if (op == MathOperator::MATH_NULL) {
+        throw std::runtime_error("Illegal MathOperator: MATH_NULL");
+    }
+    return std::make_unique<internal::NodeImpl>(NodeType::OPERATOR, op, 0, "");
+}
+
+inline bool VarNameIsLegal(const std::string &varname) noexcept {
+    return std::regex_match(varname.begin(), varname.end(), std::regex{R"((?=\w)\D\w*)"});
+}
+
+inline Node Var(std::string varname) {
+    if (!VarNameIsLegal(varname)) {
+        throw std::runtime_error("Illegal varname: " + varname);
+    }
+    return std::make_unique<internal::NodeImpl>(NodeType::VARIABLE, MathOperator::MATH_NULL, 0, std::move(varname));
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline Mat::Mat(int rows, int cols, double initValue) noexcept : rows(rows), cols(cols), data(initValue, rows * cols) {
+    assert(rows > 0);
+    assert(cols > 0);
+}
+
+inline Mat::Mat(std::initializer_list<std::initializer_list<double>> init) noexcept {
+    rows = static_cast<int>(init.size());
+    assert(rows > 0);
+    cols = static_cast<int>(std::max(init, [](auto lhs, auto rhs) {
+                                return lhs.size() < rhs.size();
+                            }).size());
+    assert(cols > 0);
+    data.resize(rows * cols);
+
+    auto i = 0;
+    for (auto values : init) {
+        Row(i++) = values;
+    }
+}
+
+inline Mat::Mat(int rows, int cols, std::valarray<double> data) noexcept
+    : rows(rows), cols(cols), data(std::move(data)) {}
+
+inline std::slice_array<double> Mat::Row(int i, int offset) {
+    return data[std::slice(cols * i + offset, cols - offset, 1)];
+}
+
+inline std::slice_array<double> Mat::Col(int j, int offset) {
+    return data[std::slice(j + offset * cols, rows - offset, cols)];
+}
+
+inline auto Mat::Row(int i, int offset) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]) {
+    return data[std::slice(cols * i + offset, cols - offset, 1)];
+}
+
+inline auto Mat::Col(int j, int offset) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]) {
+    return data[std::slice(j + offset * cols, rows - offset, cols)];
+}
+
+inline const double &Mat::Value(int i, int j) const {
+    return data[i * cols + j];
+}
+
+inline double &Mat::Value(int i, int j) {
+    return data[i * cols + j];
+}
+
+inline bool Mat::operator==(double m) const noexcept {
+    double eps = Config::Get().epsilon;
+    if (m == 0) {
+        return internal::AllAbsLess(static_cast<int>(data.size()), Data(), eps);
+    }
+    return std::all_of(std::begin(data), std::end(data), [m, eps](auto val) {
+        return std::abs(val - m) < eps;
+    });
+}
+
+inline bool Mat::operator==(const Mat &b) const noexcept {
+    assert(rows == b.rows);
+    assert(cols == b.cols);
+    return internal::AllAbsDiffLess(static_cast<int>(data.size()), Data(), b.Data(),
+                                    Config::Get().epsilon);
+}
+
+inline Mat &Mat::operator+=(const Mat &b) noexcept {
+    assert(rows == b.rows);
+    assert(cols == b.cols);
+    internal::ScaledAdd(static_cast<int>(data.size()), Data(), 1.0, b.Data(), Data());
+    return *this;
+}
+
+inline Mat &Mat::operator-=(const Mat &b) noexcept {
+    assert(rows == b.rows);
+    assert(cols == b.cols);
+    internal::ScaledAdd(static_cast<int>(data.size()), Data(), -1.0, b.Data(), Data());
+    return *this;
+}
+
+inline Mat &Mat::operator*=(double k) noexcept {
+    data *= k;
+    return *this;
+}
+
+inline Mat Mat::operator*(const Mat &b) const noexcept {
+    assert(cols == b.rows);
+    Mat ans(rows, b.cols);
+    internal::Gemm(rows, b.cols, cols, Data(), b.Data(), ans.Data());
+    return ans;
+}
+
+inline Vec Mat::ToVec() const & {
+    assert(rows > 0);
+    if (cols != 1) {
+        throw std::runtime_error("Mat::ToVec fail. rows is not one");
+    }
+    Vec v(rows);
+    v.cols = 1;
+    v.data = data;
+    return v;
+}
+
+inline Vec Mat::ToVec() && {
+    assert(rows > 0);
+    if (cols != 1) {
+        throw std::runtime_error("Mat::ToVec fail. rows is not one");
+    }
+    return Vec(std::move(data));
+}
+
+inline Mat &Mat::SwapRow(int i, int j) noexcept {
+    if (i == j) {
+        return *this;
+    }
+    assert(i >= 0);
+    assert(i < rows);
+    assert(j >= 0);
+    assert(j < rows);
+
+    std::valarray<double> temp = Row(i);
+    Row(i) = Row(j);
+    Row(j) = temp;
+
+    return *this;
+}
+
+inline Mat &Mat::SwapCol(int i, int j) noexcept {
+    if (i == j) {
+        return *this;
+    }
+    assert(i >= 0);
+    assert(i < cols);
+    assert(j >= 0);
+    assert(j < cols);
+
+    std::valarray<double> t = Col(i);
+    Col(i) = Col(j);
+    Col(j) = t;
+
+    return *this;
+}
+
+inline std::string Mat::ToString() const noexcept {
+    if (data.size() == 0) {
+        return "[]\n";
+    }
+
+    std::stringstream ss;
+    ss << "[";
+
+    size_t i = 0;
+    for (auto val : data) {
+        ss << (i == 0 ? "" : " ") << tomsolver::ToString(val);
+        i++;
+        ss << (i % cols == 0 ? (i == data.size() ? "]\n" : "\n") : ", ");
+    }
+
+    return ss.str();
+}
+
+inline void Mat::Resize(int newRows, int newCols) noexcept {
+    assert(newRows > 0 && newCols > 0);
+    auto temp = std::move(data);
+    data.resize(newRows * newCols);
+    auto minRows = std::min<size_t>(rows, newRows);
+    auto minCols = std::min<size_t>(cols, newCols);
+    data[std::gslice(0, {minRows, minCols}, {static_cast<size_t>(newCols), 1})] =
+        temp[std::gslice(0, {minRows, minCols}, {static_cast<size_t>(cols), 1})];
+    rows = newRows;
+    cols = newCols;
+}
+
+inline Mat &Mat::Zero() noexcept {
+    data = 0;
+    return *this;
+}
+
+inline Mat &Mat::Ones() noexcept {
+    assert(rows == cols);
+    Zero();
+    data[std::slice(0, rows, cols + 1)] = 1;
+    return *this;
+}
+
+inline double Mat::Norm2() const noexcept {
+    auto p = Data();
+    return internal::Dot(static_cast<int>(data.size()), p, p);
+}
+
+inline double Mat::NormInfinity() const noexcept {
+    return internal::AbsMax(static_cast<int>(data.size()), Data());
+}
+
+inline double Mat::NormNegInfinity() const noexcept {
+    return std::abs(data).min();
+}
+
+inline double Mat::Min() const noexcept {
+    return data.min();
+}
+
+inline void Mat::SetValue(double value) noexcept {
+    data = value;
+}
+
+inline bool Mat::PositiveDetermine() const noexcept {
+    assert(rows == cols);
+    return CholeskyFactorization(rows).Factor(*this);
+}
+
+inline Mat Mat::Transpose() const noexcept {
+    Mat ans(cols, rows);
+    for (auto i = 0; i < cols; i++) {
+        ans.Row(i) = Col(i);
+    }
+    return ans;
+}
+
+inline Mat Mat::Inverse() const {
+    assert(rows == cols);
+    int n = rows;
+
+    // 分解一次，逐列求解 A * X(:, j) = I(:, j)
+    LUFactorization lu(n);
+    lu.Factor(*this);
+
+    // 结果直接写入ans的第j列
+    Mat ans(n, n);
+    Vec e(n);
+    for (int j = 0; j < n; ++j) {
+        e.Zero();
+        e[j] = 1;
+        lu.Solve(e, MutableVecView(std::addressof(ans.data[j]), n, n));
+    }
+    return ans;
+}
+
+inline Mat EachDivide(const Mat &a, const Mat &b) noexcept {
+    assert(a.rows == b.rows);
+    assert(a.cols == b.cols);
+    return {a.rows, b.cols, b.data / b.data};
+}
+
+inline bool IsZero(const Mat &mat) noexcept {
+    return std::all_of(std::begin(mat.data), std::end(mat.data), [](auto val) {
+        return std::abs(val) <= Config::Get().epsilon;
+    });
+}
+
+inline bool AllIsLessThan(const Mat &v1, const Mat &v2) noexcept {
+    assert(v1.rows == v2.rows && v1.cols == v2.cols);
+    return std::all_of(std::begin(v1.data), std::end(v1.data), [iter = std::begin(v2.data)](auto val) mutable {
+        return val < *iter++;
+    });
+}
+
+inline int GetMaxAbsRowIndex(const Mat &A, int rowStart, int rowEnd, int col) noexcept {
+    int ret = rowStart;
+    for (int i = rowStart + 1; i <= rowEnd; ++i) {
+        if (std::abs(A.Value(i, col)) > std::abs(A.Value(ret, col))) {
+            ret = i;
+        }
+    }
+    return ret;
+}
+
+inline void Adjoint(const Mat &A, Mat &adj) noexcept // 딸림행렬, 수반행렬
+{
+    if (A.rows == 1) // 예외처리
+    {
+        adj.Value(0, 0) = 1;
+        return;
+    }
+
+    Mat cofactor(A.rows - 1, A.cols - 1);
+
+    for (int i = 0; i < A.rows; i++) {
+        for (int j = 0; j < A.cols; j++) {
+            GetCofactor(A, cofactor, i, j, A.rows); // 여인수 구하기, 단 i, j값으로 되기에 temp는 항상 바뀐다.
+
+            auto det = (Det(cofactor, A.rows - 1));
+
+            if ((i + j) % 2 != 0) {
+                det = -det; // +, -, + 형식으로 되는데, 0,0 좌표면 +, 0,1좌표면 -, 이렇게 된다.
+            }
+
+            adj.Value(j, i) = det; // n - 1 X n - 1 은, 언제나 각 여인수 행렬 은
+                                   // 여인수를 따오는 행렬의 크기 - 1 이기 때문이다.
+        }
+    }
+}
+
+inline void GetCofactor(const Mat &A, Mat &cofactor, int p, int q, int n) noexcept // 여인수를 구해다주는 함수!
+{
+    /*
+         ┌───┄┄┄┄┄┄┄┄┬───┬┄┄┄┄┄┄┄┄───┐   size of region A = p * q
+    0 -> │           │   │           │                  B = p * (n - 1 - q)
+         ┆           ┆   ┆           ┆                  C = (n - 1 - p) * q
+         ┆     A     ┆   ┆     B     ┆                  D = (n - 1 - p) * (n - 1 - q)
+         ┆           ┆   ┆           ┆
+         ┆           ┆   ┆           ┆    left top of region
+         ├───┄┄┄┄┄┄┄┄┼───┼┄┄┄┄┄┄┄┄───┤   ╔════════╤════════════════╤══════════╗
+    p ─> │           │   │           │   ║ region │ origin matrix  │ cofactor ║
+         ├───┄┄┄┄┄┄┄┄┼───┼┄┄┄┄┄┄┄┄───┤   ╠════════╪════════════════╪══════════╣
+         ┆           ┆   ┆           ┆   ║ A      │ (0, 0)         │ (0, 0)   ║
+         ┆           ┆   ┆           ┆   ╟────────┼────────────────┼──────────╢
+         ┆     C     ┆   ┆     D     ┆   ║ B      │ (0, q + 1)     │ (0, q)   ║
+         ┆           ┆   ┆           ┆   ╟────────┼────────────────┼──────────╢
+         │           │   │           │   ║ C      │ (p + 1, 0)     │ (p, 0)   ║
+    n ─> └───┄┄┄┄┄┄┄┄┴───┴┄┄┄┄┄┄┄┄───┘   ╟────────┼────────────────┼──────────╢
+          ^            ^            ^    ║ D      │ (p + 1, q + 1) │ (p, q)   ║
+          0            q            n    ╚════════╧════════════════╧══════════╝
+    */
+
+    auto newIndex = [n = n - 1](int p, int q) -> size_t {
+        return p * n + q;
+    };
+    auto index = [n = A.cols](int p, int q) -> size_t {
+        return p * n + q;
+    };
+    auto makeValarray = [](int p, int q) {
+        return std::valarray<size_t>{static_cast<size_t>(p), static_cast<size_t>(q)};
+    };
+    auto newStride = makeValarray(n - 1, 1);
+    auto stride = makeValarray(A.cols, 1);
+
+    std::tuple<std::valarray<size_t>, size_t, size_t> config[] = {
+        {makeValarray(p, q), newIndex(0, 0), index(0, 0)},
+        {makeValarray(p, n - 1 - q), newIndex(0, q), index(0, q + 1)},
+        {makeValarray(n - 1 - p, q), newIndex(p, 0), index(p + 1, 0)},
+        {makeValarray(n - 1 - p, n - 1 - q), newIndex(p, q), index(p + 1, q + 1)},
+    };
+
+    for (const auto &conf : config) {
+        const auto &size = std::get<0>(conf);
+        const auto &newStart = std::get<1>(conf);
+        const auto &start = std::get<2>(conf);
+        if (newStart < cofactor.data.size()) {
+            cofactor.data[std::gslice(newStart, size, newStride)] = A.data[std::gslice(start, size, stride)];
+        }
+    }
+}
+
+inline double Det(const Mat &A, int n) noexcept {
+    if (n == 0) {
+        return 0;
+    }
+
+    // 对左上角n阶子矩阵做列主元消元，行列式等于主元之积，每交换一次行变一次号
+    std::vector<double> lu(n * n);
+    for (int i = 0; i < n; ++i) {
+        std::copy_n(std::addressof(A.Value(i, 0)), n, lu.data() + i * n);
+    }
+
+    double D = 1;
+    for (int k = 0; k < n; ++k) {
+        double *rowK = lu.data() + k * n;
+
+        int maxAbsRowIndex = k;
+        for (int i = k + 1; i < n; ++i) {
+            if (std::abs(lu[i * n + k]) > std::abs(lu[maxAbsRowIndex * n + k])) {
+                maxAbsRowIndex = i;
+            }
+        }
+
+        if (lu[maxAbsRowIndex * n + k] == 0) {
+            return 0;
+        }
+
+        if (maxAbsRowIndex != k) {
+            std::swap_ranges(rowK, rowK + n, lu.data() + maxAbsRowIndex * n);
+            D = -D;
+        }
+
+        auto pivot = rowK[k];
+        D *= pivot;
+        for (int i = k + 1; i < n; ++i) {
+            double *rowI = lu.data() + i * n;
+            auto ratio = rowI[k] / pivot;
+            for (int j = k + 1; j < n; ++j) {
+                rowI[j] -= ratio * rowK[j];
+            }
+        }
+    }
+
+    return D;
+}
+
+inline Vec::Vec(int rows, double initValue) noexcept : Mat(rows, 1, initValue) {}
+
+inline Vec::Vec(std::initializer_list<double> init) noexcept : Vec(std::valarray<double>{init}) {}
+
+inline Vec::Vec(std::valarray<double> init) noexcept : Mat(static_cast<int>(init.size()), 1, std::valarray<double>()) {
+    data = std::move(init);
+}
+
+inline Mat &Vec::AsMat() noexcept {
+    return *this;
+}
+
+inline void Vec::Resize(int newRows) noexcept {
+    assert(newRows > 0);
+    Mat::Resize(newRows, 1);
+}
+
+inline double &Vec::operator[](std::size_t i) noexcept {
+    return data[i];
+}
+
+inline double Vec::operator[](std::size_t i) const noexcept {
+    return data[i];
+}
+
+inline Vec Vec::operator*(const Vec &b) const noexcept {
+    assert(rows == b.rows);
+    return {data * b.data};
+}
+
+inline Vec Vec::operator/(const Vec &b) const noexcept {
+    assert(rows == b.rows);
+    return {data / b.data};
+}
+
+inline bool Vec::operator<(const Vec &b) noexcept {
+    assert(rows == b.rows);
+    return std::all_of(std::begin(data), std::end(data), [iter = std::begin(b.data)](auto val) mutable {
+        return val < *iter++;
+    });
+}
+
+inline Mat TransposeMultiply(const Mat &A) noexcept {
+    Mat ans(A.cols, A.cols);
+    internal::SyrkTranspose(A.rows, A.cols, A.Data(), ans.Data());
+    return ans;
+}
+
+inline Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept {
+    assert(A.rows == b.rows);
+    Vec ans(A.cols);
+    internal::GemvTranspose(A.rows, A.cols, A.Data(), b.Data(),
+                            ans.Data());
+    return ans;
+}
+
+inline std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept {
+    return out << mat.ToString();
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 线性算子，计算out = A·v。v与out的长度都等于A的阶数，不会指向同一块内存。
+ * Krylov子空间方法只通过这种方式访问A，因此A可以不以矩阵的形式存在（例如用差分近似雅可比矩阵与向量的乘积）。
+ * 预条件子M⁻¹也以这种形式给出。
+ */
+using LinearOperator =
+    std::function<void(VecView v, MutableVecView out)>;
+
+/**
+ * 重启GMRES(restart)方法求解n阶线性方程组Ax = b，A可以不对称。
+ * 使用右预条件：求解AM⁻¹u = b，x = M⁻¹u，因此残差||b - Ax||不受预条件子影响。
+ * 工作空间（restart + 1个n维基向量与Hessenberg矩阵）在构造时分配，内存为O(n·restart)，之后求解不申请堆内存。
+ */
+class GMRES {
+public:
+    /**
+     * @param n: 方程组的阶数
+     * @param restart: 每隔多少次迭代重启一次，即Krylov子空间的最大维数
+     */
+    GMRES(int n, int restart);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * A奇异、Krylov子空间不再扩张而残差仍未达到要求时提前结束。
+     * @return 是否达到tol要求的精度。未达到时x仍为迭代过程中得到的近似解
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数（调用A的次数，不含计算初始残差）。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||（由迭代过程递推得到）。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int restart;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    // restart + 1个基向量，按行存放
+    std::vector<double> V;
+
+    // (restart + 1)×restart的上Hessenberg矩阵，按行存放。Givens旋转之后为上三角矩阵
+    std::vector<double> H;
+
+    // Givens旋转
+    std::vector<double> cs;
+    std::vector<double> sn;
+
+    // 最小二乘问题的右端项
+    std::vector<double> s;
+
+    Vec r;
+    Vec z;
+};
+
+/**
+ * 预条件的稳定双共轭梯度法（BiCGSTAB）求解n阶线性方程组Ax = b，A可以不对称。
+ * 与GMRES相比不需要保存Krylov子空间的基，内存为O(n)，但残差不是单调下降的。
+ * 使用右预条件，接口与GMRES相同。工作空间在构造时分配，之后求解不申请堆内存。
+ */
+class BiCGSTAB {
+public:
+    explicit BiCGSTAB(int n);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * @return 是否达到tol要求的精度。算法中断（breakdown）或未达到精度时x仍为得到的近似解
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数。每次迭代调用A两次。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    Vec r, r0, p, v, s, t, pHat, sHat;
+};
+
+/**
+ * 预条件共轭梯度法（CG）求解n阶对称正定线性方程组Ax = b，例如LM方法中的阻尼方程(JᵀJ + μD²)h = -JᵀF。
+ * 预条件子M⁻¹也必须对称正定。每次迭代调用A一次，内存为O(n)。工作空间在构造时分配，之后求解不申请堆内存。
+ */
+class ConjugateGradient {
+public:
+    explicit ConjugateGradient(int n);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * @return 是否达到tol要求的精度
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数（调用A的次数）。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    Vec r, z, p, Ap;
+};
+
+/**
+ * Jacobi（对角）预条件子，M = diag(A)。可以作为LinearOperator使用。
+ */
+class JacobiPreconditioner {
+public:
+    /**
+     * @exception MathError 对角元为0
+     */
+    explicit JacobiPreconditioner(const SparseMat &A);
+
+    /**
+     * @exception MathError 对角元为0
+     */
+    explicit JacobiPreconditioner(MatView A);
+
+    /**
+     * out = M⁻¹·v
+     */
+    void operator()(VecView v, MutableVecView out) const noexcept;
+
+private:
+    std::vector<double> invDiag;
+};
+
+/**
+ * 零填充不完全LU分解（ILU(0)）预条件子，M = LU，L和U的非零元位置与A相同。可以作为LinearOperator使用。
+ * 适用于对角占优的稀疏矩阵，例如偏微分方程的差分离散。分解与求解的计算量都是O(nnz)。
+ */
+class ILU0Preconditioner {
+public:
+    /**
+     * 分解方阵A。A的每个对角元都必须是非零元。
+     * @exception MathError 缺少对角元，或者分解过程中出现为0的主元
+     */
+    explicit ILU0Preconditioner(const SparseMat &A);
+
+    /**
+     * out = (LU)⁻¹·v，v和out可以指向同一块内存。
+     */
+    void operator()(VecView v, MutableVecView out) const noexcept;
+
+private:
+    int n;
+
+    // 与A的非零元位置相同：严格下三角部分为L（对角元1不存储），其余为U
+    std::vector<int> rowPtr;
+    std::vector<int> colIndex;
+    std::vector<double> lu;
+
+    // 每行对角元在lu中的下标
+    std::vector<int> diagIndex;
+};
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline GMRES::GMRES(int n, int restart)
+    : n(n), restart(restart), V((restart + 1) * n), H((restart + 1) * restart), cs(restart), sn(restart),
+      s(restart + 1), r(n), z(n) {
+    assert(n > 0);
+    assert(restart > 0);
+}
+
+inline bool GMRES::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x,
+                         double tol, int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        for (int i = 0; i < n; ++i) {
+            x[i] = 0;
+        }
+        relativeResidual = 0;
+        return true;
+    }
+
+    auto basis = [&](int j) {
+        return MutableVecView(V.data() + j * n, n);
+    };
+    auto h = [&](int i, int j) -> double & {
+        return H[i * restart + j];
+    };
+
+    while (1) {
+        // r = b - Ax
+        A(x, r);
+        ScaledAdd(b, -1, r, r);
+        double beta = std::sqrt(r.Norm2());
+        relativeResidual = beta / bNorm;
+        if (relativeResidual <= tol) {
+            return true;
+        }
+        if (iterations >= maxIterations) {
+            return false;
+        }
+
+        Scale(1 / beta, r, basis(0));
+        std::fill(s.begin(), s.end(), 0);
+        s[0] = beta;
+
+        // Arnoldi过程，同时用Givens旋转把Hessenberg矩阵化为上三角矩阵
+        int k = 0;
+        bool breakdown = false;
+        bool singular = false; // Hessenberg矩阵的新列与前面的列线性相关（A奇异），残差不会再下降
+        while (k < restart && iterations < maxIterations) {
+            int j = k++;
+            ++iterations;
+            MutableVecView w = basis(j + 1);
+            if (precond) {
+                precond(basis(j), z);
+                A(z, w);
+            } else {
+                A(basis(j), w);
+            }
+
+            double wNorm = std::sqrt(Dot(w, w)); // 正交化之前的||Av||，用于判断对角元是否为0
+
+            // 修正的Gram-Schmidt正交化
+            for (int i = 0; i <= j; ++i) {
+                h(i, j) = Dot(w, basis(i));
+                ScaledAdd(w, -h(i, j), basis(i), w);
+            }
+            h(j + 1, j) = std::sqrt(Dot(w, w));
+            breakdown = h(j + 1, j) == 0;
+            if (!breakdown) {
+                Scale(1 / h(j + 1, j), w, w);
+            }
+
+            for (int i = 0; i < j; ++i) {
+                double t = cs[i] * h(i, j) + sn[i] * h(i + 1, j);
+                h(i + 1, j) = -sn[i] * h(i, j) + cs[i] * h(i + 1, j);
+                h(i, j) = t;
+            }
+            double d = std::hypot(h(j, j), h(j + 1, j));
+            if (d <= n * std::numeric_limits<double>::epsilon() * wNorm) {
+                // 上三角矩阵的对角元（相对于||Av||）为0，只用前j列求解，relativeResidual仍为上一步的值
+                k = j;
+                singular = true;
+                break;
+            }
+            cs[j] = h(j, j) / d;
+            sn[j] = h(j + 1, j) / d;
+            h(j, j) = d;
+            h(j + 1, j) = 0;
+            s[j + 1] = -sn[j] * s[j];
+            s[j] *= cs[j];
+
+            relativeResidual = std::abs(s[j + 1]) / bNorm;
+            if (relativeResidual <= tol || breakdown) {
+                break;
+            }
+        }
+
+        // 回代求解上三角方程组Hy = s，y存放在s中，然后x += M⁻¹·(Vy)
+        for (int i = k - 1; i >= 0; --i) {
+            for (int j = i + 1; j < k; ++j) {
+                s[i] -= h(i, j) * s[j];
+            }
+            s[i] /= h(i, i);
+        }
+        for (int i = 0; i < n; ++i) {
+            r[i] = 0;
+        }
+        for (int j = 0; j < k; ++j) {
+            ScaledAdd(r, s[j], basis(j), r);
+        }
+        if (precond) {
+            precond(r, z);
+            ScaledAdd(x, 1, z, x);
+        } else {
+            ScaledAdd(x, 1, r, x);
+        }
+
+        if (singular) {
+            return relativeResidual <= tol;
+        }
+        if (relativeResidual <= tol || breakdown) {
+            return true;
+        }
+    }
+}
+
+inline int GMRES::Iterations() const noexcept {
+    return iterations;
+}
+
+inline double GMRES::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+namespace {
+
+/**
+ * out = M⁻¹·v，M⁻¹为nullptr时out = v。
+ */
+inline void ApplyPreconditioner(const LinearOperator &precond, VecView v, MutableVecView out) {
+    if (precond) {
+        precond(v, out);
+    } else {
+        out = v;
+    }
+}
+
+} // namespace
+
+inline BiCGSTAB::BiCGSTAB(int n) : n(n), r(n), r0(n), p(n), v(n), s(n), t(n), pHat(n), sHat(n) {
+    assert(n > 0);
+}
+
+inline bool BiCGSTAB::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x,
+                            double tol, int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        Scale(0, b, x);
+        relativeResidual = 0;
+        return true;
+    }
+
+    // r = b - Ax
+    A(x, r);
+    ScaledAdd(b, -1, r, r);
+    r0 = r;
+    relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+    double rho = 1, alpha = 1, omega = 1;
+    while (relativeResidual > tol) {
+        if (iterations >= maxIterations) {
+            return false;
+        }
+        ++iterations;
+
+        double rhoNew = Dot(r0, r);
+        if (rhoNew == 0) {
+            return false;
+        }
+        if (iterations == 1) {
+            p = r;
+        } else {
+            // p = r + β(p - ωv)
+            double beta = (rhoNew / rho) * (alpha / omega);
+            ScaledAdd(p, -omega, v, p);
+            ScaledAdd(r, beta, p, p);
+        }
+        rho = rhoNew;
+
+        ApplyPreconditioner(precond, p, pHat);
+        A(pHat, v);
+        double r0v = Dot(r0, v);
+        if (r0v == 0) {
+            return false;
+        }
+        alpha = rho / r0v;
+
+        // s = r - αv
+        ScaledAdd(r, -alpha, v, s);
+        ScaledAdd(x, alpha, pHat, x);
+        relativeResidual = std::sqrt(s.Norm2()) / bNorm;
+        if (relativeResidual <= tol) {
+            return true;
+        }
+
+        ApplyPreconditioner(precond, s, sHat);
+        A(sHat, t);
+        double tt = t.Norm2();
+        omega = tt == 0 ? 0 : Dot(t, s) / tt;
+        ScaledAdd(x, omega, sHat, x);
+        ScaledAdd(s, -omega, t, r);
+        relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+        if (omega == 0) {
+            return relativeResidual <= tol;
+        }
+    }
+    return true;
+}
+
+inline int BiCGSTAB::Iterations() const noexcept {
+    return iterations;
+}
+
+inline double BiCGSTAB::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+inline ConjugateGradient::ConjugateGradient(int n) : n(n), r(n), z(n), p(n), Ap(n) {
+    assert(n > 0);
+}
+
+inline bool ConjugateGradient::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b,
+                                     MutableVecView x, double tol, int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        Scale(0, b, x);
+        relativeResidual = 0;
+        return true;
+    }
+
+    // r = b - Ax
+    A(x, r);
+    ScaledAdd(b, -1, r, r);
+    relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+    ApplyPreconditioner(precond, r, z);
+    p = z;
+    double rz = Dot(r, z);
+    while (relativeResidual > tol) {
+        if (iterations >= maxIterations) {
+            return false;
+        }
+        ++iterations;
+
+        A(p, Ap);
+        double pAp = Dot(p, Ap);
+        if (pAp <= 0) {
+            // A不正定
+            return false;
+        }
+        double alpha = rz / pAp;
+        ScaledAdd(x, alpha, p, x);
+        ScaledAdd(r, -alpha, Ap, r);
+        relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+        ApplyPreconditioner(precond, r, z);
+        double rzNew = Dot(r, z);
+        ScaledAdd(z, rzNew / rz, p, p);
+        rz = rzNew;
+    }
+    return true;
+}
+
+inline int ConjugateGradient::Iterations() const noexcept {
+    return iterations;
+}
+
+inline double ConjugateGradient::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+inline JacobiPreconditioner::JacobiPreconditioner(const SparseMat &A) : invDiag(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        double d = A.Value(i, i);
+        if (d == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        invDiag[i] = 1 / d;
+    }
+}
+
+inline JacobiPreconditioner::JacobiPreconditioner(MatView A) : invDiag(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        double d = A.Value(i, i);
+        if (d == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        invDiag[i] = 1 / d;
+    }
+}
+
+inline void JacobiPreconditioner::operator()(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == static_cast<int>(invDiag.size()));
+    for (int i = 0; i < v.Size(); ++i) {
+        out[i] = invDiag[i] * v[i];
+    }
+}
+
+inline ILU0Preconditioner::ILU0Preconditioner(const SparseMat &A)
+    : n(A.Rows()), rowPtr(A.RowPointers()), colIndex(A.ColIndices()), lu(A.Values()), diagIndex(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < n; ++i) {
+        auto begin = colIndex.begin() + rowPtr[i];
+        auto end = colIndex.begin() + rowPtr[i + 1];
+        auto it = std::lower_bound(begin, end, i);
+        if (it == end || *it != i) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "ILU(0): missing diagonal entry");
+        }
+        diagIndex[i] = static_cast<int>(it - colIndex.begin());
+    }
+
+    // IKJ形式的高斯消元，只更新A中原有的非零元。pos[j]为第i行第j列的元素在lu中的下标，-1表示不存在
+    std::vector<int> pos(n, -1);
+    for (int i = 0; i < n; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            pos[colIndex[k]] = k;
+        }
+        for (int k = rowPtr[i]; k < diagIndex[i]; ++k) {
+            int col = colIndex[k];
+            double pivot = lu[diagIndex[col]];
+            if (pivot == 0) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+            }
+            double ratio = lu[k] /= pivot;
+            for (int kk = diagIndex[col] + 1; kk < rowPtr[col + 1]; ++kk) {
+                if (pos[colIndex[kk]] >= 0) {
+                    lu[pos[colIndex[kk]]] -= ratio * lu[kk];
+                }
+            }
+        }
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            pos[colIndex[k]] = -1;
+        }
+        if (lu[diagIndex[i]] == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+    }
+}
+
+inline void ILU0Preconditioner::operator()(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == n && out.Size() == n);
+
+    // Ly = v，L的对角元为1
+    for (int i = 0; i < n; ++i) {
+        double sum = v[i];
+        for (int k = rowPtr[i]; k < diagIndex[i]; ++k) {
+            sum -= lu[k] * out[colIndex[k]];
+        }
+        out[i] = sum;
+    }
+
+    // U·out = y
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = out[i];
+        for (int k = diagIndex[i] + 1; k < rowPtr[i + 1]; ++k) {
+            sum -= lu[k] * out[colIndex[k]];
+        }
+        out[i] = sum / lu[diagIndex[i]];
+    }
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+template <typename T>
+inline Node sin(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_SIN, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node cos(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_COS, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node tan(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_TAN, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node asin(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_ARCSIN, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node acos(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_ARCCOS, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node atan(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_ARCTAN, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node sqrt(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_SQRT, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node log(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_LOG, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node log2(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_LOG2, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node log10(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_LOG10, std::forward<T>(n));
+}
+
+template <typename T>
+inline Node exp(T &&n) noexcept {
+    return internal::UnaryOperator(MathOperator::MATH_EXP, std::forward<T>(n));
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * node对varname求导。在node包含多个变量时，是对varname求偏导。
+ * @exception runtime_error 如果表达式内包含AND(&) OR(|) MOD(%)这类不能求导的运算符，则抛出异常
+ */
+inline Node Diff(const Node &node, const std::string &varname, int i = 1);
+
+/**
+ * node对varname求导。在node包含多个变量时，是对varname求偏导。
+ * @exception runtime_error 如果表达式内包含AND(&) OR(|) MOD(%)这类不能求导的运算符，则抛出异常
+ */
+inline Node Diff(Node &&node, const std::string &varname, int i = 1);
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+class SymVec;
+class SymMat {
+public:
+    /**
+     *
+     */
+    SymMat(int rows, int cols) noexcept;
+
+    /**
+     * 使用初始化列表构造。注意列表内的对象将被强行移动至Vec内部。
+     */
+    SymMat(std::initializer_list<std::initializer_list<Node>> init) noexcept;
+
+    /**
+     * 从数值矩阵构造符号矩阵
+     */
+    SymMat(const Mat &rhs) noexcept;
+
+    SymMat Clone() const noexcept;
+
+    bool Empty() const noexcept;
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+    /**
+     * 输出Vec。如果列数不为1，抛出异常。
+     * @exception runtime_error 列数不为1
+     */
+    SymVec ToSymVec() const;
+
+    /**
+     * 逐个元素转换为符号向量（列向量）。
+     */
+    SymVec ToSymVecOneByOne() const noexcept;
+
+    /**
+     * 得到数值矩阵。前提条件是矩阵内的元素均为数值节点，否则抛出异常。
+     * @exception runtime_error 存在非数值节点
+     */
+    Mat ToMat() const;
+
+    /**
+     * 把矩阵的内的元素均计算为数值节点。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)
+     */
+    SymMat &Calc();
+
+    SymMat &Subs(const std::map<std::string, double> &varValues) noexcept;
+
+    SymMat &Subs(const VarsTable &varsTable) noexcept;
+
+    /**
+     * 返回符号矩阵内出现的所有变量名。
+     */
+    std::set<std::string> GetAllVarNames() const noexcept;
+
+    /**
+     * 如果rhs和自己的维数不匹配会触发assert。
+     */
+    SymMat operator-(const SymMat &rhs) const noexcept;
+
+    /**
+     *
+     * @exception MathError 维数不匹配
+     */
+    SymMat operator*(const SymMat &rhs) const;
+
+    /**
+     * 返回是否相等。
+     * 目前只能判断表达式树完全一致的情况。
+     * TODO 改为可以判断等价表达式
+     */
+    bool operator==(const SymMat &rhs) const noexcept;
+
+    Node &Value(int i, int j) noexcept;
+    const Node &Value(int i, int j) const noexcept;
+
+    std::string ToString() const noexcept;
+
+protected:
+    int rows, cols;
+    std::unique_ptr<std::valarray<Node>> data;
+
+    friend SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept;
+};
+
+class SymVec : public SymMat {
+public:
+    /**
+     *
+     */
+    SymVec(int rows) noexcept;
+
+    /**
+     * 使用初始化列表构造。注意列表内的对象将被强行移动至Vec内部。
+     */
+    SymVec(std::initializer_list<Node> init) noexcept;
+
+    /**
+     * 如果rhs和自己的维数不匹配会触发assert。
+     */
+    SymVec operator-(const SymVec &rhs) const noexcept;
+
+    Node &operator[](std::size_t index) noexcept;
+
+    const Node &operator[](std::size_t index) const noexcept;
+};
+
+inline SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept;
+
+inline std::ostream &operator<<(std::ostream &out, const SymMat &symMat) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+/**
+ * 用newNode节点替换oldVar指定的变量。
+ */
+inline Node Subs(const Node &node, const std::string &oldVar, const Node &newNode) noexcept;
+
+/**
+ * 用newNode节点替换oldVar指定的变量。
+ */
+inline Node Subs(Node &&node, const std::string &oldVar, const Node &newNode) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(const Node &node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(Node &&node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(const Node &node, const std::map<std::string, Node> &dict) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(Node &&node, const std::map<std::string, Node> &dict) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(const Node &node, const std::map<std::string, double> &varValues) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(Node &&node, const std::map<std::string, double> &varValues) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(const Node &node, const VarsTable &varsTable) noexcept;
+
+/**
+ * 用newNodes节点替换oldVars指定的变量。
+ */
+inline Node Subs(Node &&node, const VarsTable &varsTable) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace internal {
+
+class SubsFunctions {
+public:
+    // 前序遍历。非递归实现。
+    static Node SubsInner(Node node, const std::map<std::string, Node> &dict) noexcept {
+
+        std::stack<std::reference_wrapper<NodeImpl>> stk;
+
+        auto Replace = [&dict](Node &cur) {
+            if (cur->type != NodeType::VARIABLE) {
+                return false;
+            }
+
+            auto itor = dict.find(cur->varname);
+            if (itor == dict.end()) {
+                return false;
+            }
+
+            auto parent = cur->parent;
+            cur = Clone(itor->second);
+            cur->parent = parent;
+
+            return true;
+        };
+
+        if (!Replace(node)) {
+            auto TryReplace = [&stk, &Replace](Node &cur) {
+                if (cur && !Replace(cur)) {
+                    stk.emplace(*cur);
+                }
+            };
+
+            TryReplace(node->right);
+            TryReplace(node->left);
+
+            while (!stk.empty()) {
+                auto &f = stk.top().get();
+                stk.pop();
+                TryReplace(f.right);
+                TryReplace(f.left);
+            }
+        }
+
+#ifndef NDEBUG
+        node->CheckParent();
+#endif
+        return node;
+    }
+};
+
+} // namespace internal
+
+inline Node Subs(const Node &node, const std::string &oldVar, const Node &newNode) noexcept {
+    return Subs(Clone(node), oldVar, newNode);
+}
+
+inline Node Subs(Node &&node, const std::string &oldVar, const Node &newNode) noexcept {
+    std::map<std::string, Node> dict;
+    dict.insert({oldVar, Clone(newNode)});
+    return internal::SubsFunctions::SubsInner(Move(node), dict);
+}
+
+inline Node Subs(const Node &node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept {
+    return Subs(Clone(node), oldVars, newNodes);
+}
+
+inline Node Subs(Node &&node, const std::vector<std::string> &oldVars, const SymVec &newNodes) noexcept {
+    assert(static_cast<int>(oldVars.size()) == newNodes.Rows());
+    std::map<std::string, Node> dict;
+    for (size_t i = 0; i < oldVars.size(); ++i) {
+        dict.insert({oldVars[i], Clone(newNodes[i])});
+    }
+    return internal::SubsFunctions::SubsInner(Move(node), dict);
+}
+
+inline Node Subs(const Node &node, const std::map<std::string, Node> &dict) noexcept {
+    return Subs(Clone(node), dict);
+}
+
+inline Node Subs(Node &&node, const std::map<std::string, Node> &dict) noexcept {
+    return internal::SubsFunctions::SubsInner(Move(node), dict);
+}
+
+inline Node Subs(const Node &node, const std::map<std::string, double> &varValues) noexcept {
+    return Subs(Clone(node), varValues);
+}
+
+inline Node Subs(Node &&node, const std::map<std::string, double> &varValues) noexcept {
+    std::map<std::string, Node> dict;
+    for (auto &item : varValues) {
+        dict.insert({item.first, Num(item.second)});
+    }
+    return internal::SubsFunctions::SubsInner(Move(node), dict);
+}
+
+inline Node Subs(const Node &node, const VarsTable &varsTable) noexcept {
+    return Subs(Clone(node), varsTable);
+}
+
+inline Node Subs(Node &&node, const VarsTable &varsTable) noexcept {
+    std::map<std::string, Node> dict;
+    for (auto &item : varsTable) {
+        dict.insert({item.first, Num(item.second)});
+    }
+    return internal::SubsFunctions::SubsInner(Move(node), dict);
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline void Simplify(Node &node) noexcept;
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace internal {
+
+class SimplifyFunctions {
+public:
+    struct SimplifyNode {
+        NodeImpl &node;
+        bool isLeftChild;
+
+        SimplifyNode(NodeImpl &node) : node(node), isLeftChild(!node.parent || node.parent->left.get() == &node) {}
+    };
+
+    // 对单节点n进行化简。
+    static void SimplifySingleNode(std::unique_ptr<NodeImpl> &n) noexcept {
+        auto parent = n->parent;
+        switch (GetOperatorNum(n->op)) {
+        // 对于1元运算符，且儿子是数字的，直接计算出来
+        case 1:
+            if (n->left->type == NodeType::NUMBER) {
+                n->type = NodeType::NUMBER;
+                n->value = tomsolver::Calc(n->op, n->left->value, 0);
+                n->op = MathOperator::MATH_NULL;
+                n->left = nullptr;
+            }
+            break;
+
+        // 对于2元运算符
+        case 2:
+            // 儿子是数字的，直接计算出来
+            if (n->left->type == NodeType::NUMBER && n->right->type == NodeType::NUMBER) {
+                n->type = NodeType::NUMBER;
+                n->value = tomsolver::Calc(n->op, n->left->value, n->right->value);
+                n->op = MathOperator::MATH_NULL;
+                n->left = nullptr;
+                n->right = nullptr;
+                return;
+            }
+
+            assert(n->left && n->right);
+            bool lChildIs0 = n->left->type == NodeType::NUMBER && n->left->value == 0.0;
+            bool rChildIs0 = n->right->type == NodeType::NUMBER && n->right->value == 0.0;
+            bool lChildIs1 = n->left->type == NodeType::NUMBER && n->left->value == 1.0;
+            bool rChildIs1 = n->right->type == NodeType::NUMBER && n->right->value == 1.0;
+
+            // 任何数乘或被乘0、被0除、0的除0外的任何次方，等于0
+            if ((n->op == MathOperator::MATH_MULTIPLY && (lChildIs0 || rChildIs0)) ||
+                (n->op == MathOperator::MATH_DIVIDE && lChildIs0) || (n->op == MathOperator::MATH_POWER && lChildIs0)) {
+                n = Num(0);
+                n->parent = parent;
+                return;
+            }
+
+            // 任何数加或被加0、被减0、乘或被乘1、被1除、开1次方，等于自身
+            if ((n->op == MathOperator::MATH_ADD && (lChildIs0 || rChildIs0)) ||
+                (n->op == MathOperator::MATH_SUB && rChildIs0) ||
+                (n->op == MathOperator::MATH_MULTIPLY && (lChildIs1 || rChildIs1)) ||
+                (n->op == MathOperator::MATH_DIVIDE && rChildIs1) || (n->op == MathOperator::MATH_POWER && rChildIs1)) {
+
+                if (lChildIs1 || lChildIs0) {
+                    n->left = nullptr;
+                    n = Move(n->right);
+                    n->parent = parent;
+                } else if (rChildIs1 || rChildIs0) {
+                    n->right = nullptr;
+                    n = Move(n->left);
+                    n->parent = parent;
+                }
+                return;
+            }
+        }
+    }
+
+    // 后序遍历。非递归实现。
+    static void SimplifyWholeNode(Node &node) {
+
+        // 借助一个栈，得到反向的后序遍历序列，结果保存在revertedPostOrder。除了root节点，root节点不保存在revertedPostOrder里，最后单独化简。
+        std::stack<SimplifyNode> stk;
+        std::deque<SimplifyNode> revertedPostOrder;
+
+        auto popNode = [&stk] {
+            auto node = std::move(stk.top());
+            stk.pop();
+            return node;
+        };
+
+        // ==== Part I ====
+
+        if (node->type != NodeType::OPERATOR) {
+            return;
+        }
+
+        stk.push(SimplifyNode(*node.get()));
+
+        while (!stk.empty()) {
+            auto f = popNode();
+
+            if (f.node.left && f.node.left->type == NodeType::OPERATOR) {
+                stk.push(SimplifyNode(*f.node.left.get()));
+            }
+
+            if (f.node.right && f.node.right->type == NodeType::OPERATOR) {
+                stk.push(SimplifyNode(*f.node.right.get()));
+            }
+
+            revertedPostOrder.emplace_back(std::move(f));
+        }
+
+        // pop掉root，root最后单独处理
+        revertedPostOrder.pop_front();
+
+        // ==== Part II ====
+        std::for_each(revertedPostOrder.rbegin(), revertedPostOrder.rend(), [](SimplifyNode &snode) {
+            SimplifySingleNode(snode.isLeftChild ? snode.node.parent->left : snode.node.parent->right);
+        });
+
+        SimplifyFunctions::SimplifySingleNode(node);
+
+        return;
+
+        // if (GetOperateNum(now->eOperator) == 2) {
+
+        //    //任何节点的0次方均等于1，除了0的0次方已在前面报错
+        //    if (now->eOperator == MATH_POWER && RChildIs0) {
+        //        //替换掉当前运算符，这个1节点将在回溯时处理
+        //        //新建一个1节点
+        //        TNode *temp;
+        //        temp = new TNode;
+        //        temp->eType = NODE_NUMBER;
+        //        temp->value = 1;
+
+        //        // 0节点连接到上面
+        //        if (now != head) {
+        //            if (now->parent->left == now) {
+        //                now->parent->left = temp;
+        //                temp->parent = now->parent;
+        //            }
+        //            if (now->parent->right == now) {
+        //                now->parent->right = temp;
+        //                temp->parent = now->parent;
+        //            }
+        //        } else
+        //            head = temp;
+
+        //        DeleteNode(now);
+        //    }
+
+        //    // 0-x=-x
+        //    if (now->eOperator == MATH_SUB && LChildIs0) {
+        //        TNode *LChild = now->left;
+        //        TNode *RChild = now->right;
+        //        now->eOperator = MATH_NEGATIVE;
+        //        now->left = RChild;
+        //        now->right = NULL;
+
+        //        delete LChild;
+        //    }
+
+        //}
+    }
+};
+
+} // namespace internal
+
+inline void Simplify(Node &node) noexcept {
+    internal::SimplifyFunctions::SimplifyWholeNode(node);
+    return;
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace internal {
+
+class StringView {
+public:
+    constexpr StringView() noexcept = default;
+    constexpr StringView(const char *str, size_t len) noexcept : str{str}, len{len} {}
+    constexpr StringView(const char *str) noexcept : str{str} {
+        while (*str++) {
+            len++;
+        }
+    }
+    StringView(const std::string &str) noexcept : StringView{str.data(), str.size()} {}
+    constexpr StringView(const StringView &) noexcept = default;
+    constexpr StringView &operator=(const StringView &) noexcept = default;
+
+    constexpr auto begin() const noexcept {
+        return str;
+    }
+    constexpr auto end() const noexcept {
+        return str + len;
+    }
+    constexpr auto empty() const noexcept {
+        return !len;
+    }
+
+    auto toString() const noexcept {
+        return std::string{begin(), end()};
+    }
+
+    template <typename Stream>
+    friend Stream &operator<<(Stream &s, const internal::StringView &sv) {
+        s.rdbuf()->sputn(sv.str, sv.len);
         return s;
     }
-
-private:
-    const char *str = nullptr;
-    size_t len = 0;
+
+private:
+    const char *str = nullptr;
+    size_t len = 0;
+};
+
+template <typename Stream>
+inline void append(Stream &) {}
+
+template <typename Stream, typename T, typename... Ts>
+inline void append(Stream &s, T &&arg, Ts &&...args) {
+    s << std::forward<T>(arg);
+    append(s, std::forward<Ts>(args)...);
+}
+
+struct Token;
+} // namespace internal
+
+class ParseError : public std::runtime_error {
+public:
+protected:
+    ParseError() : std::runtime_error("parse error") {}
+};
+
+class SingleParseError : public ParseError {
+public:
+    template <typename... T>
+    SingleParseError(int line, int pos, internal::StringView content, T &&...errInfo)
+        : line(line), pos(pos), content(content) {
+        std::stringstream ss;
+
+        ss << "[Parse Error] ";
+        internal::append(ss, std::forward<T>(errInfo)...);
+        ss << " at(" << line << ", " << pos << "):\n"
+           << content << "\n"
+           << std::string(pos, ' ') << "^---- error position";
+
+        whatStr = ss.str();
+    }
+
+    virtual const char *what() const noexcept override;
+
+    int GetLine() const noexcept;
+
+    int GetPos() const noexcept;
+
+private:
+    int line;                     // the line index
+    int pos;                      // the position of character
+    internal::StringView content; // the whole content of the line
+    std::string whatStr;          // the whole error message
+};
+
+class MultiParseError : public ParseError {
+public:
+    MultiParseError(const std::vector<SingleParseError> &parseErrors);
+
+    virtual const char *what() const noexcept override;
+
+private:
+    std::vector<SingleParseError> parseErrors;
+    std::string whatStr; // the whole error message
+};
+
+namespace internal {
+
+struct Token {
+    Node node;                    // node
+    internal::StringView s;       // the string of this token
+    int line;                     // the line index
+    int pos;                      // the position of character
+    bool isBaseOperator;          // if is base operator (single-character operator or parenthesis)
+    internal::StringView content; // the whole content of the line
+    Token(int line, int pos, bool isBaseOperator, StringView s, StringView content)
+        : s(s), line(line), pos(pos), isBaseOperator(isBaseOperator), content(content) {}
+};
+
+class ParseFunctions {
+public:
+    /**
+     * 解析表达式字符串为in order记号流。其实就是做词法分析。
+     * @exception ParseError
+     */
+    static std::deque<Token> ParseToTokens(StringView expression);
+
+    /**
+     * 由in order序列得到post order序列。实质上是把记号流转化为逆波兰表达式。
+     * @exception ParseError
+     */
+    static std::vector<Token> InOrderToPostOrder(std::deque<Token> &inOrder);
+
+    /**
+     * 将PostOrder建立为树，并进行表达式有效性检验（确保二元及一元运算符、函数均有操作数）。
+     * @exception ParseError
+     */
+    static Node BuildExpressionTree(std::vector<Token> &postOrder);
+};
+
+} // namespace internal
+
+/**
+ * 把字符串解析为表达式。
+ * @exception ParseError
+ */
+inline Node Parse(internal::StringView expression);
+
+inline Node operator""_f(const char *exp, size_t);
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace {
+
+inline constexpr auto fnv1a(internal::StringView s) {
+    constexpr uint64_t offsetBasis = 14695981039346656037ul;
+    constexpr uint64_t prime = 1099511628211ul;
+
+    uint64_t hash = offsetBasis;
+
+    for (auto c : s) {
+        hash = (hash ^ c) * prime;
+    }
+
+    return hash;
+}
+
+inline constexpr auto operator""_fnv1a(const char *s, size_t) {
+    return fnv1a(s);
+}
+
+/* 是基本运算符()+-* /^&|% */
+inline bool IsBasicOperator(char c) noexcept {
+    switch (c) {
+    case '(':
+    case ')':
+    case '+':
+    case '-':
+    case '*':
+    case '/':
+    case '^':
+    case '&':
+    case '|':
+    case '%':
+        return true;
+    }
+    return false;
+}
+
+/*  */
+inline MathOperator BaseOperatorCharToEnum(char c, bool unary) noexcept {
+    switch (c) {
+    case '(':
+        return MathOperator::MATH_LEFT_PARENTHESIS;
+    case ')':
+        return MathOperator::MATH_RIGHT_PARENTHESIS;
+    case '+':
+        return unary ? MathOperator::MATH_POSITIVE : MathOperator::MATH_ADD;
+    case '-':
+        return unary ? MathOperator::MATH_NEGATIVE : MathOperator::MATH_SUB;
+    case '*':
+        return MathOperator::MATH_MULTIPLY;
+    case '/':
+        return MathOperator::MATH_DIVIDE;
+    case '^':
+        return MathOperator::MATH_POWER;
+    case '&':
+        return MathOperator::MATH_AND;
+    case '|':
+        return MathOperator::MATH_OR;
+    case '%':
+        return MathOperator::MATH_MOD;
+    default:
+        assert(0);
+    }
+    assert(0);
+    return MathOperator::MATH_NULL;
+}
+
+inline MathOperator Str2Function(internal::StringView s) noexcept {
+    switch (fnv1a(s)) {
+    case "sin"_fnv1a:
+        return MathOperator::MATH_SIN;
+    case "cos"_fnv1a:
+        return MathOperator::MATH_COS;
+    case "tan"_fnv1a:
+        return MathOperator::MATH_TAN;
+    case "arcsin"_fnv1a:
+        return MathOperator::MATH_ARCSIN;
+    case "arccos"_fnv1a:
+        return MathOperator::MATH_ARCCOS;
+    case "arctan"_fnv1a:
+        return MathOperator::MATH_ARCTAN;
+    case "sqrt"_fnv1a:
+        return MathOperator::MATH_SQRT;
+    case "log"_fnv1a:
+        return MathOperator::MATH_LOG;
+    case "log2"_fnv1a:
+        return MathOperator::MATH_LOG2;
+    case "log10"_fnv1a:
+        return MathOperator::MATH_LOG10;
+    case "exp"_fnv1a:
+        return MathOperator::MATH_EXP;
+    }
+    return MathOperator::MATH_NULL;
+}
+
+} // namespace
+
+inline const char *SingleParseError::what() const noexcept {
+    return whatStr.c_str();
+}
+
+inline int SingleParseError::GetLine() const noexcept {
+    return line;
+}
+
+inline int SingleParseError::GetPos() const noexcept {
+    return pos;
+}
+
+inline MultiParseError::MultiParseError(const std::vector<SingleParseError> &parseErrors) : parseErrors(parseErrors) {
+    std::stringstream ss;
+    std::transform(parseErrors.rbegin(), parseErrors.rend(), std::ostream_iterator<const char *>(ss, "\n"),
+                   [](const auto &err) {
+                       return err.what();
+                   });
+    whatStr = ss.str();
+}
+
+inline const char *MultiParseError::what() const noexcept {
+    return whatStr.c_str();
+}
+
+namespace internal {
+
+inline std::deque<Token> ParseFunctions::ParseToTokens(StringView content) {
+
+    if (content.empty()) {
+        throw SingleParseError(0, 0, "empty input", content);
+    }
+
+    auto iter = content.begin(), nameIter = iter;
+    std::deque<Token> ret;
+
+    auto tryComfirmToken = [&ret, &iter, &nameIter, &content] {
+        if (size_t size = std::distance(nameIter, iter)) {
+            auto exp = StringView{&*nameIter, size};
+            ret.emplace_back(0, static_cast<int>(std::distance(content.begin(), nameIter)), false, exp, content);
+            auto &token = ret.back();
+
+            auto expStr = exp.toString();
+            // 检验是否为浮点数
+            try {
+                std::size_t sz;
+                auto d = std::stod(expStr, &sz);
+                if (sz == expStr.size()) {
+                    token.node = Num(d);
+                    return;
+                }
+            } catch (...) {}
+
+            auto op = Str2Function(exp);
+            if (op != MathOperator::MATH_NULL) {
+                token.node = Op(op);
+                return;
+            }
+
+            // 变量
+            // 非运算符、数字、函数
+            if (!VarNameIsLegal(expStr)) // 变量名首字符需为下划线或字母
+            {
+                throw SingleParseError(token.line, token.pos, exp, "Invalid variable name: \"", exp, "\"");
+            }
+
+            token.node = Var(expStr);
+        }
+    };
+
+    while (iter != content.end()) {
+        if (IsBasicOperator(*iter)) {
+            tryComfirmToken();
+            auto unaryOp = ret.empty() || (ret.back().node->type == NodeType::OPERATOR &&
+                                           ret.back().node->op != MathOperator::MATH_RIGHT_PARENTHESIS);
+            ret.emplace_back(0, static_cast<int>(std::distance(content.begin(), iter)), true, StringView{&*iter, 1},
+                             content);
+            ret.back().node = Op(BaseOperatorCharToEnum(*iter, unaryOp));
+            nameIter = ++iter;
+        } else if (isspace(*iter)) {
+            // 忽略tab (\t) whitespaces (\n, \v, \f, \r) space
+            tryComfirmToken();
+            nameIter = ++iter;
+        } else {
+            ++iter;
+        }
+    }
+
+    tryComfirmToken();
+
+    return ret;
+}
+
+inline std::vector<Token> ParseFunctions::InOrderToPostOrder(std::deque<Token> &inOrder) {
+    std::vector<Token> postOrder;
+    int parenthesisBalance = 0;
+    std::stack<Token> tokenStack;
+
+    auto popToken = [&tokenStack] {
+        auto r = std::move(tokenStack.top());
+        tokenStack.pop();
+        return r;
+    };
+
+    while (!inOrder.empty()) {
+        auto f = std::move(inOrder.front());
+        inOrder.pop_front();
+
+        switch (f.node->type) {
+        // 数字直接入栈
+        case NodeType::NUMBER:
+        case NodeType::VARIABLE:
+            postOrder.emplace_back(std::move(f));
+            continue;
+        case NodeType::OPERATOR:
+            break;
+        default:
+            assert(0);
+        };
+
+        switch (f.node->op) {
+        case MathOperator::MATH_LEFT_PARENTHESIS:
+            parenthesisBalance++;
+            break;
+
+        case MathOperator::MATH_POSITIVE:
+        case MathOperator::MATH_NEGATIVE:
+            break;
+
+        case MathOperator::MATH_RIGHT_PARENTHESIS:
+            if (parenthesisBalance == 0) {
+                throw SingleParseError(f.line, f.pos, f.content, "Parenthesis not match: \"", f.s, "\"");
+            }
+            for (auto token = popToken(); token.node->op != MathOperator::MATH_LEFT_PARENTHESIS; token = popToken()) {
+                postOrder.emplace_back(std::move(token));
+            }
+            if (!tokenStack.empty() && IsFunction(tokenStack.top().node->op)) {
+                postOrder.emplace_back(popToken());
+            }
+            while (!tokenStack.empty() && (tokenStack.top().node->op == MathOperator::MATH_POSITIVE ||
+                                           tokenStack.top().node->op == MathOperator::MATH_NEGATIVE)) {
+                postOrder.emplace_back(popToken());
+            }
+            continue;
+
+        default:
+            // 不是括号也不是正负号
+            if (!tokenStack.empty()) {
+                auto compare =
+                    IsLeft2Right(f.node->op)
+                        ? std::function<bool(const Token &)>{[cmp = std::less_equal<>{}, rank = Rank(f.node->op)](
+                                                                 const Token
+                                                                     &token) { // 左结合，则挤出高优先级及同优先级符号
+                              return cmp(rank, Rank(token.node->op));
+                          }}
+                        : std::function<bool(const Token &)>{
+                              [cmp = std::less<>{}, rank = Rank(f.node->op)](
+                                  const Token &token) { // 右结合，则挤出高优先级，但不挤出同优先级符号
+                                  return cmp(rank, Rank(token.node->op));
+                              }};
+
+                while (!tokenStack.empty() && compare(tokenStack.top())) {
+                    postOrder.push_back(std::move(tokenStack.top())); // 符号进入post队列
+                    tokenStack.pop();
+                }
+            }
+            break;
+        }
+
+        tokenStack.push(std::move(f)); // 高优先级已全部挤出，当前符号入栈
+    }
+
+    // 剩下的元素全部入栈
+    while (!tokenStack.empty()) {
+        auto token = popToken();
+
+        // 退栈时出现左括号，说明没有找到与之匹配的右括号
+        if (token.node->op == MathOperator::MATH_LEFT_PARENTHESIS) {
+            throw SingleParseError(token.line, token.pos, token.content, "Parenthesis not match: \"", token.s, "\"");
+        }
+
+        postOrder.emplace_back(std::move(token));
+    }
+
+    return postOrder;
+}
+
+// 将PostOrder建立为树，并进行表达式有效性检验（确保二元及一元运算符、函数均有操作数）
+inline Node ParseFunctions::BuildExpressionTree(std::vector<Token> &postOrder) {
+    std::stack<Token> tokenStack;
+    auto pushToken = [&tokenStack](Token &token) {
+        tokenStack.emplace(std::move(token));
+    };
+    auto popNode = [&tokenStack] {
+        auto node = std::move(tokenStack.top().node);
+        tokenStack.pop();
+        return node;
+    };
+    // 逐个识别PostOrder序列，构建表达式树
+    for (auto &token : postOrder) {
+        switch (token.node->type) {
+        case NodeType::OPERATOR:
+            if (GetOperatorNum(token.node->op) == 2) {
+                if (tokenStack.empty()) {
+                    throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
+                }
+
+                tokenStack.top().node->parent = token.node.get();
+                token.node->right = popNode();
+
+                if (tokenStack.empty()) {
+                    throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
+                }
+
+                tokenStack.top().node->parent = token.node.get();
+                token.node->left = popNode();
+
+                pushToken(token);
+                continue;
+            }
+
+            // 一元运算符
+            assert(GetOperatorNum(token.node->op) == 1);
+
+            if (tokenStack.empty()) {
+                throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
+            }
+
+            tokenStack.top().node->parent = token.node.get();
+            token.node->left = popNode();
+
+            break;
+
+        case NodeType::NUMBER:
+        case NodeType::VARIABLE:
+        default:
+            break;
+        }
+
+        pushToken(token);
+    }
+
+    // 如果现在临时栈里面有超过1个元素，那么除了栈顶，其他的都代表出错
+    if (tokenStack.size() > 1) {
+        // 扔掉最顶上的，构造到一半的表达式
+        tokenStack.pop();
+
+        std::vector<SingleParseError> errors;
+        while (!tokenStack.empty()) {
+            Token &token = tokenStack.top();
+            errors.emplace_back(token.line, token.pos, token.content, "Parse Error at: \"", token.s, "\"");
+            tokenStack.pop();
+        }
+        throw MultiParseError(errors);
+    }
+
+    return popNode();
+}
+
+} // namespace internal
+
+inline Node Parse(internal::StringView expression) {
+    auto tokens = internal::ParseFunctions::ParseToTokens(expression);
+    auto postOrder = internal::ParseFunctions::InOrderToPostOrder(tokens);
+    auto node = internal::ParseFunctions::BuildExpressionTree(postOrder);
+    return node;
+}
+
+inline Node operator""_f(const char *exp, size_t) {
+    return Parse(exp);
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+enum class MultiStartMode {
+    FIRST_CONVERGED, // 第一个收敛的初值得到的根，其余初值的求解随即取消
+    ALL_ROOTS        // 所有初值得到的互不相同的根
+};
+
+/**
+ * 多初值求解的选项。
+ */
+struct MultiStartOptions {
+    MultiStartMode mode = MultiStartMode::ALL_ROOTS;
+
+    /**
+     * 工作线程数量（包括调用者所在的线程）。为0时取std::thread::hardware_concurrency()。不超过初值数量。
+     */
+    int threads = 0;
+
+    /**
+     * 两个根的每个分量之差的绝对值都小于rootTolerance时，视为同一个根。
+     */
+    double rootTolerance = 1.0e-6;
+};
+
+/**
+ * 从多个初值出发独立地求解非线性方程组equations，各初值的求解分配到多个线程中并行进行。
+ * 方程组与雅可比矩阵只做一次符号求导和编译，各线程只读共享。求解方法为Config::Get().nonlinearMethod，
+ * 具体见internal::SolveCompiled。各工作线程都使用调用者所在线程的Config::Get()（见ConfigScope）。
+ * 没有收敛的初值（迭代次数超出限制、雅可比矩阵奇异、超出定义域、发散、停滞等）不影响其他初值，直接忽略。
+ * @param starts: 初值。所有初值的变量及其顺序必须相同
+ * @return FIRST_CONVERGED模式下最多一个根；ALL_ROOTS模式下为去重后的所有根，按得到该根的第一个初值的顺序排列。
+ *         没有初值收敛时为空
+ * @exception MathError 初值的变量不一致
+ */
+inline std::vector<VarsTable> SolveMultiStart(const SymVec &equations, const std::vector<VarsTable> &starts,
+                                              const MultiStartOptions &options = {});
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+namespace internal {
+
+class DiffFunctions {
+public:
+    struct DiffNode {
+        NodeImpl &node;
+        const bool isLeftChild;
+
+        DiffNode(NodeImpl &node) : node(node), isLeftChild(node.parent && node.parent->left.get() == &node) {}
+    };
+
+    static void DiffOnce(Node &root, const std::string &varname) {
+        std::queue<DiffNode> q;
+
+        if (root->type == NodeType::OPERATOR) {
+            DiffOnceOperator(root, q);
+        } else {
+            q.emplace(*root);
+        }
+
+        while (!q.empty()) {
+            auto &node = q.front().node;
+            auto isLeftChild = q.front().isLeftChild;
+            q.pop();
+
+            switch (node.type) {
+            case NodeType::VARIABLE:
+                node.type = NodeType::NUMBER;
+                node.value = node.varname == varname ? 1 : 0;
+                node.varname = "";
+                break;
+
+            case NodeType::NUMBER:
+                node.value = 0;
+                break;
+
+            case NodeType::OPERATOR: {
+                auto &child = isLeftChild ? node.parent->left : node.parent->right;
+                DiffOnceOperator(child, q);
+                break;
+            }
+            default:
+                assert(0 && "inner bug");
+            }
+        }
+    }
+
+    static void DiffOnceOperator(Node &node, std::queue<DiffNode> &q) {
+        auto parent = node->parent;
+
+        // 调用前提：node是1元操作符
+        // 如果node的成员是数字，那么整个node变为数字节点，value=0，且返回true
+        // 例如： sin(1)' = 0
+        auto CullNumberMember = [&node]() -> bool {
+            assert(GetOperatorNum(node->op) == 1);
+            assert(node->left);
+            if (node->left->type == NodeType::NUMBER) {
+                node->left = nullptr;
+                node->type = NodeType::NUMBER;
+                node->op = MathOperator::MATH_NULL;
+                node->value = 0.0;
+                return true;
+            }
+            return false;
+        };
+
+        // 调用前提：node是2元操作符
+        // 如果node的成员是数字，那么整个node变为数字节点，value=0，且返回true
+        // 例如： (2*3)' = 0
+        auto CullNumberMemberBinary = [&node]() -> bool {
+            assert(GetOperatorNum(node->op) == 2);
+            assert(node->left && node->right);
+            if (node->left->type == NodeType::NUMBER && node->right->type == NodeType::NUMBER) {
+                node->left = nullptr;
+                node->right = nullptr;
+                node->type = NodeType::NUMBER;
+                node->op = MathOperator::MATH_NULL;
+                node->value = 0.0;
+                return true;
+            }
+            return false;
+        };
+
+        switch (node->op) {
+        case MathOperator::MATH_NULL: {
+            assert(0 && "inner bug");
+            break;
+        }
+        case MathOperator::MATH_POSITIVE:
+        case MathOperator::MATH_NEGATIVE: {
+            q.emplace(*node->left);
+            return;
+        }
+
+        // 函数
+        case MathOperator::MATH_SIN: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // sin(u)' = cos(u) * u'
+            node->op = MathOperator::MATH_COS;
+            auto u2 = Clone(node->left);
+            q.emplace(*u2);
+            node = Move(node) * Move(u2);
+            node->parent = parent;
+            break;
+        }
+        case MathOperator::MATH_COS: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // cos(u)' = -sin(u) * u'
+            node->op = MathOperator::MATH_SIN;
+            auto u2 = Clone(node->left);
+            q.emplace(*u2);
+            node = -Move(node) * Move(u2);
+            node->parent = parent;
+            break;
+        }
+        case MathOperator::MATH_TAN: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // tan'u = 1/(cos(u)^2) * u'
+            node->op = MathOperator::MATH_COS;
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = Num(1) / (Move(node) ^ Num(2)) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_ARCSIN: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // asin'u = 1/sqrt(1-u^2) * u'
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(1) / sqrt(Num(1) - (Move(u) ^ Num(2)))) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_ARCCOS: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // acos'u = -1/sqrt(1-u^2) * u'
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(-1) / sqrt(Num(1) - (Move(u) ^ Num(2)))) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_ARCTAN: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // atan'u = 1/(1+u^2) * u'
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(1) / (Num(1) + (Move(u) ^ Num(2)))) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_SQRT: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // sqrt(u)' = 1/(2*sqrt(u)) * u'
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = Num(1) / (Num(2) * Move(node)) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_LOG: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // ln(u)' = 1/u * u'
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(1) / Move(u)) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_LOG2: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // loga(u)' = 1/(u * ln(a)) * u'
+            auto a = 2.0;
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(1) / (Move(u) * Num(std::log(a)))) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_LOG10: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // loga(u)' = 1/(u * ln(a)) * u'
+            auto a = 10.0;
+            auto &u = node->left;
+            auto u2 = Clone(u);
+            q.emplace(*u2);
+            node = (Num(1) / (Move(u) * Num(std::log(a)))) * Move(u2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_EXP: {
+            if (CullNumberMember()) {
+                return;
+            }
+
+            // e^x=e^x
+            if (node->left->type == NodeType::VARIABLE)
+                return;
+
+            // (e^u)' = e^u * u'
+            auto u2 = Clone(node->left);
+            q.emplace(*u2);
+            node = Move(node) * Move(u2);
+            node->parent = parent;
+            break;
+        }
+
+        // 二元
+        case MathOperator::MATH_ADD:
+        case MathOperator::MATH_SUB:
+            if (CullNumberMemberBinary()) {
+                return;
+            }
+            // (u + v)' = u' + v'
+            if (node->left) {
+                q.emplace(*node->left);
+            }
+            if (node->right) {
+                q.emplace(*node->right);
+            }
+            return;
+        case MathOperator::MATH_MULTIPLY: {
+            // 两个操作数中有一个是数字
+            if (node->left->type == NodeType::NUMBER) {
+                q.emplace(*node->right);
+                return;
+            }
+            if (node->right->type == NodeType::NUMBER) {
+                q.emplace(*node->left);
+                return;
+            }
+
+            if (CullNumberMemberBinary()) {
+                return;
+            }
+
+            // (u*v)' = u' * v + u * v'
+            auto &u = node->left;
+            auto &v = node->right;
+            q.emplace(*u);
+            auto u2 = Clone(u);
+            auto v2 = Clone(v);
+            q.emplace(*v2);
+            node = Move(node) + Move(u2) * Move(v2);
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_DIVIDE: {
+            // auto leftIsNumber = node->left->type == NodeType::NUMBER;
+            auto rightIsNumber = node->right->type == NodeType::NUMBER;
+
+            // f(x)/number = f'(x)/number
+            if (rightIsNumber) {
+                q.emplace(*node->left);
+                return;
+            }
+
+            if (CullNumberMemberBinary()) {
+                return;
+            }
+
+            // (u/v)' = (u'v - uv')/(v^2)
+            auto &u = node->left;
+            auto &v = node->right;
+            auto u2 = Clone(u);
+            auto v2 = Clone(v);
+            auto v3 = Clone(v);
+            q.emplace(*u);
+            q.emplace(*v2);
+            node = (Move(u) * Move(v) - Move(u2) * Move(v2)) / (Move(v3) ^ Num(2));
+            node->parent = parent;
+            return;
+        }
+        case MathOperator::MATH_POWER: {
+            // 如果两个操作数都是数字
+            if (CullNumberMemberBinary()) {
+                return;
+            }
+
+            auto lChildIsNumber = node->left->type == NodeType::NUMBER;
+            auto rChildIsNumber = node->right->type == NodeType::NUMBER;
+
+            // (u^a)' = a*u^(a-1) * u'
+            if (rChildIsNumber) {
+                auto &a = node->right;
+                auto aValue = a->value;
+                auto &u = node->left;
+                auto u2 = Clone(u);
+                q.emplace(*u2);
+                node = std::move(a) * (std::move(u) ^ Num(aValue - 1)) * std::move(u2);
+                node->parent = parent;
+                return;
+            }
+
+            // (a^x)' = a^x * ln(a)  when a>0 and a!=1
+            if (lChildIsNumber) {
+                auto &a = node->left;
+                auto aValue = a->value;
+                auto &u = node->right;
+                auto u2 = Clone(u);
+                q.emplace(*u2);
+                node = (std::move(a) ^ std::move(u)) * log(Num(aValue)) * std::move(u2);
+                node->parent = parent;
+                return;
+            }
+
+            // (u^v)' = ( e^(v*ln(u)) )' = e^(v*ln(u)) * (v*ln(u))' = u^v * (v*ln(u))'
+            // 左右都不是数字
+            auto &u = node->left;
+            auto &v = node->right;
+            auto vln_u = Clone(v) * log(Clone(u));
+            q.emplace(*vln_u);
+            node = Move(node) * std::move(vln_u);
+            node->parent = parent;
+            return;
+        }
+
+        case MathOperator::MATH_AND: {
+            throw std::runtime_error("can not apply diff for AND(&) operator");
+            return;
+        }
+        case MathOperator::MATH_OR: {
+            throw std::runtime_error("can not apply diff for OR(|) operator");
+            return;
+        }
+        case MathOperator::MATH_MOD: {
+            throw std::runtime_error("can not apply diff for MOD(%) operator");
+            return;
+        }
+        case MathOperator::MATH_LEFT_PARENTHESIS:
+        case MathOperator::MATH_RIGHT_PARENTHESIS:
+            assert(0 && "inner bug");
+            return;
+        default:
+            assert(0 && "inner bug");
+            return;
+        }
+    }
 };
 
-template <typename Stream>
-inline void append(Stream &) {}
+} // namespace internal
 
-template <typename Stream, typename T, typename... Ts>
-inline void append(Stream &s, T &&arg, Ts &&...args) {
-    s << std::forward<T>(arg);
-    append(s, std::forward<Ts>(args)...);
+inline Node Diff(const Node &node, const std::string &varname, int i) {
+    auto node2 = Clone(node);
+    return Diff(std::move(node2), varname, i);
 }
 
-struct Token;
-} // namespace internal
-
-class ParseError : public std::runtime_error {
-public:
-protected:
-    ParseError() : std::runtime_error("parse error") {}
-};
+inline Node Diff(Node &&node, const std::string &varname, int i) {
+    assert(i > 0);
+    auto n = std::move(node);
+    while (i--) {
+        internal::DiffFunctions::DiffOnce(n, varname);
+    }
+#ifndef NDEBUG
+    auto s = n->ToString();
+    n->CheckParent();
+#endif
+    Simplify(n);
+#ifndef NDEBUG
+    n->CheckParent();
+#endif
+    return n;
+}
 
-class SingleParseError : public ParseError {
-public:
-    template <typename... T>
-    SingleParseError(int line, int pos, internal::StringView content, T &&...errInfo)
-        : line(line), pos(pos), content(content) {
-        std::stringstream ss;
+} // namespace tomsolver
 
-        ss << "[Parse Error] ";
-        internal::append(ss, std::forward<T>(errInfo)...);
-        ss << " at(" << line << ", " << pos << "):\n"
-           << content << "\n"
-           << std::string(pos, ' ') << "^---- error position";
+namespace tomsolver {
 
-        whatStr = ss.str();
-    }
+namespace internal {
+class CompileFunctions;
+}
 
-    virtual const char *what() const noexcept override;
+/**
+ * 编译后的符号矩阵，用于在迭代中反复求值。
+ * 构造时把每个元素的表达式树转换为一段逆波兰指令（后序遍历序列），变量替换为输入数组的下标。
+ * 之后每次求值只是顺序执行这些指令：不复制、不替换节点树，栈深度不超过64时也不申请堆内存。
+ *
+ * 求值的标量类型T由调用者选择，可以是float、double或long double。常数以double保存，求值时转换为T。
+ * 例如先用float快速筛选大量初值的残差，再对筛选出的初值用double精确求解。
+ * 求值不修改对象本身，多个线程可以同时使用同一个CompiledSymMat。
+ *
+ * 构造时还可以指定一组参数：参数不是未知量，求值时取SetParams设置的值，修改参数值不需要重新求导和编译。
+ * SetParams会修改对象，多个线程使用不同的参数值时，每个线程使用自己的副本。
+ */
+class CompiledSymMat {
+public:
+    /**
+     * 编译符号矩阵mat。求值时x[i]为vars[i]的值。
+     * @exception MathError 表达式中出现vars以外的变量
+     */
+    CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars);
 
-    int GetLine() const noexcept;
+    /**
+     * 编译符号矩阵mat。求值时x[i]为vars[i]的值，params[i]的值由SetParams设置，初始为0。
+     * @exception MathError 表达式中出现vars和params以外的变量
+     * @exception MathError vars和params中有重复的名字
+     */
+    CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars, const std::vector<std::string> &params);
 
-    int GetPos() const noexcept;
+    int Rows() const noexcept;
 
-private:
-    int line;                     // the line index
-    int pos;                      // the position of character
-    internal::StringView content; // the whole content of the line
-    std::string whatStr;          // the whole error message
-};
+    int Cols() const noexcept;
 
-class MultiParseError : public ParseError {
-public:
-    MultiParseError(const std::vector<SingleParseError> &parseErrors);
+    /**
+     * 变量数量，即求值时x的长度。
+     */
+    int VarNums() const noexcept;
 
-    virtual const char *what() const noexcept override;
+    /**
+     * 参数数量。
+     */
+    int ParamNums() const noexcept;
 
-private:
-    std::vector<SingleParseError> parseErrors;
-    std::string whatStr; // the whole error message
-};
+    /**
+     * 设置参数的值，values[i]为构造时params[i]的值。复杂度为O(ParamNums())。
+     */
+    void SetParams(VecView values) noexcept;
 
-namespace internal {
+    /**
+     * 以标量类型T求值。x的长度为VarNums()，结果按行连续写入out，长度为Rows() * Cols()。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    template <typename T>
+    void Eval(const T *x, T *out) const {
+        if (maxDepth <= INLINE_STACK_SIZE) {
+            T stk[INLINE_STACK_SIZE];
+            Run(x, out, stk);
+        } else {
+            std::vector<T> stk(maxDepth);
+            Run(x, out, stk.data());
+        }
+    }
 
-struct Token {
-    Node node;                    // node
-    internal::StringView s;       // the string of this token
-    int line;                     // the line index
-    int pos;                      // the position of character
-    bool isBaseOperator;          // if is base operator (single-character operator or parenthesis)
-    internal::StringView content; // the whole content of the line
-    Token(int line, int pos, bool isBaseOperator, StringView s, StringView content)
-        : s(s), line(line), pos(pos), isBaseOperator(isBaseOperator), content(content) {}
-};
+    /**
+     * 同时对W组自变量求值，用于SIMD批量求解。数据按路交错存放（AoSoA）：x[i * W + l]为第l组的第i个变量，
+     * params[i * W + l]为第l组的第i个参数（不使用SetParams设置的值），结果写入out[e * W + l]。
+     * 每条指令对W组数据连续计算，编译器可以将其向量化。
+     * 不抛出异常：任何一步运算出现浮点数无效值(inf, -inf, nan)的组将invalid[l]置为true，其余组不受影响。
+     */
+    template <int W>
+    void EvalLanes(const double *x, const double *params, double *out, bool *invalid) const {
+        if (maxDepth <= INLINE_STACK_SIZE) {
+            double stk[INLINE_STACK_SIZE * W];
+            RunLanes<W>(x, params, out, invalid, stk);
+        } else {
+            std::vector<double> stk(maxDepth * W);
+            RunLanes<W>(x, params, out, invalid, stk.data());
+        }
+    }
 
-class ParseFunctions {
-public:
     /**
-     * 解析表达式字符串为in order记号流。其实就是做词法分析。
-     * @exception ParseError
+     * 以double求值，返回数值矩阵。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
      */
-    static std::deque<Token> ParseToTokens(StringView expression);
+    Mat Eval(VecView x) const;
 
     /**
-     * 由in order序列得到post order序列。实质上是把记号流转化为逆波兰表达式。
-     * @exception ParseError
+     * 以double求值，结果写入out。out的尺寸必须为Rows()×Cols()，尺寸相同时不申请堆内存。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
      */
-    static std::vector<Token> InOrderToPostOrder(std::deque<Token> &inOrder);
+    void Eval(VecView x, Mat &out) const;
 
     /**
-     * 将PostOrder建立为树，并进行表达式有效性检验（确保二元及一元运算符、函数均有操作数）。
-     * @exception ParseError
+     * 以options代替Config::Get()，以double求值，返回数值矩阵。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且options.throwOnInvalidValue为true
      */
-    static Node BuildExpressionTree(std::vector<Token> &postOrder);
-};
+    Mat Eval(VecView x, const SolverOptions &options) const;
 
-} // namespace internal
+private:
+    enum class OpCode { NUMBER, VARIABLE, PARAMETER, UNARY, BINARY };
 
-/**
- * 把字符串解析为表达式。
- * @exception ParseError
- */
-inline Node Parse(internal::StringView expression);
+    struct Instruction {
+        OpCode code;
+        MathOperator op;
+        int index;    // VARIABLE时为变量下标，PARAMETER时为参数下标
+        double value; // NUMBER时为常数
+    };
 
-inline Node operator""_f(const char *exp, size_t);
+    static constexpr int INLINE_STACK_SIZE = 64;
+
+    int rows;
+    int cols;
+    int varNums;
+    int maxDepth = 0;
+
+    // 所有元素的指令按行连续存放，第i个元素的指令为[ends[i - 1], ends[i])
+    std::vector<Instruction> program;
+    std::vector<int> ends;
+    std::vector<double> params;
+
+    template <typename T>
+    void Run(const T *x, T *out, T *stk) const {
+        int begin = 0;
+        for (int e = 0; e < static_cast<int>(ends.size()); ++e) {
+            int top = -1;
+            for (int pc = begin; pc < ends[e]; ++pc) {
+                const Instruction &ins = program[pc];
+                switch (ins.code) {
+                case OpCode::NUMBER:
+                    stk[++top] = static_cast<T>(ins.value);
+                    break;
+                case OpCode::VARIABLE:
+                    stk[++top] = x[ins.index];
+                    break;
+                case OpCode::PARAMETER:
+                    stk[++top] = static_cast<T>(params[ins.index]);
+                    break;
+                case OpCode::UNARY:
+                    stk[top] = tomsolver::Calc<T>(ins.op, stk[top], T(0));
+                    break;
+                case OpCode::BINARY:
+                    --top;
+                    stk[top] = tomsolver::Calc<T>(ins.op, stk[top], stk[top + 1]);
+                    break;
+                }
+            }
+            out[e] = stk[0];
+            begin = ends[e];
+        }
+    }
+
+    template <int W>
+    void RunLanes(const double *x, const double *lanesParams, double *out, bool *invalid, double *stk) const {
+        int begin = 0;
+        for (int e = 0; e < static_cast<int>(ends.size()); ++e) {
+            int top = -1;
+            for (int pc = begin; pc < ends[e]; ++pc) {
+                const Instruction &ins = program[pc];
+                switch (ins.code) {
+                case OpCode::NUMBER:
+                    ++top;
+                    std::fill(stk + top * W, stk + (top + 1) * W, ins.value);
+                    break;
+                case OpCode::VARIABLE:
+                    ++top;
+                    std::copy(x + ins.index * W, x + (ins.index + 1) * W, stk + top * W);
+                    break;
+                case OpCode::PARAMETER:
+                    ++top;
+                    std::copy(lanesParams + ins.index * W, lanesParams + (ins.index + 1) * W, stk + top * W);
+                    break;
+                case OpCode::UNARY:
+                    tomsolver::CalcLanes<W>(ins.op, stk + top * W, stk + top * W, invalid);
+                    break;
+                case OpCode::BINARY:
+                    --top;
+                    tomsolver::CalcLanes<W>(ins.op, stk + top * W, stk + (top + 1) * W, invalid);
+                    break;
+                }
+            }
+            std::copy(stk, stk + W, out + e * W);
+            begin = ends[e];
+        }
+    }
+
+    friend class internal::CompileFunctions;
+};
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
-namespace {
-
-inline constexpr auto fnv1a(internal::StringView s) {
-    constexpr uint64_t offsetBasis = 14695981039346656037ul;
-    constexpr uint64_t prime = 1099511628211ul;
+namespace internal {
 
-    uint64_t hash = offsetBasis;
+class CompileFunctions {
+public:
+    // 后序遍历。非递归实现。把node的逆波兰指令追加到compiled.program，返回求值过程中栈的最大深度。
+    static int CompileNode(const NodeImpl &node, const std::map<std::string, int> &varIndex,
+                           CompiledSymMat &compiled) {
+        using Instruction = CompiledSymMat::Instruction;
+        using OpCode = CompiledSymMat::OpCode;
+
+        // 借助一个栈，得到反向的后序遍历序列
+        std::stack<std::reference_wrapper<const NodeImpl>> stk;
+        std::vector<std::reference_wrapper<const NodeImpl>> revertedPostOrder;
+        stk.emplace(node);
+        while (!stk.empty()) {
+            const auto &cur = stk.top().get();
+            stk.pop();
+            if (cur.left) {
+                stk.emplace(*cur.left);
+            }
+            if (cur.right) {
+                stk.emplace(*cur.right);
+            }
+            revertedPostOrder.emplace_back(cur);
+        }
 
-    for (auto c : s) {
-        hash = (hash ^ c) * prime;
+        int depth = 0, maxDepth = 0;
+        for (auto it = revertedPostOrder.rbegin(); it != revertedPostOrder.rend(); ++it) {
+            const auto &cur = it->get();
+            switch (cur.type) {
+            case NodeType::NUMBER:
+                compiled.program.push_back(Instruction{OpCode::NUMBER, MathOperator::MATH_NULL, 0, cur.value});
+                ++depth;
+                break;
+            case NodeType::VARIABLE: {
+                auto itor = varIndex.find(cur.varname);
+                if (itor == varIndex.end()) {
+                    throw MathError(ErrorType::ERROR_UNDEFINED_VARIABLE, cur.varname);
+                }
+                // 下标不小于变量数量的是参数
+                if (itor->second < compiled.varNums) {
+                    compiled.program.push_back(
+                        Instruction{OpCode::VARIABLE, MathOperator::MATH_NULL, itor->second, 0});
+                } else {
+                    compiled.program.push_back(
+                        Instruction{OpCode::PARAMETER, MathOperator::MATH_NULL, itor->second - compiled.varNums, 0});
+                }
+                ++depth;
+                break;
+            }
+            case NodeType::OPERATOR:
+                switch (GetOperatorNum(cur.op)) {
+                case 1:
+                    compiled.program.push_back(Instruction{OpCode::UNARY, cur.op, 0, 0});
+                    break;
+                case 2:
+                    compiled.program.push_back(Instruction{OpCode::BINARY, cur.op, 0, 0});
+                    --depth;
+                    break;
+                default:
+                    assert(0 && "[CompileNode] unsupported operator num");
+                    break;
+                }
+                break;
+            }
+            maxDepth = std::max(maxDepth, depth);
+        }
+        assert(depth == 1);
+        return maxDepth;
     }
+};
 
-    return hash;
-}
+} // namespace internal
 
-inline constexpr auto operator""_fnv1a(const char *s, size_t) {
-    return fnv1a(s);
-}
+inline CompiledSymMat::CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars)
+    : CompiledSymMat(mat, vars, {}) {}
 
-/* 是基本运算符()+-* /^&|% */
-inline bool IsBasicOperator(char c) noexcept {
-    switch (c) {
-    case '(':
-    case ')':
-    case '+':
-    case '-':
-    case '*':
-    case '/':
-    case '^':
-    case '&':
-    case '|':
-    case '%':
-        return true;
+inline CompiledSymMat::CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars,
+                                      const std::vector<std::string> &params)
+    : rows(mat.Rows()), cols(mat.Cols()), varNums(static_cast<int>(vars.size())), params(params.size(), 0) {
+    std::map<std::string, int> varIndex;
+    for (int i = 0; i < varNums; ++i) {
+        varIndex.emplace(vars[i], i);
+    }
+    for (int i = 0; i < static_cast<int>(params.size()); ++i) {
+        if (!varIndex.emplace(params[i], varNums + i).second) {
+            throw MathError(ErrorType::ERROR_VAR_HAS_BEEN_DEFINED, params[i]);
+        }
     }
-    return false;
-}
 
-/*  */
-inline MathOperator BaseOperatorCharToEnum(char c, bool unary) noexcept {
-    switch (c) {
-    case '(':
-        return MathOperator::MATH_LEFT_PARENTHESIS;
-    case ')':
-        return MathOperator::MATH_RIGHT_PARENTHESIS;
-    case '+':
-        return unary ? MathOperator::MATH_POSITIVE : MathOperator::MATH_ADD;
-    case '-':
-        return unary ? MathOperator::MATH_NEGATIVE : MathOperator::MATH_SUB;
-    case '*':
-        return MathOperator::MATH_MULTIPLY;
-    case '/':
-        return MathOperator::MATH_DIVIDE;
-    case '^':
-        return MathOperator::MATH_POWER;
-    case '&':
-        return MathOperator::MATH_AND;
-    case '|':
-        return MathOperator::MATH_OR;
-    case '%':
-        return MathOperator::MATH_MOD;
-    default:
-        assert(0);
+    ends.reserve(rows * cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            maxDepth = std::max(maxDepth, internal::CompileFunctions::CompileNode(*mat.Value(i, j), varIndex, *this));
+            ends.push_back(static_cast<int>(program.size()));
+        }
     }
-    assert(0);
-    return MathOperator::MATH_NULL;
 }
 
-inline MathOperator Str2Function(internal::StringView s) noexcept {
-    switch (fnv1a(s)) {
-    case "sin"_fnv1a:
-        return MathOperator::MATH_SIN;
-    case "cos"_fnv1a:
-        return MathOperator::MATH_COS;
-    case "tan"_fnv1a:
-        return MathOperator::MATH_TAN;
-    case "arcsin"_fnv1a:
-        return MathOperator::MATH_ARCSIN;
-    case "arccos"_fnv1a:
-        return MathOperator::MATH_ARCCOS;
-    case "arctan"_fnv1a:
-        return MathOperator::MATH_ARCTAN;
-    case "sqrt"_fnv1a:
-        return MathOperator::MATH_SQRT;
-    case "log"_fnv1a:
-        return MathOperator::MATH_LOG;
-    case "log2"_fnv1a:
-        return MathOperator::MATH_LOG2;
-    case "log10"_fnv1a:
-        return MathOperator::MATH_LOG10;
-    case "exp"_fnv1a:
-        return MathOperator::MATH_EXP;
-    }
-    return MathOperator::MATH_NULL;
+inline int CompiledSymMat::Rows() const noexcept {
+    return rows;
+}
+
+inline int CompiledSymMat::Cols() const noexcept {
+    return cols;
 }
 
-} // namespace
+inline int CompiledSymMat::VarNums() const noexcept {
+    return varNums;
+}
 
-inline const char *SingleParseError::what() const noexcept {
-    return whatStr.c_str();
+inline int CompiledSymMat::ParamNums() const noexcept {
+    return static_cast<int>(params.size());
 }
 
-inline int SingleParseError::GetLine() const noexcept {
-    return line;
+inline void CompiledSymMat::SetParams(VecView values) noexcept {
+    assert(values.Size() == ParamNums());
+    for (int i = 0; i < values.Size(); ++i) {
+        params[i] = values[i];
+    }
 }
 
-inline int SingleParseError::GetPos() const noexcept {
-    return pos;
+inline Mat CompiledSymMat::Eval(VecView x) const {
+    Mat ret(rows, cols);
+    Eval(x, ret);
+    return ret;
 }
 
-inline MultiParseError::MultiParseError(const std::vector<SingleParseError> &parseErrors) : parseErrors(parseErrors) {
-    std::stringstream ss;
-    std::transform(parseErrors.rbegin(), parseErrors.rend(), std::ostream_iterator<const char *>(ss, "\n"),
-                   [](const auto &err) {
-                       return err.what();
-                   });
-    whatStr = ss.str();
+inline Mat CompiledSymMat::Eval(VecView x, const SolverOptions &options) const {
+    ConfigScope scope(options);
+    return Eval(x);
 }
 
-inline const char *MultiParseError::what() const noexcept {
-    return whatStr.c_str();
+inline void CompiledSymMat::Eval(VecView x, Mat &out) const {
+    assert(x.Size() == varNums);
+    assert(out.Rows() == rows && out.Cols() == cols);
+    double *pOut = std::addressof(out.Value(0, 0));
+    if (x.IsContiguous()) {
+        Eval(x.Data(), pOut);
+        return;
+    }
+    Vec xc(x);
+    Eval(std::addressof(xc[0]), pOut);
 }
 
-namespace internal {
+} // namespace tomsolver
 
-inline std::deque<Token> ParseFunctions::ParseToTokens(StringView content) {
+namespace tomsolver {
 
-    if (content.empty()) {
-        throw SingleParseError(0, 0, "empty input", content);
-    }
+/**
+ * 批量求解中每一组参数的求解结果。
+ */
+enum class BatchStatus {
+    CONVERGED,       // 收敛
+    ITERATION_LIMIT, // 迭代次数超出限制
+    SINGULAR,        // 雅可比矩阵奇异
+    INVALID_NUMBER,  // 迭代点超出定义域，出现浮点数无效值
+    DIVERGED,        // 迭代发散
+    STAGNATED        // 迭代停滞
+};
 
-    auto iter = content.begin(), nameIter = iter;
-    std::deque<Token> ret;
+/**
+ * 批量求解的选项。
+ */
+struct BatchOptions {
+    /**
+     * 工作线程数量（包括调用者所在的线程）。为0时取std::thread::hardware_concurrency()。不超过参数的组数。
+     */
+    int threads = 0;
 
-    auto tryComfirmToken = [&ret, &iter, &nameIter, &content] {
-        if (size_t size = std::distance(nameIter, iter)) {
-            auto exp = StringView{&*nameIter, size};
-            ret.emplace_back(0, static_cast<int>(std::distance(content.begin(), nameIter)), false, exp, content);
-            auto &token = ret.back();
+    /**
+     * 是否使用SIMD批量求解：求解方法为NEWTON_RAPHSON、方程数量等于未知数数量且不超过8个时，
+     * 每8组参数按路交错存放（AoSoA）打包为一批，同时求值、同时做LU分解，已经结束的组不再更新。
+     * 每一组的计算与逐组求解相同，只是减少了解释执行和循环的开销，并且可以被编译器向量化。
+     */
+    bool laneBatched = true;
+};
 
-            auto expStr = exp.toString();
-            // 检验是否为浮点数
-            try {
-                std::size_t sz;
-                auto d = std::stod(expStr, &sz);
-                if (sz == expStr.size()) {
-                    token.node = Num(d);
-                    return;
-                }
-            } catch (...) {}
+struct BatchResult {
+    /**
+     * 第i行为第i组参数的解，第j列对应unknowns[j]。没有收敛的行为迭代中止时的值。
+     */
+    Mat solutions;
 
-            auto op = Str2Function(exp);
-            if (op != MathOperator::MATH_NULL) {
-                token.node = Op(op);
-                return;
-            }
+    /**
+     * 第i组参数的求解结果。
+     */
+    std::vector<BatchStatus> status;
+};
 
-            // 变量
-            // 非运算符、数字、函数
-            if (!VarNameIsLegal(expStr)) // 变量名首字符需为下划线或字母
-            {
-                throw SingleParseError(token.line, token.pos, exp, "Invalid variable name: \"", exp, "\"");
-            }
+/**
+ * 对多组参数求解同一个非线性方程组。方程组中除unknowns以外的符号都是参数，第i组参数的值为parameterRows的第i行。
+ * 方程组与雅可比矩阵只做一次符号求导和编译，之后每组参数只需要设置参数值（见CompiledSymMat::SetParams），
+ * 各组参数的求解分配到多个线程中并行进行。求解方法为Config::Get().nonlinearMethod，具体见internal::SolveCompiled。
+ * @param parameterNames: 参数名，第j个参数的值为parameterRows的第j列
+ * @param parameterRows: 每行一组参数
+ * @param initialGuesses: 初值，第j列对应unknowns[j]。只有一行时所有参数组都使用这个初值，否则行数与parameterRows相同
+ * @exception MathError 矩阵的尺寸与unknowns、parameterNames不一致
+ * @exception MathError 方程组中出现unknowns与parameterNames以外的变量
+ * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量
+ */
+inline BatchResult SolveBatch(const SymVec &equations, const std::vector<std::string> &unknowns,
+                              const std::vector<std::string> &parameterNames, const Mat &parameterRows, const Mat &initialGuesses, const BatchOptions &options = {});
 
-            token.node = Var(expStr);
-        }
-    };
+} // namespace tomsolver
 
-    while (iter != content.end()) {
-        if (IsBasicOperator(*iter)) {
-            tryComfirmToken();
-            auto unaryOp = ret.empty() || (ret.back().node->type == NodeType::OPERATOR &&
-                                           ret.back().node->op != MathOperator::MATH_RIGHT_PARENTHESIS);
-            ret.emplace_back(0, static_cast<int>(std::distance(content.begin(), iter)), true, StringView{&*iter, 1},
-                             content);
-            ret.back().node = Op(BaseOperatorCharToEnum(*iter, unaryOp));
-            nameIter = ++iter;
-        } else if (isspace(*iter)) {
-            // 忽略tab (\t) whitespaces (\n, \v, \f, \r) space
-            tryComfirmToken();
-            nameIter = ++iter;
-        } else {
-            ++iter;
+namespace tomsolver {
+
+using DataType = std::valarray<Node>;
+
+inline SymMat::SymMat(int rows, int cols) noexcept : rows(rows), cols(cols) {
+    assert(rows > 0 && cols > 0);
+    data.reset(new DataType(rows * cols));
+}
+
+inline SymMat::SymMat(std::initializer_list<std::initializer_list<Node>> init) noexcept {
+    rows = static_cast<int>(init.size());
+    cols = static_cast<int>(std::max(init, [](auto lhs, auto rhs) {
+                                return lhs.size() < rhs.size();
+                            }).size());
+    data.reset(new DataType(rows * cols));
+
+    auto i = 0;
+    for (auto val : init) {
+        auto j = 0;
+        for (auto &node : val) {
+            (*data)[i * cols + j++] = std::move(const_cast<Node &>(node));
         }
+        i++;
     }
+}
 
-    tryComfirmToken();
+inline SymMat::SymMat(const Mat &rhs) noexcept : SymMat(rhs.Rows(), rhs.Cols()) {
+    std::generate(std::begin(*data), std::end(*data), [p = std::addressof(rhs.Value(0, 0))]() mutable {
+        return Num(*p++);
+    });
+}
 
+inline SymMat SymMat::Clone() const noexcept {
+    SymMat ret(Rows(), Cols());
+    std::generate(std::begin(*ret.data), std::end(*ret.data), [iter = std::begin(*data)]() mutable {
+        return tomsolver::Clone(*iter++);
+    });
     return ret;
 }
 
-inline std::vector<Token> ParseFunctions::InOrderToPostOrder(std::deque<Token> &inOrder) {
-    std::vector<Token> postOrder;
-    int parenthesisBalance = 0;
-    std::stack<Token> tokenStack;
+inline bool SymMat::Empty() const noexcept {
+    return data->size() == 0;
+}
 
-    auto popToken = [&tokenStack] {
-        auto r = std::move(tokenStack.top());
-        tokenStack.pop();
-        return r;
-    };
+inline int SymMat::Rows() const noexcept {
+    return rows;
+}
 
-    while (!inOrder.empty()) {
-        auto f = std::move(inOrder.front());
-        inOrder.pop_front();
+inline int SymMat::Cols() const noexcept {
+    return cols;
+}
 
-        switch (f.node->type) {
-        // 数字直接入栈
-        case NodeType::NUMBER:
-        case NodeType::VARIABLE:
-            postOrder.emplace_back(std::move(f));
-            continue;
-        case NodeType::OPERATOR:
-            break;
-        default:
-            assert(0);
-        };
+inline SymVec SymMat::ToSymVec() const {
+    assert(rows > 0);
+    if (cols != 1) {
+        throw std::runtime_error("SymMat::ToSymVec fail. rows is not one");
+    }
+    return ToSymVecOneByOne();
+}
 
-        switch (f.node->op) {
-        case MathOperator::MATH_LEFT_PARENTHESIS:
-            parenthesisBalance++;
-            break;
+inline SymVec SymMat::ToSymVecOneByOne() const noexcept {
+    SymVec v(rows * cols);
+    std::generate(std::begin(*v.data), std::end(*v.data), [iter = std::begin(*data)]() mutable {
+        return tomsolver::Clone(*iter++);
+    });
+    return v;
+}
 
-        case MathOperator::MATH_POSITIVE:
-        case MathOperator::MATH_NEGATIVE:
-            break;
+inline Mat SymMat::ToMat() const {
+    std::valarray<double> newData(data->size());
+    std::generate(std::begin(newData), std::end(newData), [iter = std::begin(*data)]() mutable {
+        if ((**iter).type != NodeType::NUMBER) {
+            throw std::runtime_error("ToMat error: node is not number");
+        }
+        return (**iter++).value;
+    });
+    return {rows, cols, newData};
+}
 
-        case MathOperator::MATH_RIGHT_PARENTHESIS:
-            if (parenthesisBalance == 0) {
-                throw SingleParseError(f.line, f.pos, f.content, "Parenthesis not match: \"", f.s, "\"");
-            }
-            for (auto token = popToken(); token.node->op != MathOperator::MATH_LEFT_PARENTHESIS; token = popToken()) {
-                postOrder.emplace_back(std::move(token));
-            }
-            if (!tokenStack.empty() && IsFunction(tokenStack.top().node->op)) {
-                postOrder.emplace_back(popToken());
-            }
-            while (!tokenStack.empty() && (tokenStack.top().node->op == MathOperator::MATH_POSITIVE ||
-                                           tokenStack.top().node->op == MathOperator::MATH_NEGATIVE)) {
-                postOrder.emplace_back(popToken());
-            }
-            continue;
+inline SymMat &SymMat::Calc() {
+    for (auto &node : *data) {
+        node->Calc();
+    }
+    return *this;
+}
 
-        default:
-            // 不是括号也不是正负号
-            if (!tokenStack.empty()) {
-                auto compare =
-                    IsLeft2Right(f.node->op)
-                        ? std::function<bool(const Token &)>{[cmp = std::less_equal<>{}, rank = Rank(f.node->op)](
-                                                                 const Token
-                                                                     &token) { // 左结合，则挤出高优先级及同优先级符号
-                              return cmp(rank, Rank(token.node->op));
-                          }}
-                        : std::function<bool(const Token &)>{
-                              [cmp = std::less<>{}, rank = Rank(f.node->op)](
-                                  const Token &token) { // 右结合，则挤出高优先级，但不挤出同优先级符号
-                                  return cmp(rank, Rank(token.node->op));
-                              }};
+inline SymMat &SymMat::Subs(const std::map<std::string, double> &varValues) noexcept {
+    for (auto &node : *data) {
+        node = tomsolver::Subs(std::move(node), varValues);
+    }
+    return *this;
+}
+
+inline SymMat &SymMat::Subs(const VarsTable &varsTable) noexcept {
+    for (auto &node : *data) {
+        node = tomsolver::Subs(std::move(node), varsTable);
+    }
+    return *this;
+}
+
+inline std::set<std::string> SymMat::GetAllVarNames() const noexcept {
+    std::set<std::string> ret;
+    for (auto &node : *data) {
+        auto names = node->GetAllVarNames();
+        ret.insert(names.begin(), names.end());
+    }
+    return ret;
+}
+
+inline SymMat SymMat::operator-(const SymMat &rhs) const noexcept {
+    assert(rhs.rows == rows && rhs.cols == cols);
+    SymMat ret(rows, cols);
+    std::generate(std::begin(*ret.data), std::end(*ret.data),
+                  [lhsIter = std::begin(*data), rhsIter = std::begin(*rhs.data)]() mutable {
+                      return *lhsIter++ - *rhsIter++;
+                  });
+    return ret;
+}
 
-                while (!tokenStack.empty() && compare(tokenStack.top())) {
-                    postOrder.push_back(std::move(tokenStack.top())); // 符号进入post队列
-                    tokenStack.pop();
-                }
+inline SymMat SymMat::operator*(const SymMat &rhs) const {
+    if (cols != rhs.rows) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    }
+
+    SymMat ans(rows, rhs.cols);
+    for (int i = 0; i < Rows(); ++i) {
+        for (int j = 0; j < rhs.cols; ++j) {
+            auto sum = Value(i, 0) * rhs.Value(0, j);
+            for (int k = 1; k < cols; ++k) {
+                sum += Value(i, k) * rhs.Value(k, j);
             }
-            break;
+            ans.Value(i, j) = Move(sum);
         }
+    }
+    return ans;
+}
 
-        tokenStack.push(std::move(f)); // 高优先级已全部挤出，当前符号入栈
+inline bool SymMat::operator==(const SymMat &rhs) const noexcept {
+    if (rhs.rows != rows || rhs.cols != cols) {
+        return false;
     }
+    return std::equal(std::begin(*data), std::end(*data), std::begin(*rhs.data), [](auto &node1, auto &node2) {
+        return node1->Equal(node2);
+    });
+}
 
-    // 剩下的元素全部入栈
-    while (!tokenStack.empty()) {
-        auto token = popToken();
+inline Node &SymMat::Value(int i, int j) noexcept {
+    return (*data)[i * cols + j];
+}
 
-        // 退栈时出现左括号，说明没有找到与之匹配的右括号
-        if (token.node->op == MathOperator::MATH_LEFT_PARENTHESIS) {
-            throw SingleParseError(token.line, token.pos, token.content, "Parenthesis not match: \"", token.s, "\"");
-        }
+inline const Node &SymMat::Value(int i, int j) const noexcept {
+    return (*data)[i * cols + j];
+}
 
-        postOrder.emplace_back(std::move(token));
+inline std::string SymMat::ToString() const noexcept {
+    if (data->size() == 0) {
+        return "[]\n";
     }
 
-    return postOrder;
+    std::stringstream ss;
+    ss << "[";
+
+    size_t i = 0;
+    for (auto &node : *data) {
+        ss << (i == 0 ? "" : " ") << node->ToString();
+        i++;
+        ss << (i % cols == 0 ? (i == data->size() ? "]\n" : "\n") : ", ");
+    }
+
+    return ss.str();
 }
 
-// 将PostOrder建立为树，并进行表达式有效性检验（确保二元及一元运算符、函数均有操作数）
-inline Node ParseFunctions::BuildExpressionTree(std::vector<Token> &postOrder) {
-    std::stack<Token> tokenStack;
-    auto pushToken = [&tokenStack](Token &token) {
-        tokenStack.emplace(std::move(token));
-    };
-    auto popNode = [&tokenStack] {
-        auto node = std::move(tokenStack.top().node);
-        tokenStack.pop();
-        return node;
-    };
-    // 逐个识别PostOrder序列，构建表达式树
-    for (auto &token : postOrder) {
-        switch (token.node->type) {
-        case NodeType::OPERATOR:
-            if (GetOperatorNum(token.node->op) == 2) {
-                if (tokenStack.empty()) {
-                    throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
-                }
+inline SymVec::SymVec(int rows) noexcept : SymMat(rows, 1) {}
 
-                tokenStack.top().node->parent = token.node.get();
-                token.node->right = popNode();
+inline SymVec::SymVec(std::initializer_list<Node> init) noexcept : SymMat(static_cast<int>(init.size()), 1) {
+    auto i = 0;
+    for (auto &node : init) {
+        (*data)[i++] = std::move(const_cast<Node &>(node));
+    }
+}
 
-                if (tokenStack.empty()) {
-                    throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
-                }
+inline SymVec SymVec::operator-(const SymVec &rhs) const noexcept {
+    return SymMat::operator-(rhs).ToSymVec();
+}
 
-                tokenStack.top().node->parent = token.node.get();
-                token.node->left = popNode();
+inline Node &SymVec::operator[](std::size_t index) noexcept {
+    return (*data)[index];
+}
 
-                pushToken(token);
-                continue;
-            }
+inline const Node &SymVec::operator[](std::size_t index) const noexcept {
+    return (*data)[index];
+}
 
-            // 一元运算符
-            assert(GetOperatorNum(token.node->op) == 1);
+inline SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept {
+    int rows = equations.rows;
+    int cols = static_cast<int>(vars.size());
+    SymMat ja(rows, cols);
+    std::generate(std::begin(*ja.data), std::end(*ja.data),
+                  [iter = std::begin(*equations.data), &vars, i = size_t{0}]() mutable {
+                      if (i == vars.size()) {
+                          i = 0;
+                          iter++;
+                      }
+                      return Diff(*iter, vars[i++]);
+                  });
+    return ja;
+}
 
-            if (tokenStack.empty()) {
-                throw MathError{ErrorType::ERROR_WRONG_EXPRESSION};
-            }
+inline std::ostream &operator<<(std::ostream &out, const SymMat &symMat) noexcept {
+    return out << symMat.ToString();
+}
 
-            tokenStack.top().node->parent = token.node.get();
-            token.node->left = popNode();
+} // namespace tomsolver
 
-            break;
+namespace tomsolver {
 
-        case NodeType::NUMBER:
-        case NodeType::VARIABLE:
-        default:
-            break;
-        }
+/**
+ * 带参数的非线性方程组。参数（例如连杆长度、目标位置）与未知量分开声明：
+ * 构造时只对未知量求一次雅可比矩阵并编译，参数编译为CompiledSymMat的参数槽。
+ * 之后修改参数值（Rebind）的复杂度为O(参数数量)，不做任何符号运算；求解时也不再求导、编译。
+ * 不需要在每次求解前用Subs或拼接字符串把已知量代入方程组。
+ *
+ * Rebind修改对象，Solve不修改对象。多个线程使用不同的参数值时，每个线程使用自己的副本。
+ */
+class ParametricSystem {
+public:
+    /**
+     * @param equations 方程组
+     * @param unknowns 未知量
+     * @param params 参数，初始值均为0
+     * @exception MathError 方程组中出现unknowns和params以外的变量
+     * @exception MathError unknowns和params中有重复的名字
+     */
+    ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                     const std::vector<std::string> &params);
 
-        pushToken(token);
-    }
+    /**
+     * 参数名为params.Vars()，初始值为params.Values()。
+     * @exception MathError 同上
+     */
+    ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns, const VarsTable &params);
 
-    // 如果现在临时栈里面有超过1个元素，那么除了栈顶，其他的都代表出错
-    if (tokenStack.size() > 1) {
-        // 扔掉最顶上的，构造到一半的表达式
-        tokenStack.pop();
+    const std::vector<std::string> &Unknowns() const noexcept;
 
-        std::vector<SingleParseError> errors;
-        while (!tokenStack.empty()) {
-            Token &token = tokenStack.top();
-            errors.emplace_back(token.line, token.pos, token.content, "Parse Error at: \"", token.s, "\"");
-            tokenStack.pop();
-        }
-        throw MultiParseError(errors);
-    }
+    const std::vector<std::string> &Params() const noexcept;
 
-    return popNode();
-}
+    /**
+     * 设置全部参数的值，values[i]为Params()[i]的值。复杂度为O(参数数量)，不申请内存。
+     */
+    void Rebind(VecView values) noexcept;
 
-} // namespace internal
+    /**
+     * 按名字设置参数的值，params中没有出现的参数保持原值。
+     * @exception MathError params中有不是参数的变量，此时所有参数都保持原值
+     */
+    void Rebind(const VarsTable &params);
 
-inline Node Parse(internal::StringView expression) {
-    auto tokens = internal::ParseFunctions::ParseToTokens(expression);
-    auto postOrder = internal::ParseFunctions::InOrderToPostOrder(tokens);
-    auto node = internal::ParseFunctions::BuildExpressionTree(postOrder);
-    return node;
-}
+    /**
+     * 以当前的参数值计算方程组的值F(q)。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    Vec Eval(VecView q) const;
 
-inline Node operator""_f(const char *exp, size_t) {
-    return Parse(exp);
-}
+    /**
+     * 以当前的参数值求解，调用时q为初值，返回时为解。反复求解时可以直接用上一次的解作为初值。
+     * 求解方法为Config::Get().nonlinearMethod，具体见internal::SolveCompiled。
+     * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+     * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散或停滞
+     */
+    void Solve(Vec &q) const;
+
+    /**
+     * 以当前的参数值求解，初值为initialValues。initialValues的变量必须与Unknowns()相同，顺序可以不同。
+     * @return 未知量的解，变量顺序与Unknowns()相同
+     * @exception MathError initialValues的变量与Unknowns()不一致
+     * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+     * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散或停滞
+     */
+    VarsTable Solve(const VarsTable &initialValues) const;
+
+private:
+    std::vector<std::string> unknowns;
+    std::vector<std::string> params;
+    std::map<std::string, int> paramIndex;
+    std::vector<double> values; // 当前的参数值
+    CompiledSymMat f;
+    CompiledSymMat df;
+};
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
 /**
- * Armijo方法一维搜索，寻找alpha
+ * Armijo方法一维搜索，寻找alpha。f(x)与df(x)只计算一次，最多回溯LineSearch::MAX_BACKTRACKING次。
+ * 试探点处出现浮点数无效值时视为步长过大。
+ * @return 找到的alpha；回溯次数用完仍不满足条件时返回0
  */
 inline double Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df);
 
+/**
+ * 同上，alpha通过参数返回。
+ * @return 是否找到满足条件的alpha。返回false时alpha为最后一次试探的步长，调用者应改用其他方法
+ */
+inline bool Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df, double &alpha);
+
 /**
  * 割线法 进行一维搜索，寻找alpha
  */
@@ -3690,33 +9278,186 @@ inline double FindAlpha(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, d
 /**
  * 解非线性方程组equations。
  * 初值及变量名通过varsTable传入。
- * @exception runtime_error 迭代次数超出限制
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
  */
 inline VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &varsTable);
 
 /**
- * 解非线性方程组equations。
+ * 用Levenberg-Marquardt方法解非线性方程组equations，方程数量可以不等于未知数数量。
  * 初值及变量名通过varsTable传入。
- * @exception runtime_error 迭代次数超出限制
+ * 雅可比矩阵只在接受试探步后计算一次，阻尼系数按增益比以Nielsen方法更新，并以JᵀJ的对角元缩放。
+ * 试探点超出定义域（出现浮点数无效值）时视为步长过大，增大阻尼后重试。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
  */
 inline VarsTable SolveByLM(const SymVec &equations, const VarsTable &varsTable);
 
 /**
- * Solve a system of nonlinear equations.
- * Initial values and variable names are passed through varsTable. Will not use the Config::Get().initialValue
- * @param equations: The system of equations. Essentially, it is a symbolic vector.
- * @param varsTable: The table of initial values.
- * @throws tomsolver::MathError: If the number of iterations exceeds the limit.
+ * 用Powell折线法（信赖域方法，参考MINPACK的hybrj）解非线性方程组equations，方程数量可以不等于未知数数量。
+ * 初值及变量名通过varsTable传入。
+ * 每一步在信赖域内组合高斯-牛顿步与最速下降方向上的Cauchy步。雅可比矩阵只在接受试探步后计算并分解一次，
+ * 试探步被拒绝时只缩小信赖域，不再重新求解。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ */
+inline VarsTable SolveByDogleg(const SymVec &equations, const VarsTable &varsTable);
+
+/**
+ * 多算法组合求解非线性方程组equations（NonlinearMethod::AUTO）。
+ * 初值及变量名通过varsTable传入。
+ * 先使用不带一维搜索的牛顿法，只要||F||每步都明显缩小就一直使用牛顿步；出现以下情况之一时，保留当前的迭代点，
+ * 改用LM方法迭代到收敛：雅可比矩阵奇异或病态（按LU分解的条件数估计）、牛顿步超出定义域、||F||收缩不够。
+ * 迭代次数在两个阶段中累计。方程数量不等于未知数数量时直接使用LM方法。
+ * 与先用牛顿法求解、失败后再换方法从头求解相比，困难的情况不必付出两次求解的时间。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ */
+inline VarsTable SolveByPolyalgorithm(const SymVec &equations, const VarsTable &varsTable);
+
+/**
+ * 用Jacobian-free Newton-Krylov方法解非线性方程组equations，方程数量必须等于未知数数量。
+ * 初值及变量名通过varsTable传入。
+ * 不构造雅可比矩阵：每个牛顿步用重启GMRES求解，J·v由方程组沿v方向的差商近似，内存为O(n·restart)，
+ * 适合未知数很多的方程组。GMRES的参数见Config::krylovRestart、krylovTolerance、maxKrylovIterations。
+ * @param preconditioner: 每个牛顿步开始时以当前的q调用一次，返回本步使用的预条件子M⁻¹ ≈ J⁻¹。
+ *                        为nullptr时不使用预条件
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError 方程数量不等于未知数数量
+ */
+inline VarsTable SolveByNewtonKrylov(const SymVec &equations, const VarsTable &varsTable,
+                                     const std::function<LinearOperator(VecView q)> &preconditioner = nullptr);
+
+/**
+ * 用Anderson加速的不动点迭代解方程组x = G(x)，G的行数必须等于未知数数量，G的第i行对应varsTable的第i个变量。
+ * 初值及变量名通过varsTable传入。
+ * 不需要雅可比矩阵：每次迭代只计算一次G，再用最近Config::Get().andersonDepth次的残差解一个小规模最小二乘问题，
+ * 外推得到下一个点。以G(x) - x作为残差，收敛、发散与停滞的判断见ConvergenceMonitor。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError G的行数不等于未知数数量
+ */
+inline VarsTable SolveFixedPoint(const SymVec &G, const VarsTable &varsTable);
+
+/**
+ * Solve a system of nonlinear equations.
+ * Initial values and variable names are passed through varsTable. Will not use the Config::Get().initialValue
+ * @param equations: The system of equations. Essentially, it is a symbolic vector.
+ * @param varsTable: The table of initial values.
+ * @throws tomsolver::MathError: If the number of iterations exceeds the limit.
+ */
+inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable);
+
+/**
+ * Solve the equations.
+ * Variable names are obtained by analyzing the equations. Initial values are obtained through Config::Get().
+ * Every variable is treated as an unknown. For equations with known parameters that change between solves, see
+ * ParametricSystem.
+ * @param equations: The system of equations. Essentially, it is a symbolic vector.
+ * @throws tomsolver::MathError: If the number of iterations exceeds the limit.
+ */
+inline VarsTable Solve(const SymVec &equations);
+
+/**
+ * 以options代替Config::Get()求解，不读取也不修改全局配置，多个线程可以同时用不同的options求解。其余同上。
+ */
+inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable, const SolverOptions &options);
+
+/**
+ * 以options代替Config::Get()求解，初值为options.initialValue。其余同上。
+ */
+inline VarsTable Solve(const SymVec &equations, const SolverOptions &options);
+
+namespace internal {
+
+/**
+ * 用编译后的方程组f与雅可比矩阵df，按method从q开始迭代求解，返回时q为解。
+ * 不修改f与df，多个线程可以同时用同一组f、df求解不同的初值。monitor用于收敛判断，可以预先设置取消标志。
+ * NEWTON_RAPHSON为不带一维搜索、不复用分解结果的牛顿法；NEWTON_KRYLOV不使用df，也不使用预条件子。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散、停滞或被取消
+ */
+inline void SolveCompiled(NonlinearMethod method, const CompiledSymMat &f, const CompiledSymMat &df, Vec &q,
+                          ConvergenceMonitor &monitor);
+
+} // namespace internal
+
+/**
+ * 用牛顿-拉夫森法解N元非线性方程组f(x) = 0，N在编译期确定。
+ * 迭代过程中的向量、雅可比矩阵和LU分解都存放在栈上，不申请堆内存；f与jacobian不申请内存时，整个求解过程不申请内存。
+ * @param f: 计算方程组的值，形如FixedVec<N>(const FixedVec<N> &x)
+ * @param jacobian: 计算雅可比矩阵，形如FixedMat<N, N>(const FixedVec<N> &x)
+ * @param x: 初值
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError 奇异矩阵
+ */
+template <int N, typename F, typename J>
+inline FixedVec<N> SolveByNewtonRaphson(F &&f, J &&jacobian, FixedVec<N> x) {
+    ConvergenceMonitor monitor;
+    for (int it = 0;; ++it) {
+        FixedVec<N> phi = f(x);
+        if (monitor.Check(it, VecView(phi.Data(), N))) {
+            break;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        FixedVec<N> deltaq;
+        try {
+            deltaq = SolveLinear(FixedMat<N, N>(jacobian(x)), phi);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() == ErrorType::ERROR_SINGULAR_MATRIX) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
+            }
+            throw;
+        }
+        x -= deltaq;
+
+        VecView step(deltaq.Data(), N), xv(x.Data(), N);
+        if (monitor.StepConverged(std::sqrt(Dot(step, step)), std::sqrt(Dot(xv, xv)))) {
+            break;
+        }
+    }
+    return x;
+}
+
+/**
+ * 解N元非线性方程组equations，方程数量和未知量数量在编译期确定。
+ * 初值及变量名通过varsTable传入。总是使用牛顿-拉夫森法，不受Config::Get().nonlinearMethod影响。
+ * 方程组和雅可比矩阵编译为CompiledSymMat后直接求值到栈上的FixedMat，迭代过程中不申请堆内存。
+ * @exception MathError 方程数量或未知量数量不等于N
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
  */
-inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable);
+template <int N>
+inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable) {
+    if (equations.Rows() != N || varsTable.VarNums() != N) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    }
 
-/**
- * Solve the equations.
- * Variable names are obtained by analyzing the equations. Initial values are obtained through Config::Get().
- * @param equations: The system of equations. Essentially, it is a symbolic vector.
- * @throws tomsolver::MathError: If the number of iterations exceeds the limit.
- */
-inline VarsTable Solve(const SymVec &equations);
+    CompiledSymMat f(equations, varsTable.Vars());
+    CompiledSymMat ja(Jacobian(equations, varsTable.Vars()), varsTable.Vars());
+    FixedVec<N> x = SolveByNewtonRaphson<N>(
+        [&](const FixedVec<N> &v) {
+            FixedVec<N> phi;
+            f.Eval(v.Data(), phi.Data());
+            return phi;
+        },
+        [&](const FixedVec<N> &v) {
+            FixedMat<N, N> J;
+            ja.Eval(v.Data(), J.Data());
+            return J;
+        },
+        FixedVec<N>(varsTable.Values()));
+
+    VarsTable table = varsTable;
+    table.SetValues(VecView(x.Data(), N));
+    return table;
+}
 
 } // namespace tomsolver
 
@@ -3727,22 +9468,40 @@ using std::runtime_error;
 namespace tomsolver {
 
 inline double Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df) {
-    double alpha = 1;   // a > 0
+    double alpha = 0;
+    return Armijo(x, d, std::move(f), std::move(df), alpha) ? alpha : 0;
+}
+
+inline bool Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df, double &alpha) {
+    alpha = 1;          // a > 0
     double gamma = 0.4; // 取值范围(0, 0.5)越大越快
     double sigma = 0.5; // 取值范围(0, 1)越大越慢
+
+    // f(x)与df(x)ᵀd在搜索过程中不变，只计算一次
+    Vec fx = f(x);
+    Mat slope = df(x).Transpose() * d;
+
     Vec x_new(x);
-    while (1) {
-        x_new = x + alpha * d;
+    for (int i = 0; i < LineSearch::MAX_BACKTRACKING; ++i) {
+        ScaledAdd(x, alpha, d, x_new);
 
-        auto l = f(x_new).Norm2();
-        auto r = (f(x).AsMat() + gamma * alpha * df(x).Transpose() * d).Norm2();
+        double l = std::numeric_limits<double>::quiet_NaN();
+        try {
+            l = f(x_new).Norm2();
+        } catch (const MathError &err) {
+            // 试探点超出定义域，视为步长过大
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                throw;
+            }
+        }
+        double r = (fx.AsMat() + gamma * alpha * slope).Norm2();
         if (l <= r) // 检验条件
         {
-            break;
-        } else
-            alpha = alpha * sigma; // 缩小alpha，进入下一次循环
+            return true;
+        }
+        alpha = alpha * sigma; // 缩小alpha，进入下一次循环
     }
-    return alpha;
+    return false;
 }
 
 inline double FindAlpha(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, double uncert) {
@@ -3803,12 +9562,37 @@ inline VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &
     int it = 0; // 迭代计数
     VarsTable table = varsTable;
     int n = table.VarNums(); // 未知量数量
-    Vec q(n);                // x向量
+    Vec q = table.Values();  // x向量
     internal::PrintSolveStartInfo(equations, varsTable);
 
     SymMat JaEqs = Jacobian(equations, table.Vars());
     internal::PrintJacobian(JaEqs);
 
+    // 弦方法：雅可比矩阵为方阵时，复用上一次的LU分解结果，直到收缩率变差
+    bool chord = Config::Get().reuseJacobian && JaEqs.Rows() == n;
+    // 混合精度：单精度分解雅可比矩阵，迭代修正得到双精度的牛顿步
+    bool mixed = Config::Get().mixedPrecision && JaEqs.Rows() == n;
+    // 行列平衡：求解(R·J·C)·z = R·phi，-Δq = C·z
+    bool equilibrate = Config::Get().equilibrate && JaEqs.Rows() == n;
+    Equilibration eq;
+    Mat ja(JaEqs.Rows(), n);
+    Vec rhs(JaEqs.Rows()); // R·phi
+    LUFactorization lu;
+    MixedPrecisionLUFactorization mlu;
+    double phiNorm = 0; // 上一次迭代的||phi||
+    Vec deltaq(n);      // -Δq
+    Vec grad(n);        // Jᵀphi，J为当前q处未经缩放的雅可比矩阵
+    ConvergenceMonitor monitor;
+
+    // 一维搜索：沿牛顿方向回溯，避免||phi||增大或者试探点超出定义域
+    LineSearchMethod lineSearchMethod = Config::Get().lineSearch;
+    std::unique_ptr<CompiledSymMat> f;
+    std::unique_ptr<LineSearch> lineSearch;
+    if (lineSearchMethod != LineSearchMethod::NONE) {
+        f = std::make_unique<CompiledSymMat>(equations, table.Vars());
+        lineSearch = std::make_unique<LineSearch>(n, equations.Rows());
+    }
+
     while (1) {
         internal::PrintAtIterationStart(it);
 
@@ -3817,23 +9601,98 @@ inline VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &
             cout << "phi = \n" + phi.ToString();
         }
 
-        if (phi == 0) {
+        if (monitor.Check(it, phi)) {
             break;
         }
 
         if (it > Config::Get().maxIterations) {
-            throw runtime_error("迭代次数超出限制");
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
         }
 
-        Mat ja = JaEqs.Clone().Subs(table).Calc().ToMat();
+        double newPhiNorm = std::sqrt(phi.Norm2());
+        bool factored = mixed ? mlu.IsFactored() : lu.IsFactored();
+        bool refresh = !chord || !factored || newPhiNorm > Config::Get().jacobianRefreshRatio * phiNorm;
+        phiNorm = newPhiNorm;
+        double stepNorm = 0; // 实际走过的||Δq||
 
         try {
-            Vec deltaq = SolveLinear(ja, -phi);
+            if (refresh) {
+                ja = JaEqs.Clone().Subs(table).Calc().ToMat();
+                if (Config::Get().logLevel >= LogLevel::TRACE) {
+                    cout << "ja = " << ja << endl;
+                }
+
+                // ja随后会被缩放或者移走，先算好一维搜索需要的Jᵀphi
+                if (lineSearch) {
+                    grad = TransposeMultiply(ja, phi);
+                }
+
+                // 复用分解结果时，缩放因子与分解结果一起更新
+                if (equilibrate) {
+                    if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                        eq.Compute(ja);
+                    }
+                    eq.Apply(ja);
+                }
+
+                if (mixed) {
+                    mlu.Factor(ja);
+                } else if (chord) {
+                    lu.Factor(ja);
+                }
+            }
+
+            rhs = phi;
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    rhs[i] *= eq.RowScale()[i];
+                }
+            }
+
+            // 这里求解的是 ja * (-Δq) = phi，复用分解结果时不申请新的内存
+            if (mixed) {
+                mlu.Solve(rhs, deltaq);
+            } else if (chord) {
+                lu.Solve(rhs, deltaq);
+            } else {
+                deltaq = SolveLinear(std::move(ja), rhs);
+            }
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i] *= eq.ColScale()[i];
+                }
+            }
+
             if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "deltaq = " << deltaq << endl;
+                cout << "deltaq = " << -deltaq << endl;
             }
 
-            q += deltaq;
+            // 沿方向d = -deltaq搜索，φ'(0) = phiᵀJd = (Jᵀphi)ᵀd。
+            // 最小二乘解、近似分解等情况下Jd ≠ -phi，所以用当前的J计算；弦方法复用旧分解的步骤没有当前的J，
+            // 不做一维搜索（收缩率变差时会重新计算雅可比矩阵）。d不是下降方向或搜索失败时仍然走完整的一步
+            double dphi0 = 0;
+            if (lineSearch && refresh) {
+                dphi0 = -Dot(grad, deltaq);
+            }
+            if (dphi0 < 0) {
+                deltaq = -deltaq;
+                auto eval = [&](VecView x, Vec &out) {
+                    f->Eval(x, out);
+                };
+                stepNorm = std::sqrt(deltaq.Norm2());
+                if (lineSearch->Search(lineSearchMethod, q, deltaq, phi.Norm2() / 2, dphi0, eval)) {
+                    if (Config::Get().logLevel >= LogLevel::TRACE) {
+                        cout << "alpha = " << lineSearch->Alpha() << endl;
+                    }
+                    q = lineSearch->X();
+                    stepNorm *= lineSearch->Alpha();
+                } else {
+                    q += deltaq;
+                }
+            } else {
+                q -= deltaq;
+                stepNorm = std::sqrt(deltaq.Norm2());
+            }
         } catch (const tomsolver::MathError &err) {
             if (err.GetErrorType() == ErrorType::ERROR_SINGULAR_MATRIX) {
                 throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
@@ -3842,770 +9701,1437 @@ inline VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &
         }
 
         if (Config::Get().logLevel >= LogLevel::TRACE) {
-            cout << "ja = " << ja << endl;
             cout << "q = " << q << endl;
         }
 
         table.SetValues(q);
 
+        if (monitor.StepConverged(stepNorm, std::sqrt(q.Norm2()))) {
+            break;
+        }
+
         ++it;
     }
     return table;
 }
 
-inline VarsTable SolveByLM(const SymVec &equations, const VarsTable &varsTable) {
-    int it = 0; // 迭代计数
-    VarsTable table = varsTable;
-    int n = table.VarNums(); // 未知量数量
-    Vec q = table.Values();  // x向量
-    internal::PrintSolveStartInfo(equations, varsTable);
+namespace {
 
-    SymMat JaEqs = Jacobian(equations, table.Vars());
-    internal::PrintJacobian(JaEqs);
+/**
+ * 利用缓存的JᵀJ与JᵀF求解阻尼方程(JᵀJ + μD²)h = -JᵀF，结果写入h。
+ * 优先使用Cholesky分解；数值上不正定时，改为对增广方程组[J; √μD]h = [-F; 0]做QR分解，求最小二乘解。
+ */
+inline void SolveDampedSystem(const Mat &J, const Vec &F, const Mat &JtJ, const Vec &JtF, const Vec &dsq, double mu,
+                              Mat &A, CholeskyFactorization &chol, Vec &h) {
+    int m = J.Rows(), n = J.Cols();
+    A = JtJ;
+    for (int i = 0; i < n; ++i) {
+        A.Value(i, i) += mu * dsq[i];
+    }
+    if (chol.Factor(A)) {
+        chol.Solve(JtF, h);
+        h = -h;
+        return;
+    }
 
-    while (1) {
-        internal::PrintAtIterationStart(it);
+    Mat aug(m + n, n);
+    Vec rhs(m + n);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            aug.Value(i, j) = J.Value(i, j);
+        }
+        rhs[i] = -F[i];
+    }
+    for (int i = 0; i < n; ++i) {
+        aug.Value(m + i, i) = std::sqrt(mu * dsq[i]);
+    }
+    h = QRFactorization(aug).Solve(rhs);
+}
 
-        double mu = 1e-5; // LM方法的λ值
+/**
+ * Levenberg-Marquardt迭代的主体，供SolveByLM与SolveByPolyalgorithm共用。从q开始迭代，返回时q为解。
+ * it为之前已经用掉的迭代次数，monitor为之前使用的收敛判断，都继续累计。
+ * eq为行列平衡的缩放因子，已经计算过时沿用（与之前的牛顿迭代使用同一个||R·F||）。
+ * checked为true表示q处的F已经由调用者交给monitor检查过，第一次迭代不再重复检查。
+ */
+inline void IterateLM(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int it, ConvergenceMonitor &monitor,
+                      Equilibration &eq, bool checked) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Vec Fs(m);         // R·F
+    Mat J(m, n);       // 当前点的雅可比矩阵
+    Mat JtJ(n, n), A(n, n);
+    Vec JtF(n);
+    Vec dsq(n);  // 对角缩放矩阵D²
+    Vec h(n);    // 试探步Δq
+    Vec qNew(n); // 试探点q+Δq
+    CholeskyFactorization chol(n);
+
+    // 行列平衡：最小化||R·F||²，R取J的行缩放因子。对未知量的缩放即为下面的D，不再另外缩放
+    bool equilibrate = Config::Get().equilibrate && m == n;
+    Vec rowScale(m, 1);
+    auto residualNorm2 = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += rowScale[i] * rowScale[i] * v[i] * v[i];
+        }
+        return ret;
+    };
+
+    // 用共轭梯度法求解阻尼方程时不构造JᵀJ，(JᵀJ + μD²)v由J与Jᵀ分别乘向量得到
+    bool iterative = Config::Get().lmConjugateGradient;
+    std::unique_ptr<ConjugateGradient> cg;
+    Vec Jv(m);
+    if (iterative) {
+        cg = std::make_unique<ConjugateGradient>(n);
+    }
+
+    double mu = 1e-3; // 阻尼系数μ，相对于D²
+    double nu = 2;    // 试探步被拒绝时μ的放大倍数，连续拒绝时加倍
+    bool accepted = true;
 
-        Vec F = equations.Clone().Subs(table).Calc().ToMat().ToVec(); // 计算F
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
 
         if (Config::Get().logLevel >= LogLevel::TRACE) {
             cout << "F = " << F << endl;
         }
 
-        if (F == 0) { // F值为0，满足方程组求根条件
+        if (!checked && monitor.Check(it, F)) {
             break;
         }
+        checked = false;
 
-        Vec FNew(n);   // 下一轮F
-        Vec deltaq(n); // Δq
-        while (1) {
-
-            Mat J = JaEqs.Clone().Subs(table).Calc().ToMat(); // 计算雅可比矩阵
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
 
+        // 雅可比矩阵只在接受试探步后计算一次，被拒绝的试探步复用缓存的JᵀJ和JᵀF
+        if (accepted) {
+            df.Eval(q, J);
             if (Config::Get().logLevel >= LogLevel::TRACE) {
                 cout << "J = " << J << endl;
             }
 
-            // 说明：
-            // 标准的LM方法中，d=-(J'*J+λI)^(-1)*J'F，其中J'*J是为了确保矩阵对称正定。有时d会过大，很难收敛。
-            // 牛顿法的 d=-(J+λI)^(-1)*F
+            if (equilibrate) {
+                if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                    eq.Compute(J);
+                }
+                rowScale = eq.RowScale();
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J.Value(i, j) *= rowScale[i];
+                    }
+                }
+            }
+            for (int i = 0; i < m; ++i) {
+                Fs[i] = rowScale[i] * F[i];
+            }
+
+            if (!iterative) {
+                internal::SyrkTranspose(m, n, &J.Value(0, 0), &JtJ.Value(0, 0));
+            }
+            internal::GemvTranspose(m, n, &J.Value(0, 0), &Fs[0], &JtF[0]);
 
-            // 方向向量
-            Vec d = SolveLinear(J.Transpose() * J + mu * Mat(J.Rows(), J.Cols()).Ones(),
-                                -(J.Transpose() * F).ToVec()); // 得到d
+            // Marquardt缩放：D²取JᵀJ的对角元，使步长对未知量的尺度不敏感
+            for (int i = 0; i < n; ++i) {
+                double d = iterative ? Dot(MatView(J).Col(i), MatView(J).Col(i)) : JtJ.Value(i, i);
+                dsq[i] = d > 0 ? d : 1;
+            }
+        }
 
-            if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "d = " << d << endl;
+        if (iterative) {
+            // D²近似为JᵀJ的对角元，因此(1 + μ)D²即为系数矩阵的对角元，用作Jacobi预条件子
+            LinearOperator op = [&](VecView v, MutableVecView out) {
+                for (int i = 0; i < m; ++i) {
+                    Jv[i] = Dot(MatView(J).Row(i), v);
+                }
+                for (int i = 0; i < n; ++i) {
+                    out[i] = Dot(MatView(J).Col(i), Jv) + mu * dsq[i] * v[i];
+                }
+            };
+            LinearOperator precond = [&](VecView v, MutableVecView out) {
+                for (int i = 0; i < n; ++i) {
+                    out[i] = v[i] / ((1 + mu) * dsq[i]);
+                }
+            };
+            h.Zero();
+            cg->Solve(op, precond, JtF, h, Config::Get().krylovTolerance, Config::Get().maxKrylovIterations);
+            Scale(-1, h, h);
+        } else {
+            SolveDampedSystem(J, Fs, JtJ, JtF, dsq, mu, A, chol, h);
+        }
+        ScaledAdd(q, 1, h, qNew);
+
+        // 增益比ρ：实际下降量与线性化模型预测下降量之比
+        // 预测下降量 ||F||² - ||F + Jh||² = hᵀ(μD²h - JᵀF)。共轭梯度法从0开始迭代时，残差与h正交，等式同样成立
+        double predicted = 0;
+        for (int i = 0; i < n; ++i) {
+            predicted += h[i] * (mu * dsq[i] * h[i] - JtF[i]);
+        }
+        double rho = -1;
+        if (predicted > 0) {
+            try {
+                f.Eval(qNew, FNew);
+                rho = (residualNorm2(F) - residualNorm2(FNew)) / predicted;
+            } catch (const MathError &err) {
+                // 试探点超出定义域，视为步长过大
+                if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
+            }
+        }
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "h = " << h << endl;
+            cout << "mu = " << mu << endl;
+            cout << "rho = " << rho << endl;
+        }
+
+        // Nielsen方法更新μ：ρ越接近1，线性化模型越可信，μ减小得越多
+        accepted = rho > 0;
+        if (accepted) {
+            std::swap(q, qNew);
+            std::swap(F, FNew);
+            mu *= std::max(1.0 / 3, 1 - std::pow(2 * rho - 1, 3));
+            nu = 2;
+            if (monitor.StepConverged(std::sqrt(h.Norm2()), std::sqrt(q.Norm2()))) {
+                break;
             }
+        } else {
+            mu *= nu;
+            nu *= 2;
+        }
+
+        ++it;
+    }
+
+    if (Config::Get().logLevel >= LogLevel::TRACE) {
+        cout << "success" << endl;
+    }
+}
+
+} // namespace
+
+inline VarsTable SolveByLM(const SymVec &equations, const VarsTable &varsTable) {
+    VarsTable table = varsTable;
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
+
+    SymMat JaEqs = Jacobian(equations, table.Vars());
+    internal::PrintJacobian(JaEqs);
+
+    // 方程组和雅可比矩阵只编译一次，迭代中求值不再复制、替换表达式树
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+
+    ConvergenceMonitor monitor;
+    Equilibration eq;
+    IterateLM(f, df, q, 0, monitor, eq, false);
+
+    table.SetValues(q);
+    return table;
+}
 
-            double alpha = Armijo(
-                q, d,
-                [&](Vec v) -> Vec {
-                    table.SetValues(v);
-                    return equations.Clone().Subs(table).Calc().ToMat().ToVec();
-                },
-                [&](Vec v) -> Mat {
-                    table.SetValues(v);
-                    return JaEqs.Clone().Subs(table).Calc().ToMat();
-                }); // 进行1维搜索得到alpha
+namespace {
+
+/**
+ * Powell折线法迭代的主体，供SolveByDogleg与多初值求解共用。参数的含义与IterateLM相同。
+ */
+inline void IterateDogleg(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int it,
+                          ConvergenceMonitor &monitor) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Vec Fs(m);         // R·F
+    Mat J(m, n);       // 当前点的雅可比矩阵
+    QRFactorization qr;
+    Vec hGN(n);  // 高斯-牛顿步
+    Vec hSD(n);  // 最速下降方向上的Cauchy步
+    Vec g(n);    // JᵀF
+    Vec diag(n); // 对角缩放D，信赖域为||Dh|| <= Δ
+    Vec h(n);    // 试探步Δq
+    Vec qNew(n); // 试探点q+Δq
+
+    // 行列平衡：与SolveByLM相同，最小化||R·F||²。信赖域的缩放即为D，
+    // 但高斯-牛顿步的QR分解按列主元的相对大小判断秩，仍然需要对R·J按列缩放
+    bool equilibrate = Config::Get().equilibrate && m == n;
+    Equilibration eq;
+    Vec rowScale(m, 1);
+    Mat JC(m, n); // R·J·C
+    auto residualNorm2 = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += rowScale[i] * rowScale[i] * v[i] * v[i];
+        }
+        return ret;
+    };
+
+    auto scaledNorm = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            ret += diag[i] * diag[i] * v[i] * v[i];
+        }
+        return std::sqrt(ret);
+    };
 
-            // double alpha = FindAlpha(q, d, std::bind(SixBarAngPosition, std::placeholders::_1, thetaCDKL, Hhit));
+    double delta = 0; // 信赖域半径Δ
+    bool accepted = true;
 
-            // for (size_t i = 0; i < alpha.rows; ++i)
-            //{
-            //	if (alpha[i] != alpha[i])
-            //		alpha[i] = 1.0;
-            //}
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
 
-            deltaq = alpha * d; // 计算Δq
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
+        }
 
-            Vec qTemp = q + deltaq;
-            table.SetValues(qTemp);
+        if (monitor.Check(it, F)) {
+            break;
+        }
 
-            FNew = equations.Clone().Subs(table).Calc().ToMat().ToVec(); // 计算新的F
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
 
+        // 雅可比矩阵只在接受试探步后计算一次。高斯-牛顿步与Cauchy步只与J有关，
+        // 试探步被拒绝时只需缩小Δ并重新组合这两步，不必重新求解
+        if (accepted) {
+            df.Eval(q, J);
             if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "it=" << it << endl;
-                cout << "\talpha=" << alpha << endl;
-                cout << "mu=" << mu << endl;
-                cout << "F.Norm2()=" << F.Norm2() << endl;
-                cout << "FNew.Norm2()=" << FNew.Norm2() << endl;
-                cout << "\tF(x k+1).Norm2()\t" << ((FNew.Norm2() < F.Norm2()) ? "<" : ">=") << "\tF(x k).Norm2()\t"
-                     << endl;
+                cout << "J = " << J << endl;
             }
 
-            if (FNew.Norm2() < F.Norm2()) // 满足下降条件，跳出内层循环
-            {
-                break;
+            if (equilibrate) {
+                if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                    eq.Compute(J);
+                    rowScale = eq.RowScale();
+                }
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J.Value(i, j) *= rowScale[i];
+                    }
+                }
+            }
+            for (int i = 0; i < m; ++i) {
+                Fs[i] = rowScale[i] * F[i];
+            }
+
+            // 与MINPACK相同，D取历次J的列范数的最大值
+            for (int j = 0; j < n; ++j) {
+                double colNorm = 0;
+                for (int i = 0; i < m; ++i) {
+                    colNorm += J.Value(i, j) * J.Value(i, j);
+                }
+                diag[j] = std::max(diag[j], std::sqrt(colNorm));
+                if (diag[j] == 0) {
+                    diag[j] = 1;
+                }
+            }
+            if (delta == 0) {
+                delta = 100 * scaledNorm(q);
+                if (delta == 0) {
+                    delta = 100;
+                }
+            }
+
+            // 秩亏或非方阵时为最小二乘意义下范数最小的解
+            if (equilibrate) {
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        JC.Value(i, j) = J.Value(i, j) * eq.ColScale()[j];
+                    }
+                }
+                qr.Factor(JC);
+                qr.Solve(Fs, hGN);
+                for (int j = 0; j < n; ++j) {
+                    hGN[j] *= -eq.ColScale()[j];
+                }
+            } else {
+                qr.Factor(J);
+                qr.Solve(Fs, hGN);
+                hGN = -hGN;
+            }
+
+            // 缩放后的最速下降方向s = -D⁻²JᵀF，沿s使||F + tJs||最小的t = ||D⁻¹JᵀF||² / ||Js||²
+            internal::GemvTranspose(m, n, &J.Value(0, 0), &Fs[0], &g[0]);
+            double gNorm2 = 0;
+            for (int i = 0; i < n; ++i) {
+                hSD[i] = -g[i] / (diag[i] * diag[i]);
+                gNorm2 += g[i] * g[i] / (diag[i] * diag[i]);
+            }
+            double JsNorm2 = 0;
+            for (int i = 0; i < m; ++i) {
+                double v = Dot(MatView(J).Row(i), hSD);
+                JsNorm2 += v * v;
+            }
+            hSD = (JsNorm2 > 0 ? gNorm2 / JsNorm2 : 0) * hSD;
+        }
+
+        // 折线：高斯-牛顿步在信赖域内时直接采用；否则沿Cauchy步到高斯-牛顿步的折线，取与信赖域边界的交点
+        double gnNorm = scaledNorm(hGN);
+        if (gnNorm <= delta) {
+            h = hGN;
+        } else {
+            double sdNorm = scaledNorm(hSD);
+            if (sdNorm >= delta) {
+                h = (delta / sdNorm) * hSD;
             } else {
-                mu *= 10.0; // 扩大λ，使模型倾向梯度下降方向
+                // 求β使||D(hSD + β(hGN - hSD))|| = Δ
+                double a = 0, b = 0, c = sdNorm * sdNorm - delta * delta;
+                for (int i = 0; i < n; ++i) {
+                    double di2 = diag[i] * diag[i];
+                    double diff = hGN[i] - hSD[i];
+                    a += di2 * diff * diff;
+                    b += di2 * hSD[i] * diff;
+                }
+                double beta = (-b + std::sqrt(b * b - a * c)) / a;
+                h = hSD + beta * (hGN - hSD);
+            }
+        }
+        double hNorm = scaledNorm(h);
+        if (it == 0) {
+            // 与MINPACK相同，第一次迭代时Δ不超过第一步的长度
+            delta = std::min(delta, hNorm);
+        }
+        ScaledAdd(q, 1, h, qNew);
+
+        // 增益比ρ：实际下降量与线性化模型预测下降量之比
+        double predicted = Fs.Norm2();
+        for (int i = 0; i < m; ++i) {
+            double v = Fs[i] + Dot(MatView(J).Row(i), h);
+            predicted -= v * v;
+        }
+        double rho = -1;
+        if (predicted > 0) {
+            try {
+                f.Eval(qNew, FNew);
+                rho = (residualNorm2(F) - residualNorm2(FNew)) / predicted;
+            } catch (const MathError &err) {
+                // 试探点超出定义域，视为步长过大
+                if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
             }
+        }
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "h = " << h << endl;
+            cout << "delta = " << delta << endl;
+            cout << "rho = " << rho << endl;
+        }
+
+        // 按ρ调整信赖域半径
+        if (!(rho >= 0.1)) {
+            delta = 0.5 * hNorm;
+        } else if (rho >= 0.75) {
+            delta = std::max(delta, 2 * hNorm);
+        }
 
-            if (it++ == Config::Get().maxIterations) {
-                throw runtime_error("迭代次数超出限制");
+        accepted = rho >= 1.0e-4;
+        if (accepted) {
+            std::swap(q, qNew);
+            std::swap(F, FNew);
+            if (monitor.StepConverged(std::sqrt(h.Norm2()), std::sqrt(q.Norm2()))) {
+                break;
             }
         }
 
-        q += deltaq; // 应用Δq，更新q值
+        ++it;
+    }
+
+    if (Config::Get().logLevel >= LogLevel::TRACE) {
+        cout << "success" << endl;
+    }
+}
+
+} // namespace
+
+inline VarsTable SolveByDogleg(const SymVec &equations, const VarsTable &varsTable) {
+    VarsTable table = varsTable;
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
+
+    SymMat JaEqs = Jacobian(equations, table.Vars());
+    internal::PrintJacobian(JaEqs);
+
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+
+    ConvergenceMonitor monitor;
+    IterateDogleg(f, df, q, 0, monitor);
+
+    table.SetValues(q);
+    return table;
+}
+
+namespace {
+
+/**
+ * Jacobian-free Newton-Krylov迭代的主体，供SolveByNewtonKrylov与多初值求解共用。参数的含义与IterateLM相同。
+ */
+inline void IterateNewtonKrylov(const CompiledSymMat &f, Vec &q, int it, ConvergenceMonitor &monitor,
+                                const std::function<LinearOperator(VecView q)> &preconditioner) {
+    int n = q.Rows(); // 未知量数量
+
+    Vec F(n);
+    Vec deltaq(n); // -Δq
+
+    std::unique_ptr<GMRES> gmres;
+    std::unique_ptr<BiCGSTAB> bicgstab;
+    if (Config::Get().krylovMethod == KrylovMethod::GMRES) {
+        gmres = std::make_unique<GMRES>(n, std::min(Config::Get().krylovRestart, n));
+    } else {
+        bicgstab = std::make_unique<BiCGSTAB>(n);
+    }
+
+    // 不构造雅可比矩阵，J·v由差商(f(q + hv) - f(q)) / h近似，h取机器精度的平方根（相对于q和v的大小）
+    Vec qh(n), Fh(n), Jd(n);
+    double qNorm = 0;
+    LinearOperator jv = [&](VecView v, MutableVecView out) {
+        double vNorm = std::sqrt(Dot(v, v));
+        if (vNorm == 0) {
+            Scale(0, v, out);
+            return;
+        }
+        double h = std::sqrt(std::numeric_limits<double>::epsilon()) * (1 + qNorm) / vNorm;
+        ScaledAdd(q, h, v, qh);
+        f.Eval(qh, Fh);
+        ScaledAdd(Fh, -1, F, out);
+        Scale(1 / h, out, out);
+    };
+
+    LineSearchMethod lineSearchMethod = Config::Get().lineSearch;
+    std::unique_ptr<LineSearch> lineSearch;
+    if (lineSearchMethod != LineSearchMethod::NONE) {
+        lineSearch = std::make_unique<LineSearch>(n, n);
+    }
+
+    double eta = Config::Get().krylovTolerance; // 线性方程组的相对精度η
+    double FNormPrev = 0;                       // 上一次迭代的||F||
+
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
+        }
+
+        if (monitor.Check(it, F)) {
+            break;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        double FNorm = std::sqrt(F.Norm2());
+        if (Config::Get().eisenstatWalker) {
+            // Eisenstat-Walker方法（选择2）：η = γ(||F|| / ||F_prev||)²，γ = 0.9，并限制η不要下降得过快
+            const double gamma = 0.9, etaMax = 0.9;
+            if (it == 0) {
+                eta = 0.5;
+            } else {
+                double etaNew = gamma * (FNorm / FNormPrev) * (FNorm / FNormPrev);
+                if (gamma * eta * eta > 0.1) {
+                    etaNew = std::max(etaNew, gamma * eta * eta);
+                }
+                eta = etaNew;
+            }
+            // 接近收敛时，线性残差不必比非线性方程组的精度要求更小
+            eta = std::min(etaMax, std::max(eta, 0.5 * monitor.Tolerance() / FNorm));
+        }
+        FNormPrev = FNorm;
 
-        table.SetValues(q);
+        // 求解J·(-Δq) = F。未达到精度时仍然使用得到的近似解（非精确牛顿法）
+        qNorm = std::sqrt(q.Norm2());
+        LinearOperator precond = preconditioner ? preconditioner(q) : nullptr;
+        deltaq.Zero();
+        int maxKrylovIterations = Config::Get().maxKrylovIterations;
+        bool converged = gmres ? gmres->Solve(jv, precond, F, deltaq, eta, maxKrylovIterations)
+                               : bicgstab->Solve(jv, precond, F, deltaq, eta, maxKrylovIterations);
 
-        F = FNew; // 更新F
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "eta = " << eta << endl;
+            cout << "Krylov iterations = " << (gmres ? gmres->Iterations() : bicgstab->Iterations())
+                 << ", relative residual = "
+                 << (gmres ? gmres->RelativeResidual() : bicgstab->RelativeResidual())
+                 << (converged ? "" : " (not converged)") << endl;
+            cout << "deltaq = " << -deltaq << endl;
+        }
 
-        if (it++ == Config::Get().maxIterations) {
-            throw runtime_error("迭代次数超出限制");
+        double stepNorm = std::sqrt(deltaq.Norm2()); // 实际走过的||Δq||
+        // 沿d = -deltaq搜索。线性方程组只解到相对精度η，Jd ≠ -F，φ'(0) = FᵀJd用差商多计算一次f得到。
+        // d不是下降方向或搜索失败时仍然走完整的一步
+        double dphi0 = 0;
+        if (lineSearch) {
+            jv(deltaq, Jd);
+            dphi0 = -Dot(F, Jd);
+        }
+        if (dphi0 < 0) {
+            deltaq = -deltaq;
+            auto eval = [&](VecView x, Vec &out) {
+                f.Eval(x, out);
+            };
+            if (lineSearch->Search(lineSearchMethod, q, deltaq, F.Norm2() / 2, dphi0, eval)) {
+                q = lineSearch->X();
+                F = lineSearch->F();
+                stepNorm *= lineSearch->Alpha();
+            } else {
+                q += deltaq;
+                f.Eval(q, F);
+            }
+        } else {
+            q -= deltaq;
+            f.Eval(q, F);
         }
 
         if (Config::Get().logLevel >= LogLevel::TRACE) {
-            cout << std::string(20, '=') << endl;
+            cout << "q = " << q << endl;
         }
-    }
-
-    if (Config::Get().logLevel >= LogLevel::TRACE) {
-        cout << "success" << endl;
-    }
 
-    return table;
-}
+        if (monitor.StepConverged(stepNorm, std::sqrt(q.Norm2()))) {
+            break;
+        }
 
-inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable) {
-    switch (Config::Get().nonlinearMethod) {
-    case NonlinearMethod::NEWTON_RAPHSON:
-        return SolveByNewtonRaphson(equations, varsTable);
-    case NonlinearMethod::LM:
-        return SolveByLM(equations, varsTable);
+        ++it;
     }
-    throw runtime_error("invalid config.NonlinearMethod value: " +
-                        std::to_string(static_cast<int>(Config::Get().nonlinearMethod)));
-}
-
-inline VarsTable Solve(const SymVec &equations) {
-    auto varNames = equations.GetAllVarNames();
-    std::vector<std::string> vecVarNames(varNames.begin(), varNames.end());
-    VarsTable varsTable(std::move(vecVarNames), Config::Get().initialValue);
-    return Solve(equations, varsTable);
 }
 
-} // namespace tomsolver
+} // namespace
 
-namespace tomsolver {
+inline VarsTable SolveByNewtonKrylov(const SymVec &equations, const VarsTable &varsTable,
+                                     const std::function<LinearOperator(VecView q)> &preconditioner) {
+    VarsTable table = varsTable;
+    int n = table.VarNums(); // 未知量数量
+    if (equations.Rows() < n) {
+        throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION);
+    }
+    if (equations.Rows() > n) {
+        throw MathError(ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
+    }
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
 
-namespace internal {
+    CompiledSymMat f(equations, table.Vars());
 
-class DiffFunctions {
-public:
-    struct DiffNode {
-        NodeImpl &node;
-        const bool isLeftChild;
+    ConvergenceMonitor monitor;
+    IterateNewtonKrylov(f, q, 0, monitor, preconditioner);
 
-        DiffNode(NodeImpl &node) : node(node), isLeftChild(node.parent && node.parent->left.get() == &node) {}
-    };
+    table.SetValues(q);
+    return table;
+}
 
-    static void DiffOnce(Node &root, const std::string &varname) {
-        std::queue<DiffNode> q;
+inline VarsTable SolveFixedPoint(const SymVec &G, const VarsTable &varsTable) {
+    int it = 0; // 迭代计数
+    VarsTable table = varsTable;
+    int n = table.VarNums(); // 未知量数量
+    if (G.Rows() != n) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    }
+    Vec q = table.Values(); // x向量
+    if (Config::Get().logLevel >= LogLevel::INFO) {
+        cout << "Solve fixed point start.\n";
+        cout << "G:\n" + G.ToString();
+        cout << "Inital Values:\n" + varsTable.ToString();
+    }
 
-        if (root->type == NodeType::OPERATOR) {
-            DiffOnceOperator(root, q);
-        } else {
-            q.emplace(*root);
-        }
+    CompiledSymMat g(G, table.Vars());
+    int depth = std::min(Config::Get().andersonDepth, n);
 
-        while (!q.empty()) {
-            auto &node = q.front().node;
-            auto isLeftChild = q.front().isLeftChild;
-            q.pop();
+    // 最近depth次迭代的Δf与Δg，按列循环存放。列的顺序不影响最小二乘问题的解
+    Mat dF(n, std::max(depth, 1)), dG(n, std::max(depth, 1));
+    int history = 0; // 有效的列数
+    int next = 0;    // 下一次写入的列
+    QRFactorization qr;
+    ConvergenceMonitor monitor;
 
-            switch (node.type) {
-            case NodeType::VARIABLE:
-                node.type = NodeType::NUMBER;
-                node.value = node.varname == varname ? 1 : 0;
-                node.varname = "";
-                break;
+    Vec gq(n), gPrev(n); // G(q)
+    Vec fq(n), fPrev(n); // f(q) = G(q) - q
+    Vec qPrev(n), dq(n);
 
-            case NodeType::NUMBER:
-                node.value = 0;
-                break;
+    g.Eval(q, gq);
+    while (1) {
+        internal::PrintAtIterationStart(it);
 
-            case NodeType::OPERATOR: {
-                auto &child = isLeftChild ? node.parent->left : node.parent->right;
-                DiffOnceOperator(child, q);
-                break;
-            }
-            default:
-                assert(0 && "inner bug");
-            }
+        fq = gq - q;
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "G(q) - q = " << fq << endl;
         }
-    }
-
-    static void DiffOnceOperator(Node &node, std::queue<DiffNode> &q) {
-        auto parent = node->parent;
-
-        // 调用前提：node是1元操作符
-        // 如果node的成员是数字，那么整个node变为数字节点，value=0，且返回true
-        // 例如： sin(1)' = 0
-        auto CullNumberMember = [&node]() -> bool {
-            assert(GetOperatorNum(node->op) == 1);
-            assert(node->left);
-            if (node->left->type == NodeType::NUMBER) {
-                node->left = nullptr;
-                node->type = NodeType::NUMBER;
-                node->op = MathOperator::MATH_NULL;
-                node->value = 0.0;
-                return true;
-            }
-            return false;
-        };
-
-        // 调用前提：node是2元操作符
-        // 如果node的成员是数字，那么整个node变为数字节点，value=0，且返回true
-        // 例如： (2*3)' = 0
-        auto CullNumberMemberBinary = [&node]() -> bool {
-            assert(GetOperatorNum(node->op) == 2);
-            assert(node->left && node->right);
-            if (node->left->type == NodeType::NUMBER && node->right->type == NodeType::NUMBER) {
-                node->left = nullptr;
-                node->right = nullptr;
-                node->type = NodeType::NUMBER;
-                node->op = MathOperator::MATH_NULL;
-                node->value = 0.0;
-                return true;
-            }
-            return false;
-        };
 
-        switch (node->op) {
-        case MathOperator::MATH_NULL: {
-            assert(0 && "inner bug");
+        if (monitor.Check(it, fq)) {
             break;
         }
-        case MathOperator::MATH_POSITIVE:
-        case MathOperator::MATH_NEGATIVE: {
-            q.emplace(*node->left);
-            return;
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
         }
 
-        // 函数
-        case MathOperator::MATH_SIN: {
-            if (CullNumberMember()) {
-                return;
+        if (it > 0 && depth > 0) {
+            for (int i = 0; i < n; ++i) {
+                dF.Value(i, next) = fq[i] - fPrev[i];
+                dG.Value(i, next) = gq[i] - gPrev[i];
             }
-
-            // sin(u)' = cos(u) * u'
-            node->op = MathOperator::MATH_COS;
-            auto u2 = Clone(node->left);
-            q.emplace(*u2);
-            node = Move(node) * Move(u2);
-            node->parent = parent;
-            break;
+            next = (next + 1) % depth;
+            history = std::min(history + 1, depth);
         }
-        case MathOperator::MATH_COS: {
-            if (CullNumberMember()) {
-                return;
-            }
+        fPrev = fq;
+        gPrev = gq;
+        qPrev = q;
 
-            // cos(u)' = -sin(u) * u'
-            node->op = MathOperator::MATH_SIN;
-            auto u2 = Clone(node->left);
-            q.emplace(*u2);
-            node = -Move(node) * Move(u2);
-            node->parent = parent;
-            break;
-        }
-        case MathOperator::MATH_TAN: {
-            if (CullNumberMember()) {
-                return;
+        if (history == 0) {
+            q = gq;
+        } else {
+            // Anderson混合：γ = argmin||f - ΔF·γ||，q = G(q) - ΔG·γ
+            qr.Factor(MatView(dF).Block(0, 0, n, history));
+            Vec gamma = qr.Solve(fq);
+            for (int i = 0; i < n; ++i) {
+                q[i] = gq[i] - Dot(MatView(dG).Block(0, 0, n, history).Row(i), gamma);
             }
-
-            // tan'u = 1/(cos(u)^2) * u'
-            node->op = MathOperator::MATH_COS;
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = Num(1) / (Move(node) ^ Num(2)) * Move(u2);
-            node->parent = parent;
-            return;
         }
-        case MathOperator::MATH_ARCSIN: {
-            if (CullNumberMember()) {
-                return;
-            }
 
-            // asin'u = 1/sqrt(1-u^2) * u'
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(1) / sqrt(Num(1) - (Move(u) ^ Num(2)))) * Move(u2);
-            node->parent = parent;
-            return;
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "q = " << q << endl;
         }
-        case MathOperator::MATH_ARCCOS: {
-            if (CullNumberMember()) {
-                return;
-            }
 
-            // acos'u = -1/sqrt(1-u^2) * u'
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(-1) / sqrt(Num(1) - (Move(u) ^ Num(2)))) * Move(u2);
-            node->parent = parent;
-            return;
-        }
-        case MathOperator::MATH_ARCTAN: {
-            if (CullNumberMember()) {
-                return;
+        try {
+            g.Eval(q, gq);
+        } catch (const MathError &err) {
+            // 外推得到的点超出定义域时，清空历史，退回一次普通的不动点迭代
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER || history == 0) {
+                throw;
             }
-
-            // atan'u = 1/(1+u^2) * u'
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(1) / (Num(1) + (Move(u) ^ Num(2)))) * Move(u2);
-            node->parent = parent;
-            return;
+            history = 0;
+            next = 0;
+            q = gPrev;
+            g.Eval(q, gq);
         }
-        case MathOperator::MATH_SQRT: {
-            if (CullNumberMember()) {
-                return;
-            }
 
-            // sqrt(u)' = 1/(2*sqrt(u)) * u'
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = Num(1) / (Num(2) * Move(node)) * Move(u2);
-            node->parent = parent;
-            return;
+        dq = q - qPrev;
+        if (monitor.StepConverged(std::sqrt(dq.Norm2()), std::sqrt(q.Norm2()))) {
+            break;
         }
-        case MathOperator::MATH_LOG: {
-            if (CullNumberMember()) {
-                return;
-            }
 
-            // ln(u)' = 1/u * u'
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(1) / Move(u)) * Move(u2);
-            node->parent = parent;
-            return;
-        }
-        case MathOperator::MATH_LOG2: {
-            if (CullNumberMember()) {
-                return;
-            }
+        ++it;
+    }
 
-            // loga(u)' = 1/(u * ln(a)) * u'
-            auto a = 2.0;
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(1) / (Move(u) * Num(std::log(a)))) * Move(u2);
-            node->parent = parent;
-            return;
+    table.SetValues(q);
+    return table;
+}
+
+namespace {
+
+/**
+ * 用编译后的方程组与雅可比矩阵做不带一维搜索的牛顿迭代，供SolveByPolyalgorithm与多初值求解共用。
+ * 从q开始迭代，it为已经用掉的迭代次数，返回时q为最后接受的迭代点，it为累计的迭代次数。
+ * fallback为true时，雅可比矩阵奇异或病态、牛顿步超出定义域、||F||收缩不够时不再继续，返回false，
+ * 由调用者改用其他方法；为false时就是普通的牛顿法，这些情况下照常抛出异常或继续迭代。
+ * 返回false时q处的F已经交给monitor检查过。eq为行列平衡的缩放因子，开启行列平衡时收缩率按||R·F||计算，
+ * 与之后的LM方法一致。
+ * @return 是否已经收敛
+ */
+inline bool IterateNewton(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int &it,
+                          ConvergenceMonitor &monitor, bool fallback, Equilibration &eq) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+    assert(m == n);
+
+    // 牛顿步需要使||F||缩小到原来的contraction倍以下，雅可比矩阵的条件数估计不能超过maxCondition
+    const double contraction = 0.9, maxCondition = 1.0e10;
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Mat J(m, n);
+    Vec rhs(m);    // R·F
+    Vec deltaq(n); // -Δq
+    Vec qNew(n);   // 试探点
+    LUFactorization lu(n);
+    bool equilibrate = Config::Get().equilibrate;
+    auto residualNorm2 = [&](const Vec &v) {
+        if (!equilibrate) {
+            return v.Norm2();
         }
-        case MathOperator::MATH_LOG10: {
-            if (CullNumberMember()) {
-                return;
-            }
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += eq.RowScale()[i] * eq.RowScale()[i] * v[i] * v[i];
+        }
+        return ret;
+    };
 
-            // loga(u)' = 1/(u * ln(a)) * u'
-            auto a = 10.0;
-            auto &u = node->left;
-            auto u2 = Clone(u);
-            q.emplace(*u2);
-            node = (Num(1) / (Move(u) * Num(std::log(a)))) * Move(u2);
-            node->parent = parent;
-            return;
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
         }
-        case MathOperator::MATH_EXP: {
-            if (CullNumberMember()) {
-                return;
-            }
 
-            // e^x=e^x
-            if (node->left->type == NodeType::VARIABLE)
-                return;
+        if (monitor.Check(it, F)) {
+            return true;
+        }
 
-            // (e^u)' = e^u * u'
-            auto u2 = Clone(node->left);
-            q.emplace(*u2);
-            node = Move(node) * Move(u2);
-            node->parent = parent;
-            break;
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
         }
 
-        // 二元
-        case MathOperator::MATH_ADD:
-        case MathOperator::MATH_SUB:
-            if (CullNumberMemberBinary()) {
-                return;
+        const char *reason = nullptr; // 改用其他方法的原因
+        df.Eval(q, J);
+        if (equilibrate) {
+            if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                eq.Compute(J);
             }
-            // (u + v)' = u' + v'
-            if (node->left) {
-                q.emplace(*node->left);
+            eq.Apply(J);
+        }
+        try {
+            lu.Factor(J);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+                throw;
             }
-            if (node->right) {
-                q.emplace(*node->right);
+            if (!fallback) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
             }
-            return;
-        case MathOperator::MATH_MULTIPLY: {
-            // 两个操作数中有一个是数字
-            if (node->left->type == NodeType::NUMBER) {
-                q.emplace(*node->right);
-                return;
+            reason = "singular Jacobian";
+        }
+        if (fallback && !reason && lu.ConditionEstimate() > maxCondition) {
+            reason = "ill-conditioned Jacobian";
+        }
+
+        if (!reason) {
+            rhs = F;
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    rhs[i] *= eq.RowScale()[i];
+                }
             }
-            if (node->right->type == NodeType::NUMBER) {
-                q.emplace(*node->left);
-                return;
+            lu.Solve(rhs, deltaq);
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i] *= eq.ColScale()[i];
+                }
             }
+            ScaledAdd(q, -1, deltaq, qNew);
 
-            if (CullNumberMemberBinary()) {
-                return;
+            try {
+                f.Eval(qNew, FNew);
+                if (fallback && !(residualNorm2(FNew) < contraction * contraction * residualNorm2(F))) {
+                    reason = "residual not contracting";
+                }
+            } catch (const MathError &err) {
+                if (!fallback || err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
+                reason = "domain error";
             }
-
-            // (u*v)' = u' * v + u * v'
-            auto &u = node->left;
-            auto &v = node->right;
-            q.emplace(*u);
-            auto u2 = Clone(u);
-            auto v2 = Clone(v);
-            q.emplace(*v2);
-            node = Move(node) + Move(u2) * Move(v2);
-            node->parent = parent;
-            return;
         }
-        case MathOperator::MATH_DIVIDE: {
-            // auto leftIsNumber = node->left->type == NodeType::NUMBER;
-            auto rightIsNumber = node->right->type == NodeType::NUMBER;
 
-            // f(x)/number = f'(x)/number
-            if (rightIsNumber) {
-                q.emplace(*node->left);
-                return;
-            }
+        // 被放弃的牛顿步同样计入迭代次数
+        ++it;
 
-            if (CullNumberMemberBinary()) {
-                return;
+        if (reason) {
+            if (Config::Get().logLevel >= LogLevel::INFO) {
+                cout << "leave Newton iteration: " << reason << endl;
             }
+            return false;
+        }
 
-            // (u/v)' = (u'v - uv')/(v^2)
-            auto &u = node->left;
-            auto &v = node->right;
-            auto u2 = Clone(u);
-            auto v2 = Clone(v);
-            auto v3 = Clone(v);
-            q.emplace(*u);
-            q.emplace(*v2);
-            node = (Move(u) * Move(v) - Move(u2) * Move(v2)) / (Move(v3) ^ Num(2));
-            node->parent = parent;
-            return;
+        std::swap(q, qNew);
+        std::swap(F, FNew);
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "q = " << q << endl;
         }
-        case MathOperator::MATH_POWER: {
-            // 如果两个操作数都是数字
-            if (CullNumberMemberBinary()) {
-                return;
-            }
 
-            auto lChildIsNumber = node->left->type == NodeType::NUMBER;
-            auto rChildIsNumber = node->right->type == NodeType::NUMBER;
+        if (monitor.StepConverged(std::sqrt(deltaq.Norm2()), std::sqrt(q.Norm2()))) {
+            return true;
+        }
+    }
+}
 
-            // (u^a)' = a*u^(a-1) * u'
-            if (rChildIsNumber) {
-                auto &a = node->right;
-                auto aValue = a->value;
-                auto &u = node->left;
-                auto u2 = Clone(u);
-                q.emplace(*u2);
-                node = std::move(a) * (std::move(u) ^ Num(aValue - 1)) * std::move(u2);
-                node->parent = parent;
-                return;
-            }
+/**
+ * 先用牛顿法，不满足条件时保留当前的q，改用LM方法继续迭代。非方阵直接使用LM方法。
+ * 两者共用行列平衡的缩放因子；切换时q处的F已经检查过，不重复计入停滞次数。
+ */
+inline void IteratePolyalgorithm(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int &it,
+                                 ConvergenceMonitor &monitor) {
+    Equilibration eq;
+    bool square = f.Rows() == q.Rows();
+    if (square && IterateNewton(f, df, q, it, monitor, true, eq)) {
+        return;
+    }
+    IterateLM(f, df, q, it, monitor, eq, square);
+}
 
-            // (a^x)' = a^x * ln(a)  when a>0 and a!=1
-            if (lChildIsNumber) {
-                auto &a = node->left;
-                auto aValue = a->value;
-                auto &u = node->right;
-                auto u2 = Clone(u);
-                q.emplace(*u2);
-                node = (std::move(a) ^ std::move(u)) * log(Num(aValue)) * std::move(u2);
-                node->parent = parent;
-                return;
-            }
+} // namespace
 
-            // (u^v)' = ( e^(v*ln(u)) )' = e^(v*ln(u)) * (v*ln(u))' = u^v * (v*ln(u))'
-            // 左右都不是数字
-            auto &u = node->left;
-            auto &v = node->right;
-            auto vln_u = Clone(v) * log(Clone(u));
-            q.emplace(*vln_u);
-            node = Move(node) * std::move(vln_u);
-            node->parent = parent;
-            return;
-        }
+inline VarsTable SolveByPolyalgorithm(const SymVec &equations, const VarsTable &varsTable) {
+    int it = 0; // 迭代计数
+    VarsTable table = varsTable;
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
 
-        case MathOperator::MATH_AND: {
-            throw std::runtime_error("can not apply diff for AND(&) operator");
-            return;
-        }
-        case MathOperator::MATH_OR: {
-            throw std::runtime_error("can not apply diff for OR(|) operator");
-            return;
-        }
-        case MathOperator::MATH_MOD: {
-            throw std::runtime_error("can not apply diff for MOD(%) operator");
-            return;
-        }
-        case MathOperator::MATH_LEFT_PARENTHESIS:
-        case MathOperator::MATH_RIGHT_PARENTHESIS:
-            assert(0 && "inner bug");
-            return;
-        default:
-            assert(0 && "inner bug");
-            return;
-        }
+    SymMat JaEqs = Jacobian(equations, table.Vars());
+    internal::PrintJacobian(JaEqs);
+
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+    ConvergenceMonitor monitor;
+    IteratePolyalgorithm(f, df, q, it, monitor);
+
+    table.SetValues(q);
+    return table;
+}
+
+namespace internal {
+
+inline void SolveCompiled(NonlinearMethod method, const CompiledSymMat &f, const CompiledSymMat &df, Vec &q,
+                          ConvergenceMonitor &monitor) {
+    int it = 0;
+    bool square = f.Rows() == q.Rows();
+    if (!square && (method == NonlinearMethod::NEWTON_RAPHSON || method == NonlinearMethod::NEWTON_KRYLOV)) {
+        throw MathError(f.Rows() < q.Rows() ? ErrorType::ERROR_INDETERMINATE_EQUATION
+                                            : ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
     }
-};
+    switch (method) {
+    case NonlinearMethod::NEWTON_RAPHSON: {
+        Equilibration eq;
+        IterateNewton(f, df, q, it, monitor, false, eq);
+        return;
+    }
+    case NonlinearMethod::LM: {
+        Equilibration eq;
+        IterateLM(f, df, q, it, monitor, eq, false);
+        return;
+    }
+    case NonlinearMethod::DOGLEG:
+        IterateDogleg(f, df, q, it, monitor);
+        return;
+    case NonlinearMethod::NEWTON_KRYLOV:
+        IterateNewtonKrylov(f, q, it, monitor, nullptr);
+        return;
+    case NonlinearMethod::AUTO:
+        IteratePolyalgorithm(f, df, q, it, monitor);
+        return;
+    }
+    throw runtime_error("invalid config.NonlinearMethod value: " + std::to_string(static_cast<int>(method)));
+}
 
 } // namespace internal
 
-inline Node Diff(const Node &node, const std::string &varname, int i) {
-    auto node2 = Clone(node);
-    return Diff(std::move(node2), varname, i);
+inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable) {
+    switch (Config::Get().nonlinearMethod) {
+    case NonlinearMethod::NEWTON_RAPHSON:
+        return SolveByNewtonRaphson(equations, varsTable);
+    case NonlinearMethod::LM:
+        return SolveByLM(equations, varsTable);
+    case NonlinearMethod::DOGLEG:
+        return SolveByDogleg(equations, varsTable);
+    case NonlinearMethod::NEWTON_KRYLOV:
+        return SolveByNewtonKrylov(equations, varsTable);
+    case NonlinearMethod::AUTO:
+        return SolveByPolyalgorithm(equations, varsTable);
+    }
+    throw runtime_error("invalid config.NonlinearMethod value: " +
+                        std::to_string(static_cast<int>(Config::Get().nonlinearMethod)));
 }
 
-inline Node Diff(Node &&node, const std::string &varname, int i) {
-    assert(i > 0);
-    auto n = std::move(node);
-    while (i--) {
-        internal::DiffFunctions::DiffOnce(n, varname);
+inline VarsTable Solve(const SymVec &equations) {
+    auto varNames = equations.GetAllVarNames();
+    std::vector<std::string> vecVarNames(varNames.begin(), varNames.end());
+    VarsTable varsTable(std::move(vecVarNames), Config::Get().initialValue);
+    return Solve(equations, varsTable);
+}
+
+inline VarsTable Solve(const SymVec &equations, const VarsTable &varsTable, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return Solve(equations, varsTable);
+}
+
+inline VarsTable Solve(const SymVec &equations, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return Solve(equations);
+}
+
+} // namespace tomsolver
+
+namespace tomsolver {
+
+inline std::vector<VarsTable> SolveMultiStart(const SymVec &equations, const std::vector<VarsTable> &starts,
+                                              const MultiStartOptions &options) {
+    if (starts.empty()) {
+        return {};
     }
-#ifndef NDEBUG
-    auto s = n->ToString();
-    n->CheckParent();
-#endif
-    Simplify(n);
-#ifndef NDEBUG
-    n->CheckParent();
-#endif
-    return n;
+    const std::vector<std::string> &vars = starts[0].Vars();
+    for (auto &start : starts) {
+        if (start.Vars() != vars) {
+            throw MathError(ErrorType::SIZE_NOT_MATCH, "all starts must have the same variables");
+        }
+    }
+
+    // 符号求导与编译只做一次，CompiledSymMat求值不修改自身，各线程共享
+    CompiledSymMat f(equations, vars);
+    CompiledSymMat df(Jacobian(equations, vars), vars);
+    NonlinearMethod method = Config::Get().nonlinearMethod;
+    bool first = options.mode == MultiStartMode::FIRST_CONVERGED;
+
+    int count = static_cast<int>(starts.size());
+    std::vector<Vec> results;
+    results.reserve(count);
+    for (auto &start : starts) {
+        results.push_back(start.Values());
+    }
+    std::vector<char> converged(count, 0); // 每个元素只由一个线程写入
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> winner{-1};
+
+    // 求解失败以外的异常（例如内存不足）由ParallelFor在所有线程结束后重新抛出
+    internal::ParallelFor(count, options.threads, [&](int, int k) {
+        if (cancelled.load()) {
+            return;
+        }
+
+        ConvergenceMonitor monitor;
+        monitor.SetCancelFlag(&cancelled);
+        try {
+            internal::SolveCompiled(method, f, df, results[k], monitor);
+            converged[k] = 1;
+            if (first) {
+                int none = -1;
+                winner.compare_exchange_strong(none, k);
+                cancelled = true;
+            }
+        } catch (const std::runtime_error &) {
+            // 这个初值没有收敛，或者被取消
+        } catch (...) {
+            cancelled = true;
+            throw;
+        }
+    });
+
+    std::vector<VarsTable> roots;
+    if (first) {
+        if (winner >= 0) {
+            roots.emplace_back(vars, results[winner]);
+        }
+        return roots;
+    }
+
+    std::vector<int> distinct; // 互不相同的根对应的初值下标
+    for (int k = 0; k < count; ++k) {
+        if (!converged[k]) {
+            continue;
+        }
+        bool duplicate = std::any_of(distinct.begin(), distinct.end(), [&](int d) {
+            for (int i = 0; i < results[k].Rows(); ++i) {
+                if (!(std::abs(results[k][i] - results[d][i]) < options.rootTolerance)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        if (!duplicate) {
+            distinct.push_back(k);
+            roots.emplace_back(vars, results[k]);
+        }
+    }
+    return roots;
 }
 
 } // namespace tomsolver
 
 namespace tomsolver {
 
-using DataType = std::valarray<Node>;
+namespace {
 
-inline SymMat::SymMat(int rows, int cols) noexcept : rows(rows), cols(cols) {
-    assert(rows > 0 && cols > 0);
-    data.reset(new DataType(rows * cols));
-}
+// SIMD批量求解每批的路数：AVX-512一次处理8个double，AVX2、SSE2分两次、四次
+constexpr int BATCH_LANES = 8;
 
-inline SymMat::SymMat(std::initializer_list<std::initializer_list<Node>> init) noexcept {
-    rows = static_cast<int>(init.size());
-    cols = static_cast<int>(std::max(init, [](auto lhs, auto rhs) {
-                                return lhs.size() < rhs.size();
-                            }).size());
-    data.reset(new DataType(rows * cols));
+// 使用SIMD批量求解的未知数数量上限。更大的方程组每一路的计算量已经足够，逐组求解即可
+constexpr int MAX_LANE_UNKNOWNS = 8;
 
-    auto i = 0;
-    for (auto val : init) {
-        auto j = 0;
-        for (auto &node : val) {
-            (*data)[i * cols + j++] = std::move(const_cast<Node &>(node));
-        }
-        i++;
+// 求解失败的原因。不属于求解失败的错误（例如方程组不是方阵）返回false
+inline bool ToBatchStatus(const MathError &err, BatchStatus &status) noexcept {
+    switch (err.GetErrorType()) {
+    case ErrorType::ERROR_SINGULAR_MATRIX:
+        status = BatchStatus::SINGULAR;
+        return true;
+    case ErrorType::ERROR_INVALID_NUMBER:
+    case ErrorType::ERROR_OUTOF_DOMAIN:
+        status = BatchStatus::INVALID_NUMBER;
+        return true;
+    case ErrorType::ERROR_DIVERGENCE:
+        status = BatchStatus::DIVERGED;
+        return true;
+    case ErrorType::ERROR_STAGNATION:
+        status = BatchStatus::STAGNATED;
+        return true;
+    case ErrorType::ERROR_ITERATION_LIMIT:
+        status = BatchStatus::ITERATION_LIMIT;
+        return true;
+    default:
+        return false;
     }
 }
 
-inline SymMat::SymMat(const Mat &rhs) noexcept : SymMat(rhs.Rows(), rhs.Cols()) {
-    std::generate(std::begin(*data), std::end(*data), [p = std::addressof(rhs.Value(0, 0))]() mutable {
-        return Num(*p++);
-    });
-}
+/*
+ * 用牛顿法同时求解BATCH_LANES组参数，每一路的计算与internal::SolveCompiled的NEWTON_RAPHSON相同
+ * （包括行列平衡与收敛判断），只是求值和LU分解在各路之间交错进行。
+ * 某一路结束（收敛或失败）后，立即从next取下一组参数装入这一路，直到所有参数组都已求解。
+ */
+inline void SolveLanes(const CompiledSymMat &f, const CompiledSymMat &df, MatView params, MatView guesses,
+                       std::atomic<int> &next, BatchResult &result) {
+    const int W = BATCH_LANES;
+    int n = f.Rows();
+    int p = params.Cols();
+    int count = params.Rows();
+    const Config &config = Config::Get();
+
+    // 数据按路交错存放：q[i * W + l]为第l路的第i个未知数
+    std::vector<double> pv(p * W), q(n * W), qNew(n * W), F(n * W), FNew(n * W), J(n * n * W), deltaq(n * W);
+    std::vector<int> pivots(n * W);
+
+    int rows[W];   // 每一路正在求解的参数组，-1表示空闲
+    int its[W];    // 每一路的迭代次数
+    bool fresh[W]; // 刚装入，还没有计算F
+    bool invalid[W], ok[W];
+    ConvergenceMonitor monitors[W];
+    Equilibration eqs[W];
+    std::fill(rows, rows + W, -1);
+
+    auto finish = [&](int l, BatchStatus status) {
+        result.status[rows[l]] = status;
+        for (int i = 0; i < n; ++i) {
+            result.solutions.Value(rows[l], i) = q[i * W + l];
+        }
+        rows[l] = -1;
+    };
+    // 空闲的路仍然参与计算，结果不使用。把最后一条在用的路的数据复制过去，使空闲的路只在有效的数据上计算
+    // （否则是已经结束的组留下的数据，或者全为0，例如x % a中a为0）。v为按路交错存放、每路rowsPerLane个元素的数据
+    auto fillIdle = [&](std::vector<double> &v, int rowsPerLane) {
+        int src = W - 1;
+        while (src >= 0 && rows[src] < 0) {
+            --src;
+        }
+        if (src < 0) {
+            return;
+        }
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] < 0) {
+                for (int i = 0; i < rowsPerLane; ++i) {
+                    v[i * W + l] = v[i * W + src];
+                }
+            }
+        }
+    };
+    auto checkInvalid = [&](const bool *lanes) {
+        for (int l = 0; l < W; ++l) {
+            if (lanes[l] && invalid[l] && config.throwOnInvalidValue) {
+                finish(l, BatchStatus::INVALID_NUMBER);
+            }
+        }
+    };
 
-inline SymMat SymMat::Clone() const noexcept {
-    SymMat ret(Rows(), Cols());
-    std::generate(std::begin(*ret.data), std::end(*ret.data), [iter = std::begin(*data)]() mutable {
-        return tomsolver::Clone(*iter++);
-    });
-    return ret;
-}
+    while (1) {
+        // 把空闲的路装满，并对新装入的路计算F、判断收敛，直到没有空闲的路或者没有剩下的参数组
+        bool refilled = true;
+        while (refilled) {
+            refilled = false;
+            for (int l = 0; l < W; ++l) {
+                fresh[l] = false;
+                if (rows[l] >= 0) {
+                    continue;
+                }
+                int k = next++;
+                if (k >= count) {
+                    continue;
+                }
+                rows[l] = k;
+                its[l] = 0;
+                fresh[l] = refilled = true;
+                monitors[l] = ConvergenceMonitor();
+                eqs[l] = Equilibration();
+                for (int i = 0; i < p; ++i) {
+                    pv[i * W + l] = params.Value(k, i);
+                }
+                for (int i = 0; i < n; ++i) {
+                    q[i * W + l] = guesses.Value(guesses.Rows() == 1 ? 0 : k, i);
+                }
+            }
+            if (!refilled) {
+                break;
+            }
 
-inline bool SymMat::Empty() const noexcept {
-    return data->size() == 0;
-}
+            fillIdle(pv, p);
+            fillIdle(q, n);
+            std::fill(invalid, invalid + W, false);
+            f.EvalLanes<W>(q.data(), pv.data(), FNew.data(), invalid);
+            for (int l = 0; l < W; ++l) {
+                if (fresh[l]) {
+                    for (int i = 0; i < n; ++i) {
+                        F[i * W + l] = FNew[i * W + l];
+                    }
+                }
+            }
+            checkInvalid(fresh);
 
-inline int SymMat::Rows() const noexcept {
-    return rows;
-}
+            for (int l = 0; l < W; ++l) {
+                if (!fresh[l] || rows[l] < 0) {
+                    continue;
+                }
+                try {
+                    if (monitors[l].Check(0, VecView(F.data() + l, n, W))) {
+                        finish(l, BatchStatus::CONVERGED);
+                    } else if (its[l] > config.maxIterations) {
+                        finish(l, BatchStatus::ITERATION_LIMIT);
+                    }
+                } catch (const MathError &err) {
+                    BatchStatus status;
+                    if (!ToBatchStatus(err, status)) {
+                        throw;
+                    }
+                    finish(l, status);
+                }
+            }
+        }
 
-inline int SymMat::Cols() const noexcept {
-    return cols;
-}
+        bool live[W];
+        for (int l = 0; l < W; ++l) {
+            live[l] = rows[l] >= 0;
+        }
+        if (std::none_of(live, live + W, [](bool b) {
+                return b;
+            })) {
+            return;
+        }
 
-inline SymVec SymMat::ToSymVec() const {
-    assert(rows > 0);
-    if (cols != 1) {
-        throw std::runtime_error("SymMat::ToSymVec fail. rows is not one");
-    }
-    return ToSymVecOneByOne();
-}
+        fillIdle(pv, p);
+        fillIdle(q, n);
+        std::fill(invalid, invalid + W, false);
+        df.EvalLanes<W>(q.data(), pv.data(), J.data(), invalid);
+        checkInvalid(live);
+
+        // 每一路分别做行列平衡：J = R·J·C，F = R·F
+        deltaq = F;
+        if (config.equilibrate) {
+            for (int l = 0; l < W; ++l) {
+                if (rows[l] < 0) {
+                    continue;
+                }
+                MatView Jl(J.data() + l, n, n, n * W, W);
+                if (!eqs[l].IsComputed() || config.updateEquilibration) {
+                    eqs[l].Compute(Jl);
+                }
+                VecView r = eqs[l].RowScale(), c = eqs[l].ColScale();
+                for (int i = 0; i < n; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J[(i * n + j) * W + l] *= r[i] * c[j];
+                    }
+                    deltaq[i * W + l] *= r[i];
+                }
+            }
+        }
 
-inline SymVec SymMat::ToSymVecOneByOne() const noexcept {
-    SymVec v(rows * cols);
-    std::generate(std::begin(*v.data), std::end(*v.data), [iter = std::begin(*data)]() mutable {
-        return tomsolver::Clone(*iter++);
-    });
-    return v;
-}
+        std::fill(ok, ok + W, true);
+        internal::LUFactorLanes<W>(J.data(), n, pivots.data(), ok);
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] >= 0 && !ok[l]) {
+                finish(l, BatchStatus::SINGULAR);
+            }
+        }
 
-inline Mat SymMat::ToMat() const {
-    std::valarray<double> newData(data->size());
-    std::generate(std::begin(newData), std::end(newData), [iter = std::begin(*data)]() mutable {
-        if ((**iter).type != NodeType::NUMBER) {
-            throw std::runtime_error("ToMat error: node is not number");
+        internal::LUSolveLanes<W>(J.data(), pivots.data(), n, deltaq.data());
+        if (config.equilibrate) {
+            for (int l = 0; l < W; ++l) {
+                if (rows[l] < 0) {
+                    continue;
+                }
+                VecView c = eqs[l].ColScale();
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i * W + l] *= c[i];
+                }
+            }
+        }
+        for (int i = 0; i < n * W; ++i) {
+            qNew[i] = q[i] - deltaq[i];
         }
-        return (**iter++).value;
-    });
-    return {rows, cols, newData};
-}
 
-inline SymMat &SymMat::Calc() {
-    for (auto &node : *data) {
-        node->Calc();
-    }
-    return *this;
-}
+        fillIdle(qNew, n);
+        std::fill(invalid, invalid + W, false);
+        f.EvalLanes<W>(qNew.data(), pv.data(), FNew.data(), invalid);
+        for (int l = 0; l < W; ++l) {
+            live[l] = rows[l] >= 0;
+        }
+        checkInvalid(live);
 
-inline SymMat &SymMat::Subs(const std::map<std::string, double> &varValues) noexcept {
-    for (auto &node : *data) {
-        node = tomsolver::Subs(std::move(node), varValues);
-    }
-    return *this;
-}
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] < 0) {
+                continue;
+            }
+            ++its[l];
+            double stepNorm2 = 0, qNorm2 = 0;
+            for (int i = 0; i < n; ++i) {
+                q[i * W + l] = qNew[i * W + l];
+                F[i * W + l] = FNew[i * W + l];
+                stepNorm2 += deltaq[i * W + l] * deltaq[i * W + l];
+                qNorm2 += q[i * W + l] * q[i * W + l];
+            }
+            if (monitors[l].StepConverged(std::sqrt(stepNorm2), std::sqrt(qNorm2))) {
+                finish(l, BatchStatus::CONVERGED);
+                continue;
+            }
 
-inline SymMat &SymMat::Subs(const VarsTable &varsTable) noexcept {
-    for (auto &node : *data) {
-        node = tomsolver::Subs(std::move(node), varsTable);
+            try {
+                if (monitors[l].Check(its[l], VecView(F.data() + l, n, W))) {
+                    finish(l, BatchStatus::CONVERGED);
+                } else if (its[l] > config.maxIterations) {
+                    finish(l, BatchStatus::ITERATION_LIMIT);
+                }
+            } catch (const MathError &err) {
+                BatchStatus status;
+                if (!ToBatchStatus(err, status)) {
+                    throw;
+                }
+                finish(l, status);
+            }
+        }
     }
-    return *this;
 }
 
-inline std::set<std::string> SymMat::GetAllVarNames() const noexcept {
-    std::set<std::string> ret;
-    for (auto &node : *data) {
-        auto names = node->GetAllVarNames();
-        ret.insert(names.begin(), names.end());
-    }
-    return ret;
-}
+} // namespace
 
-inline SymMat SymMat::operator-(const SymMat &rhs) const noexcept {
-    assert(rhs.rows == rows && rhs.cols == cols);
-    SymMat ret(rows, cols);
-    std::generate(std::begin(*ret.data), std::end(*ret.data),
-                  [lhsIter = std::begin(*data), rhsIter = std::begin(*rhs.data)]() mutable {
-                      return *lhsIter++ - *rhsIter++;
-                  });
-    return ret;
-}
+inline BatchResult SolveBatch(const SymVec &equations, const std::vector<std::string> &unknowns,
+                              const std::vector<std::string> &parameterNames, const Mat &parameterRows, const Mat &initialGuesses, const BatchOptions &options) {
+    int count = parameterRows.Rows();
+    int n = static_cast<int>(unknowns.size());
+    if (parameterRows.Cols() != static_cast<int>(parameterNames.size()) || initialGuesses.Cols() != n ||
+        (initialGuesses.Rows() != 1 && initialGuesses.Rows() != count)) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH, "parameterRows: " + std::to_string(count) + "x" +
+                                                       std::to_string(parameterRows.Cols()) + ", initialGuesses: " +
+                                                       std::to_string(initialGuesses.Rows()) + "x" +
+                                                       std::to_string(initialGuesses.Cols()));
+    }
 
-inline SymMat SymMat::operator*(const SymMat &rhs) const {
-    if (cols != rhs.rows) {
-        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    // 符号求导与编译只做一次
+    CompiledSymMat f(equations, unknowns, parameterNames);
+    CompiledSymMat df(Jacobian(equations, unknowns), unknowns, parameterNames);
+    NonlinearMethod method = Config::Get().nonlinearMethod;
+
+    BatchResult result{Mat(count, n), std::vector<BatchStatus>(count, BatchStatus::CONVERGED)};
+    MatView params(parameterRows), guesses(initialGuesses);
+
+    // 小规模方程组用牛顿法求解时，多组参数打包为一批，各组的参数值由EvalLanes直接读取，f与df各线程共享
+    if (options.laneBatched && method == NonlinearMethod::NEWTON_RAPHSON && f.Rows() == n && n <= MAX_LANE_UNKNOWNS) {
+        // 每个线程同时求解BATCH_LANES组，各线程从next取下一组参数
+        std::atomic<int> next{0};
+        int workers = internal::ParallelWorkers((count + BATCH_LANES - 1) / BATCH_LANES, options.threads);
+        internal::ParallelFor(workers, workers, [&](int, int) {
+            SolveLanes(f, df, params, guesses, next, result);
+        });
+        return result;
     }
 
-    SymMat ans(rows, rhs.cols);
-    for (int i = 0; i < Rows(); ++i) {
-        for (int j = 0; j < rhs.cols; ++j) {
-            auto sum = Value(i, 0) * rhs.Value(0, j);
-            for (int k = 1; k < cols; ++k) {
-                sum += Value(i, k) * rhs.Value(k, j);
+    // 参数值保存在CompiledSymMat中，每个线程使用自己的副本
+    int workers = internal::ParallelWorkers(count, options.threads);
+    std::vector<CompiledSymMat> fs(workers, f), dfs(workers, df);
+    internal::ParallelFor(count, options.threads, [&](int worker, int k) {
+        fs[worker].SetParams(params.Row(k));
+        dfs[worker].SetParams(params.Row(k));
+        Vec q(guesses.Row(guesses.Rows() == 1 ? 0 : k));
+
+        ConvergenceMonitor monitor;
+        try {
+            internal::SolveCompiled(method, fs[worker], dfs[worker], q, monitor);
+        } catch (const MathError &err) {
+            if (!ToBatchStatus(err, result.status[k])) {
+                throw;
             }
-            ans.Value(i, j) = Move(sum);
         }
-    }
-    return ans;
-}
 
-inline bool SymMat::operator==(const SymMat &rhs) const noexcept {
-    if (rhs.rows != rows || rhs.cols != cols) {
-        return false;
-    }
-    return std::equal(std::begin(*data), std::end(*data), std::begin(*rhs.data), [](auto &node1, auto &node2) {
-        return node1->Equal(node2);
+        for (int j = 0; j < n; ++j) {
+            result.solutions.Value(k, j) = q[j];
+        }
     });
+    return result;
 }
 
-inline Node &SymMat::Value(int i, int j) noexcept {
-    return (*data)[i * cols + j];
-}
-
-inline const Node &SymMat::Value(int i, int j) const noexcept {
-    return (*data)[i * cols + j];
-}
-
-inline std::string SymMat::ToString() const noexcept {
-    if (data->size() == 0) {
-        return "[]\n";
-    }
+} // namespace tomsolver
 
-    std::stringstream ss;
-    ss << "[";
+namespace tomsolver {
 
-    size_t i = 0;
-    for (auto &node : *data) {
-        ss << (i == 0 ? "" : " ") << node->ToString();
-        i++;
-        ss << (i % cols == 0 ? (i == data->size() ? "]\n" : "\n") : ", ");
+inline ParametricSystem::ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                                          const std::vector<std::string> &params)
+    : unknowns(unknowns), params(params), values(params.size(), 0),
+      f(equations, unknowns, params), df(Jacobian(equations, unknowns), unknowns, params) {
+    for (int i = 0; i < static_cast<int>(params.size()); ++i) {
+        paramIndex.emplace(params[i], i);
     }
+}
 
-    return ss.str();
+inline ParametricSystem::ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                                          const VarsTable &params)
+    : ParametricSystem(equations, unknowns, params.Vars()) {
+    Rebind(params);
 }
 
-inline SymVec::SymVec(int rows) noexcept : SymMat(rows, 1) {}
+inline const std::vector<std::string> &ParametricSystem::Unknowns() const noexcept {
+    return unknowns;
+}
 
-inline SymVec::SymVec(std::initializer_list<Node> init) noexcept : SymMat(static_cast<int>(init.size()), 1) {
-    auto i = 0;
-    for (auto &node : init) {
-        (*data)[i++] = std::move(const_cast<Node &>(node));
-    }
+inline const std::vector<std::string> &ParametricSystem::Params() const noexcept {
+    return params;
 }
 
-inline SymVec SymVec::operator-(const SymVec &rhs) const noexcept {
-    return SymMat::operator-(rhs).ToSymVec();
+inline void ParametricSystem::Rebind(VecView values) noexcept {
+    assert(values.Size() == static_cast<int>(params.size()));
+    f.SetParams(values);
+    df.SetParams(values);
+    for (int i = 0; i < values.Size(); ++i) {
+        this->values[i] = values[i];
+    }
 }
 
-inline Node &SymVec::operator[](std::size_t index) noexcept {
-    return (*data)[index];
+inline void ParametricSystem::Rebind(const VarsTable &params) {
+    // 先检查全部名字，出错时不修改任何参数
+    for (auto &item : params) {
+        if (paramIndex.find(item.first) == paramIndex.end()) {
+            throw MathError(ErrorType::ERROR_UNDEFINED_VARIABLE, item.first + " is not a parameter");
+        }
+    }
+    for (auto &item : params) {
+        values[paramIndex.find(item.first)->second] = item.second;
+    }
+    if (!values.empty()) {
+        f.SetParams(VecView(values.data(), static_cast<int>(values.size())));
+        df.SetParams(VecView(values.data(), static_cast<int>(values.size())));
+    }
 }
 
-inline const Node &SymVec::operator[](std::size_t index) const noexcept {
-    return (*data)[index];
+inline Vec ParametricSystem::Eval(VecView q) const {
+    return f.Eval(q).ToVec();
 }
 
-inline SymMat Jacobian(const SymMat &equations, const std::vector<std::string> &vars) noexcept {
-    int rows = equations.rows;
-    int cols = static_cast<int>(vars.size());
-    SymMat ja(rows, cols);
-    std::generate(std::begin(*ja.data), std::end(*ja.data),
-                  [iter = std::begin(*equations.data), &vars, i = size_t{0}]() mutable {
-                      if (i == vars.size()) {
-                          i = 0;
-                          iter++;
-                      }
-                      return Diff(*iter, vars[i++]);
-                  });
-    return ja;
+inline void ParametricSystem::Solve(Vec &q) const {
+    assert(q.Rows() == static_cast<int>(unknowns.size()));
+    ConvergenceMonitor monitor;
+    internal::SolveCompiled(Config::Get().nonlinearMethod, f, df, q, monitor);
 }
 
-inline std::ostream &operator<<(std::ostream &out, const SymMat &symMat) noexcept {
-    return out << symMat.ToString();
+inline VarsTable ParametricSystem::Solve(const VarsTable &initialValues) const {
+    if (initialValues.VarNums() != static_cast<int>(unknowns.size())) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH, "initial values must be given for exactly the unknowns");
+    }
+    Vec q(static_cast<int>(unknowns.size()));
+    for (int i = 0; i < q.Rows(); ++i) {
+        if (!initialValues.Has(unknowns[i])) {
+            throw MathError(ErrorType::SIZE_NOT_MATCH, "no initial value for " + unknowns[i]);
+        }
+        q[i] = initialValues[unknowns[i]];
+    }
+    Solve(q);
+    return {unknowns, q};
 }
 
 } // namespace tomsolver
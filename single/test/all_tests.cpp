@@ -73,11 +73,45 @@ private:
 
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <new>
 #include <random>
 
 using std::cout;
 using std::endl;
 
+namespace {
+
+long long &AllocationCounter() noexcept {
+    static thread_local long long count = 0;
+    return count;
+}
+
+} // namespace
+
+// 不允许内联：operator delete内联到调用处后，编译器会把其中的free误报为与new不匹配
+#ifdef _MSC_VER
+#define TOMSOLVER_TEST_NOINLINE __declspec(noinline)
+#else
+#define TOMSOLVER_TEST_NOINLINE __attribute__((noinline))
+#endif
+
+TOMSOLVER_TEST_NOINLINE void *operator new(std::size_t size) {
+    ++AllocationCounter();
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+TOMSOLVER_TEST_NOINLINE void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+TOMSOLVER_TEST_NOINLINE void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
 namespace tomsolver {
 
 std::pair<Node, double> CreateRandomExpresionTree(int len) {
@@ -190,7 +224,589 @@ std::pair<Node, double> CreateRandomExpresionTree(int len) {
     return {std::move(node), v};
 }
 
+long long AllocationCount() noexcept {
+    return AllocationCounter();
+}
+
 } // namespace tomsolver
+TEST(Batch, Solve) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 圆x^2 + y^2 = r^2与直线y = a*x在第一象限的交点
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*x"_f};
+    int count = 200;
+    Mat params(count, 2);
+    for (int i = 0; i < count; ++i) {
+        params.Value(i, 0) = 1 + 0.05 * i;
+        params.Value(i, 1) = 0.5 + 0.01 * i;
+    }
+
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::AUTO}) {
+        Config::Get().nonlinearMethod = method;
+        for (int threads : {1, 4}) {
+            BatchOptions options;
+            options.threads = threads;
+            BatchResult result = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, Mat({{1, 1}}), options);
+            ASSERT_EQ(result.solutions.Rows(), count);
+            ASSERT_EQ(result.solutions.Cols(), 2);
+            ASSERT_EQ(static_cast<int>(result.status.size()), count);
+            for (int i = 0; i < count; ++i) {
+                double r = params.Value(i, 0), a = params.Value(i, 1);
+                double x = r / std::sqrt(1 + a * a);
+                ASSERT_EQ(result.status[i], BatchStatus::CONVERGED);
+                ASSERT_NEAR(result.solutions.Value(i, 0), x, 1e-8);
+                ASSERT_NEAR(result.solutions.Value(i, 1), a * x, 1e-8);
+            }
+        }
+    }
+}
+TEST(Batch, Status) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 每组参数使用自己的初值
+    {
+        SymVec f = {"x^2 - a"_f};
+        BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{4}, {4}, {9}}), Mat({{1}, {-1}, {1}}));
+        ASSERT_EQ(result.solutions, Mat({{2}, {-2}, {3}}));
+
+        // x^2 = -1没有实根：从1出发的第一步到达0，雅可比矩阵奇异
+        result = SolveBatch(f, {"x"}, {"a"}, Mat({{4}, {-1}}), Mat({{1}}));
+        ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+        ASSERT_EQ(result.status[1], BatchStatus::SINGULAR);
+    }
+
+    // sqrt(x) = -1：第一步越过定义域
+    {
+        SymVec f = {"sqrt(x) - a"_f};
+        BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{2}, {-1}}), Mat({{1}}));
+        ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+        ASSERT_NEAR(result.solutions.Value(0, 0), 4, 1e-9);
+        ASSERT_EQ(result.status[1], BatchStatus::INVALID_NUMBER);
+    }
+
+    // 迭代次数超出限制，逐组求解与SIMD批量求解相同
+    {
+        SymVec f = {"x^2 - a"_f};
+        Config::Get().maxIterations = 1;
+        for (bool laneBatched : {true, false}) {
+            BatchOptions options;
+            options.laneBatched = laneBatched;
+            BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{1}, {100}}), Mat({{1}}), options);
+            ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+            ASSERT_EQ(result.status[1], BatchStatus::ITERATION_LIMIT);
+        }
+        Config::Get().Reset();
+    }
+
+    // 其他错误不作为某一组的求解结果，照常抛出
+    {
+        SymVec f = {"x^2 - a"_f};
+        Config::Get().nonlinearMethod = static_cast<NonlinearMethod>(-1);
+        ASSERT_THROW(SolveBatch(f, {"x"}, {"a"}, Mat({{4}}), Mat({{1}})), std::runtime_error);
+        Config::Get().Reset();
+    }
+
+    // 尺寸不一致
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - x"_f};
+    try {
+        SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1, 2}}), Mat({{1, 1}}));
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::SIZE_NOT_MATCH);
+    }
+    ASSERT_THROW(SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1}, {2}}), Mat({{1, 1}, {1, 1}, {1, 1}})), MathError);
+    ASSERT_THROW(SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1}}), Mat({{1}})), MathError);
+
+    // 方程组中有未声明的符号
+    try {
+        SolveBatch(f, {"x"}, {"r"}, Mat({{1}}), Mat({{1}}));
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+}
+TEST(Batch, Lanes) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // SIMD批量求解与逐组求解的结果相同，包括没有收敛的组。组数不是8的倍数
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*sqrt(x)"_f};
+    int count = 203;
+    Mat params(count, 2);
+    for (int i = 0; i < count; ++i) {
+        params.Value(i, 0) = i % 7 == 3 ? 0 : 0.5 + 0.02 * i;
+        params.Value(i, 1) = i % 11 == 5 ? -40 : 1 + 0.01 * i;
+    }
+    Mat guesses(count, 2, 1);
+    for (int i = 0; i < count; ++i) {
+        guesses.Value(i, 0) = 0.2 + 0.01 * (i % 13);
+    }
+
+    for (bool equilibrate : {true, false}) {
+        Config::Get().equilibrate = equilibrate;
+        Config::Get().stagnationIterations = 20;
+        BatchOptions scalar;
+        scalar.laneBatched = false;
+        BatchResult expected = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, guesses, scalar);
+        for (int threads : {1, 3}) {
+            BatchOptions options;
+            options.threads = threads;
+            BatchResult got = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, guesses, options);
+            int converged = 0;
+            for (int i = 0; i < count; ++i) {
+                ASSERT_EQ(got.status[i], expected.status[i]) << i;
+                converged += got.status[i] == BatchStatus::CONVERGED;
+                if (got.status[i] == BatchStatus::CONVERGED) {
+                    ASSERT_NEAR(got.solutions.Value(i, 0), expected.solutions.Value(i, 0), 1e-12);
+                    ASSERT_NEAR(got.solutions.Value(i, 1), expected.solutions.Value(i, 1), 1e-12);
+                }
+            }
+            ASSERT_GT(converged, count / 2);
+            ASSERT_LT(converged, count);
+        }
+    }
+}
+
+TEST(CompiledSymMat, Base) {
+    MemoryLeakDetection mld;
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    std::vector<std::string> vars = {"x1", "x2", "x3"};
+    SymMat J = Jacobian(f, vars);
+
+    CompiledSymMat cf(f, vars);
+    CompiledSymMat cj(J, vars);
+    ASSERT_EQ(cf.Rows(), 3);
+    ASSERT_EQ(cf.Cols(), 1);
+    ASSERT_EQ(cj.Cols(), 3);
+    ASSERT_EQ(cj.VarNums(), 3);
+
+    // 与替换后计算的结果一致
+    VarsTable table({{"x1", 0.3}, {"x2", -1.2}, {"x3", 2.5}});
+    ASSERT_EQ(cf.Eval(table.Values()), f.Clone().Subs(table).Calc().ToMat());
+    ASSERT_EQ(cj.Eval(table.Values()), J.Clone().Subs(table).Calc().ToMat());
+
+    Mat out(3, 3);
+    cj.Eval(table.Values(), out);
+    ASSERT_EQ(out, J.Clone().Subs(table).Calc().ToMat());
+
+    // 变量顺序由vars决定
+    CompiledSymMat reversed(f, {"x3", "x2", "x1"});
+    ASSERT_EQ(reversed.Eval(Vec{2.5, -1.2, 0.3}), cf.Eval(table.Values()));
+
+    // float和long double求值
+    Mat expected = cf.Eval(table.Values());
+    float xf[] = {0.3f, -1.2f, 2.5f}, outf[3];
+    cf.Eval(xf, outf);
+    long double xl[] = {0.3L, -1.2L, 2.5L}, outl[3];
+    cf.Eval(xl, outl);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NEAR(outf[i], expected.Value(i, 0), 1e-6);
+        ASSERT_NEAR(static_cast<double>(outl[i]), expected.Value(i, 0), 1e-15);
+    }
+}
+TEST(CompiledSymMat, Calc) {
+    MemoryLeakDetection mld;
+
+    // 参数类型不一致时使用double版本
+    ASSERT_DOUBLE_EQ(Calc(MathOperator::MATH_ADD, 1.5, 2), 3.5);
+    ASSERT_DOUBLE_EQ(Calc(MathOperator::MATH_SQRT, 4, 0), 2);
+
+    // 显式指定标量类型
+    static_assert(std::is_same<decltype(Calc<float>(MathOperator::MATH_ADD, 1.5f, 2)), float>::value, "");
+    ASSERT_FLOAT_EQ(Calc<float>(MathOperator::MATH_MULTIPLY, 1.5f, 2), 3.0f);
+    ASSERT_EQ(Calc<long double>(MathOperator::MATH_DIVIDE, 1, 4), 0.25L);
+}
+TEST(CompiledSymMat, Error) {
+    MemoryLeakDetection mld;
+
+    // 未给出的变量
+    SymVec f = {"x+y"_f};
+    try {
+        CompiledSymMat c(f, {"x"});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+
+    // 无效值
+    CompiledSymMat c({{"log(x)"_f}}, {"x"});
+    ASSERT_THROW(c.Eval(Vec{-1}), MathError);
+    float x = -1, out;
+    ASSERT_THROW(c.Eval(&x, &out), MathError);
+}
+TEST(CompiledSymMat, Params) {
+    MemoryLeakDetection mld;
+
+    // a、r为参数：修改参数值不需要重新编译
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*x"_f};
+    CompiledSymMat c(f, {"x", "y"}, {"r", "a"});
+    ASSERT_EQ(c.VarNums(), 2);
+    ASSERT_EQ(c.ParamNums(), 2);
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{5}, {2}}));
+
+    c.SetParams(Vec{2, 3});
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{1}, {-1}}));
+    double xf[] = {3, 1}, out[2];
+    c.Eval(xf, out);
+    ASSERT_DOUBLE_EQ(out[0], 6);
+    ASSERT_DOUBLE_EQ(out[1], -8);
+
+    // 与替换后计算的结果一致
+    VarsTable table({{"x", 1}, {"y", 2}, {"r", 2}, {"a", 3}});
+    ASSERT_EQ(c.Eval(Vec{1, 2}), f.Clone().Subs(table).Calc().ToMat());
+
+    // 副本的参数值互不影响
+    CompiledSymMat copy = c;
+    copy.SetParams(Vec{0, 0});
+    ASSERT_EQ(copy.Eval(Vec{1, 2}), Mat({{5}, {2}}));
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{1}, {-1}}));
+
+    // 参数与变量重名
+    try {
+        CompiledSymMat dup(f, {"x", "y"}, {"r", "x"});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_VAR_HAS_BEEN_DEFINED);
+    }
+}
+TEST(CompiledSymMat, Lanes) {
+    MemoryLeakDetection mld;
+
+    // 4组自变量与参数交错存放，结果与逐组求值相同
+    SymVec f = {"sqrt(x) * a + y"_f, "x ^ 2 - y / a"_f};
+    CompiledSymMat c(f, {"x", "y"}, {"a"});
+    double x[] = {1, 4, 9, -1, 2, 3, 4, 5}, a[] = {1, 2, 0.5, 3}, out[8];
+    bool invalid[4] = {};
+    c.EvalLanes<4>(x, a, out, invalid);
+    for (int l = 0; l < 3; ++l) {
+        c.SetParams(Vec{a[l]});
+        Mat expected = c.Eval(Vec{x[l], x[4 + l]});
+        ASSERT_FALSE(invalid[l]);
+        ASSERT_DOUBLE_EQ(out[l], expected.Value(0, 0));
+        ASSERT_DOUBLE_EQ(out[4 + l], expected.Value(1, 0));
+    }
+
+    // sqrt(-1)只影响第3组，不抛出异常
+    ASSERT_TRUE(invalid[3]);
+    ASSERT_DOUBLE_EQ(out[7], 1 - 5.0 / 3);
+
+    // 组数不是4的倍数，空闲的第3路全为0：对0取模的结果为nan，不会出现整数除以0
+    SymVec g = {"x % a + (y & 6) + (y | 1)"_f};
+    CompiledSymMat d(g, {"x", "y"}, {"a"});
+    double gx[] = {7, 8, -9, 0, 3, 5, 6, 0}, ga[] = {3, 5, 4, 0}, gout[4];
+    bool ginvalid[4] = {};
+    d.EvalLanes<4>(gx, ga, gout, ginvalid);
+    for (int l = 0; l < 3; ++l) {
+        d.SetParams(Vec{ga[l]});
+        ASSERT_FALSE(ginvalid[l]);
+        ASSERT_DOUBLE_EQ(gout[l], d.Eval(Vec{gx[l], gx[4 + l]}).Value(0, 0));
+    }
+    ASSERT_TRUE(ginvalid[3]);
+    ASSERT_TRUE(std::isnan(gout[3]));
+
+    // nan与超出int范围的操作数同样得到nan
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    double hx[] = {nan, 1e10, 1, 2, 1, 1, 1e10, 1}, ha[] = {3, 3, 3, 3}, hout[4];
+    bool hinvalid[4] = {};
+    d.EvalLanes<4>(hx, ha, hout, hinvalid);
+    ASSERT_TRUE(hinvalid[0] && hinvalid[1] && hinvalid[2]);
+    ASSERT_FALSE(hinvalid[3]);
+    ASSERT_DOUBLE_EQ(hout[3], 2 + 0 + 1);
+}
+TEST(CompiledSymMat, Deep) {
+    MemoryLeakDetection mld;
+
+    // 右结合的长表达式，求值栈深度超过64
+    Node n = Var("x");
+    for (int i = 0; i < 100; ++i) {
+        n = Var("x") + std::move(n) * Num(0.5);
+    }
+    SymMat m(1, 1);
+    m.Value(0, 0) = Clone(n);
+    CompiledSymMat c(m, {"x"});
+    double expected = 0, k = 1;
+    for (int i = 0; i <= 100; ++i) {
+        expected += 2 * k;
+        k *= 0.5;
+    }
+    ASSERT_NEAR(c.Eval(Vec{2}).Value(0, 0), expected, 1e-12);
+}
+
+TEST(Config, Scope) {
+    MemoryLeakDetection mld;
+
+    SolverOptions options;
+    options.epsilon = 1.0e-3;
+    {
+        ConfigScope scope(options);
+        ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-3);
+
+        // 可以嵌套
+        options.epsilon = 1.0e-5;
+        {
+            ConfigScope inner(options);
+            ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-5);
+        }
+        ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-3);
+
+        // 其他线程仍然使用全局配置
+        double other = 0;
+        std::thread t([&other] {
+            other = Config::Get().epsilon;
+        });
+        t.join();
+        ASSERT_DOUBLE_EQ(other, 1.0e-9);
+
+        // 作用域内的修改不影响全局配置
+        Config::Get().maxIterations = 1;
+    }
+    ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-9);
+    ASSERT_EQ(Config::Get().maxIterations, 100);
+}
+TEST(Config, ConcurrentOptions) {
+    MemoryLeakDetection mld;
+
+    SymVec equations = {"x^2 + y^2 - 4"_f, "x - y"_f};
+    VarsTable start{{"x", 1}, {"y", 0.5}};
+    Mat A = {{1, 1}};
+    Vec b = {2};
+    Node invalid = "log(0-1)"_f;
+
+    // 每个线程使用不同的选项反复求解，结果只取决于自己的选项
+    std::atomic<int> failures{0};
+    auto worker = [&](int id) {
+        SolverOptions options;
+        bool odd = id % 2 == 1;
+        options.nonlinearMethod = odd ? NonlinearMethod::LM : NonlinearMethod::NEWTON_RAPHSON;
+        options.epsilon = odd ? 1.0e-12 : 1.0e-6;
+        options.allowIndeterminateEquation = odd;
+        options.throwOnInvalidValue = !odd;
+        for (int i = 0; i < 200; ++i) {
+            VarsTable got = Solve(equations, start, options);
+            if (!(std::abs(got["x"] - std::sqrt(2.0)) < 1.0e-5) ||
+                !(std::abs(got["x"] - got["y"]) < options.epsilon)) {
+                ++failures;
+            }
+
+            try {
+                Vec x = SolveLinear(A, b, options);
+                if (!odd || !(std::abs(x[0] - 1) < 1.0e-9)) {
+                    ++failures;
+                }
+            } catch (const MathError &) {
+                if (odd) {
+                    ++failures;
+                }
+            }
+
+            try {
+                double v = invalid->Vpa(options);
+                if (!odd || !std::isnan(v)) {
+                    ++failures;
+                }
+            } catch (const MathError &) {
+                if (odd) {
+                    ++failures;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int id = 0; id < 8; ++id) {
+        threads.emplace_back(worker, id);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(failures, 0);
+
+    // 全局配置没有被修改
+    ASSERT_EQ(Config::Get().nonlinearMethod, NonlinearMethod::NEWTON_RAPHSON);
+    ASSERT_FALSE(Config::Get().allowIndeterminateEquation);
+    ASSERT_THROW(SolveLinear(A, b), MathError);
+    ASSERT_THROW(invalid->Vpa(), MathError);
+}
+
+TEST(ConvergenceMonitor, Base) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 默认只有绝对残差容差
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_FALSE(monitor.Check(0, Vec({10, -20})));
+        ASSERT_DOUBLE_EQ(monitor.Tolerance(), Config::Get().epsilon);
+        ASSERT_FALSE(monitor.Check(1, Vec({1e-3, 0})));
+        ASSERT_TRUE(monitor.Check(2, Vec({1e-10, -1e-10})));
+        ASSERT_FALSE(monitor.StepConverged(0, 1));
+        ASSERT_FALSE(monitor.Check(3, Vec({std::numeric_limits<double>::quiet_NaN(), 0})));
+    }
+
+    // 相对残差容差
+    Config::Get().relativeTolerance = 0.01;
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_FALSE(monitor.Check(0, Vec({10, -20})));
+        ASSERT_DOUBLE_EQ(monitor.Tolerance(), 0.2);
+        ASSERT_FALSE(monitor.Check(1, Vec({0.1, -0.3})));
+        ASSERT_TRUE(monitor.Check(2, Vec({0.1, -0.2})));
+    }
+    Config::Get().relativeTolerance = 0;
+
+    // 步长容差
+    Config::Get().stepTolerance = 1e-6;
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_TRUE(monitor.StepConverged(1e-7, 1));
+        ASSERT_FALSE(monitor.StepConverged(1e-5, 1));
+        ASSERT_TRUE(monitor.StepConverged(1e-3, 1e4));
+        ASSERT_TRUE(monitor.StepConverged(0, 0));
+    }
+    Config::Get().stepTolerance = 0;
+
+    // 发散
+    Config::Get().divergenceRatio = 100;
+    {
+        ConvergenceMonitor monitor;
+        monitor.Check(0, Vec({1}));
+        monitor.Check(1, Vec({99}));
+        try {
+            monitor.Check(2, Vec({101}));
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_DIVERGENCE);
+        }
+    }
+    Config::Get().divergenceRatio = 0;
+
+    // 停滞：下降不足STAGNATION_DECREASE的迭代不算作进展
+    Config::Get().stagnationIterations = 3;
+    {
+        ConvergenceMonitor monitor;
+        monitor.Check(0, Vec({1}));
+        monitor.Check(1, Vec({0.5}));
+        monitor.Check(2, Vec({0.4999}));
+        monitor.Check(3, Vec({0.6}));
+        monitor.Check(4, Vec({0.1}));
+        monitor.Check(5, Vec({0.2}));
+        monitor.Check(6, Vec({0.09999}));
+        try {
+            monitor.Check(7, Vec({0.1}));
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_STAGNATION);
+        }
+    }
+}
+TEST(ConvergenceMonitor, Cancel) {
+    MemoryLeakDetection mld;
+
+    std::atomic<bool> cancelled{false};
+    ConvergenceMonitor monitor;
+    monitor.SetCancelFlag(&cancelled);
+    ASSERT_FALSE(monitor.Check(0, Vec({1})));
+    cancelled = true;
+    try {
+        monitor.Check(1, Vec({0.5}));
+        FAIL();
+    } catch (const MathError &err) {
+        ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_CANCELLED);
+    }
+
+    // 在迭代中途取消
+    SymVec f = {"x^2 + 1"_f};
+    CompiledSymMat compiled(f, {"x"});
+    CompiledSymMat jacobian(Jacobian(f, {"x"}), {"x"});
+    Vec q = {3};
+    ConvergenceMonitor solveMonitor;
+    solveMonitor.SetCancelFlag(&cancelled);
+    ASSERT_THROW(internal::SolveCompiled(NonlinearMethod::LM, compiled, jacobian, q, solveMonitor), MathError);
+}
+TEST(ConvergenceMonitor, Solve) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 相对残差容差与步长容差让迭代提前结束
+    SymVec f = {"x^2 - 2"_f};
+    VarsTable init{{"x", 1}};
+    Config::Get().relativeTolerance = 1e-3;
+    VarsTable got = Solve(f, init);
+    ASSERT_LE(std::abs(got["x"] * got["x"] - 2), 1e-3);
+    ASSERT_GT(std::abs(got["x"] * got["x"] - 2), Config::Get().epsilon);
+    Config::Get().relativeTolerance = 0;
+
+    Config::Get().stepTolerance = 1e-4;
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::NEWTON_KRYLOV}) {
+        Config::Get().nonlinearMethod = method;
+        got = Solve(f, init);
+        ASSERT_NEAR(got["x"], std::sqrt(2.0), 1e-6);
+    }
+    Config::Get().stepTolerance = 0;
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // x² + 1 = 0没有实根：默认一直迭代到次数上限，开启停滞检测后提前放弃
+    SymVec hopeless = {"x^2 + 1"_f};
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG}) {
+        Config::Get().nonlinearMethod = method;
+        Config::Get().stagnationIterations = 0;
+        ASSERT_THROW(Solve(hopeless, VarsTable{{"x", 3}}), std::runtime_error);
+
+        Config::Get().stagnationIterations = 10;
+        try {
+            Solve(hopeless, VarsTable{{"x", 3}});
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_STAGNATION);
+        }
+    }
+    Config::Get().stagnationIterations = 0;
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // 立方根的牛顿迭代x ← -2x发散，||F||每次增大2^(1/3)倍
+    SymVec cbrt = {"x / (x^2)^(1/3)"_f};
+    Config::Get().divergenceRatio = 10;
+    try {
+        Solve(cbrt, VarsTable{{"x", 1}});
+        FAIL();
+    } catch (const MathError &err) {
+        ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_DIVERGENCE);
+    }
+
+    // 编译期确定尺寸的牛顿法使用相同的判断
+    auto fixed = [](const FixedVec<1> &x) -> FixedVec<1> {
+        return {x[0] / std::cbrt(x[0] * x[0])};
+    };
+    auto dfixed = [](const FixedVec<1> &x) -> FixedMat<1, 1> {
+        return {1 / (3 * std::cbrt(x[0] * x[0]))};
+    };
+    ASSERT_THROW(SolveByNewtonRaphson<1>(fixed, dfixed, FixedVec<1>{1}), MathError);
+}
+
 TEST(Diff, Base) {
     MemoryLeakDetection mld;
 
@@ -514,6 +1130,101 @@ TEST(Diff, Combine2) {
     }
 }
 
+TEST(FixedMat, Basic) {
+    MemoryLeakDetection mld;
+
+    FixedMat<2, 3> A = {{1, 2, 3}, {4, 5, 6}};
+    ASSERT_EQ(A.Rows(), 2);
+    ASSERT_EQ(A.Cols(), 3);
+    ASSERT_EQ(A.Value(1, 2), 6);
+    ASSERT_EQ(A.ToMat(), Mat({{1, 2, 3}, {4, 5, 6}}));
+    ASSERT_EQ(A.Transpose().ToMat(), Mat({{1, 4}, {2, 5}, {3, 6}}));
+
+    FixedVec<3> x = {1, 0, -1};
+    ASSERT_EQ(A * x, (FixedVec<2>{-2, -2}));
+    ASSERT_EQ(A * A.Transpose(), (FixedMat<2, 2>{{14, 32}, {32, 77}}));
+
+    // 与Mat混合运算得到表达式，可以赋值给Mat
+    Mat B = {{1, 1, 1}, {1, 1, 1}};
+    Mat sum = A + 2 * B;
+    ASSERT_EQ(sum, Mat({{3, 4, 5}, {6, 7, 8}}));
+    FixedMat<2, 3> C(sum);
+    ASSERT_EQ(C, (FixedMat<2, 3>{{3, 4, 5}, {6, 7, 8}}));
+
+    // FixedMat之间运算的结果仍是FixedMat
+    static_assert(std::is_same<decltype(-A + 0.5 * A - A * 2), FixedMat<2, 3>>::value, "");
+    ASSERT_EQ(-A + 0.5 * A - A * 2, (FixedMat<2, 3>{{-2.5, -5, -7.5}, {-10, -12.5, -15}}));
+    C = C - A;
+    ASSERT_EQ(C, (FixedMat<2, 3>(2)));
+    C -= FixedMat<2, 3>(2);
+    ASSERT_EQ(C, 0);
+    ASSERT_EQ((FixedMat<2, 3>(B).ToMat()), B);
+}
+TEST(FixedMat, SolveLinear) {
+    MemoryLeakDetection mld;
+
+    {
+        FixedMat<1, 1> A = {4};
+        ASSERT_EQ(SolveLinear(A, FixedVec<1>{2}), FixedVec<1>{0.5});
+    }
+
+    {
+        // 第一列主元在第二行
+        FixedMat<2, 2> A = {{1, 2}, {3, 4}};
+        FixedVec<2> b = {5, 6};
+        ASSERT_EQ(SolveLinear(A, b), FixedVec<2>({-4, 4.5}));
+        ASSERT_THROW(SolveLinear(FixedMat<2, 2>({{1, 2}, {2, 4}}), b), MathError);
+        ASSERT_THROW(SolveLinear(FixedMat<2, 2>({{0, 2}, {0, 4}}), b), MathError);
+    }
+
+    {
+        FixedMat<3, 3> A = {{2, 1, 1}, {4, -6, 0}, {-2, 7, 2}};
+        FixedVec<3> b = {5, -2, 9};
+        ASSERT_EQ(SolveLinear(A, b), FixedVec<3>({1, 1, 2}));
+    }
+
+    // 与Mat版本的结果一致
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-1, 4, -1, 0, 0, 1}, {0, -1, 4, -1, 0, 0},
+             {0, 0, -1, 4, -1, 0}, {1, 0, 0, -1, 4, -1}, {0, 1, 0, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    FixedLUFactorization<6> lu(FixedMat<6, 6>{A});
+    ASSERT_TRUE(lu.IsFactored());
+    ASSERT_EQ(lu.Solve(FixedVec<6>(b)).ToMat(), Mat(SolveLinear(A, b)));
+    ASSERT_EQ(SolveLinear(FixedMat<6, 6>(A), FixedVec<6>(b)).ToMat(), Mat(SolveLinear(A, b)));
+
+    Mat S = {{1, 2, 3}, {2, 4, 6}, {0, 0, 1}};
+    ASSERT_THROW(SolveLinear(FixedMat<3, 3>(S), FixedVec<3>{1, 2, 3}), MathError);
+}
+TEST(FixedMat, Solve) {
+    MemoryLeakDetection mld;
+
+    // 数值函数：圆与直线的交点
+    auto f = [](const FixedVec<2> &x) -> FixedVec<2> {
+        return {x[0] * x[0] + x[1] * x[1] - 4, x[0] - x[1]};
+    };
+    auto df = [](const FixedVec<2> &x) -> FixedMat<2, 2> {
+        return {{2 * x[0], 2 * x[1]}, {1, -1}};
+    };
+    FixedVec<2> x = SolveByNewtonRaphson<2>(f, df, FixedVec<2>{1, 0.5});
+    ASSERT_NEAR(x[0], std::sqrt(2.0), 1e-9);
+    ASSERT_NEAR(x[1], std::sqrt(2.0), 1e-9);
+
+    // 雅可比矩阵奇异
+    ASSERT_THROW(SolveByNewtonRaphson<2>(f, df, FixedVec<2>{0, 0}), MathError);
+
+    // 符号方程组
+    SymVec equations = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+    VarsTable got = Solve<3>(equations, VarsTable({"x1", "x2", "x3"}, 1.0));
+    ASSERT_EQ(got, expected);
+
+    ASSERT_THROW(Solve<2>(equations, VarsTable({"x1", "x2", "x3"}, 1.0)), MathError);
+}
+
 TEST(Function, Trigonometric) {
     MemoryLeakDetection mld;
 
@@ -602,22 +1313,810 @@ TEST(Function, InvalidNumber) {
 TEST(Function, ToString) {
     MemoryLeakDetection mld;
 
-    Node f = Var("r") * sin(Var("omega") / Num(2.0) + Var("phi")) + Var("c");
+    Node f = Var("r") * sin(Var("omega") / Num(2.0) + Var("phi")) + Var("c");
+
+    ASSERT_EQ(f->ToString(), "r*sin(omega/2+phi)+c");
+}
+
+TEST(Kernels, Level1) {
+    MemoryLeakDetection mld;
+
+    // 覆盖各指令集的整块部分和剩余尾部
+    for (int n : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33}) {
+        std::vector<double> x(n), y(n), out(n);
+        double dot = 0, absMax = 0;
+        for (int i = 0; i < n; ++i) {
+            x[i] = (i % 3 == 0 ? -1 : 1) * (0.5 + i);
+            y[i] = 0.25 * i - 1;
+            dot += x[i] * y[i];
+            absMax = std::max(absMax, std::abs(x[i]));
+        }
+
+        ASSERT_NEAR(internal::Dot(n, x.data(), y.data()), dot, 1e-12);
+        ASSERT_DOUBLE_EQ(internal::AbsMax(n, x.data()), absMax);
+
+        internal::ScaledAdd(n, x.data(), -2, y.data(), out.data());
+        for (int i = 0; i < n; ++i) {
+            ASSERT_DOUBLE_EQ(out[i], x[i] - 2 * y[i]);
+        }
+
+        // out与x为同一地址
+        internal::ScaledAdd(n, x.data(), 3, y.data(), x.data());
+        for (int i = 0; i < n; ++i) {
+            ASSERT_DOUBLE_EQ(x[i], out[i] + 5 * y[i]);
+        }
+
+        ASSERT_TRUE(internal::AllAbsLess(n, y.data(), absMax + 1e9));
+        ASSERT_TRUE(internal::AllAbsDiffLess(n, x.data(), x.data(), 1e-12));
+
+        // 最后一个元素不满足时也要能发现
+        std::vector<double> z(n, 0.0);
+        ASSERT_TRUE(internal::AllAbsLess(n, z.data(), 1e-9));
+        z[n - 1] = -1e-3;
+        ASSERT_FALSE(internal::AllAbsLess(n, z.data(), 1e-9));
+        std::vector<double> zero(n, 0.0);
+        ASSERT_FALSE(internal::AllAbsDiffLess(n, z.data(), zero.data(), 1e-9));
+    }
+}
+TEST(Kernels, NaN) {
+    MemoryLeakDetection mld;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (int n : {1, 3, 4, 8, 11}) {
+        for (int pos = 0; pos < n; ++pos) {
+            std::vector<double> x(n, 0.0), y(n, 0.0);
+            x[pos] = nan;
+            ASSERT_FALSE(internal::AllAbsLess(n, x.data(), 1.0));
+            ASSERT_FALSE(internal::AllAbsDiffLess(n, x.data(), y.data(), 1.0));
+            ASSERT_FALSE(internal::AllAbsDiffLess(n, y.data(), x.data(), 1.0));
+            ASSERT_TRUE(std::isnan(internal::Dot(n, x.data(), x.data())));
+        }
+    }
+}
+TEST(Kernels, Variants) {
+    MemoryLeakDetection mld;
+
+    const internal::SimdLevel original = internal::GetSimdLevel();
+    std::shared_ptr<void> defer(nullptr, [original](auto) {
+        internal::SetSimdLevel(original);
+    });
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const int m = 13, n = 19, k = 11;
+    std::vector<double> A(m * k), B(k * n);
+    for (int i = 0; i < m * k; ++i) {
+        A[i] = std::sin(0.7 * i);
+    }
+    for (int i = 0; i < k * n; ++i) {
+        B[i] = std::cos(0.3 * i) - 0.5;
+    }
+
+    // 逐个切换到CPU支持的每种实现，与标量实现的结果逐项对比
+    for (auto level : {internal::SimdLevel::SCALAR, internal::SimdLevel::SSE2, internal::SimdLevel::AVX2,
+                       internal::SimdLevel::AVX512}) {
+        auto used = internal::SetSimdLevel(level);
+        ASSERT_EQ(internal::GetSimdLevel(), used);
+        if (used != level) {
+            std::cout << "skip SimdLevel " << static_cast<int>(level) << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        for (int len : {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33}) {
+            std::vector<double> x(len), y(len), out(len);
+            double dot = 0, absMax = 0;
+            for (int i = 0; i < len; ++i) {
+                x[i] = (i % 3 == 0 ? -1 : 1) * (0.5 + i);
+                y[i] = 0.25 * i - 1;
+                dot += x[i] * y[i];
+                absMax = std::max(absMax, std::abs(x[i]));
+            }
+
+            ASSERT_NEAR(internal::Dot(len, x.data(), y.data()), dot, 1e-12);
+            ASSERT_EQ(internal::AbsMax(len, x.data()), absMax);
+            internal::ScaledAdd(len, x.data(), -2, y.data(), out.data());
+            for (int i = 0; i < len; ++i) {
+                ASSERT_DOUBLE_EQ(out[i], x[i] - 2 * y[i]);
+            }
+            ASSERT_EQ(internal::AllAbsLess(len, x.data(), absMax), len == 0);
+            ASSERT_TRUE(internal::AllAbsLess(len, x.data(), absMax + 1));
+            ASSERT_TRUE(internal::AllAbsDiffLess(len, x.data(), x.data(), 1e-12));
+
+            // nan出现在整块部分或尾部时，所有实现的结果都相同
+            for (int pos = 0; pos < len; ++pos) {
+                std::vector<double> z = x;
+                z[pos] = nan;
+                ASSERT_TRUE(std::isnan(internal::AbsMax(len, z.data())));
+                ASSERT_TRUE(std::isnan(internal::Dot(len, z.data(), y.data())));
+                ASSERT_FALSE(internal::AllAbsLess(len, z.data(), 1e300));
+                ASSERT_FALSE(internal::AllAbsDiffLess(len, z.data(), x.data(), 1e300));
+                z[pos] = -nan;
+                ASSERT_TRUE(std::isnan(internal::AbsMax(len, z.data())));
+            }
+        }
+
+        std::vector<double> C(m * n);
+        internal::Gemm(m, n, k, A.data(), B.data(), C.data());
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                double c = 0;
+                for (int p = 0; p < k; ++p) {
+                    c += A[i * k + p] * B[p * n + j];
+                }
+                ASSERT_NEAR(C[i * n + j], c, 1e-12);
+            }
+        }
+    }
+}
+
+TEST(Krylov, GMRES) {
+    MemoryLeakDetection mld;
+
+    // 不对称矩阵
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-2, 5, -1, 0, 0, 1}, {0, -1, 6, -1, 0, 0},
+             {0, 3, -1, 4, -1, 0}, {1, 0, 0, -1, 7, -1}, {0, 1, 2, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    Vec expected = SolveLinear(A, b);
+
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        for (int i = 0; i < A.Rows(); ++i) {
+            out[i] = Dot(MatView(A).Row(i), v);
+        }
+    };
+
+    // 不重启时至多6次迭代得到精确解
+    {
+        GMRES gmres(6, 6);
+        Vec x(6);
+        ASSERT_TRUE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 100));
+        ASSERT_LE(gmres.Iterations(), 6);
+        ASSERT_EQ(x, expected);
+    }
+
+    // 频繁重启，以及Jacobi预条件
+    {
+        GMRES gmres(6, 2);
+        Vec x(6);
+        ASSERT_TRUE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 100));
+        ASSERT_EQ(x, expected);
+
+        LinearOperator jacobi = [&](VecView v, MutableVecView out) {
+            for (int i = 0; i < A.Rows(); ++i) {
+                out[i] = v[i] / A.Value(i, i);
+            }
+        };
+        Vec y(6);
+        ASSERT_TRUE(gmres.Solve(op, jacobi, b, y, 1.0e-12, 100));
+        ASSERT_EQ(y, expected);
+    }
+
+    // 迭代次数不足
+    {
+        GMRES gmres(6, 2);
+        Vec x(6);
+        ASSERT_FALSE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 1));
+        ASSERT_EQ(gmres.Iterations(), 1);
+        ASSERT_GT(gmres.RelativeResidual(), 1.0e-12);
+    }
+
+    // 奇异矩阵，b不在值域内：第二列的对角元为0，只用第一列求解
+    {
+        LinearOperator singular = [](VecView v, MutableVecView out) {
+            out[0] = v[0];
+            out[1] = 0;
+        };
+        GMRES gmres(2, 2);
+        Vec x(2);
+        ASSERT_FALSE(gmres.Solve(singular, nullptr, Vec{1, 1}, x, 1.0e-12, 100));
+        ASSERT_TRUE(std::isfinite(x[0]) && std::isfinite(x[1]));
+        ASSERT_NEAR(gmres.RelativeResidual(), std::sqrt(0.5), 1.0e-12);
+        ASSERT_NEAR(x[0], 1, 1.0e-12);
+        ASSERT_NEAR(x[1], 1, 1.0e-12);
+    }
+}
+TEST(Krylov, BiCGSTAB) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-2, 5, -1, 0, 0, 1}, {0, -1, 6, -1, 0, 0},
+             {0, 3, -1, 4, -1, 0}, {1, 0, 0, -1, 7, -1}, {0, 1, 2, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    Vec expected = SolveLinear(A, b);
+
+    SparseMat S(A);
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        S.Multiply(v, out);
+    };
+
+    BiCGSTAB solver(6);
+    Vec x(6);
+    ASSERT_TRUE(solver.Solve(op, nullptr, b, x, 1.0e-12, 100));
+    ASSERT_EQ(x, expected);
+
+    // 预条件子可以直接作为LinearOperator
+    Vec y(6);
+    ASSERT_TRUE(solver.Solve(op, ILU0Preconditioner(S), b, y, 1.0e-12, 100));
+    ASSERT_EQ(y, expected);
+
+    Vec z(6);
+    ASSERT_TRUE(solver.Solve(op, JacobiPreconditioner(A), b, z, 1.0e-12, 100));
+    ASSERT_EQ(z, expected);
+}
+TEST(Krylov, ConjugateGradient) {
+    MemoryLeakDetection mld;
+
+    // n×n网格上二维泊松方程的五点差分矩阵，对称正定，对角占优
+    int n = 20;
+    std::vector<SparseMat::Triplet> triplets;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            int k = i * n + j;
+            triplets.push_back({k, k, 4});
+            if (i > 0) {
+                triplets.push_back({k, k - n, -1});
+            }
+            if (i + 1 < n) {
+                triplets.push_back({k, k + n, -1});
+            }
+            if (j > 0) {
+                triplets.push_back({k, k - 1, -1});
+            }
+            if (j + 1 < n) {
+                triplets.push_back({k, k + 1, -1});
+            }
+        }
+    }
+    SparseMat A(n * n, n * n, triplets);
+    ASSERT_EQ(A.NonZeros(), 5 * n * n - 4 * n);
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        A.Multiply(v, out);
+    };
+    Vec b(n * n, 1);
+    Vec r(n * n);
+
+    ConjugateGradient cg(n * n);
+    Vec x(n * n);
+    ASSERT_TRUE(cg.Solve(op, nullptr, b, x, 1.0e-10, 1000));
+    A.Multiply(x, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+    int plain = cg.Iterations();
+
+    // ILU(0)预条件减少迭代次数
+    Vec y(n * n);
+    ASSERT_TRUE(cg.Solve(op, ILU0Preconditioner(A), b, y, 1.0e-10, 1000));
+    ASSERT_LT(cg.Iterations(), plain);
+    A.Multiply(y, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+
+    // BiCGSTAB同样适用
+    BiCGSTAB bicgstab(n * n);
+    Vec z(n * n);
+    ASSERT_TRUE(bicgstab.Solve(op, ILU0Preconditioner(A), b, z, 1.0e-10, 1000));
+    A.Multiply(z, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+
+    // 缺少对角元
+    ASSERT_THROW(ILU0Preconditioner(SparseMat(2, 2, {{0, 1, 1}, {1, 0, 1}})), MathError);
+    ASSERT_THROW(JacobiPreconditioner(SparseMat(2, 2, {{0, 1, 1}, {1, 0, 1}})), MathError);
+}
+TEST(Krylov, NewtonKrylov) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_KRYLOV;
+    VarsTable got = Solve(f, varsTable);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-8);
+    }
+
+    ASSERT_THROW(SolveByNewtonKrylov({"x+y"_f}, VarsTable{{"x", 1}, {"y", 1}}), MathError);
+
+    // 完整的步会使arctan(x) = 0发散，一维搜索的φ'(0)由差商得到
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        Config::Get().lineSearch = method;
+        got = SolveByNewtonKrylov({"arctan(x)"_f}, VarsTable{{"x", 3}});
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+}
+TEST(Krylov, Bratu) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 一维Bratu问题u'' + λe^u = 0, u(0) = u(1) = 0的差分方程组，三对角的雅可比矩阵
+    int n = 100;
+    double h = 1.0 / (n + 1);
+    double lambda = 1;
+    SymVec equations(n);
+    std::vector<std::string> vars;
+    for (int i = 0; i < n; ++i) {
+        vars.emplace_back("u" + std::to_string(i));
+    }
+    for (int i = 0; i < n; ++i) {
+        std::string eq = "-2*" + vars[i] + "+" + ToString(h * h * lambda) + "*exp(" + vars[i] + ")";
+        if (i > 0) {
+            eq += "+" + vars[i - 1];
+        }
+        if (i + 1 < n) {
+            eq += "+" + vars[i + 1];
+        }
+        equations[i] = Parse(eq);
+    }
+    VarsTable varsTable(vars, 0);
+
+    Config::Get().krylovRestart = 10;
+    VarsTable expected = SolveByNewtonKrylov(equations, varsTable);
+    CompiledSymMat f(equations, vars);
+    ASSERT_LT(f.Eval(expected.Values()).NormInfinity(), 1.0e-9);
+
+    // 解关于x = 0.5对称，最大值约为0.1405
+    ASSERT_NEAR(expected["u49"], expected["u50"], 1.0e-9);
+    ASSERT_NEAR(expected["u49"], 0.1405, 1.0e-3);
+
+    // 以三对角部分的对角元作为Jacobi预条件子
+    int calls = 0;
+    VarsTable got = SolveByNewtonKrylov(equations, varsTable, [&](VecView q) -> LinearOperator {
+        ++calls;
+        Vec diag(n);
+        for (int i = 0; i < n; ++i) {
+            diag[i] = -2 + h * h * lambda * std::exp(q[i]);
+        }
+        return [diag](VecView v, MutableVecView out) {
+            for (int i = 0; i < v.Size(); ++i) {
+                out[i] = v[i] / diag[i];
+            }
+        };
+    });
+    ASSERT_GT(calls, 0);
+    ASSERT_LT(f.Eval(got.Values()).NormInfinity(), 1.0e-9);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+
+    // BiCGSTAB，以及固定的线性精度
+    Config::Get().krylovMethod = KrylovMethod::BICGSTAB;
+    Config::Get().eisenstatWalker = false;
+    got = SolveByNewtonKrylov(equations, varsTable);
+    ASSERT_LT(f.Eval(got.Values()).NormInfinity(), 1.0e-9);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
+
+TEST(LineSearch, Base) {
+    MemoryLeakDetection mld;
+
+    // atan(x) = 0，x = 3处完整的牛顿步会越过根，且使|f|增大
+    auto f = [](VecView x, Vec &out) {
+        out[0] = std::atan(x[0]);
+    };
+    Vec x = {3};
+    double fx = std::atan(3.0);
+    Vec d = {-fx * 10}; // -f / f'
+    double phi0 = fx * fx / 2;
+
+    LineSearch armijo(1, 1);
+    ASSERT_TRUE(armijo.Search(LineSearchMethod::ARMIJO, x, d, phi0, -fx * fx, f));
+    ASSERT_LT(armijo.Alpha(), 1);
+    ASSERT_LT(std::abs(armijo.F()[0]), fx);
+    ASSERT_DOUBLE_EQ(armijo.X()[0], 3 + armijo.Alpha() * d[0]);
+
+    LineSearch cubic(1, 1);
+    ASSERT_TRUE(cubic.Search(LineSearchMethod::CUBIC, x, d, phi0, -fx * fx, f));
+    ASSERT_LT(std::abs(cubic.F()[0]), fx);
+    ASSERT_LE(cubic.Evaluations(), armijo.Evaluations());
+
+    // 上升方向：找不到满足条件的步长，计算次数有上限
+    ASSERT_FALSE(armijo.Search(LineSearchMethod::ARMIJO, x, Vec{-d[0]}, phi0, -fx * fx, f));
+    int maxBacktracking = LineSearch::MAX_BACKTRACKING;
+    ASSERT_EQ(armijo.Evaluations(), maxBacktracking);
+}
+TEST(LineSearch, InvalidValue) {
+    MemoryLeakDetection mld;
+
+    // x = 20处的完整牛顿步到达x = -20，超出ln的定义域
+    auto f = [](VecView x, Vec &out) {
+        out[0] = Calc(MathOperator::MATH_LOG, x[0], 0.0) - 1;
+    };
+    Vec x = {20};
+    double fx = std::log(20.0) - 1;
+    Vec d = {-fx * 20};
+
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        LineSearch search(1, 1);
+        ASSERT_TRUE(search.Search(method, x, d, fx * fx / 2, -fx * fx, f));
+        ASSERT_GT(search.X()[0], 0);
+        ASSERT_LT(std::abs(search.F()[0]), fx);
+    }
+
+    // 其他错误照常抛出
+    LineSearch search(1, 1);
+    ASSERT_THROW(search.Search(LineSearchMethod::ARMIJO, x, d, fx * fx / 2, -fx * fx,
+                               [](VecView, Vec &) {
+                                   throw MathError(ErrorType::ERROR_OUTOF_DOMAIN);
+                               }),
+                 MathError);
+}
+TEST(LineSearch, NewtonRaphson) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    SymVec f = {"arctan(x)"_f};
+    VarsTable varsTable{{"x", 3}};
+
+    // 完整的牛顿步发散
+    ASSERT_ANY_THROW(SolveByNewtonRaphson(f, varsTable));
+
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        Config::Get().lineSearch = method;
+        VarsTable got = SolveByNewtonRaphson(f, varsTable);
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+
+    // 圆与直线，初值远离交点
+    SymVec g = {"x^2+y^2-4"_f, "x-y"_f};
+    Config::Get().lineSearch = LineSearchMethod::CUBIC;
+    VarsTable got = SolveByNewtonRaphson(g, VarsTable{{"x", 100}, {"y", 0.1}});
+    ASSERT_NEAR(std::abs(got["x"]), std::sqrt(2.0), 1.0e-9);
+    ASSERT_NEAR(got["x"], got["y"], 1.0e-9);
+}
+TEST(LineSearch, NewtonRaphsonVariants) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 这些模式下Jd ≠ -phi，φ'(0)需要用当前的雅可比矩阵计算
+    SymVec f = {"arctan(x)"_f};
+    VarsTable varsTable{{"x", 3}};
+    Config::Get().lineSearch = LineSearchMethod::CUBIC;
+    for (int mode = 0; mode < 3; ++mode) {
+        Config::Get().reuseJacobian = mode == 0;
+        Config::Get().mixedPrecision = mode == 1;
+        Config::Get().equilibrate = mode == 2;
+        VarsTable got = SolveByNewtonRaphson(f, varsTable);
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+    Config::Get().Reset();
+
+    // 方程数量多于未知数：最小二乘解，Jd只是phi在J的列空间上的投影
+    Config::Get().lineSearch = LineSearchMethod::ARMIJO;
+    SymVec g = {"arctan(x)"_f, "arctan(x)*10"_f, "arctan(2*x)"_f};
+    VarsTable got = SolveByNewtonRaphson(g, varsTable);
+    ASSERT_NEAR(got["x"], 0, 1.0e-9);
+}
+
+TEST(Linear, Base) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
+    Vec b = {13, -9, 6, 0};
+
+    auto x = SolveLinear(std::move(A), std::move(b));
+
+    Vec expected = {-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555};
+
+    ASSERT_EQ(x, expected);
+}
+TEST(Linear, LUFactorization) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
+
+    LUFactorization lu(A);
+    ASSERT_TRUE(lu.IsFactored());
+
+    // 一次分解，多次求解
+    {
+        Vec b = {13, -9, 6, 0};
+        Vec expected = {-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555};
+        ASSERT_EQ(lu.Solve(b), expected);
+    }
+    {
+        Vec b = {1, 2, 3, 4};
+        ASSERT_EQ(lu.Solve(b), SolveLinear(A, b));
+    }
+
+    // 结果写入已有的向量，允许原地求解
+    {
+        Vec b = {13, -9, 6, 0};
+        Vec x(4);
+        lu.Solve(b, x);
+        lu.Solve(b, b);
+        ASSERT_EQ(x, b);
+        ASSERT_EQ(x, Vec({-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555}));
+    }
+
+    // 条件数估计：单位阵为1，接近奇异的矩阵很大
+    ASSERT_GT(lu.ConditionEstimate(), 1);
+    ASSERT_LT(lu.ConditionEstimate(), 100);
+    lu.Factor(Mat({{1, 0}, {0, 1}}));
+    ASSERT_DOUBLE_EQ(lu.ConditionEstimate(), 1);
+    lu.Factor(Mat({{1, 1}, {1, 1 + 1e-8}}));
+    ASSERT_GT(lu.ConditionEstimate(), 1e7);
+
+    // 奇异矩阵
+    try {
+        lu.Factor({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_SINGULAR_MATRIX);
+        ASSERT_FALSE(lu.IsFactored());
+    }
+}
+TEST(Linear, LUReuseWithoutAllocation) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
+    Mat B = {{4, 1, 0, 0}, {1, 4, 1, 0}, {0, 1, 4, 1}, {0, 0, 1, 4}};
+    Vec b = {13, -9, 6, 0};
+    Vec x(4);
+
+    // 预先分配工作空间后，反复分解、求解都不申请堆内存
+    LUFactorization lu(4);
+    long long before = AllocationCount();
+    for (int i = 0; i < 10; ++i) {
+        lu.Factor(i % 2 ? B : A);
+        lu.Solve(b, x);
+        lu.Solve(x, x);
+    }
+    long long allocations = AllocationCount() - before;
+    ASSERT_EQ(allocations, 0);
+
+    Vec expected = LUFactorization(B).Solve(LUFactorization(B).Solve(b));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_NEAR(x[i], expected[i], 1e-12);
+    }
+
+    // 阶数变小时也复用已有的工作空间
+    Mat C = {{2, 1}, {1, 3}};
+    Vec c = {1, 2};
+    Vec y(2);
+    before = AllocationCount();
+    lu.Factor(C);
+    lu.Solve(c, y);
+    allocations = AllocationCount() - before;
+    ASSERT_EQ(allocations, 0);
+    ASSERT_NEAR(y[0], 0.2, 1e-12);
+    ASSERT_NEAR(y[1], 0.6, 1e-12);
+}
+TEST(Linear, LUScalarType) {
+    MemoryLeakDetection mld;
+
+    // float、long double下的原地分解与求解
+    {
+        float a[] = {2, 1, -5, 1, 1, -5, 0, 7, 0, 2, 1, -1, 1, 6, -1, -4};
+        int pivots[4];
+        internal::LUFactorInPlace(a, 4, pivots);
+        float x[] = {13, -9, 6, 0};
+        internal::LUSolveInPlace(a, pivots, 4, x);
+        float expected[] = {-66.5555555555555429f, 25.6666666666666643f, -18.777777777777775f, 26.55555555555555f};
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-3);
+        }
+    }
+    {
+        long double a[] = {4, -2, 1, 3};
+        int pivots[2];
+        internal::LUFactorInPlace(a, 2, pivots);
+        long double x[] = {1, 2};
+        internal::LUSolveInPlace(a, pivots, 2, x);
+        ASSERT_NEAR(static_cast<double>(x[0]), 0.5, 1e-15);
+        ASSERT_NEAR(static_cast<double>(x[1]), 0.5, 1e-15);
+    }
+
+    float s[] = {1, 2, 2, 4};
+    int pivots[2];
+    ASSERT_THROW(internal::LUFactorInPlace(s, 2, pivots), MathError);
+}
+TEST(Linear, MixedPrecisionLU) {
+    MemoryLeakDetection mld;
+
+    // 良态矩阵：单精度分解，修正后达到双精度
+    {
+        Mat A = {{4, -1, 0, 0, 1, 0},  {-1, 4, -1, 0, 0, 1}, {0, -1, 4, -1, 0, 0},
+                 {0, 0, -1, 4, -1, 0}, {1, 0, 0, -1, 4, -1}, {0, 1, 0, 0, -1, 4}};
+        Vec b = {1.1, 2.3, 3.7, 4.13, 5.17, 6.19};
+        Vec expected = LUFactorization(A).Solve(b);
+
+        MixedPrecisionLUFactorization lu;
+        lu.Factor(A);
+        ASSERT_TRUE(lu.IsFactored());
+        Vec x = lu.Solve(b);
+        ASSERT_FALSE(lu.IsDoublePrecision());
+        for (int i = 0; i < 6; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-14);
+        }
+
+        // 原地求解
+        lu.Solve(b, b);
+        ASSERT_EQ(b, expected);
+    }
+
+    // Hilbert矩阵的条件数约为1e10，超出单精度的范围，修正停滞后退回双精度分解
+    {
+        Mat H(8, 8);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                H.Value(i, j) = 1.0 / (i + j + 1);
+            }
+        }
+        Vec b(8, 1.0);
+
+        Config::Get().epsilon = 1e-12;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        MixedPrecisionLUFactorization lu(8);
+        lu.Factor(H);
+        Vec x = lu.Solve(b);
+        ASSERT_TRUE(lu.IsDoublePrecision());
+        Vec expected = LUFactorization(H).Solve(b);
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-6 * std::abs(expected[i]));
+        }
+    }
+
+    // 奇异矩阵
+    MixedPrecisionLUFactorization lu;
+    ASSERT_THROW(lu.Factor(Mat({{1, 2}, {2, 4}})), MathError);
+    ASSERT_FALSE(lu.IsFactored());
+}
+TEST(Linear, QRFactorization) {
+    MemoryLeakDetection mld;
+
+    // 过定义：直线拟合的最小二乘解
+    {
+        Mat A = {{1, 0}, {1, 1}, {1, 2}, {1, 3}};
+        Vec b = {1, 2, 2, 4};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 2);
+        ASSERT_EQ(qr.Solve(b), Vec({0.9, 0.9}));
+        ASSERT_EQ(SolveLinear(A, b), Vec({0.9, 0.9}));
+
+        // 与正规方程的解一致
+        Mat B = {{3, 1, -2}, {0.5, 4, 1}, {-1, 2, 5}, {2, -3, 1}, {1, 1, 1}, {0, -2, 3}};
+        Vec c = {1, -2, 3, 0.5, 2, -1};
+        ASSERT_EQ(SolveLinear(B, c), SolveLinear(TransposeMultiply(B), TransposeMultiply(B, c)));
+    }
+
+    // 冗余约束：秩亏的过定义方程组，返回范数最小的最小二乘解
+    {
+        Mat A = {{1, 1}, {1, 1}, {1, 1}};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 1);
+        ASSERT_EQ(qr.Solve(Vec{1, 2, 3}), Vec({1, 1}));
+
+        Mat B = {{1, 2, 3}, {2, 4, 6}, {1, 0, 1}, {3, 4, 7}};
+        Vec c = {1, 2, 3, 5};
+        Vec x = SolveLinear(B, c);
+        ASSERT_EQ(B * x, Mat(c));
+        ASSERT_EQ(x, Vec({7 / 3.0, -5 / 3.0, 2 / 3.0}));
+    }
+
+    // 不定方程：范数最小的解
+    {
+        Mat A = {{1, 2, 3}, {4, 5, 6}};
+        Vec b = {1, 2};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 2);
+        Vec expected = {-3 / 54.0, 6 / 54.0, 15 / 54.0};
+        ASSERT_EQ(qr.Solve(b), expected);
+
+        ASSERT_THROW(SolveLinear(A, b), MathError);
+
+        Config::Get().allowIndeterminateEquation = true;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        ASSERT_EQ(SolveLinear(A, b), expected);
+
+        // 秩亏但相容：b很大时残差的舍入误差也按比例放大，不能误判为矛盾
+        {
+            Mat C = {{1, 2, 3}, {2, 4, 6}};
+            Vec d = {123456789.123, 246913578.246};
+            Vec x = SolveLinear(C, d);
+            ASSERT_NEAR(Dot(MatView(C).Row(0), x), d[0], 1e-6);
+        }
+
+        // 矛盾方程组
+        try {
+            SolveLinear(Mat({{1, 1, 1}, {2, 2, 2}}), Vec({1, 3}));
+            FAIL();
+        } catch (const MathError &e) {
+            ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+    }
+
+    // 零矩阵
+    QRFactorization qr(Mat(3, 2));
+    ASSERT_EQ(qr.Rank(), 0);
+    ASSERT_EQ(qr.Solve(Vec{1, 2, 3}), Vec({0, 0}));
 
-    ASSERT_EQ(f->ToString(), "r*sin(omega/2+phi)+c");
+    // 空矩阵
+    qr.Factor(MatView(nullptr, 0, 2));
+    ASSERT_EQ(qr.Rank(), 0);
+    ASSERT_EQ(qr.Solve(VecView(nullptr, 0)), Vec({0, 0}));
+    qr.Factor(MatView(nullptr, 2, 0));
+    ASSERT_EQ(qr.Rank(), 0);
 }
-
-TEST(Linear, Base) {
+TEST(Linear, Equilibration) {
     MemoryLeakDetection mld;
 
-    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
-    Vec b = {13, -9, 6, 0};
+    // 第二列（未知量的单位很小）与第二行（方程的数量级很小）
+    Mat A = {{3, 4e-10, 0}, {1e-6, 2e-16, -3e-6}, {1, 0, 1}};
+    Equilibration eq(A);
+    ASSERT_TRUE(eq.IsComputed());
+    ASSERT_EQ(eq.Rows(), 3);
+    ASSERT_EQ(eq.Cols(), 3);
 
-    auto x = SolveLinear(std::move(A), std::move(b));
+    Mat B = A;
+    eq.Apply(B);
+    for (int i = 0; i < 3; ++i) {
+        double rowMax = 0, colMax = 0;
+        for (int j = 0; j < 3; ++j) {
+            rowMax = std::max(rowMax, std::abs(B.Value(i, j)));
+            colMax = std::max(colMax, std::abs(B.Value(j, i)));
+        }
+        ASSERT_LE(rowMax, 2);
+        ASSERT_GE(colMax, 1);
+        ASSERT_LT(colMax, 2);
 
-    Vec expected = {-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555};
+        // 缩放因子为2的整数次幂
+        int e;
+        ASSERT_EQ(std::frexp(eq.RowScale()[i], &e), 0.5);
+        ASSERT_EQ(std::frexp(eq.ColScale()[i], &e), 0.5);
+    }
 
-    ASSERT_EQ(x, expected);
+    // 原矩阵的主元低于Config::Get().epsilon，平衡后可以正常分解
+    ASSERT_THROW(LUFactorization{A}, MathError);
+    LUFactorization lu(B);
+    Vec b = {1, 2, 3};
+    Vec rb = b;
+    for (int i = 0; i < 3; ++i) {
+        rb[i] *= eq.RowScale()[i];
+    }
+    Vec x = lu.Solve(rb);
+    for (int i = 0; i < 3; ++i) {
+        x[i] *= eq.ColScale()[i];
+    }
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NEAR(Dot(MatView(A).Row(i), x), b[i], 1e-9 * std::abs(b[i]));
+    }
+
+    // 全为0的行
+    Equilibration zero(Mat({{0, 0}, {2, 0.25}}));
+    ASSERT_EQ(zero.RowScale()[0], 1);
+    ASSERT_EQ(zero.RowScale()[1], 0.5);
+    ASSERT_EQ(zero.ColScale()[0], 1);
+    ASSERT_EQ(zero.ColScale()[1], 8);
 }
 
 TEST(Mat, Multiply) {
@@ -669,6 +2168,353 @@ TEST(Mat, PositiveDetermine) {
         ASSERT_TRUE(!A.PositiveDetermine());
     }
 }
+TEST(Mat, Det) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}, {-2, 7, 8}};
+    ASSERT_DOUBLE_EQ(Det(A, 1), 1);
+    ASSERT_DOUBLE_EQ(Det(A, 2), -3);
+    ASSERT_NEAR(Det(A, 3), 24, 1.0e-12);
+
+    Mat B = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    ASSERT_NEAR(Det(B, 3), 0, 1.0e-12);
+
+    // 较大的矩阵：det(I + c * ones) = 1 + n * c
+    int n = 12;
+    Mat C(n, n, 0.5);
+    for (int i = 0; i < n; ++i) {
+        C.Value(i, i) += 1;
+    }
+    ASSERT_NEAR(Det(C, n), 1 + n * 0.5, 1.0e-9);
+
+    // C * C^-1 = I
+    ASSERT_EQ(C * C.Inverse(), Mat(n, n).Ones());
+    ASSERT_TRUE(C.PositiveDetermine());
+}
+TEST(Mat, MultiplyLarge) {
+    MemoryLeakDetection mld;
+
+    // 尺寸覆盖寄存器分块、缓存分块以及边缘部分
+    for (auto size : {std::make_tuple(13, 17, 11), std::make_tuple(70, 300, 135)}) {
+        int m = std::get<0>(size), k = std::get<1>(size), n = std::get<2>(size);
+        Mat A(m, k), B(k, n);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < k; ++j) {
+                A.Value(i, j) = std::sin(i * k + j);
+            }
+        }
+        for (int i = 0; i < k; ++i) {
+            for (int j = 0; j < n; ++j) {
+                B.Value(i, j) = std::cos(i * n + j);
+            }
+        }
+
+        Mat expected(m, n);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                for (int p = 0; p < k; ++p) {
+                    expected.Value(i, j) += A.Value(i, p) * B.Value(p, j);
+                }
+            }
+        }
+
+        ASSERT_EQ(A * B, expected);
+    }
+}
+TEST(Mat, TransposeMultiply) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}, {-2, 7, 8}, {0, 1, -1}, {3, 3, 1}};
+    Vec b = {1, -1, 2, 0.5, 3};
+
+    ASSERT_EQ(TransposeMultiply(A), A.Transpose() * A);
+    ASSERT_EQ(TransposeMultiply(A, b), (A.Transpose() * b).ToVec());
+}
+TEST(Mat, Arithmetic) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2}, {3, 4}};
+    Mat B = {{6, 7}, {8, 9}};
+
+    Mat C = A + 2 * B - B * 0.5 - (-A);
+    ASSERT_EQ(C, Mat({{11, 14.5}, {18, 21.5}}));
+
+    // 赋值给同尺寸的对象时直接写入原有内存，右侧引用自身也可以
+    const double *p = &C.Value(0, 0);
+    C = C - A * 2;
+    ASSERT_EQ(&C.Value(0, 0), p);
+    ASSERT_EQ(C, Mat({{9, 10.5}, {12, 13.5}}));
+
+    C += A - B;
+    ASSERT_EQ(C, Mat({{4, 5.5}, {7, 8.5}}));
+
+    // 尺寸不同时重新分配
+    Mat D(1, 1);
+    D = A + B;
+    ASSERT_EQ(D, Mat({{7, 9}, {11, 13}}));
+
+    // 表达式保存临时对象的值，不会悬空
+    auto e = Mat{{1, 1}, {1, 1}} + A.Transpose();
+    Mat E = e;
+    ASSERT_EQ(E, Mat({{2, 4}, {3, 5}}));
+    ASSERT_DOUBLE_EQ((A - B).Norm2(), 100);
+    ASSERT_DOUBLE_EQ((A - B * 2).NormInfinity(), 14);
+
+    // 用auto保存的表达式可以像Vec一样取元素、调用ToVec()、参与点乘和比较，在使用时才求值
+    Vec a = {1, 2};
+    Vec b = {3, 5};
+    auto c = a + b;
+    ASSERT_EQ(c[0], 4);
+    ASSERT_EQ(c, Vec({4, 7}));
+    ASSERT_EQ(c.ToVec(), Vec({4, 7}));
+    a = {0, 0};
+    ASSERT_EQ(c, Vec({3, 5}));
+    a = {1, 2};
+
+    ASSERT_DOUBLE_EQ(Dot(a - b, a), -8);
+    ASSERT_DOUBLE_EQ(Dot(a, a - b), -8);
+    ASSERT_DOUBLE_EQ(Dot(a - b, 2 * a), -16);
+    Mat m = {{1}, {2}};
+    ASSERT_EQ((m + m).ToVec(), Vec({2, 4}));
+    ASSERT_THROW((A + B).ToVec(), std::runtime_error);
+
+    // 与向量相乘：列数匹配时为矩阵乘法，Vec之间逐元素相乘
+    Vec x = {1, 2};
+    Vec y = {3, 4};
+    ASSERT_EQ((A + B) * x, Vec({25, 37}));
+    ASSERT_EQ((x + y) * y, Vec({12, 24}));
+    ASSERT_EQ(A * (x - y), Vec({-6, -14}));
+
+    Vec v = x + 0.5 * y;
+    v = -v;
+    ASSERT_EQ(v, Vec({-2.5, -4}));
+}
+
+TEST(MatView, Basic) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}};
+    MatView v = A;
+    ASSERT_TRUE(v.IsContiguous());
+    ASSERT_EQ(v.Data(), &A.Value(0, 0));
+    ASSERT_EQ(Mat(v), A);
+
+    // 转置、子矩阵、行列都不复制数据
+    MatView t = v.Transpose();
+    ASSERT_FALSE(t.IsContiguous());
+    ASSERT_EQ(Mat(t), A.Transpose());
+    ASSERT_EQ(Mat(v.Block(0, 1, 2, 2)), Mat({{2, 3}, {5, 6}}));
+    ASSERT_EQ(Vec(v.Row(1)), Vec({4, 5, 6}));
+    ASSERT_EQ(Vec(v.Col(2)), Vec({3, 6}));
+    ASSERT_EQ(Vec(t.Row(2)), Vec({3, 6}));
+
+    A.Value(0, 0) = 10;
+    ASSERT_EQ(v.Value(0, 0), 10);
+
+    // 视图参与表达式运算
+    Mat B = v + 2 * t.Transpose();
+    ASSERT_EQ(B, Mat({{30, 6, 9}, {12, 15, 18}}));
+    ASSERT_EQ(Mat(v.Transpose()) * Vec({1, 1}), Mat({{14}, {7}, {9}}));
+}
+TEST(MatView, Empty) {
+    MemoryLeakDetection mld;
+
+    // 空矩阵没有元素可以取地址，视图指向nullptr
+    Mat A(0, 0, std::valarray<double>());
+    ASSERT_EQ(A.Data(), nullptr);
+    MatView v = A;
+    ASSERT_EQ(v.Rows(), 0);
+    ASSERT_EQ(v.Cols(), 0);
+    ASSERT_EQ(v.Data(), nullptr);
+    ASSERT_EQ(A.Norm2(), 0);
+    ASSERT_EQ(A.NormInfinity(), 0);
+
+    Mat B = v;
+    ASSERT_EQ(B.Rows(), 0);
+    ASSERT_EQ(B.Cols(), 0);
+    ASSERT_EQ(B.Data(), nullptr);
+    B = A;
+    B += A;
+    ASSERT_EQ(B, A);
+
+    Vec x(std::valarray<double>{});
+    VecView xv = x;
+    MutableVecView mv = x;
+    ASSERT_EQ(xv.Size(), 0);
+    ASSERT_EQ(mv.Size(), 0);
+    ASSERT_EQ(mv.Data(), nullptr);
+}
+TEST(MatView, VecView) {
+    MemoryLeakDetection mld;
+
+    // 调用者自己的内存，每隔一个元素取一个
+    double buf[] = {1, -1, 2, -1, 3, -1};
+    VecView x(buf, 3, 2);
+    ASSERT_EQ(x.Size(), 3);
+    ASSERT_EQ(Vec(x), Vec({1, 2, 3}));
+    ASSERT_EQ(Vec(x.Segment(1, 2)), Vec({2, 3}));
+
+    Vec y = {4, 5, 6};
+    ASSERT_DOUBLE_EQ(Dot(x, y), 32);
+    ASSERT_DOUBLE_EQ(Dot(y, y), 77);
+
+    MutableVecView out(buf + 1, 3, 2);
+    ScaledAdd(x, 2, y, out);
+    ASSERT_EQ(Vec(out), Vec({9, 12, 15}));
+    ASSERT_EQ(Vec(x), Vec({1, 2, 3}));
+
+    // 结果写回x自身
+    MutableVecView mx(buf, 3, 2);
+    ScaledAdd(x, -1, x, mx);
+    ASSERT_EQ(Vec(x), Vec({0, 0, 0}));
+
+    mx = y - 2 * x;
+    ASSERT_EQ(Vec(x), Vec({4, 5, 6}));
+    mx = out;
+    ASSERT_EQ(Vec(x), Vec({9, 12, 15}));
+
+    Vec z(3);
+    MutableVecView mz = z;
+    mz[1] = 7;
+    ASSERT_EQ(z, Vec({0, 7, 0}));
+}
+TEST(MatView, Solve) {
+    MemoryLeakDetection mld;
+
+    // 行主序存储在调用者数组中的矩阵，只取左上角3×3
+    double a[] = {2, 1, 1, 99, 4, -6, 0, 99, -2, 7, 2, 99};
+    MatView A(a, 3, 3, 4, 1);
+    double b[] = {5, -2, 9};
+    Vec expected = {1, 1, 2};
+
+    LUFactorization lu(A);
+    ASSERT_EQ(lu.Solve(VecView(b, 3)), expected);
+
+    // 结果写入调用者的数组
+    double x[6] = {};
+    lu.Solve(VecView(b, 3), MutableVecView(x, 3, 2));
+    ASSERT_EQ(Vec(VecView(x, 3, 2)), expected);
+
+    ASSERT_EQ(SolveLinear(A, VecView(b, 3)), expected);
+
+    // 转置视图：Aᵀy = b
+    LUFactorization luT(A.Transpose());
+    Vec y = luT.Solve(VecView(b, 3));
+    ASSERT_EQ(Mat(A.Transpose()) * y, Mat(Vec(VecView(b, 3))));
+
+    // 对称正定矩阵AᵀA
+    Mat AtA = Mat(A.Transpose()) * Mat(A);
+    CholeskyFactorization chol;
+    ASSERT_TRUE(chol.Factor(AtA));
+    Vec c = (AtA * expected).ToVec();
+    ASSERT_EQ(chol.Solve(c), expected);
+}
+TEST(MatView, VarsTable) {
+    MemoryLeakDetection mld;
+
+    double state[] = {1, 2, 3};
+    VarsTable table({"x", "y", "z"}, VecView(state, 3));
+    ASSERT_EQ(table, VarsTable({{"x", 1}, {"y", 2}, {"z", 3}}));
+
+    double next[] = {0, 4, 0, 5, 0, 6};
+    table.SetValues(VecView(next + 1, 3, 2));
+    ASSERT_EQ(table, VarsTable({{"x", 4}, {"y", 5}, {"z", 6}}));
+}
+
+TEST(MultiStart, AllRoots) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // (x - 1)(x - 2)(x - 3) = 0。根按得到它的第一个初值排序，从4出发得到3
+    SymVec f = {"x^3 - 6*x^2 + 11*x - 6"_f};
+    std::vector<VarsTable> starts;
+    for (int i = 0; i <= 8; ++i) {
+        starts.emplace_back(VarsTable{{"x", 4 - 0.5 * i}});
+    }
+
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::AUTO}) {
+        Config::Get().nonlinearMethod = method;
+        for (int threads : {1, 4}) {
+            MultiStartOptions options;
+            options.threads = threads;
+            std::vector<VarsTable> roots = SolveMultiStart(f, starts, options);
+            ASSERT_EQ(roots.size(), 3u);
+            ASSERT_NEAR(roots[0]["x"], 3, 1e-9);
+            std::vector<double> xs;
+            for (auto &root : roots) {
+                xs.push_back(root["x"]);
+            }
+            std::sort(xs.begin(), xs.end());
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_NEAR(xs[i], i + 1, 1e-9);
+            }
+        }
+    }
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // 圆与直线的两个交点，从网格上的初值出发
+    SymVec circle = {"x^2 + y^2 - 4"_f, "x - y"_f};
+    starts.clear();
+    for (int i = -2; i <= 2; ++i) {
+        for (int j = -2; j <= 2; ++j) {
+            if (i + j != 0) {
+                starts.emplace_back(VarsTable{{"x", i + 0.1}, {"y", j}});
+            }
+        }
+    }
+    std::vector<VarsTable> roots = SolveMultiStart(circle, starts);
+    ASSERT_EQ(roots.size(), 2u);
+    for (auto &root : roots) {
+        ASSERT_NEAR(std::abs(root["x"]), std::sqrt(2.0), 1e-9);
+        ASSERT_NEAR(root["x"], root["y"], 1e-9);
+    }
+    ASSERT_NEAR(roots[0]["x"] + roots[1]["x"], 0, 1e-9);
+
+    // 没有收敛的初值被忽略：从20出发的牛顿步超出定义域
+    starts = {VarsTable{{"x", 20}}, VarsTable{{"x", 2}}};
+    roots = SolveMultiStart(SymVec{"log(x) - 1"_f}, starts);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], std::exp(1.0), 1e-9);
+
+    ASSERT_TRUE(SolveMultiStart(SymVec{"x^2 + 1"_f}, {VarsTable{{"x", 3}}}).empty());
+    ASSERT_TRUE(SolveMultiStart(f, {}).empty());
+
+    // 初值的变量必须一致
+    starts = {VarsTable{{"x", 1}, {"y", 1}}, VarsTable{{"y", 1}, {"z", 1}}};
+    ASSERT_THROW(SolveMultiStart(circle, starts), MathError);
+}
+TEST(MultiStart, FirstConverged) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 大量没有希望的初值（x² + 1在实数范围内无根）中混有一个能收敛的初值，其余的求解被取消
+    SymVec f = {"(x^2 + 1) * (x - 5)"_f};
+    std::vector<VarsTable> starts;
+    for (int i = 0; i < 200; ++i) {
+        starts.emplace_back(VarsTable{{"x", -10 + 0.01 * i}});
+    }
+    starts[150] = VarsTable{{"x", 6}};
+
+    Config::Get().nonlinearMethod = NonlinearMethod::AUTO;
+    MultiStartOptions options;
+    options.mode = MultiStartMode::FIRST_CONVERGED;
+    options.threads = 4;
+    std::vector<VarsTable> roots = SolveMultiStart(f, starts, options);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], 5, 1e-9);
+
+    options.threads = 1;
+    roots = SolveMultiStart(f, starts, options);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], 5, 1e-9);
+}
 
 TEST(Node, Num) {
     MemoryLeakDetection mld;
@@ -955,6 +2801,87 @@ TEST(Node, Equal) {
     ASSERT_TRUE((Var("a") + Var("b") * Var("c"))->Equal(n));
 }
 
+TEST(ParametricSystem, Base) {
+    MemoryLeakDetection mld;
+
+    // 平面二连杆的逆运动学：连杆长度l1、l2与目标位置(px, py)是参数
+    SymVec equations = {
+        "l1*cos(t1) + l2*cos(t1+t2) - px"_f,
+        "l1*sin(t1) + l2*sin(t1+t2) - py"_f,
+    };
+    VarsTable params{{"l1", 1}, {"l2", 0.8}, {"px", 1.2}, {"py", 0.6}};
+    ParametricSystem system(equations, {"t1", "t2"}, params);
+    ASSERT_EQ(system.Unknowns(), std::vector<std::string>({"t1", "t2"}));
+    ASSERT_EQ(system.Params(), params.Vars());
+
+    // 与代入参数后直接求解的结果相同
+    VarsTable initial{{"t1", 0.3}, {"t2", 0.5}};
+    VarsTable got = system.Solve(initial);
+    VarsTable expected = Solve(equations.Clone().Subs(params).ToSymVec(), initial);
+    ASSERT_NEAR(got["t1"], expected["t1"], 1e-8);
+    ASSERT_NEAR(got["t2"], expected["t2"], 1e-8);
+    ASSERT_TRUE(system.Eval(got.Values()).NormInfinity() < 1e-9);
+
+    // 目标沿圆弧移动：只更新参数值，以上一次的解作为初值
+    Vec q = got.Values();
+    for (int i = 0; i <= 50; ++i) {
+        double angle = 0.02 * i, px = 1.3 * std::cos(angle), py = 1.3 * std::sin(angle);
+        system.Rebind(Vec{1, 0.8, px, py});
+        system.Solve(q);
+        ASSERT_NEAR(std::cos(q[0]) + 0.8 * std::cos(q[0] + q[1]), px, 1e-9);
+        ASSERT_NEAR(std::sin(q[0]) + 0.8 * std::sin(q[0] + q[1]), py, 1e-9);
+    }
+
+    // 按名字更新部分参数，其余参数保持原值
+    system.Rebind(VarsTable{{"px", 0}, {"py", 1.5}});
+    Vec F = system.Eval(Vec{PI / 2, 0});
+    ASSERT_NEAR(F[0], 0, 1e-12);
+    ASSERT_NEAR(F[1], 0.3, 1e-12);
+
+    // 副本的参数值互不影响
+    ParametricSystem copy = system;
+    copy.Rebind(Vec{1, 1, 0, 0});
+    ASSERT_NEAR(copy.Eval(Vec{PI / 2, 0})[1], 2, 1e-12);
+    ASSERT_NEAR(system.Eval(Vec{PI / 2, 0})[1], 0.3, 1e-12);
+}
+TEST(ParametricSystem, Error) {
+    MemoryLeakDetection mld;
+
+    SymVec equations = {"x^2 - a"_f};
+
+    // 未声明的变量、重复的名字
+    ASSERT_THROW(ParametricSystem(equations, {"x"}, std::vector<std::string>{}), MathError);
+    ASSERT_THROW(ParametricSystem(equations, {"x"}, std::vector<std::string>{"a", "x"}), MathError);
+
+    ParametricSystem system(equations, {"x"}, {"a"});
+    try {
+        system.Rebind(VarsTable{{"x", 1}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+    try {
+        system.Solve(VarsTable{{"y", 1}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::SIZE_NOT_MATCH);
+    }
+
+    // a = 4时x = 2；a = -1时没有实根
+    system.Rebind(Vec{4});
+    ASSERT_NEAR(system.Solve(VarsTable{{"x", 1}})["x"], 2, 1e-9);
+    system.Rebind(Vec{-1});
+    ASSERT_THROW(system.Solve(VarsTable{{"x", 1}}), MathError);
+
+    // 有不是参数的名字时，其他参数也不修改
+    ParametricSystem two({"x - a - b"_f}, {"x"}, {"a", "b"});
+    two.Rebind(Vec{1, 2});
+    ASSERT_THROW(two.Rebind(VarsTable{{"a", 10}, {"b", 20}, {"c", 30}}), MathError);
+    ASSERT_DOUBLE_EQ(two.Eval(Vec{0})[0], -3);
+    two.Rebind(VarsTable{{"a", 5}});
+    ASSERT_DOUBLE_EQ(two.Eval(Vec{0})[0], -7);
+}
+
 TEST(Parse, Base) {
     MemoryLeakDetection mld;
     std::setlocale(LC_ALL, ".UTF8");
@@ -1357,6 +3284,11 @@ TEST(SolveBase, FindAlphaByArmijo) {
     double alpha = Armijo(x, d, g, dg);
     cout << alpha << endl;
 
+    // 上升方向：回溯次数用完后返回失败
+    ASSERT_FALSE(Armijo(x, -d, g, dg, alpha));
+    ASSERT_GT(alpha, 0);
+    ASSERT_EQ(Armijo(x, -d, g, dg), 0);
+
     // FIXME: not match got results
     // double expected = 0.003866;
 }
@@ -1420,6 +3352,13 @@ TEST(SolveBase, Base) {
         VarsTable got = SolveByLM(equations, varsTable);
         cout << got << endl;
 
+        ASSERT_EQ(got, expected);
+    }
+    // 折线法
+    {
+        VarsTable got = SolveByDogleg(equations, varsTable);
+        cout << got << endl;
+
         ASSERT_EQ(got, expected);
     }
 }
@@ -1452,6 +3391,297 @@ TEST(SolveBase, IndeterminateEquation) {
     VarsTable got = Solve(f);
     cout << got << endl;
 }
+TEST(SolveBase, ReuseJacobian) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    // 弦方法：雅可比矩阵只在收缩变慢时重新分解
+    Config::Get().reuseJacobian = true;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    VarsTable got = SolveByNewtonRaphson(f, varsTable);
+    cout << got << endl;
+
+    // 弦方法为线性收敛，残差满足容差时解的精度略低于牛顿法
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
+TEST(SolveBase, MixedPrecision) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    // 单精度分解雅可比矩阵，迭代修正后的牛顿步与双精度一致
+    Config::Get().mixedPrecision = true;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    VarsTable got = SolveByNewtonRaphson(f, varsTable);
+    cout << got << endl;
+    ASSERT_EQ(got, expected);
+
+    // 与弦方法同时使用
+    Config::Get().reuseJacobian = true;
+    got = SolveByNewtonRaphson(f, varsTable);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
+TEST(SolveBase, LM) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // Rosenbrock函数的残差形式，弯曲狭长的山谷
+    {
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+    }
+
+    // 完整的第一步会落到ln的定义域之外，试探步被拒绝后增大阻尼
+    {
+        SymVec f = {"log(x)-1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x", 20}});
+        ASSERT_NEAR(got["x"], std::exp(1.0), 1.0e-8);
+    }
+
+    // 方程数量多于未知数数量的相容方程组
+    {
+        SymVec f = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+    // 用共轭梯度法求解阻尼方程
+    {
+        Config::Get().lmConjugateGradient = true;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+
+        SymVec g = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        got = SolveByLM(g, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+}
+TEST(SolveBase, Dogleg) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // 完整的牛顿步发散
+    {
+        SymVec f = {"arctan(x)"_f};
+        ASSERT_ANY_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 3}}));
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 3}});
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+
+    // Rosenbrock函数的残差形式
+    {
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+    }
+
+    // 完整的第一步会落到ln的定义域之外
+    {
+        SymVec f = {"log(x)-1"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 20}});
+        ASSERT_NEAR(got["x"], std::exp(1.0), 1.0e-8);
+    }
+
+    // 方程数量多于未知数数量的相容方程组
+    {
+        SymVec f = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+
+    // Powell的病态缩放函数，两个未知数相差约6个数量级
+    {
+        SymVec f = {"10000*x*y-1"_f, "exp(-x)+exp(-y)-1.0001"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 0}, {"y", 1}});
+        ASSERT_NEAR(got["x"], 1.098159329e-5, 1.0e-12);
+        ASSERT_NEAR(got["y"], 9.106146740, 1.0e-8);
+    }
+}
+TEST(SolveBase, FixedPoint) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // x = cos(x)
+    {
+        VarsTable got = SolveFixedPoint(SymVec{"cos(x)"_f}, VarsTable{{"x", 1}});
+        ASSERT_NEAR(got["x"], 0.7390851332151607, 1e-9);
+    }
+
+    // 二元压缩映射
+    SymVec G = {"0.5*cos(y)"_f, "0.5*sin(x) + 0.1"_f};
+    VarsTable got = SolveFixedPoint(G, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(got["x"] - 0.5 * std::cos(got["y"]), 0, 1e-9);
+    ASSERT_NEAR(got["y"] - 0.5 * std::sin(got["x"]) - 0.1, 0, 1e-9);
+
+    Config::Get().andersonDepth = 0;
+    VarsTable picard = SolveFixedPoint(G, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(picard["x"], got["x"], 1e-6);
+    ASSERT_NEAR(picard["y"], got["y"], 1e-6);
+
+    // 收缩因子接近1时普通不动点迭代很慢，Anderson加速的割线外推一步即可得到线性问题的解
+    SymVec slow = {"0.99*x + 0.01*y"_f, "0.99*y - 0.01*x + 0.02"_f};
+    Config::Get().maxIterations = 50;
+    ASSERT_THROW(SolveFixedPoint(slow, VarsTable({"x", "y"}, 0.0)), std::runtime_error);
+
+    Config::Get().andersonDepth = 5;
+    got = SolveFixedPoint(slow, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(got["x"], 1, 1e-6);
+    ASSERT_NEAR(got["y"], 1, 1e-6);
+
+    // G的行数必须等于未知数数量
+    ASSERT_THROW(SolveFixedPoint(SymVec{"cos(x)"_f}, VarsTable({"x", "y"}, 0.0)), MathError);
+}
+TEST(SolveBase, Equilibration) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // y的单位比x小10个数量级，根为x = 2, y = 1e10。不缩放时消元得到的第二个主元约为1e-10，被误判为奇异
+    SymVec f = {"x^2 + 0.0000000001*y - 5"_f, "x - 0.0000000001*y - 1"_f};
+    VarsTable init({"x", "y"}, 1.0);
+
+    // 默认不缩放
+    ASSERT_FALSE(Config::Get().equilibrate);
+    ASSERT_THROW(SolveByNewtonRaphson(f, init), MathError);
+
+    Config::Get().equilibrate = true;
+    for (int update = 0; update < 2; ++update) {
+        Config::Get().updateEquilibration = update;
+        for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                            NonlinearMethod::AUTO}) {
+            Config::Get().nonlinearMethod = method;
+            VarsTable got = Solve(f, init);
+            ASSERT_NEAR(got["x"], 2, 1e-9);
+            ASSERT_NEAR(got["y"], 1e10, 1e-9 * 1e10);
+        }
+    }
+
+    // 弦方法与混合精度复用平衡后的分解结果
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+    Config::Get().reuseJacobian = true;
+    VarsTable got = Solve(f, init);
+    ASSERT_NEAR(got["x"], 2, 1e-9);
+    Config::Get().reuseJacobian = false;
+    Config::Get().mixedPrecision = true;
+    got = Solve(f, init);
+    ASSERT_NEAR(got["x"], 2, 1e-9);
+}
+TEST(SolveBase, Polyalgorithm) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 牛顿法收敛良好时与牛顿法的结果相同
+    SymVec equations = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable init({"x1", "x2", "x3"}, 1.0);
+    VarsTable expected = SolveByNewtonRaphson(equations, init);
+    VarsTable got = SolveByPolyalgorithm(equations, init);
+    ASSERT_EQ(got, expected);
+
+    Config::Get().nonlinearMethod = NonlinearMethod::AUTO;
+    ASSERT_EQ(Solve(equations, init), expected);
+
+    // 牛顿步超出定义域：log(-40)
+    {
+        SymVec f = {"log(x) - 1"_f};
+        ASSERT_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 20}}), MathError);
+        ASSERT_NEAR(Solve(f, VarsTable{{"x", 20}})["x"], std::exp(1.0), 1e-9);
+    }
+
+    // 牛顿迭代发散：arctan(x)从3出发，||F||不再收缩
+    {
+        SymVec f = {"arctan(x)"_f};
+        ASSERT_ANY_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 3}}));
+        ASSERT_NEAR(Solve(f, VarsTable{{"x", 3}})["x"], 0, 1e-9);
+    }
+
+    // 初值处雅可比矩阵奇异
+    {
+        SymVec f = {"x^2 - y"_f, "x + y - 2"_f};
+        VarsTable start{{"x", -0.5}, {"y", 0}};
+        ASSERT_THROW(SolveByNewtonRaphson(f, start), MathError);
+        got = Solve(f, start);
+        ASSERT_NEAR(got["x"] * got["x"] - got["y"], 0, 1e-9);
+        ASSERT_NEAR(got["x"] + got["y"] - 2, 0, 1e-9);
+    }
+
+    // 非方阵直接使用LM方法
+    {
+        SymVec f = {"x - 1"_f, "y - 2"_f, "x + y - 3"_f};
+        got = Solve(f, VarsTable({"x", "y"}, 0.0));
+        ASSERT_NEAR(got["x"], 1, 1e-9);
+        ASSERT_NEAR(got["y"], 2, 1e-9);
+    }
+
+    // 切换到LM方法时，牛顿法已经检查过的F不重复计入停滞次数。
+    // 从x = 3出发，||F||在6次检查中没有明显下降之后才开始减小，重复检查时为7次，会被误判为停滞
+    Config::Get().stagnationIterations = 7;
+    ASSERT_NEAR(Solve(SymVec{"arctan(x)"_f}, VarsTable{{"x", 3}})["x"], 0, 1e-9);
+    Config::Get().stagnationIterations = 0;
+
+    // 迭代次数在两个阶段中累计
+    Config::Get().maxIterations = 1;
+    ASSERT_THROW(Solve(SymVec{"arctan(x)"_f}, VarsTable{{"x", 3}}), std::runtime_error);
+}
 
 TEST(Solve, Base) {
     // the example of this test is from: https://zhuanlan.zhihu.com/p/136889381
@@ -1508,6 +3738,20 @@ TEST(Solve, Base) {
         VarsTable got = Solve(equations);
         cout << got << endl;
 
+        ASSERT_EQ(got, expected);
+    }
+    // 折线法
+    {
+        Config::Get().nonlinearMethod = NonlinearMethod::DOGLEG;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [&](...) {
+            Config::Get().Reset();
+        });
+
+        VarsTable got = Solve(equations);
+        cout << got << endl;
+
         ASSERT_EQ(got, expected);
     }
 }
@@ -1538,7 +3782,6 @@ TEST(Solve, Case1) {
 
             0.353246561920553   0.606082026502285
 
-
      */
 
     // 设置初值为0.0
@@ -1661,6 +3904,38 @@ TEST(Solve, Case4) {
     cout << ans << endl;
 }
 
+TEST(SparseMat, Base) {
+    MemoryLeakDetection mld;
+
+    // 顺序任意，重复的位置累加
+    SparseMat A(3, 4, {{2, 3, 1}, {0, 0, 4}, {1, 2, -1}, {0, 2, 2}, {2, 0, 5}, {1, 2, -2}});
+    ASSERT_EQ(A.Rows(), 3);
+    ASSERT_EQ(A.Cols(), 4);
+    ASSERT_EQ(A.NonZeros(), 5);
+    Mat dense = {{4, 0, 2, 0}, {0, 0, -3, 0}, {5, 0, 0, 1}};
+    ASSERT_EQ(A.ToMat(), dense);
+    ASSERT_EQ(A.Value(1, 2), -3);
+    ASSERT_EQ(A.Value(1, 1), 0);
+    ASSERT_EQ(A.RowPointers(), (std::vector<int>{0, 2, 3, 5}));
+    ASSERT_EQ(A.ColIndices(), (std::vector<int>{0, 2, 2, 0, 3}));
+
+    Vec x = {1, 2, 3, 4};
+    Vec y(3);
+    A.Multiply(x, y);
+    ASSERT_EQ(y, (dense * x).ToVec());
+
+    Vec z = {1, -1, 2};
+    Vec w(4);
+    A.TransposeMultiply(z, w);
+    ASSERT_EQ(w, (dense.Transpose() * z).ToVec());
+
+    // 由稠密矩阵构造
+    SparseMat B(dense);
+    ASSERT_EQ(B.NonZeros(), 5);
+    ASSERT_EQ(B.ToMat(), dense);
+    ASSERT_EQ(B.Values(), A.Values());
+}
+
 TEST(Subs, Base) {
     MemoryLeakDetection mld;
 
@@ -0,0 +1,332 @@
+#include "batch.h"
+
+#include "compiled_symmat.h"
+#include "config.h"
+#include "convergence.h"
+#include "error_type.h"
+#include "linear.h"
+#include "mat_view.h"
+#include "nonlinear.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace tomsolver {
+
+namespace {
+
+// SIMD批量求解每批的路数：AVX-512一次处理8个double，AVX2、SSE2分两次、四次
+constexpr int BATCH_LANES = 8;
+
+// 使用SIMD批量求解的未知数数量上限。更大的方程组每一路的计算量已经足够，逐组求解即可
+constexpr int MAX_LANE_UNKNOWNS = 8;
+
+// 求解失败的原因。不属于求解失败的错误（例如方程组不是方阵）返回false
+bool ToBatchStatus(const MathError &err, BatchStatus &status) noexcept {
+    switch (err.GetErrorType()) {
+    case ErrorType::ERROR_SINGULAR_MATRIX:
+        status = BatchStatus::SINGULAR;
+        return true;
+    case ErrorType::ERROR_INVALID_NUMBER:
+    case ErrorType::ERROR_OUTOF_DOMAIN:
+        status = BatchStatus::INVALID_NUMBER;
+        return true;
+    case ErrorType::ERROR_DIVERGENCE:
+        status = BatchStatus::DIVERGED;
+        return true;
+    case ErrorType::ERROR_STAGNATION:
+        status = BatchStatus::STAGNATED;
+        return true;
+    case ErrorType::ERROR_ITERATION_LIMIT:
+        status = BatchStatus::ITERATION_LIMIT;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * 用牛顿法同时求解BATCH_LANES组参数，每一路的计算与internal::SolveCompiled的NEWTON_RAPHSON相同
+ * （包括行列平衡与收敛判断），只是求值和LU分解在各路之间交错进行。
+ * 某一路结束（收敛或失败）后，立即从next取下一组参数装入这一路，直到所有参数组都已求解。
+ */
+void SolveLanes(const CompiledSymMat &f, const CompiledSymMat &df, MatView params, MatView guesses,
+                std::atomic<int> &next, BatchResult &result) {
+    const int W = BATCH_LANES;
+    int n = f.Rows();
+    int p = params.Cols();
+    int count = params.Rows();
+    const Config &config = Config::Get();
+
+    // 数据按路交错存放：q[i * W + l]为第l路的第i个未知数
+    std::vector<double> pv(p * W), q(n * W), qNew(n * W), F(n * W), FNew(n * W), J(n * n * W), deltaq(n * W);
+    std::vector<int> pivots(n * W);
+
+    int rows[W];   // 每一路正在求解的参数组，-1表示空闲
+    int its[W];    // 每一路的迭代次数
+    bool fresh[W]; // 刚装入，还没有计算F
+    bool invalid[W], ok[W];
+    ConvergenceMonitor monitors[W];
+    Equilibration eqs[W];
+    std::fill(rows, rows + W, -1);
+
+    auto finish = [&](int l, BatchStatus status) {
+        result.status[rows[l]] = status;
+        for (int i = 0; i < n; ++i) {
+            result.solutions.Value(rows[l], i) = q[i * W + l];
+        }
+        rows[l] = -1;
+    };
+    // 空闲的路仍然参与计算，结果不使用。把最后一条在用的路的数据复制过去，使空闲的路只在有效的数据上计算
+    // （否则是已经结束的组留下的数据，或者全为0，例如x % a中a为0）。v为按路交错存放、每路rowsPerLane个元素的数据
+    auto fillIdle = [&](std::vector<double> &v, int rowsPerLane) {
+        int src = W - 1;
+        while (src >= 0 && rows[src] < 0) {
+            --src;
+        }
+        if (src < 0) {
+            return;
+        }
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] < 0) {
+                for (int i = 0; i < rowsPerLane; ++i) {
+                    v[i * W + l] = v[i * W + src];
+                }
+            }
+        }
+    };
+    auto checkInvalid = [&](const bool *lanes) {
+        for (int l = 0; l < W; ++l) {
+            if (lanes[l] && invalid[l] && config.throwOnInvalidValue) {
+                finish(l, BatchStatus::INVALID_NUMBER);
+            }
+        }
+    };
+
+    while (1) {
+        // 把空闲的路装满，并对新装入的路计算F、判断收敛，直到没有空闲的路或者没有剩下的参数组
+        bool refilled = true;
+        while (refilled) {
+            refilled = false;
+            for (int l = 0; l < W; ++l) {
+                fresh[l] = false;
+                if (rows[l] >= 0) {
+                    continue;
+                }
+                int k = next++;
+                if (k >= count) {
+                    continue;
+                }
+                rows[l] = k;
+                its[l] = 0;
+                fresh[l] = refilled = true;
+                monitors[l] = ConvergenceMonitor();
+                eqs[l] = Equilibration();
+                for (int i = 0; i < p; ++i) {
+                    pv[i * W + l] = params.Value(k, i);
+                }
+                for (int i = 0; i < n; ++i) {
+                    q[i * W + l] = guesses.Value(guesses.Rows() == 1 ? 0 : k, i);
+                }
+            }
+            if (!refilled) {
+                break;
+            }
+
+            fillIdle(pv, p);
+            fillIdle(q, n);
+            std::fill(invalid, invalid + W, false);
+            f.EvalLanes<W>(q.data(), pv.data(), FNew.data(), invalid);
+            for (int l = 0; l < W; ++l) {
+                if (fresh[l]) {
+                    for (int i = 0; i < n; ++i) {
+                        F[i * W + l] = FNew[i * W + l];
+                    }
+                }
+            }
+            checkInvalid(fresh);
+
+            for (int l = 0; l < W; ++l) {
+                if (!fresh[l] || rows[l] < 0) {
+                    continue;
+                }
+                try {
+                    if (monitors[l].Check(0, VecView(F.data() + l, n, W))) {
+                        finish(l, BatchStatus::CONVERGED);
+                    } else if (its[l] > config.maxIterations) {
+                        finish(l, BatchStatus::ITERATION_LIMIT);
+                    }
+                } catch (const MathError &err) {
+                    BatchStatus status;
+                    if (!ToBatchStatus(err, status)) {
+                        throw;
+                    }
+                    finish(l, status);
+                }
+            }
+        }
+
+        bool live[W];
+        for (int l = 0; l < W; ++l) {
+            live[l] = rows[l] >= 0;
+        }
+        if (std::none_of(live, live + W, [](bool b) {
+                return b;
+            })) {
+            return;
+        }
+
+        fillIdle(pv, p);
+        fillIdle(q, n);
+        std::fill(invalid, invalid + W, false);
+        df.EvalLanes<W>(q.data(), pv.data(), J.data(), invalid);
+        checkInvalid(live);
+
+        // 每一路分别做行列平衡：J = R·J·C，F = R·F
+        deltaq = F;
+        if (config.equilibrate) {
+            for (int l = 0; l < W; ++l) {
+                if (rows[l] < 0) {
+                    continue;
+                }
+                MatView Jl(J.data() + l, n, n, n * W, W);
+                if (!eqs[l].IsComputed() || config.updateEquilibration) {
+                    eqs[l].Compute(Jl);
+                }
+                VecView r = eqs[l].RowScale(), c = eqs[l].ColScale();
+                for (int i = 0; i < n; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J[(i * n + j) * W + l] *= r[i] * c[j];
+                    }
+                    deltaq[i * W + l] *= r[i];
+                }
+            }
+        }
+
+        std::fill(ok, ok + W, true);
+        internal::LUFactorLanes<W>(J.data(), n, pivots.data(), ok);
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] >= 0 && !ok[l]) {
+                finish(l, BatchStatus::SINGULAR);
+            }
+        }
+
+        internal::LUSolveLanes<W>(J.data(), pivots.data(), n, deltaq.data());
+        if (config.equilibrate) {
+            for (int l = 0; l < W; ++l) {
+                if (rows[l] < 0) {
+                    continue;
+                }
+                VecView c = eqs[l].ColScale();
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i * W + l] *= c[i];
+                }
+            }
+        }
+        for (int i = 0; i < n * W; ++i) {
+            qNew[i] = q[i] - deltaq[i];
+        }
+
+        fillIdle(qNew, n);
+        std::fill(invalid, invalid + W, false);
+        f.EvalLanes<W>(qNew.data(), pv.data(), FNew.data(), invalid);
+        for (int l = 0; l < W; ++l) {
+            live[l] = rows[l] >= 0;
+        }
+        checkInvalid(live);
+
+        for (int l = 0; l < W; ++l) {
+            if (rows[l] < 0) {
+                continue;
+            }
+            ++its[l];
+            double stepNorm2 = 0, qNorm2 = 0;
+            for (int i = 0; i < n; ++i) {
+                q[i * W + l] = qNew[i * W + l];
+                F[i * W + l] = FNew[i * W + l];
+                stepNorm2 += deltaq[i * W + l] * deltaq[i * W + l];
+                qNorm2 += q[i * W + l] * q[i * W + l];
+            }
+            if (monitors[l].StepConverged(std::sqrt(stepNorm2), std::sqrt(qNorm2))) {
+                finish(l, BatchStatus::CONVERGED);
+                continue;
+            }
+
+            try {
+                if (monitors[l].Check(its[l], VecView(F.data() + l, n, W))) {
+                    finish(l, BatchStatus::CONVERGED);
+                } else if (its[l] > config.maxIterations) {
+                    finish(l, BatchStatus::ITERATION_LIMIT);
+                }
+            } catch (const MathError &err) {
+                BatchStatus status;
+                if (!ToBatchStatus(err, status)) {
+                    throw;
+                }
+                finish(l, status);
+            }
+        }
+    }
+}
+
+} // namespace
+
+BatchResult SolveBatch(const SymVec &equations, const std::vector<std::string> &unknowns,
+                       const std::vector<std::string> &parameterNames, const Mat &parameterRows,
+                       const Mat &initialGuesses, const BatchOptions &options) {
+    int count = parameterRows.Rows();
+    int n = static_cast<int>(unknowns.size());
+    if (parameterRows.Cols() != static_cast<int>(parameterNames.size()) || initialGuesses.Cols() != n ||
+        (initialGuesses.Rows() != 1 && initialGuesses.Rows() != count)) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH, "parameterRows: " + std::to_string(count) + "x" +
+                                                       std::to_string(parameterRows.Cols()) + ", initialGuesses: " +
+                                                       std::to_string(initialGuesses.Rows()) + "x" +
+                                                       std::to_string(initialGuesses.Cols()));
+    }
+
+    // 符号求导与编译只做一次
+    CompiledSymMat f(equations, unknowns, parameterNames);
+    CompiledSymMat df(Jacobian(equations, unknowns), unknowns, parameterNames);
+    NonlinearMethod method = Config::Get().nonlinearMethod;
+
+    BatchResult result{Mat(count, n), std::vector<BatchStatus>(count, BatchStatus::CONVERGED)};
+    MatView params(parameterRows), guesses(initialGuesses);
+
+    // 小规模方程组用牛顿法求解时，多组参数打包为一批，各组的参数值由EvalLanes直接读取，f与df各线程共享
+    if (options.laneBatched && method == NonlinearMethod::NEWTON_RAPHSON && f.Rows() == n && n <= MAX_LANE_UNKNOWNS) {
+        // 每个线程同时求解BATCH_LANES组，各线程从next取下一组参数
+        std::atomic<int> next{0};
+        int workers = internal::ParallelWorkers((count + BATCH_LANES - 1) / BATCH_LANES, options.threads);
+        internal::ParallelFor(workers, workers, [&](int, int) {
+            SolveLanes(f, df, params, guesses, next, result);
+        });
+        return result;
+    }
+
+    // 参数值保存在CompiledSymMat中，每个线程使用自己的副本
+    int workers = internal::ParallelWorkers(count, options.threads);
+    std::vector<CompiledSymMat> fs(workers, f), dfs(workers, df);
+    internal::ParallelFor(count, options.threads, [&](int worker, int k) {
+        fs[worker].SetParams(params.Row(k));
+        dfs[worker].SetParams(params.Row(k));
+        Vec q(guesses.Row(guesses.Rows() == 1 ? 0 : k));
+
+        ConvergenceMonitor monitor;
+        try {
+            internal::SolveCompiled(method, fs[worker], dfs[worker], q, monitor);
+        } catch (const MathError &err) {
+            if (!ToBatchStatus(err, result.status[k])) {
+                throw;
+            }
+        }
+
+        for (int j = 0; j < n; ++j) {
+            result.solutions.Value(k, j) = q[j];
+        }
+    });
+    return result;
+}
+
+} // namespace tomsolver
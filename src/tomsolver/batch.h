@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mat.h"
+#include "symmat.h"
+
+#include <string>
+#include <vector>
+
+namespace tomsolver {
+
+/**
+ * 批量求解中每一组参数的求解结果。
+ */
+enum class BatchStatus {
+    CONVERGED,       // 收敛
+    ITERATION_LIMIT, // 迭代次数超出限制
+    SINGULAR,        // 雅可比矩阵奇异
+    INVALID_NUMBER,  // 迭代点超出定义域，出现浮点数无效值
+    DIVERGED,        // 迭代发散
+    STAGNATED        // 迭代停滞
+};
+
+/**
+ * 批量求解的选项。
+ */
+struct BatchOptions {
+    /**
+     * 工作线程数量（包括调用者所在的线程）。为0时取std::thread::hardware_concurrency()。不超过参数的组数。
+     */
+    int threads = 0;
+
+    /**
+     * 是否使用SIMD批量求解：求解方法为NEWTON_RAPHSON、方程数量等于未知数数量且不超过8个时，
+     * 每8组参数按路交错存放（AoSoA）打包为一批，同时求值、同时做LU分解，已经结束的组不再更新。
+     * 每一组的计算与逐组求解相同，只是减少了解释执行和循环的开销，并且可以被编译器向量化。
+     */
+    bool laneBatched = true;
+};
+
+struct BatchResult {
+    /**
+     * 第i行为第i组参数的解，第j列对应unknowns[j]。没有收敛的行为迭代中止时的值。
+     */
+    Mat solutions;
+
+    /**
+     * 第i组参数的求解结果。
+     */
+    std::vector<BatchStatus> status;
+};
+
+/**
+ * 对多组参数求解同一个非线性方程组。方程组中除unknowns以外的符号都是参数，第i组参数的值为parameterRows的第i行。
+ * 方程组与雅可比矩阵只做一次符号求导和编译，之后每组参数只需要设置参数值（见CompiledSymMat::SetParams），
+ * 各组参数的求解分配到多个线程中并行进行。求解方法为Config::Get().nonlinearMethod，具体见internal::SolveCompiled。
+ * @param parameterNames: 参数名，第j个参数的值为parameterRows的第j列
+ * @param parameterRows: 每行一组参数
+ * @param initialGuesses: 初值，第j列对应unknowns[j]。只有一行时所有参数组都使用这个初值，否则行数与parameterRows相同
+ * @exception MathError 矩阵的尺寸与unknowns、parameterNames不一致
+ * @exception MathError 方程组中出现unknowns与parameterNames以外的变量
+ * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量
+ */
+BatchResult SolveBatch(const SymVec &equations, const std::vector<std::string> &unknowns,
+                       const std::vector<std::string> &parameterNames, const Mat &parameterRows,
+                       const Mat &initialGuesses, const BatchOptions &options = {});
+
+} // namespace tomsolver
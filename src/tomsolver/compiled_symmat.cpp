@@ -0,0 +1,160 @@
+#include "compiled_symmat.h"
+
+#include "error_type.h"
+#include "node.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stack>
+
+namespace tomsolver {
+
+namespace internal {
+
+class CompileFunctions {
+public:
+    // 后序遍历。非递归实现。把node的逆波兰指令追加到compiled.program，返回求值过程中栈的最大深度。
+    static int CompileNode(const NodeImpl &node, const std::map<std::string, int> &varIndex,
+                           CompiledSymMat &compiled) {
+        using Instruction = CompiledSymMat::Instruction;
+        using OpCode = CompiledSymMat::OpCode;
+
+        // 借助一个栈，得到反向的后序遍历序列
+        std::stack<std::reference_wrapper<const NodeImpl>> stk;
+        std::vector<std::reference_wrapper<const NodeImpl>> revertedPostOrder;
+        stk.emplace(node);
+        while (!stk.empty()) {
+            const auto &cur = stk.top().get();
+            stk.pop();
+            if (cur.left) {
+                stk.emplace(*cur.left);
+            }
+            if (cur.right) {
+                stk.emplace(*cur.right);
+            }
+            revertedPostOrder.emplace_back(cur);
+        }
+
+        int depth = 0, maxDepth = 0;
+        for (auto it = revertedPostOrder.rbegin(); it != revertedPostOrder.rend(); ++it) {
+            const auto &cur = it->get();
+            switch (cur.type) {
+            case NodeType::NUMBER:
+                compiled.program.push_back(Instruction{OpCode::NUMBER, MathOperator::MATH_NULL, 0, cur.value});
+                ++depth;
+                break;
+            case NodeType::VARIABLE: {
+                auto itor = varIndex.find(cur.varname);
+                if (itor == varIndex.end()) {
+                    throw MathError(ErrorType::ERROR_UNDEFINED_VARIABLE, cur.varname);
+                }
+                // 下标不小于变量数量的是参数
+                if (itor->second < compiled.varNums) {
+                    compiled.program.push_back(
+                        Instruction{OpCode::VARIABLE, MathOperator::MATH_NULL, itor->second, 0});
+                } else {
+                    compiled.program.push_back(
+                        Instruction{OpCode::PARAMETER, MathOperator::MATH_NULL, itor->second - compiled.varNums, 0});
+                }
+                ++depth;
+                break;
+            }
+            case NodeType::OPERATOR:
+                switch (GetOperatorNum(cur.op)) {
+                case 1:
+                    compiled.program.push_back(Instruction{OpCode::UNARY, cur.op, 0, 0});
+                    break;
+                case 2:
+                    compiled.program.push_back(Instruction{OpCode::BINARY, cur.op, 0, 0});
+                    --depth;
+                    break;
+                default:
+                    assert(0 && "[CompileNode] unsupported operator num");
+                    break;
+                }
+                break;
+            }
+            maxDepth = std::max(maxDepth, depth);
+        }
+        assert(depth == 1);
+        return maxDepth;
+    }
+};
+
+} // namespace internal
+
+CompiledSymMat::CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars)
+    : CompiledSymMat(mat, vars, {}) {}
+
+CompiledSymMat::CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars,
+                               const std::vector<std::string> &params)
+    : rows(mat.Rows()), cols(mat.Cols()), varNums(static_cast<int>(vars.size())), params(params.size(), 0) {
+    std::map<std::string, int> varIndex;
+    for (int i = 0; i < varNums; ++i) {
+        varIndex.emplace(vars[i], i);
+    }
+    for (int i = 0; i < static_cast<int>(params.size()); ++i) {
+        if (!varIndex.emplace(params[i], varNums + i).second) {
+            throw MathError(ErrorType::ERROR_VAR_HAS_BEEN_DEFINED, params[i]);
+        }
+    }
+
+    ends.reserve(rows * cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            maxDepth = std::max(maxDepth, internal::CompileFunctions::CompileNode(*mat.Value(i, j), varIndex, *this));
+            ends.push_back(static_cast<int>(program.size()));
+        }
+    }
+}
+
+int CompiledSymMat::Rows() const noexcept {
+    return rows;
+}
+
+int CompiledSymMat::Cols() const noexcept {
+    return cols;
+}
+
+int CompiledSymMat::VarNums() const noexcept {
+    return varNums;
+}
+
+int CompiledSymMat::ParamNums() const noexcept {
+    return static_cast<int>(params.size());
+}
+
+void CompiledSymMat::SetParams(VecView values) noexcept {
+    assert(values.Size() == ParamNums());
+    for (int i = 0; i < values.Size(); ++i) {
+        params[i] = values[i];
+    }
+}
+
+Mat CompiledSymMat::Eval(VecView x) const {
+    Mat ret(rows, cols);
+    Eval(x, ret);
+    return ret;
+}
+
+Mat CompiledSymMat::Eval(VecView x, const SolverOptions &options) const {
+    ConfigScope scope(options);
+    return Eval(x);
+}
+
+void CompiledSymMat::Eval(VecView x, Mat &out) const {
+    assert(x.Size() == varNums);
+    assert(out.Rows() == rows && out.Cols() == cols);
+    double *pOut = std::addressof(out.Value(0, 0));
+    if (x.IsContiguous()) {
+        Eval(x.Data(), pOut);
+        return;
+    }
+    Vec xc(x);
+    Eval(std::addressof(xc[0]), pOut);
+}
+
+} // namespace tomsolver
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "config.h"
+#include "mat.h"
+#include "mat_view.h"
+#include "math_operator.h"
+#include "symmat.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace tomsolver {
+
+namespace internal {
+class CompileFunctions;
+}
+
+/**
+ * 编译后的符号矩阵，用于在迭代中反复求值。
+ * 构造时把每个元素的表达式树转换为一段逆波兰指令（后序遍历序列），变量替换为输入数组的下标。
+ * 之后每次求值只是顺序执行这些指令：不复制、不替换节点树，栈深度不超过64时也不申请堆内存。
+ *
+ * 求值的标量类型T由调用者选择，可以是float、double或long double。常数以double保存，求值时转换为T。
+ * 例如先用float快速筛选大量初值的残差，再对筛选出的初值用double精确求解。
+ * 求值不修改对象本身，多个线程可以同时使用同一个CompiledSymMat。
+ *
+ * 构造时还可以指定一组参数：参数不是未知量，求值时取SetParams设置的值，修改参数值不需要重新求导和编译。
+ * SetParams会修改对象，多个线程使用不同的参数值时，每个线程使用自己的副本。
+ */
+class CompiledSymMat {
+public:
+    /**
+     * 编译符号矩阵mat。求值时x[i]为vars[i]的值。
+     * @exception MathError 表达式中出现vars以外的变量
+     */
+    CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars);
+
+    /**
+     * 编译符号矩阵mat。求值时x[i]为vars[i]的值，params[i]的值由SetParams设置，初始为0。
+     * @exception MathError 表达式中出现vars和params以外的变量
+     * @exception MathError vars和params中有重复的名字
+     */
+    CompiledSymMat(const SymMat &mat, const std::vector<std::string> &vars, const std::vector<std::string> &params);
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+    /**
+     * 变量数量，即求值时x的长度。
+     */
+    int VarNums() const noexcept;
+
+    /**
+     * 参数数量。
+     */
+    int ParamNums() const noexcept;
+
+    /**
+     * 设置参数的值，values[i]为构造时params[i]的值。复杂度为O(ParamNums())。
+     */
+    void SetParams(VecView values) noexcept;
+
+    /**
+     * 以标量类型T求值。x的长度为VarNums()，结果按行连续写入out，长度为Rows() * Cols()。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    template <typename T>
+    void Eval(const T *x, T *out) const {
+        if (maxDepth <= INLINE_STACK_SIZE) {
+            T stk[INLINE_STACK_SIZE];
+            Run(x, out, stk);
+        } else {
+            std::vector<T> stk(maxDepth);
+            Run(x, out, stk.data());
+        }
+    }
+
+    /**
+     * 同时对W组自变量求值，用于SIMD批量求解。数据按路交错存放（AoSoA）：x[i * W + l]为第l组的第i个变量，
+     * params[i * W + l]为第l组的第i个参数（不使用SetParams设置的值），结果写入out[e * W + l]。
+     * 每条指令对W组数据连续计算，编译器可以将其向量化。
+     * 不抛出异常：任何一步运算出现浮点数无效值(inf, -inf, nan)的组将invalid[l]置为true，其余组不受影响。
+     */
+    template <int W>
+    void EvalLanes(const double *x, const double *params, double *out, bool *invalid) const {
+        if (maxDepth <= INLINE_STACK_SIZE) {
+            double stk[INLINE_STACK_SIZE * W];
+            RunLanes<W>(x, params, out, invalid, stk);
+        } else {
+            std::vector<double> stk(maxDepth * W);
+            RunLanes<W>(x, params, out, invalid, stk.data());
+        }
+    }
+
+    /**
+     * 以double求值，返回数值矩阵。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    Mat Eval(VecView x) const;
+
+    /**
+     * 以double求值，结果写入out。out的尺寸必须为Rows()×Cols()，尺寸相同时不申请堆内存。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    void Eval(VecView x, Mat &out) const;
+
+    /**
+     * 以options代替Config::Get()，以double求值，返回数值矩阵。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且options.throwOnInvalidValue为true
+     */
+    Mat Eval(VecView x, const SolverOptions &options) const;
+
+private:
+    enum class OpCode { NUMBER, VARIABLE, PARAMETER, UNARY, BINARY };
+
+    struct Instruction {
+        OpCode code;
+        MathOperator op;
+        int index;    // VARIABLE时为变量下标，PARAMETER时为参数下标
+        double value; // NUMBER时为常数
+    };
+
+    static constexpr int INLINE_STACK_SIZE = 64;
+
+    int rows;
+    int cols;
+    int varNums;
+    int maxDepth = 0;
+
+    // 所有元素的指令按行连续存放，第i个元素的指令为[ends[i - 1], ends[i])
+    std::vector<Instruction> program;
+    std::vector<int> ends;
+    std::vector<double> params;
+
+    template <typename T>
+    void Run(const T *x, T *out, T *stk) const {
+        int begin = 0;
+        for (int e = 0; e < static_cast<int>(ends.size()); ++e) {
+            int top = -1;
+            for (int pc = begin; pc < ends[e]; ++pc) {
+                const Instruction &ins = program[pc];
+                switch (ins.code) {
+                case OpCode::NUMBER:
+                    stk[++top] = static_cast<T>(ins.value);
+                    break;
+                case OpCode::VARIABLE:
+                    stk[++top] = x[ins.index];
+                    break;
+                case OpCode::PARAMETER:
+                    stk[++top] = static_cast<T>(params[ins.index]);
+                    break;
+                case OpCode::UNARY:
+                    stk[top] = tomsolver::Calc<T>(ins.op, stk[top], T(0));
+                    break;
+                case OpCode::BINARY:
+                    --top;
+                    stk[top] = tomsolver::Calc<T>(ins.op, stk[top], stk[top + 1]);
+                    break;
+                }
+            }
+            out[e] = stk[0];
+            begin = ends[e];
+        }
+    }
+
+    template <int W>
+    void RunLanes(const double *x, const double *lanesParams, double *out, bool *invalid, double *stk) const {
+        int begin = 0;
+        for (int e = 0; e < static_cast<int>(ends.size()); ++e) {
+            int top = -1;
+            for (int pc = begin; pc < ends[e]; ++pc) {
+                const Instruction &ins = program[pc];
+                switch (ins.code) {
+                case OpCode::NUMBER:
+                    ++top;
+                    std::fill(stk + top * W, stk + (top + 1) * W, ins.value);
+                    break;
+                case OpCode::VARIABLE:
+                    ++top;
+                    std::copy(x + ins.index * W, x + (ins.index + 1) * W, stk + top * W);
+                    break;
+                case OpCode::PARAMETER:
+                    ++top;
+                    std::copy(lanesParams + ins.index * W, lanesParams + (ins.index + 1) * W, stk + top * W);
+                    break;
+                case OpCode::UNARY:
+                    tomsolver::CalcLanes<W>(ins.op, stk + top * W, stk + top * W, invalid);
+                    break;
+                case OpCode::BINARY:
+                    --top;
+                    tomsolver::CalcLanes<W>(ins.op, stk + top * W, stk + (top + 1) * W, invalid);
+                    break;
+                }
+            }
+            std::copy(stk, stk + W, out + e * W);
+            begin = ends[e];
+        }
+    }
+
+    friend class internal::CompileFunctions;
+};
+
+} // namespace tomsolver
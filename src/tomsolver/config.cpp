@@ -42,7 +42,21 @@ void Config::Reset() noexcept {
 
 Config &Config::Get() {
     static Config config;
-    return config;
+    Config *current = Current();
+    return current ? *current : config;
+}
+
+Config *&Config::Current() noexcept {
+    thread_local Config *current = nullptr;
+    return current;
+}
+
+ConfigScope::ConfigScope(const Config &options) noexcept : config(options), previous(Config::Current()) {
+    Config::Current() = &config;
+}
+
+ConfigScope::~ConfigScope() {
+    Config::Current() = previous;
 }
 
 } // namespace tomsolver
\ No newline at end of file
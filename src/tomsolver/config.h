@@ -6,7 +6,11 @@ namespace tomsolver {
 
 enum class LogLevel { OFF, FATAL, ERROR, WARN, INFO, DEBUG, TRACE, ALL };
 
-enum class NonlinearMethod { NEWTON_RAPHSON, LM };
+enum class NonlinearMethod { NEWTON_RAPHSON, LM, DOGLEG, NEWTON_KRYLOV, AUTO };
+
+enum class LineSearchMethod { NONE, ARMIJO, CUBIC };
+
+enum class KrylovMethod { GMRES, BICGSTAB };
 
 struct Config {
     /**
@@ -14,6 +18,9 @@ struct Config {
      */
     bool throwOnInvalidValue = true;
 
+    /**
+     * 判断浮点数相等、矩阵奇异的阈值，也是非线性方程组的绝对残差容差：||F||∞ < epsilon时视为收敛。
+     */
     double epsilon = 1.0e-9;
 
     LogLevel logLevel = LogLevel::WARN;
@@ -23,11 +30,114 @@ struct Config {
      */
     int maxIterations = 100;
 
+    /**
+     * 非线性方程组的相对残差容差：||F||∞ ≤ relativeTolerance·||F0||∞时视为收敛，F0为初值处的残差。
+     * 绝对残差容差即为epsilon。为0时只使用绝对残差容差。
+     */
+    double relativeTolerance = 0;
+
+    /**
+     * 非线性方程组的步长容差：||Δq|| ≤ stepTolerance·(||q|| + stepTolerance)时视为收敛。为0时不按步长判断收敛。
+     */
+    double stepTolerance = 0;
+
+    /**
+     * 发散检测：||F||∞超过初值处的divergenceRatio倍时，抛出ERROR_DIVERGENCE。为0时不检测。
+     */
+    double divergenceRatio = 0;
+
+    /**
+     * 停滞检测：连续stagnationIterations次迭代||F||∞都没有明显下降时，抛出ERROR_STAGNATION。为0时不检测。
+     * 信赖域/LM方法中被拒绝的试探步也计入迭代次数。
+     */
+    int stagnationIterations = 0;
+
     /**
      * 求解方法
      */
     NonlinearMethod nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
 
+    /**
+     * Newton-Raphson方法是否复用雅可比矩阵的LU分解结果（弦方法/简化牛顿法）。
+     * 开启后只有当||phi||的收缩率（本次/上次）大于jacobianRefreshRatio时，才重新计算并分解雅可比矩阵。
+     * 仅对方阵（方程数量等于未知数数量）生效。
+     */
+    bool reuseJacobian = false;
+
+    /**
+     * 复用雅可比矩阵时，触发重新计算雅可比矩阵的||phi||收缩率阈值，取值范围(0, 1)。
+     */
+    double jacobianRefreshRatio = 0.5;
+
+    /**
+     * Newton-Raphson方法是否使用混合精度求解牛顿步：以单精度分解雅可比矩阵，再以双精度残差迭代修正，
+     * 得到与双精度分解相同精度的牛顿步。迭代修正停滞或单精度分解失败时，自动退回双精度分解。仅对方阵生效。
+     */
+    bool mixedPrecision = false;
+
+    /**
+     * 非线性方程组求解时，是否对雅可比矩阵做行列平衡（见Equilibration），即按数量级缩放方程与未知量。
+     * 用于量纲、数量级差异很大的方程组，避免主元的绝对阈值造成误判奇异。缩放因子由初值处的雅可比矩阵确定。
+     * 仅对方阵生效：方程数量不等于未知数数量时，缩放会改变最小二乘解或最小范数解。
+     * SolveByNewtonKrylov不构造雅可比矩阵，不做行列平衡，可以通过预条件子达到同样的效果。
+     * 缩放会改变迭代过程中的舍入误差与主元选择，默认关闭，保持原有方程组的迭代结果不变。
+     */
+    bool equilibrate = false;
+
+    /**
+     * 行列平衡开启时，是否在每次重新计算雅可比矩阵时更新缩放因子。关闭时始终使用初值处的缩放因子。
+     */
+    bool updateEquilibration = false;
+
+    /**
+     * 混合精度求解时，每次求解允许的最大修正次数。超过后退回双精度分解。
+     */
+    int maxRefinementIterations = 10;
+
+    /**
+     * Newton-Raphson方法和Newton-Krylov方法沿牛顿方向的一维搜索方法。默认为NONE，即每次都走完整的牛顿步。
+     * 完整的牛顿步使||phi||增大或者超出定义域时，可以选择ARMIJO（回溯减半）或CUBIC（插值回溯）。
+     */
+    LineSearchMethod lineSearch = LineSearchMethod::NONE;
+
+    /**
+     * Newton-Krylov方法求解每个牛顿步所用的Krylov子空间方法。BICGSTAB的内存为O(n)，与krylovRestart无关。
+     */
+    KrylovMethod krylovMethod = KrylovMethod::GMRES;
+
+    /**
+     * Newton-Krylov方法中GMRES的重启长度，即重启前保存的Krylov子空间基向量数量。内存占用约为未知数数量的这么多倍。
+     */
+    int krylovRestart = 30;
+
+    /**
+     * Newton-Krylov方法求解每个牛顿步J·Δq = -F的相对精度，即要求||J·Δq + F|| <= krylovTolerance * ||F||。
+     * eisenstatWalker为true时，Newton-Krylov方法不使用这个值。LM方法使用共轭梯度法时也使用这个精度。
+     */
+    double krylovTolerance = 1.0e-6;
+
+    /**
+     * Newton-Krylov方法是否按Eisenstat-Walker方法选取每个牛顿步的相对精度（forcing term）：
+     * 离解较远时只粗略求解，||F||下降越快要求越高，避免前几次迭代过度求解线性方程组。
+     */
+    bool eisenstatWalker = true;
+
+    /**
+     * Newton-Krylov方法中，每个牛顿步最多的GMRES迭代次数。
+     */
+    int maxKrylovIterations = 1000;
+
+    /**
+     * LM方法是否用Jacobi预条件共轭梯度法求解阻尼方程(JᵀJ + μD²)h = -JᵀF。
+     * 开启后不构造和分解JᵀJ，每次迭代只需要J和Jᵀ各乘一次向量，适合未知数很多的情况。
+     */
+    bool lmConjugateGradient = false;
+
+    /**
+     * SolveFixedPoint使用的Anderson加速深度，即最多保留的历史残差数量。为0时退化为普通的不动点迭代x = G(x)。
+     */
+    int andersonDepth = 5;
+
     /**
      * 非线性方程求解时，当没有为VarsTable传初值时，设定的初值
      */
@@ -42,7 +152,40 @@ struct Config {
 
     void Reset() noexcept;
 
+    /**
+     * 当前线程使用的配置：在ConfigScope的作用域内为该作用域的选项，否则为进程全局的默认配置。
+     * 全局配置只应在没有其他线程求解时修改。需要在多个线程中同时使用不同的配置时，把SolverOptions传给各个函数。
+     */
     static Config &Get();
+
+private:
+    static Config *&Current() noexcept;
+
+    friend class ConfigScope;
+};
+
+/**
+ * 单次调用的求解选项，字段与Config相同。传给Solve、SolveLinear、Vpa等函数后只在这次调用中生效，
+ * 既不读取也不修改全局配置，因此多个线程可以同时使用各自的选项。
+ */
+using SolverOptions = Config;
+
+/**
+ * 在作用域内让当前线程的Config::Get()返回options的副本，析构时恢复。其他线程不受影响，可以嵌套。
+ */
+class ConfigScope {
+public:
+    explicit ConfigScope(const Config &options) noexcept;
+
+    ~ConfigScope();
+
+    ConfigScope(const ConfigScope &) = delete;
+
+    ConfigScope &operator=(const ConfigScope &) = delete;
+
+private:
+    Config config;
+    Config *previous;
 };
 
 std::string ToString(double value) noexcept;
@@ -0,0 +1,75 @@
+#include "convergence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace tomsolver {
+
+bool ConvergenceMonitor::Check(int it, VecView F) {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+        throw MathError(ErrorType::ERROR_CANCELLED, "iteration " + std::to_string(it));
+    }
+
+    double FNorm = InfNorm(F);
+    if (!started) {
+        started = true;
+        F0Norm = best = FNorm;
+        tolerance = std::max(Config::Get().epsilon, Config::Get().relativeTolerance * F0Norm);
+    }
+
+    if (FNorm < Config::Get().epsilon || FNorm <= Config::Get().relativeTolerance * F0Norm) {
+        return true;
+    }
+
+    double divergenceRatio = Config::Get().divergenceRatio;
+    if (divergenceRatio > 0 && !(FNorm <= divergenceRatio * F0Norm)) {
+        std::stringstream ss;
+        ss << "iteration " << it << ", ||F|| = " << FNorm << ", initial ||F|| = " << F0Norm;
+        throw MathError(ErrorType::ERROR_DIVERGENCE, ss.str());
+    }
+
+    if (FNorm < (1 - STAGNATION_DECREASE) * best) {
+        best = FNorm;
+        sinceBest = 0;
+        return false;
+    }
+    best = std::min(best, FNorm);
+    ++sinceBest;
+
+    int stagnationIterations = Config::Get().stagnationIterations;
+    if (stagnationIterations > 0 && sinceBest >= stagnationIterations) {
+        std::stringstream ss;
+        ss << "iteration " << it << ", ||F|| = " << FNorm << ", no progress in " << sinceBest << " iterations";
+        throw MathError(ErrorType::ERROR_STAGNATION, ss.str());
+    }
+    return false;
+}
+
+bool ConvergenceMonitor::StepConverged(double stepNorm, double qNorm) const noexcept {
+    double stepTolerance = Config::Get().stepTolerance;
+    return stepTolerance > 0 && stepNorm <= stepTolerance * (qNorm + stepTolerance);
+}
+
+void ConvergenceMonitor::SetCancelFlag(const std::atomic<bool> *cancelled) noexcept {
+    this->cancelled = cancelled;
+}
+
+double ConvergenceMonitor::Tolerance() const noexcept {
+    return tolerance;
+}
+
+double InfNorm(VecView v) noexcept {
+    double ret = 0;
+    for (int i = 0; i < v.Size(); ++i) {
+        double a = std::abs(v[i]);
+        if (std::isnan(a)) {
+            return a;
+        }
+        ret = std::max(ret, a);
+    }
+    return ret;
+}
+
+} // namespace tomsolver
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "config.h"
+#include "error_type.h"
+#include "mat_view.h"
+
+#include <atomic>
+
+namespace tomsolver {
+
+/**
+ * 非线性迭代的收敛判断与失败检测，供各个求解器共用。
+ * 收敛条件（满足其一即可）：
+ *  - 残差：||F||∞ < Config::Get().epsilon，或||F||∞ ≤ Config::Get().relativeTolerance·||F0||∞，F0为初值处的残差；
+ *  - 步长：||Δq|| ≤ Config::Get().stepTolerance·(||q|| + Config::Get().stepTolerance)。
+ * 失败检测（默认关闭）：
+ *  - 发散：||F||∞ > Config::Get().divergenceRatio·||F0||∞；
+ *  - 停滞：连续Config::Get().stagnationIterations次迭代，||F||∞都没有比之前的最小值下降STAGNATION_DECREASE以上。
+ * 失败时抛出MathError，调用者可以据此尽早放弃没有希望的初值，而不是一直迭代到Config::Get().maxIterations。
+ */
+class ConvergenceMonitor {
+public:
+    /**
+     * 判断停滞时，||F||∞相对于之前最小值的最小下降比例。
+     */
+    static constexpr double STAGNATION_DECREASE = 1.0e-3;
+
+    ConvergenceMonitor() noexcept = default;
+
+    /**
+     * 记录第it次迭代的残差F，返回是否满足残差收敛条件。第一次调用时的F即为F0。
+     * 未收敛时检测发散与停滞，应在计算下一步之前调用。
+     * @exception MathError 发散(ERROR_DIVERGENCE)、停滞(ERROR_STAGNATION)或被取消(ERROR_CANCELLED)
+     */
+    bool Check(int it, VecView F);
+
+    /**
+     * 步长是否满足收敛条件。stepNorm为这一步的||Δq||，qNorm为走完这一步之后的||q||。stepTolerance为0时总是返回false。
+     */
+    bool StepConverged(double stepNorm, double qNorm) const noexcept;
+
+    /**
+     * 设置取消标志。之后每次调用Check时，如果*cancelled为true，抛出ERROR_CANCELLED，用于从其他线程中止求解。
+     * 为nullptr时不检查。
+     */
+    void SetCancelFlag(const std::atomic<bool> *cancelled) noexcept;
+
+    /**
+     * 残差的收敛阈值，即max(epsilon, relativeTolerance·||F0||∞)。第一次调用Check之后有效。
+     */
+    double Tolerance() const noexcept;
+
+private:
+    const std::atomic<bool> *cancelled = nullptr;
+    bool started = false;
+    double F0Norm = 0;
+    double tolerance = 0;
+    double best = 0;   // 目前为止||F||∞的最小值
+    int sinceBest = 0; // best上一次明显下降之后的迭代次数
+};
+
+/**
+ * 无穷范数max|v[i]|。存在nan时返回nan。
+ */
+double InfNorm(VecView v) noexcept;
+
+} // namespace tomsolver
@@ -54,6 +54,18 @@ std::string GetErrorInfo(ErrorType err) {
         break;
     case ErrorType::SIZE_NOT_MATCH:
         return u8"size does not match";
+        break;
+    case ErrorType::ERROR_DIVERGENCE:
+        return u8"iteration diverged";
+        break;
+    case ErrorType::ERROR_STAGNATION:
+        return u8"iteration stagnated";
+        break;
+    case ErrorType::ERROR_CANCELLED:
+        return u8"cancelled";
+        break;
+    case ErrorType::ERROR_ITERATION_LIMIT:
+        return u8"iteration limit exceeded";
     default:
         assert(0);
         break;
@@ -21,7 +21,11 @@ enum class ErrorType {
     ERROR_SINGULAR_MATRIX,               // 矩阵奇异
     ERROR_INFINITY_SOLUTIONS,            // 无穷多解
     ERROR_OVER_DETERMINED_EQUATIONS,     // 方程组过定义
-    SIZE_NOT_MATCH                       // 维数不匹配
+    SIZE_NOT_MATCH,                      // 维数不匹配
+    ERROR_DIVERGENCE,                    // 迭代发散
+    ERROR_STAGNATION,                    // 迭代停滞
+    ERROR_CANCELLED,                     // 求解被取消
+    ERROR_ITERATION_LIMIT                // 迭代次数超出限制
 };
 
 std::string GetErrorInfo(ErrorType err);
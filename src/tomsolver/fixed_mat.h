@@ -0,0 +1,366 @@
+#pragma once
+
+#include "config.h"
+#include "error_type.h"
+#include "mat.h"
+#include "mat_view.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <initializer_list>
+
+namespace tomsolver {
+
+/**
+ * 尺寸在编译期确定的N×M矩阵。数据按行连续存放在对象内部（栈上），构造、复制和运算都不申请堆内存。
+ * 用于2×2～6×6这类小规模方程组：循环次数都是编译期常量，编译器可以完全展开。
+ * FixedMat之间的+、-和数乘结果仍是FixedMat；与Mat/Vec/视图混合运算时结果为Mat。
+ * FixedMat也是矩阵表达式，视图等表达式可以直接赋值给FixedMat。
+ */
+template <int N, int M>
+class FixedMat : public MatExpr<FixedMat<N, M>> {
+    static_assert(N > 0 && M > 0, "FixedMat size must be positive");
+
+public:
+    FixedMat() noexcept : data{} {}
+
+    explicit FixedMat(double initValue) noexcept {
+        data.fill(initValue);
+    }
+
+    FixedMat(std::initializer_list<std::initializer_list<double>> init) noexcept : data{} {
+        assert(static_cast<int>(init.size()) == N);
+        int i = 0;
+        for (auto &row : init) {
+            assert(static_cast<int>(row.size()) <= M);
+            std::copy(row.begin(), row.end(), data.begin() + i * M);
+            ++i;
+        }
+    }
+
+    /**
+     * 按行连续存储的顺序给出全部元素。主要用于FixedVec。
+     */
+    FixedMat(std::initializer_list<double> init) noexcept : data{} {
+        assert(static_cast<int>(init.size()) == N * M);
+        std::copy(init.begin(), init.end(), data.begin());
+    }
+
+    explicit FixedMat(const Mat &mat) noexcept : FixedMat(MatView(mat)) {}
+
+    /**
+     * 对表达式求值。表达式的尺寸必须是N×M。
+     */
+    template <typename E>
+    FixedMat(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == N);
+        assert(expr.Cols() == M);
+        expr.EvalTo(data.data());
+    }
+
+    template <typename E>
+    FixedMat &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == N);
+        assert(expr.Cols() == M);
+        expr.EvalTo(data.data());
+        return *this;
+    }
+
+    static constexpr int Rows() noexcept {
+        return N;
+    }
+
+    static constexpr int Cols() noexcept {
+        return M;
+    }
+
+    double Value(int i, int j) const noexcept {
+        return data[i * M + j];
+    }
+
+    double &Value(int i, int j) noexcept {
+        return data[i * M + j];
+    }
+
+    /**
+     * 按行连续存储的顺序访问第i个元素。对FixedVec即为第i个分量。
+     */
+    double operator[](int i) const noexcept {
+        return data[i];
+    }
+
+    double &operator[](int i) noexcept {
+        return data[i];
+    }
+
+    double Coeff(int i) const noexcept {
+        return data[i];
+    }
+
+    const double *Data() const noexcept {
+        return data.data();
+    }
+
+    double *Data() noexcept {
+        return data.data();
+    }
+
+    FixedMat &operator+=(const FixedMat &b) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] += b.data[i];
+        }
+        return *this;
+    }
+
+    FixedMat &operator-=(const FixedMat &b) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] -= b.data[i];
+        }
+        return *this;
+    }
+
+    FixedMat &operator*=(double k) noexcept {
+        for (int i = 0; i < N * M; ++i) {
+            data[i] *= k;
+        }
+        return *this;
+    }
+
+    FixedMat<M, N> Transpose() const noexcept {
+        FixedMat<M, N> ans;
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < M; ++j) {
+                ans.Value(j, i) = Value(i, j);
+            }
+        }
+        return ans;
+    }
+
+    bool operator==(const FixedMat &b) const noexcept {
+        double eps = Config::Get().epsilon;
+        for (int i = 0; i < N * M; ++i) {
+            if (!(std::abs(data[i] - b.data[i]) < eps)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 返回是否所有元素的绝对值都小于Config::Get().epsilon。
+     */
+    bool operator==(double m) const noexcept {
+        double eps = Config::Get().epsilon;
+        for (int i = 0; i < N * M; ++i) {
+            if (!(std::abs(data[i] - m) < eps)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Mat ToMat() const noexcept {
+        return Mat(*this);
+    }
+
+private:
+    std::array<double, N * M> data;
+};
+
+template <int N>
+using FixedVec = FixedMat<N, 1>;
+
+template <int N, int M>
+FixedMat<N, M> operator+(FixedMat<N, M> a, const FixedMat<N, M> &b) noexcept {
+    a += b;
+    return a;
+}
+
+template <int N, int M>
+FixedMat<N, M> operator-(FixedMat<N, M> a, const FixedMat<N, M> &b) noexcept {
+    a -= b;
+    return a;
+}
+
+template <int N, int M>
+FixedMat<N, M> operator*(FixedMat<N, M> m, double k) noexcept {
+    m *= k;
+    return m;
+}
+
+template <int N, int M>
+FixedMat<N, M> operator*(double k, FixedMat<N, M> m) noexcept {
+    m *= k;
+    return m;
+}
+
+// be negative
+template <int N, int M>
+FixedMat<N, M> operator-(FixedMat<N, M> m) noexcept {
+    m *= -1;
+    return m;
+}
+
+/**
+ * 矩阵乘法。
+ */
+template <int N, int M, int K>
+FixedMat<N, K> operator*(const FixedMat<N, M> &a, const FixedMat<M, K> &b) noexcept {
+    FixedMat<N, K> ans;
+    for (int i = 0; i < N; ++i) {
+        for (int p = 0; p < M; ++p) {
+            double v = a.Value(i, p);
+            for (int j = 0; j < K; ++j) {
+                ans.Value(i, j) += v * b.Value(p, j);
+            }
+        }
+    }
+    return ans;
+}
+
+template <int N, int M>
+std::ostream &operator<<(std::ostream &out, const FixedMat<N, M> &mat) noexcept {
+    return out << mat.ToMat();
+}
+
+/**
+ * N阶方阵的LU分解（列主元），PA = LU。分解结果原地存放在FixedMat中，不申请堆内存。
+ */
+template <int N>
+class FixedLUFactorization {
+public:
+    FixedLUFactorization() noexcept = default;
+
+    /**
+     * 构造并立即分解方阵A。
+     * @exception MathError 奇异矩阵
+     */
+    explicit FixedLUFactorization(const FixedMat<N, N> &A) {
+        Factor(A);
+    }
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(const FixedMat<N, N> &A) {
+        factored = false;
+        lu = A;
+        double eps = Config::Get().epsilon;
+        for (int k = 0; k < N; ++k) {
+            int maxAbsRowIndex = k;
+            double maxAbs = std::abs(lu.Value(k, k));
+            for (int i = k + 1; i < N; ++i) {
+                if (std::abs(lu.Value(i, k)) > maxAbs) {
+                    maxAbs = std::abs(lu.Value(i, k));
+                    maxAbsRowIndex = i;
+                }
+            }
+
+            pivots[k] = maxAbsRowIndex;
+            if (maxAbs < eps) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+            }
+
+            if (maxAbsRowIndex != k) {
+                for (int j = 0; j < N; ++j) {
+                    std::swap(lu.Value(k, j), lu.Value(maxAbsRowIndex, j));
+                }
+            }
+
+            double pivot = lu.Value(k, k);
+            for (int i = k + 1; i < N; ++i) {
+                double ratio = lu.Value(i, k) /= pivot;
+                for (int j = k + 1; j < N; ++j) {
+                    lu.Value(i, j) -= ratio * lu.Value(k, j);
+                }
+            }
+        }
+        factored = true;
+    }
+
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     */
+    FixedVec<N> Solve(FixedVec<N> b) const noexcept {
+        assert(factored);
+        for (int k = 0; k < N; ++k) {
+            std::swap(b[k], b[pivots[k]]);
+        }
+        for (int i = 1; i < N; ++i) {
+            for (int j = 0; j < i; ++j) {
+                b[i] -= lu.Value(i, j) * b[j];
+            }
+        }
+        for (int i = N - 1; i >= 0; --i) {
+            for (int j = i + 1; j < N; ++j) {
+                b[i] -= lu.Value(i, j) * b[j];
+            }
+            b[i] /= lu.Value(i, i);
+        }
+        return b;
+    }
+
+    bool IsFactored() const noexcept {
+        return factored;
+    }
+
+private:
+    bool factored = false;
+    FixedMat<N, N> lu;
+    std::array<int, N> pivots{};
+};
+
+namespace internal {
+
+/**
+ * 按N选择求解方法：一般情况使用LU分解，一元、二元的情况使用闭式解。
+ */
+template <int N>
+struct FixedLinearSolver {
+    static FixedVec<N> Solve(const FixedMat<N, N> &A, const FixedVec<N> &b) {
+        return FixedLUFactorization<N>(A).Solve(b);
+    }
+};
+
+template <>
+struct FixedLinearSolver<1> {
+    static FixedVec<1> Solve(const FixedMat<1, 1> &A, const FixedVec<1> &b) {
+        if (std::abs(A[0]) < Config::Get().epsilon) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        return {b[0] / A[0]};
+    }
+};
+
+/**
+ * 克莱姆法则。奇异判断与列主元LU分解一致：det / maxAbs即为消元后的第二个主元。
+ */
+template <>
+struct FixedLinearSolver<2> {
+    static FixedVec<2> Solve(const FixedMat<2, 2> &A, const FixedVec<2> &b) {
+        double a = A.Value(0, 0), c = A.Value(1, 0);
+        double maxAbs = std::max(std::abs(a), std::abs(c));
+        double det = a * A.Value(1, 1) - A.Value(0, 1) * c;
+        double eps = Config::Get().epsilon;
+        if (maxAbs < eps || std::abs(det) < eps * maxAbs) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        return {(b[0] * A.Value(1, 1) - A.Value(0, 1) * b[1]) / det, (a * b[1] - c * b[0]) / det};
+    }
+};
+
+} // namespace internal
+
+/**
+ * 求解N元线性方程组Ax = b。N在编译期确定，不申请堆内存：一元、二元直接求闭式解，其余使用展开的LU分解。
+ * @exception MathError 奇异矩阵
+ */
+template <int N>
+FixedVec<N> SolveLinear(const FixedMat<N, N> &A, const FixedVec<N> &b) {
+    return internal::FixedLinearSolver<N>::Solve(A, b);
+}
+
+} // namespace tomsolver
@@ -0,0 +1,643 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TOMSOLVER_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC和Clang需要为使用了对应指令集的函数单独指定target，MSVC不需要
+#if defined(__GNUC__) || defined(__clang__)
+#define TOMSOLVER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TOMSOLVER_TARGET(isa)
+#endif
+
+namespace tomsolver {
+
+namespace internal {
+
+namespace {
+
+// 分块大小：A的MC×KC子块和B的KC×NC子块在计算过程中常驻缓存
+constexpr int GEMM_MC = 64;
+constexpr int GEMM_KC = 256;
+constexpr int GEMM_NC = 128;
+
+// AᵀA按NB×NB分块计算，保证C的子块常驻缓存
+constexpr int SYRK_NB = 128;
+
+/*
+ * 标量实现。
+ */
+
+double DotScalar(int n, const double *x, const double *y) noexcept {
+    double ret = 0;
+    for (int i = 0; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
+}
+
+double AbsMaxScalar(int n, const double *x) noexcept {
+    double ret = 0;
+    for (int i = 0; i < n; ++i) {
+        double a = std::abs(x[i]);
+        if (std::isnan(a)) {
+            return a;
+        }
+        ret = std::max(ret, a);
+    }
+    return ret;
+}
+
+void ScaledAddScalar(int n, const double *x, double alpha, const double *y, double *out) noexcept {
+    for (int i = 0; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+bool AllAbsLessScalar(int n, const double *x, double tol) noexcept {
+    for (int i = 0; i < n; ++i) {
+        if (!(std::abs(x[i]) < tol)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AllAbsDiffLessScalar(int n, const double *x, const double *y, double tol) noexcept {
+    for (int i = 0; i < n; ++i) {
+        if (!(std::abs(x[i] - y[i]) < tol)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 4行×8列的寄存器分块：C(4×8) += A(4×k) * B(k×8)。
+ */
+void GemmMicroKernel4x8Scalar(int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc) noexcept {
+    double c[4][8];
+    for (int r = 0; r < 4; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            c[r][j] = C[r * ldc + j];
+        }
+    }
+    for (int p = 0; p < k; ++p) {
+        const double *b = B + p * ldb;
+        for (int r = 0; r < 4; ++r) {
+            double a = A[r * lda + p];
+            for (int j = 0; j < 8; ++j) {
+                c[r][j] += a * b[j];
+            }
+        }
+    }
+    for (int r = 0; r < 4; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            C[r * ldc + j] = c[r][j];
+        }
+    }
+}
+
+#if defined(TOMSOLVER_KERNELS_X86)
+
+/**
+ * 合并SIMD整块部分和剩余尾部的AbsMax结果，尾部出现nan时返回nan。
+ */
+double CombineAbsMax(double head, double tail) noexcept {
+    return std::isnan(tail) ? tail : std::max(head, tail);
+}
+
+/*
+ * SSE2实现。每次处理2个double。
+ */
+
+TOMSOLVER_TARGET("sse2") double DotSse2(int n, const double *x, const double *y) noexcept {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    double ret = _mm_cvtsd_f64(_mm_add_sd(s0, _mm_unpackhi_pd(s0, s0)));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
+}
+
+TOMSOLVER_TARGET("sse2") double AbsMaxSse2(int n, const double *x) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d m = _mm_setzero_pd();
+    __m128d nan = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        m = _mm_max_pd(m, _mm_andnot_pd(sign, v));
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+    }
+    if (_mm_movemask_pd(nan)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double ret = _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
+}
+
+TOMSOLVER_TARGET("sse2") void ScaledAddSse2(int n, const double *x, double alpha, const double *y,
+                                            double *out) noexcept {
+    const __m128d a = _mm_set1_pd(alpha);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(a, _mm_loadu_pd(y + i))));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+TOMSOLVER_TARGET("sse2") bool AllAbsLessSse2(int n, const double *x, double tol) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d t = _mm_set1_pd(tol);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        if (_mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, _mm_loadu_pd(x + i)), t)) != 0x3) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
+}
+
+TOMSOLVER_TARGET("sse2") bool AllAbsDiffLessSse2(int n, const double *x, const double *y, double tol) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d t = _mm_set1_pd(tol);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d d = _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i));
+        if (_mm_movemask_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, d), t)) != 0x3) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
+}
+
+/*
+ * AVX2 + FMA实现。每次处理4个double。
+ */
+
+TOMSOLVER_TARGET("avx2,fma") double DotAvx2(int n, const double *x, const double *y) noexcept {
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+    }
+    s0 = _mm256_add_pd(s0, s1);
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    double ret = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
+}
+
+TOMSOLVER_TARGET("avx2,fma") double AbsMaxAvx2(int n, const double *x) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d m = _mm256_setzero_pd();
+    __m256d nan = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(x + i);
+        m = _mm256_max_pd(m, _mm256_andnot_pd(sign, v));
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    }
+    if (_mm256_movemask_pd(nan)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    __m128d h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+    double ret = _mm_cvtsd_f64(_mm_max_sd(h, _mm_unpackhi_pd(h, h)));
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
+}
+
+TOMSOLVER_TARGET("avx2,fma") void ScaledAddAvx2(int n, const double *x, double alpha, const double *y,
+                                                double *out) noexcept {
+    const __m256d a = _mm256_set1_pd(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+TOMSOLVER_TARGET("avx2,fma") bool AllAbsLessAvx2(int n, const double *x, double tol) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d t = _mm256_set1_pd(tol);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d lt = _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_loadu_pd(x + i)), t, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(lt) != 0xF) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
+}
+
+TOMSOLVER_TARGET("avx2,fma") bool AllAbsDiffLessAvx2(int n, const double *x, const double *y, double tol) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d t = _mm256_set1_pd(tol);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, d), t, _CMP_LT_OQ)) != 0xF) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
+}
+
+/**
+ * 4行×8列的寄存器分块：C(4×8) += A(4×k) * B(k×8)。C的4×8子块累加在8个ymm寄存器中。
+ */
+TOMSOLVER_TARGET("avx2,fma") void GemmMicroKernel4x8Avx2(int k, const double *A, int lda, const double *B, int ldb,
+                                                         double *C, int ldc) noexcept {
+    __m256d c[4][2];
+    for (int r = 0; r < 4; ++r) {
+        c[r][0] = _mm256_loadu_pd(C + r * ldc);
+        c[r][1] = _mm256_loadu_pd(C + r * ldc + 4);
+    }
+    for (int p = 0; p < k; ++p) {
+        __m256d b0 = _mm256_loadu_pd(B + p * ldb);
+        __m256d b1 = _mm256_loadu_pd(B + p * ldb + 4);
+        for (int r = 0; r < 4; ++r) {
+            __m256d a = _mm256_broadcast_sd(A + r * lda + p);
+            c[r][0] = _mm256_fmadd_pd(a, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_pd(a, b1, c[r][1]);
+        }
+    }
+    for (int r = 0; r < 4; ++r) {
+        _mm256_storeu_pd(C + r * ldc, c[r][0]);
+        _mm256_storeu_pd(C + r * ldc + 4, c[r][1]);
+    }
+}
+
+/*
+ * AVX-512实现。每次处理8个double。
+ */
+
+TOMSOLVER_TARGET("avx512f") double DotAvx512(int n, const double *x, const double *y) noexcept {
+    __m512d s = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s);
+    }
+    // 不使用_mm512_reduce_add_pd：GCC在优化时会对其内部实现误报未初始化
+    double buf[8];
+    _mm512_storeu_pd(buf, s);
+    double ret = ((buf[0] + buf[1]) + (buf[2] + buf[3])) + ((buf[4] + buf[5]) + (buf[6] + buf[7]));
+    for (; i < n; ++i) {
+        ret += x[i] * y[i];
+    }
+    return ret;
+}
+
+TOMSOLVER_TARGET("avx512f") double AbsMaxAvx512(int n, const double *x) noexcept {
+    __m512d m = _mm512_setzero_pd();
+    __mmask8 nan = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d v = _mm512_loadu_pd(x + i);
+        // 同上，使用带掩码的版本
+        m = _mm512_mask_max_pd(m, 0xFF, m, _mm512_abs_pd(v));
+        nan |= _mm512_cmp_pd_mask(v, v, _CMP_UNORD_Q);
+    }
+    if (nan) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double buf[8];
+    _mm512_storeu_pd(buf, m);
+    double ret = *std::max_element(buf, buf + 8);
+    return CombineAbsMax(ret, AbsMaxScalar(n - i, x + i));
+}
+
+TOMSOLVER_TARGET("avx512f") void ScaledAddAvx512(int n, const double *x, double alpha, const double *y,
+                                                 double *out) noexcept {
+    const __m512d a = _mm512_set1_pd(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(out + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i)));
+    }
+    for (; i < n; ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+TOMSOLVER_TARGET("avx512f") bool AllAbsLessAvx512(int n, const double *x, double tol) noexcept {
+    const __m512d t = _mm512_set1_pd(tol);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (_mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_loadu_pd(x + i)), t, _CMP_LT_OQ) != 0xFF) {
+            return false;
+        }
+    }
+    return AllAbsLessScalar(n - i, x + i, tol);
+}
+
+TOMSOLVER_TARGET("avx512f") bool AllAbsDiffLessAvx512(int n, const double *x, const double *y, double tol) noexcept {
+    const __m512d t = _mm512_set1_pd(tol);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d d = _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        if (_mm512_cmp_pd_mask(_mm512_abs_pd(d), t, _CMP_LT_OQ) != 0xFF) {
+            return false;
+        }
+    }
+    return AllAbsDiffLessScalar(n - i, x + i, y + i, tol);
+}
+
+#if defined(_MSC_VER)
+/**
+ * 通过cpuid和xgetbv检测CPU和操作系统同时支持的指令集。
+ */
+TOMSOLVER_TARGET("xsave") SimdLevel DetectSimdLevel() noexcept {
+    int info[4];
+    __cpuid(info, 0);
+    int maxId = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    bool avx2 = false;
+    bool avx512f = false;
+    if (maxId >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512f = (info[1] & (1 << 16)) != 0;
+    }
+
+    // 操作系统需要保存ymm/zmm寄存器的状态
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osYmm = (xcr0 & 0x6) == 0x6;
+    bool osZmm = (xcr0 & 0xE6) == 0xE6;
+
+    if (avx512f && osZmm) {
+        return SimdLevel::AVX512;
+    }
+    if (avx2 && fma && osYmm) {
+        return SimdLevel::AVX2;
+    }
+    return sse2 ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+}
+#else
+/**
+ * 检测CPU和操作系统同时支持的指令集。
+ */
+SimdLevel DetectSimdLevel() noexcept {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+}
+#endif
+
+#else
+
+SimdLevel DetectSimdLevel() noexcept {
+    return SimdLevel::SCALAR;
+}
+
+#endif
+
+/**
+ * 按指令集选出的一组内核。
+ */
+struct Kernels {
+    SimdLevel level;
+    double (*dot)(int, const double *, const double *);
+    double (*absMax)(int, const double *);
+    void (*scaledAdd)(int, const double *, double, const double *, double *);
+    bool (*allAbsLess)(int, const double *, double);
+    bool (*allAbsDiffLess)(int, const double *, const double *, double);
+    void (*gemmMicroKernel4x8)(int, const double *, int, const double *, int, double *, int);
+};
+
+const Kernels SCALAR_KERNELS{SimdLevel::SCALAR,   DotScalar,           AbsMaxScalar, ScaledAddScalar, AllAbsLessScalar,
+                             AllAbsDiffLessScalar, GemmMicroKernel4x8Scalar};
+
+#if defined(TOMSOLVER_KERNELS_X86)
+const Kernels SSE2_KERNELS{SimdLevel::SSE2,   DotSse2,           AbsMaxSse2, ScaledAddSse2, AllAbsLessSse2,
+                           AllAbsDiffLessSse2, GemmMicroKernel4x8Scalar};
+
+const Kernels AVX2_KERNELS{SimdLevel::AVX2,   DotAvx2,           AbsMaxAvx2, ScaledAddAvx2, AllAbsLessAvx2,
+                           AllAbsDiffLessAvx2, GemmMicroKernel4x8Avx2};
+
+const Kernels AVX512_KERNELS{SimdLevel::AVX512,   DotAvx512,           AbsMaxAvx512, ScaledAddAvx512, AllAbsLessAvx512,
+                             AllAbsDiffLessAvx512, GemmMicroKernel4x8Avx2};
+#endif
+
+const Kernels *SelectKernels(SimdLevel level) noexcept {
+#if defined(TOMSOLVER_KERNELS_X86)
+    switch (level) {
+    case SimdLevel::AVX512:
+        return &AVX512_KERNELS;
+    case SimdLevel::AVX2:
+        return &AVX2_KERNELS;
+    case SimdLevel::SSE2:
+        return &SSE2_KERNELS;
+    case SimdLevel::SCALAR:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return &SCALAR_KERNELS;
+}
+
+/**
+ * CPU和操作系统支持的最高指令集，只检测一次。
+ */
+SimdLevel SupportedSimdLevel() noexcept {
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+std::atomic<const Kernels *> &CurrentKernels() noexcept {
+    static std::atomic<const Kernels *> current{SelectKernels(SupportedSimdLevel())};
+    return current;
+}
+
+const Kernels &GetKernels() noexcept {
+    return *CurrentKernels().load(std::memory_order_relaxed);
+}
+
+/**
+ * 不足一个寄存器分块的边缘部分：C(mr×nr) += A(mr×k) * B(k×nr)。
+ */
+void GemmEdge(int mr, int nr, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc) noexcept {
+    for (int r = 0; r < mr; ++r) {
+        double *c = C + r * ldc;
+        for (int p = 0; p < k; ++p) {
+            double a = A[r * lda + p];
+            const double *b = B + p * ldb;
+            for (int j = 0; j < nr; ++j) {
+                c[j] += a * b[j];
+            }
+        }
+    }
+}
+
+} // namespace
+
+SimdLevel GetSimdLevel() noexcept {
+    return GetKernels().level;
+}
+
+SimdLevel SetSimdLevel(SimdLevel level) noexcept {
+    level = std::min(level, SupportedSimdLevel());
+    CurrentKernels().store(SelectKernels(level), std::memory_order_relaxed);
+    return level;
+}
+
+double Dot(int n, const double *x, const double *y) noexcept {
+    return GetKernels().dot(n, x, y);
+}
+
+double AbsMax(int n, const double *x) noexcept {
+    return GetKernels().absMax(n, x);
+}
+
+void ScaledAdd(int n, const double *x, double alpha, const double *y, double *out) noexcept {
+    GetKernels().scaledAdd(n, x, alpha, y, out);
+}
+
+bool AllAbsLess(int n, const double *x, double tol) noexcept {
+    return GetKernels().allAbsLess(n, x, tol);
+}
+
+bool AllAbsDiffLess(int n, const double *x, const double *y, double tol) noexcept {
+    return GetKernels().allAbsDiffLess(n, x, y, tol);
+}
+
+void Gemm(int m, int n, int k, const double *A, const double *B, double *C) noexcept {
+    std::fill(C, C + m * n, 0.0);
+
+    auto microKernel = GetKernels().gemmMicroKernel4x8;
+
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        int nc = std::min(GEMM_NC, n - jc);
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            int kc = std::min(GEMM_KC, k - pc);
+            for (int ic = 0; ic < m; ic += GEMM_MC) {
+                int mc = std::min(GEMM_MC, m - ic);
+
+                const double *a = A + ic * k + pc;
+                const double *b = B + pc * n + jc;
+                double *c = C + ic * n + jc;
+
+                int i = 0;
+                for (; i + 4 <= mc; i += 4) {
+                    int j = 0;
+                    for (; j + 8 <= nc; j += 8) {
+                        microKernel(kc, a + i * k, k, b + j, n, c + i * n + j, n);
+                    }
+                    if (j < nc) {
+                        GemmEdge(4, nc - j, kc, a + i * k, k, b + j, n, c + i * n + j, n);
+                    }
+                }
+                if (i < mc) {
+                    GemmEdge(mc - i, nc, kc, a + i * k, k, b, n, c + i * n, n);
+                }
+            }
+        }
+    }
+}
+
+void SyrkTranspose(int m, int n, const double *A, double *C) noexcept {
+    std::fill(C, C + n * n, 0.0);
+
+    // 只计算上三角。C += A(r,:)ᵀ * A(r,:)，每次累加4行以减少对C的读写
+    for (int ic = 0; ic < n; ic += SYRK_NB) {
+        int ie = std::min(ic + SYRK_NB, n);
+        for (int jc = ic; jc < n; jc += SYRK_NB) {
+            int je = std::min(jc + SYRK_NB, n);
+
+            int r = 0;
+            for (; r + 4 <= m; r += 4) {
+                const double *a0 = A + r * n;
+                const double *a1 = a0 + n;
+                const double *a2 = a1 + n;
+                const double *a3 = a2 + n;
+                for (int i = ic; i < ie; ++i) {
+                    double s0 = a0[i], s1 = a1[i], s2 = a2[i], s3 = a3[i];
+                    double *c = C + i * n;
+                    for (int j = std::max(i, jc); j < je; ++j) {
+                        c[j] += s0 * a0[j] + s1 * a1[j] + s2 * a2[j] + s3 * a3[j];
+                    }
+                }
+            }
+            for (; r < m; ++r) {
+                const double *a0 = A + r * n;
+                for (int i = ic; i < ie; ++i) {
+                    double s0 = a0[i];
+                    double *c = C + i * n;
+                    for (int j = std::max(i, jc); j < je; ++j) {
+                        c[j] += s0 * a0[j];
+                    }
+                }
+            }
+        }
+    }
+
+    // 复制到下三角
+    for (int i = 1; i < n; ++i) {
+        for (int j = 0; j < i; ++j) {
+            C[i * n + j] = C[j * n + i];
+        }
+    }
+}
+
+void GemvTranspose(int m, int n, const double *A, const double *x, double *y) noexcept {
+    std::fill(y, y + n, 0.0);
+
+    // y += x[r] * A(r,:)，每次累加4行以减少对y的读写
+    int r = 0;
+    for (; r + 4 <= m; r += 4) {
+        const double *a0 = A + r * n;
+        const double *a1 = a0 + n;
+        const double *a2 = a1 + n;
+        const double *a3 = a2 + n;
+        double x0 = x[r], x1 = x[r + 1], x2 = x[r + 2], x3 = x[r + 3];
+        for (int j = 0; j < n; ++j) {
+            y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
+        }
+    }
+    for (; r < m; ++r) {
+        const double *a0 = A + r * n;
+        double x0 = x[r];
+        for (int j = 0; j < n; ++j) {
+            y[j] += x0 * a0[j];
+        }
+    }
+}
+
+} // namespace internal
+
+} // namespace tomsolver
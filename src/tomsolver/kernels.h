@@ -0,0 +1,71 @@
+#pragma once
+
+namespace tomsolver {
+
+namespace internal {
+
+/*
+ * 稠密矩阵、向量运算的底层内核。矩阵均按行连续存储（与Mat一致）。
+ * 第一次调用时通过cpuid检测CPU支持的指令集，之后使用对应的SSE2/AVX2/AVX-512实现；
+ * 非x86平台使用标量实现。各实现对nan的处理相同。
+ */
+
+/**
+ * 向量内核可用的SIMD指令集。
+ */
+enum class SimdLevel { SCALAR, SSE2, AVX2, AVX512 };
+
+/**
+ * 返回当前CPU上内核实际使用的指令集。
+ */
+SimdLevel GetSimdLevel() noexcept;
+
+/**
+ * 改用指定指令集的内核，但不超过CPU实际支持的级别。返回实际使用的指令集。
+ * 用于对比测试各指令集的实现。可以与内核调用并发，但正在执行的调用仍使用原来的实现。
+ */
+SimdLevel SetSimdLevel(SimdLevel level) noexcept;
+
+/**
+ * 返回x和y的点积。
+ */
+double Dot(int n, const double *x, const double *y) noexcept;
+
+/**
+ * 返回x各元素绝对值的最大值。出现nan时返回nan。
+ */
+double AbsMax(int n, const double *x) noexcept;
+
+/**
+ * out = x + alpha * y。out可以与x或y重叠（完全相同的地址）。
+ */
+void ScaledAdd(int n, const double *x, double alpha, const double *y, double *out) noexcept;
+
+/**
+ * 返回是否所有|x[i]| < tol。出现nan时返回false。
+ */
+bool AllAbsLess(int n, const double *x, double tol) noexcept;
+
+/**
+ * 返回是否所有|x[i] - y[i]| < tol。出现nan时返回false。
+ */
+bool AllAbsDiffLess(int n, const double *x, const double *y, double tol) noexcept;
+
+/**
+ * C = A * B。A为m×k，B为k×n，C为m×n。C不能与A、B重叠。
+ */
+void Gemm(int m, int n, int k, const double *A, const double *B, double *C) noexcept;
+
+/**
+ * C = Aᵀ * A，不生成Aᵀ。A为m×n，C为n×n。C不能与A重叠。
+ */
+void SyrkTranspose(int m, int n, const double *A, double *C) noexcept;
+
+/**
+ * y = Aᵀ * x，不生成Aᵀ。A为m×n，x的长度为m，y的长度为n。y不能与A、x重叠。
+ */
+void GemvTranspose(int m, int n, const double *A, const double *x, double *y) noexcept;
+
+} // namespace internal
+
+} // namespace tomsolver
@@ -0,0 +1,389 @@
+#include "krylov.h"
+
+#include "error_type.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace tomsolver {
+
+GMRES::GMRES(int n, int restart)
+    : n(n), restart(restart), V((restart + 1) * n), H((restart + 1) * restart), cs(restart), sn(restart),
+      s(restart + 1), r(n), z(n) {
+    assert(n > 0);
+    assert(restart > 0);
+}
+
+bool GMRES::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+                  int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        for (int i = 0; i < n; ++i) {
+            x[i] = 0;
+        }
+        relativeResidual = 0;
+        return true;
+    }
+
+    auto basis = [&](int j) {
+        return MutableVecView(V.data() + j * n, n);
+    };
+    auto h = [&](int i, int j) -> double & {
+        return H[i * restart + j];
+    };
+
+    while (1) {
+        // r = b - Ax
+        A(x, r);
+        ScaledAdd(b, -1, r, r);
+        double beta = std::sqrt(r.Norm2());
+        relativeResidual = beta / bNorm;
+        if (relativeResidual <= tol) {
+            return true;
+        }
+        if (iterations >= maxIterations) {
+            return false;
+        }
+
+        Scale(1 / beta, r, basis(0));
+        std::fill(s.begin(), s.end(), 0);
+        s[0] = beta;
+
+        // Arnoldi过程，同时用Givens旋转把Hessenberg矩阵化为上三角矩阵
+        int k = 0;
+        bool breakdown = false;
+        bool singular = false; // Hessenberg矩阵的新列与前面的列线性相关（A奇异），残差不会再下降
+        while (k < restart && iterations < maxIterations) {
+            int j = k++;
+            ++iterations;
+            MutableVecView w = basis(j + 1);
+            if (precond) {
+                precond(basis(j), z);
+                A(z, w);
+            } else {
+                A(basis(j), w);
+            }
+
+            double wNorm = std::sqrt(Dot(w, w)); // 正交化之前的||Av||，用于判断对角元是否为0
+
+            // 修正的Gram-Schmidt正交化
+            for (int i = 0; i <= j; ++i) {
+                h(i, j) = Dot(w, basis(i));
+                ScaledAdd(w, -h(i, j), basis(i), w);
+            }
+            h(j + 1, j) = std::sqrt(Dot(w, w));
+            breakdown = h(j + 1, j) == 0;
+            if (!breakdown) {
+                Scale(1 / h(j + 1, j), w, w);
+            }
+
+            for (int i = 0; i < j; ++i) {
+                double t = cs[i] * h(i, j) + sn[i] * h(i + 1, j);
+                h(i + 1, j) = -sn[i] * h(i, j) + cs[i] * h(i + 1, j);
+                h(i, j) = t;
+            }
+            double d = std::hypot(h(j, j), h(j + 1, j));
+            if (d <= n * std::numeric_limits<double>::epsilon() * wNorm) {
+                // 上三角矩阵的对角元（相对于||Av||）为0，只用前j列求解，relativeResidual仍为上一步的值
+                k = j;
+                singular = true;
+                break;
+            }
+            cs[j] = h(j, j) / d;
+            sn[j] = h(j + 1, j) / d;
+            h(j, j) = d;
+            h(j + 1, j) = 0;
+            s[j + 1] = -sn[j] * s[j];
+            s[j] *= cs[j];
+
+            relativeResidual = std::abs(s[j + 1]) / bNorm;
+            if (relativeResidual <= tol || breakdown) {
+                break;
+            }
+        }
+
+        // 回代求解上三角方程组Hy = s，y存放在s中，然后x += M⁻¹·(Vy)
+        for (int i = k - 1; i >= 0; --i) {
+            for (int j = i + 1; j < k; ++j) {
+                s[i] -= h(i, j) * s[j];
+            }
+            s[i] /= h(i, i);
+        }
+        for (int i = 0; i < n; ++i) {
+            r[i] = 0;
+        }
+        for (int j = 0; j < k; ++j) {
+            ScaledAdd(r, s[j], basis(j), r);
+        }
+        if (precond) {
+            precond(r, z);
+            ScaledAdd(x, 1, z, x);
+        } else {
+            ScaledAdd(x, 1, r, x);
+        }
+
+        if (singular) {
+            return relativeResidual <= tol;
+        }
+        if (relativeResidual <= tol || breakdown) {
+            return true;
+        }
+    }
+}
+
+int GMRES::Iterations() const noexcept {
+    return iterations;
+}
+
+double GMRES::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+namespace {
+
+/**
+ * out = M⁻¹·v，M⁻¹为nullptr时out = v。
+ */
+void ApplyPreconditioner(const LinearOperator &precond, VecView v, MutableVecView out) {
+    if (precond) {
+        precond(v, out);
+    } else {
+        out = v;
+    }
+}
+
+} // namespace
+
+BiCGSTAB::BiCGSTAB(int n) : n(n), r(n), r0(n), p(n), v(n), s(n), t(n), pHat(n), sHat(n) {
+    assert(n > 0);
+}
+
+bool BiCGSTAB::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+                     int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        Scale(0, b, x);
+        relativeResidual = 0;
+        return true;
+    }
+
+    // r = b - Ax
+    A(x, r);
+    ScaledAdd(b, -1, r, r);
+    r0 = r;
+    relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+    double rho = 1, alpha = 1, omega = 1;
+    while (relativeResidual > tol) {
+        if (iterations >= maxIterations) {
+            return false;
+        }
+        ++iterations;
+
+        double rhoNew = Dot(r0, r);
+        if (rhoNew == 0) {
+            return false;
+        }
+        if (iterations == 1) {
+            p = r;
+        } else {
+            // p = r + β(p - ωv)
+            double beta = (rhoNew / rho) * (alpha / omega);
+            ScaledAdd(p, -omega, v, p);
+            ScaledAdd(r, beta, p, p);
+        }
+        rho = rhoNew;
+
+        ApplyPreconditioner(precond, p, pHat);
+        A(pHat, v);
+        double r0v = Dot(r0, v);
+        if (r0v == 0) {
+            return false;
+        }
+        alpha = rho / r0v;
+
+        // s = r - αv
+        ScaledAdd(r, -alpha, v, s);
+        ScaledAdd(x, alpha, pHat, x);
+        relativeResidual = std::sqrt(s.Norm2()) / bNorm;
+        if (relativeResidual <= tol) {
+            return true;
+        }
+
+        ApplyPreconditioner(precond, s, sHat);
+        A(sHat, t);
+        double tt = t.Norm2();
+        omega = tt == 0 ? 0 : Dot(t, s) / tt;
+        ScaledAdd(x, omega, sHat, x);
+        ScaledAdd(s, -omega, t, r);
+        relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+        if (omega == 0) {
+            return relativeResidual <= tol;
+        }
+    }
+    return true;
+}
+
+int BiCGSTAB::Iterations() const noexcept {
+    return iterations;
+}
+
+double BiCGSTAB::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+ConjugateGradient::ConjugateGradient(int n) : n(n), r(n), z(n), p(n), Ap(n) {
+    assert(n > 0);
+}
+
+bool ConjugateGradient::Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x,
+                              double tol, int maxIterations) {
+    assert(b.Size() == n && x.Size() == n);
+    iterations = 0;
+    double bNorm = std::sqrt(Dot(b, b));
+    if (bNorm == 0) {
+        Scale(0, b, x);
+        relativeResidual = 0;
+        return true;
+    }
+
+    // r = b - Ax
+    A(x, r);
+    ScaledAdd(b, -1, r, r);
+    relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+    ApplyPreconditioner(precond, r, z);
+    p = z;
+    double rz = Dot(r, z);
+    while (relativeResidual > tol) {
+        if (iterations >= maxIterations) {
+            return false;
+        }
+        ++iterations;
+
+        A(p, Ap);
+        double pAp = Dot(p, Ap);
+        if (pAp <= 0) {
+            // A不正定
+            return false;
+        }
+        double alpha = rz / pAp;
+        ScaledAdd(x, alpha, p, x);
+        ScaledAdd(r, -alpha, Ap, r);
+        relativeResidual = std::sqrt(r.Norm2()) / bNorm;
+
+        ApplyPreconditioner(precond, r, z);
+        double rzNew = Dot(r, z);
+        ScaledAdd(z, rzNew / rz, p, p);
+        rz = rzNew;
+    }
+    return true;
+}
+
+int ConjugateGradient::Iterations() const noexcept {
+    return iterations;
+}
+
+double ConjugateGradient::RelativeResidual() const noexcept {
+    return relativeResidual;
+}
+
+JacobiPreconditioner::JacobiPreconditioner(const SparseMat &A) : invDiag(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        double d = A.Value(i, i);
+        if (d == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        invDiag[i] = 1 / d;
+    }
+}
+
+JacobiPreconditioner::JacobiPreconditioner(MatView A) : invDiag(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        double d = A.Value(i, i);
+        if (d == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+        invDiag[i] = 1 / d;
+    }
+}
+
+void JacobiPreconditioner::operator()(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == static_cast<int>(invDiag.size()));
+    for (int i = 0; i < v.Size(); ++i) {
+        out[i] = invDiag[i] * v[i];
+    }
+}
+
+ILU0Preconditioner::ILU0Preconditioner(const SparseMat &A)
+    : n(A.Rows()), rowPtr(A.RowPointers()), colIndex(A.ColIndices()), lu(A.Values()), diagIndex(A.Rows()) {
+    assert(A.Rows() == A.Cols());
+    for (int i = 0; i < n; ++i) {
+        auto begin = colIndex.begin() + rowPtr[i];
+        auto end = colIndex.begin() + rowPtr[i + 1];
+        auto it = std::lower_bound(begin, end, i);
+        if (it == end || *it != i) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "ILU(0): missing diagonal entry");
+        }
+        diagIndex[i] = static_cast<int>(it - colIndex.begin());
+    }
+
+    // IKJ形式的高斯消元，只更新A中原有的非零元。pos[j]为第i行第j列的元素在lu中的下标，-1表示不存在
+    std::vector<int> pos(n, -1);
+    for (int i = 0; i < n; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            pos[colIndex[k]] = k;
+        }
+        for (int k = rowPtr[i]; k < diagIndex[i]; ++k) {
+            int col = colIndex[k];
+            double pivot = lu[diagIndex[col]];
+            if (pivot == 0) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+            }
+            double ratio = lu[k] /= pivot;
+            for (int kk = diagIndex[col] + 1; kk < rowPtr[col + 1]; ++kk) {
+                if (pos[colIndex[kk]] >= 0) {
+                    lu[pos[colIndex[kk]]] -= ratio * lu[kk];
+                }
+            }
+        }
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            pos[colIndex[k]] = -1;
+        }
+        if (lu[diagIndex[i]] == 0) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+    }
+}
+
+void ILU0Preconditioner::operator()(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == n && out.Size() == n);
+
+    // Ly = v，L的对角元为1
+    for (int i = 0; i < n; ++i) {
+        double sum = v[i];
+        for (int k = rowPtr[i]; k < diagIndex[i]; ++k) {
+            sum -= lu[k] * out[colIndex[k]];
+        }
+        out[i] = sum;
+    }
+
+    // U·out = y
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = out[i];
+        for (int k = diagIndex[i] + 1; k < rowPtr[i + 1]; ++k) {
+            sum -= lu[k] * out[colIndex[k]];
+        }
+        out[i] = sum / lu[diagIndex[i]];
+    }
+}
+
+} // namespace tomsolver
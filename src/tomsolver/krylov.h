@@ -0,0 +1,197 @@
+#pragma once
+
+#include "mat.h"
+#include "mat_view.h"
+#include "sparse_mat.h"
+
+#include <functional>
+#include <vector>
+
+namespace tomsolver {
+
+/**
+ * 线性算子，计算out = A·v。v与out的长度都等于A的阶数，不会指向同一块内存。
+ * Krylov子空间方法只通过这种方式访问A，因此A可以不以矩阵的形式存在（例如用差分近似雅可比矩阵与向量的乘积）。
+ * 预条件子M⁻¹也以这种形式给出。
+ */
+using LinearOperator =
+    std::function<void(VecView v, MutableVecView out)>;
+
+/**
+ * 重启GMRES(restart)方法求解n阶线性方程组Ax = b，A可以不对称。
+ * 使用右预条件：求解AM⁻¹u = b，x = M⁻¹u，因此残差||b - Ax||不受预条件子影响。
+ * 工作空间（restart + 1个n维基向量与Hessenberg矩阵）在构造时分配，内存为O(n·restart)，之后求解不申请堆内存。
+ */
+class GMRES {
+public:
+    /**
+     * @param n: 方程组的阶数
+     * @param restart: 每隔多少次迭代重启一次，即Krylov子空间的最大维数
+     */
+    GMRES(int n, int restart);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * A奇异、Krylov子空间不再扩张而残差仍未达到要求时提前结束。
+     * @return 是否达到tol要求的精度。未达到时x仍为迭代过程中得到的近似解
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数（调用A的次数，不含计算初始残差）。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||（由迭代过程递推得到）。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int restart;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    // restart + 1个基向量，按行存放
+    std::vector<double> V;
+
+    // (restart + 1)×restart的上Hessenberg矩阵，按行存放。Givens旋转之后为上三角矩阵
+    std::vector<double> H;
+
+    // Givens旋转
+    std::vector<double> cs;
+    std::vector<double> sn;
+
+    // 最小二乘问题的右端项
+    std::vector<double> s;
+
+    Vec r;
+    Vec z;
+};
+
+/**
+ * 预条件的稳定双共轭梯度法（BiCGSTAB）求解n阶线性方程组Ax = b，A可以不对称。
+ * 与GMRES相比不需要保存Krylov子空间的基，内存为O(n)，但残差不是单调下降的。
+ * 使用右预条件，接口与GMRES相同。工作空间在构造时分配，之后求解不申请堆内存。
+ */
+class BiCGSTAB {
+public:
+    explicit BiCGSTAB(int n);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * @return 是否达到tol要求的精度。算法中断（breakdown）或未达到精度时x仍为得到的近似解
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数。每次迭代调用A两次。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    Vec r, r0, p, v, s, t, pHat, sHat;
+};
+
+/**
+ * 预条件共轭梯度法（CG）求解n阶对称正定线性方程组Ax = b，例如LM方法中的阻尼方程(JᵀJ + μD²)h = -JᵀF。
+ * 预条件子M⁻¹也必须对称正定。每次迭代调用A一次，内存为O(n)。工作空间在构造时分配，之后求解不申请堆内存。
+ */
+class ConjugateGradient {
+public:
+    explicit ConjugateGradient(int n);
+
+    /**
+     * 以x为初值迭代求解Ax = b，直到||b - Ax|| <= tol·||b||或者迭代次数达到maxIterations。结果写回x。
+     * @param precond: 预条件子M⁻¹，为nullptr时不使用预条件
+     * @return 是否达到tol要求的精度
+     */
+    bool Solve(const LinearOperator &A, const LinearOperator &precond, VecView b, MutableVecView x, double tol,
+               int maxIterations);
+
+    /**
+     * 最近一次求解的迭代次数（调用A的次数）。
+     */
+    int Iterations() const noexcept;
+
+    /**
+     * 最近一次求解结束时的相对残差||b - Ax|| / ||b||。
+     */
+    double RelativeResidual() const noexcept;
+
+private:
+    int n;
+    int iterations = 0;
+    double relativeResidual = 0;
+
+    Vec r, z, p, Ap;
+};
+
+/**
+ * Jacobi（对角）预条件子，M = diag(A)。可以作为LinearOperator使用。
+ */
+class JacobiPreconditioner {
+public:
+    /**
+     * @exception MathError 对角元为0
+     */
+    explicit JacobiPreconditioner(const SparseMat &A);
+
+    /**
+     * @exception MathError 对角元为0
+     */
+    explicit JacobiPreconditioner(MatView A);
+
+    /**
+     * out = M⁻¹·v
+     */
+    void operator()(VecView v, MutableVecView out) const noexcept;
+
+private:
+    std::vector<double> invDiag;
+};
+
+/**
+ * 零填充不完全LU分解（ILU(0)）预条件子，M = LU，L和U的非零元位置与A相同。可以作为LinearOperator使用。
+ * 适用于对角占优的稀疏矩阵，例如偏微分方程的差分离散。分解与求解的计算量都是O(nnz)。
+ */
+class ILU0Preconditioner {
+public:
+    /**
+     * 分解方阵A。A的每个对角元都必须是非零元。
+     * @exception MathError 缺少对角元，或者分解过程中出现为0的主元
+     */
+    explicit ILU0Preconditioner(const SparseMat &A);
+
+    /**
+     * out = (LU)⁻¹·v，v和out可以指向同一块内存。
+     */
+    void operator()(VecView v, MutableVecView out) const noexcept;
+
+private:
+    int n;
+
+    // 与A的非零元位置相同：严格下三角部分为L（对角元1不存储），其余为U
+    std::vector<int> rowPtr;
+    std::vector<int> colIndex;
+    std::vector<double> lu;
+
+    // 每行对角元在lu中的下标
+    std::vector<int> diagIndex;
+};
+
+} // namespace tomsolver
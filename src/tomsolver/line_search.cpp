@@ -0,0 +1,52 @@
+#include "line_search.h"
+
+#include <algorithm>
+
+namespace tomsolver {
+
+LineSearch::LineSearch(int n, int m) : xNew(n), fNew(m) {}
+
+double LineSearch::Alpha() const noexcept {
+    return alpha;
+}
+
+const Vec &LineSearch::X() const noexcept {
+    return xNew;
+}
+
+const Vec &LineSearch::F() const noexcept {
+    return fNew;
+}
+
+int LineSearch::Evaluations() const noexcept {
+    return evaluations;
+}
+
+double LineSearch::Interpolate(double a, double phi, double prevAlpha, double prevPhi, double phi0,
+                               double dphi0) noexcept {
+    // 去掉φ(0) + φ'(0)α之后的余项
+    double r = phi - phi0 - dphi0 * a;
+    double t;
+    if (prevAlpha == 0) {
+        // 二次插值：φ(0) + φ'(0)α + (r / a²)α²
+        t = -dphi0 * a * a / (2 * r);
+    } else {
+        // 三次插值：φ(0) + φ'(0)α + bα² + cα³
+        double prevR = prevPhi - phi0 - dphi0 * prevAlpha;
+        double c = (r / (a * a) - prevR / (prevAlpha * prevAlpha)) / (a - prevAlpha);
+        double b = (-prevAlpha * r / (a * a) + a * prevR / (prevAlpha * prevAlpha)) / (a - prevAlpha);
+        if (c == 0) {
+            t = -dphi0 / (2 * b);
+        } else {
+            double disc = b * b - 3 * c * dphi0;
+            t = disc >= 0 ? (-b + std::sqrt(disc)) / (3 * c) : 0.5 * a;
+        }
+    }
+
+    if (!std::isfinite(t)) {
+        return 0.5 * a;
+    }
+    return std::min(std::max(t, 0.1 * a), 0.5 * a);
+}
+
+} // namespace tomsolver
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "config.h"
+#include "error_type.h"
+#include "mat.h"
+#include "mat_view.h"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace tomsolver {
+
+/**
+ * 求解非线性方程组时，沿方向d的回溯一维搜索。
+ * 评价函数为φ(α) = ||f(x + αd)||² / 2。φ(0)与φ'(0)由调用者给出（通常在求方向时已经算好），
+ * 搜索过程中只计算试探点处的f，不再重复计算f(x)和雅可比矩阵。
+ * 工作空间在构造时分配，之后每次搜索都不申请堆内存。
+ */
+class LineSearch {
+public:
+    /**
+     * 每次搜索最多计算f的次数。
+     */
+    static constexpr int MAX_BACKTRACKING = 40;
+
+    /**
+     * Armijo条件φ(α) ≤ φ(0) + cαφ'(0)中的c。
+     */
+    static constexpr double SUFFICIENT_DECREASE = 1.0e-4;
+
+    /**
+     * @param n: 未知数数量，即x的长度
+     * @param m: 方程数量，即f(x)的长度
+     */
+    LineSearch(int n, int m);
+
+    /**
+     * 从α = 1开始回溯，直到满足Armijo条件。
+     * ARMIJO每次把α减半；CUBIC用φ(0)、φ'(0)和最近两次试探的φ做二次/三次插值，新的α限制在[0.1α, 0.5α]内。
+     * 试探点处f抛出浮点数无效值的MathError，或者φ不是有限值时，视为步长过大，把α减半后继续。
+     * @param f: 计算方程组的值，形如void(VecView x, Vec &out)，out的长度为m
+     * @param phi0: φ(0)
+     * @param dphi0: φ'(0)，即f(x)ᵀJd，必须小于0
+     * @return 是否在MAX_BACKTRACKING次以内找到满足条件的α。成功时由Alpha()、X()、F()取得结果
+     */
+    template <typename Func>
+    bool Search(LineSearchMethod method, VecView x, VecView d, double phi0, double dphi0, Func &&f) {
+        assert(method != LineSearchMethod::NONE);
+        assert(x.Size() == xNew.Rows() && d.Size() == xNew.Rows());
+        double a = 1;
+        double prevAlpha = 0; // 上一次结果有限的试探，0表示没有
+        double prevPhi = 0;
+        for (evaluations = 0; evaluations < MAX_BACKTRACKING;) {
+            ScaledAdd(x, a, d, xNew);
+            double phi = EvalPhi(f);
+            ++evaluations;
+            if (phi <= phi0 + SUFFICIENT_DECREASE * a * dphi0) {
+                alpha = a;
+                return true;
+            }
+
+            if (method == LineSearchMethod::CUBIC && std::isfinite(phi)) {
+                double next = Interpolate(a, phi, prevAlpha, prevPhi, phi0, dphi0);
+                prevAlpha = a;
+                prevPhi = phi;
+                a = next;
+            } else {
+                a *= 0.5;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 最近一次成功搜索得到的步长α。
+     */
+    double Alpha() const noexcept;
+
+    /**
+     * 最近一次成功搜索得到的点x + αd。
+     */
+    const Vec &X() const noexcept;
+
+    /**
+     * f(X())。
+     */
+    const Vec &F() const noexcept;
+
+    /**
+     * 最近一次搜索计算f的次数。
+     */
+    int Evaluations() const noexcept;
+
+private:
+    Vec xNew;
+    Vec fNew;
+    double alpha = 0;
+    int evaluations = 0;
+
+    template <typename Func>
+    double EvalPhi(Func &f) {
+        try {
+            f(VecView(xNew), fNew);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                throw;
+            }
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return fNew.Norm2() / 2;
+    }
+
+    /**
+     * 以φ(0)、φ'(0)、φ(a)（以及φ(prevAlpha)，prevAlpha不为0时）拟合多项式，返回其极小点，限制在[0.1a, 0.5a]内。
+     */
+    static double Interpolate(double a, double phi, double prevAlpha, double prevPhi, double phi0,
+                              double dphi0) noexcept;
+};
+
+} // namespace tomsolver
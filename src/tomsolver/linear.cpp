@@ -2,17 +2,133 @@
 
 #include "config.h"
 #include "error_type.h"
+#include "kernels.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
 #include <vector>
 
 namespace tomsolver {
 
 namespace {
-template <typename T>
-const T &asConst(T &a) {
-    return a;
+
+/**
+ * 对m×n矩阵a（按行存放）原地做Householder QR分解，结果格式与QRFactorization相同。
+ * perm不为nullptr时选取剩余列中范数最大的一列作为主元列，perm返回列的排列。
+ * 变换按行访问a，对按行存放的矩阵是连续访存。
+ */
+void HouseholderQR(double *a, int m, int n, double *tau, int *perm, std::vector<double> &work) {
+    int kMax = std::min(m, n);
+
+    // 各列剩余部分的范数平方、上一次重新计算时的范数平方、Householder变换的中间结果
+    work.assign(3 * n, 0);
+    double *norms = work.data(), *norms0 = norms + n, *w = norms + 2 * n;
+    if (perm) {
+        for (int j = 0; j < n; ++j) {
+            perm[j] = j;
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                norms[j] += a[i * n + j] * a[i * n + j];
+            }
+        }
+        std::copy_n(norms, n, norms0);
+    }
+
+    for (int k = 0; k < kMax; ++k) {
+        double *rowK = a + k * n;
+
+        if (perm) {
+            int p = static_cast<int>(std::max_element(norms + k, norms + n) - norms);
+            if (p != k) {
+                for (int i = 0; i < m; ++i) {
+                    std::swap(a[i * n + k], a[i * n + p]);
+                }
+                std::swap(perm[k], perm[p]);
+                std::swap(norms[k], norms[p]);
+                std::swap(norms0[k], norms0[p]);
+            }
+        }
+
+        // 构造Householder变换 H = I - tau * v * vᵀ，使k列对角线以下的元素为0
+        double alpha = rowK[k];
+        double sigma = 0;
+        for (int i = k + 1; i < m; ++i) {
+            sigma += a[i * n + k] * a[i * n + k];
+        }
+
+        if (sigma == 0) {
+            tau[k] = 0;
+        } else {
+            double beta = -std::copysign(std::sqrt(alpha * alpha + sigma), alpha);
+            tau[k] = (beta - alpha) / beta;
+            double scale = 1 / (alpha - beta);
+            for (int i = k + 1; i < m; ++i) {
+                a[i * n + k] *= scale;
+            }
+            rowK[k] = beta;
+
+            // 右侧各列左乘H：w = tau * vᵀA，A -= v * w
+            for (int j = k + 1; j < n; ++j) {
+                w[j] = rowK[j];
+            }
+            for (int i = k + 1; i < m; ++i) {
+                const double *rowI = a + i * n;
+                double vi = rowI[k];
+                for (int j = k + 1; j < n; ++j) {
+                    w[j] += vi * rowI[j];
+                }
+            }
+            for (int j = k + 1; j < n; ++j) {
+                w[j] *= tau[k];
+                rowK[j] -= w[j];
+            }
+            for (int i = k + 1; i < m; ++i) {
+                double *rowI = a + i * n;
+                double vi = rowI[k];
+                for (int j = k + 1; j < n; ++j) {
+                    rowI[j] -= vi * w[j];
+                }
+            }
+        }
+
+        if (perm) {
+            // 更新剩余部分的范数。相消过多时重新计算，避免舍入误差累积
+            for (int j = k + 1; j < n; ++j) {
+                norms[j] -= rowK[j] * rowK[j];
+                if (norms[j] <= 1.0e-6 * norms0[j]) {
+                    norms[j] = 0;
+                    for (int i = k + 1; i < m; ++i) {
+                        norms[j] += a[i * n + j] * a[i * n + j];
+                    }
+                    norms0[j] = norms[j];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * c = H(k)c，H(k)为HouseholderQR得到的第k个变换。
+ */
+void ApplyHouseholder(const double *a, int m, int n, const double *tau, int k, double *c) noexcept {
+    if (tau[k] == 0) {
+        return;
+    }
+    double s = c[k];
+    for (int i = k + 1; i < m; ++i) {
+        s += a[i * n + k] * c[i];
+    }
+    s *= tau[k];
+    c[k] -= s;
+    for (int i = k + 1; i < m; ++i) {
+        c[i] -= s * a[i * n + k];
+    }
 }
+
 } // namespace
 
 Vec SolveLinear(Mat A, Vec b) {
@@ -29,28 +145,44 @@ Vec SolveLinear(Mat A, Vec b) {
 
     assert(rows == b.Rows()); // A行数不等于b行数
 
-    Vec ret(rows);
-
     if (rows > 0) {
         cols = A.Cols();
     }
-    if (cols != rows) // 不是方阵
-    {
-        if (rows > cols) {
-            // 过定义方程组
-            throw MathError(ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
-        } else {
-            // 不定方程组
-            ret.Resize(cols);
+
+    // 过定义方程组：返回最小二乘解
+    if (rows > cols) {
+        return QRFactorization(A).Solve(b);
+    }
+
+    // 不定方程组：返回范数最小的解
+    if (rows < cols) {
+        if (!Config::Get().allowIndeterminateEquation) {
+            throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION, "A = " + A.ToString() + "\nb = " + b.ToString());
+        }
+
+        Vec ret = QRFactorization(A).Solve(b);
+
+        // 秩亏且最小二乘解不满足方程 -> 无解。残差的舍入误差与b的大小成正比，因此使用相对误差
+        double tol = Config::Get().epsilon * std::max(1.0, b.NormInfinity());
+        if (!((A * ret - b).NormInfinity() <= tol)) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
         }
+        return ret;
     }
 
-    std::vector<int> TrueRowNumber(cols);
+    // 方阵优先使用LU分解；如果奇异，再用下面的消元法判断是无解还是无穷多解
+    try {
+        return LUFactorization(A).Solve(b);
+    } catch (const MathError &err) {
+        if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+            throw;
+        }
+    }
+
+    Vec ret(rows);
 
     // 列主元消元法
     for (auto y = 0, x = 0; y < rows && x < cols; y++, x++) {
-        // if (A[i].size() != rows)
-
         // 从当前行(y)到最后一行(rows-1)中，找出x列最大的一行与y行交换
         int maxAbsRowIndex = GetMaxAbsRowIndex(A, y, rows - 1, x);
         A.SwapRow(y, maxAbsRowIndex);
@@ -69,10 +201,6 @@ Vec SolveLinear(Mat A, Vec b) {
             b.SwapRow(y, maxAbsRowIndex);
         }
 
-        if (x != cols && x > y) {
-            TrueRowNumber[y] = x; // 补齐方程时 当前行应换到x行
-        }
-
         if (x == cols) // 本行全为0
         {
             RankA = y;
@@ -92,8 +220,10 @@ Vec SolveLinear(Mat A, Vec b) {
         // 主对角线化为1
         auto ratioY = A.Value(y, x);
         // y行第j个->第cols个
-        std::valarray<double> rowY = asConst(A).Row(y, x) / ratioY;
-        A.Row(y, x) = rowY;
+        double *rowY = std::addressof(A.Value(y, 0));
+        for (auto j = x; j < cols; j++) {
+            rowY[j] /= ratioY;
+        }
         b[y] /= ratioY;
 
         // 每行化为0
@@ -101,49 +231,513 @@ Vec SolveLinear(Mat A, Vec b) {
         {
             auto ratioRow = A.Value(row, x);
             if (std::abs(ratioRow) >= Config::Get().epsilon) {
-                A.Row(row, x) -= rowY * ratioRow;
+                double *rowRow = std::addressof(A.Value(row, 0));
+                for (auto j = x; j < cols; j++) {
+                    rowRow[j] -= rowY[j] * ratioRow;
+                }
                 b[row] -= b[y] * ratioRow;
             }
         }
     }
 
-    bool bIndeterminateEquation = false; // 设置此变量是因为后面rows将=cols，标记以判断是否为不定方程组
+    if (RankA < cols && RankA == RankAb) {
+        throw MathError(ErrorType::ERROR_INFINITY_SOLUTIONS);
+    }
 
-    // 若为不定方程组，空缺行全填0继续运算
-    if (rows != cols) {
-        A.Resize(cols, cols);
-        b.Resize(cols);
-        rows = cols;
-        bIndeterminateEquation = true;
+    // 后置换得到x
+    for (int i = rows - 1; i >= 0; i--) // 最后1行->第1行
+    {
+        ret[i] = b[i];
+        for (int j = i + 1; j < cols; j++) {
+            ret[i] -= A.Value(i, j) * ret[j];
+        }
+    }
 
-        // 调整顺序
-        for (int i = rows - 1; i >= 0; i--) {
-            if (TrueRowNumber[i] != 0) {
-                A.SwapRow(i, TrueRowNumber[i]);
-                b.SwapRow(i, TrueRowNumber[i]);
+    return ret;
+}
+
+Vec SolveLinear(Mat A, Vec b, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return SolveLinear(std::move(A), std::move(b));
+}
+
+LUFactorization::LUFactorization(int n) : n(n), lu(n * n), pivots(n) {
+    assert(n > 0);
+}
+
+LUFactorization::LUFactorization(MatView A) {
+    Factor(A);
+}
+
+void LUFactorization::Factor(const Mat &A) {
+    Factor(MatView(A));
+}
+
+void LUFactorization::Factor(MatView A) {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    n = A.Rows();
+    lu.resize(n * n);
+    pivots.resize(n);
+    if (A.IsContiguous()) {
+        std::copy_n(A.Data(), n * n, lu.data());
+    } else {
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                lu[i * n + j] = A.Value(i, j);
             }
         }
     }
 
-    // 后置换得到x
-    for (int i = rows - 1; i >= 0; i--) // 最后1行->第1行
-    {
-        auto vec = asConst(A).Row(i, i + 1) * asConst(ret).Col(0, i + 1);
-        ret[i] = b[i] - (vec.size() ? vec.sum() : 0);
+    internal::LUFactorInPlace(lu.data(), n, pivots.data());
+
+    factored = true;
+}
+
+Vec LUFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
+
+void LUFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
+
+    if (b.Data() != x.Data()) {
+        x = b;
     }
 
-    if (RankA < cols && RankA == RankAb) {
-        if (bIndeterminateEquation) {
-            if (!Config::Get().allowIndeterminateEquation) {
-                throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION,
-                                "A = " + A.ToString() + "\nb = " + b.ToString());
+    internal::LUSolveInPlace(lu.data(), pivots.data(), n, x);
+}
+
+double LUFactorization::ConditionEstimate() const noexcept {
+    assert(factored);
+    double maxAbs = 0, minAbs = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        double v = std::abs(lu[i * n + i]);
+        maxAbs = std::max(maxAbs, v);
+        minAbs = std::min(minAbs, v);
+    }
+    return maxAbs / minAbs;
+}
+
+bool LUFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+int LUFactorization::Size() const noexcept {
+    return n;
+}
+
+MixedPrecisionLUFactorization::MixedPrecisionLUFactorization(int n)
+    : n(n), a(n * n), luf(n * n), pivots(n), rhs(n), r(n), d(n), fallback(n) {
+    assert(n > 0);
+}
+
+void MixedPrecisionLUFactorization::Factor(MatView A) {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    doublePrecision = false;
+    n = A.Rows();
+    a.resize(n * n);
+    luf.resize(n * n);
+    pivots.resize(n);
+    rhs.resize(n);
+    r.resize(n);
+    d.resize(n);
+
+    normA = 0;
+    for (int i = 0; i < n; ++i) {
+        double rowSum = 0;
+        for (int j = 0; j < n; ++j) {
+            double v = A.Value(i, j);
+            a[i * n + j] = v;
+            luf[i * n + j] = static_cast<float>(v);
+            rowSum += std::abs(v);
+        }
+        normA = std::max(normA, rowSum);
+    }
+
+    try {
+        internal::LUFactorInPlace(luf.data(), n, pivots.data());
+    } catch (const MathError &err) {
+        if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+            throw;
+        }
+
+        // 单精度下奇异（主元下溢等），不一定是A本身奇异
+        FallBack();
+    }
+
+    factored = true;
+}
+
+Vec MixedPrecisionLUFactorization::Solve(VecView b) {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
+
+void MixedPrecisionLUFactorization::Solve(VecView b, MutableVecView x) {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
+
+    if (doublePrecision) {
+        fallback.Solve(b, x);
+        return;
+    }
+
+    // b和x可能指向同一块内存，修正过程中每一步都要用到b
+    MutableVecView(rhs.data(), n) = b;
+    if (!Refine(x)) {
+        FallBack();
+        fallback.Solve(VecView(rhs.data(), n), x);
+    }
+}
+
+bool MixedPrecisionLUFactorization::Refine(MutableVecView x) {
+    // 初始解：单精度求解
+    for (int i = 0; i < n; ++i) {
+        d[i] = static_cast<float>(rhs[i]);
+    }
+    internal::LUSolveInPlace(luf.data(), pivots.data(), n, d.data());
+    for (int i = 0; i < n; ++i) {
+        x[i] = d[i];
+    }
+
+    // 残差小于双精度舍入误差的量级时认为收敛
+    double tol = normA * std::numeric_limits<double>::epsilon() * std::sqrt(static_cast<double>(n));
+    double lastCorrection = std::numeric_limits<double>::infinity();
+    for (int it = 0;; ++it) {
+        // r = b - Ax，以双精度计算
+        double normR = 0, normX = 0;
+        for (int i = 0; i < n; ++i) {
+            const double *rowI = a.data() + i * n;
+            double v = rhs[i];
+            if (x.IsContiguous()) {
+                v -= internal::Dot(n, rowI, x.Data());
+            } else {
+                for (int j = 0; j < n; ++j) {
+                    v -= rowI[j] * x[j];
+                }
             }
-        } else {
-            throw MathError(ErrorType::ERROR_INFINITY_SOLUTIONS);
+            r[i] = v;
+            normR = std::max(normR, std::abs(v));
+            normX = std::max(normX, std::abs(x[i]));
+        }
+
+        if (normR <= tol * normX) {
+            return true;
+        }
+
+        if (it == Config::Get().maxRefinementIterations) {
+            return false;
+        }
+
+        // 单精度求解修正量 Ad = r
+        for (int i = 0; i < n; ++i) {
+            d[i] = static_cast<float>(r[i]);
+        }
+        internal::LUSolveInPlace(luf.data(), pivots.data(), n, d.data());
+
+        double correction = 0;
+        for (int i = 0; i < n; ++i) {
+            correction = std::max(correction, std::abs(static_cast<double>(d[i])));
+        }
+
+        // 修正量没有明显缩小（或出现nan），说明A相对单精度过于病态
+        if (!(correction <= 0.5 * lastCorrection)) {
+            return false;
+        }
+        lastCorrection = correction;
+
+        for (int i = 0; i < n; ++i) {
+            x[i] += d[i];
         }
     }
+}
 
-    return ret;
+void MixedPrecisionLUFactorization::FallBack() {
+    fallback.Factor(MatView(a.data(), n, n));
+    doublePrecision = true;
+}
+
+bool MixedPrecisionLUFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+bool MixedPrecisionLUFactorization::IsDoublePrecision() const noexcept {
+    return doublePrecision;
+}
+
+int MixedPrecisionLUFactorization::Size() const noexcept {
+    return n;
+}
+
+QRFactorization::QRFactorization(MatView A) {
+    Factor(A);
+}
+
+void QRFactorization::Factor(MatView A) {
+    factored = false;
+    m = A.Rows();
+    n = A.Cols();
+    int kMax = std::min(m, n);
+    qr.resize(m * n);
+    tau.resize(kMax);
+    perm.resize(n);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            qr[i * n + j] = A.Value(i, j);
+        }
+    }
+
+    HouseholderQR(qr.data(), m, n, tau.data(), perm.data(), work);
+
+    // 列主元保证|R(k, k)|大致递减。空矩阵的秩为0
+    double r00 = kMax > 0 ? std::abs(qr[0]) : 0;
+    rank = 0;
+    while (rank < kMax && std::abs(qr[rank * n + rank]) > Config::Get().epsilon * r00) {
+        ++rank;
+    }
+
+    // 秩亏：R的前rank行 [R11 R12] = Lᵀ Zᵀ，其中 [R11 R12]ᵀ = Z L
+    if (rank < n) {
+        z.assign(n * rank, 0);
+        zTau.resize(rank);
+        for (int i = 0; i < rank; ++i) {
+            for (int j = i; j < n; ++j) {
+                z[j * rank + i] = qr[i * n + j];
+            }
+        }
+        HouseholderQR(z.data(), n, rank, zTau.data(), nullptr, work);
+    }
+
+    factored = true;
+}
+
+Vec QRFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
+
+void QRFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == m);
+    assert(x.Size() == n);
+
+    // c = Qᵀb
+    Vec c(b);
+    double *pc = c.Data();
+    for (int k = 0; k < std::min(m, n); ++k) {
+        ApplyHouseholder(qr.data(), m, n, tau.data(), k, pc);
+    }
+
+    Vec u(n);
+    double *pu = u.Data();
+    if (rank == n) {
+        // 回代：Ru = c
+        for (int i = n - 1; i >= 0; --i) {
+            const double *rowI = qr.data() + i * n;
+            double v = pc[i];
+            for (int j = i + 1; j < n; ++j) {
+                v -= rowI[j] * pu[j];
+            }
+            pu[i] = v / rowI[i];
+        }
+    } else {
+        // 前代：Lᵀy = c，u = Z[y; 0]即为范数最小的解
+        for (int i = 0; i < rank; ++i) {
+            double v = pc[i];
+            for (int j = 0; j < i; ++j) {
+                v -= z[j * rank + i] * pu[j];
+            }
+            pu[i] = v / z[i * rank + i];
+        }
+        for (int k = rank - 1; k >= 0; --k) {
+            ApplyHouseholder(z.data(), n, rank, zTau.data(), k, pu);
+        }
+    }
+
+    for (int j = 0; j < n; ++j) {
+        x[perm[j]] = pu[j];
+    }
+}
+
+bool QRFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+int QRFactorization::Rank() const noexcept {
+    return rank;
+}
+
+int QRFactorization::Rows() const noexcept {
+    return m;
+}
+
+int QRFactorization::Cols() const noexcept {
+    return n;
+}
+
+CholeskyFactorization::CholeskyFactorization(int n) : n(n), l(n * n) {
+    assert(n > 0);
+}
+
+bool CholeskyFactorization::Factor(MatView A) noexcept {
+    assert(A.Rows() == A.Cols());
+
+    factored = false;
+    n = A.Rows();
+    l.resize(n * n);
+
+    for (int j = 0; j < n; ++j) {
+        double *rowJ = l.data() + j * n;
+
+        // 对角线元素
+        double d = A.Value(j, j);
+        for (int k = 0; k < j; ++k) {
+            d -= rowJ[k] * rowJ[k];
+        }
+        if (!(d > 0)) {
+            return false;
+        }
+        rowJ[j] = std::sqrt(d);
+
+        // j列对角线以下的元素
+        for (int i = j + 1; i < n; ++i) {
+            double *rowI = l.data() + i * n;
+            double v = A.Value(i, j);
+            for (int k = 0; k < j; ++k) {
+                v -= rowI[k] * rowJ[k];
+            }
+            rowI[j] = v / rowJ[j];
+        }
+    }
+
+    factored = true;
+    return true;
+}
+
+Vec CholeskyFactorization::Solve(VecView b) const {
+    Vec x(n);
+    Solve(b, x);
+    return x;
+}
+
+void CholeskyFactorization::Solve(VecView b, MutableVecView x) const {
+    assert(factored);
+    assert(b.Size() == n);
+    assert(x.Size() == n);
+
+    if (b.Data() != x.Data()) {
+        x = b;
+    }
+
+    // 前代：Ly = b
+    for (int i = 0; i < n; ++i) {
+        const double *rowI = l.data() + i * n;
+        double v = x[i];
+        for (int j = 0; j < i; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v / rowI[i];
+    }
+
+    // 回代：Lᵀx = y
+    for (int i = n - 1; i >= 0; --i) {
+        double v = x[i];
+        for (int j = i + 1; j < n; ++j) {
+            v -= l[j * n + i] * x[j];
+        }
+        x[i] = v / l[i * n + i];
+    }
+}
+
+bool CholeskyFactorization::IsFactored() const noexcept {
+    return factored;
+}
+
+int CholeskyFactorization::Size() const noexcept {
+    return n;
+}
+
+namespace {
+
+/**
+ * 返回2的整数次幂s，使v * s落在[1, 2)之间。v为0时返回1。
+ */
+double PowerOfTwoScale(double v) noexcept {
+    if (v == 0) {
+        return 1;
+    }
+    int e;
+    std::frexp(v, &e);
+    return std::ldexp(1.0, 1 - e);
+}
+
+} // namespace
+
+Equilibration::Equilibration(MatView A) {
+    Compute(A);
+}
+
+void Equilibration::Compute(MatView A) {
+    int m = A.Rows(), n = A.Cols();
+    r.assign(m, 0);
+    c.assign(n, 0);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            r[i] = std::max(r[i], std::abs(A.Value(i, j)));
+        }
+        r[i] = PowerOfTwoScale(r[i]);
+    }
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            c[j] = std::max(c[j], std::abs(r[i] * A.Value(i, j)));
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        c[j] = PowerOfTwoScale(c[j]);
+    }
+}
+
+void Equilibration::Apply(Mat &A) const noexcept {
+    assert(A.Rows() == Rows());
+    assert(A.Cols() == Cols());
+    for (int i = 0; i < A.Rows(); ++i) {
+        for (int j = 0; j < A.Cols(); ++j) {
+            A.Value(i, j) *= r[i] * c[j];
+        }
+    }
+}
+
+VecView Equilibration::RowScale() const noexcept {
+    assert(IsComputed());
+    return {r.data(), Rows()};
+}
+
+VecView Equilibration::ColScale() const noexcept {
+    assert(IsComputed());
+    return {c.data(), Cols()};
+}
+
+bool Equilibration::IsComputed() const noexcept {
+    return !r.empty();
+}
+
+int Equilibration::Rows() const noexcept {
+    return static_cast<int>(r.size());
+}
+
+int Equilibration::Cols() const noexcept {
+    return static_cast<int>(c.size());
 }
 
 } // namespace tomsolver
\ No newline at end of file
@@ -1,11 +1,20 @@
 #pragma once
 
+#include "config.h"
+#include "error_type.h"
 #include "mat.h"
+#include "mat_view.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace tomsolver {
 
 /**
- * 求解线性方程组Ax = b。传入矩阵A，向量b，返回向量x。
+ * 求解线性方程组Ax = b。传入矩阵A，向量b，返回向量x。A和b也可以是MatView/VecView（会复制一次）。
+ * 方程数量多于未知数数量（过定义）时，返回最小二乘解；A秩亏时返回最小二乘解中范数最小的一个。
+ * 方程数量少于未知数数量（不定方程）时，返回范数最小的解。
  * @exception MathError 奇异矩阵
  * @exception MathError 矛盾方程组
  * @exception MathError 不定方程（设置Config::Get().allowIndeterminateEquation=true可以允许不定方程组返回一组特解）
@@ -13,4 +22,496 @@ namespace tomsolver {
  */
 Vec SolveLinear(Mat A, Vec b);
 
+/**
+ * 以options代替Config::Get()求解线性方程组Ax = b，不读取也不修改全局配置。其余同上。
+ */
+Vec SolveLinear(Mat A, Vec b, const SolverOptions &options);
+
+namespace internal {
+
+/**
+ * n阶方阵的原地LU分解（列主元），标量类型为T（float、double、long double）。
+ * a按行连续存放，分解后L（不含对角线）和U存放在a中，pivots[k]为第k步消元时与第k行交换的行号。
+ * @exception MathError 奇异矩阵
+ */
+template <typename T>
+void LUFactorInPlace(T *a, int n, int *pivots) {
+    for (int k = 0; k < n; ++k) {
+        T *rowK = a + k * n;
+
+        // 从第k行到最后一行中，找出k列绝对值最大的一行作为主元行
+        int maxAbsRowIndex = k;
+        T maxAbs = std::abs(rowK[k]);
+        for (int i = k + 1; i < n; ++i) {
+            if (std::abs(a[i * n + k]) > maxAbs) {
+                maxAbs = std::abs(a[i * n + k]);
+                maxAbsRowIndex = i;
+            }
+        }
+
+        pivots[k] = maxAbsRowIndex;
+        if (maxAbs < Config::Get().epsilon) {
+            throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+
+        if (maxAbsRowIndex != k) {
+            std::swap_ranges(rowK, rowK + n, a + maxAbsRowIndex * n);
+        }
+
+        // 消去k列对角线以下的元素，消元系数存放到L的位置
+        T pivot = rowK[k];
+        for (int i = k + 1; i < n; ++i) {
+            T *rowI = a + i * n;
+            T ratio = rowI[k] /= pivot;
+            if (ratio != 0) {
+                for (int j = k + 1; j < n; ++j) {
+                    rowI[j] -= ratio * rowK[j];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * 利用LUFactorInPlace的结果求解Ax = b。调用时x为b，返回时x为解。
+ * x可以是T*，也可以是支持operator[]的向量（例如MutableVecView）。
+ */
+template <typename T, typename X>
+void LUSolveInPlace(const T *lu, const int *pivots, int n, X &&x) noexcept {
+    // 按照分解时的顺序交换b的各行
+    for (int k = 0; k < n; ++k) {
+        if (pivots[k] != k) {
+            std::swap(x[k], x[pivots[k]]);
+        }
+    }
+
+    // 前代：Ly = Pb
+    for (int i = 1; i < n; ++i) {
+        const T *rowI = lu + i * n;
+        T v = x[i];
+        for (int j = 0; j < i; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v;
+    }
+
+    // 回代：Ux = y
+    for (int i = n - 1; i >= 0; --i) {
+        const T *rowI = lu + i * n;
+        T v = x[i];
+        for (int j = i + 1; j < n; ++j) {
+            v -= rowI[j] * x[j];
+        }
+        x[i] = v / rowI[i];
+    }
+}
+
+/**
+ * 同时对W个n阶方阵做原地LU分解（列主元），每个方阵的结果与LUFactorInPlace相同。
+ * 各方阵按路交错存放：a[(i * n + j) * W + l]为第l个方阵的(i, j)元素，pivots[k * W + l]同理。
+ * 选主元时各路分别比较，消元时W路同时计算，最内层的循环连续访问内存，可以向量化。
+ * 不抛出异常：第l个方阵奇异时将ok[l]置为false，该路之后的结果没有意义。
+ */
+template <int W>
+void LUFactorLanes(double *a, int n, int *pivots, bool *ok) noexcept {
+    double eps = Config::Get().epsilon;
+    for (int k = 0; k < n; ++k) {
+        double *rowK = a + k * n * W;
+
+        // 各路分别找出k列绝对值最大的一行作为主元行
+        for (int l = 0; l < W; ++l) {
+            int maxAbsRowIndex = k;
+            double maxAbs = std::abs(rowK[k * W + l]);
+            for (int i = k + 1; i < n; ++i) {
+                if (std::abs(a[(i * n + k) * W + l]) > maxAbs) {
+                    maxAbs = std::abs(a[(i * n + k) * W + l]);
+                    maxAbsRowIndex = i;
+                }
+            }
+
+            pivots[k * W + l] = maxAbsRowIndex;
+            if (maxAbs < eps) {
+                ok[l] = false;
+            }
+
+            if (maxAbsRowIndex != k) {
+                for (int j = 0; j < n; ++j) {
+                    std::swap(rowK[j * W + l], a[(maxAbsRowIndex * n + j) * W + l]);
+                }
+            }
+        }
+
+        // 消去k列对角线以下的元素，消元系数存放到L的位置
+        for (int i = k + 1; i < n; ++i) {
+            double *rowI = a + i * n * W;
+            double ratio[W];
+            for (int l = 0; l < W; ++l) {
+                ratio[l] = rowI[k * W + l] /= rowK[k * W + l];
+            }
+            for (int j = k + 1; j < n; ++j) {
+                for (int l = 0; l < W; ++l) {
+                    rowI[j * W + l] -= ratio[l] * rowK[j * W + l];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * 利用LUFactorLanes的结果同时求解W个方程组，x[i * W + l]为第l个方程组的b，返回时为解。
+ */
+template <int W>
+void LUSolveLanes(const double *lu, const int *pivots, int n, double *x) noexcept {
+    for (int k = 0; k < n; ++k) {
+        for (int l = 0; l < W; ++l) {
+            int p = pivots[k * W + l];
+            if (p != k) {
+                std::swap(x[k * W + l], x[p * W + l]);
+            }
+        }
+    }
+
+    // 前代：Ly = Pb
+    for (int i = 1; i < n; ++i) {
+        const double *rowI = lu + i * n * W;
+        for (int j = 0; j < i; ++j) {
+            for (int l = 0; l < W; ++l) {
+                x[i * W + l] -= rowI[j * W + l] * x[j * W + l];
+            }
+        }
+    }
+
+    // 回代：Ux = y
+    for (int i = n - 1; i >= 0; --i) {
+        const double *rowI = lu + i * n * W;
+        for (int j = i + 1; j < n; ++j) {
+            for (int l = 0; l < W; ++l) {
+                x[i * W + l] -= rowI[j * W + l] * x[j * W + l];
+            }
+        }
+        for (int l = 0; l < W; ++l) {
+            x[i * W + l] /= rowI[i * W + l];
+        }
+    }
+}
+
+} // namespace internal
+
+/**
+ * 方阵的LU分解（列主元），PA = LU。
+ * 分解一次之后可以对多个右端向量反复求解，用于在多次迭代之间复用同一个雅可比矩阵的分解结果。
+ * 工作空间在构造时（或第一次分解时）分配，之后对同阶方阵的分解和求解都不再申请堆内存。
+ */
+class LUFactorization {
+public:
+    LUFactorization() noexcept = default;
+
+    /**
+     * 预先分配n阶方阵所需的工作空间。
+     */
+    explicit LUFactorization(int n);
+
+    /**
+     * 构造并立即分解方阵A。
+     * @exception MathError 奇异矩阵
+     */
+    explicit LUFactorization(MatView A);
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(MatView A);
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @exception MathError 奇异矩阵
+     */
+    void Factor(const Mat &A);
+
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     */
+    Vec Solve(VecView b) const;
+
+    /**
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * 不申请堆内存。
+     */
+    void Solve(VecView b, MutableVecView x) const;
+
+    /**
+     * 条件数的粗略估计max|U(i, i)| / min|U(i, i)|，只需O(n)次运算。
+     * 不是严格的上界或下界，但病态矩阵的U对角元通常相差很多个数量级，足以区分良态与病态。调用前必须已经成功分解。
+     */
+    double ConditionEstimate() const noexcept;
+
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
+
+    /**
+     * 方阵的阶数。
+     */
+    int Size() const noexcept;
+
+private:
+    int n = 0;
+    bool factored = false;
+
+    // L和U按行连续存放在同一块内存中，L的对角线元素（均为1）不存储
+    std::vector<double> lu;
+
+    // pivots[k]表示第k步消元时与第k行交换的行号
+    std::vector<int> pivots;
+};
+
+/**
+ * 混合精度的方阵LU分解：以单精度分解A，求解时以双精度残差 r = b - Ax 反复修正（iterative refinement），
+ * 得到与双精度LU分解同等精度的解。分解的内存访问量和计算量约为双精度的一半。
+ * 修正停滞（A病态）、超过Config::Get().maxRefinementIterations次或单精度分解失败时，改用双精度分解A，
+ * 并在下一次Factor之前一直使用双精度分解。
+ * 工作空间的分配规则与LUFactorization相同。
+ */
+class MixedPrecisionLUFactorization {
+public:
+    MixedPrecisionLUFactorization() noexcept = default;
+
+    /**
+     * 预先分配n阶方阵所需的工作空间。
+     */
+    explicit MixedPrecisionLUFactorization(int n);
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。A会被复制一份，用于计算双精度残差。
+     * @exception MathError 奇异矩阵（单精度和双精度分解都失败）
+     */
+    void Factor(MatView A);
+
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     * @exception MathError 修正停滞后双精度分解发现A奇异
+     */
+    Vec Solve(VecView b);
+
+    /**
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * @exception MathError 修正停滞后双精度分解发现A奇异
+     */
+    void Solve(VecView b, MutableVecView x);
+
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
+
+    /**
+     * 返回是否已经退回双精度分解。
+     */
+    bool IsDoublePrecision() const noexcept;
+
+    /**
+     * 方阵的阶数。
+     */
+    int Size() const noexcept;
+
+private:
+    int n = 0;
+    bool factored = false;
+    bool doublePrecision = false;
+
+    // A的副本，按行连续存放
+    std::vector<double> a;
+
+    // A的无穷范数（行绝对值和的最大值）
+    double normA = 0;
+
+    // 单精度的LU分解结果，格式与LUFactorization相同
+    std::vector<float> luf;
+    std::vector<int> pivots;
+
+    // 修正过程中的工作空间：b的副本、残差、单精度的修正量
+    std::vector<double> rhs;
+    std::vector<double> r;
+    std::vector<float> d;
+
+    // 双精度分解，仅在退回时使用
+    LUFactorization fallback;
+
+    /**
+     * 用单精度分解结果迭代修正求解Ax = rhs，结果写入x。修正停滞时返回false。
+     */
+    bool Refine(MutableVecView x);
+
+    /**
+     * 退回双精度分解。
+     * @exception MathError 奇异矩阵
+     */
+    void FallBack();
+};
+
+/**
+ * 列主元Householder QR分解，AP = QR。A为m×n矩阵，形状任意，可以秩亏。
+ * 用于求解最小二乘问题 min||Ax - b||：A列满秩时得到唯一的最小二乘解；
+ * A秩亏（包括m < n）时，再对R的前Rank()行做一次QR分解（完全正交分解），得到范数最小的最小二乘解。
+ * 工作空间的分配规则与LUFactorization相同。
+ */
+class QRFactorization {
+public:
+    QRFactorization() noexcept = default;
+
+    /**
+     * 构造并立即分解矩阵A。
+     */
+    explicit QRFactorization(MatView A);
+
+    /**
+     * 分解矩阵A。之前的分解结果将被覆盖。
+     * |R(k, k)| < Config::Get().epsilon * |R(0, 0)|的对角元视为0，据此确定A的秩。
+     */
+    void Factor(MatView A);
+
+    /**
+     * 返回min||Ax - b||的解（秩亏时为其中范数最小的解）。b的长度为Rows()，返回值的长度为Cols()。
+     */
+    Vec Solve(VecView b) const;
+
+    /**
+     * 同Solve(b)，结果写入x。x的长度必须等于Cols()，b和x不能指向同一块内存。
+     */
+    void Solve(VecView b, MutableVecView x) const;
+
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
+
+    /**
+     * 数值秩。
+     */
+    int Rank() const noexcept;
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+private:
+    int m = 0;
+    int n = 0;
+    int rank = 0;
+    bool factored = false;
+
+    // m×n，按行存放。R位于上三角，Householder向量（首元素1不存储）位于对角线以下
+    std::vector<double> qr;
+    std::vector<double> tau;
+
+    // AP的第j列是A的第perm[j]列
+    std::vector<int> perm;
+
+    // 秩亏时R的前rank行转置后（n×rank）的QR分解，格式与qr相同
+    std::vector<double> z;
+    std::vector<double> zTau;
+
+    // 分解过程中的工作空间
+    std::vector<double> work;
+};
+
+/**
+ * 对称正定矩阵的Cholesky分解，A = LLᵀ。只使用A的下三角部分。
+ * 工作空间的分配规则与LUFactorization相同。
+ */
+class CholeskyFactorization {
+public:
+    CholeskyFactorization() noexcept = default;
+
+    /**
+     * 预先分配n阶方阵所需的工作空间。
+     */
+    explicit CholeskyFactorization(int n);
+
+    /**
+     * 分解方阵A。之前的分解结果将被覆盖。
+     * @return A是否正定。如果不是正定矩阵，分解失败，返回false
+     */
+    bool Factor(MatView A) noexcept;
+
+    /**
+     * 利用分解结果求解Ax = b。调用前必须已经成功分解。
+     */
+    Vec Solve(VecView b) const;
+
+    /**
+     * 利用分解结果求解Ax = b，结果写入x。x的长度必须等于Size()，b和x可以指向同一块内存。
+     * 不申请堆内存。
+     */
+    void Solve(VecView b, MutableVecView x) const;
+
+    /**
+     * 返回是否已经有可用的分解结果。
+     */
+    bool IsFactored() const noexcept;
+
+    /**
+     * 方阵的阶数。
+     */
+    int Size() const noexcept;
+
+private:
+    int n = 0;
+    bool factored = false;
+
+    // L按行存放，只使用下三角部分
+    std::vector<double> l;
+};
+
+/**
+ * 矩阵的行列平衡（equilibration）：求对角矩阵R、C，使R·A·C每行、每列绝对值最大的元素都落在[1, 2)之间。
+ * 与LAPACK的dgeequ相同，先按行缩放，再对缩放后的矩阵按列缩放。缩放因子取2的整数次幂，缩放本身不引入舍入误差。
+ * 用于量纲差异很大的方程组：主元的绝对阈值Config::Get().epsilon对缩放后的矩阵才有意义。
+ * 全为0的行、列的缩放因子为1。
+ */
+class Equilibration {
+public:
+    Equilibration() noexcept = default;
+
+    /**
+     * 构造并立即计算A的缩放因子。
+     */
+    explicit Equilibration(MatView A);
+
+    /**
+     * 计算A的缩放因子。之前的结果将被覆盖。
+     */
+    void Compute(MatView A);
+
+    /**
+     * 将A原地替换为R·A·C。A的尺寸必须与计算缩放因子时的矩阵相同。
+     */
+    void Apply(Mat &A) const noexcept;
+
+    /**
+     * 行缩放因子，即R的对角元，长度为Rows()。
+     */
+    VecView RowScale() const noexcept;
+
+    /**
+     * 列缩放因子，即C的对角元，长度为Cols()。
+     */
+    VecView ColScale() const noexcept;
+
+    /**
+     * 返回是否已经计算过缩放因子。
+     */
+    bool IsComputed() const noexcept;
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+private:
+    std::vector<double> r;
+    std::vector<double> c;
+};
+
 } // namespace tomsolver
@@ -2,15 +2,20 @@
 
 #include "config.h"
 #include "error_type.h"
+#include "kernels.h"
+#include "linear.h"
+#include "mat_view.h"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath> // std::abs
 #include <iterator>
+#include <memory>
 #include <sstream>
 #include <tuple>
 #include <valarray>
+#include <vector>
 
 namespace tomsolver {
 
@@ -61,67 +66,49 @@ double &Mat::Value(int i, int j) {
 }
 
 bool Mat::operator==(double m) const noexcept {
-    return std::all_of(std::begin(data), std::end(data), [m](auto val) {
-        return std::abs(val - m) < Config::Get().epsilon;
+    double eps = Config::Get().epsilon;
+    if (m == 0) {
+        return internal::AllAbsLess(static_cast<int>(data.size()), Data(), eps);
+    }
+    return std::all_of(std::begin(data), std::end(data), [m, eps](auto val) {
+        return std::abs(val - m) < eps;
     });
 }
 
 bool Mat::operator==(const Mat &b) const noexcept {
     assert(rows == b.rows);
     assert(cols == b.cols);
-    return std::all_of(std::begin(data), std::end(data), [iter = std::begin(b.data)](auto val) mutable {
-        return std::abs(val - *iter++) < Config::Get().epsilon;
-    });
-}
-
-// be negative
-Mat Mat::operator-() noexcept {
-    return {rows, cols, -data};
-}
-
-Mat Mat::operator+(const Mat &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == b.cols);
-    return {rows, cols, data + b.data};
+    return internal::AllAbsDiffLess(static_cast<int>(data.size()), Data(), b.Data(),
+                                    Config::Get().epsilon);
 }
 
 Mat &Mat::operator+=(const Mat &b) noexcept {
     assert(rows == b.rows);
     assert(cols == b.cols);
-    data += b.data;
+    internal::ScaledAdd(static_cast<int>(data.size()), Data(), 1.0, b.Data(), Data());
     return *this;
 }
 
-Mat Mat::operator-(const Mat &b) const noexcept {
+Mat &Mat::operator-=(const Mat &b) noexcept {
     assert(rows == b.rows);
     assert(cols == b.cols);
-    return {rows, cols, data - b.data};
+    internal::ScaledAdd(static_cast<int>(data.size()), Data(), -1.0, b.Data(), Data());
+    return *this;
 }
 
-Mat Mat::operator*(double m) const noexcept {
-    return {rows, cols, data * m};
+Mat &Mat::operator*=(double k) noexcept {
+    data *= k;
+    return *this;
 }
 
 Mat Mat::operator*(const Mat &b) const noexcept {
     assert(cols == b.rows);
     Mat ans(rows, b.cols);
-    for (auto i = 0; i < rows; ++i) {
-        for (auto j = 0; j < b.cols; ++j) {
-            ans.Value(i, j) = (Row(i) * b.Col(j)).sum();
-        }
-    }
+    internal::Gemm(rows, b.cols, cols, Data(), b.Data(), ans.Data());
     return ans;
 }
 
-int Mat::Rows() const noexcept {
-    return rows;
-}
-
-int Mat::Cols() const noexcept {
-    return cols;
-}
-
-Vec Mat::ToVec() const {
+Vec Mat::ToVec() const & {
     assert(rows > 0);
     if (cols != 1) {
         throw std::runtime_error("Mat::ToVec fail. rows is not one");
@@ -132,6 +119,14 @@ Vec Mat::ToVec() const {
     return v;
 }
 
+Vec Mat::ToVec() && {
+    assert(rows > 0);
+    if (cols != 1) {
+        throw std::runtime_error("Mat::ToVec fail. rows is not one");
+    }
+    return Vec(std::move(data));
+}
+
 Mat &Mat::SwapRow(int i, int j) noexcept {
     if (i == j) {
         return *this;
@@ -207,11 +202,12 @@ Mat &Mat::Ones() noexcept {
 }
 
 double Mat::Norm2() const noexcept {
-    return (data * data).sum();
+    auto p = Data();
+    return internal::Dot(static_cast<int>(data.size()), p, p);
 }
 
 double Mat::NormInfinity() const noexcept {
-    return std::abs(data).max();
+    return internal::AbsMax(static_cast<int>(data.size()), Data());
 }
 
 double Mat::NormNegInfinity() const noexcept {
@@ -228,12 +224,7 @@ void Mat::SetValue(double value) noexcept {
 
 bool Mat::PositiveDetermine() const noexcept {
     assert(rows == cols);
-    for (int i = 1; i <= rows; ++i) {
-        if (Det(*this, i) <= 0) {
-            return false;
-        }
-    }
-    return true;
+    return CholeskyFactorization(rows).Factor(*this);
 }
 
 Mat Mat::Transpose() const noexcept {
@@ -247,23 +238,19 @@ Mat Mat::Transpose() const noexcept {
 Mat Mat::Inverse() const {
     assert(rows == cols);
     int n = rows;
-    double det = Det(*this, n); // Determinant, 역행렬을 시킬 행렬의 행렬식을 구함
 
-    if (std::abs(det) <= Config::Get().epsilon) // 0일때는 예외처리 (역행렬을 구할 수 없기 때문.)
-    {
-        throw MathError(ErrorType::ERROR_SINGULAR_MATRIX);
+    // 分解一次，逐列求解 A * X(:, j) = I(:, j)
+    LUFactorization lu(n);
+    lu.Factor(*this);
+
+    // 结果直接写入ans的第j列
+    Mat ans(n, n);
+    Vec e(n);
+    for (int j = 0; j < n; ++j) {
+        e.Zero();
+        e[j] = 1;
+        lu.Solve(e, MutableVecView(std::addressof(ans.data[j]), n, n));
     }
-
-    Mat adj(n, n); // 딸림행렬 선언
-
-    Adjoint(*this, adj); // 딸림행렬 초기화
-
-    return {n, n, adj.data / det};
-}
-
-Mat operator*(double k, const Mat &mat) noexcept {
-    Mat ans(mat);
-    ans.data *= k;
     return ans;
 }
 
@@ -287,10 +274,13 @@ bool AllIsLessThan(const Mat &v1, const Mat &v2) noexcept {
 }
 
 int GetMaxAbsRowIndex(const Mat &A, int rowStart, int rowEnd, int col) noexcept {
-    std::valarray<double> temp =
-        std::valarray<double>(A.Col(col)[std::slice(rowStart, rowEnd - rowStart + 1, 1)]).apply(std::abs);
-    auto ret = std::distance(std::begin(temp), std::find(std::begin(temp), std::end(temp), temp.max())) + rowStart;
-    return static_cast<int>(ret);
+    int ret = rowStart;
+    for (int i = rowStart + 1; i <= rowEnd; ++i) {
+        if (std::abs(A.Value(i, col)) > std::abs(A.Value(ret, col))) {
+            ret = i;
+        }
+    }
+    return ret;
 }
 
 void Adjoint(const Mat &A, Mat &adj) noexcept // 딸림행렬, 수반행렬
@@ -376,39 +366,51 @@ double Det(const Mat &A, int n) noexcept {
         return 0;
     }
 
-    if (n == 1) {
-        return A.Value(0, 0);
-    }
-
-    if (n == 2) // 계산 압축
-    {
-        return A.Value(0, 0) * A.Value(1, 1) - A.Value(1, 0) * A.Value(0, 1);
+    // 对左上角n阶子矩阵做列主元消元，行列式等于主元之积，每交换一次行变一次号
+    std::vector<double> lu(n * n);
+    for (int i = 0; i < n; ++i) {
+        std::copy_n(std::addressof(A.Value(i, 0)), n, lu.data() + i * n);
     }
 
-    Mat cofactor(n - 1, n - 1); // n X n 행렬의 여인수를 담을 임시 행렬
+    double D = 1;
+    for (int k = 0; k < n; ++k) {
+        double *rowK = lu.data() + k * n;
 
-    double D = 0; // D = 한 행렬의 Determinant값
+        int maxAbsRowIndex = k;
+        for (int i = k + 1; i < n; ++i) {
+            if (std::abs(lu[i * n + k]) > std::abs(lu[maxAbsRowIndex * n + k])) {
+                maxAbsRowIndex = i;
+            }
+        }
 
-    int sign = 1; // sign = +, -, +, -.... 형태로 지속되는 결과값에 영향을 주는 정수
+        if (lu[maxAbsRowIndex * n + k] == 0) {
+            return 0;
+        }
 
-    for (int f = 0; f < n; f++) {
-        GetCofactor(A, cofactor, 0, f, n); // 0으로 고정시킨 이유는, 수학 공식 상 Determinant (행렬식)은 n개의 열 중
-        // 아무거나 잡아도 결과값은 모두 일치하기 때문
-        auto det = Det(cofactor, n - 1);
-        auto v = A.Value(0, f);
-        D += sign * v * det; // 재귀 형식으로 돌아간다. f는 n X n 중 정수 n을 향해 간다.
+        if (maxAbsRowIndex != k) {
+            std::swap_ranges(rowK, rowK + n, lu.data() + maxAbsRowIndex * n);
+            D = -D;
+        }
 
-        sign = -sign; // +, -, +, -... 형식으로 되기 때문에 반대로 만들어준다.
+        auto pivot = rowK[k];
+        D *= pivot;
+        for (int i = k + 1; i < n; ++i) {
+            double *rowI = lu.data() + i * n;
+            auto ratio = rowI[k] / pivot;
+            for (int j = k + 1; j < n; ++j) {
+                rowI[j] -= ratio * rowK[j];
+            }
+        }
     }
 
-    return D; // 마지막엔 n X n 행렬의 Determinant를 리턴해준다.
+    return D;
 }
 
 Vec::Vec(int rows, double initValue) noexcept : Mat(rows, 1, initValue) {}
 
 Vec::Vec(std::initializer_list<double> init) noexcept : Vec(std::valarray<double>{init}) {}
 
-Vec::Vec(std::valarray<double> init) noexcept : Vec(static_cast<int>(init.size())) {
+Vec::Vec(std::valarray<double> init) noexcept : Mat(static_cast<int>(init.size()), 1, std::valarray<double>()) {
     data = std::move(init);
 }
 
@@ -429,25 +431,6 @@ double Vec::operator[](std::size_t i) const noexcept {
     return data[i];
 }
 
-Vec Vec::operator+(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    assert(cols == 1 && b.cols == 1);
-    return {data + b.data};
-}
-
-Vec Vec::operator-() noexcept {
-    return {-data};
-}
-
-Vec Vec::operator-(const Vec &b) const noexcept {
-    assert(rows == b.rows);
-    return {data - b.data};
-}
-
-Vec Vec::operator*(double m) const noexcept {
-    return {data * m};
-}
-
 Vec Vec::operator*(const Vec &b) const noexcept {
     assert(rows == b.rows);
     return {data * b.data};
@@ -465,13 +448,18 @@ bool Vec::operator<(const Vec &b) noexcept {
     });
 }
 
-Vec operator*(double k, const Vec &v) {
-    return {v.data * k};
+Mat TransposeMultiply(const Mat &A) noexcept {
+    Mat ans(A.cols, A.cols);
+    internal::SyrkTranspose(A.rows, A.cols, A.Data(), ans.Data());
+    return ans;
 }
 
-double Dot(const Vec &a, const Vec &b) noexcept {
-    assert(a.rows == b.rows);
-    return (a.data * b.data).sum();
+Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept {
+    assert(A.rows == b.rows);
+    Vec ans(A.cols);
+    internal::GemvTranspose(A.rows, A.cols, A.Data(), b.Data(),
+                            ans.Data());
+    return ans;
 }
 
 std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept {
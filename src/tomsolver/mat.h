@@ -23,14 +23,114 @@ Original Inverse(), Adjoint(), GetCofactor(), Det() is from https://github.com/t
 #pragma once
 
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <valarray>
 
 namespace tomsolver {
 
+class Mat;
 class Vec;
 
+namespace internal {
+
+/**
+ * 所有矩阵表达式的公共基类，仅用于类型判断。
+ */
+struct MatExprTag {};
+
+} // namespace internal
+
+/**
+ * 逐元素矩阵表达式的基类（表达式模板）。MatView、VecView等视图也是矩阵表达式。
+ * Mat/Vec之间的+、-和数乘不立即计算，而是返回表达式对象。表达式被赋值给Mat/Vec时，
+ * 整条运算链在一个循环里逐元素求值，只分配一次结果的内存；赋值给已有的同尺寸对象时不分配内存。
+ *
+ * 表达式以引用保存作为左值的Mat/Vec，临时的Mat/Vec则被移动到表达式内部保存。
+ * 因此用auto保存表达式时，被引用的Mat/Vec必须在表达式求值前保持有效，且求值结果反映的是求值时的值。
+ * 表达式可以像Mat/Vec一样用[]取元素、调用ToVec()、参与点乘和比较。
+ * 需要立即得到结果时，赋值给Mat/Vec或调用Eval()。
+ */
+template <typename E>
+class MatExpr : public internal::MatExprTag {
+public:
+    const E &Derived() const noexcept {
+        return static_cast<const E &>(*this);
+    }
+
+    int Rows() const noexcept {
+        return Derived().Rows();
+    }
+
+    int Cols() const noexcept {
+        return Derived().Cols();
+    }
+
+    /**
+     * 按行连续存储的顺序，把表达式的值写入out。out可以与表达式引用的矩阵是同一块内存。
+     */
+    void EvalTo(double *out) const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        for (int i = 0; i < n; ++i) {
+            out[i] = e.Coeff(i);
+        }
+    }
+
+    /**
+     * 按行连续存储的顺序取第i个元素。
+     */
+    double operator[](int i) const noexcept {
+        return Derived().Coeff(i);
+    }
+
+    /**
+     * 计算表达式的值。
+     */
+    Mat Eval() const noexcept;
+
+    /**
+     * 计算表达式的值并输出Vec。如果列数不为1，抛出异常。
+     * @exception runtime_error 列数不为1
+     */
+    Vec ToVec() const;
+
+    /**
+     * 各元素的平方和，不生成中间矩阵。
+     */
+    double Norm2() const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            double v = e.Coeff(i);
+            ret += v * v;
+        }
+        return ret;
+    }
+
+    /**
+     * 各元素绝对值的最大值，不生成中间矩阵。出现nan时返回nan，与Mat::NormInfinity一致。
+     */
+    double NormInfinity() const noexcept {
+        const E &e = Derived();
+        int n = e.Rows() * e.Cols();
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            double a = std::abs(e.Coeff(i));
+            if (std::isnan(a)) {
+                return a;
+            }
+            ret = std::max(ret, a);
+        }
+        return ret;
+    }
+};
+
 class Mat {
 public:
     explicit Mat(int row, int col, double initValue = 0) noexcept;
@@ -39,11 +139,31 @@ public:
 
     Mat(int row, int col, std::valarray<double> data) noexcept;
 
+    /**
+     * 对表达式求值。
+     */
+    template <typename E>
+    Mat(const MatExpr<E> &expr) noexcept : rows(expr.Rows()), cols(expr.Cols()), data(rows * cols) {
+        expr.EvalTo(Data());
+    }
+
     Mat(const Mat &) = default;
     Mat(Mat &&) = default;
     Mat &operator=(const Mat &) = default;
     Mat &operator=(Mat &&) = default;
 
+    /**
+     * 对表达式求值。尺寸相同时直接写入已有的内存，不分配内存。
+     */
+    template <typename E>
+    Mat &operator=(const MatExpr<E> &expr) noexcept {
+        if (rows != expr.Rows() || cols != expr.Cols()) {
+            return *this = Mat(expr);
+        }
+        expr.EvalTo(Data());
+        return *this;
+    }
+
     std::slice_array<double> Row(int i, int offset = 0);
     std::slice_array<double> Col(int j, int offset = 0);
     auto Row(int i, int offset = 0) const -> decltype(std::declval<const std::valarray<double>>()[(std::slice{})]);
@@ -51,29 +171,69 @@ public:
     const double &Value(int i, int j) const;
     double &Value(int i, int j);
 
+    /**
+     * 按行连续存放的元素。空矩阵返回nullptr。
+     */
+    const double *Data() const noexcept {
+        return data.size() ? std::addressof(data[0]) : nullptr;
+    }
+
+    double *Data() noexcept {
+        return data.size() ? std::addressof(data[0]) : nullptr;
+    }
+
     bool operator==(double m) const noexcept;
     bool operator==(const Mat &b) const noexcept;
 
-    // be negative
-    Mat operator-() noexcept;
-
-    Mat operator+(const Mat &b) const noexcept;
     Mat &operator+=(const Mat &b) noexcept;
 
-    Mat operator-(const Mat &b) const noexcept;
+    template <typename E>
+    Mat &operator+=(const MatExpr<E> &expr) noexcept {
+        assert(rows == expr.Rows());
+        assert(cols == expr.Cols());
+        const E &e = expr.Derived();
+        for (int i = 0; i < rows * cols; ++i) {
+            data[i] += e.Coeff(i);
+        }
+        return *this;
+    }
+
+    Mat &operator-=(const Mat &b) noexcept;
+
+    template <typename E>
+    Mat &operator-=(const MatExpr<E> &expr) noexcept {
+        assert(rows == expr.Rows());
+        assert(cols == expr.Cols());
+        const E &e = expr.Derived();
+        for (int i = 0; i < rows * cols; ++i) {
+            data[i] -= e.Coeff(i);
+        }
+        return *this;
+    }
+
+    Mat &operator*=(double k) noexcept;
 
-    Mat operator*(double m) const noexcept;
     Mat operator*(const Mat &b) const noexcept;
 
-    int Rows() const noexcept;
+    int Rows() const noexcept {
+        return rows;
+    }
 
-    int Cols() const noexcept;
+    int Cols() const noexcept {
+        return cols;
+    }
 
     /**
      * 输出Vec。如果列数不为1，抛出异常。
      * @exception runtime_error 列数不为1
      */
-    Vec ToVec() const;
+    Vec ToVec() const &;
+
+    /**
+     * 输出Vec，直接移走自身的数据，不复制。如果列数不为1，抛出异常。
+     * @exception runtime_error 列数不为1
+     */
+    Vec ToVec() &&;
 
     Mat &SwapRow(int i, int j) noexcept;
     Mat &SwapCol(int i, int j) noexcept;
@@ -97,7 +257,7 @@ public:
     void SetValue(double value) noexcept;
 
     /**
-     * 返回矩阵是否正定。
+     * 返回矩阵是否正定。通过Cholesky分解判断，只使用矩阵的下三角部分，因此矩阵应当是对称矩阵。
      */
     bool PositiveDetermine() const noexcept;
 
@@ -114,7 +274,6 @@ protected:
     int cols;
     std::valarray<double> data;
 
-    friend Mat operator*(double k, const Mat &mat) noexcept;
     friend std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept;
     friend Mat EachDivide(const Mat &a, const Mat &b) noexcept;
     friend bool IsZero(const Mat &mat) noexcept;
@@ -122,10 +281,10 @@ protected:
     friend void GetCofactor(const Mat &A, Mat &temp, int p, int q, int n) noexcept;
     friend void Adjoint(const Mat &A, Mat &adj) noexcept;
     friend double Det(const Mat &A, int n) noexcept;
+    friend Mat TransposeMultiply(const Mat &A) noexcept;
+    friend Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept;
 };
 
-Mat operator*(double k, const Mat &mat) noexcept;
-
 std::ostream &operator<<(std::ostream &out, const Mat &mat) noexcept;
 
 Mat EachDivide(const Mat &a, const Mat &b) noexcept;
@@ -144,7 +303,7 @@ void Adjoint(const Mat &A, Mat &adj) noexcept;
 void GetCofactor(const Mat &A, Mat &temp, int p, int q, int n) noexcept;
 
 /**
- * 计算矩阵的行列式值。
+ * 计算矩阵左上角n阶子矩阵的行列式值。使用列主元消元，复杂度O(n³)。
  */
 double Det(const Mat &A, int n) noexcept;
 
@@ -156,6 +315,29 @@ public:
 
     Vec(std::valarray<double> data) noexcept;
 
+    /**
+     * 对表达式求值。表达式必须只有1列。
+     */
+    template <typename E>
+    Vec(const MatExpr<E> &expr) noexcept : Mat(expr) {
+        assert(cols == 1);
+    }
+
+    Vec(const Vec &) = default;
+    Vec(Vec &&) = default;
+    Vec &operator=(const Vec &) = default;
+    Vec &operator=(Vec &&) = default;
+
+    /**
+     * 对表达式求值。尺寸相同时直接写入已有的内存，不分配内存。
+     */
+    template <typename E>
+    Vec &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Cols() == 1);
+        Mat::operator=(expr);
+        return *this;
+    }
+
     Mat &AsMat() noexcept;
 
     void Resize(int newRows) noexcept;
@@ -164,28 +346,259 @@ public:
 
     double operator[](std::size_t i) const noexcept;
 
-    Vec operator+(const Vec &b) const noexcept;
+    Vec operator*(const Vec &b) const noexcept;
 
-    // be negative
-    Vec operator-() noexcept;
+    Vec operator/(const Vec &b) const noexcept;
 
-    Vec operator-(const Vec &b) const noexcept;
+    bool operator<(const Vec &b) noexcept;
+};
 
-    Vec operator*(double m) const noexcept;
+/**
+ * 计算AᵀA，不生成转置矩阵。
+ */
+Mat TransposeMultiply(const Mat &A) noexcept;
 
-    Vec operator*(const Vec &b) const noexcept;
+/**
+ * 计算Aᵀb，不生成转置矩阵。
+ */
+Vec TransposeMultiply(const Mat &A, const Vec &b) noexcept;
 
-    Vec operator/(const Vec &b) const noexcept;
+template <typename E>
+Mat MatExpr<E>::Eval() const noexcept {
+    return Mat(*this);
+}
 
-    bool operator<(const Vec &b) noexcept;
+template <typename E>
+Vec MatExpr<E>::ToVec() const {
+    if (Cols() != 1) {
+        throw std::runtime_error("MatExpr::ToVec fail. cols is not one");
+    }
+    return Vec(*this);
+}
 
-    friend double Dot(const Vec &a, const Vec &b) noexcept;
-    friend Vec operator*(double k, const Vec &V);
+/**
+ * 表达式与矩阵比较，先对表达式求值。
+ */
+template <typename E>
+bool operator==(const MatExpr<E> &a, const Mat &b) noexcept {
+    return b == a.Eval();
+}
+
+template <int N, int M>
+class FixedMat;
+
+namespace internal {
+
+/**
+ * 表达式中以引用保存的Mat/Vec。求值时才读取数据的地址，因此被引用的对象在此之前可以被重新赋值。
+ */
+class MatRef : public MatExpr<MatRef> {
+public:
+    explicit MatRef(const Mat &m) noexcept : m(m) {}
+
+    int Rows() const noexcept {
+        return m.Rows();
+    }
+
+    int Cols() const noexcept {
+        return m.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return m.Data()[i];
+    }
+
+private:
+    const Mat &m;
+};
+
+/**
+ * 表达式中以值保存的临时Mat/Vec。
+ */
+class MatValue : public MatExpr<MatValue> {
+public:
+    explicit MatValue(Mat &&m) noexcept : m(std::move(m)) {}
+
+    explicit MatValue(const Mat &m) noexcept : m(m) {}
+
+    int Rows() const noexcept {
+        return m.Rows();
+    }
+
+    int Cols() const noexcept {
+        return m.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return m.Data()[i];
+    }
+
+private:
+    Mat m;
+};
+
+struct PlusOp {
+    static double Apply(double a, double b) noexcept {
+        return a + b;
+    }
+};
+
+struct MinusOp {
+    static double Apply(double a, double b) noexcept {
+        return a - b;
+    }
+};
+
+/**
+ * 逐元素的二元运算。
+ */
+template <typename Op, typename L, typename R>
+class MatBinaryExpr : public MatExpr<MatBinaryExpr<Op, L, R>> {
+public:
+    MatBinaryExpr(L lhs, R rhs) noexcept : l(std::move(lhs)), r(std::move(rhs)) {
+        assert(l.Rows() == r.Rows());
+        assert(l.Cols() == r.Cols());
+    }
+
+    int Rows() const noexcept {
+        return l.Rows();
+    }
+
+    int Cols() const noexcept {
+        return l.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return Op::Apply(l.Coeff(i), r.Coeff(i));
+    }
+
+private:
+    L l;
+    R r;
+};
+
+/**
+ * 数乘。
+ */
+template <typename E>
+class MatScaleExpr : public MatExpr<MatScaleExpr<E>> {
+public:
+    MatScaleExpr(double k, E e) noexcept : k(k), e(std::move(e)) {}
+
+    int Rows() const noexcept {
+        return e.Rows();
+    }
+
+    int Cols() const noexcept {
+        return e.Cols();
+    }
+
+    double Coeff(int i) const noexcept {
+        return k * e.Coeff(i);
+    }
+
+private:
+    double k;
+    E e;
 };
 
+template <typename T>
+struct IsMatExpr : std::is_base_of<MatExprTag, std::decay_t<T>> {};
+
+template <typename T>
+struct IsMatOperand
+    : std::integral_constant<bool, std::is_base_of<Mat, std::decay_t<T>>::value || IsMatExpr<T>::value> {};
+
+template <typename T>
+struct IsFixedMat : std::false_type {};
+
+template <int N, int M>
+struct IsFixedMat<FixedMat<N, M>> : std::true_type {};
+
+/**
+ * 运算数都是FixedMat时使用fixed_mat.h中的重载，结果仍是FixedMat。
+ */
+template <typename L, typename R>
+using EnableIfMatOperands =
+    std::enable_if_t<IsMatOperand<L>::value && IsMatOperand<R>::value &&
+                     !(IsFixedMat<std::decay_t<L>>::value && IsFixedMat<std::decay_t<R>>::value)>;
+
+template <typename T>
+using EnableIfMatOperand = std::enable_if_t<IsMatOperand<T>::value && !IsFixedMat<std::decay_t<T>>::value>;
+
 /**
- * 向量点乘。
+ * 运算数在表达式中的保存方式：左值Mat/Vec保存引用，右值Mat/Vec保存值，表达式保存值。
  */
-double Dot(const Vec &a, const Vec &b) noexcept;
+template <typename T, bool = std::is_base_of<Mat, std::decay_t<T>>::value>
+struct MatOperand {
+    using type = std::decay_t<T>;
+};
 
-} // namespace tomsolver
\ No newline at end of file
+template <typename T>
+struct MatOperand<T &, true> {
+    using type = MatRef;
+};
+
+template <typename T>
+struct MatOperand<T, true> {
+    using type = MatValue;
+};
+
+template <typename T>
+using MatOperandT = typename MatOperand<T>::type;
+
+template <typename T>
+MatOperandT<T> MakeMatOperand(T &&t) noexcept {
+    return MatOperandT<T>(std::forward<T>(t));
+}
+
+} // namespace internal
+
+template <typename L, typename R, typename = internal::EnableIfMatOperands<L, R>>
+auto operator+(L &&l, R &&r) noexcept {
+    using Expr = internal::MatBinaryExpr<internal::PlusOp, internal::MatOperandT<L>, internal::MatOperandT<R>>;
+    return Expr(internal::MakeMatOperand(std::forward<L>(l)), internal::MakeMatOperand(std::forward<R>(r)));
+}
+
+template <typename L, typename R, typename = internal::EnableIfMatOperands<L, R>>
+auto operator-(L &&l, R &&r) noexcept {
+    using Expr = internal::MatBinaryExpr<internal::MinusOp, internal::MatOperandT<L>, internal::MatOperandT<R>>;
+    return Expr(internal::MakeMatOperand(std::forward<L>(l)), internal::MakeMatOperand(std::forward<R>(r)));
+}
+
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+auto operator*(double k, T &&m) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(k, internal::MakeMatOperand(std::forward<T>(m)));
+}
+
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+auto operator*(T &&m, double k) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(k, internal::MakeMatOperand(std::forward<T>(m)));
+}
+
+// be negative
+template <typename T, typename = internal::EnableIfMatOperand<T>>
+auto operator-(T &&m) noexcept {
+    return internal::MatScaleExpr<internal::MatOperandT<T>>(-1, internal::MakeMatOperand(std::forward<T>(m)));
+}
+
+/**
+ * 表达式与矩阵相乘（矩阵乘法）。
+ */
+template <typename E>
+Mat operator*(const MatExpr<E> &a, const Mat &b) noexcept {
+    return a.Eval() * b;
+}
+
+/**
+ * 表达式与向量相乘。与Mat/Vec的运算规则一致：表达式的列数等于向量的行数时为矩阵乘法，否则为逐元素相乘。
+ */
+template <typename E>
+Vec operator*(const MatExpr<E> &a, const Vec &b) noexcept {
+    if (a.Cols() == b.Rows()) {
+        return (a.Eval() * b).ToVec();
+    }
+    return Vec(a) * b;
+}
+
+} // namespace tomsolver
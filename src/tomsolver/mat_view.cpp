@@ -0,0 +1,140 @@
+#include "mat_view.h"
+
+#include "kernels.h"
+
+#include <cassert>
+
+namespace tomsolver {
+
+MatView::MatView(const double *data, int rows, int cols) noexcept : MatView(data, rows, cols, cols, 1) {}
+
+MatView::MatView(const double *data, int rows, int cols, int rowStride, int colStride) noexcept
+    : data(data), rows(rows), cols(cols), rowStride(rowStride), colStride(colStride) {
+    assert(rows >= 0);
+    assert(cols >= 0);
+}
+
+MatView::MatView(const Mat &mat) noexcept : MatView(mat.Data(), mat.Rows(), mat.Cols()) {}
+
+int MatView::RowStride() const noexcept {
+    return rowStride;
+}
+
+int MatView::ColStride() const noexcept {
+    return colStride;
+}
+
+const double *MatView::Data() const noexcept {
+    return data;
+}
+
+MatView MatView::Transpose() const noexcept {
+    return {data, cols, rows, colStride, rowStride};
+}
+
+MatView MatView::Block(int i, int j, int rows, int cols) const noexcept {
+    assert(i >= 0 && i + rows <= this->rows);
+    assert(j >= 0 && j + cols <= this->cols);
+    return {data + i * rowStride + j * colStride, rows, cols, rowStride, colStride};
+}
+
+VecView MatView::Row(int i) const noexcept {
+    assert(i >= 0 && i < rows);
+    return {data + i * rowStride, cols, colStride};
+}
+
+VecView MatView::Col(int j) const noexcept {
+    assert(j >= 0 && j < cols);
+    return {data + j * colStride, rows, rowStride};
+}
+
+VecView::VecView(const double *data, int size, int stride) noexcept : data(data), size(size), stride(stride) {
+    assert(size >= 0);
+}
+
+VecView::VecView(const Vec &v) noexcept : VecView(v.Data(), v.Rows()) {}
+
+VecView::VecView(const MutableVecView &v) noexcept : VecView(v.Data(), v.Size(), v.Stride()) {}
+
+int VecView::Size() const noexcept {
+    return size;
+}
+
+int VecView::Stride() const noexcept {
+    return stride;
+}
+
+const double *VecView::Data() const noexcept {
+    return data;
+}
+
+VecView VecView::Segment(int start, int size) const noexcept {
+    assert(start >= 0 && start + size <= this->size);
+    return {data + start * stride, size, stride};
+}
+
+MutableVecView::MutableVecView(double *data, int size, int stride) noexcept
+    : data(data), size(size), stride(stride) {
+    assert(size >= 0);
+}
+
+MutableVecView::MutableVecView(Vec &v) noexcept : MutableVecView(v.Data(), v.Rows()) {}
+
+MutableVecView &MutableVecView::operator=(const MutableVecView &v) noexcept {
+    return *this = VecView(v);
+}
+
+MutableVecView &MutableVecView::operator=(const Mat &m) noexcept {
+    assert(m.Cols() == 1);
+    return *this = MatView(m);
+}
+
+int MutableVecView::Size() const noexcept {
+    return size;
+}
+
+int MutableVecView::Stride() const noexcept {
+    return stride;
+}
+
+double *MutableVecView::Data() const noexcept {
+    return data;
+}
+
+MutableVecView MutableVecView::Segment(int start, int size) const noexcept {
+    assert(start >= 0 && start + size <= this->size);
+    return {data + start * stride, size, stride};
+}
+
+double Dot(VecView a, VecView b) noexcept {
+    assert(a.Size() == b.Size());
+    if (a.IsContiguous() && b.IsContiguous()) {
+        return internal::Dot(a.Size(), a.Data(), b.Data());
+    }
+    double ret = 0;
+    for (int i = 0; i < a.Size(); ++i) {
+        ret += a[i] * b[i];
+    }
+    return ret;
+}
+
+void ScaledAdd(VecView x, double alpha, VecView y, MutableVecView out) noexcept {
+    assert(x.Size() == y.Size());
+    assert(x.Size() == out.Size());
+    if (x.IsContiguous() && y.IsContiguous() && out.IsContiguous()) {
+        internal::ScaledAdd(x.Size(), x.Data(), alpha, y.Data(), out.Data());
+        return;
+    }
+    for (int i = 0; i < x.Size(); ++i) {
+        out[i] = x[i] + alpha * y[i];
+    }
+}
+
+void Scale(double alpha, VecView x, MutableVecView out) noexcept {
+    assert(x.Size() == out.Size());
+    for (int i = 0; i < x.Size(); ++i) {
+        out[i] = alpha * x[i];
+    }
+}
+
+} // namespace tomsolver
\ No newline at end of file
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "mat.h"
+
+#include <cassert>
+
+namespace tomsolver {
+
+/*
+ * 不拥有内存的矩阵、向量视图。
+ * 视图只保存首元素地址、尺寸和步长，可以指向Mat/Vec的内存，也可以指向调用者自己管理的数组，
+ * 构造和复制都不申请堆内存。视图在使用期间，被指向的内存必须保持有效。
+ * 视图也是矩阵表达式，可以直接参与+、-、数乘运算，或者赋值给Mat/Vec。
+ */
+
+class VecView;
+
+/**
+ * 只读的矩阵视图。元素(i, j)位于data[i * rowStride + j * colStride]。
+ */
+class MatView : public MatExpr<MatView> {
+public:
+    /**
+     * 按行连续存储的rows×cols矩阵。
+     */
+    MatView(const double *data, int rows, int cols) noexcept;
+
+    MatView(const double *data, int rows, int cols, int rowStride, int colStride) noexcept;
+
+    MatView(const Mat &mat) noexcept;
+
+    int Rows() const noexcept {
+        return rows;
+    }
+
+    int Cols() const noexcept {
+        return cols;
+    }
+
+    int RowStride() const noexcept;
+
+    int ColStride() const noexcept;
+
+    const double *Data() const noexcept;
+
+    double Value(int i, int j) const noexcept {
+        return data[i * rowStride + j * colStride];
+    }
+
+    /**
+     * 按行连续存储的顺序访问第i个元素。
+     */
+    double Coeff(int i) const noexcept {
+        if (IsContiguous()) {
+            return data[i];
+        }
+        return Value(i / cols, i % cols);
+    }
+
+    /**
+     * 返回是否按行连续存储。
+     */
+    bool IsContiguous() const noexcept {
+        return rowStride == cols && colStride == 1;
+    }
+
+    /**
+     * 转置视图，不复制数据。
+     */
+    MatView Transpose() const noexcept;
+
+    /**
+     * 从(i, j)开始的rows×cols子矩阵视图。
+     */
+    MatView Block(int i, int j, int rows, int cols) const noexcept;
+
+    VecView Row(int i) const noexcept;
+
+    VecView Col(int j) const noexcept;
+
+private:
+    const double *data;
+    int rows;
+    int cols;
+    int rowStride;
+    int colStride;
+};
+
+class MutableVecView;
+
+/**
+ * 只读的向量视图。第i个元素位于data[i * stride]。
+ */
+class VecView : public MatExpr<VecView> {
+public:
+    VecView(const double *data, int size, int stride = 1) noexcept;
+
+    VecView(const Vec &v) noexcept;
+
+    VecView(const MutableVecView &v) noexcept;
+
+    int Rows() const noexcept {
+        return size;
+    }
+
+    int Cols() const noexcept {
+        return 1;
+    }
+
+    int Size() const noexcept;
+
+    int Stride() const noexcept;
+
+    const double *Data() const noexcept;
+
+    double operator[](int i) const noexcept {
+        return data[i * stride];
+    }
+
+    double Coeff(int i) const noexcept {
+        return data[i * stride];
+    }
+
+    bool IsContiguous() const noexcept {
+        return stride == 1;
+    }
+
+    /**
+     * 从start开始、长度为size的子向量视图。
+     */
+    VecView Segment(int start, int size) const noexcept;
+
+private:
+    const double *data;
+    int size;
+    int stride;
+};
+
+/**
+ * 可写的向量视图，用于把结果直接写入调用者的内存。
+ * 与std::slice_array一样，赋值操作复制元素，而不是让视图指向别处。
+ */
+class MutableVecView : public MatExpr<MutableVecView> {
+public:
+    MutableVecView(double *data, int size, int stride = 1) noexcept;
+
+    MutableVecView(Vec &v) noexcept;
+
+    MutableVecView(const MutableVecView &) = default;
+
+    /**
+     * 逐元素复制v的值。
+     */
+    MutableVecView &operator=(const MutableVecView &v) noexcept;
+
+    /**
+     * 逐元素复制列向量m的值。
+     */
+    MutableVecView &operator=(const Mat &m) noexcept;
+
+    /**
+     * 对表达式逐元素求值并写入视图。表达式可以引用视图自身的元素。
+     */
+    template <typename E>
+    MutableVecView &operator=(const MatExpr<E> &expr) noexcept {
+        assert(expr.Rows() == size);
+        assert(expr.Cols() == 1);
+        const E &e = expr.Derived();
+        for (int i = 0; i < size; ++i) {
+            data[i * stride] = e.Coeff(i);
+        }
+        return *this;
+    }
+
+    int Rows() const noexcept {
+        return size;
+    }
+
+    int Cols() const noexcept {
+        return 1;
+    }
+
+    int Size() const noexcept;
+
+    int Stride() const noexcept;
+
+    double *Data() const noexcept;
+
+    double &operator[](int i) const noexcept {
+        return data[i * stride];
+    }
+
+    double Coeff(int i) const noexcept {
+        return data[i * stride];
+    }
+
+    bool IsContiguous() const noexcept {
+        return stride == 1;
+    }
+
+    MutableVecView Segment(int start, int size) const noexcept;
+
+private:
+    double *data;
+    int size;
+    int stride;
+};
+
+/**
+ * 向量点乘。
+ */
+double Dot(VecView a, VecView b) noexcept;
+
+namespace internal {
+
+/**
+ * 不能直接转换为VecView的表达式（如a - b）时启用。视图使用上面的重载。
+ */
+template <typename E>
+using EnableIfNotVecView = std::enable_if_t<!std::is_convertible<const E &, VecView>::value>;
+
+} // namespace internal
+
+/**
+ * 向量表达式与向量点乘，逐元素求值，不生成中间向量。
+ */
+template <typename E, typename = internal::EnableIfNotVecView<E>>
+double Dot(const MatExpr<E> &a, VecView b) noexcept {
+    assert(a.Rows() == b.Size());
+    assert(a.Cols() == 1);
+    const E &e = a.Derived();
+    double ret = 0;
+    for (int i = 0; i < b.Size(); ++i) {
+        ret += e.Coeff(i) * b[i];
+    }
+    return ret;
+}
+
+template <typename E, typename = internal::EnableIfNotVecView<E>>
+double Dot(VecView a, const MatExpr<E> &b) noexcept {
+    return Dot(b, a);
+}
+
+template <typename L, typename R, typename = internal::EnableIfNotVecView<L>,
+          typename = internal::EnableIfNotVecView<R>>
+double Dot(const MatExpr<L> &a, const MatExpr<R> &b) noexcept {
+    assert(a.Rows() == b.Rows());
+    assert(a.Cols() == 1);
+    assert(b.Cols() == 1);
+    const L &l = a.Derived();
+    const R &r = b.Derived();
+    double ret = 0;
+    for (int i = 0; i < a.Rows(); ++i) {
+        ret += l.Coeff(i) * r.Coeff(i);
+    }
+    return ret;
+}
+
+/**
+ * out = x + alpha * y，不产生临时对象。out可以与x或y指向同一块内存（步长也相同）。
+ */
+void ScaledAdd(VecView x, double alpha, VecView y, MutableVecView out) noexcept;
+
+/**
+ * out = alpha * x，不产生临时对象。out可以与x指向同一块内存（步长也相同）。
+ */
+void Scale(double alpha, VecView x, MutableVecView out) noexcept;
+
+} // namespace tomsolver
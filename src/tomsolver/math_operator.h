@@ -1,9 +1,15 @@
 #pragma once
 
+#include "config.h"
+
 #include <string>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include <cassert>
+#include <cmath>
+#include <limits>
+
 namespace tomsolver {
 
 constexpr double PI = M_PI;
@@ -88,6 +94,249 @@ bool IsFunction(MathOperator op) noexcept;
  */
 bool IsIntAndEven(double n) noexcept;
 
+namespace internal {
+
+/**
+ * 抛出ERROR_INVALID_NUMBER异常，异常信息中包含出错的运算式。
+ * @exception MathError 总是抛出
+ */
+void ThrowInvalidNumber(MathOperator op, double v1, double v2);
+
+} // namespace internal
+
+/**
+ * 以标量类型T（float、double、long double）计算运算符op。一元运算符忽略v2。
+ * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+ */
+template <typename T>
+T Calc(MathOperator op, T v1, T v2) {
+    T ret = std::numeric_limits<T>::quiet_NaN();
+    switch (op) {
+    case MathOperator::MATH_SIN:
+        ret = std::sin(v1);
+        break;
+    case MathOperator::MATH_COS:
+        ret = std::cos(v1);
+        break;
+    case MathOperator::MATH_TAN:
+        ret = std::tan(v1);
+        break;
+    case MathOperator::MATH_ARCSIN:
+        ret = std::asin(v1);
+        break;
+    case MathOperator::MATH_ARCCOS:
+        ret = std::acos(v1);
+        break;
+    case MathOperator::MATH_ARCTAN:
+        ret = std::atan(v1);
+        break;
+    case MathOperator::MATH_SQRT:
+        ret = std::sqrt(v1);
+        break;
+    case MathOperator::MATH_LOG:
+        ret = std::log(v1);
+        break;
+    case MathOperator::MATH_LOG2:
+        ret = std::log2(v1);
+        break;
+    case MathOperator::MATH_LOG10:
+        ret = std::log10(v1);
+        break;
+    case MathOperator::MATH_EXP:
+        ret = std::exp(v1);
+        break;
+    case MathOperator::MATH_POSITIVE:
+        ret = v1;
+        break;
+    case MathOperator::MATH_NEGATIVE:
+        ret = -v1;
+        break;
+
+    case MathOperator::MATH_MOD: //%
+        ret = static_cast<T>(static_cast<int>(v1) % static_cast<int>(v2));
+        break;
+    case MathOperator::MATH_AND: //&
+        ret = static_cast<T>(static_cast<int>(v1) & static_cast<int>(v2));
+        break;
+    case MathOperator::MATH_OR: //|
+        ret = static_cast<T>(static_cast<int>(v1) | static_cast<int>(v2));
+        break;
+
+    case MathOperator::MATH_POWER: //^
+        ret = std::pow(v1, v2);
+        break;
+
+    case MathOperator::MATH_ADD:
+        ret = v1 + v2;
+        break;
+    case MathOperator::MATH_SUB:
+        ret = v1 - v2;
+        break;
+    case MathOperator::MATH_MULTIPLY:
+        ret = v1 * v2;
+        break;
+    case MathOperator::MATH_DIVIDE:
+        ret = v1 / v2;
+        break;
+    default:
+        assert(0 && "[Calc] bug.");
+        break;
+    }
+
+    if (Config::Get().throwOnInvalidValue && !std::isfinite(ret)) {
+        internal::ThrowInvalidNumber(op, static_cast<double>(v1), static_cast<double>(v2));
+    }
+
+    return ret;
+}
+
+/**
+ * 以double计算运算符op，参数可以是int等能隐式转换为double的类型。一元运算符忽略v2。
+ * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+ */
 double Calc(MathOperator op, double v1, double v2);
 
+/**
+ * Calc的W路版本：对l = 0..W-1计算v1[l] = op(v1[l], v2[l])，一元运算符忽略v2。
+ * 运算符的分支在循环外，各路的计算连续进行，编译器可以将其向量化。
+ * 不抛出异常：结果为浮点数无效值(inf, -inf, nan)的路将invalid[l]置为true，其余路不受影响。
+ * 与Calc不同，%、&、|的操作数不是有限值或者超出int的范围、以及对0取模时，结果为nan，而不是未定义行为。
+ */
+template <int W>
+void CalcLanes(MathOperator op, double *v1, const double *v2, bool *invalid) noexcept {
+    auto unary = [v1](auto fn) {
+        for (int l = 0; l < W; ++l) {
+            v1[l] = fn(v1[l]);
+        }
+    };
+    auto binary = [v1, v2](auto fn) {
+        for (int l = 0; l < W; ++l) {
+            v1[l] = fn(v1[l], v2[l]);
+        }
+    };
+    auto integer = [v1, v2](auto fn) {
+        const double limit = 2147483648.0; // 2^31，|v| < limit时截断为int不会溢出，nan不满足
+        for (int l = 0; l < W; ++l) {
+            bool inRange = std::abs(v1[l]) < limit && std::abs(v2[l]) < limit;
+            v1[l] = inRange ? fn(static_cast<int>(v1[l]), static_cast<int>(v2[l]))
+                            : std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+    switch (op) {
+    case MathOperator::MATH_SIN:
+        unary([](double v) {
+            return std::sin(v);
+        });
+        break;
+    case MathOperator::MATH_COS:
+        unary([](double v) {
+            return std::cos(v);
+        });
+        break;
+    case MathOperator::MATH_TAN:
+        unary([](double v) {
+            return std::tan(v);
+        });
+        break;
+    case MathOperator::MATH_ARCSIN:
+        unary([](double v) {
+            return std::asin(v);
+        });
+        break;
+    case MathOperator::MATH_ARCCOS:
+        unary([](double v) {
+            return std::acos(v);
+        });
+        break;
+    case MathOperator::MATH_ARCTAN:
+        unary([](double v) {
+            return std::atan(v);
+        });
+        break;
+    case MathOperator::MATH_SQRT:
+        unary([](double v) {
+            return std::sqrt(v);
+        });
+        break;
+    case MathOperator::MATH_LOG:
+        unary([](double v) {
+            return std::log(v);
+        });
+        break;
+    case MathOperator::MATH_LOG2:
+        unary([](double v) {
+            return std::log2(v);
+        });
+        break;
+    case MathOperator::MATH_LOG10:
+        unary([](double v) {
+            return std::log10(v);
+        });
+        break;
+    case MathOperator::MATH_EXP:
+        unary([](double v) {
+            return std::exp(v);
+        });
+        break;
+    case MathOperator::MATH_POSITIVE:
+        break;
+    case MathOperator::MATH_NEGATIVE:
+        unary([](double v) {
+            return -v;
+        });
+        break;
+
+    case MathOperator::MATH_MOD: //%
+        integer([](int a, int b) {
+            return b == 0 ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(a % b);
+        });
+        break;
+    case MathOperator::MATH_AND: //&
+        integer([](int a, int b) {
+            return static_cast<double>(a & b);
+        });
+        break;
+    case MathOperator::MATH_OR: //|
+        integer([](int a, int b) {
+            return static_cast<double>(a | b);
+        });
+        break;
+
+    case MathOperator::MATH_POWER: //^
+        binary([](double a, double b) {
+            return std::pow(a, b);
+        });
+        break;
+
+    case MathOperator::MATH_ADD:
+        binary([](double a, double b) {
+            return a + b;
+        });
+        break;
+    case MathOperator::MATH_SUB:
+        binary([](double a, double b) {
+            return a - b;
+        });
+        break;
+    case MathOperator::MATH_MULTIPLY:
+        binary([](double a, double b) {
+            return a * b;
+        });
+        break;
+    case MathOperator::MATH_DIVIDE:
+        binary([](double a, double b) {
+            return a / b;
+        });
+        break;
+    default:
+        assert(0 && "[CalcLanes] bug.");
+        break;
+    }
+
+    // 有限值x满足x - x == 0，inf和nan不满足
+    for (int l = 0; l < W; ++l) {
+        invalid[l] = invalid[l] || !(v1[l] - v1[l] == 0);
+    }
+}
+
 } // namespace tomsolver
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "multi_start.h"
+
+#include "compiled_symmat.h"
+#include "config.h"
+#include "convergence.h"
+#include "error_type.h"
+#include "nonlinear.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace tomsolver {
+
+std::vector<VarsTable> SolveMultiStart(const SymVec &equations, const std::vector<VarsTable> &starts,
+                                       const MultiStartOptions &options) {
+    if (starts.empty()) {
+        return {};
+    }
+    const std::vector<std::string> &vars = starts[0].Vars();
+    for (auto &start : starts) {
+        if (start.Vars() != vars) {
+            throw MathError(ErrorType::SIZE_NOT_MATCH, "all starts must have the same variables");
+        }
+    }
+
+    // 符号求导与编译只做一次，CompiledSymMat求值不修改自身，各线程共享
+    CompiledSymMat f(equations, vars);
+    CompiledSymMat df(Jacobian(equations, vars), vars);
+    NonlinearMethod method = Config::Get().nonlinearMethod;
+    bool first = options.mode == MultiStartMode::FIRST_CONVERGED;
+
+    int count = static_cast<int>(starts.size());
+    std::vector<Vec> results;
+    results.reserve(count);
+    for (auto &start : starts) {
+        results.push_back(start.Values());
+    }
+    std::vector<char> converged(count, 0); // 每个元素只由一个线程写入
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> winner{-1};
+
+    // 求解失败以外的异常（例如内存不足）由ParallelFor在所有线程结束后重新抛出
+    internal::ParallelFor(count, options.threads, [&](int, int k) {
+        if (cancelled.load()) {
+            return;
+        }
+
+        ConvergenceMonitor monitor;
+        monitor.SetCancelFlag(&cancelled);
+        try {
+            internal::SolveCompiled(method, f, df, results[k], monitor);
+            converged[k] = 1;
+            if (first) {
+                int none = -1;
+                winner.compare_exchange_strong(none, k);
+                cancelled = true;
+            }
+        } catch (const std::runtime_error &) {
+            // 这个初值没有收敛，或者被取消
+        } catch (...) {
+            cancelled = true;
+            throw;
+        }
+    });
+
+    std::vector<VarsTable> roots;
+    if (first) {
+        if (winner >= 0) {
+            roots.emplace_back(vars, results[winner]);
+        }
+        return roots;
+    }
+
+    std::vector<int> distinct; // 互不相同的根对应的初值下标
+    for (int k = 0; k < count; ++k) {
+        if (!converged[k]) {
+            continue;
+        }
+        bool duplicate = std::any_of(distinct.begin(), distinct.end(), [&](int d) {
+            for (int i = 0; i < results[k].Rows(); ++i) {
+                if (!(std::abs(results[k][i] - results[d][i]) < options.rootTolerance)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        if (!duplicate) {
+            distinct.push_back(k);
+            roots.emplace_back(vars, results[k]);
+        }
+    }
+    return roots;
+}
+
+} // namespace tomsolver
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "symmat.h"
+#include "vars_table.h"
+
+#include <vector>
+
+namespace tomsolver {
+
+enum class MultiStartMode {
+    FIRST_CONVERGED, // 第一个收敛的初值得到的根，其余初值的求解随即取消
+    ALL_ROOTS        // 所有初值得到的互不相同的根
+};
+
+/**
+ * 多初值求解的选项。
+ */
+struct MultiStartOptions {
+    MultiStartMode mode = MultiStartMode::ALL_ROOTS;
+
+    /**
+     * 工作线程数量（包括调用者所在的线程）。为0时取std::thread::hardware_concurrency()。不超过初值数量。
+     */
+    int threads = 0;
+
+    /**
+     * 两个根的每个分量之差的绝对值都小于rootTolerance时，视为同一个根。
+     */
+    double rootTolerance = 1.0e-6;
+};
+
+/**
+ * 从多个初值出发独立地求解非线性方程组equations，各初值的求解分配到多个线程中并行进行。
+ * 方程组与雅可比矩阵只做一次符号求导和编译，各线程只读共享。求解方法为Config::Get().nonlinearMethod，
+ * 具体见internal::SolveCompiled。各工作线程都使用调用者所在线程的Config::Get()（见ConfigScope）。
+ * 没有收敛的初值（迭代次数超出限制、雅可比矩阵奇异、超出定义域、发散、停滞等）不影响其他初值，直接忽略。
+ * @param starts: 初值。所有初值的变量及其顺序必须相同
+ * @return FIRST_CONVERGED模式下最多一个根；ALL_ROOTS模式下为去重后的所有根，按得到该根的第一个初值的顺序排列。
+ *         没有初值收敛时为空
+ * @exception MathError 初值的变量不一致
+ */
+std::vector<VarsTable> SolveMultiStart(const SymVec &equations, const std::vector<VarsTable> &starts,
+                                       const MultiStartOptions &options = {});
+
+} // namespace tomsolver
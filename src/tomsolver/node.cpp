@@ -159,6 +159,11 @@ double NodeImpl::Vpa() const {
     return VpaNonRecursively();
 }
 
+double NodeImpl::Vpa(const SolverOptions &options) const {
+    ConfigScope scope(options);
+    return VpaNonRecursively();
+}
+
 NodeImpl &NodeImpl::Calc() {
     auto d = Vpa();
     *this = {};
@@ -1,4 +1,5 @@
 #pragma once
+#include "config.h"
 #include "math_operator.h"
 
 #include <cassert>
@@ -62,6 +63,13 @@ struct NodeImpl {
      */
     double Vpa() const;
 
+    /**
+     * 以options代替Config::Get()计算出整个表达式的数值。不改变自身。
+     * @exception runtime_error 如果有变量存在，则无法计算
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且options.throwOnInvalidValue为true
+     */
+    double Vpa(const SolverOptions &options) const;
+
     /**
      * 计算出整个表达式的数值。不改变自身。
      * @exception runtime_error 如果有变量存在，则无法计算
@@ -146,6 +154,7 @@ private:
     friend class DiffFunctions;
     friend class SubsFunctions;
     friend class ParseFunctions;
+    friend class CompileFunctions;
 };
 
 Node CloneRecursively(const Node &rhs) noexcept;
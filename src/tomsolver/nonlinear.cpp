@@ -2,10 +2,16 @@
 
 #include "config.h"
 #include "error_type.h"
+#include "kernels.h"
 #include "linear.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <utility>
 
 using std::cout;
 using std::endl;
@@ -14,22 +20,40 @@ using std::runtime_error;
 namespace tomsolver {
 
 double Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df) {
-    double alpha = 1;   // a > 0
+    double alpha = 0;
+    return Armijo(x, d, std::move(f), std::move(df), alpha) ? alpha : 0;
+}
+
+bool Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df, double &alpha) {
+    alpha = 1;          // a > 0
     double gamma = 0.4; // 取值范围(0, 0.5)越大越快
     double sigma = 0.5; // 取值范围(0, 1)越大越慢
+
+    // f(x)与df(x)ᵀd在搜索过程中不变，只计算一次
+    Vec fx = f(x);
+    Mat slope = df(x).Transpose() * d;
+
     Vec x_new(x);
-    while (1) {
-        x_new = x + alpha * d;
+    for (int i = 0; i < LineSearch::MAX_BACKTRACKING; ++i) {
+        ScaledAdd(x, alpha, d, x_new);
 
-        auto l = f(x_new).Norm2();
-        auto r = (f(x).AsMat() + gamma * alpha * df(x).Transpose() * d).Norm2();
+        double l = std::numeric_limits<double>::quiet_NaN();
+        try {
+            l = f(x_new).Norm2();
+        } catch (const MathError &err) {
+            // 试探点超出定义域，视为步长过大
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                throw;
+            }
+        }
+        double r = (fx.AsMat() + gamma * alpha * slope).Norm2();
         if (l <= r) // 检验条件
         {
-            break;
-        } else
-            alpha = alpha * sigma; // 缩小alpha，进入下一次循环
+            return true;
+        }
+        alpha = alpha * sigma; // 缩小alpha，进入下一次循环
     }
-    return alpha;
+    return false;
 }
 
 double FindAlpha(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, double uncert) {
@@ -90,12 +114,37 @@ VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &varsTab
     int it = 0; // 迭代计数
     VarsTable table = varsTable;
     int n = table.VarNums(); // 未知量数量
-    Vec q(n);                // x向量
+    Vec q = table.Values();  // x向量
     internal::PrintSolveStartInfo(equations, varsTable);
 
     SymMat JaEqs = Jacobian(equations, table.Vars());
     internal::PrintJacobian(JaEqs);
 
+    // 弦方法：雅可比矩阵为方阵时，复用上一次的LU分解结果，直到收缩率变差
+    bool chord = Config::Get().reuseJacobian && JaEqs.Rows() == n;
+    // 混合精度：单精度分解雅可比矩阵，迭代修正得到双精度的牛顿步
+    bool mixed = Config::Get().mixedPrecision && JaEqs.Rows() == n;
+    // 行列平衡：求解(R·J·C)·z = R·phi，-Δq = C·z
+    bool equilibrate = Config::Get().equilibrate && JaEqs.Rows() == n;
+    Equilibration eq;
+    Mat ja(JaEqs.Rows(), n);
+    Vec rhs(JaEqs.Rows()); // R·phi
+    LUFactorization lu;
+    MixedPrecisionLUFactorization mlu;
+    double phiNorm = 0; // 上一次迭代的||phi||
+    Vec deltaq(n);      // -Δq
+    Vec grad(n);        // Jᵀphi，J为当前q处未经缩放的雅可比矩阵
+    ConvergenceMonitor monitor;
+
+    // 一维搜索：沿牛顿方向回溯，避免||phi||增大或者试探点超出定义域
+    LineSearchMethod lineSearchMethod = Config::Get().lineSearch;
+    std::unique_ptr<CompiledSymMat> f;
+    std::unique_ptr<LineSearch> lineSearch;
+    if (lineSearchMethod != LineSearchMethod::NONE) {
+        f = std::make_unique<CompiledSymMat>(equations, table.Vars());
+        lineSearch = std::make_unique<LineSearch>(n, equations.Rows());
+    }
+
     while (1) {
         internal::PrintAtIterationStart(it);
 
@@ -104,23 +153,98 @@ VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &varsTab
             cout << "phi = \n" + phi.ToString();
         }
 
-        if (phi == 0) {
+        if (monitor.Check(it, phi)) {
             break;
         }
 
         if (it > Config::Get().maxIterations) {
-            throw runtime_error("迭代次数超出限制");
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
         }
 
-        Mat ja = JaEqs.Clone().Subs(table).Calc().ToMat();
+        double newPhiNorm = std::sqrt(phi.Norm2());
+        bool factored = mixed ? mlu.IsFactored() : lu.IsFactored();
+        bool refresh = !chord || !factored || newPhiNorm > Config::Get().jacobianRefreshRatio * phiNorm;
+        phiNorm = newPhiNorm;
+        double stepNorm = 0; // 实际走过的||Δq||
 
         try {
-            Vec deltaq = SolveLinear(ja, -phi);
+            if (refresh) {
+                ja = JaEqs.Clone().Subs(table).Calc().ToMat();
+                if (Config::Get().logLevel >= LogLevel::TRACE) {
+                    cout << "ja = " << ja << endl;
+                }
+
+                // ja随后会被缩放或者移走，先算好一维搜索需要的Jᵀphi
+                if (lineSearch) {
+                    grad = TransposeMultiply(ja, phi);
+                }
+
+                // 复用分解结果时，缩放因子与分解结果一起更新
+                if (equilibrate) {
+                    if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                        eq.Compute(ja);
+                    }
+                    eq.Apply(ja);
+                }
+
+                if (mixed) {
+                    mlu.Factor(ja);
+                } else if (chord) {
+                    lu.Factor(ja);
+                }
+            }
+
+            rhs = phi;
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    rhs[i] *= eq.RowScale()[i];
+                }
+            }
+
+            // 这里求解的是 ja * (-Δq) = phi，复用分解结果时不申请新的内存
+            if (mixed) {
+                mlu.Solve(rhs, deltaq);
+            } else if (chord) {
+                lu.Solve(rhs, deltaq);
+            } else {
+                deltaq = SolveLinear(std::move(ja), rhs);
+            }
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i] *= eq.ColScale()[i];
+                }
+            }
+
             if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "deltaq = " << deltaq << endl;
+                cout << "deltaq = " << -deltaq << endl;
             }
 
-            q += deltaq;
+            // 沿方向d = -deltaq搜索，φ'(0) = phiᵀJd = (Jᵀphi)ᵀd。
+            // 最小二乘解、近似分解等情况下Jd ≠ -phi，所以用当前的J计算；弦方法复用旧分解的步骤没有当前的J，
+            // 不做一维搜索（收缩率变差时会重新计算雅可比矩阵）。d不是下降方向或搜索失败时仍然走完整的一步
+            double dphi0 = 0;
+            if (lineSearch && refresh) {
+                dphi0 = -Dot(grad, deltaq);
+            }
+            if (dphi0 < 0) {
+                deltaq = -deltaq;
+                auto eval = [&](VecView x, Vec &out) {
+                    f->Eval(x, out);
+                };
+                stepNorm = std::sqrt(deltaq.Norm2());
+                if (lineSearch->Search(lineSearchMethod, q, deltaq, phi.Norm2() / 2, dphi0, eval)) {
+                    if (Config::Get().logLevel >= LogLevel::TRACE) {
+                        cout << "alpha = " << lineSearch->Alpha() << endl;
+                    }
+                    q = lineSearch->X();
+                    stepNorm *= lineSearch->Alpha();
+                } else {
+                    q += deltaq;
+                }
+            } else {
+                q -= deltaq;
+                stepNorm = std::sqrt(deltaq.Norm2());
+            }
         } catch (const tomsolver::MathError &err) {
             if (err.GetErrorType() == ErrorType::ERROR_SINGULAR_MATRIX) {
                 throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
@@ -129,140 +253,937 @@ VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &varsTab
         }
 
         if (Config::Get().logLevel >= LogLevel::TRACE) {
-            cout << "ja = " << ja << endl;
             cout << "q = " << q << endl;
         }
 
         table.SetValues(q);
 
+        if (monitor.StepConverged(stepNorm, std::sqrt(q.Norm2()))) {
+            break;
+        }
+
         ++it;
     }
     return table;
 }
 
+namespace {
+
+/**
+ * 利用缓存的JᵀJ与JᵀF求解阻尼方程(JᵀJ + μD²)h = -JᵀF，结果写入h。
+ * 优先使用Cholesky分解；数值上不正定时，改为对增广方程组[J; √μD]h = [-F; 0]做QR分解，求最小二乘解。
+ */
+void SolveDampedSystem(const Mat &J, const Vec &F, const Mat &JtJ, const Vec &JtF, const Vec &dsq, double mu,
+                       Mat &A, CholeskyFactorization &chol, Vec &h) {
+    int m = J.Rows(), n = J.Cols();
+    A = JtJ;
+    for (int i = 0; i < n; ++i) {
+        A.Value(i, i) += mu * dsq[i];
+    }
+    if (chol.Factor(A)) {
+        chol.Solve(JtF, h);
+        h = -h;
+        return;
+    }
+
+    Mat aug(m + n, n);
+    Vec rhs(m + n);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            aug.Value(i, j) = J.Value(i, j);
+        }
+        rhs[i] = -F[i];
+    }
+    for (int i = 0; i < n; ++i) {
+        aug.Value(m + i, i) = std::sqrt(mu * dsq[i]);
+    }
+    h = QRFactorization(aug).Solve(rhs);
+}
+
+/**
+ * Levenberg-Marquardt迭代的主体，供SolveByLM与SolveByPolyalgorithm共用。从q开始迭代，返回时q为解。
+ * it为之前已经用掉的迭代次数，monitor为之前使用的收敛判断，都继续累计。
+ * eq为行列平衡的缩放因子，已经计算过时沿用（与之前的牛顿迭代使用同一个||R·F||）。
+ * checked为true表示q处的F已经由调用者交给monitor检查过，第一次迭代不再重复检查。
+ */
+void IterateLM(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int it, ConvergenceMonitor &monitor,
+               Equilibration &eq, bool checked) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Vec Fs(m);         // R·F
+    Mat J(m, n);       // 当前点的雅可比矩阵
+    Mat JtJ(n, n), A(n, n);
+    Vec JtF(n);
+    Vec dsq(n);  // 对角缩放矩阵D²
+    Vec h(n);    // 试探步Δq
+    Vec qNew(n); // 试探点q+Δq
+    CholeskyFactorization chol(n);
+
+    // 行列平衡：最小化||R·F||²，R取J的行缩放因子。对未知量的缩放即为下面的D，不再另外缩放
+    bool equilibrate = Config::Get().equilibrate && m == n;
+    Vec rowScale(m, 1);
+    auto residualNorm2 = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += rowScale[i] * rowScale[i] * v[i] * v[i];
+        }
+        return ret;
+    };
+
+    // 用共轭梯度法求解阻尼方程时不构造JᵀJ，(JᵀJ + μD²)v由J与Jᵀ分别乘向量得到
+    bool iterative = Config::Get().lmConjugateGradient;
+    std::unique_ptr<ConjugateGradient> cg;
+    Vec Jv(m);
+    if (iterative) {
+        cg = std::make_unique<ConjugateGradient>(n);
+    }
+
+    double mu = 1e-3; // 阻尼系数μ，相对于D²
+    double nu = 2;    // 试探步被拒绝时μ的放大倍数，连续拒绝时加倍
+    bool accepted = true;
+
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
+        }
+
+        if (!checked && monitor.Check(it, F)) {
+            break;
+        }
+        checked = false;
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        // 雅可比矩阵只在接受试探步后计算一次，被拒绝的试探步复用缓存的JᵀJ和JᵀF
+        if (accepted) {
+            df.Eval(q, J);
+            if (Config::Get().logLevel >= LogLevel::TRACE) {
+                cout << "J = " << J << endl;
+            }
+
+            if (equilibrate) {
+                if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                    eq.Compute(J);
+                }
+                rowScale = eq.RowScale();
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J.Value(i, j) *= rowScale[i];
+                    }
+                }
+            }
+            for (int i = 0; i < m; ++i) {
+                Fs[i] = rowScale[i] * F[i];
+            }
+
+            if (!iterative) {
+                internal::SyrkTranspose(m, n, &J.Value(0, 0), &JtJ.Value(0, 0));
+            }
+            internal::GemvTranspose(m, n, &J.Value(0, 0), &Fs[0], &JtF[0]);
+
+            // Marquardt缩放：D²取JᵀJ的对角元，使步长对未知量的尺度不敏感
+            for (int i = 0; i < n; ++i) {
+                double d = iterative ? Dot(MatView(J).Col(i), MatView(J).Col(i)) : JtJ.Value(i, i);
+                dsq[i] = d > 0 ? d : 1;
+            }
+        }
+
+        if (iterative) {
+            // D²近似为JᵀJ的对角元，因此(1 + μ)D²即为系数矩阵的对角元，用作Jacobi预条件子
+            LinearOperator op = [&](VecView v, MutableVecView out) {
+                for (int i = 0; i < m; ++i) {
+                    Jv[i] = Dot(MatView(J).Row(i), v);
+                }
+                for (int i = 0; i < n; ++i) {
+                    out[i] = Dot(MatView(J).Col(i), Jv) + mu * dsq[i] * v[i];
+                }
+            };
+            LinearOperator precond = [&](VecView v, MutableVecView out) {
+                for (int i = 0; i < n; ++i) {
+                    out[i] = v[i] / ((1 + mu) * dsq[i]);
+                }
+            };
+            h.Zero();
+            cg->Solve(op, precond, JtF, h, Config::Get().krylovTolerance, Config::Get().maxKrylovIterations);
+            Scale(-1, h, h);
+        } else {
+            SolveDampedSystem(J, Fs, JtJ, JtF, dsq, mu, A, chol, h);
+        }
+        ScaledAdd(q, 1, h, qNew);
+
+        // 增益比ρ：实际下降量与线性化模型预测下降量之比
+        // 预测下降量 ||F||² - ||F + Jh||² = hᵀ(μD²h - JᵀF)。共轭梯度法从0开始迭代时，残差与h正交，等式同样成立
+        double predicted = 0;
+        for (int i = 0; i < n; ++i) {
+            predicted += h[i] * (mu * dsq[i] * h[i] - JtF[i]);
+        }
+        double rho = -1;
+        if (predicted > 0) {
+            try {
+                f.Eval(qNew, FNew);
+                rho = (residualNorm2(F) - residualNorm2(FNew)) / predicted;
+            } catch (const MathError &err) {
+                // 试探点超出定义域，视为步长过大
+                if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
+            }
+        }
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "h = " << h << endl;
+            cout << "mu = " << mu << endl;
+            cout << "rho = " << rho << endl;
+        }
+
+        // Nielsen方法更新μ：ρ越接近1，线性化模型越可信，μ减小得越多
+        accepted = rho > 0;
+        if (accepted) {
+            std::swap(q, qNew);
+            std::swap(F, FNew);
+            mu *= std::max(1.0 / 3, 1 - std::pow(2 * rho - 1, 3));
+            nu = 2;
+            if (monitor.StepConverged(std::sqrt(h.Norm2()), std::sqrt(q.Norm2()))) {
+                break;
+            }
+        } else {
+            mu *= nu;
+            nu *= 2;
+        }
+
+        ++it;
+    }
+
+    if (Config::Get().logLevel >= LogLevel::TRACE) {
+        cout << "success" << endl;
+    }
+}
+
+} // namespace
+
 VarsTable SolveByLM(const SymVec &equations, const VarsTable &varsTable) {
-    int it = 0; // 迭代计数
     VarsTable table = varsTable;
-    int n = table.VarNums(); // 未知量数量
-    Vec q = table.Values();  // x向量
+    Vec q = table.Values(); // x向量
     internal::PrintSolveStartInfo(equations, varsTable);
 
     SymMat JaEqs = Jacobian(equations, table.Vars());
     internal::PrintJacobian(JaEqs);
 
-    while (1) {
-        internal::PrintAtIterationStart(it);
+    // 方程组和雅可比矩阵只编译一次，迭代中求值不再复制、替换表达式树
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+
+    ConvergenceMonitor monitor;
+    Equilibration eq;
+    IterateLM(f, df, q, 0, monitor, eq, false);
+
+    table.SetValues(q);
+    return table;
+}
+
+namespace {
+
+/**
+ * Powell折线法迭代的主体，供SolveByDogleg与多初值求解共用。参数的含义与IterateLM相同。
+ */
+void IterateDogleg(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int it, ConvergenceMonitor &monitor) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Vec Fs(m);         // R·F
+    Mat J(m, n);       // 当前点的雅可比矩阵
+    QRFactorization qr;
+    Vec hGN(n);  // 高斯-牛顿步
+    Vec hSD(n);  // 最速下降方向上的Cauchy步
+    Vec g(n);    // JᵀF
+    Vec diag(n); // 对角缩放D，信赖域为||Dh|| <= Δ
+    Vec h(n);    // 试探步Δq
+    Vec qNew(n); // 试探点q+Δq
 
-        double mu = 1e-5; // LM方法的λ值
+    // 行列平衡：与SolveByLM相同，最小化||R·F||²。信赖域的缩放即为D，
+    // 但高斯-牛顿步的QR分解按列主元的相对大小判断秩，仍然需要对R·J按列缩放
+    bool equilibrate = Config::Get().equilibrate && m == n;
+    Equilibration eq;
+    Vec rowScale(m, 1);
+    Mat JC(m, n); // R·J·C
+    auto residualNorm2 = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += rowScale[i] * rowScale[i] * v[i] * v[i];
+        }
+        return ret;
+    };
+
+    auto scaledNorm = [&](const Vec &v) {
+        double ret = 0;
+        for (int i = 0; i < n; ++i) {
+            ret += diag[i] * diag[i] * v[i] * v[i];
+        }
+        return std::sqrt(ret);
+    };
 
-        Vec F = equations.Clone().Subs(table).Calc().ToMat().ToVec(); // 计算F
+    double delta = 0; // 信赖域半径Δ
+    bool accepted = true;
+
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
 
         if (Config::Get().logLevel >= LogLevel::TRACE) {
             cout << "F = " << F << endl;
         }
 
-        if (F == 0) { // F值为0，满足方程组求根条件
+        if (monitor.Check(it, F)) {
             break;
         }
 
-        Vec FNew(n);   // 下一轮F
-        Vec deltaq(n); // Δq
-        while (1) {
-
-            Mat J = JaEqs.Clone().Subs(table).Calc().ToMat(); // 计算雅可比矩阵
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
 
+        // 雅可比矩阵只在接受试探步后计算一次。高斯-牛顿步与Cauchy步只与J有关，
+        // 试探步被拒绝时只需缩小Δ并重新组合这两步，不必重新求解
+        if (accepted) {
+            df.Eval(q, J);
             if (Config::Get().logLevel >= LogLevel::TRACE) {
                 cout << "J = " << J << endl;
             }
 
-            // 说明：
-            // 标准的LM方法中，d=-(J'*J+λI)^(-1)*J'F，其中J'*J是为了确保矩阵对称正定。有时d会过大，很难收敛。
-            // 牛顿法的 d=-(J+λI)^(-1)*F
+            if (equilibrate) {
+                if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                    eq.Compute(J);
+                    rowScale = eq.RowScale();
+                }
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        J.Value(i, j) *= rowScale[i];
+                    }
+                }
+            }
+            for (int i = 0; i < m; ++i) {
+                Fs[i] = rowScale[i] * F[i];
+            }
 
-            // 方向向量
-            Vec d = SolveLinear(J.Transpose() * J + mu * Mat(J.Rows(), J.Cols()).Ones(),
-                                -(J.Transpose() * F).ToVec()); // 得到d
+            // 与MINPACK相同，D取历次J的列范数的最大值
+            for (int j = 0; j < n; ++j) {
+                double colNorm = 0;
+                for (int i = 0; i < m; ++i) {
+                    colNorm += J.Value(i, j) * J.Value(i, j);
+                }
+                diag[j] = std::max(diag[j], std::sqrt(colNorm));
+                if (diag[j] == 0) {
+                    diag[j] = 1;
+                }
+            }
+            if (delta == 0) {
+                delta = 100 * scaledNorm(q);
+                if (delta == 0) {
+                    delta = 100;
+                }
+            }
 
-            if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "d = " << d << endl;
+            // 秩亏或非方阵时为最小二乘意义下范数最小的解
+            if (equilibrate) {
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < n; ++j) {
+                        JC.Value(i, j) = J.Value(i, j) * eq.ColScale()[j];
+                    }
+                }
+                qr.Factor(JC);
+                qr.Solve(Fs, hGN);
+                for (int j = 0; j < n; ++j) {
+                    hGN[j] *= -eq.ColScale()[j];
+                }
+            } else {
+                qr.Factor(J);
+                qr.Solve(Fs, hGN);
+                hGN = -hGN;
             }
 
-            double alpha = Armijo(
-                q, d,
-                [&](Vec v) -> Vec {
-                    table.SetValues(v);
-                    return equations.Clone().Subs(table).Calc().ToMat().ToVec();
-                },
-                [&](Vec v) -> Mat {
-                    table.SetValues(v);
-                    return JaEqs.Clone().Subs(table).Calc().ToMat();
-                }); // 进行1维搜索得到alpha
+            // 缩放后的最速下降方向s = -D⁻²JᵀF，沿s使||F + tJs||最小的t = ||D⁻¹JᵀF||² / ||Js||²
+            internal::GemvTranspose(m, n, &J.Value(0, 0), &Fs[0], &g[0]);
+            double gNorm2 = 0;
+            for (int i = 0; i < n; ++i) {
+                hSD[i] = -g[i] / (diag[i] * diag[i]);
+                gNorm2 += g[i] * g[i] / (diag[i] * diag[i]);
+            }
+            double JsNorm2 = 0;
+            for (int i = 0; i < m; ++i) {
+                double v = Dot(MatView(J).Row(i), hSD);
+                JsNorm2 += v * v;
+            }
+            hSD = (JsNorm2 > 0 ? gNorm2 / JsNorm2 : 0) * hSD;
+        }
+
+        // 折线：高斯-牛顿步在信赖域内时直接采用；否则沿Cauchy步到高斯-牛顿步的折线，取与信赖域边界的交点
+        double gnNorm = scaledNorm(hGN);
+        if (gnNorm <= delta) {
+            h = hGN;
+        } else {
+            double sdNorm = scaledNorm(hSD);
+            if (sdNorm >= delta) {
+                h = (delta / sdNorm) * hSD;
+            } else {
+                // 求β使||D(hSD + β(hGN - hSD))|| = Δ
+                double a = 0, b = 0, c = sdNorm * sdNorm - delta * delta;
+                for (int i = 0; i < n; ++i) {
+                    double di2 = diag[i] * diag[i];
+                    double diff = hGN[i] - hSD[i];
+                    a += di2 * diff * diff;
+                    b += di2 * hSD[i] * diff;
+                }
+                double beta = (-b + std::sqrt(b * b - a * c)) / a;
+                h = hSD + beta * (hGN - hSD);
+            }
+        }
+        double hNorm = scaledNorm(h);
+        if (it == 0) {
+            // 与MINPACK相同，第一次迭代时Δ不超过第一步的长度
+            delta = std::min(delta, hNorm);
+        }
+        ScaledAdd(q, 1, h, qNew);
 
-            // double alpha = FindAlpha(q, d, std::bind(SixBarAngPosition, std::placeholders::_1, thetaCDKL, Hhit));
+        // 增益比ρ：实际下降量与线性化模型预测下降量之比
+        double predicted = Fs.Norm2();
+        for (int i = 0; i < m; ++i) {
+            double v = Fs[i] + Dot(MatView(J).Row(i), h);
+            predicted -= v * v;
+        }
+        double rho = -1;
+        if (predicted > 0) {
+            try {
+                f.Eval(qNew, FNew);
+                rho = (residualNorm2(F) - residualNorm2(FNew)) / predicted;
+            } catch (const MathError &err) {
+                // 试探点超出定义域，视为步长过大
+                if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
+            }
+        }
 
-            // for (size_t i = 0; i < alpha.rows; ++i)
-            //{
-            //	if (alpha[i] != alpha[i])
-            //		alpha[i] = 1.0;
-            //}
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "h = " << h << endl;
+            cout << "delta = " << delta << endl;
+            cout << "rho = " << rho << endl;
+        }
 
-            deltaq = alpha * d; // 计算Δq
+        // 按ρ调整信赖域半径
+        if (!(rho >= 0.1)) {
+            delta = 0.5 * hNorm;
+        } else if (rho >= 0.75) {
+            delta = std::max(delta, 2 * hNorm);
+        }
 
-            Vec qTemp = q + deltaq;
-            table.SetValues(qTemp);
+        accepted = rho >= 1.0e-4;
+        if (accepted) {
+            std::swap(q, qNew);
+            std::swap(F, FNew);
+            if (monitor.StepConverged(std::sqrt(h.Norm2()), std::sqrt(q.Norm2()))) {
+                break;
+            }
+        }
 
-            FNew = equations.Clone().Subs(table).Calc().ToMat().ToVec(); // 计算新的F
+        ++it;
+    }
 
-            if (Config::Get().logLevel >= LogLevel::TRACE) {
-                cout << "it=" << it << endl;
-                cout << "\talpha=" << alpha << endl;
-                cout << "mu=" << mu << endl;
-                cout << "F.Norm2()=" << F.Norm2() << endl;
-                cout << "FNew.Norm2()=" << FNew.Norm2() << endl;
-                cout << "\tF(x k+1).Norm2()\t" << ((FNew.Norm2() < F.Norm2()) ? "<" : ">=") << "\tF(x k).Norm2()\t"
-                     << endl;
+    if (Config::Get().logLevel >= LogLevel::TRACE) {
+        cout << "success" << endl;
+    }
+}
+
+} // namespace
+
+VarsTable SolveByDogleg(const SymVec &equations, const VarsTable &varsTable) {
+    VarsTable table = varsTable;
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
+
+    SymMat JaEqs = Jacobian(equations, table.Vars());
+    internal::PrintJacobian(JaEqs);
+
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+
+    ConvergenceMonitor monitor;
+    IterateDogleg(f, df, q, 0, monitor);
+
+    table.SetValues(q);
+    return table;
+}
+
+namespace {
+
+/**
+ * Jacobian-free Newton-Krylov迭代的主体，供SolveByNewtonKrylov与多初值求解共用。参数的含义与IterateLM相同。
+ */
+void IterateNewtonKrylov(const CompiledSymMat &f, Vec &q, int it, ConvergenceMonitor &monitor,
+                         const std::function<LinearOperator(VecView q)> &preconditioner) {
+    int n = q.Rows(); // 未知量数量
+
+    Vec F(n);
+    Vec deltaq(n); // -Δq
+
+    std::unique_ptr<GMRES> gmres;
+    std::unique_ptr<BiCGSTAB> bicgstab;
+    if (Config::Get().krylovMethod == KrylovMethod::GMRES) {
+        gmres = std::make_unique<GMRES>(n, std::min(Config::Get().krylovRestart, n));
+    } else {
+        bicgstab = std::make_unique<BiCGSTAB>(n);
+    }
+
+    // 不构造雅可比矩阵，J·v由差商(f(q + hv) - f(q)) / h近似，h取机器精度的平方根（相对于q和v的大小）
+    Vec qh(n), Fh(n), Jd(n);
+    double qNorm = 0;
+    LinearOperator jv = [&](VecView v, MutableVecView out) {
+        double vNorm = std::sqrt(Dot(v, v));
+        if (vNorm == 0) {
+            Scale(0, v, out);
+            return;
+        }
+        double h = std::sqrt(std::numeric_limits<double>::epsilon()) * (1 + qNorm) / vNorm;
+        ScaledAdd(q, h, v, qh);
+        f.Eval(qh, Fh);
+        ScaledAdd(Fh, -1, F, out);
+        Scale(1 / h, out, out);
+    };
+
+    LineSearchMethod lineSearchMethod = Config::Get().lineSearch;
+    std::unique_ptr<LineSearch> lineSearch;
+    if (lineSearchMethod != LineSearchMethod::NONE) {
+        lineSearch = std::make_unique<LineSearch>(n, n);
+    }
+
+    double eta = Config::Get().krylovTolerance; // 线性方程组的相对精度η
+    double FNormPrev = 0;                       // 上一次迭代的||F||
+
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
+        }
+
+        if (monitor.Check(it, F)) {
+            break;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        double FNorm = std::sqrt(F.Norm2());
+        if (Config::Get().eisenstatWalker) {
+            // Eisenstat-Walker方法（选择2）：η = γ(||F|| / ||F_prev||)²，γ = 0.9，并限制η不要下降得过快
+            const double gamma = 0.9, etaMax = 0.9;
+            if (it == 0) {
+                eta = 0.5;
+            } else {
+                double etaNew = gamma * (FNorm / FNormPrev) * (FNorm / FNormPrev);
+                if (gamma * eta * eta > 0.1) {
+                    etaNew = std::max(etaNew, gamma * eta * eta);
+                }
+                eta = etaNew;
             }
+            // 接近收敛时，线性残差不必比非线性方程组的精度要求更小
+            eta = std::min(etaMax, std::max(eta, 0.5 * monitor.Tolerance() / FNorm));
+        }
+        FNormPrev = FNorm;
 
-            if (FNew.Norm2() < F.Norm2()) // 满足下降条件，跳出内层循环
-            {
-                break;
+        // 求解J·(-Δq) = F。未达到精度时仍然使用得到的近似解（非精确牛顿法）
+        qNorm = std::sqrt(q.Norm2());
+        LinearOperator precond = preconditioner ? preconditioner(q) : nullptr;
+        deltaq.Zero();
+        int maxKrylovIterations = Config::Get().maxKrylovIterations;
+        bool converged = gmres ? gmres->Solve(jv, precond, F, deltaq, eta, maxKrylovIterations)
+                               : bicgstab->Solve(jv, precond, F, deltaq, eta, maxKrylovIterations);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "eta = " << eta << endl;
+            cout << "Krylov iterations = " << (gmres ? gmres->Iterations() : bicgstab->Iterations())
+                 << ", relative residual = "
+                 << (gmres ? gmres->RelativeResidual() : bicgstab->RelativeResidual())
+                 << (converged ? "" : " (not converged)") << endl;
+            cout << "deltaq = " << -deltaq << endl;
+        }
+
+        double stepNorm = std::sqrt(deltaq.Norm2()); // 实际走过的||Δq||
+        // 沿d = -deltaq搜索。线性方程组只解到相对精度η，Jd ≠ -F，φ'(0) = FᵀJd用差商多计算一次f得到。
+        // d不是下降方向或搜索失败时仍然走完整的一步
+        double dphi0 = 0;
+        if (lineSearch) {
+            jv(deltaq, Jd);
+            dphi0 = -Dot(F, Jd);
+        }
+        if (dphi0 < 0) {
+            deltaq = -deltaq;
+            auto eval = [&](VecView x, Vec &out) {
+                f.Eval(x, out);
+            };
+            if (lineSearch->Search(lineSearchMethod, q, deltaq, F.Norm2() / 2, dphi0, eval)) {
+                q = lineSearch->X();
+                F = lineSearch->F();
+                stepNorm *= lineSearch->Alpha();
             } else {
-                mu *= 10.0; // 扩大λ，使模型倾向梯度下降方向
+                q += deltaq;
+                f.Eval(q, F);
             }
+        } else {
+            q -= deltaq;
+            f.Eval(q, F);
+        }
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "q = " << q << endl;
+        }
+
+        if (monitor.StepConverged(stepNorm, std::sqrt(q.Norm2()))) {
+            break;
+        }
+
+        ++it;
+    }
+}
+
+} // namespace
 
-            if (it++ == Config::Get().maxIterations) {
-                throw runtime_error("迭代次数超出限制");
+VarsTable SolveByNewtonKrylov(const SymVec &equations, const VarsTable &varsTable,
+                              const std::function<LinearOperator(VecView q)> &preconditioner) {
+    VarsTable table = varsTable;
+    int n = table.VarNums(); // 未知量数量
+    if (equations.Rows() < n) {
+        throw MathError(ErrorType::ERROR_INDETERMINATE_EQUATION);
+    }
+    if (equations.Rows() > n) {
+        throw MathError(ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
+    }
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
+
+    CompiledSymMat f(equations, table.Vars());
+
+    ConvergenceMonitor monitor;
+    IterateNewtonKrylov(f, q, 0, monitor, preconditioner);
+
+    table.SetValues(q);
+    return table;
+}
+
+VarsTable SolveFixedPoint(const SymVec &G, const VarsTable &varsTable) {
+    int it = 0; // 迭代计数
+    VarsTable table = varsTable;
+    int n = table.VarNums(); // 未知量数量
+    if (G.Rows() != n) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    }
+    Vec q = table.Values(); // x向量
+    if (Config::Get().logLevel >= LogLevel::INFO) {
+        cout << "Solve fixed point start.\n";
+        cout << "G:\n" + G.ToString();
+        cout << "Inital Values:\n" + varsTable.ToString();
+    }
+
+    CompiledSymMat g(G, table.Vars());
+    int depth = std::min(Config::Get().andersonDepth, n);
+
+    // 最近depth次迭代的Δf与Δg，按列循环存放。列的顺序不影响最小二乘问题的解
+    Mat dF(n, std::max(depth, 1)), dG(n, std::max(depth, 1));
+    int history = 0; // 有效的列数
+    int next = 0;    // 下一次写入的列
+    QRFactorization qr;
+    ConvergenceMonitor monitor;
+
+    Vec gq(n), gPrev(n); // G(q)
+    Vec fq(n), fPrev(n); // f(q) = G(q) - q
+    Vec qPrev(n), dq(n);
+
+    g.Eval(q, gq);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        fq = gq - q;
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "G(q) - q = " << fq << endl;
+        }
+
+        if (monitor.Check(it, fq)) {
+            break;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        if (it > 0 && depth > 0) {
+            for (int i = 0; i < n; ++i) {
+                dF.Value(i, next) = fq[i] - fPrev[i];
+                dG.Value(i, next) = gq[i] - gPrev[i];
             }
+            next = (next + 1) % depth;
+            history = std::min(history + 1, depth);
         }
+        fPrev = fq;
+        gPrev = gq;
+        qPrev = q;
 
-        q += deltaq; // 应用Δq，更新q值
+        if (history == 0) {
+            q = gq;
+        } else {
+            // Anderson混合：γ = argmin||f - ΔF·γ||，q = G(q) - ΔG·γ
+            qr.Factor(MatView(dF).Block(0, 0, n, history));
+            Vec gamma = qr.Solve(fq);
+            for (int i = 0; i < n; ++i) {
+                q[i] = gq[i] - Dot(MatView(dG).Block(0, 0, n, history).Row(i), gamma);
+            }
+        }
 
-        table.SetValues(q);
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "q = " << q << endl;
+        }
 
-        F = FNew; // 更新F
+        try {
+            g.Eval(q, gq);
+        } catch (const MathError &err) {
+            // 外推得到的点超出定义域时，清空历史，退回一次普通的不动点迭代
+            if (err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER || history == 0) {
+                throw;
+            }
+            history = 0;
+            next = 0;
+            q = gPrev;
+            g.Eval(q, gq);
+        }
+
+        dq = q - qPrev;
+        if (monitor.StepConverged(std::sqrt(dq.Norm2()), std::sqrt(q.Norm2()))) {
+            break;
+        }
+
+        ++it;
+    }
+
+    table.SetValues(q);
+    return table;
+}
+
+namespace {
+
+/**
+ * 用编译后的方程组与雅可比矩阵做不带一维搜索的牛顿迭代，供SolveByPolyalgorithm与多初值求解共用。
+ * 从q开始迭代，it为已经用掉的迭代次数，返回时q为最后接受的迭代点，it为累计的迭代次数。
+ * fallback为true时，雅可比矩阵奇异或病态、牛顿步超出定义域、||F||收缩不够时不再继续，返回false，
+ * 由调用者改用其他方法；为false时就是普通的牛顿法，这些情况下照常抛出异常或继续迭代。
+ * 返回false时q处的F已经交给monitor检查过。eq为行列平衡的缩放因子，开启行列平衡时收缩率按||R·F||计算，
+ * 与之后的LM方法一致。
+ * @return 是否已经收敛
+ */
+bool IterateNewton(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int &it, ConvergenceMonitor &monitor,
+                   bool fallback, Equilibration &eq) {
+    int n = q.Rows(); // 未知量数量
+    int m = f.Rows(); // 方程数量
+    assert(m == n);
+
+    // 牛顿步需要使||F||缩小到原来的contraction倍以下，雅可比矩阵的条件数估计不能超过maxCondition
+    const double contraction = 0.9, maxCondition = 1.0e10;
+
+    Vec F(m), FNew(m); // 当前点与试探点的F
+    Mat J(m, n);
+    Vec rhs(m);    // R·F
+    Vec deltaq(n); // -Δq
+    Vec qNew(n);   // 试探点
+    LUFactorization lu(n);
+    bool equilibrate = Config::Get().equilibrate;
+    auto residualNorm2 = [&](const Vec &v) {
+        if (!equilibrate) {
+            return v.Norm2();
+        }
+        double ret = 0;
+        for (int i = 0; i < m; ++i) {
+            ret += eq.RowScale()[i] * eq.RowScale()[i] * v[i] * v[i];
+        }
+        return ret;
+    };
+
+    f.Eval(q, F);
+    while (1) {
+        internal::PrintAtIterationStart(it);
+
+        if (Config::Get().logLevel >= LogLevel::TRACE) {
+            cout << "F = " << F << endl;
+        }
+
+        if (monitor.Check(it, F)) {
+            return true;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        const char *reason = nullptr; // 改用其他方法的原因
+        df.Eval(q, J);
+        if (equilibrate) {
+            if (!eq.IsComputed() || Config::Get().updateEquilibration) {
+                eq.Compute(J);
+            }
+            eq.Apply(J);
+        }
+        try {
+            lu.Factor(J);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() != ErrorType::ERROR_SINGULAR_MATRIX) {
+                throw;
+            }
+            if (!fallback) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
+            }
+            reason = "singular Jacobian";
+        }
+        if (fallback && !reason && lu.ConditionEstimate() > maxCondition) {
+            reason = "ill-conditioned Jacobian";
+        }
+
+        if (!reason) {
+            rhs = F;
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    rhs[i] *= eq.RowScale()[i];
+                }
+            }
+            lu.Solve(rhs, deltaq);
+            if (equilibrate) {
+                for (int i = 0; i < n; ++i) {
+                    deltaq[i] *= eq.ColScale()[i];
+                }
+            }
+            ScaledAdd(q, -1, deltaq, qNew);
+
+            try {
+                f.Eval(qNew, FNew);
+                if (fallback && !(residualNorm2(FNew) < contraction * contraction * residualNorm2(F))) {
+                    reason = "residual not contracting";
+                }
+            } catch (const MathError &err) {
+                if (!fallback || err.GetErrorType() != ErrorType::ERROR_INVALID_NUMBER) {
+                    throw;
+                }
+                reason = "domain error";
+            }
+        }
 
-        if (it++ == Config::Get().maxIterations) {
-            throw runtime_error("迭代次数超出限制");
+        // 被放弃的牛顿步同样计入迭代次数
+        ++it;
+
+        if (reason) {
+            if (Config::Get().logLevel >= LogLevel::INFO) {
+                cout << "leave Newton iteration: " << reason << endl;
+            }
+            return false;
         }
 
+        std::swap(q, qNew);
+        std::swap(F, FNew);
         if (Config::Get().logLevel >= LogLevel::TRACE) {
-            cout << std::string(20, '=') << endl;
+            cout << "q = " << q << endl;
+        }
+
+        if (monitor.StepConverged(std::sqrt(deltaq.Norm2()), std::sqrt(q.Norm2()))) {
+            return true;
         }
     }
+}
 
-    if (Config::Get().logLevel >= LogLevel::TRACE) {
-        cout << "success" << endl;
+/**
+ * 先用牛顿法，不满足条件时保留当前的q，改用LM方法继续迭代。非方阵直接使用LM方法。
+ * 两者共用行列平衡的缩放因子；切换时q处的F已经检查过，不重复计入停滞次数。
+ */
+void IteratePolyalgorithm(const CompiledSymMat &f, const CompiledSymMat &df, Vec &q, int &it,
+                          ConvergenceMonitor &monitor) {
+    Equilibration eq;
+    bool square = f.Rows() == q.Rows();
+    if (square && IterateNewton(f, df, q, it, monitor, true, eq)) {
+        return;
     }
+    IterateLM(f, df, q, it, monitor, eq, square);
+}
+
+} // namespace
+
+VarsTable SolveByPolyalgorithm(const SymVec &equations, const VarsTable &varsTable) {
+    int it = 0; // 迭代计数
+    VarsTable table = varsTable;
+    Vec q = table.Values(); // x向量
+    internal::PrintSolveStartInfo(equations, varsTable);
 
+    SymMat JaEqs = Jacobian(equations, table.Vars());
+    internal::PrintJacobian(JaEqs);
+
+    CompiledSymMat f(equations, table.Vars());
+    CompiledSymMat df(JaEqs, table.Vars());
+    ConvergenceMonitor monitor;
+    IteratePolyalgorithm(f, df, q, it, monitor);
+
+    table.SetValues(q);
     return table;
 }
 
+namespace internal {
+
+void SolveCompiled(NonlinearMethod method, const CompiledSymMat &f, const CompiledSymMat &df, Vec &q,
+                   ConvergenceMonitor &monitor) {
+    int it = 0;
+    bool square = f.Rows() == q.Rows();
+    if (!square && (method == NonlinearMethod::NEWTON_RAPHSON || method == NonlinearMethod::NEWTON_KRYLOV)) {
+        throw MathError(f.Rows() < q.Rows() ? ErrorType::ERROR_INDETERMINATE_EQUATION
+                                            : ErrorType::ERROR_OVER_DETERMINED_EQUATIONS);
+    }
+    switch (method) {
+    case NonlinearMethod::NEWTON_RAPHSON: {
+        Equilibration eq;
+        IterateNewton(f, df, q, it, monitor, false, eq);
+        return;
+    }
+    case NonlinearMethod::LM: {
+        Equilibration eq;
+        IterateLM(f, df, q, it, monitor, eq, false);
+        return;
+    }
+    case NonlinearMethod::DOGLEG:
+        IterateDogleg(f, df, q, it, monitor);
+        return;
+    case NonlinearMethod::NEWTON_KRYLOV:
+        IterateNewtonKrylov(f, q, it, monitor, nullptr);
+        return;
+    case NonlinearMethod::AUTO:
+        IteratePolyalgorithm(f, df, q, it, monitor);
+        return;
+    }
+    throw runtime_error("invalid config.NonlinearMethod value: " + std::to_string(static_cast<int>(method)));
+}
+
+} // namespace internal
+
 VarsTable Solve(const SymVec &equations, const VarsTable &varsTable) {
     switch (Config::Get().nonlinearMethod) {
     case NonlinearMethod::NEWTON_RAPHSON:
         return SolveByNewtonRaphson(equations, varsTable);
     case NonlinearMethod::LM:
         return SolveByLM(equations, varsTable);
+    case NonlinearMethod::DOGLEG:
+        return SolveByDogleg(equations, varsTable);
+    case NonlinearMethod::NEWTON_KRYLOV:
+        return SolveByNewtonKrylov(equations, varsTable);
+    case NonlinearMethod::AUTO:
+        return SolveByPolyalgorithm(equations, varsTable);
     }
     throw runtime_error("invalid config.NonlinearMethod value: " +
                         std::to_string(static_cast<int>(Config::Get().nonlinearMethod)));
@@ -275,4 +1196,14 @@ VarsTable Solve(const SymVec &equations) {
     return Solve(equations, varsTable);
 }
 
+VarsTable Solve(const SymVec &equations, const VarsTable &varsTable, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return Solve(equations, varsTable);
+}
+
+VarsTable Solve(const SymVec &equations, const SolverOptions &options) {
+    ConfigScope scope(options);
+    return Solve(equations);
+}
+
 } // namespace tomsolver
\ No newline at end of file
@@ -1,18 +1,35 @@
 #pragma once
 
+#include "compiled_symmat.h"
+#include "config.h"
+#include "convergence.h"
+#include "error_type.h"
+#include "fixed_mat.h"
+#include "krylov.h"
+#include "line_search.h"
 #include "mat.h"
 #include "symmat.h"
 #include "vars_table.h"
 
+#include <cmath>
 #include <functional>
+#include <stdexcept>
 
 namespace tomsolver {
 
 /**
- * Armijo方法一维搜索，寻找alpha
+ * Armijo方法一维搜索，寻找alpha。f(x)与df(x)只计算一次，最多回溯LineSearch::MAX_BACKTRACKING次。
+ * 试探点处出现浮点数无效值时视为步长过大。
+ * @return 找到的alpha；回溯次数用完仍不满足条件时返回0
  */
 double Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df);
 
+/**
+ * 同上，alpha通过参数返回。
+ * @return 是否找到满足条件的alpha。返回false时alpha为最后一次试探的步长，调用者应改用其他方法
+ */
+bool Armijo(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, std::function<Mat(Vec)> df, double &alpha);
+
 /**
  * 割线法 进行一维搜索，寻找alpha
  */
@@ -21,17 +38,68 @@ double FindAlpha(const Vec &x, const Vec &d, std::function<Vec(Vec)> f, double u
 /**
  * 解非线性方程组equations。
  * 初值及变量名通过varsTable传入。
- * @exception runtime_error 迭代次数超出限制
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
  */
 VarsTable SolveByNewtonRaphson(const SymVec &equations, const VarsTable &varsTable);
 
 /**
- * 解非线性方程组equations。
+ * 用Levenberg-Marquardt方法解非线性方程组equations，方程数量可以不等于未知数数量。
  * 初值及变量名通过varsTable传入。
- * @exception runtime_error 迭代次数超出限制
+ * 雅可比矩阵只在接受试探步后计算一次，阻尼系数按增益比以Nielsen方法更新，并以JᵀJ的对角元缩放。
+ * 试探点超出定义域（出现浮点数无效值）时视为步长过大，增大阻尼后重试。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
  */
 VarsTable SolveByLM(const SymVec &equations, const VarsTable &varsTable);
 
+/**
+ * 用Powell折线法（信赖域方法，参考MINPACK的hybrj）解非线性方程组equations，方程数量可以不等于未知数数量。
+ * 初值及变量名通过varsTable传入。
+ * 每一步在信赖域内组合高斯-牛顿步与最速下降方向上的Cauchy步。雅可比矩阵只在接受试探步后计算并分解一次，
+ * 试探步被拒绝时只缩小信赖域，不再重新求解。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ */
+VarsTable SolveByDogleg(const SymVec &equations, const VarsTable &varsTable);
+
+/**
+ * 多算法组合求解非线性方程组equations（NonlinearMethod::AUTO）。
+ * 初值及变量名通过varsTable传入。
+ * 先使用不带一维搜索的牛顿法，只要||F||每步都明显缩小就一直使用牛顿步；出现以下情况之一时，保留当前的迭代点，
+ * 改用LM方法迭代到收敛：雅可比矩阵奇异或病态（按LU分解的条件数估计）、牛顿步超出定义域、||F||收缩不够。
+ * 迭代次数在两个阶段中累计。方程数量不等于未知数数量时直接使用LM方法。
+ * 与先用牛顿法求解、失败后再换方法从头求解相比，困难的情况不必付出两次求解的时间。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ */
+VarsTable SolveByPolyalgorithm(const SymVec &equations, const VarsTable &varsTable);
+
+/**
+ * 用Jacobian-free Newton-Krylov方法解非线性方程组equations，方程数量必须等于未知数数量。
+ * 初值及变量名通过varsTable传入。
+ * 不构造雅可比矩阵：每个牛顿步用重启GMRES求解，J·v由方程组沿v方向的差商近似，内存为O(n·restart)，
+ * 适合未知数很多的方程组。GMRES的参数见Config::krylovRestart、krylovTolerance、maxKrylovIterations。
+ * @param preconditioner: 每个牛顿步开始时以当前的q调用一次，返回本步使用的预条件子M⁻¹ ≈ J⁻¹。
+ *                        为nullptr时不使用预条件
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError 方程数量不等于未知数数量
+ */
+VarsTable SolveByNewtonKrylov(const SymVec &equations, const VarsTable &varsTable,
+                              const std::function<LinearOperator(VecView q)> &preconditioner = nullptr);
+
+/**
+ * 用Anderson加速的不动点迭代解方程组x = G(x)，G的行数必须等于未知数数量，G的第i行对应varsTable的第i个变量。
+ * 初值及变量名通过varsTable传入。
+ * 不需要雅可比矩阵：每次迭代只计算一次G，再用最近Config::Get().andersonDepth次的残差解一个小规模最小二乘问题，
+ * 外推得到下一个点。以G(x) - x作为残差，收敛、发散与停滞的判断见ConvergenceMonitor。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError G的行数不等于未知数数量
+ */
+VarsTable SolveFixedPoint(const SymVec &G, const VarsTable &varsTable);
+
 /**
  * Solve a system of nonlinear equations.
  * Initial values and variable names are passed through varsTable. Will not use the Config::Get().initialValue
@@ -44,9 +112,111 @@ VarsTable Solve(const SymVec &equations, const VarsTable &varsTable);
 /**
  * Solve the equations.
  * Variable names are obtained by analyzing the equations. Initial values are obtained through Config::Get().
+ * Every variable is treated as an unknown. For equations with known parameters that change between solves, see
+ * ParametricSystem.
  * @param equations: The system of equations. Essentially, it is a symbolic vector.
  * @throws tomsolver::MathError: If the number of iterations exceeds the limit.
  */
 VarsTable Solve(const SymVec &equations);
 
+/**
+ * 以options代替Config::Get()求解，不读取也不修改全局配置，多个线程可以同时用不同的options求解。其余同上。
+ */
+VarsTable Solve(const SymVec &equations, const VarsTable &varsTable, const SolverOptions &options);
+
+/**
+ * 以options代替Config::Get()求解，初值为options.initialValue。其余同上。
+ */
+VarsTable Solve(const SymVec &equations, const SolverOptions &options);
+
+namespace internal {
+
+/**
+ * 用编译后的方程组f与雅可比矩阵df，按method从q开始迭代求解，返回时q为解。
+ * 不修改f与df，多个线程可以同时用同一组f、df求解不同的初值。monitor用于收敛判断，可以预先设置取消标志。
+ * NEWTON_RAPHSON为不带一维搜索、不复用分解结果的牛顿法；NEWTON_KRYLOV不使用df，也不使用预条件子。
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散、停滞或被取消
+ */
+void SolveCompiled(NonlinearMethod method, const CompiledSymMat &f, const CompiledSymMat &df, Vec &q,
+                   ConvergenceMonitor &monitor);
+
+} // namespace internal
+
+/**
+ * 用牛顿-拉夫森法解N元非线性方程组f(x) = 0，N在编译期确定。
+ * 迭代过程中的向量、雅可比矩阵和LU分解都存放在栈上，不申请堆内存；f与jacobian不申请内存时，整个求解过程不申请内存。
+ * @param f: 计算方程组的值，形如FixedVec<N>(const FixedVec<N> &x)
+ * @param jacobian: 计算雅可比矩阵，形如FixedMat<N, N>(const FixedVec<N> &x)
+ * @param x: 初值
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ * @exception MathError 奇异矩阵
+ */
+template <int N, typename F, typename J>
+FixedVec<N> SolveByNewtonRaphson(F &&f, J &&jacobian, FixedVec<N> x) {
+    ConvergenceMonitor monitor;
+    for (int it = 0;; ++it) {
+        FixedVec<N> phi = f(x);
+        if (monitor.Check(it, VecView(phi.Data(), N))) {
+            break;
+        }
+
+        if (it > Config::Get().maxIterations) {
+            throw MathError(ErrorType::ERROR_ITERATION_LIMIT);
+        }
+
+        FixedVec<N> deltaq;
+        try {
+            deltaq = SolveLinear(FixedMat<N, N>(jacobian(x)), phi);
+        } catch (const MathError &err) {
+            if (err.GetErrorType() == ErrorType::ERROR_SINGULAR_MATRIX) {
+                throw MathError(ErrorType::ERROR_SINGULAR_MATRIX, "tip: consider using different initial values");
+            }
+            throw;
+        }
+        x -= deltaq;
+
+        VecView step(deltaq.Data(), N), xv(x.Data(), N);
+        if (monitor.StepConverged(std::sqrt(Dot(step, step)), std::sqrt(Dot(xv, xv)))) {
+            break;
+        }
+    }
+    return x;
+}
+
+/**
+ * 解N元非线性方程组equations，方程数量和未知量数量在编译期确定。
+ * 初值及变量名通过varsTable传入。总是使用牛顿-拉夫森法，不受Config::Get().nonlinearMethod影响。
+ * 方程组和雅可比矩阵编译为CompiledSymMat后直接求值到栈上的FixedMat，迭代过程中不申请堆内存。
+ * @exception MathError 方程数量或未知量数量不等于N
+ * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+ * @exception MathError 迭代发散或停滞（见ConvergenceMonitor）
+ */
+template <int N>
+VarsTable Solve(const SymVec &equations, const VarsTable &varsTable) {
+    if (equations.Rows() != N || varsTable.VarNums() != N) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH);
+    }
+
+    CompiledSymMat f(equations, varsTable.Vars());
+    CompiledSymMat ja(Jacobian(equations, varsTable.Vars()), varsTable.Vars());
+    FixedVec<N> x = SolveByNewtonRaphson<N>(
+        [&](const FixedVec<N> &v) {
+            FixedVec<N> phi;
+            f.Eval(v.Data(), phi.Data());
+            return phi;
+        },
+        [&](const FixedVec<N> &v) {
+            FixedMat<N, N> J;
+            ja.Eval(v.Data(), J.Data());
+            return J;
+        },
+        FixedVec<N>(varsTable.Values()));
+
+    VarsTable table = varsTable;
+    table.SetValues(VecView(x.Data(), N));
+    return table;
+}
+
 } // namespace tomsolver
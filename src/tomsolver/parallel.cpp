@@ -0,0 +1,67 @@
+#include "parallel.h"
+
+#include "config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tomsolver {
+
+namespace internal {
+
+int ParallelWorkers(int count, int threads) noexcept {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return std::max(1, std::min(threads, count));
+}
+
+void ParallelFor(int count, int threads, const std::function<void(int, int)> &body) {
+    const Config &config = Config::Get();
+    std::atomic<int> next{0};
+    std::atomic<bool> stopped{false};
+    std::mutex mtx;
+    std::exception_ptr error;
+
+    auto worker = [&](int id) {
+        ConfigScope scope(config); // 工作线程使用调用者所在线程的配置
+        while (!stopped.load()) {
+            int k = next++;
+            if (k >= count) {
+                return;
+            }
+            try {
+                body(id, k);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                stopped = true;
+            }
+        }
+    };
+
+    // 调用者所在的线程也参与执行
+    int workers = ParallelWorkers(count, threads);
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; ++i) {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto &t : pool) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace internal
+
+} // namespace tomsolver
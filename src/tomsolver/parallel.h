@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+
+namespace tomsolver {
+
+namespace internal {
+
+/**
+ * 实际使用的工作线程数量（包括调用者所在的线程）：threads为0时取std::thread::hardware_concurrency()，
+ * 不超过count，至少为1。
+ */
+int ParallelWorkers(int count, int threads) noexcept;
+
+/**
+ * 用ParallelWorkers(count, threads)个线程（包括调用者所在的线程）并行执行body(worker, k)，k = 0..count-1。
+ * 每个k只执行一次，执行顺序不定；worker为执行它的线程编号，取值[0, ParallelWorkers(count, threads))，
+ * 可以用来访问每个线程自己的数据。各线程都使用调用者所在线程的Config::Get()（见ConfigScope）。
+ * body抛出异常后不再开始新的k，等所有线程结束后，重新抛出第一个异常。
+ */
+void ParallelFor(int count, int threads, const std::function<void(int, int)> &body);
+
+} // namespace internal
+
+} // namespace tomsolver
@@ -0,0 +1,84 @@
+#include "parametric_system.h"
+
+#include "convergence.h"
+#include "error_type.h"
+#include "nonlinear.h"
+
+#include <cassert>
+
+namespace tomsolver {
+
+ParametricSystem::ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                                   const std::vector<std::string> &params)
+    : unknowns(unknowns), params(params), values(params.size(), 0),
+      f(equations, unknowns, params), df(Jacobian(equations, unknowns), unknowns, params) {
+    for (int i = 0; i < static_cast<int>(params.size()); ++i) {
+        paramIndex.emplace(params[i], i);
+    }
+}
+
+ParametricSystem::ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                                   const VarsTable &params)
+    : ParametricSystem(equations, unknowns, params.Vars()) {
+    Rebind(params);
+}
+
+const std::vector<std::string> &ParametricSystem::Unknowns() const noexcept {
+    return unknowns;
+}
+
+const std::vector<std::string> &ParametricSystem::Params() const noexcept {
+    return params;
+}
+
+void ParametricSystem::Rebind(VecView values) noexcept {
+    assert(values.Size() == static_cast<int>(params.size()));
+    f.SetParams(values);
+    df.SetParams(values);
+    for (int i = 0; i < values.Size(); ++i) {
+        this->values[i] = values[i];
+    }
+}
+
+void ParametricSystem::Rebind(const VarsTable &params) {
+    // 先检查全部名字，出错时不修改任何参数
+    for (auto &item : params) {
+        if (paramIndex.find(item.first) == paramIndex.end()) {
+            throw MathError(ErrorType::ERROR_UNDEFINED_VARIABLE, item.first + " is not a parameter");
+        }
+    }
+    for (auto &item : params) {
+        values[paramIndex.find(item.first)->second] = item.second;
+    }
+    if (!values.empty()) {
+        f.SetParams(VecView(values.data(), static_cast<int>(values.size())));
+        df.SetParams(VecView(values.data(), static_cast<int>(values.size())));
+    }
+}
+
+Vec ParametricSystem::Eval(VecView q) const {
+    return f.Eval(q).ToVec();
+}
+
+void ParametricSystem::Solve(Vec &q) const {
+    assert(q.Rows() == static_cast<int>(unknowns.size()));
+    ConvergenceMonitor monitor;
+    internal::SolveCompiled(Config::Get().nonlinearMethod, f, df, q, monitor);
+}
+
+VarsTable ParametricSystem::Solve(const VarsTable &initialValues) const {
+    if (initialValues.VarNums() != static_cast<int>(unknowns.size())) {
+        throw MathError(ErrorType::SIZE_NOT_MATCH, "initial values must be given for exactly the unknowns");
+    }
+    Vec q(static_cast<int>(unknowns.size()));
+    for (int i = 0; i < q.Rows(); ++i) {
+        if (!initialValues.Has(unknowns[i])) {
+            throw MathError(ErrorType::SIZE_NOT_MATCH, "no initial value for " + unknowns[i]);
+        }
+        q[i] = initialValues[unknowns[i]];
+    }
+    Solve(q);
+    return {unknowns, q};
+}
+
+} // namespace tomsolver
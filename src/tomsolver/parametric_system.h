@@ -0,0 +1,88 @@
+#pragma once
+
+#include "compiled_symmat.h"
+#include "mat.h"
+#include "mat_view.h"
+#include "symmat.h"
+#include "vars_table.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tomsolver {
+
+/**
+ * 带参数的非线性方程组。参数（例如连杆长度、目标位置）与未知量分开声明：
+ * 构造时只对未知量求一次雅可比矩阵并编译，参数编译为CompiledSymMat的参数槽。
+ * 之后修改参数值（Rebind）的复杂度为O(参数数量)，不做任何符号运算；求解时也不再求导、编译。
+ * 不需要在每次求解前用Subs或拼接字符串把已知量代入方程组。
+ *
+ * Rebind修改对象，Solve不修改对象。多个线程使用不同的参数值时，每个线程使用自己的副本。
+ */
+class ParametricSystem {
+public:
+    /**
+     * @param equations 方程组
+     * @param unknowns 未知量
+     * @param params 参数，初始值均为0
+     * @exception MathError 方程组中出现unknowns和params以外的变量
+     * @exception MathError unknowns和params中有重复的名字
+     */
+    ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns,
+                     const std::vector<std::string> &params);
+
+    /**
+     * 参数名为params.Vars()，初始值为params.Values()。
+     * @exception MathError 同上
+     */
+    ParametricSystem(const SymVec &equations, const std::vector<std::string> &unknowns, const VarsTable &params);
+
+    const std::vector<std::string> &Unknowns() const noexcept;
+
+    const std::vector<std::string> &Params() const noexcept;
+
+    /**
+     * 设置全部参数的值，values[i]为Params()[i]的值。复杂度为O(参数数量)，不申请内存。
+     */
+    void Rebind(VecView values) noexcept;
+
+    /**
+     * 按名字设置参数的值，params中没有出现的参数保持原值。
+     * @exception MathError params中有不是参数的变量，此时所有参数都保持原值
+     */
+    void Rebind(const VarsTable &params);
+
+    /**
+     * 以当前的参数值计算方程组的值F(q)。
+     * @exception MathError 出现浮点数无效值(inf, -inf, nan)，且Config::Get().throwOnInvalidValue为true
+     */
+    Vec Eval(VecView q) const;
+
+    /**
+     * 以当前的参数值求解，调用时q为初值，返回时为解。反复求解时可以直接用上一次的解作为初值。
+     * 求解方法为Config::Get().nonlinearMethod，具体见internal::SolveCompiled。
+     * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+     * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散或停滞
+     */
+    void Solve(Vec &q) const;
+
+    /**
+     * 以当前的参数值求解，初值为initialValues。initialValues的变量必须与Unknowns()相同，顺序可以不同。
+     * @return 未知量的解，变量顺序与Unknowns()相同
+     * @exception MathError initialValues的变量与Unknowns()不一致
+     * @exception MathError 迭代次数超出限制(ERROR_ITERATION_LIMIT)
+     * @exception MathError NEWTON_RAPHSON与NEWTON_KRYLOV的方程数量不等于未知数数量；迭代发散或停滞
+     */
+    VarsTable Solve(const VarsTable &initialValues) const;
+
+private:
+    std::vector<std::string> unknowns;
+    std::vector<std::string> params;
+    std::map<std::string, int> paramIndex;
+    std::vector<double> values; // 当前的参数值
+    CompiledSymMat f;
+    CompiledSymMat df;
+};
+
+} // namespace tomsolver
@@ -0,0 +1,118 @@
+#include "sparse_mat.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tomsolver {
+
+SparseMat::SparseMat(int rows, int cols, const std::vector<Triplet> &triplets)
+    : rows(rows), cols(cols), rowPtr(rows + 1) {
+    assert(rows > 0 && cols > 0);
+
+    std::vector<Triplet> sorted(triplets);
+    std::sort(sorted.begin(), sorted.end(), [](const Triplet &a, const Triplet &b) {
+        return a.row < b.row || (a.row == b.row && a.col < b.col);
+    });
+
+    colIndex.reserve(sorted.size());
+    values.reserve(sorted.size());
+    for (std::size_t k = 0; k < sorted.size(); ++k) {
+        const Triplet &t = sorted[k];
+        assert(t.row >= 0 && t.row < rows);
+        assert(t.col >= 0 && t.col < cols);
+        if (k > 0 && t.row == sorted[k - 1].row && t.col == sorted[k - 1].col) {
+            values.back() += t.value;
+            continue;
+        }
+        colIndex.push_back(t.col);
+        values.push_back(t.value);
+        ++rowPtr[t.row + 1];
+    }
+    for (int i = 0; i < rows; ++i) {
+        rowPtr[i + 1] += rowPtr[i];
+    }
+}
+
+SparseMat::SparseMat(MatView mat) : rows(mat.Rows()), cols(mat.Cols()), rowPtr(mat.Rows() + 1) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            if (mat.Value(i, j) != 0) {
+                colIndex.push_back(j);
+                values.push_back(mat.Value(i, j));
+            }
+        }
+        rowPtr[i + 1] = static_cast<int>(values.size());
+    }
+}
+
+int SparseMat::Rows() const noexcept {
+    return rows;
+}
+
+int SparseMat::Cols() const noexcept {
+    return cols;
+}
+
+int SparseMat::NonZeros() const noexcept {
+    return static_cast<int>(values.size());
+}
+
+double SparseMat::Value(int i, int j) const noexcept {
+    assert(i >= 0 && i < rows);
+    auto begin = colIndex.begin() + rowPtr[i];
+    auto end = colIndex.begin() + rowPtr[i + 1];
+    auto it = std::lower_bound(begin, end, j);
+    if (it == end || *it != j) {
+        return 0;
+    }
+    return values[it - colIndex.begin()];
+}
+
+void SparseMat::Multiply(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == cols);
+    assert(out.Size() == rows);
+    for (int i = 0; i < rows; ++i) {
+        double sum = 0;
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            sum += values[k] * v[colIndex[k]];
+        }
+        out[i] = sum;
+    }
+}
+
+void SparseMat::TransposeMultiply(VecView v, MutableVecView out) const noexcept {
+    assert(v.Size() == rows);
+    assert(out.Size() == cols);
+    for (int j = 0; j < cols; ++j) {
+        out[j] = 0;
+    }
+    for (int i = 0; i < rows; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            out[colIndex[k]] += values[k] * v[i];
+        }
+    }
+}
+
+Mat SparseMat::ToMat() const {
+    Mat ret(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+            ret.Value(i, colIndex[k]) = values[k];
+        }
+    }
+    return ret;
+}
+
+const std::vector<int> &SparseMat::RowPointers() const noexcept {
+    return rowPtr;
+}
+
+const std::vector<int> &SparseMat::ColIndices() const noexcept {
+    return colIndex;
+}
+
+const std::vector<double> &SparseMat::Values() const noexcept {
+    return values;
+}
+
+} // namespace tomsolver
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mat.h"
+#include "mat_view.h"
+
+#include <vector>
+
+namespace tomsolver {
+
+/**
+ * 压缩稀疏行（CSR）格式的稀疏矩阵，只存放非零元。矩阵与向量相乘的计算量为O(nnz)。
+ * 用于大规模线性方程组的迭代求解，见krylov.h。
+ */
+class SparseMat {
+public:
+    /**
+     * 非零元(row, col)的值为value。
+     */
+    struct Triplet {
+        int row;
+        int col;
+        double value;
+    };
+
+    /**
+     * 由三元组构造rows×cols的稀疏矩阵。三元组的顺序任意，同一位置出现多次时累加。
+     */
+    SparseMat(int rows, int cols, const std::vector<Triplet> &triplets);
+
+    /**
+     * 由稠密矩阵构造，只保留不为0的元素。
+     */
+    explicit SparseMat(MatView mat);
+
+    int Rows() const noexcept;
+
+    int Cols() const noexcept;
+
+    /**
+     * 存放的非零元数量。
+     */
+    int NonZeros() const noexcept;
+
+    /**
+     * 元素(i, j)，不是非零元时返回0。每行内二分查找。
+     */
+    double Value(int i, int j) const noexcept;
+
+    /**
+     * out = A·v。v的长度为Cols()，out的长度为Rows()，不申请堆内存。
+     */
+    void Multiply(VecView v, MutableVecView out) const noexcept;
+
+    /**
+     * out = Aᵀ·v。v的长度为Rows()，out的长度为Cols()，不申请堆内存。
+     */
+    void TransposeMultiply(VecView v, MutableVecView out) const noexcept;
+
+    Mat ToMat() const;
+
+    /**
+     * 第i行的非零元为下标[RowPointers()[i], RowPointers()[i + 1])的元素，长度为Rows() + 1。
+     */
+    const std::vector<int> &RowPointers() const noexcept;
+
+    /**
+     * 非零元的列号，每行内从小到大排列。
+     */
+    const std::vector<int> &ColIndices() const noexcept;
+
+    /**
+     * 非零元的值，与ColIndices()一一对应。
+     */
+    const std::vector<double> &Values() const noexcept;
+
+private:
+    int rows;
+    int cols;
+    std::vector<int> rowPtr;
+    std::vector<int> colIndex;
+    std::vector<double> values;
+};
+
+} // namespace tomsolver
@@ -8,5 +8,16 @@
 #include "subs.h"   // symmat.h vars_table.h
 #include "symmat.h" // mat.h vars_table.h
 #include "parse.h"
+#include "mat_view.h"
+#include "fixed_mat.h"
+#include "compiled_symmat.h"
 #include "linear.h"
-#include "nonlinear.h"
\ No newline at end of file
+#include "line_search.h"
+#include "sparse_mat.h"
+#include "krylov.h"
+#include "convergence.h"
+#include "nonlinear.h"
+#include "parallel.h"
+#include "multi_start.h"
+#include "batch.h"
+#include "parametric_system.h"
\ No newline at end of file
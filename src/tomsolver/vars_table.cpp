@@ -15,6 +15,15 @@ VarsTable::VarsTable(const std::vector<std::string> &vars, double initValue)
     assert(vars.size() == table.size() && "vars is not unique");
 }
 
+VarsTable::VarsTable(const std::vector<std::string> &vars, VecView initValues)
+    : vars(vars), values(initValues) {
+    assert(static_cast<int>(vars.size()) == initValues.Size());
+    for (int i = 0; i < values.Rows(); ++i) {
+        table.insert({vars[i], values[i]});
+    }
+    assert(vars.size() == table.size() && "vars is not unique");
+}
+
 VarsTable::VarsTable(std::initializer_list<std::pair<std::string, double>> initList)
     : VarsTable({initList.begin(), initList.end()}) {
     assert(vars.size() == table.size() && "vars is not unique");
@@ -42,7 +51,7 @@ const Vec &VarsTable::Values() const noexcept {
     return values;
 }
 
-void VarsTable::SetValues(const Vec &v) noexcept {
+void VarsTable::SetValues(VecView v) noexcept {
     assert(v.Rows() == values.Rows());
     values = v;
     for (int i = 0; i < values.Rows(); ++i) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mat.h"
+#include "mat_view.h"
 
 #include <iostream>
 #include <map>
@@ -21,6 +22,13 @@ public:
      */
     VarsTable(const std::vector<std::string> &vars, double initValue);
 
+    /**
+     * 新建变量表。
+     * @param vars 变量数组
+     * @param initValues 各变量的初值，长度必须与vars相同。可以是Vec，也可以是指向调用者内存的VecView
+     */
+    VarsTable(const std::vector<std::string> &vars, VecView initValues);
+
     /**
      * 新建变量表。
      * @param vars 变量数组
@@ -51,9 +59,9 @@ public:
     const Vec &Values() const noexcept;
 
     /**
-     * 设置数值向量。
+     * 设置数值向量。v可以是Vec，也可以是指向调用者内存的VecView，不会申请堆内存。
      */
-    void SetValues(const Vec &v) noexcept;
+    void SetValues(VecView v) noexcept;
 
     /**
      * 返回是否有指定的变量。
@@ -0,0 +1,166 @@
+#include <tomsolver/batch.h>
+#include <tomsolver/config.h>
+#include <tomsolver/error_type.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+using namespace tomsolver;
+
+TEST(Batch, Solve) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 圆x^2 + y^2 = r^2与直线y = a*x在第一象限的交点
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*x"_f};
+    int count = 200;
+    Mat params(count, 2);
+    for (int i = 0; i < count; ++i) {
+        params.Value(i, 0) = 1 + 0.05 * i;
+        params.Value(i, 1) = 0.5 + 0.01 * i;
+    }
+
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::AUTO}) {
+        Config::Get().nonlinearMethod = method;
+        for (int threads : {1, 4}) {
+            BatchOptions options;
+            options.threads = threads;
+            BatchResult result = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, Mat({{1, 1}}), options);
+            ASSERT_EQ(result.solutions.Rows(), count);
+            ASSERT_EQ(result.solutions.Cols(), 2);
+            ASSERT_EQ(static_cast<int>(result.status.size()), count);
+            for (int i = 0; i < count; ++i) {
+                double r = params.Value(i, 0), a = params.Value(i, 1);
+                double x = r / std::sqrt(1 + a * a);
+                ASSERT_EQ(result.status[i], BatchStatus::CONVERGED);
+                ASSERT_NEAR(result.solutions.Value(i, 0), x, 1e-8);
+                ASSERT_NEAR(result.solutions.Value(i, 1), a * x, 1e-8);
+            }
+        }
+    }
+}
+
+TEST(Batch, Status) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 每组参数使用自己的初值
+    {
+        SymVec f = {"x^2 - a"_f};
+        BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{4}, {4}, {9}}), Mat({{1}, {-1}, {1}}));
+        ASSERT_EQ(result.solutions, Mat({{2}, {-2}, {3}}));
+
+        // x^2 = -1没有实根：从1出发的第一步到达0，雅可比矩阵奇异
+        result = SolveBatch(f, {"x"}, {"a"}, Mat({{4}, {-1}}), Mat({{1}}));
+        ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+        ASSERT_EQ(result.status[1], BatchStatus::SINGULAR);
+    }
+
+    // sqrt(x) = -1：第一步越过定义域
+    {
+        SymVec f = {"sqrt(x) - a"_f};
+        BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{2}, {-1}}), Mat({{1}}));
+        ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+        ASSERT_NEAR(result.solutions.Value(0, 0), 4, 1e-9);
+        ASSERT_EQ(result.status[1], BatchStatus::INVALID_NUMBER);
+    }
+
+    // 迭代次数超出限制，逐组求解与SIMD批量求解相同
+    {
+        SymVec f = {"x^2 - a"_f};
+        Config::Get().maxIterations = 1;
+        for (bool laneBatched : {true, false}) {
+            BatchOptions options;
+            options.laneBatched = laneBatched;
+            BatchResult result = SolveBatch(f, {"x"}, {"a"}, Mat({{1}, {100}}), Mat({{1}}), options);
+            ASSERT_EQ(result.status[0], BatchStatus::CONVERGED);
+            ASSERT_EQ(result.status[1], BatchStatus::ITERATION_LIMIT);
+        }
+        Config::Get().Reset();
+    }
+
+    // 其他错误不作为某一组的求解结果，照常抛出
+    {
+        SymVec f = {"x^2 - a"_f};
+        Config::Get().nonlinearMethod = static_cast<NonlinearMethod>(-1);
+        ASSERT_THROW(SolveBatch(f, {"x"}, {"a"}, Mat({{4}}), Mat({{1}})), std::runtime_error);
+        Config::Get().Reset();
+    }
+
+    // 尺寸不一致
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - x"_f};
+    try {
+        SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1, 2}}), Mat({{1, 1}}));
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::SIZE_NOT_MATCH);
+    }
+    ASSERT_THROW(SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1}, {2}}), Mat({{1, 1}, {1, 1}, {1, 1}})), MathError);
+    ASSERT_THROW(SolveBatch(f, {"x", "y"}, {"r"}, Mat({{1}}), Mat({{1}})), MathError);
+
+    // 方程组中有未声明的符号
+    try {
+        SolveBatch(f, {"x"}, {"r"}, Mat({{1}}), Mat({{1}}));
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+}
+
+TEST(Batch, Lanes) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // SIMD批量求解与逐组求解的结果相同，包括没有收敛的组。组数不是8的倍数
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*sqrt(x)"_f};
+    int count = 203;
+    Mat params(count, 2);
+    for (int i = 0; i < count; ++i) {
+        params.Value(i, 0) = i % 7 == 3 ? 0 : 0.5 + 0.02 * i;
+        params.Value(i, 1) = i % 11 == 5 ? -40 : 1 + 0.01 * i;
+    }
+    Mat guesses(count, 2, 1);
+    for (int i = 0; i < count; ++i) {
+        guesses.Value(i, 0) = 0.2 + 0.01 * (i % 13);
+    }
+
+    for (bool equilibrate : {true, false}) {
+        Config::Get().equilibrate = equilibrate;
+        Config::Get().stagnationIterations = 20;
+        BatchOptions scalar;
+        scalar.laneBatched = false;
+        BatchResult expected = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, guesses, scalar);
+        for (int threads : {1, 3}) {
+            BatchOptions options;
+            options.threads = threads;
+            BatchResult got = SolveBatch(f, {"x", "y"}, {"r", "a"}, params, guesses, options);
+            int converged = 0;
+            for (int i = 0; i < count; ++i) {
+                ASSERT_EQ(got.status[i], expected.status[i]) << i;
+                converged += got.status[i] == BatchStatus::CONVERGED;
+                if (got.status[i] == BatchStatus::CONVERGED) {
+                    ASSERT_NEAR(got.solutions.Value(i, 0), expected.solutions.Value(i, 0), 1e-12);
+                    ASSERT_NEAR(got.solutions.Value(i, 1), expected.solutions.Value(i, 1), 1e-12);
+                }
+            }
+            ASSERT_GT(converged, count / 2);
+            ASSERT_LT(converged, count);
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include <tomsolver/compiled_symmat.h>
+#include <tomsolver/error_type.h>
+#include <tomsolver/functions.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+using namespace tomsolver;
+
+TEST(CompiledSymMat, Base) {
+    MemoryLeakDetection mld;
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    std::vector<std::string> vars = {"x1", "x2", "x3"};
+    SymMat J = Jacobian(f, vars);
+
+    CompiledSymMat cf(f, vars);
+    CompiledSymMat cj(J, vars);
+    ASSERT_EQ(cf.Rows(), 3);
+    ASSERT_EQ(cf.Cols(), 1);
+    ASSERT_EQ(cj.Cols(), 3);
+    ASSERT_EQ(cj.VarNums(), 3);
+
+    // 与替换后计算的结果一致
+    VarsTable table({{"x1", 0.3}, {"x2", -1.2}, {"x3", 2.5}});
+    ASSERT_EQ(cf.Eval(table.Values()), f.Clone().Subs(table).Calc().ToMat());
+    ASSERT_EQ(cj.Eval(table.Values()), J.Clone().Subs(table).Calc().ToMat());
+
+    Mat out(3, 3);
+    cj.Eval(table.Values(), out);
+    ASSERT_EQ(out, J.Clone().Subs(table).Calc().ToMat());
+
+    // 变量顺序由vars决定
+    CompiledSymMat reversed(f, {"x3", "x2", "x1"});
+    ASSERT_EQ(reversed.Eval(Vec{2.5, -1.2, 0.3}), cf.Eval(table.Values()));
+
+    // float和long double求值
+    Mat expected = cf.Eval(table.Values());
+    float xf[] = {0.3f, -1.2f, 2.5f}, outf[3];
+    cf.Eval(xf, outf);
+    long double xl[] = {0.3L, -1.2L, 2.5L}, outl[3];
+    cf.Eval(xl, outl);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NEAR(outf[i], expected.Value(i, 0), 1e-6);
+        ASSERT_NEAR(static_cast<double>(outl[i]), expected.Value(i, 0), 1e-15);
+    }
+}
+
+TEST(CompiledSymMat, Calc) {
+    MemoryLeakDetection mld;
+
+    // 参数类型不一致时使用double版本
+    ASSERT_DOUBLE_EQ(Calc(MathOperator::MATH_ADD, 1.5, 2), 3.5);
+    ASSERT_DOUBLE_EQ(Calc(MathOperator::MATH_SQRT, 4, 0), 2);
+
+    // 显式指定标量类型
+    static_assert(std::is_same<decltype(Calc<float>(MathOperator::MATH_ADD, 1.5f, 2)), float>::value, "");
+    ASSERT_FLOAT_EQ(Calc<float>(MathOperator::MATH_MULTIPLY, 1.5f, 2), 3.0f);
+    ASSERT_EQ(Calc<long double>(MathOperator::MATH_DIVIDE, 1, 4), 0.25L);
+}
+
+TEST(CompiledSymMat, Error) {
+    MemoryLeakDetection mld;
+
+    // 未给出的变量
+    SymVec f = {"x+y"_f};
+    try {
+        CompiledSymMat c(f, {"x"});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+
+    // 无效值
+    CompiledSymMat c({{"log(x)"_f}}, {"x"});
+    ASSERT_THROW(c.Eval(Vec{-1}), MathError);
+    float x = -1, out;
+    ASSERT_THROW(c.Eval(&x, &out), MathError);
+}
+
+TEST(CompiledSymMat, Params) {
+    MemoryLeakDetection mld;
+
+    // a、r为参数：修改参数值不需要重新编译
+    SymVec f = {"x^2 + y^2 - r^2"_f, "y - a*x"_f};
+    CompiledSymMat c(f, {"x", "y"}, {"r", "a"});
+    ASSERT_EQ(c.VarNums(), 2);
+    ASSERT_EQ(c.ParamNums(), 2);
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{5}, {2}}));
+
+    c.SetParams(Vec{2, 3});
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{1}, {-1}}));
+    double xf[] = {3, 1}, out[2];
+    c.Eval(xf, out);
+    ASSERT_DOUBLE_EQ(out[0], 6);
+    ASSERT_DOUBLE_EQ(out[1], -8);
+
+    // 与替换后计算的结果一致
+    VarsTable table({{"x", 1}, {"y", 2}, {"r", 2}, {"a", 3}});
+    ASSERT_EQ(c.Eval(Vec{1, 2}), f.Clone().Subs(table).Calc().ToMat());
+
+    // 副本的参数值互不影响
+    CompiledSymMat copy = c;
+    copy.SetParams(Vec{0, 0});
+    ASSERT_EQ(copy.Eval(Vec{1, 2}), Mat({{5}, {2}}));
+    ASSERT_EQ(c.Eval(Vec{1, 2}), Mat({{1}, {-1}}));
+
+    // 参数与变量重名
+    try {
+        CompiledSymMat dup(f, {"x", "y"}, {"r", "x"});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_VAR_HAS_BEEN_DEFINED);
+    }
+}
+
+TEST(CompiledSymMat, Lanes) {
+    MemoryLeakDetection mld;
+
+    // 4组自变量与参数交错存放，结果与逐组求值相同
+    SymVec f = {"sqrt(x) * a + y"_f, "x ^ 2 - y / a"_f};
+    CompiledSymMat c(f, {"x", "y"}, {"a"});
+    double x[] = {1, 4, 9, -1, 2, 3, 4, 5}, a[] = {1, 2, 0.5, 3}, out[8];
+    bool invalid[4] = {};
+    c.EvalLanes<4>(x, a, out, invalid);
+    for (int l = 0; l < 3; ++l) {
+        c.SetParams(Vec{a[l]});
+        Mat expected = c.Eval(Vec{x[l], x[4 + l]});
+        ASSERT_FALSE(invalid[l]);
+        ASSERT_DOUBLE_EQ(out[l], expected.Value(0, 0));
+        ASSERT_DOUBLE_EQ(out[4 + l], expected.Value(1, 0));
+    }
+
+    // sqrt(-1)只影响第3组，不抛出异常
+    ASSERT_TRUE(invalid[3]);
+    ASSERT_DOUBLE_EQ(out[7], 1 - 5.0 / 3);
+
+    // 组数不是4的倍数，空闲的第3路全为0：对0取模的结果为nan，不会出现整数除以0
+    SymVec g = {"x % a + (y & 6) + (y | 1)"_f};
+    CompiledSymMat d(g, {"x", "y"}, {"a"});
+    double gx[] = {7, 8, -9, 0, 3, 5, 6, 0}, ga[] = {3, 5, 4, 0}, gout[4];
+    bool ginvalid[4] = {};
+    d.EvalLanes<4>(gx, ga, gout, ginvalid);
+    for (int l = 0; l < 3; ++l) {
+        d.SetParams(Vec{ga[l]});
+        ASSERT_FALSE(ginvalid[l]);
+        ASSERT_DOUBLE_EQ(gout[l], d.Eval(Vec{gx[l], gx[4 + l]}).Value(0, 0));
+    }
+    ASSERT_TRUE(ginvalid[3]);
+    ASSERT_TRUE(std::isnan(gout[3]));
+
+    // nan与超出int范围的操作数同样得到nan
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    double hx[] = {nan, 1e10, 1, 2, 1, 1, 1e10, 1}, ha[] = {3, 3, 3, 3}, hout[4];
+    bool hinvalid[4] = {};
+    d.EvalLanes<4>(hx, ha, hout, hinvalid);
+    ASSERT_TRUE(hinvalid[0] && hinvalid[1] && hinvalid[2]);
+    ASSERT_FALSE(hinvalid[3]);
+    ASSERT_DOUBLE_EQ(hout[3], 2 + 0 + 1);
+}
+
+TEST(CompiledSymMat, Deep) {
+    MemoryLeakDetection mld;
+
+    // 右结合的长表达式，求值栈深度超过64
+    Node n = Var("x");
+    for (int i = 0; i < 100; ++i) {
+        n = Var("x") + std::move(n) * Num(0.5);
+    }
+    SymMat m(1, 1);
+    m.Value(0, 0) = Clone(n);
+    CompiledSymMat c(m, {"x"});
+    double expected = 0, k = 1;
+    for (int i = 0; i <= 100; ++i) {
+        expected += 2 * k;
+        k *= 0.5;
+    }
+    ASSERT_NEAR(c.Eval(Vec{2}).Value(0, 0), expected, 1e-12);
+}
@@ -0,0 +1,113 @@
+#include <tomsolver/config.h>
+#include <tomsolver/error_type.h>
+#include <tomsolver/linear.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace tomsolver;
+
+TEST(Config, Scope) {
+    MemoryLeakDetection mld;
+
+    SolverOptions options;
+    options.epsilon = 1.0e-3;
+    {
+        ConfigScope scope(options);
+        ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-3);
+
+        // 可以嵌套
+        options.epsilon = 1.0e-5;
+        {
+            ConfigScope inner(options);
+            ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-5);
+        }
+        ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-3);
+
+        // 其他线程仍然使用全局配置
+        double other = 0;
+        std::thread t([&other] {
+            other = Config::Get().epsilon;
+        });
+        t.join();
+        ASSERT_DOUBLE_EQ(other, 1.0e-9);
+
+        // 作用域内的修改不影响全局配置
+        Config::Get().maxIterations = 1;
+    }
+    ASSERT_DOUBLE_EQ(Config::Get().epsilon, 1.0e-9);
+    ASSERT_EQ(Config::Get().maxIterations, 100);
+}
+
+TEST(Config, ConcurrentOptions) {
+    MemoryLeakDetection mld;
+
+    SymVec equations = {"x^2 + y^2 - 4"_f, "x - y"_f};
+    VarsTable start{{"x", 1}, {"y", 0.5}};
+    Mat A = {{1, 1}};
+    Vec b = {2};
+    Node invalid = "log(0-1)"_f;
+
+    // 每个线程使用不同的选项反复求解，结果只取决于自己的选项
+    std::atomic<int> failures{0};
+    auto worker = [&](int id) {
+        SolverOptions options;
+        bool odd = id % 2 == 1;
+        options.nonlinearMethod = odd ? NonlinearMethod::LM : NonlinearMethod::NEWTON_RAPHSON;
+        options.epsilon = odd ? 1.0e-12 : 1.0e-6;
+        options.allowIndeterminateEquation = odd;
+        options.throwOnInvalidValue = !odd;
+        for (int i = 0; i < 200; ++i) {
+            VarsTable got = Solve(equations, start, options);
+            if (!(std::abs(got["x"] - std::sqrt(2.0)) < 1.0e-5) ||
+                !(std::abs(got["x"] - got["y"]) < options.epsilon)) {
+                ++failures;
+            }
+
+            try {
+                Vec x = SolveLinear(A, b, options);
+                if (!odd || !(std::abs(x[0] - 1) < 1.0e-9)) {
+                    ++failures;
+                }
+            } catch (const MathError &) {
+                if (odd) {
+                    ++failures;
+                }
+            }
+
+            try {
+                double v = invalid->Vpa(options);
+                if (!odd || !std::isnan(v)) {
+                    ++failures;
+                }
+            } catch (const MathError &) {
+                if (odd) {
+                    ++failures;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int id = 0; id < 8; ++id) {
+        threads.emplace_back(worker, id);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(failures, 0);
+
+    // 全局配置没有被修改
+    ASSERT_EQ(Config::Get().nonlinearMethod, NonlinearMethod::NEWTON_RAPHSON);
+    ASSERT_FALSE(Config::Get().allowIndeterminateEquation);
+    ASSERT_THROW(SolveLinear(A, b), MathError);
+    ASSERT_THROW(invalid->Vpa(), MathError);
+}
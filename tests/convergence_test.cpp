@@ -0,0 +1,180 @@
+#include <tomsolver/config.h>
+#include <tomsolver/convergence.h>
+#include <tomsolver/error_type.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+using namespace tomsolver;
+
+TEST(ConvergenceMonitor, Base) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 默认只有绝对残差容差
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_FALSE(monitor.Check(0, Vec({10, -20})));
+        ASSERT_DOUBLE_EQ(monitor.Tolerance(), Config::Get().epsilon);
+        ASSERT_FALSE(monitor.Check(1, Vec({1e-3, 0})));
+        ASSERT_TRUE(monitor.Check(2, Vec({1e-10, -1e-10})));
+        ASSERT_FALSE(monitor.StepConverged(0, 1));
+        ASSERT_FALSE(monitor.Check(3, Vec({std::numeric_limits<double>::quiet_NaN(), 0})));
+    }
+
+    // 相对残差容差
+    Config::Get().relativeTolerance = 0.01;
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_FALSE(monitor.Check(0, Vec({10, -20})));
+        ASSERT_DOUBLE_EQ(monitor.Tolerance(), 0.2);
+        ASSERT_FALSE(monitor.Check(1, Vec({0.1, -0.3})));
+        ASSERT_TRUE(monitor.Check(2, Vec({0.1, -0.2})));
+    }
+    Config::Get().relativeTolerance = 0;
+
+    // 步长容差
+    Config::Get().stepTolerance = 1e-6;
+    {
+        ConvergenceMonitor monitor;
+        ASSERT_TRUE(monitor.StepConverged(1e-7, 1));
+        ASSERT_FALSE(monitor.StepConverged(1e-5, 1));
+        ASSERT_TRUE(monitor.StepConverged(1e-3, 1e4));
+        ASSERT_TRUE(monitor.StepConverged(0, 0));
+    }
+    Config::Get().stepTolerance = 0;
+
+    // 发散
+    Config::Get().divergenceRatio = 100;
+    {
+        ConvergenceMonitor monitor;
+        monitor.Check(0, Vec({1}));
+        monitor.Check(1, Vec({99}));
+        try {
+            monitor.Check(2, Vec({101}));
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_DIVERGENCE);
+        }
+    }
+    Config::Get().divergenceRatio = 0;
+
+    // 停滞：下降不足STAGNATION_DECREASE的迭代不算作进展
+    Config::Get().stagnationIterations = 3;
+    {
+        ConvergenceMonitor monitor;
+        monitor.Check(0, Vec({1}));
+        monitor.Check(1, Vec({0.5}));
+        monitor.Check(2, Vec({0.4999}));
+        monitor.Check(3, Vec({0.6}));
+        monitor.Check(4, Vec({0.1}));
+        monitor.Check(5, Vec({0.2}));
+        monitor.Check(6, Vec({0.09999}));
+        try {
+            monitor.Check(7, Vec({0.1}));
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_STAGNATION);
+        }
+    }
+}
+
+TEST(ConvergenceMonitor, Cancel) {
+    MemoryLeakDetection mld;
+
+    std::atomic<bool> cancelled{false};
+    ConvergenceMonitor monitor;
+    monitor.SetCancelFlag(&cancelled);
+    ASSERT_FALSE(monitor.Check(0, Vec({1})));
+    cancelled = true;
+    try {
+        monitor.Check(1, Vec({0.5}));
+        FAIL();
+    } catch (const MathError &err) {
+        ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_CANCELLED);
+    }
+
+    // 在迭代中途取消
+    SymVec f = {"x^2 + 1"_f};
+    CompiledSymMat compiled(f, {"x"});
+    CompiledSymMat jacobian(Jacobian(f, {"x"}), {"x"});
+    Vec q = {3};
+    ConvergenceMonitor solveMonitor;
+    solveMonitor.SetCancelFlag(&cancelled);
+    ASSERT_THROW(internal::SolveCompiled(NonlinearMethod::LM, compiled, jacobian, q, solveMonitor), MathError);
+}
+
+TEST(ConvergenceMonitor, Solve) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 相对残差容差与步长容差让迭代提前结束
+    SymVec f = {"x^2 - 2"_f};
+    VarsTable init{{"x", 1}};
+    Config::Get().relativeTolerance = 1e-3;
+    VarsTable got = Solve(f, init);
+    ASSERT_LE(std::abs(got["x"] * got["x"] - 2), 1e-3);
+    ASSERT_GT(std::abs(got["x"] * got["x"] - 2), Config::Get().epsilon);
+    Config::Get().relativeTolerance = 0;
+
+    Config::Get().stepTolerance = 1e-4;
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::NEWTON_KRYLOV}) {
+        Config::Get().nonlinearMethod = method;
+        got = Solve(f, init);
+        ASSERT_NEAR(got["x"], std::sqrt(2.0), 1e-6);
+    }
+    Config::Get().stepTolerance = 0;
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // x² + 1 = 0没有实根：默认一直迭代到次数上限，开启停滞检测后提前放弃
+    SymVec hopeless = {"x^2 + 1"_f};
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG}) {
+        Config::Get().nonlinearMethod = method;
+        Config::Get().stagnationIterations = 0;
+        ASSERT_THROW(Solve(hopeless, VarsTable{{"x", 3}}), std::runtime_error);
+
+        Config::Get().stagnationIterations = 10;
+        try {
+            Solve(hopeless, VarsTable{{"x", 3}});
+            FAIL();
+        } catch (const MathError &err) {
+            ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_STAGNATION);
+        }
+    }
+    Config::Get().stagnationIterations = 0;
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // 立方根的牛顿迭代x ← -2x发散，||F||每次增大2^(1/3)倍
+    SymVec cbrt = {"x / (x^2)^(1/3)"_f};
+    Config::Get().divergenceRatio = 10;
+    try {
+        Solve(cbrt, VarsTable{{"x", 1}});
+        FAIL();
+    } catch (const MathError &err) {
+        ASSERT_EQ(err.GetErrorType(), ErrorType::ERROR_DIVERGENCE);
+    }
+
+    // 编译期确定尺寸的牛顿法使用相同的判断
+    auto fixed = [](const FixedVec<1> &x) -> FixedVec<1> {
+        return {x[0] / std::cbrt(x[0] * x[0])};
+    };
+    auto dfixed = [](const FixedVec<1> &x) -> FixedMat<1, 1> {
+        return {1 / (3 * std::cbrt(x[0] * x[0]))};
+    };
+    ASSERT_THROW(SolveByNewtonRaphson<1>(fixed, dfixed, FixedVec<1>{1}), MathError);
+}
@@ -0,0 +1,110 @@
+#include <tomsolver/fixed_mat.h>
+#include <tomsolver/linear.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <type_traits>
+
+using namespace tomsolver;
+
+TEST(FixedMat, Basic) {
+    MemoryLeakDetection mld;
+
+    FixedMat<2, 3> A = {{1, 2, 3}, {4, 5, 6}};
+    ASSERT_EQ(A.Rows(), 2);
+    ASSERT_EQ(A.Cols(), 3);
+    ASSERT_EQ(A.Value(1, 2), 6);
+    ASSERT_EQ(A.ToMat(), Mat({{1, 2, 3}, {4, 5, 6}}));
+    ASSERT_EQ(A.Transpose().ToMat(), Mat({{1, 4}, {2, 5}, {3, 6}}));
+
+    FixedVec<3> x = {1, 0, -1};
+    ASSERT_EQ(A * x, (FixedVec<2>{-2, -2}));
+    ASSERT_EQ(A * A.Transpose(), (FixedMat<2, 2>{{14, 32}, {32, 77}}));
+
+    // 与Mat混合运算得到表达式，可以赋值给Mat
+    Mat B = {{1, 1, 1}, {1, 1, 1}};
+    Mat sum = A + 2 * B;
+    ASSERT_EQ(sum, Mat({{3, 4, 5}, {6, 7, 8}}));
+    FixedMat<2, 3> C(sum);
+    ASSERT_EQ(C, (FixedMat<2, 3>{{3, 4, 5}, {6, 7, 8}}));
+
+    // FixedMat之间运算的结果仍是FixedMat
+    static_assert(std::is_same<decltype(-A + 0.5 * A - A * 2), FixedMat<2, 3>>::value, "");
+    ASSERT_EQ(-A + 0.5 * A - A * 2, (FixedMat<2, 3>{{-2.5, -5, -7.5}, {-10, -12.5, -15}}));
+    C = C - A;
+    ASSERT_EQ(C, (FixedMat<2, 3>(2)));
+    C -= FixedMat<2, 3>(2);
+    ASSERT_EQ(C, 0);
+    ASSERT_EQ((FixedMat<2, 3>(B).ToMat()), B);
+}
+
+TEST(FixedMat, SolveLinear) {
+    MemoryLeakDetection mld;
+
+    {
+        FixedMat<1, 1> A = {4};
+        ASSERT_EQ(SolveLinear(A, FixedVec<1>{2}), FixedVec<1>{0.5});
+    }
+
+    {
+        // 第一列主元在第二行
+        FixedMat<2, 2> A = {{1, 2}, {3, 4}};
+        FixedVec<2> b = {5, 6};
+        ASSERT_EQ(SolveLinear(A, b), FixedVec<2>({-4, 4.5}));
+        ASSERT_THROW(SolveLinear(FixedMat<2, 2>({{1, 2}, {2, 4}}), b), MathError);
+        ASSERT_THROW(SolveLinear(FixedMat<2, 2>({{0, 2}, {0, 4}}), b), MathError);
+    }
+
+    {
+        FixedMat<3, 3> A = {{2, 1, 1}, {4, -6, 0}, {-2, 7, 2}};
+        FixedVec<3> b = {5, -2, 9};
+        ASSERT_EQ(SolveLinear(A, b), FixedVec<3>({1, 1, 2}));
+    }
+
+    // 与Mat版本的结果一致
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-1, 4, -1, 0, 0, 1}, {0, -1, 4, -1, 0, 0},
+             {0, 0, -1, 4, -1, 0}, {1, 0, 0, -1, 4, -1}, {0, 1, 0, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    FixedLUFactorization<6> lu(FixedMat<6, 6>{A});
+    ASSERT_TRUE(lu.IsFactored());
+    ASSERT_EQ(lu.Solve(FixedVec<6>(b)).ToMat(), Mat(SolveLinear(A, b)));
+    ASSERT_EQ(SolveLinear(FixedMat<6, 6>(A), FixedVec<6>(b)).ToMat(), Mat(SolveLinear(A, b)));
+
+    Mat S = {{1, 2, 3}, {2, 4, 6}, {0, 0, 1}};
+    ASSERT_THROW(SolveLinear(FixedMat<3, 3>(S), FixedVec<3>{1, 2, 3}), MathError);
+}
+
+TEST(FixedMat, Solve) {
+    MemoryLeakDetection mld;
+
+    // 数值函数：圆与直线的交点
+    auto f = [](const FixedVec<2> &x) -> FixedVec<2> {
+        return {x[0] * x[0] + x[1] * x[1] - 4, x[0] - x[1]};
+    };
+    auto df = [](const FixedVec<2> &x) -> FixedMat<2, 2> {
+        return {{2 * x[0], 2 * x[1]}, {1, -1}};
+    };
+    FixedVec<2> x = SolveByNewtonRaphson<2>(f, df, FixedVec<2>{1, 0.5});
+    ASSERT_NEAR(x[0], std::sqrt(2.0), 1e-9);
+    ASSERT_NEAR(x[1], std::sqrt(2.0), 1e-9);
+
+    // 雅可比矩阵奇异
+    ASSERT_THROW(SolveByNewtonRaphson<2>(f, df, FixedVec<2>{0, 0}), MathError);
+
+    // 符号方程组
+    SymVec equations = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+    VarsTable got = Solve<3>(equations, VarsTable({"x1", "x2", "x3"}, 1.0));
+    ASSERT_EQ(got, expected);
+
+    ASSERT_THROW(Solve<2>(equations, VarsTable({"x1", "x2", "x3"}, 1.0)), MathError);
+}
@@ -5,11 +5,45 @@
 
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <new>
 #include <random>
 
 using std::cout;
 using std::endl;
 
+namespace {
+
+long long &AllocationCounter() noexcept {
+    static thread_local long long count = 0;
+    return count;
+}
+
+} // namespace
+
+// 不允许内联：operator delete内联到调用处后，编译器会把其中的free误报为与new不匹配
+#ifdef _MSC_VER
+#define TOMSOLVER_TEST_NOINLINE __declspec(noinline)
+#else
+#define TOMSOLVER_TEST_NOINLINE __attribute__((noinline))
+#endif
+
+TOMSOLVER_TEST_NOINLINE void *operator new(std::size_t size) {
+    ++AllocationCounter();
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+TOMSOLVER_TEST_NOINLINE void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+TOMSOLVER_TEST_NOINLINE void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
 namespace tomsolver {
 
 std::pair<Node, double> CreateRandomExpresionTree(int len) {
@@ -122,4 +156,8 @@ std::pair<Node, double> CreateRandomExpresionTree(int len) {
     return {std::move(node), v};
 }
 
+long long AllocationCount() noexcept {
+    return AllocationCounter();
+}
+
 } // namespace tomsolver
\ No newline at end of file
@@ -5,4 +5,9 @@ namespace tomsolver {
 
 std::pair<Node, double> CreateRandomExpresionTree(int len);
 
+/**
+ * 当前线程通过operator new申请堆内存的累计次数。用于检查某段代码是否申请了堆内存。
+ */
+long long AllocationCount() noexcept;
+
 } // namespace tomsolver
\ No newline at end of file
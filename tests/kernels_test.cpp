@@ -0,0 +1,145 @@
+#include <tomsolver/kernels.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace tomsolver;
+
+TEST(Kernels, Level1) {
+    MemoryLeakDetection mld;
+
+    // 覆盖各指令集的整块部分和剩余尾部
+    for (int n : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33}) {
+        std::vector<double> x(n), y(n), out(n);
+        double dot = 0, absMax = 0;
+        for (int i = 0; i < n; ++i) {
+            x[i] = (i % 3 == 0 ? -1 : 1) * (0.5 + i);
+            y[i] = 0.25 * i - 1;
+            dot += x[i] * y[i];
+            absMax = std::max(absMax, std::abs(x[i]));
+        }
+
+        ASSERT_NEAR(internal::Dot(n, x.data(), y.data()), dot, 1e-12);
+        ASSERT_DOUBLE_EQ(internal::AbsMax(n, x.data()), absMax);
+
+        internal::ScaledAdd(n, x.data(), -2, y.data(), out.data());
+        for (int i = 0; i < n; ++i) {
+            ASSERT_DOUBLE_EQ(out[i], x[i] - 2 * y[i]);
+        }
+
+        // out与x为同一地址
+        internal::ScaledAdd(n, x.data(), 3, y.data(), x.data());
+        for (int i = 0; i < n; ++i) {
+            ASSERT_DOUBLE_EQ(x[i], out[i] + 5 * y[i]);
+        }
+
+        ASSERT_TRUE(internal::AllAbsLess(n, y.data(), absMax + 1e9));
+        ASSERT_TRUE(internal::AllAbsDiffLess(n, x.data(), x.data(), 1e-12));
+
+        // 最后一个元素不满足时也要能发现
+        std::vector<double> z(n, 0.0);
+        ASSERT_TRUE(internal::AllAbsLess(n, z.data(), 1e-9));
+        z[n - 1] = -1e-3;
+        ASSERT_FALSE(internal::AllAbsLess(n, z.data(), 1e-9));
+        std::vector<double> zero(n, 0.0);
+        ASSERT_FALSE(internal::AllAbsDiffLess(n, z.data(), zero.data(), 1e-9));
+    }
+}
+
+TEST(Kernels, NaN) {
+    MemoryLeakDetection mld;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (int n : {1, 3, 4, 8, 11}) {
+        for (int pos = 0; pos < n; ++pos) {
+            std::vector<double> x(n, 0.0), y(n, 0.0);
+            x[pos] = nan;
+            ASSERT_FALSE(internal::AllAbsLess(n, x.data(), 1.0));
+            ASSERT_FALSE(internal::AllAbsDiffLess(n, x.data(), y.data(), 1.0));
+            ASSERT_FALSE(internal::AllAbsDiffLess(n, y.data(), x.data(), 1.0));
+            ASSERT_TRUE(std::isnan(internal::Dot(n, x.data(), x.data())));
+        }
+    }
+}
+
+TEST(Kernels, Variants) {
+    MemoryLeakDetection mld;
+
+    const internal::SimdLevel original = internal::GetSimdLevel();
+    std::shared_ptr<void> defer(nullptr, [original](auto) {
+        internal::SetSimdLevel(original);
+    });
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const int m = 13, n = 19, k = 11;
+    std::vector<double> A(m * k), B(k * n);
+    for (int i = 0; i < m * k; ++i) {
+        A[i] = std::sin(0.7 * i);
+    }
+    for (int i = 0; i < k * n; ++i) {
+        B[i] = std::cos(0.3 * i) - 0.5;
+    }
+
+    // 逐个切换到CPU支持的每种实现，与标量实现的结果逐项对比
+    for (auto level : {internal::SimdLevel::SCALAR, internal::SimdLevel::SSE2, internal::SimdLevel::AVX2,
+                       internal::SimdLevel::AVX512}) {
+        auto used = internal::SetSimdLevel(level);
+        ASSERT_EQ(internal::GetSimdLevel(), used);
+        if (used != level) {
+            std::cout << "skip SimdLevel " << static_cast<int>(level) << ": not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        for (int len : {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33}) {
+            std::vector<double> x(len), y(len), out(len);
+            double dot = 0, absMax = 0;
+            for (int i = 0; i < len; ++i) {
+                x[i] = (i % 3 == 0 ? -1 : 1) * (0.5 + i);
+                y[i] = 0.25 * i - 1;
+                dot += x[i] * y[i];
+                absMax = std::max(absMax, std::abs(x[i]));
+            }
+
+            ASSERT_NEAR(internal::Dot(len, x.data(), y.data()), dot, 1e-12);
+            ASSERT_EQ(internal::AbsMax(len, x.data()), absMax);
+            internal::ScaledAdd(len, x.data(), -2, y.data(), out.data());
+            for (int i = 0; i < len; ++i) {
+                ASSERT_DOUBLE_EQ(out[i], x[i] - 2 * y[i]);
+            }
+            ASSERT_EQ(internal::AllAbsLess(len, x.data(), absMax), len == 0);
+            ASSERT_TRUE(internal::AllAbsLess(len, x.data(), absMax + 1));
+            ASSERT_TRUE(internal::AllAbsDiffLess(len, x.data(), x.data(), 1e-12));
+
+            // nan出现在整块部分或尾部时，所有实现的结果都相同
+            for (int pos = 0; pos < len; ++pos) {
+                std::vector<double> z = x;
+                z[pos] = nan;
+                ASSERT_TRUE(std::isnan(internal::AbsMax(len, z.data())));
+                ASSERT_TRUE(std::isnan(internal::Dot(len, z.data(), y.data())));
+                ASSERT_FALSE(internal::AllAbsLess(len, z.data(), 1e300));
+                ASSERT_FALSE(internal::AllAbsDiffLess(len, z.data(), x.data(), 1e300));
+                z[pos] = -nan;
+                ASSERT_TRUE(std::isnan(internal::AbsMax(len, z.data())));
+            }
+        }
+
+        std::vector<double> C(m * n);
+        internal::Gemm(m, n, k, A.data(), B.data(), C.data());
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                double c = 0;
+                for (int p = 0; p < k; ++p) {
+                    c += A[i * k + p] * B[p * n + j];
+                }
+                ASSERT_NEAR(C[i * n + j], c, 1e-12);
+            }
+        }
+    }
+}
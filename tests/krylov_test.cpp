@@ -0,0 +1,272 @@
+#include <tomsolver/compiled_symmat.h>
+#include <tomsolver/config.h>
+#include <tomsolver/krylov.h>
+#include <tomsolver/linear.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+#include <tomsolver/sparse_mat.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace tomsolver;
+
+TEST(Krylov, GMRES) {
+    MemoryLeakDetection mld;
+
+    // 不对称矩阵
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-2, 5, -1, 0, 0, 1}, {0, -1, 6, -1, 0, 0},
+             {0, 3, -1, 4, -1, 0}, {1, 0, 0, -1, 7, -1}, {0, 1, 2, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    Vec expected = SolveLinear(A, b);
+
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        for (int i = 0; i < A.Rows(); ++i) {
+            out[i] = Dot(MatView(A).Row(i), v);
+        }
+    };
+
+    // 不重启时至多6次迭代得到精确解
+    {
+        GMRES gmres(6, 6);
+        Vec x(6);
+        ASSERT_TRUE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 100));
+        ASSERT_LE(gmres.Iterations(), 6);
+        ASSERT_EQ(x, expected);
+    }
+
+    // 频繁重启，以及Jacobi预条件
+    {
+        GMRES gmres(6, 2);
+        Vec x(6);
+        ASSERT_TRUE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 100));
+        ASSERT_EQ(x, expected);
+
+        LinearOperator jacobi = [&](VecView v, MutableVecView out) {
+            for (int i = 0; i < A.Rows(); ++i) {
+                out[i] = v[i] / A.Value(i, i);
+            }
+        };
+        Vec y(6);
+        ASSERT_TRUE(gmres.Solve(op, jacobi, b, y, 1.0e-12, 100));
+        ASSERT_EQ(y, expected);
+    }
+
+    // 迭代次数不足
+    {
+        GMRES gmres(6, 2);
+        Vec x(6);
+        ASSERT_FALSE(gmres.Solve(op, nullptr, b, x, 1.0e-12, 1));
+        ASSERT_EQ(gmres.Iterations(), 1);
+        ASSERT_GT(gmres.RelativeResidual(), 1.0e-12);
+    }
+
+    // 奇异矩阵，b不在值域内：第二列的对角元为0，只用第一列求解
+    {
+        LinearOperator singular = [](VecView v, MutableVecView out) {
+            out[0] = v[0];
+            out[1] = 0;
+        };
+        GMRES gmres(2, 2);
+        Vec x(2);
+        ASSERT_FALSE(gmres.Solve(singular, nullptr, Vec{1, 1}, x, 1.0e-12, 100));
+        ASSERT_TRUE(std::isfinite(x[0]) && std::isfinite(x[1]));
+        ASSERT_NEAR(gmres.RelativeResidual(), std::sqrt(0.5), 1.0e-12);
+        ASSERT_NEAR(x[0], 1, 1.0e-12);
+        ASSERT_NEAR(x[1], 1, 1.0e-12);
+    }
+}
+
+TEST(Krylov, BiCGSTAB) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{4, -1, 0, 0, 1, 0},  {-2, 5, -1, 0, 0, 1}, {0, -1, 6, -1, 0, 0},
+             {0, 3, -1, 4, -1, 0}, {1, 0, 0, -1, 7, -1}, {0, 1, 2, 0, -1, 4}};
+    Vec b = {1, 2, 3, 4, 5, 6};
+    Vec expected = SolveLinear(A, b);
+
+    SparseMat S(A);
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        S.Multiply(v, out);
+    };
+
+    BiCGSTAB solver(6);
+    Vec x(6);
+    ASSERT_TRUE(solver.Solve(op, nullptr, b, x, 1.0e-12, 100));
+    ASSERT_EQ(x, expected);
+
+    // 预条件子可以直接作为LinearOperator
+    Vec y(6);
+    ASSERT_TRUE(solver.Solve(op, ILU0Preconditioner(S), b, y, 1.0e-12, 100));
+    ASSERT_EQ(y, expected);
+
+    Vec z(6);
+    ASSERT_TRUE(solver.Solve(op, JacobiPreconditioner(A), b, z, 1.0e-12, 100));
+    ASSERT_EQ(z, expected);
+}
+
+TEST(Krylov, ConjugateGradient) {
+    MemoryLeakDetection mld;
+
+    // n×n网格上二维泊松方程的五点差分矩阵，对称正定，对角占优
+    int n = 20;
+    std::vector<SparseMat::Triplet> triplets;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            int k = i * n + j;
+            triplets.push_back({k, k, 4});
+            if (i > 0) {
+                triplets.push_back({k, k - n, -1});
+            }
+            if (i + 1 < n) {
+                triplets.push_back({k, k + n, -1});
+            }
+            if (j > 0) {
+                triplets.push_back({k, k - 1, -1});
+            }
+            if (j + 1 < n) {
+                triplets.push_back({k, k + 1, -1});
+            }
+        }
+    }
+    SparseMat A(n * n, n * n, triplets);
+    ASSERT_EQ(A.NonZeros(), 5 * n * n - 4 * n);
+    LinearOperator op = [&](VecView v, MutableVecView out) {
+        A.Multiply(v, out);
+    };
+    Vec b(n * n, 1);
+    Vec r(n * n);
+
+    ConjugateGradient cg(n * n);
+    Vec x(n * n);
+    ASSERT_TRUE(cg.Solve(op, nullptr, b, x, 1.0e-10, 1000));
+    A.Multiply(x, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+    int plain = cg.Iterations();
+
+    // ILU(0)预条件减少迭代次数
+    Vec y(n * n);
+    ASSERT_TRUE(cg.Solve(op, ILU0Preconditioner(A), b, y, 1.0e-10, 1000));
+    ASSERT_LT(cg.Iterations(), plain);
+    A.Multiply(y, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+
+    // BiCGSTAB同样适用
+    BiCGSTAB bicgstab(n * n);
+    Vec z(n * n);
+    ASSERT_TRUE(bicgstab.Solve(op, ILU0Preconditioner(A), b, z, 1.0e-10, 1000));
+    A.Multiply(z, r);
+    ASSERT_LT((r - b).NormInfinity(), 1.0e-8);
+
+    // 缺少对角元
+    ASSERT_THROW(ILU0Preconditioner(SparseMat(2, 2, {{0, 1, 1}, {1, 0, 1}})), MathError);
+    ASSERT_THROW(JacobiPreconditioner(SparseMat(2, 2, {{0, 1, 1}, {1, 0, 1}})), MathError);
+}
+
+TEST(Krylov, NewtonKrylov) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_KRYLOV;
+    VarsTable got = Solve(f, varsTable);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-8);
+    }
+
+    ASSERT_THROW(SolveByNewtonKrylov({"x+y"_f}, VarsTable{{"x", 1}, {"y", 1}}), MathError);
+
+    // 完整的步会使arctan(x) = 0发散，一维搜索的φ'(0)由差商得到
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        Config::Get().lineSearch = method;
+        got = SolveByNewtonKrylov({"arctan(x)"_f}, VarsTable{{"x", 3}});
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+}
+
+TEST(Krylov, Bratu) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 一维Bratu问题u'' + λe^u = 0, u(0) = u(1) = 0的差分方程组，三对角的雅可比矩阵
+    int n = 100;
+    double h = 1.0 / (n + 1);
+    double lambda = 1;
+    SymVec equations(n);
+    std::vector<std::string> vars;
+    for (int i = 0; i < n; ++i) {
+        vars.emplace_back("u" + std::to_string(i));
+    }
+    for (int i = 0; i < n; ++i) {
+        std::string eq = "-2*" + vars[i] + "+" + ToString(h * h * lambda) + "*exp(" + vars[i] + ")";
+        if (i > 0) {
+            eq += "+" + vars[i - 1];
+        }
+        if (i + 1 < n) {
+            eq += "+" + vars[i + 1];
+        }
+        equations[i] = Parse(eq);
+    }
+    VarsTable varsTable(vars, 0);
+
+    Config::Get().krylovRestart = 10;
+    VarsTable expected = SolveByNewtonKrylov(equations, varsTable);
+    CompiledSymMat f(equations, vars);
+    ASSERT_LT(f.Eval(expected.Values()).NormInfinity(), 1.0e-9);
+
+    // 解关于x = 0.5对称，最大值约为0.1405
+    ASSERT_NEAR(expected["u49"], expected["u50"], 1.0e-9);
+    ASSERT_NEAR(expected["u49"], 0.1405, 1.0e-3);
+
+    // 以三对角部分的对角元作为Jacobi预条件子
+    int calls = 0;
+    VarsTable got = SolveByNewtonKrylov(equations, varsTable, [&](VecView q) -> LinearOperator {
+        ++calls;
+        Vec diag(n);
+        for (int i = 0; i < n; ++i) {
+            diag[i] = -2 + h * h * lambda * std::exp(q[i]);
+        }
+        return [diag](VecView v, MutableVecView out) {
+            for (int i = 0; i < v.Size(); ++i) {
+                out[i] = v[i] / diag[i];
+            }
+        };
+    });
+    ASSERT_GT(calls, 0);
+    ASSERT_LT(f.Eval(got.Values()).NormInfinity(), 1.0e-9);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+
+    // BiCGSTAB，以及固定的线性精度
+    Config::Get().krylovMethod = KrylovMethod::BICGSTAB;
+    Config::Get().eisenstatWalker = false;
+    got = SolveByNewtonKrylov(equations, varsTable);
+    ASSERT_LT(f.Eval(got.Values()).NormInfinity(), 1.0e-9);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
@@ -0,0 +1,125 @@
+#include <tomsolver/config.h>
+#include <tomsolver/line_search.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+
+using namespace tomsolver;
+
+TEST(LineSearch, Base) {
+    MemoryLeakDetection mld;
+
+    // atan(x) = 0，x = 3处完整的牛顿步会越过根，且使|f|增大
+    auto f = [](VecView x, Vec &out) {
+        out[0] = std::atan(x[0]);
+    };
+    Vec x = {3};
+    double fx = std::atan(3.0);
+    Vec d = {-fx * 10}; // -f / f'
+    double phi0 = fx * fx / 2;
+
+    LineSearch armijo(1, 1);
+    ASSERT_TRUE(armijo.Search(LineSearchMethod::ARMIJO, x, d, phi0, -fx * fx, f));
+    ASSERT_LT(armijo.Alpha(), 1);
+    ASSERT_LT(std::abs(armijo.F()[0]), fx);
+    ASSERT_DOUBLE_EQ(armijo.X()[0], 3 + armijo.Alpha() * d[0]);
+
+    LineSearch cubic(1, 1);
+    ASSERT_TRUE(cubic.Search(LineSearchMethod::CUBIC, x, d, phi0, -fx * fx, f));
+    ASSERT_LT(std::abs(cubic.F()[0]), fx);
+    ASSERT_LE(cubic.Evaluations(), armijo.Evaluations());
+
+    // 上升方向：找不到满足条件的步长，计算次数有上限
+    ASSERT_FALSE(armijo.Search(LineSearchMethod::ARMIJO, x, Vec{-d[0]}, phi0, -fx * fx, f));
+    int maxBacktracking = LineSearch::MAX_BACKTRACKING;
+    ASSERT_EQ(armijo.Evaluations(), maxBacktracking);
+}
+
+TEST(LineSearch, InvalidValue) {
+    MemoryLeakDetection mld;
+
+    // x = 20处的完整牛顿步到达x = -20，超出ln的定义域
+    auto f = [](VecView x, Vec &out) {
+        out[0] = Calc(MathOperator::MATH_LOG, x[0], 0.0) - 1;
+    };
+    Vec x = {20};
+    double fx = std::log(20.0) - 1;
+    Vec d = {-fx * 20};
+
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        LineSearch search(1, 1);
+        ASSERT_TRUE(search.Search(method, x, d, fx * fx / 2, -fx * fx, f));
+        ASSERT_GT(search.X()[0], 0);
+        ASSERT_LT(std::abs(search.F()[0]), fx);
+    }
+
+    // 其他错误照常抛出
+    LineSearch search(1, 1);
+    ASSERT_THROW(search.Search(LineSearchMethod::ARMIJO, x, d, fx * fx / 2, -fx * fx,
+                               [](VecView, Vec &) {
+                                   throw MathError(ErrorType::ERROR_OUTOF_DOMAIN);
+                               }),
+                 MathError);
+}
+
+TEST(LineSearch, NewtonRaphson) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    SymVec f = {"arctan(x)"_f};
+    VarsTable varsTable{{"x", 3}};
+
+    // 完整的牛顿步发散
+    ASSERT_ANY_THROW(SolveByNewtonRaphson(f, varsTable));
+
+    for (auto method : {LineSearchMethod::ARMIJO, LineSearchMethod::CUBIC}) {
+        Config::Get().lineSearch = method;
+        VarsTable got = SolveByNewtonRaphson(f, varsTable);
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+
+    // 圆与直线，初值远离交点
+    SymVec g = {"x^2+y^2-4"_f, "x-y"_f};
+    Config::Get().lineSearch = LineSearchMethod::CUBIC;
+    VarsTable got = SolveByNewtonRaphson(g, VarsTable{{"x", 100}, {"y", 0.1}});
+    ASSERT_NEAR(std::abs(got["x"]), std::sqrt(2.0), 1.0e-9);
+    ASSERT_NEAR(got["x"], got["y"], 1.0e-9);
+}
+
+TEST(LineSearch, NewtonRaphsonVariants) {
+    MemoryLeakDetection mld;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 这些模式下Jd ≠ -phi，φ'(0)需要用当前的雅可比矩阵计算
+    SymVec f = {"arctan(x)"_f};
+    VarsTable varsTable{{"x", 3}};
+    Config::Get().lineSearch = LineSearchMethod::CUBIC;
+    for (int mode = 0; mode < 3; ++mode) {
+        Config::Get().reuseJacobian = mode == 0;
+        Config::Get().mixedPrecision = mode == 1;
+        Config::Get().equilibrate = mode == 2;
+        VarsTable got = SolveByNewtonRaphson(f, varsTable);
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+    Config::Get().Reset();
+
+    // 方程数量多于未知数：最小二乘解，Jd只是phi在J的列空间上的投影
+    Config::Get().lineSearch = LineSearchMethod::ARMIJO;
+    SymVec g = {"arctan(x)"_f, "arctan(x)*10"_f, "arctan(2*x)"_f};
+    VarsTable got = SolveByNewtonRaphson(g, varsTable);
+    ASSERT_NEAR(got["x"], 0, 1.0e-9);
+}
@@ -1,9 +1,16 @@
+#include <tomsolver/config.h>
+#include <tomsolver/error_type.h>
 #include <tomsolver/linear.h>
 
+#include "helper.h"
 #include "memory_leak_detection.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
 using namespace tomsolver;
 
 TEST(Linear, Base) {
@@ -17,4 +24,309 @@ TEST(Linear, Base) {
     Vec expected = {-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555};
 
     ASSERT_EQ(x, expected);
-}
\ No newline at end of file
+}
+
+TEST(Linear, LUFactorization) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
+
+    LUFactorization lu(A);
+    ASSERT_TRUE(lu.IsFactored());
+
+    // 一次分解，多次求解
+    {
+        Vec b = {13, -9, 6, 0};
+        Vec expected = {-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555};
+        ASSERT_EQ(lu.Solve(b), expected);
+    }
+    {
+        Vec b = {1, 2, 3, 4};
+        ASSERT_EQ(lu.Solve(b), SolveLinear(A, b));
+    }
+
+    // 结果写入已有的向量，允许原地求解
+    {
+        Vec b = {13, -9, 6, 0};
+        Vec x(4);
+        lu.Solve(b, x);
+        lu.Solve(b, b);
+        ASSERT_EQ(x, b);
+        ASSERT_EQ(x, Vec({-66.5555555555555429, 25.6666666666666643, -18.777777777777775, 26.55555555555555}));
+    }
+
+    // 条件数估计：单位阵为1，接近奇异的矩阵很大
+    ASSERT_GT(lu.ConditionEstimate(), 1);
+    ASSERT_LT(lu.ConditionEstimate(), 100);
+    lu.Factor(Mat({{1, 0}, {0, 1}}));
+    ASSERT_DOUBLE_EQ(lu.ConditionEstimate(), 1);
+    lu.Factor(Mat({{1, 1}, {1, 1 + 1e-8}}));
+    ASSERT_GT(lu.ConditionEstimate(), 1e7);
+
+    // 奇异矩阵
+    try {
+        lu.Factor({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_SINGULAR_MATRIX);
+        ASSERT_FALSE(lu.IsFactored());
+    }
+}
+
+TEST(Linear, LUReuseWithoutAllocation) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{2, 1, -5, 1}, {1, -5, 0, 7}, {0, 2, 1, -1}, {1, 6, -1, -4}};
+    Mat B = {{4, 1, 0, 0}, {1, 4, 1, 0}, {0, 1, 4, 1}, {0, 0, 1, 4}};
+    Vec b = {13, -9, 6, 0};
+    Vec x(4);
+
+    // 预先分配工作空间后，反复分解、求解都不申请堆内存
+    LUFactorization lu(4);
+    long long before = AllocationCount();
+    for (int i = 0; i < 10; ++i) {
+        lu.Factor(i % 2 ? B : A);
+        lu.Solve(b, x);
+        lu.Solve(x, x);
+    }
+    long long allocations = AllocationCount() - before;
+    ASSERT_EQ(allocations, 0);
+
+    Vec expected = LUFactorization(B).Solve(LUFactorization(B).Solve(b));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_NEAR(x[i], expected[i], 1e-12);
+    }
+
+    // 阶数变小时也复用已有的工作空间
+    Mat C = {{2, 1}, {1, 3}};
+    Vec c = {1, 2};
+    Vec y(2);
+    before = AllocationCount();
+    lu.Factor(C);
+    lu.Solve(c, y);
+    allocations = AllocationCount() - before;
+    ASSERT_EQ(allocations, 0);
+    ASSERT_NEAR(y[0], 0.2, 1e-12);
+    ASSERT_NEAR(y[1], 0.6, 1e-12);
+}
+
+TEST(Linear, LUScalarType) {
+    MemoryLeakDetection mld;
+
+    // float、long double下的原地分解与求解
+    {
+        float a[] = {2, 1, -5, 1, 1, -5, 0, 7, 0, 2, 1, -1, 1, 6, -1, -4};
+        int pivots[4];
+        internal::LUFactorInPlace(a, 4, pivots);
+        float x[] = {13, -9, 6, 0};
+        internal::LUSolveInPlace(a, pivots, 4, x);
+        float expected[] = {-66.5555555555555429f, 25.6666666666666643f, -18.777777777777775f, 26.55555555555555f};
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-3);
+        }
+    }
+    {
+        long double a[] = {4, -2, 1, 3};
+        int pivots[2];
+        internal::LUFactorInPlace(a, 2, pivots);
+        long double x[] = {1, 2};
+        internal::LUSolveInPlace(a, pivots, 2, x);
+        ASSERT_NEAR(static_cast<double>(x[0]), 0.5, 1e-15);
+        ASSERT_NEAR(static_cast<double>(x[1]), 0.5, 1e-15);
+    }
+
+    float s[] = {1, 2, 2, 4};
+    int pivots[2];
+    ASSERT_THROW(internal::LUFactorInPlace(s, 2, pivots), MathError);
+}
+
+TEST(Linear, MixedPrecisionLU) {
+    MemoryLeakDetection mld;
+
+    // 良态矩阵：单精度分解，修正后达到双精度
+    {
+        Mat A = {{4, -1, 0, 0, 1, 0},  {-1, 4, -1, 0, 0, 1}, {0, -1, 4, -1, 0, 0},
+                 {0, 0, -1, 4, -1, 0}, {1, 0, 0, -1, 4, -1}, {0, 1, 0, 0, -1, 4}};
+        Vec b = {1.1, 2.3, 3.7, 4.13, 5.17, 6.19};
+        Vec expected = LUFactorization(A).Solve(b);
+
+        MixedPrecisionLUFactorization lu;
+        lu.Factor(A);
+        ASSERT_TRUE(lu.IsFactored());
+        Vec x = lu.Solve(b);
+        ASSERT_FALSE(lu.IsDoublePrecision());
+        for (int i = 0; i < 6; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-14);
+        }
+
+        // 原地求解
+        lu.Solve(b, b);
+        ASSERT_EQ(b, expected);
+    }
+
+    // Hilbert矩阵的条件数约为1e10，超出单精度的范围，修正停滞后退回双精度分解
+    {
+        Mat H(8, 8);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                H.Value(i, j) = 1.0 / (i + j + 1);
+            }
+        }
+        Vec b(8, 1.0);
+
+        Config::Get().epsilon = 1e-12;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        MixedPrecisionLUFactorization lu(8);
+        lu.Factor(H);
+        Vec x = lu.Solve(b);
+        ASSERT_TRUE(lu.IsDoublePrecision());
+        Vec expected = LUFactorization(H).Solve(b);
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_NEAR(x[i], expected[i], 1e-6 * std::abs(expected[i]));
+        }
+    }
+
+    // 奇异矩阵
+    MixedPrecisionLUFactorization lu;
+    ASSERT_THROW(lu.Factor(Mat({{1, 2}, {2, 4}})), MathError);
+    ASSERT_FALSE(lu.IsFactored());
+}
+
+TEST(Linear, QRFactorization) {
+    MemoryLeakDetection mld;
+
+    // 过定义：直线拟合的最小二乘解
+    {
+        Mat A = {{1, 0}, {1, 1}, {1, 2}, {1, 3}};
+        Vec b = {1, 2, 2, 4};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 2);
+        ASSERT_EQ(qr.Solve(b), Vec({0.9, 0.9}));
+        ASSERT_EQ(SolveLinear(A, b), Vec({0.9, 0.9}));
+
+        // 与正规方程的解一致
+        Mat B = {{3, 1, -2}, {0.5, 4, 1}, {-1, 2, 5}, {2, -3, 1}, {1, 1, 1}, {0, -2, 3}};
+        Vec c = {1, -2, 3, 0.5, 2, -1};
+        ASSERT_EQ(SolveLinear(B, c), SolveLinear(TransposeMultiply(B), TransposeMultiply(B, c)));
+    }
+
+    // 冗余约束：秩亏的过定义方程组，返回范数最小的最小二乘解
+    {
+        Mat A = {{1, 1}, {1, 1}, {1, 1}};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 1);
+        ASSERT_EQ(qr.Solve(Vec{1, 2, 3}), Vec({1, 1}));
+
+        Mat B = {{1, 2, 3}, {2, 4, 6}, {1, 0, 1}, {3, 4, 7}};
+        Vec c = {1, 2, 3, 5};
+        Vec x = SolveLinear(B, c);
+        ASSERT_EQ(B * x, Mat(c));
+        ASSERT_EQ(x, Vec({7 / 3.0, -5 / 3.0, 2 / 3.0}));
+    }
+
+    // 不定方程：范数最小的解
+    {
+        Mat A = {{1, 2, 3}, {4, 5, 6}};
+        Vec b = {1, 2};
+        QRFactorization qr(A);
+        ASSERT_EQ(qr.Rank(), 2);
+        Vec expected = {-3 / 54.0, 6 / 54.0, 15 / 54.0};
+        ASSERT_EQ(qr.Solve(b), expected);
+
+        ASSERT_THROW(SolveLinear(A, b), MathError);
+
+        Config::Get().allowIndeterminateEquation = true;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        ASSERT_EQ(SolveLinear(A, b), expected);
+
+        // 秩亏但相容：b很大时残差的舍入误差也按比例放大，不能误判为矛盾
+        {
+            Mat C = {{1, 2, 3}, {2, 4, 6}};
+            Vec d = {123456789.123, 246913578.246};
+            Vec x = SolveLinear(C, d);
+            ASSERT_NEAR(Dot(MatView(C).Row(0), x), d[0], 1e-6);
+        }
+
+        // 矛盾方程组
+        try {
+            SolveLinear(Mat({{1, 1, 1}, {2, 2, 2}}), Vec({1, 3}));
+            FAIL();
+        } catch (const MathError &e) {
+            ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_SINGULAR_MATRIX);
+        }
+    }
+
+    // 零矩阵
+    QRFactorization qr(Mat(3, 2));
+    ASSERT_EQ(qr.Rank(), 0);
+    ASSERT_EQ(qr.Solve(Vec{1, 2, 3}), Vec({0, 0}));
+
+    // 空矩阵
+    qr.Factor(MatView(nullptr, 0, 2));
+    ASSERT_EQ(qr.Rank(), 0);
+    ASSERT_EQ(qr.Solve(VecView(nullptr, 0)), Vec({0, 0}));
+    qr.Factor(MatView(nullptr, 2, 0));
+    ASSERT_EQ(qr.Rank(), 0);
+}
+
+TEST(Linear, Equilibration) {
+    MemoryLeakDetection mld;
+
+    // 第二列（未知量的单位很小）与第二行（方程的数量级很小）
+    Mat A = {{3, 4e-10, 0}, {1e-6, 2e-16, -3e-6}, {1, 0, 1}};
+    Equilibration eq(A);
+    ASSERT_TRUE(eq.IsComputed());
+    ASSERT_EQ(eq.Rows(), 3);
+    ASSERT_EQ(eq.Cols(), 3);
+
+    Mat B = A;
+    eq.Apply(B);
+    for (int i = 0; i < 3; ++i) {
+        double rowMax = 0, colMax = 0;
+        for (int j = 0; j < 3; ++j) {
+            rowMax = std::max(rowMax, std::abs(B.Value(i, j)));
+            colMax = std::max(colMax, std::abs(B.Value(j, i)));
+        }
+        ASSERT_LE(rowMax, 2);
+        ASSERT_GE(colMax, 1);
+        ASSERT_LT(colMax, 2);
+
+        // 缩放因子为2的整数次幂
+        int e;
+        ASSERT_EQ(std::frexp(eq.RowScale()[i], &e), 0.5);
+        ASSERT_EQ(std::frexp(eq.ColScale()[i], &e), 0.5);
+    }
+
+    // 原矩阵的主元低于Config::Get().epsilon，平衡后可以正常分解
+    ASSERT_THROW(LUFactorization{A}, MathError);
+    LUFactorization lu(B);
+    Vec b = {1, 2, 3};
+    Vec rb = b;
+    for (int i = 0; i < 3; ++i) {
+        rb[i] *= eq.RowScale()[i];
+    }
+    Vec x = lu.Solve(rb);
+    for (int i = 0; i < 3; ++i) {
+        x[i] *= eq.ColScale()[i];
+    }
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_NEAR(Dot(MatView(A).Row(i), x), b[i], 1e-9 * std::abs(b[i]));
+    }
+
+    // 全为0的行
+    Equilibration zero(Mat({{0, 0}, {2, 0.25}}));
+    ASSERT_EQ(zero.RowScale()[0], 1);
+    ASSERT_EQ(zero.RowScale()[1], 0.5);
+    ASSERT_EQ(zero.ColScale()[0], 1);
+    ASSERT_EQ(zero.ColScale()[1], 8);
+}
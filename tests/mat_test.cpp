@@ -1,10 +1,15 @@
 #include <tomsolver/error_type.h>
 #include <tomsolver/mat.h>
+#include <tomsolver/mat_view.h>
 
 #include "memory_leak_detection.h"
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <tuple>
+#include <stdexcept>
+
 using namespace tomsolver;
 
 using std::cout;
@@ -61,3 +66,128 @@ TEST(Mat, PositiveDetermine) {
         ASSERT_TRUE(!A.PositiveDetermine());
     }
 }
+
+TEST(Mat, Det) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}, {-2, 7, 8}};
+    ASSERT_DOUBLE_EQ(Det(A, 1), 1);
+    ASSERT_DOUBLE_EQ(Det(A, 2), -3);
+    ASSERT_NEAR(Det(A, 3), 24, 1.0e-12);
+
+    Mat B = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    ASSERT_NEAR(Det(B, 3), 0, 1.0e-12);
+
+    // 较大的矩阵：det(I + c * ones) = 1 + n * c
+    int n = 12;
+    Mat C(n, n, 0.5);
+    for (int i = 0; i < n; ++i) {
+        C.Value(i, i) += 1;
+    }
+    ASSERT_NEAR(Det(C, n), 1 + n * 0.5, 1.0e-9);
+
+    // C * C^-1 = I
+    ASSERT_EQ(C * C.Inverse(), Mat(n, n).Ones());
+    ASSERT_TRUE(C.PositiveDetermine());
+}
+
+TEST(Mat, MultiplyLarge) {
+    MemoryLeakDetection mld;
+
+    // 尺寸覆盖寄存器分块、缓存分块以及边缘部分
+    for (auto size : {std::make_tuple(13, 17, 11), std::make_tuple(70, 300, 135)}) {
+        int m = std::get<0>(size), k = std::get<1>(size), n = std::get<2>(size);
+        Mat A(m, k), B(k, n);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < k; ++j) {
+                A.Value(i, j) = std::sin(i * k + j);
+            }
+        }
+        for (int i = 0; i < k; ++i) {
+            for (int j = 0; j < n; ++j) {
+                B.Value(i, j) = std::cos(i * n + j);
+            }
+        }
+
+        Mat expected(m, n);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                for (int p = 0; p < k; ++p) {
+                    expected.Value(i, j) += A.Value(i, p) * B.Value(p, j);
+                }
+            }
+        }
+
+        ASSERT_EQ(A * B, expected);
+    }
+}
+
+TEST(Mat, TransposeMultiply) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}, {-2, 7, 8}, {0, 1, -1}, {3, 3, 1}};
+    Vec b = {1, -1, 2, 0.5, 3};
+
+    ASSERT_EQ(TransposeMultiply(A), A.Transpose() * A);
+    ASSERT_EQ(TransposeMultiply(A, b), (A.Transpose() * b).ToVec());
+}
+
+TEST(Mat, Arithmetic) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2}, {3, 4}};
+    Mat B = {{6, 7}, {8, 9}};
+
+    Mat C = A + 2 * B - B * 0.5 - (-A);
+    ASSERT_EQ(C, Mat({{11, 14.5}, {18, 21.5}}));
+
+    // 赋值给同尺寸的对象时直接写入原有内存，右侧引用自身也可以
+    const double *p = &C.Value(0, 0);
+    C = C - A * 2;
+    ASSERT_EQ(&C.Value(0, 0), p);
+    ASSERT_EQ(C, Mat({{9, 10.5}, {12, 13.5}}));
+
+    C += A - B;
+    ASSERT_EQ(C, Mat({{4, 5.5}, {7, 8.5}}));
+
+    // 尺寸不同时重新分配
+    Mat D(1, 1);
+    D = A + B;
+    ASSERT_EQ(D, Mat({{7, 9}, {11, 13}}));
+
+    // 表达式保存临时对象的值，不会悬空
+    auto e = Mat{{1, 1}, {1, 1}} + A.Transpose();
+    Mat E = e;
+    ASSERT_EQ(E, Mat({{2, 4}, {3, 5}}));
+    ASSERT_DOUBLE_EQ((A - B).Norm2(), 100);
+    ASSERT_DOUBLE_EQ((A - B * 2).NormInfinity(), 14);
+
+    // 用auto保存的表达式可以像Vec一样取元素、调用ToVec()、参与点乘和比较，在使用时才求值
+    Vec a = {1, 2};
+    Vec b = {3, 5};
+    auto c = a + b;
+    ASSERT_EQ(c[0], 4);
+    ASSERT_EQ(c, Vec({4, 7}));
+    ASSERT_EQ(c.ToVec(), Vec({4, 7}));
+    a = {0, 0};
+    ASSERT_EQ(c, Vec({3, 5}));
+    a = {1, 2};
+
+    ASSERT_DOUBLE_EQ(Dot(a - b, a), -8);
+    ASSERT_DOUBLE_EQ(Dot(a, a - b), -8);
+    ASSERT_DOUBLE_EQ(Dot(a - b, 2 * a), -16);
+    Mat m = {{1}, {2}};
+    ASSERT_EQ((m + m).ToVec(), Vec({2, 4}));
+    ASSERT_THROW((A + B).ToVec(), std::runtime_error);
+
+    // 与向量相乘：列数匹配时为矩阵乘法，Vec之间逐元素相乘
+    Vec x = {1, 2};
+    Vec y = {3, 4};
+    ASSERT_EQ((A + B) * x, Vec({25, 37}));
+    ASSERT_EQ((x + y) * y, Vec({12, 24}));
+    ASSERT_EQ(A * (x - y), Vec({-6, -14}));
+
+    Vec v = x + 0.5 * y;
+    v = -v;
+    ASSERT_EQ(v, Vec({-2.5, -4}));
+}
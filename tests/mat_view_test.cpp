@@ -0,0 +1,144 @@
+#include <tomsolver/linear.h>
+#include <tomsolver/mat_view.h>
+#include <tomsolver/vars_table.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+using namespace tomsolver;
+
+TEST(MatView, Basic) {
+    MemoryLeakDetection mld;
+
+    Mat A = {{1, 2, 3}, {4, 5, 6}};
+    MatView v = A;
+    ASSERT_TRUE(v.IsContiguous());
+    ASSERT_EQ(v.Data(), &A.Value(0, 0));
+    ASSERT_EQ(Mat(v), A);
+
+    // 转置、子矩阵、行列都不复制数据
+    MatView t = v.Transpose();
+    ASSERT_FALSE(t.IsContiguous());
+    ASSERT_EQ(Mat(t), A.Transpose());
+    ASSERT_EQ(Mat(v.Block(0, 1, 2, 2)), Mat({{2, 3}, {5, 6}}));
+    ASSERT_EQ(Vec(v.Row(1)), Vec({4, 5, 6}));
+    ASSERT_EQ(Vec(v.Col(2)), Vec({3, 6}));
+    ASSERT_EQ(Vec(t.Row(2)), Vec({3, 6}));
+
+    A.Value(0, 0) = 10;
+    ASSERT_EQ(v.Value(0, 0), 10);
+
+    // 视图参与表达式运算
+    Mat B = v + 2 * t.Transpose();
+    ASSERT_EQ(B, Mat({{30, 6, 9}, {12, 15, 18}}));
+    ASSERT_EQ(Mat(v.Transpose()) * Vec({1, 1}), Mat({{14}, {7}, {9}}));
+}
+
+TEST(MatView, Empty) {
+    MemoryLeakDetection mld;
+
+    // 空矩阵没有元素可以取地址，视图指向nullptr
+    Mat A(0, 0, std::valarray<double>());
+    ASSERT_EQ(A.Data(), nullptr);
+    MatView v = A;
+    ASSERT_EQ(v.Rows(), 0);
+    ASSERT_EQ(v.Cols(), 0);
+    ASSERT_EQ(v.Data(), nullptr);
+    ASSERT_EQ(A.Norm2(), 0);
+    ASSERT_EQ(A.NormInfinity(), 0);
+
+    Mat B = v;
+    ASSERT_EQ(B.Rows(), 0);
+    ASSERT_EQ(B.Cols(), 0);
+    ASSERT_EQ(B.Data(), nullptr);
+    B = A;
+    B += A;
+    ASSERT_EQ(B, A);
+
+    Vec x(std::valarray<double>{});
+    VecView xv = x;
+    MutableVecView mv = x;
+    ASSERT_EQ(xv.Size(), 0);
+    ASSERT_EQ(mv.Size(), 0);
+    ASSERT_EQ(mv.Data(), nullptr);
+}
+
+TEST(MatView, VecView) {
+    MemoryLeakDetection mld;
+
+    // 调用者自己的内存，每隔一个元素取一个
+    double buf[] = {1, -1, 2, -1, 3, -1};
+    VecView x(buf, 3, 2);
+    ASSERT_EQ(x.Size(), 3);
+    ASSERT_EQ(Vec(x), Vec({1, 2, 3}));
+    ASSERT_EQ(Vec(x.Segment(1, 2)), Vec({2, 3}));
+
+    Vec y = {4, 5, 6};
+    ASSERT_DOUBLE_EQ(Dot(x, y), 32);
+    ASSERT_DOUBLE_EQ(Dot(y, y), 77);
+
+    MutableVecView out(buf + 1, 3, 2);
+    ScaledAdd(x, 2, y, out);
+    ASSERT_EQ(Vec(out), Vec({9, 12, 15}));
+    ASSERT_EQ(Vec(x), Vec({1, 2, 3}));
+
+    // 结果写回x自身
+    MutableVecView mx(buf, 3, 2);
+    ScaledAdd(x, -1, x, mx);
+    ASSERT_EQ(Vec(x), Vec({0, 0, 0}));
+
+    mx = y - 2 * x;
+    ASSERT_EQ(Vec(x), Vec({4, 5, 6}));
+    mx = out;
+    ASSERT_EQ(Vec(x), Vec({9, 12, 15}));
+
+    Vec z(3);
+    MutableVecView mz = z;
+    mz[1] = 7;
+    ASSERT_EQ(z, Vec({0, 7, 0}));
+}
+
+TEST(MatView, Solve) {
+    MemoryLeakDetection mld;
+
+    // 行主序存储在调用者数组中的矩阵，只取左上角3×3
+    double a[] = {2, 1, 1, 99, 4, -6, 0, 99, -2, 7, 2, 99};
+    MatView A(a, 3, 3, 4, 1);
+    double b[] = {5, -2, 9};
+    Vec expected = {1, 1, 2};
+
+    LUFactorization lu(A);
+    ASSERT_EQ(lu.Solve(VecView(b, 3)), expected);
+
+    // 结果写入调用者的数组
+    double x[6] = {};
+    lu.Solve(VecView(b, 3), MutableVecView(x, 3, 2));
+    ASSERT_EQ(Vec(VecView(x, 3, 2)), expected);
+
+    ASSERT_EQ(SolveLinear(A, VecView(b, 3)), expected);
+
+    // 转置视图：Aᵀy = b
+    LUFactorization luT(A.Transpose());
+    Vec y = luT.Solve(VecView(b, 3));
+    ASSERT_EQ(Mat(A.Transpose()) * y, Mat(Vec(VecView(b, 3))));
+
+    // 对称正定矩阵AᵀA
+    Mat AtA = Mat(A.Transpose()) * Mat(A);
+    CholeskyFactorization chol;
+    ASSERT_TRUE(chol.Factor(AtA));
+    Vec c = (AtA * expected).ToVec();
+    ASSERT_EQ(chol.Solve(c), expected);
+}
+
+TEST(MatView, VarsTable) {
+    MemoryLeakDetection mld;
+
+    double state[] = {1, 2, 3};
+    VarsTable table({"x", "y", "z"}, VecView(state, 3));
+    ASSERT_EQ(table, VarsTable({{"x", 1}, {"y", 2}, {"z", 3}}));
+
+    double next[] = {0, 4, 0, 5, 0, 6};
+    table.SetValues(VecView(next + 1, 3, 2));
+    ASSERT_EQ(table, VarsTable({{"x", 4}, {"y", 5}, {"z", 6}}));
+}
@@ -0,0 +1,112 @@
+#include <tomsolver/config.h>
+#include <tomsolver/error_type.h>
+#include <tomsolver/multi_start.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace tomsolver;
+
+TEST(MultiStart, AllRoots) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // (x - 1)(x - 2)(x - 3) = 0。根按得到它的第一个初值排序，从4出发得到3
+    SymVec f = {"x^3 - 6*x^2 + 11*x - 6"_f};
+    std::vector<VarsTable> starts;
+    for (int i = 0; i <= 8; ++i) {
+        starts.emplace_back(VarsTable{{"x", 4 - 0.5 * i}});
+    }
+
+    for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                        NonlinearMethod::AUTO}) {
+        Config::Get().nonlinearMethod = method;
+        for (int threads : {1, 4}) {
+            MultiStartOptions options;
+            options.threads = threads;
+            std::vector<VarsTable> roots = SolveMultiStart(f, starts, options);
+            ASSERT_EQ(roots.size(), 3u);
+            ASSERT_NEAR(roots[0]["x"], 3, 1e-9);
+            std::vector<double> xs;
+            for (auto &root : roots) {
+                xs.push_back(root["x"]);
+            }
+            std::sort(xs.begin(), xs.end());
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_NEAR(xs[i], i + 1, 1e-9);
+            }
+        }
+    }
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+
+    // 圆与直线的两个交点，从网格上的初值出发
+    SymVec circle = {"x^2 + y^2 - 4"_f, "x - y"_f};
+    starts.clear();
+    for (int i = -2; i <= 2; ++i) {
+        for (int j = -2; j <= 2; ++j) {
+            if (i + j != 0) {
+                starts.emplace_back(VarsTable{{"x", i + 0.1}, {"y", j}});
+            }
+        }
+    }
+    std::vector<VarsTable> roots = SolveMultiStart(circle, starts);
+    ASSERT_EQ(roots.size(), 2u);
+    for (auto &root : roots) {
+        ASSERT_NEAR(std::abs(root["x"]), std::sqrt(2.0), 1e-9);
+        ASSERT_NEAR(root["x"], root["y"], 1e-9);
+    }
+    ASSERT_NEAR(roots[0]["x"] + roots[1]["x"], 0, 1e-9);
+
+    // 没有收敛的初值被忽略：从20出发的牛顿步超出定义域
+    starts = {VarsTable{{"x", 20}}, VarsTable{{"x", 2}}};
+    roots = SolveMultiStart(SymVec{"log(x) - 1"_f}, starts);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], std::exp(1.0), 1e-9);
+
+    ASSERT_TRUE(SolveMultiStart(SymVec{"x^2 + 1"_f}, {VarsTable{{"x", 3}}}).empty());
+    ASSERT_TRUE(SolveMultiStart(f, {}).empty());
+
+    // 初值的变量必须一致
+    starts = {VarsTable{{"x", 1}, {"y", 1}}, VarsTable{{"y", 1}, {"z", 1}}};
+    ASSERT_THROW(SolveMultiStart(circle, starts), MathError);
+}
+
+TEST(MultiStart, FirstConverged) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 大量没有希望的初值（x² + 1在实数范围内无根）中混有一个能收敛的初值，其余的求解被取消
+    SymVec f = {"(x^2 + 1) * (x - 5)"_f};
+    std::vector<VarsTable> starts;
+    for (int i = 0; i < 200; ++i) {
+        starts.emplace_back(VarsTable{{"x", -10 + 0.01 * i}});
+    }
+    starts[150] = VarsTable{{"x", 6}};
+
+    Config::Get().nonlinearMethod = NonlinearMethod::AUTO;
+    MultiStartOptions options;
+    options.mode = MultiStartMode::FIRST_CONVERGED;
+    options.threads = 4;
+    std::vector<VarsTable> roots = SolveMultiStart(f, starts, options);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], 5, 1e-9);
+
+    options.threads = 1;
+    roots = SolveMultiStart(f, starts, options);
+    ASSERT_EQ(roots.size(), 1u);
+    ASSERT_NEAR(roots[0]["x"], 5, 1e-9);
+}
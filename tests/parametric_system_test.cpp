@@ -0,0 +1,94 @@
+#include <tomsolver/error_type.h>
+#include <tomsolver/nonlinear.h>
+#include <tomsolver/parametric_system.h>
+#include <tomsolver/parse.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using namespace tomsolver;
+
+TEST(ParametricSystem, Base) {
+    MemoryLeakDetection mld;
+
+    // 平面二连杆的逆运动学：连杆长度l1、l2与目标位置(px, py)是参数
+    SymVec equations = {
+        "l1*cos(t1) + l2*cos(t1+t2) - px"_f,
+        "l1*sin(t1) + l2*sin(t1+t2) - py"_f,
+    };
+    VarsTable params{{"l1", 1}, {"l2", 0.8}, {"px", 1.2}, {"py", 0.6}};
+    ParametricSystem system(equations, {"t1", "t2"}, params);
+    ASSERT_EQ(system.Unknowns(), std::vector<std::string>({"t1", "t2"}));
+    ASSERT_EQ(system.Params(), params.Vars());
+
+    // 与代入参数后直接求解的结果相同
+    VarsTable initial{{"t1", 0.3}, {"t2", 0.5}};
+    VarsTable got = system.Solve(initial);
+    VarsTable expected = Solve(equations.Clone().Subs(params).ToSymVec(), initial);
+    ASSERT_NEAR(got["t1"], expected["t1"], 1e-8);
+    ASSERT_NEAR(got["t2"], expected["t2"], 1e-8);
+    ASSERT_TRUE(system.Eval(got.Values()).NormInfinity() < 1e-9);
+
+    // 目标沿圆弧移动：只更新参数值，以上一次的解作为初值
+    Vec q = got.Values();
+    for (int i = 0; i <= 50; ++i) {
+        double angle = 0.02 * i, px = 1.3 * std::cos(angle), py = 1.3 * std::sin(angle);
+        system.Rebind(Vec{1, 0.8, px, py});
+        system.Solve(q);
+        ASSERT_NEAR(std::cos(q[0]) + 0.8 * std::cos(q[0] + q[1]), px, 1e-9);
+        ASSERT_NEAR(std::sin(q[0]) + 0.8 * std::sin(q[0] + q[1]), py, 1e-9);
+    }
+
+    // 按名字更新部分参数，其余参数保持原值
+    system.Rebind(VarsTable{{"px", 0}, {"py", 1.5}});
+    Vec F = system.Eval(Vec{PI / 2, 0});
+    ASSERT_NEAR(F[0], 0, 1e-12);
+    ASSERT_NEAR(F[1], 0.3, 1e-12);
+
+    // 副本的参数值互不影响
+    ParametricSystem copy = system;
+    copy.Rebind(Vec{1, 1, 0, 0});
+    ASSERT_NEAR(copy.Eval(Vec{PI / 2, 0})[1], 2, 1e-12);
+    ASSERT_NEAR(system.Eval(Vec{PI / 2, 0})[1], 0.3, 1e-12);
+}
+
+TEST(ParametricSystem, Error) {
+    MemoryLeakDetection mld;
+
+    SymVec equations = {"x^2 - a"_f};
+
+    // 未声明的变量、重复的名字
+    ASSERT_THROW(ParametricSystem(equations, {"x"}, std::vector<std::string>{}), MathError);
+    ASSERT_THROW(ParametricSystem(equations, {"x"}, std::vector<std::string>{"a", "x"}), MathError);
+
+    ParametricSystem system(equations, {"x"}, {"a"});
+    try {
+        system.Rebind(VarsTable{{"x", 1}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::ERROR_UNDEFINED_VARIABLE);
+    }
+    try {
+        system.Solve(VarsTable{{"y", 1}});
+        FAIL();
+    } catch (const MathError &e) {
+        ASSERT_EQ(e.GetErrorType(), ErrorType::SIZE_NOT_MATCH);
+    }
+
+    // a = 4时x = 2；a = -1时没有实根
+    system.Rebind(Vec{4});
+    ASSERT_NEAR(system.Solve(VarsTable{{"x", 1}})["x"], 2, 1e-9);
+    system.Rebind(Vec{-1});
+    ASSERT_THROW(system.Solve(VarsTable{{"x", 1}}), MathError);
+
+    // 有不是参数的名字时，其他参数也不修改
+    ParametricSystem two({"x - a - b"_f}, {"x"}, {"a", "b"});
+    two.Rebind(Vec{1, 2});
+    ASSERT_THROW(two.Rebind(VarsTable{{"a", 10}, {"b", 20}, {"c", 30}}), MathError);
+    ASSERT_DOUBLE_EQ(two.Eval(Vec{0})[0], -3);
+    two.Rebind(VarsTable{{"a", 5}});
+    ASSERT_DOUBLE_EQ(two.Eval(Vec{0})[0], -7);
+}
@@ -32,6 +32,11 @@ TEST(SolveBase, FindAlphaByArmijo) {
     double alpha = Armijo(x, d, g, dg);
     cout << alpha << endl;
 
+    // 上升方向：回溯次数用完后返回失败
+    ASSERT_FALSE(Armijo(x, -d, g, dg, alpha));
+    ASSERT_GT(alpha, 0);
+    ASSERT_EQ(Armijo(x, -d, g, dg), 0);
+
     // FIXME: not match got results
     // double expected = 0.003866;
 }
@@ -97,6 +102,13 @@ TEST(SolveBase, Base) {
         VarsTable got = SolveByLM(equations, varsTable);
         cout << got << endl;
 
+        ASSERT_EQ(got, expected);
+    }
+    // 折线法
+    {
+        VarsTable got = SolveByDogleg(equations, varsTable);
+        cout << got << endl;
+
         ASSERT_EQ(got, expected);
     }
 }
@@ -129,4 +141,302 @@ TEST(SolveBase, IndeterminateEquation) {
 
     VarsTable got = Solve(f);
     cout << got << endl;
-}
\ No newline at end of file
+}
+
+TEST(SolveBase, ReuseJacobian) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    // 弦方法：雅可比矩阵只在收缩变慢时重新分解
+    Config::Get().reuseJacobian = true;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    VarsTable got = SolveByNewtonRaphson(f, varsTable);
+    cout << got << endl;
+
+    // 弦方法为线性收敛，残差满足容差时解的精度略低于牛顿法
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
+
+TEST(SolveBase, MixedPrecision) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    SymVec f = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+
+    VarsTable varsTable{{"x1", 1}, {"x2", 1}, {"x3", 1}};
+    VarsTable expected{{"x1", 1.5722855035930956}, {"x2", 1.6360330989069252}, {"x3", -0.0637475947386077}};
+
+    // 单精度分解雅可比矩阵，迭代修正后的牛顿步与双精度一致
+    Config::Get().mixedPrecision = true;
+
+    // 结束时恢复设置
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    VarsTable got = SolveByNewtonRaphson(f, varsTable);
+    cout << got << endl;
+    ASSERT_EQ(got, expected);
+
+    // 与弦方法同时使用
+    Config::Get().reuseJacobian = true;
+    got = SolveByNewtonRaphson(f, varsTable);
+    for (auto &item : expected) {
+        ASSERT_NEAR(got[item.first], item.second, 1.0e-6);
+    }
+}
+
+TEST(SolveBase, LM) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // Rosenbrock函数的残差形式，弯曲狭长的山谷
+    {
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+    }
+
+    // 完整的第一步会落到ln的定义域之外，试探步被拒绝后增大阻尼
+    {
+        SymVec f = {"log(x)-1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x", 20}});
+        ASSERT_NEAR(got["x"], std::exp(1.0), 1.0e-8);
+    }
+
+    // 方程数量多于未知数数量的相容方程组
+    {
+        SymVec f = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+    // 用共轭梯度法求解阻尼方程
+    {
+        Config::Get().lmConjugateGradient = true;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [](auto) {
+            Config::Get().Reset();
+        });
+
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByLM(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+
+        SymVec g = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        got = SolveByLM(g, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+}
+
+TEST(SolveBase, Dogleg) {
+    MemoryLeakDetection mld;
+
+    std::setlocale(LC_ALL, ".UTF8");
+
+    // 完整的牛顿步发散
+    {
+        SymVec f = {"arctan(x)"_f};
+        ASSERT_ANY_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 3}}));
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 3}});
+        ASSERT_NEAR(got["x"], 0, 1.0e-9);
+    }
+
+    // Rosenbrock函数的残差形式
+    {
+        SymVec f = {"10*(x2-x1^2)"_f, "1-x1"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x1", -1.2}, {"x2", 1}});
+        ASSERT_NEAR(got["x1"], 1, 1.0e-6);
+        ASSERT_NEAR(got["x2"], 1, 1.0e-6);
+    }
+
+    // 完整的第一步会落到ln的定义域之外
+    {
+        SymVec f = {"log(x)-1"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 20}});
+        ASSERT_NEAR(got["x"], std::exp(1.0), 1.0e-8);
+    }
+
+    // 方程数量多于未知数数量的相容方程组
+    {
+        SymVec f = {"x+y-3"_f, "x-y+1"_f, "x*y-2"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 5}, {"y", -3}});
+        ASSERT_NEAR(got["x"], 1, 1.0e-6);
+        ASSERT_NEAR(got["y"], 2, 1.0e-6);
+    }
+
+    // Powell的病态缩放函数，两个未知数相差约6个数量级
+    {
+        SymVec f = {"10000*x*y-1"_f, "exp(-x)+exp(-y)-1.0001"_f};
+        VarsTable got = SolveByDogleg(f, VarsTable{{"x", 0}, {"y", 1}});
+        ASSERT_NEAR(got["x"], 1.098159329e-5, 1.0e-12);
+        ASSERT_NEAR(got["y"], 9.106146740, 1.0e-8);
+    }
+}
+
+TEST(SolveBase, FixedPoint) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // x = cos(x)
+    {
+        VarsTable got = SolveFixedPoint(SymVec{"cos(x)"_f}, VarsTable{{"x", 1}});
+        ASSERT_NEAR(got["x"], 0.7390851332151607, 1e-9);
+    }
+
+    // 二元压缩映射
+    SymVec G = {"0.5*cos(y)"_f, "0.5*sin(x) + 0.1"_f};
+    VarsTable got = SolveFixedPoint(G, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(got["x"] - 0.5 * std::cos(got["y"]), 0, 1e-9);
+    ASSERT_NEAR(got["y"] - 0.5 * std::sin(got["x"]) - 0.1, 0, 1e-9);
+
+    Config::Get().andersonDepth = 0;
+    VarsTable picard = SolveFixedPoint(G, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(picard["x"], got["x"], 1e-6);
+    ASSERT_NEAR(picard["y"], got["y"], 1e-6);
+
+    // 收缩因子接近1时普通不动点迭代很慢，Anderson加速的割线外推一步即可得到线性问题的解
+    SymVec slow = {"0.99*x + 0.01*y"_f, "0.99*y - 0.01*x + 0.02"_f};
+    Config::Get().maxIterations = 50;
+    ASSERT_THROW(SolveFixedPoint(slow, VarsTable({"x", "y"}, 0.0)), std::runtime_error);
+
+    Config::Get().andersonDepth = 5;
+    got = SolveFixedPoint(slow, VarsTable({"x", "y"}, 0.0));
+    ASSERT_NEAR(got["x"], 1, 1e-6);
+    ASSERT_NEAR(got["y"], 1, 1e-6);
+
+    // G的行数必须等于未知数数量
+    ASSERT_THROW(SolveFixedPoint(SymVec{"cos(x)"_f}, VarsTable({"x", "y"}, 0.0)), MathError);
+}
+
+TEST(SolveBase, Equilibration) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // y的单位比x小10个数量级，根为x = 2, y = 1e10。不缩放时消元得到的第二个主元约为1e-10，被误判为奇异
+    SymVec f = {"x^2 + 0.0000000001*y - 5"_f, "x - 0.0000000001*y - 1"_f};
+    VarsTable init({"x", "y"}, 1.0);
+
+    // 默认不缩放
+    ASSERT_FALSE(Config::Get().equilibrate);
+    ASSERT_THROW(SolveByNewtonRaphson(f, init), MathError);
+
+    Config::Get().equilibrate = true;
+    for (int update = 0; update < 2; ++update) {
+        Config::Get().updateEquilibration = update;
+        for (auto method : {NonlinearMethod::NEWTON_RAPHSON, NonlinearMethod::LM, NonlinearMethod::DOGLEG,
+                            NonlinearMethod::AUTO}) {
+            Config::Get().nonlinearMethod = method;
+            VarsTable got = Solve(f, init);
+            ASSERT_NEAR(got["x"], 2, 1e-9);
+            ASSERT_NEAR(got["y"], 1e10, 1e-9 * 1e10);
+        }
+    }
+
+    // 弦方法与混合精度复用平衡后的分解结果
+    Config::Get().nonlinearMethod = NonlinearMethod::NEWTON_RAPHSON;
+    Config::Get().reuseJacobian = true;
+    VarsTable got = Solve(f, init);
+    ASSERT_NEAR(got["x"], 2, 1e-9);
+    Config::Get().reuseJacobian = false;
+    Config::Get().mixedPrecision = true;
+    got = Solve(f, init);
+    ASSERT_NEAR(got["x"], 2, 1e-9);
+}
+
+TEST(SolveBase, Polyalgorithm) {
+    MemoryLeakDetection mld;
+
+    std::shared_ptr<void> defer(nullptr, [](auto) {
+        Config::Get().Reset();
+    });
+
+    // 牛顿法收敛良好时与牛顿法的结果相同
+    SymVec equations = {
+        "0.425*cos(x1) + 0.39243*cos(x1-x2) + 0.109*cos(x1-x2-x3) - 0.5"_f,
+        "0.425*sin(x1) + 0.39243*sin(x1-x2) + 0.109*sin(x1-x2-x3) - 0.4"_f,
+        "x1-x2-x3"_f,
+    };
+    VarsTable init({"x1", "x2", "x3"}, 1.0);
+    VarsTable expected = SolveByNewtonRaphson(equations, init);
+    VarsTable got = SolveByPolyalgorithm(equations, init);
+    ASSERT_EQ(got, expected);
+
+    Config::Get().nonlinearMethod = NonlinearMethod::AUTO;
+    ASSERT_EQ(Solve(equations, init), expected);
+
+    // 牛顿步超出定义域：log(-40)
+    {
+        SymVec f = {"log(x) - 1"_f};
+        ASSERT_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 20}}), MathError);
+        ASSERT_NEAR(Solve(f, VarsTable{{"x", 20}})["x"], std::exp(1.0), 1e-9);
+    }
+
+    // 牛顿迭代发散：arctan(x)从3出发，||F||不再收缩
+    {
+        SymVec f = {"arctan(x)"_f};
+        ASSERT_ANY_THROW(SolveByNewtonRaphson(f, VarsTable{{"x", 3}}));
+        ASSERT_NEAR(Solve(f, VarsTable{{"x", 3}})["x"], 0, 1e-9);
+    }
+
+    // 初值处雅可比矩阵奇异
+    {
+        SymVec f = {"x^2 - y"_f, "x + y - 2"_f};
+        VarsTable start{{"x", -0.5}, {"y", 0}};
+        ASSERT_THROW(SolveByNewtonRaphson(f, start), MathError);
+        got = Solve(f, start);
+        ASSERT_NEAR(got["x"] * got["x"] - got["y"], 0, 1e-9);
+        ASSERT_NEAR(got["x"] + got["y"] - 2, 0, 1e-9);
+    }
+
+    // 非方阵直接使用LM方法
+    {
+        SymVec f = {"x - 1"_f, "y - 2"_f, "x + y - 3"_f};
+        got = Solve(f, VarsTable({"x", "y"}, 0.0));
+        ASSERT_NEAR(got["x"], 1, 1e-9);
+        ASSERT_NEAR(got["y"], 2, 1e-9);
+    }
+
+    // 切换到LM方法时，牛顿法已经检查过的F不重复计入停滞次数。
+    // 从x = 3出发，||F||在6次检查中没有明显下降之后才开始减小，重复检查时为7次，会被误判为停滞
+    Config::Get().stagnationIterations = 7;
+    ASSERT_NEAR(Solve(SymVec{"arctan(x)"_f}, VarsTable{{"x", 3}})["x"], 0, 1e-9);
+    Config::Get().stagnationIterations = 0;
+
+    // 迭代次数在两个阶段中累计
+    Config::Get().maxIterations = 1;
+    ASSERT_THROW(Solve(SymVec{"arctan(x)"_f}, VarsTable{{"x", 3}}), std::runtime_error);
+}
@@ -69,6 +69,20 @@ TEST(Solve, Base) {
         VarsTable got = Solve(equations);
         cout << got << endl;
 
+        ASSERT_EQ(got, expected);
+    }
+    // 折线法
+    {
+        Config::Get().nonlinearMethod = NonlinearMethod::DOGLEG;
+
+        // 结束时恢复设置
+        std::shared_ptr<void> defer(nullptr, [&](...) {
+            Config::Get().Reset();
+        });
+
+        VarsTable got = Solve(equations);
+        cout << got << endl;
+
         ASSERT_EQ(got, expected);
     }
 }
@@ -0,0 +1,39 @@
+#include <tomsolver/sparse_mat.h>
+
+#include "memory_leak_detection.h"
+
+#include <gtest/gtest.h>
+
+using namespace tomsolver;
+
+TEST(SparseMat, Base) {
+    MemoryLeakDetection mld;
+
+    // 顺序任意，重复的位置累加
+    SparseMat A(3, 4, {{2, 3, 1}, {0, 0, 4}, {1, 2, -1}, {0, 2, 2}, {2, 0, 5}, {1, 2, -2}});
+    ASSERT_EQ(A.Rows(), 3);
+    ASSERT_EQ(A.Cols(), 4);
+    ASSERT_EQ(A.NonZeros(), 5);
+    Mat dense = {{4, 0, 2, 0}, {0, 0, -3, 0}, {5, 0, 0, 1}};
+    ASSERT_EQ(A.ToMat(), dense);
+    ASSERT_EQ(A.Value(1, 2), -3);
+    ASSERT_EQ(A.Value(1, 1), 0);
+    ASSERT_EQ(A.RowPointers(), (std::vector<int>{0, 2, 3, 5}));
+    ASSERT_EQ(A.ColIndices(), (std::vector<int>{0, 2, 2, 0, 3}));
+
+    Vec x = {1, 2, 3, 4};
+    Vec y(3);
+    A.Multiply(x, y);
+    ASSERT_EQ(y, (dense * x).ToVec());
+
+    Vec z = {1, -1, 2};
+    Vec w(4);
+    A.TransposeMultiply(z, w);
+    ASSERT_EQ(w, (dense.Transpose() * z).ToVec());
+
+    // 由稠密矩阵构造
+    SparseMat B(dense);
+    ASSERT_EQ(B.NonZeros(), 5);
+    ASSERT_EQ(B.ToMat(), dense);
+    ASSERT_EQ(B.Values(), A.Values());
+}